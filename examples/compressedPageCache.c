@@ -0,0 +1,147 @@
+// LZ4 API example : Compressed page cache
+// Keeps the pages of a file compressed in memory, like a zram device,
+// while several threads rewrite and read them back concurrently.
+
+#define _POSIX_C_SOURCE 199309L   /* clock_gettime */
+#include "lz4page.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+    PAGE_SIZE_BYTES = 4096,
+    NB_THREADS = 4,
+    NB_OPERATIONS = 200000   /* per thread */
+};
+
+typedef struct {
+    LZ4_pageStore* store;
+    char* reference;    /* expected content of all pages */
+    size_t nbPages;
+    unsigned threadNb;
+    unsigned nbErrors;
+} worker_t;
+
+static unsigned nextRandom(unsigned* seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+/* Each thread owns pages n such that n % NB_THREADS == threadNb :
+ * it rewrites them after modifying a few bytes, and checks them when reading them back.
+ * All threads share size classes and page locks, hence exercise concurrent accesses. */
+static void* worker(void* arg)
+{
+    worker_t* const w = (worker_t*)arg;
+    char page[PAGE_SIZE_BYTES];
+    unsigned seed = w->threadNb + 1;
+    int n;
+
+    for (n = 0; n < NB_OPERATIONS; n++) {
+        size_t const pageNb = nextRandom(&seed) % w->nbPages / NB_THREADS * NB_THREADS + w->threadNb;
+        char* const content = w->reference + pageNb * PAGE_SIZE_BYTES;
+        if (pageNb >= w->nbPages) continue;
+        if (nextRandom(&seed) % 4 == 0) {
+            /* dirty the page by moving a few bytes around, then write it back */
+            memmove(content + nextRandom(&seed) % (PAGE_SIZE_BYTES - 16),
+                    content + nextRandom(&seed) % (PAGE_SIZE_BYTES - 16), 16);
+            if (LZ4_pageStore_put(w->store, pageNb, content) <= 0) w->nbErrors++;
+        } else {
+            if (LZ4_pageStore_get(w->store, pageNb, page) != PAGE_SIZE_BYTES
+              || memcmp(page, content, PAGE_SIZE_BYTES)) w->nbErrors++;
+        }
+    }
+    return NULL;
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+int main(int argc, char* argv[])
+{
+    FILE* f;
+    long fileSize;
+    size_t nbPages, n;
+    char* reference;
+    LZ4_pageStore* store;
+    LZ4_pageStoreStats stats;
+    pthread_t threads[NB_THREADS];
+    worker_t workers[NB_THREADS];
+    unsigned nbErrors = 0;
+    double start, elapsed;
+
+    if (argc < 2) {
+        printf("Please specify input filename\n");
+        return 0;
+    }
+
+    /* load file, cut into pages, last one padded with zeroes */
+    f = fopen(argv[1], "rb");
+    if (f == NULL) { printf("Cannot open %s\n", argv[1]); return 1; }
+    fseek(f, 0, SEEK_END);
+    fileSize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    nbPages = (size_t)(fileSize + PAGE_SIZE_BYTES - 1) / PAGE_SIZE_BYTES;
+    if (nbPages < NB_THREADS) nbPages = NB_THREADS;
+    reference = (char*)calloc(nbPages, PAGE_SIZE_BYTES);
+    if (reference == NULL || fread(reference, 1, (size_t)fileSize, f) != (size_t)fileSize) {
+        printf("Cannot read %s\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    /* one compression state per thread */
+    store = LZ4_createPageStore(PAGE_SIZE_BYTES, nbPages, NB_THREADS, 1);
+    if (store == NULL) { printf("LZ4_createPageStore() failed\n"); return 1; }
+    for (n = 0; n < nbPages; n++) {
+        if (LZ4_pageStore_put(store, n, reference + n * PAGE_SIZE_BYTES) <= 0) {
+            printf("LZ4_pageStore_put() failed\n");
+            return 1;
+    }   }
+    LZ4_pageStore_getStats(store, &stats);
+    printf("%u pages stored into %u bytes (%u raw), using %u bytes of memory \n",
+           (unsigned)stats.nbPages, (unsigned)stats.storedSize, (unsigned)stats.nbRawPages, (unsigned)stats.memoryUsed);
+
+    start = now();
+    for (n = 0; n < NB_THREADS; n++) {
+        workers[n].store = store;
+        workers[n].reference = reference;
+        workers[n].nbPages = nbPages;
+        workers[n].threadNb = (unsigned)n;
+        workers[n].nbErrors = 0;
+        pthread_create(&threads[n], NULL, worker, &workers[n]);
+    }
+    for (n = 0; n < NB_THREADS; n++) {
+        pthread_join(threads[n], NULL);
+        nbErrors += workers[n].nbErrors;
+    }
+    elapsed = now() - start;
+    printf("%u threads : %.0f operations/s \n", NB_THREADS, (double)(NB_THREADS * NB_OPERATIONS) / elapsed);
+
+    /* all pages must read back as their last written content */
+    for (n = 0; n < nbPages; n++) {
+        char page[PAGE_SIZE_BYTES];
+        if (LZ4_pageStore_get(store, n, page) != PAGE_SIZE_BYTES
+          || memcmp(page, reference + n * PAGE_SIZE_BYTES, PAGE_SIZE_BYTES)) nbErrors++;
+    }
+    LZ4_pageStore_getStats(store, &stats);
+    printf("%u pages stored into %u bytes (%u raw), using %u bytes of memory \n",
+           (unsigned)stats.nbPages, (unsigned)stats.storedSize, (unsigned)stats.nbRawPages, (unsigned)stats.memoryUsed);
+
+    LZ4_freePageStore(store);
+    free(reference);
+    if (nbErrors) {
+        printf("%u errors \n", nbErrors);
+        return 1;
+    }
+    printf("OK \n");
+    return 0;
+}
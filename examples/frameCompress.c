@@ -23,7 +23,9 @@ static const LZ4F_preferences_t kPrefs = {
     0,   /* compression level; 0 == default */
     0,   /* autoflush */
     0,   /* favor decompression speed */
-    { 0, 0, 0 },  /* reserved, must be set to 0 */
+    0,   /* memory usage; 0 == default */
+    0,   /* skip incompressible blocks */
+    { 0 },  /* reserved, must be set to 0 */
 };
 
 
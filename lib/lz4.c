@@ -180,6 +180,14 @@
 #define unlikely(expr)   expect((expr) != 0, 0)
 #endif
 
+#if (defined(__GNUC__) && (__GNUC__ >= 4)) || defined(__clang__)
+#  define LZ4_PREFETCH_R(ptr)   __builtin_prefetch((const void*)(ptr), 0)
+#  define LZ4_PREFETCH_W(ptr)   __builtin_prefetch((const void*)(ptr), 1)
+#else
+#  define LZ4_PREFETCH_R(ptr)   (void)(ptr)
+#  define LZ4_PREFETCH_W(ptr)   (void)(ptr)
+#endif
+
 /* Should the alignment test prove unreliable, for some reason,
  * it can be disabled by setting LZ4_ALIGN_TEST to 0 */
 #ifndef LZ4_ALIGN_TEST  /* can be externally provided */
@@ -295,6 +303,13 @@ static int LZ4_isAligned(const void* ptr, size_t alignment)
 }
 
 
+/*-************************************
+*  Runtime CPU dispatch
+**************************************/
+/* LZ4_CPU_DISPATCH and LZ4_MULTIVERSION are defined in lz4.h (static section),
+ * so that lz4 programs can reuse them for their own hot loops. */
+
+
 /*-************************************
 *  Types
 **************************************/
@@ -492,29 +507,6 @@ static const int      dec64table[8] = {0, 0, 0, -1, -4,  1, 2, 3};
 
 #if LZ4_FAST_DEC_LOOP
 
-LZ4_FORCE_INLINE void
-LZ4_memcpy_using_offset_base(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd, const size_t offset)
-{
-    assert(srcPtr + offset == dstPtr);
-    if (offset < 8) {
-        LZ4_write32(dstPtr, 0);   /* silence an msan warning when offset==0 */
-        dstPtr[0] = srcPtr[0];
-        dstPtr[1] = srcPtr[1];
-        dstPtr[2] = srcPtr[2];
-        dstPtr[3] = srcPtr[3];
-        srcPtr += inc32table[offset];
-        LZ4_memcpy(dstPtr+4, srcPtr, 4);
-        srcPtr -= dec64table[offset];
-        dstPtr += 8;
-    } else {
-        LZ4_memcpy(dstPtr, srcPtr, 8);
-        dstPtr += 8;
-        srcPtr += 8;
-    }
-
-    LZ4_wildCopy8(dstPtr, srcPtr, dstEnd);
-}
-
 /* customized variant of memcpy, which can overwrite up to 32 bytes beyond dstEnd
  * this version copies two times 16 bytes (instead of one time 32 bytes)
  * because it must be compatible with offsets >= 16. */
@@ -530,44 +522,53 @@ LZ4_wildCopy32(void* dstPtr, const void* srcPtr, void* dstEnd)
 
 /* LZ4_memcpy_using_offset()  presumes :
  * - dstEnd >= dstPtr + MINMATCH
- * - there is at least 8 bytes available to write after dstEnd */
+ * - there is at least 32 bytes available to write after dstEnd
+ * A match with a short offset generates a periodic pattern.
+ * Once its first 16, then 32 bytes are written, they are stored again and again,
+ * advancing by the largest multiple of offset which fits into 16 / 32 bytes. */
+static const BYTE LZ4_patternStep16[16] = { 16, 16, 16, 15, 16, 15, 12, 14, 16,  9, 10, 11, 12, 13, 14, 15 };
+static const BYTE LZ4_patternStep32[16] = { 32, 32, 32, 30, 32, 30, 30, 28, 32, 27, 30, 22, 24, 26, 28, 30 };
+
 LZ4_FORCE_INLINE void
 LZ4_memcpy_using_offset(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd, const size_t offset)
 {
-    BYTE v[8];
+    BYTE* const dstStart = dstPtr;
+    BYTE v[32];
 
     assert(dstEnd >= dstPtr + MINMATCH);
+    assert(offset < 16);
 
-    switch(offset) {
-    case 1:
-        MEM_INIT(v, *srcPtr, 8);
-        break;
-    case 2:
-        LZ4_memcpy(v, srcPtr, 2);
-        LZ4_memcpy(&v[2], srcPtr, 2);
-#if defined(_MSC_VER) && (_MSC_VER <= 1937) /* MSVC 2022 ver 17.7 or earlier */
-#  pragma warning(push)
-#  pragma warning(disable : 6385) /* warning C6385: Reading invalid data from 'v'. */
-#endif
-        LZ4_memcpy(&v[4], v, 4);
-#if defined(_MSC_VER) && (_MSC_VER <= 1937) /* MSVC 2022 ver 17.7 or earlier */
-#  pragma warning(pop)
-#endif
-        break;
-    case 4:
-        LZ4_memcpy(v, srcPtr, 4);
-        LZ4_memcpy(&v[4], srcPtr, 4);
-        break;
-    default:
-        LZ4_memcpy_using_offset_base(dstPtr, srcPtr, dstEnd, offset);
-        return;
+    /* first 16 bytes : once 8 bytes are written,
+     * distance from srcPtr is a multiple of offset, >= 8 */
+    if (offset < 8) {
+        LZ4_write32(dstPtr, 0);   /* silence an msan warning when offset==0 */
+        dstPtr[0] = srcPtr[0];
+        dstPtr[1] = srcPtr[1];
+        dstPtr[2] = srcPtr[2];
+        dstPtr[3] = srcPtr[3];
+        srcPtr += inc32table[offset];
+        LZ4_memcpy(dstPtr+4, srcPtr, 4);
+        srcPtr -= dec64table[offset];
+    } else {
+        LZ4_memcpy(dstPtr, srcPtr, 8);
+        srcPtr += 8;
     }
+    LZ4_memcpy(dstPtr+8, srcPtr, 8);
+    if (dstEnd <= dstStart + 16) return;
+
+    /* up to 32 bytes */
+    {   size_t const step16 = LZ4_patternStep16[offset];
+        LZ4_memcpy(v, dstStart, 16);
+        LZ4_memcpy(dstStart + step16, v, 16);
+        LZ4_memcpy(dstStart + 2*step16, v, 16);
+    }
+    if (dstEnd <= dstStart + 32) return;
 
-    LZ4_memcpy(dstPtr, v, 8);
-    dstPtr += 8;
-    while (dstPtr < dstEnd) {
-        LZ4_memcpy(dstPtr, v, 8);
-        dstPtr += 8;
+    /* rest of the match, by 32-bytes stripes */
+    {   size_t const step32 = LZ4_patternStep32[offset];
+        LZ4_memcpy(v, dstStart, 32);
+        dstPtr = dstStart + step32;
+        do { LZ4_memcpy(dstPtr, v, 32); dstPtr += step32; } while (dstPtr < dstEnd);
     }
 }
 #endif
@@ -675,6 +676,83 @@ static unsigned LZ4_NbCommonBytes (reg_t val)
 }
 
 
+/* LZ4_SIMD_COUNT :
+ * When set to 1, long matches are measured 32 bytes (AVX2) or 64 bytes (AVX-512BW) at a time,
+ * using a routine selected at runtime based on host cpu capabilities.
+ * Short matches, which are the vast majority, keep using the portable code path.
+ * Only effective for x86-64 targets compiled with gcc or clang.
+ * Default : 0 (disabled) */
+#ifndef LZ4_SIMD_COUNT
+#  define LZ4_SIMD_COUNT 0
+#endif
+
+#if LZ4_SIMD_COUNT && defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 6)))
+#  define LZ4_SIMD_COUNT_X86 1
+#  include <immintrin.h>
+#else
+#  define LZ4_SIMD_COUNT_X86 0
+#endif
+
+#if LZ4_SIMD_COUNT_X86
+/* LZ4_countLong_*() :
+ * @return : nb of identical bytes, measured by full vectors only.
+ *  Stops on first mismatching vector, or when less than one vector remains before pInLimit.
+ *  The caller completes the count with the portable code path. */
+typedef unsigned (*LZ4_countLong_f)(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit);
+
+static unsigned LZ4_countLong_none(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    (void)pIn; (void)pMatch; (void)pInLimit;
+    return 0;
+}
+
+__attribute__((target("avx2")))
+static unsigned LZ4_countLong_avx2(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    const BYTE* const pStart = pIn;
+    while (pInLimit - pIn >= 32) {
+        __m256i const a = _mm256_loadu_si256((const __m256i*)(const void*)pIn);
+        __m256i const b = _mm256_loadu_si256((const __m256i*)(const void*)pMatch);
+        unsigned const eq = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        if (eq != 0xFFFFFFFFU) return (unsigned)(pIn - pStart) + (unsigned)__builtin_ctz(~eq);
+        pIn += 32; pMatch += 32;
+    }
+    return (unsigned)(pIn - pStart);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static unsigned LZ4_countLong_avx512(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    const BYTE* const pStart = pIn;
+    while (pInLimit - pIn >= 64) {
+        __m512i const a = _mm512_loadu_si512((const void*)pIn);
+        __m512i const b = _mm512_loadu_si512((const void*)pMatch);
+        __mmask64 const neq = _mm512_cmpneq_epi8_mask(a, b);
+        if (neq) return (unsigned)(pIn - pStart) + (unsigned)__builtin_ctzll((U64)neq);
+        pIn += 64; pMatch += 64;
+    }
+    return (unsigned)(pIn - pStart);
+}
+
+static unsigned LZ4_countLong_init(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit);
+
+/* Selected on first use. Concurrent first calls all store the same value. */
+static LZ4_countLong_f LZ4_countLong = LZ4_countLong_init;
+
+static unsigned LZ4_countLong_init(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    LZ4_countLong_f f = LZ4_countLong_none;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        f = LZ4_countLong_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        f = LZ4_countLong_avx2;
+    }
+    LZ4_countLong = f;
+    return f(pIn, pMatch, pInLimit);
+}
+#endif  /* LZ4_SIMD_COUNT_X86 */
+
 #define STEPSIZE sizeof(reg_t)
 LZ4_FORCE_INLINE
 unsigned LZ4_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
@@ -689,6 +767,14 @@ unsigned LZ4_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
             return LZ4_NbCommonBytes(diff);
     }   }
 
+#if LZ4_SIMD_COUNT_X86
+    /* second word also identical : likely a long match, worth vector comparisons */
+    if (likely(pIn < pInLimit-(STEPSIZE-1)) && (LZ4_read_ARCH(pMatch) == LZ4_read_ARCH(pIn))) {
+        unsigned const n = LZ4_countLong(pIn, pMatch, pInLimit);
+        pIn += n; pMatch += n;
+    }
+#endif
+
     while (likely(pIn < pInLimit-(STEPSIZE-1))) {
         reg_t const diff = LZ4_read_ARCH(pMatch) ^ LZ4_read_ARCH(pIn);
         if (!diff) { pIn+=STEPSIZE; pMatch+=STEPSIZE; continue; }
@@ -742,6 +828,17 @@ typedef enum { clearedTable = 0, byPtr, byU32, byU16 } tableType_t;
 typedef enum { noDict = 0, withPrefix64k, usingExtDict, usingDictCtx } dict_directive;
 typedef enum { noDictIssue = 0, dictSmall } dictIssue_directive;
 
+/**
+ * This enum selects how a match is chosen once one is found :
+ *
+ * - searchFast : the first match found is emitted (LZ4_compress_fast()).
+ *
+ * - searchLazy : before emitting a match, the next position is also probed,
+ *                and its match is preferred when it's longer (LZ4_compress_lazy()).
+ *                Only supported with noDict.
+ */
+typedef enum { searchFast = 0, searchLazy } search_directive;
+
 
 /*-************************************
 *  Local Utils
@@ -774,17 +871,27 @@ int LZ4_decompress_safe_partial_forceExtDict(const char* source, char* dest,
 /*-******************************
 *  Compression functions
 ********************************/
-LZ4_FORCE_INLINE U32 LZ4_hash4(U32 sequence, tableType_t const tableType)
+/* LZ4_streamMemoryUsage() :
+ * hash table size (log2, in bytes) of a given state */
+LZ4_FORCE_INLINE U32 LZ4_streamMemoryUsage(const LZ4_stream_t_internal* cctx)
+{
+    return cctx->memoryUsage ? cctx->memoryUsage : LZ4_MEMORY_USAGE;
+}
+
+/* LZ4_tableHashLog() :
+ * nb of hash bits addressing a table of (1 << memoryUsage) bytes */
+LZ4_FORCE_INLINE U32 LZ4_tableHashLog(U32 memoryUsage, tableType_t const tableType)
+{
+    return (tableType == byU16) ? memoryUsage-1 : memoryUsage-2;
+}
+
+LZ4_FORCE_INLINE U32 LZ4_hash4(U32 sequence, U32 const hashLog)
 {
-    if (tableType == byU16)
-        return ((sequence * 2654435761U) >> ((MINMATCH*8)-(LZ4_HASHLOG+1)));
-    else
-        return ((sequence * 2654435761U) >> ((MINMATCH*8)-LZ4_HASHLOG));
+    return ((sequence * 2654435761U) >> ((MINMATCH*8)-hashLog));
 }
 
-LZ4_FORCE_INLINE U32 LZ4_hash5(U64 sequence, tableType_t const tableType)
+LZ4_FORCE_INLINE U32 LZ4_hash5(U64 sequence, U32 const hashLog)
 {
-    const U32 hashLog = (tableType == byU16) ? LZ4_HASHLOG+1 : LZ4_HASHLOG;
     if (LZ4_isLittleEndian()) {
         const U64 prime5bytes = 889523592379ULL;
         return (U32)(((sequence << 24) * prime5bytes) >> (64 - hashLog));
@@ -794,14 +901,14 @@ LZ4_FORCE_INLINE U32 LZ4_hash5(U64 sequence, tableType_t const tableType)
     }
 }
 
-LZ4_FORCE_INLINE U32 LZ4_hashPosition(const void* const p, tableType_t const tableType)
+LZ4_FORCE_INLINE U32 LZ4_hashPosition(const void* const p, tableType_t const tableType, U32 const hashLog)
 {
-    if ((sizeof(reg_t)==8) && (tableType != byU16)) return LZ4_hash5(LZ4_read_ARCH(p), tableType);
+    if ((sizeof(reg_t)==8) && (tableType != byU16)) return LZ4_hash5(LZ4_read_ARCH(p), hashLog);
 
 #ifdef LZ4_STATIC_LINKING_ONLY_ENDIANNESS_INDEPENDENT_OUTPUT
-    return LZ4_hash4(LZ4_readLE32(p), tableType);
+    return LZ4_hash4(LZ4_readLE32(p), hashLog);
 #else
-    return LZ4_hash4(LZ4_read32(p), tableType);
+    return LZ4_hash4(LZ4_read32(p), hashLog);
 #endif
 }
 
@@ -838,9 +945,9 @@ LZ4_FORCE_INLINE void LZ4_putPositionOnHash(const BYTE* p, U32 h,
     hashTable[h] = p;
 }
 
-LZ4_FORCE_INLINE void LZ4_putPosition(const BYTE* p, void* tableBase, tableType_t tableType)
+LZ4_FORCE_INLINE void LZ4_putPosition(const BYTE* p, void* tableBase, tableType_t tableType, U32 hashLog)
 {
-    U32 const h = LZ4_hashPosition(p, tableType);
+    U32 const h = LZ4_hashPosition(p, tableType, hashLog);
     LZ4_putPositionOnHash(p, h, tableBase, tableType);
 }
 
@@ -855,12 +962,12 @@ LZ4_FORCE_INLINE U32 LZ4_getIndexOnHash(U32 h, const void* tableBase, tableType_
     LZ4_STATIC_ASSERT(LZ4_MEMORY_USAGE > 2);
     if (tableType == byU32) {
         const U32* const hashTable = (const U32*) tableBase;
-        assert(h < (1U << (LZ4_MEMORY_USAGE-2)));
+        assert(h < (1U << (LZ4_MEMORY_USAGE_MAX-2)));
         return hashTable[h];
     }
     if (tableType == byU16) {
         const U16* const hashTable = (const U16*) tableBase;
-        assert(h < (1U << (LZ4_MEMORY_USAGE-1)));
+        assert(h < (1U << (LZ4_MEMORY_USAGE_MAX-1)));
         return hashTable[h];
     }
     assert(0); return 0;  /* forbidden case */
@@ -874,9 +981,9 @@ static const BYTE* LZ4_getPositionOnHash(U32 h, const void* tableBase, tableType
 
 LZ4_FORCE_INLINE const BYTE*
 LZ4_getPosition(const BYTE* p,
-                const void* tableBase, tableType_t tableType)
+                const void* tableBase, tableType_t tableType, U32 hashLog)
 {
-    U32 const h = LZ4_hashPosition(p, tableType);
+    U32 const h = LZ4_hashPosition(p, tableType, hashLog);
     return LZ4_getPositionOnHash(h, tableBase, tableType);
 }
 
@@ -897,7 +1004,7 @@ LZ4_prepareTable(LZ4_stream_t_internal* const cctx,
           || inputSize >= 4 KB)
         {
             DEBUGLOG(4, "LZ4_prepareTable: Resetting table in %p", cctx);
-            MEM_INIT(cctx->hashTable, 0, LZ4_HASHTABLESIZE);
+            MEM_INIT(cctx->hashTable, 0, (size_t)1 << LZ4_streamMemoryUsage(cctx));
             cctx->currentOffset = 0;
             cctx->tableType = (U32)clearedTable;
         } else {
@@ -938,6 +1045,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
                  const tableType_t tableType,
                  const dict_directive dictDirective,
                  const dictIssue_directive dictIssue,
+                 const search_directive search,
                  const int acceleration)
 {
     int result;
@@ -973,6 +1081,9 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
     BYTE* op = (BYTE*) dest;
     BYTE* const olimit = op + maxOutputSize;
 
+    U32 const hashLog = LZ4_tableHashLog(LZ4_streamMemoryUsage(cctx), tableType);
+    U32 const dictHashLog = (dictDirective == usingDictCtx) ? LZ4_tableHashLog(LZ4_streamMemoryUsage(dictCtx), byU32) : hashLog;
+
     U32 offset = 0;
     U32 forwardH;
 
@@ -980,6 +1091,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
     assert(ip != NULL);
     if (tableType == byU16) assert(inputSize<LZ4_64Klimit);  /* Size too large (not within 64K limit) */
     if (tableType == byPtr) assert(dictDirective==noDict);   /* only supported use case with byPtr */
+    if (search == searchLazy) assert(dictDirective==noDict);  /* only supported use case with searchLazy */
     /* If init conditions are not met, we don't have to mark stream
      * as having dirty context, since no action was taken yet */
     if (outputDirective == fillOutput && maxOutputSize < 1) { return 0; } /* Impossible to store anything */
@@ -1002,13 +1114,13 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
     if (inputSize<LZ4_minLength) goto _last_literals;        /* Input too small, no compression (all literals) */
 
     /* First Byte */
-    {   U32 const h = LZ4_hashPosition(ip, tableType);
+    {   U32 const h = LZ4_hashPosition(ip, tableType, hashLog);
         if (tableType == byPtr) {
             LZ4_putPositionOnHash(ip, h, cctx->hashTable, byPtr);
         } else {
             LZ4_putIndexOnHash(startIndex, h, cctx->hashTable, tableType);
     }   }
-    ip++; forwardH = LZ4_hashPosition(ip, tableType);
+    ip++; forwardH = LZ4_hashPosition(ip, tableType, hashLog);
 
     /* Main Loop */
     for ( ; ; ) {
@@ -1031,7 +1143,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
                 assert(ip < mflimitPlusOne);
 
                 match = LZ4_getPositionOnHash(h, cctx->hashTable, tableType);
-                forwardH = LZ4_hashPosition(forwardIp, tableType);
+                forwardH = LZ4_hashPosition(forwardIp, tableType, hashLog);
                 LZ4_putPositionOnHash(ip, h, cctx->hashTable, tableType);
 
             } while ( (match+LZ4_DISTANCE_MAX < ip)
@@ -1059,7 +1171,8 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
                     if (matchIndex < startIndex) {
                         /* there was no match, try the dictionary */
                         assert(tableType == byU32);
-                        matchIndex = LZ4_getIndexOnHash(h, dictCtx->hashTable, byU32);
+                        matchIndex = LZ4_getIndexOnHash((dictHashLog == hashLog) ? h : LZ4_hashPosition(ip, byU32, dictHashLog),
+                                                        dictCtx->hashTable, byU32);
                         match = dictBase + matchIndex;
                         matchIndex += dictDelta;   /* make dictCtx index comparable with current context */
                         lowLimit = dictionary;
@@ -1081,7 +1194,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
                 } else {   /* single continuous memory segment */
                     match = base + matchIndex;
                 }
-                forwardH = LZ4_hashPosition(forwardIp, tableType);
+                forwardH = LZ4_hashPosition(forwardIp, tableType, hashLog);
                 LZ4_putIndexOnHash(current, h, cctx->hashTable, tableType);
 
                 DEBUGLOG(7, "candidate at pos=%u  (offset=%u \n", matchIndex, current - matchIndex);
@@ -1101,6 +1214,32 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
             } while(1);
         }
 
+        /* Lazy step : a longer match starting at next position is preferred */
+        if ((search == searchLazy) && (ip+1 < mflimitPlusOne)) {
+            const BYTE* const ip1 = ip+1;
+            const BYTE* match1;
+            U32 const h1 = LZ4_hashPosition(ip1, tableType, hashLog);
+            int valid;
+            if (tableType == byPtr) {
+                match1 = LZ4_getPositionOnHash(h1, cctx->hashTable, byPtr);
+                LZ4_putPositionOnHash(ip1, h1, cctx->hashTable, byPtr);
+                valid = (match1+LZ4_DISTANCE_MAX >= ip1);
+            } else {
+                U32 const current1 = (U32)(ip1 - base);
+                U32 const matchIndex1 = LZ4_getIndexOnHash(h1, cctx->hashTable, tableType);
+                assert(matchIndex1 < current1);
+                match1 = base + matchIndex1;
+                LZ4_putIndexOnHash(current1, h1, cctx->hashTable, tableType);
+                valid = ((dictIssue == dictSmall) ? (matchIndex1 >= prefixIdxLimit) : 1)
+                     && (matchIndex1+LZ4_DISTANCE_MAX >= current1);
+            }
+            if (valid && (LZ4_read32(match1) == LZ4_read32(ip1))) {
+                unsigned const len0 = LZ4_count(ip+MINMATCH, match+MINMATCH, matchlimit);
+                unsigned const len1 = LZ4_count(ip1+MINMATCH, match1+MINMATCH, matchlimit);
+                if (len1 > len0) { ip = ip1; match = match1; }
+            }
+        }
+
         /* Catch up */
         filledIp = ip;
         assert(ip > anchor); /* this is always true as ip has been advanced before entering the main loop */
@@ -1201,7 +1340,7 @@ _next_match:
                         const BYTE* ptr;
                         DEBUGLOG(5, "Clearing %u positions", (U32)(filledIp - ip));
                         for (ptr = ip; ptr <= filledIp; ++ptr) {
-                            U32 const h = LZ4_hashPosition(ptr, tableType);
+                            U32 const h = LZ4_hashPosition(ptr, tableType, hashLog);
                             LZ4_clearHash(h, cctx->hashTable, tableType);
                         }
                     }
@@ -1233,7 +1372,7 @@ _next_match:
         if (ip >= mflimitPlusOne) break;
 
         /* Fill table */
-        {   U32 const h = LZ4_hashPosition(ip-2, tableType);
+        {   U32 const h = LZ4_hashPosition(ip-2, tableType, hashLog);
             if (tableType == byPtr) {
                 LZ4_putPositionOnHash(ip-2, h, cctx->hashTable, byPtr);
             } else {
@@ -1244,15 +1383,15 @@ _next_match:
         /* Test next position */
         if (tableType == byPtr) {
 
-            match = LZ4_getPosition(ip, cctx->hashTable, tableType);
-            LZ4_putPosition(ip, cctx->hashTable, tableType);
+            match = LZ4_getPosition(ip, cctx->hashTable, tableType, hashLog);
+            LZ4_putPosition(ip, cctx->hashTable, tableType, hashLog);
             if ( (match+LZ4_DISTANCE_MAX >= ip)
               && (LZ4_read32(match) == LZ4_read32(ip)) )
             { token=op++; *token=0; goto _next_match; }
 
         } else {   /* byU32, byU16 */
 
-            U32 const h = LZ4_hashPosition(ip, tableType);
+            U32 const h = LZ4_hashPosition(ip, tableType, hashLog);
             U32 const current = (U32)(ip-base);
             U32 matchIndex = LZ4_getIndexOnHash(h, cctx->hashTable, tableType);
             assert(matchIndex < current);
@@ -1260,7 +1399,8 @@ _next_match:
                 if (matchIndex < startIndex) {
                     /* there was no match, try the dictionary */
                     assert(tableType == byU32);
-                    matchIndex = LZ4_getIndexOnHash(h, dictCtx->hashTable, byU32);
+                    matchIndex = LZ4_getIndexOnHash((dictHashLog == hashLog) ? h : LZ4_hashPosition(ip, byU32, dictHashLog),
+                                                    dictCtx->hashTable, byU32);
                     match = dictBase + matchIndex;
                     lowLimit = dictionary;   /* required for match length counter */
                     matchIndex += dictDelta;
@@ -1295,7 +1435,7 @@ _next_match:
         }
 
         /* Prepare next loop */
-        forwardH = LZ4_hashPosition(++ip, tableType);
+        forwardH = LZ4_hashPosition(++ip, tableType, hashLog);
 
     }
 
@@ -1375,10 +1515,11 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
     return LZ4_compress_generic_validated(cctx, src, dst, srcSize,
                 inputConsumed, /* only written into if outputDirective == fillOutput */
                 dstCapacity, outputDirective,
-                tableType, dictDirective, dictIssue, acceleration);
+                tableType, dictDirective, dictIssue, searchFast, acceleration);
 }
 
 
+LZ4_MULTIVERSION
 int LZ4_compress_fast_extState(void* state, const char* source, char* dest, int inputSize, int maxOutputSize, int acceleration)
 {
     LZ4_stream_t_internal* const ctx = & LZ4_initStream(state, sizeof(LZ4_stream_t)) -> internal_donotuse;
@@ -1402,22 +1543,12 @@ int LZ4_compress_fast_extState(void* state, const char* source, char* dest, int
     }
 }
 
-/**
- * LZ4_compress_fast_extState_fastReset() :
- * A variant of LZ4_compress_fast_extState().
- *
- * Using this variant avoids an expensive initialization step. It is only safe
- * to call if the state buffer is known to be correctly initialized already
- * (see comment in lz4.h on LZ4_resetStream_fast() for a definition of
- * "correctly initialized").
- */
-int LZ4_compress_fast_extState_fastReset(void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration)
+/* LZ4_compress_fastReset_internal() :
+ * body of LZ4_compress_fast_extState_fastReset(), @acceleration already clamped */
+LZ4_FORCE_INLINE int LZ4_compress_fastReset_internal(LZ4_stream_t_internal* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration)
 {
-    LZ4_stream_t_internal* const ctx = &((LZ4_stream_t*)state)->internal_donotuse;
-    if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
-    if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
     assert(ctx != NULL);
-
+    assert(acceleration >= 1 && acceleration <= LZ4_ACCELERATION_MAX);
     if (dstCapacity >= LZ4_compressBound(srcSize)) {
         if (srcSize < LZ4_64Klimit) {
             const tableType_t tableType = byU16;
@@ -1449,6 +1580,45 @@ int LZ4_compress_fast_extState_fastReset(void* state, const char* src, char* dst
     }
 }
 
+/**
+ * LZ4_compress_fast_extState_fastReset() :
+ * A variant of LZ4_compress_fast_extState().
+ *
+ * Using this variant avoids an expensive initialization step. It is only safe
+ * to call if the state buffer is known to be correctly initialized already
+ * (see comment in lz4.h on LZ4_resetStream_fast() for a definition of
+ * "correctly initialized").
+ */
+LZ4_MULTIVERSION
+int LZ4_compress_fast_extState_fastReset(void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration)
+{
+    if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
+    if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
+    return LZ4_compress_fastReset_internal(&((LZ4_stream_t*)state)->internal_donotuse, src, dst, srcSize, dstCapacity, acceleration);
+}
+
+static size_t LZ4_stream_t_alignment(void);
+
+LZ4_MULTIVERSION
+int LZ4_compress_fast_batch(void* state,
+                      const char* const srcs[], const int srcSizes[],
+                            char* const dsts[], const int dstCapacities[],
+                            int cSizes[], int nbInputs, int acceleration)
+{
+    LZ4_stream_t_internal* ctx;
+    int n, nbCompressed = 0;
+    DEBUGLOG(5, "LZ4_compress_fast_batch (%i inputs)", nbInputs);
+    if (!LZ4_isAligned(state, LZ4_stream_t_alignment())) return 0;
+    ctx = &((LZ4_stream_t*)state)->internal_donotuse;   /* only once alignment is validated */
+    if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
+    if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
+    for (n = 0; n < nbInputs; n++) {
+        cSizes[n] = LZ4_compress_fastReset_internal(ctx, srcs[n], dsts[n], srcSizes[n], dstCapacities[n], acceleration);
+        nbCompressed += (cSizes[n] > 0);
+    }
+    return nbCompressed;
+}
+
 
 int LZ4_compress_fast(const char* src, char* dest, int srcSize, int dstCapacity, int acceleration)
 {
@@ -1475,9 +1645,313 @@ int LZ4_compress_default(const char* src, char* dst, int srcSize, int dstCapacit
 }
 
 
+LZ4_MULTIVERSION
+int LZ4_compress_lazy_extState(void* state, const char* src, char* dst, int srcSize, int dstCapacity)
+{
+    LZ4_stream_t_internal* const ctx = & LZ4_initStream(state, sizeof(LZ4_stream_t)) -> internal_donotuse;
+    limitedOutput_directive const outputDirective = (dstCapacity >= LZ4_compressBound(srcSize)) ? notLimited : limitedOutput;
+    assert(ctx != NULL);
+    if ((U32)srcSize > (U32)LZ4_MAX_INPUT_SIZE) return 0;
+    if (srcSize == 0) return LZ4_compress_generic(ctx, src, dst, 0, NULL, dstCapacity, outputDirective, byU32, noDict, noDictIssue, 1);
+    assert(src != NULL);
+    if (srcSize < LZ4_64Klimit) {
+        return LZ4_compress_generic_validated(ctx, src, dst, srcSize, NULL, dstCapacity, outputDirective, byU16, noDict, noDictIssue, searchLazy, 1);
+    } else {
+        const tableType_t tableType = ((sizeof(void*)==4) && ((uptrval)src > LZ4_DISTANCE_MAX)) ? byPtr : byU32;
+        return LZ4_compress_generic_validated(ctx, src, dst, srcSize, NULL, dstCapacity, outputDirective, tableType, noDict, noDictIssue, searchLazy, 1);
+    }
+}
+
+
+int LZ4_compress_lazy(const char* src, char* dst, int srcSize, int dstCapacity)
+{
+    int result;
+#if (LZ4_HEAPMODE)
+    LZ4_stream_t* const ctxPtr = (LZ4_stream_t*)ALLOC(sizeof(LZ4_stream_t));   /* malloc-calloc always properly aligned */
+    if (ctxPtr == NULL) return 0;
+#else
+    LZ4_stream_t ctx;
+    LZ4_stream_t* const ctxPtr = &ctx;
+#endif
+    result = LZ4_compress_lazy_extState(ctxPtr, src, dst, srcSize, dstCapacity);
+
+#if (LZ4_HEAPMODE)
+    FREEMEM(ctxPtr);
+#endif
+    return result;
+}
+
+
+/*-******************************
+*  Compressed size estimation
+********************************/
+/* LZ4_estimate_candidate() :
+ * inserts @ip into hash table,
+ * @return : previous position sharing the same hash, or NULL if it is too far */
+LZ4_FORCE_INLINE const BYTE*
+LZ4_estimate_candidate(const BYTE* ip, U32 h, void* tableBase, tableType_t tableType, const BYTE* base)
+{
+    if (tableType == byPtr) {
+        const BYTE* const match = LZ4_getPositionOnHash(h, tableBase, byPtr);
+        LZ4_putPositionOnHash(ip, h, tableBase, byPtr);
+        return (match+LZ4_DISTANCE_MAX < ip) ? NULL : match;
+    } else {
+        U32 const current = (U32)(ip - base);
+        U32 const matchIndex = LZ4_getIndexOnHash(h, tableBase, tableType);
+        assert(matchIndex <= current);
+        LZ4_putIndexOnHash(current, h, tableBase, tableType);
+        if ( ((tableType != byU16) || (LZ4_DISTANCE_MAX < LZ4_DISTANCE_ABSOLUTE_MAX))
+          && (matchIndex+LZ4_DISTANCE_MAX < current) ) return NULL;
+        return base + matchIndex;
+    }
+}
+
+/* nb of bytes added to token by a literal or match length field */
+LZ4_FORCE_INLINE size_t LZ4_estimate_lengthBytes(size_t len)
+{
+    return (len >= RUN_MASK) ? ((len - RUN_MASK) / 255) + 1 : 0;
+}
+
+/* LZ4_estimate_generic() :
+ * Same parsing as LZ4_compress_generic(), with noDict, on a freshly initialized state.
+ * Sequences are not written : only their size is accounted.
+ * Accounting starts with the first sequence beginning at or after @countStart,
+ * input before it only fills the hash table, like history would.
+ * *countedSrcSizePtr receives the nb of input bytes accounted.
+ * @return : the size LZ4_compress_generic() would produce for accounted bytes, with enough dst capacity */
+LZ4_FORCE_INLINE size_t LZ4_estimate_generic(
+                 LZ4_stream_t_internal* const cctx,
+                 const char* const source,
+                 const int inputSize,
+                 const char* const countStart,
+                 size_t* countedSrcSizePtr,
+                 const tableType_t tableType,
+                 const int acceleration)
+{
+    const BYTE* ip = (const BYTE*)source;
+    const BYTE* const base = (const BYTE*)source;
+    const BYTE* anchor = (const BYTE*)source;
+    const BYTE* const iend = ip + inputSize;
+    const BYTE* const mflimitPlusOne = iend - MFLIMIT + 1;
+    const BYTE* const matchlimit = iend - LASTLITERALS;
+    U32 const hashLog = LZ4_tableHashLog(LZ4_streamMemoryUsage(cctx), tableType);
+    const BYTE* const countLimit = (const BYTE*)countStart;
+    const BYTE* countFrom = (countLimit <= anchor) ? anchor : NULL;
+    const BYTE* seqStart;      /* current sequence : literals start */
+    const BYTE* matchStart;    /* current sequence : match start */
+    size_t seqCSize;           /* compressed size before current sequence */
+    size_t cSize = 0;
+    size_t skippedCSize = 0;
+    U32 forwardH;
+
+    assert(cctx->currentOffset == 0);
+    assert(acceleration >= 1);
+    if (inputSize<LZ4_minLength) goto _last_literals;
+
+    /* First Byte */
+    (void)LZ4_estimate_candidate(ip, LZ4_hashPosition(ip, tableType, hashLog), cctx->hashTable, tableType, base);
+    ip++; forwardH = LZ4_hashPosition(ip, tableType, hashLog);
+
+    /* Main Loop */
+    for ( ; ; ) {
+        const BYTE* match;
+
+        /* Find a match */
+        {   const BYTE* forwardIp = ip;
+            int step = 1;
+            int searchMatchNb = acceleration << LZ4_skipTrigger;
+            do {
+                U32 const h = forwardH;
+                ip = forwardIp;
+                forwardIp += step;
+                step = (searchMatchNb++ >> LZ4_skipTrigger);
+
+                if (unlikely(forwardIp > mflimitPlusOne)) goto _last_literals;
+
+                match = LZ4_estimate_candidate(ip, h, cctx->hashTable, tableType, base);
+                forwardH = LZ4_hashPosition(forwardIp, tableType, hashLog);
+            } while ( (match == NULL) || (LZ4_read32(match) != LZ4_read32(ip)) );
+        }
+
+        /* Catch up */
+        if ((match > base) && unlikely(ip[-1] == match[-1])) {
+            do { ip--; match--; } while (((ip > anchor) & (match > base)) && (unlikely(ip[-1] == match[-1])));
+        }
+
+        /* Literals */
+        seqStart = anchor; matchStart = ip; seqCSize = cSize;
+        {   size_t const litLength = (size_t)(ip - anchor);
+            cSize += 1 /* token */ + LZ4_estimate_lengthBytes(litLength) + litLength;
+        }
+
+_next_match:
+        /* Offset and MatchLength */
+        {   unsigned const matchCode = LZ4_count(ip+MINMATCH, match+MINMATCH, matchlimit);
+            ip += (size_t)matchCode + MINMATCH;
+            cSize += 2 /* offset */ + LZ4_estimate_lengthBytes(matchCode);
+        }
+        anchor = ip;
+        if (unlikely(countFrom == NULL) && (anchor >= countLimit)) {
+            if (matchStart >= countLimit) {
+                /* literals of this sequence preceding countLimit are not accounted */
+                countFrom = (seqStart > countLimit) ? seqStart : countLimit;
+                skippedCSize = seqCSize + (size_t)(countFrom - seqStart);
+            } else {
+                countFrom = anchor;
+                skippedCSize = cSize;
+        }   }
+
+        /* Test end of chunk */
+        if (ip >= mflimitPlusOne) break;
+
+        /* Fill table */
+        (void)LZ4_estimate_candidate(ip-2, LZ4_hashPosition(ip-2, tableType, hashLog), cctx->hashTable, tableType, base);
+
+        /* Test next position */
+        match = LZ4_estimate_candidate(ip, LZ4_hashPosition(ip, tableType, hashLog), cctx->hashTable, tableType, base);
+        if ((match != NULL) && (LZ4_read32(match) == LZ4_read32(ip))) {
+            seqStart = ip; matchStart = ip; seqCSize = cSize;
+            cSize += 1;   /* token */
+            goto _next_match;
+        }
+
+        /* Prepare next loop */
+        forwardH = LZ4_hashPosition(++ip, tableType, hashLog);
+    }
+
+_last_literals:
+    if (countFrom == NULL) {
+        countFrom = (anchor > countLimit) ? anchor : countLimit;
+        skippedCSize = cSize + (size_t)(countFrom - anchor);
+    }
+    {   size_t const lastRun = (size_t)(iend - anchor);
+        cSize += 1 /* token */ + LZ4_estimate_lengthBytes(lastRun) + lastRun;
+    }
+    *countedSrcSizePtr = (size_t)(iend - countFrom);
+    return cSize - skippedCSize;
+}
+
+/* LZ4_estimate_extState() :
+ * selects the same table type as LZ4_compress_fast_extState() would for an input of @fullSize bytes,
+ * which @src is part of */
+static size_t LZ4_estimate_extState(LZ4_stream_t* state, const char* src, int srcSize, int fullSize,
+                                    const char* countStart, size_t* countedSrcSizePtr, int acceleration)
+{
+    LZ4_stream_t_internal* const ctx = &LZ4_initStream(state, sizeof(LZ4_stream_t))->internal_donotuse;
+    assert(ctx != NULL);
+    assert(0 < srcSize && srcSize <= fullSize);
+    if (fullSize < LZ4_64Klimit) {
+        return LZ4_estimate_generic(ctx, src, srcSize, countStart, countedSrcSizePtr, byU16, acceleration);
+    } else {
+        const tableType_t tableType = ((sizeof(void*)==4) && ((uptrval)src > LZ4_DISTANCE_MAX)) ? byPtr : byU32;
+        return LZ4_estimate_generic(ctx, src, srcSize, countStart, countedSrcSizePtr, tableType, acceleration);
+    }
+}
+
+/* LZ4_isqrt64() :
+ * integer square root, rounded down */
+static U64 LZ4_isqrt64(U64 v)
+{
+    U64 r = 0;
+    U64 bit = (U64)1 << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) { v -= r + bit; r = (r >> 1) + bit; }
+        else r >>= 1;
+        bit >>= 2;
+    }
+    return r;
+}
+
+/* Each sampled chunk is preceded by a warm-up segment, which fills the hash table like history would,
+ * but is not accounted. Shorter warm-ups noticeably overestimate compressed size. */
+#define LZ4_ESTIMATE_WARMUP_SIZE (64 KB)
+
+int LZ4_estimateCompressedSize_sampled(const char* src, int srcSize, int acceleration,
+                                       int sampleLog, int* errorBoundPtr)
+{
+    int const chunkSize = LZ4_ESTIMATE_CHUNK_SIZE;
+    int const nbChunks = (srcSize > 0) ? srcSize / chunkSize : 0;
+    int step, first, nbSamples;
+    size_t result;
+#if (LZ4_HEAPMODE)
+    LZ4_stream_t* ctxPtr;
+#else
+    LZ4_stream_t ctx;
+    LZ4_stream_t* const ctxPtr = &ctx;
+#endif
+
+    if (errorBoundPtr) *errorBoundPtr = 0;
+    if ((srcSize < 0) || (srcSize > LZ4_MAX_INPUT_SIZE)) return 0;
+    if (srcSize == 0) return 1;
+    if (src == NULL) return 0;
+    if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
+    if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
+    if (sampleLog < 0) sampleLog = 0;
+    if (sampleLog > 20) sampleLog = 20;
+    step = 1 << sampleLog;
+    first = step / 2;   /* middle of each group of chunks */
+    nbSamples = (nbChunks > first) ? (nbChunks - first + step - 1) / step : 0;
+#if (LZ4_HEAPMODE)
+    ctxPtr = (LZ4_stream_t*)ALLOC(sizeof(LZ4_stream_t));   /* malloc-calloc always properly aligned */
+    if (ctxPtr == NULL) return 0;
+#endif
+
+    if ((sampleLog == 0) || (nbSamples < 2)) {
+        /* not enough chunks to sample : full estimation */
+        size_t counted;
+        result = LZ4_estimate_extState(ctxPtr, src, srcSize, srcSize, src, &counted, acceleration);
+        assert(counted == (size_t)srcSize);
+    } else {
+        /* sampled chunks are extrapolated, the remainder is fully estimated */
+        U64 sum = 0, sumSq = 0;
+        int const tailStart = nbChunks * chunkSize;
+        int c;
+        for (c = first; c < nbChunks; c += step) {
+            int const chunkStart = c * chunkSize;
+            int const warmStart = (chunkStart > LZ4_ESTIMATE_WARMUP_SIZE) ? chunkStart - LZ4_ESTIMATE_WARMUP_SIZE : 0;
+            size_t counted;
+            U64 cSize = LZ4_estimate_extState(ctxPtr, src + warmStart, chunkStart + chunkSize - warmStart, srcSize,
+                                              src + chunkStart, &counted, acceleration);
+            cSize = (cSize * (U64)chunkSize) / counted;   /* first sequence may start a bit after chunkStart */
+            sum += cSize;
+            sumSq += cSize * cSize;
+        }
+        result = (size_t)((sum * (U64)nbChunks) / (U64)nbSamples);
+        if (tailStart < srcSize) {
+            int const warmStart = (tailStart > LZ4_ESTIMATE_WARMUP_SIZE) ? tailStart - LZ4_ESTIMATE_WARMUP_SIZE : 0;
+            size_t counted;
+            result += LZ4_estimate_extState(ctxPtr, src + warmStart, srcSize - warmStart, srcSize,
+                                            src + tailStart, &counted, acceleration);
+        }
+        if (errorBoundPtr) {
+            /* 2 standard deviations of the sampled total, with finite population correction :
+             * var = nbChunks^2 * (1 - nbSamples/nbChunks) * s^2 / nbSamples */
+            U64 const n = (U64)nbSamples;
+            U64 const N = (U64)nbChunks;
+            U64 const ssd = sumSq - (sum * sum) / n;   /* (n-1) * s^2 */
+            U64 const variance = (N * (N - n) / n) * ssd / (n - 1);
+            U64 const bound = 2 * LZ4_isqrt64(variance);
+            *errorBoundPtr = (bound < (U64)srcSize) ? (int)bound : srcSize;
+        }
+    }
+
+#if (LZ4_HEAPMODE)
+    FREEMEM(ctxPtr);
+#endif
+    return (int)result;
+}
+
+int LZ4_estimateCompressedSize(const char* src, int srcSize, int acceleration)
+{
+    return LZ4_estimateCompressedSize_sampled(src, srcSize, acceleration, 0, NULL);
+}
+
+
 /* Note!: This function leaves the stream in an unclean/broken state!
  * It is not safe to subsequently use the same state with a _fastReset() or
  * _continue() call without resetting it. */
+LZ4_MULTIVERSION
 static int LZ4_compress_destSize_extState_internal(LZ4_stream_t* state, const char* src, char* dst, int* srcSizePtr, int targetDstSize, int acceleration)
 {
     void* const s = LZ4_initStream(state, sizeof (*state));
@@ -1503,6 +1977,31 @@ int LZ4_compress_destSize_extState(void* state, const char* src, char* dst, int*
 }
 
 
+int LZ4_compress_destSize_extState_fastReset(void* state, const char* src, char* dst, int* srcSizePtr, int targetDstSize, int acceleration)
+{
+    LZ4_stream_t_internal* const ctx = &((LZ4_stream_t*)state)->internal_donotuse;
+    assert(ctx != NULL);
+
+    if (targetDstSize >= LZ4_compressBound(*srcSizePtr)) {  /* compression success is guaranteed */
+        return LZ4_compress_fast_extState_fastReset(state, src, dst, *srcSizePtr, targetDstSize, acceleration);
+    }
+    if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
+    if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
+    if (*srcSizePtr < LZ4_64Klimit) {
+        const tableType_t tableType = byU16;
+        LZ4_prepareTable(ctx, *srcSizePtr, tableType);
+        if (ctx->currentOffset) {
+            return LZ4_compress_generic(ctx, src, dst, *srcSizePtr, srcSizePtr, targetDstSize, fillOutput, tableType, noDict, dictSmall, acceleration);
+        } else {
+            return LZ4_compress_generic(ctx, src, dst, *srcSizePtr, srcSizePtr, targetDstSize, fillOutput, tableType, noDict, noDictIssue, acceleration);
+        }
+    } else {
+        const tableType_t tableType = ((sizeof(void*)==4) && ((uptrval)src > LZ4_DISTANCE_MAX)) ? byPtr : byU32;
+        LZ4_prepareTable(ctx, *srcSizePtr, tableType);
+        return LZ4_compress_generic(ctx, src, dst, *srcSizePtr, srcSizePtr, targetDstSize, fillOutput, tableType, noDict, noDictIssue, acceleration);
+    }
+}
+
 int LZ4_compress_destSize(const char* src, char* dst, int* srcSizePtr, int targetDstSize)
 {
 #if (LZ4_HEAPMODE)
@@ -1559,6 +2058,40 @@ LZ4_stream_t* LZ4_initStream (void* buffer, size_t size)
     return (LZ4_stream_t*)buffer;
 }
 
+static size_t LZ4_sizeofStreamInternal(U32 memoryUsage)
+{
+    return offsetof(LZ4_stream_t_internal, hashTable) + ((size_t)1 << memoryUsage);
+}
+
+int LZ4_sizeofStream_advanced(int memoryUsage)
+{
+    if ((memoryUsage < LZ4_MEMORY_USAGE_MIN) || (memoryUsage > LZ4_MEMORY_USAGE_MAX)) return 0;
+    return (int)LZ4_sizeofStreamInternal((U32)memoryUsage);
+}
+
+LZ4_stream_t* LZ4_initStream_advanced (void* buffer, size_t size, int memoryUsage)
+{
+    size_t const stateSize = (size_t)LZ4_sizeofStream_advanced(memoryUsage);
+    DEBUGLOG(5, "LZ4_initStream_advanced (memoryUsage=%i)", memoryUsage);
+    LZ4_STATIC_ASSERT(sizeof(LZ4_stream_t_internal) <= LZ4_STREAM_MINSIZE);
+    if (buffer == NULL) { return NULL; }
+    if (stateSize == 0) { return NULL; }   /* invalid memoryUsage */
+    if (size < stateSize) { return NULL; }
+    if (!LZ4_isAligned(buffer, LZ4_stream_t_alignment())) return NULL;
+    MEM_INIT(buffer, 0, stateSize);
+    ((LZ4_stream_t*)buffer)->internal_donotuse.memoryUsage = (U32)memoryUsage;
+    return (LZ4_stream_t*)buffer;
+}
+
+/* LZ4_reinitStream() :
+ * full reset of an initialized state, preserving its hash table size */
+static void LZ4_reinitStream(LZ4_stream_t_internal* cctx)
+{
+    U32 const memoryUsage = cctx->memoryUsage;
+    MEM_INIT(cctx, 0, LZ4_sizeofStreamInternal(LZ4_streamMemoryUsage(cctx)));
+    cctx->memoryUsage = memoryUsage;
+}
+
 /* resetStream is now deprecated,
  * prefer initStream() which is more general */
 void LZ4_resetStream (LZ4_stream_t* LZ4_stream)
@@ -1590,6 +2123,7 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
 {
     LZ4_stream_t_internal* const dict = &LZ4_dict->internal_donotuse;
     const tableType_t tableType = byU32;
+    U32 const hashLog = LZ4_tableHashLog(LZ4_streamMemoryUsage(dict), tableType);
     const BYTE* p = (const BYTE*)dictionary;
     const BYTE* const dictEnd = p + dictSize;
     U32 idx32;
@@ -1600,7 +2134,7 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
      * and not just continue it with prepareTable()
      * to avoid any risk of generating overflowing matchIndex
      * when compressing using this dictionary */
-    LZ4_resetStream(LZ4_dict);
+    LZ4_reinitStream(dict);
 
     /* We always increment the offset by 64 KB, since, if the dict is longer,
      * we truncate it to the last 64k, and if it's shorter, we still want to
@@ -1621,7 +2155,7 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
     idx32 = dict->currentOffset - dict->dictSize;
 
     while (p <= dictEnd-HASH_UNIT) {
-        U32 const h = LZ4_hashPosition(p, tableType);
+        U32 const h = LZ4_hashPosition(p, tableType, hashLog);
         /* Note: overwriting => favors positions end of dictionary */
         LZ4_putIndexOnHash(idx32, h, dict->hashTable, tableType);
         p+=3; idx32+=3;
@@ -1632,7 +2166,7 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
         p = dict->dictionary;
         idx32 = dict->currentOffset - dict->dictSize;
         while (p <= dictEnd-HASH_UNIT) {
-            U32 const h = LZ4_hashPosition(p, tableType);
+            U32 const h = LZ4_hashPosition(p, tableType, hashLog);
             U32 const limit = dict->currentOffset - 64 KB;
             if (LZ4_getIndexOnHash(h, dict->hashTable, tableType) <= limit) {
                 /* Note: not overwriting => favors positions beginning of dictionary */
@@ -1683,6 +2217,20 @@ void LZ4_attach_dictionary(LZ4_stream_t* workingStream, const LZ4_stream_t* dict
     workingStream->internal_donotuse.dictCtx = dictCtx;
 }
 
+LZ4_stream_t* LZ4_cloneStream(void* dstBuffer, size_t dstSize, const LZ4_stream_t* srcStream)
+{
+    size_t stateSize;
+    DEBUGLOG(5, "LZ4_cloneStream (%p => %p)", srcStream, dstBuffer);
+    if ((dstBuffer == NULL) || (srcStream == NULL)) return NULL;
+    if (!LZ4_isAligned(dstBuffer, LZ4_stream_t_alignment())) return NULL;
+    /* only the hash table actually used by srcStream is copied.
+     * History buffers and dictCtx are referenced, not copied. */
+    stateSize = LZ4_sizeofStreamInternal(LZ4_streamMemoryUsage(&srcStream->internal_donotuse));
+    if (dstSize < stateSize) return NULL;
+    if (dstBuffer != (const void*)srcStream) LZ4_memcpy(dstBuffer, srcStream, stateSize);
+    return (LZ4_stream_t*)dstBuffer;
+}
+
 
 static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
 {
@@ -1691,9 +2239,10 @@ static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
         /* rescale hash table */
         U32 const delta = LZ4_dict->currentOffset - 64 KB;
         const BYTE* dictEnd = LZ4_dict->dictionary + LZ4_dict->dictSize;
+        int const nbEntries = 1 << LZ4_tableHashLog(LZ4_streamMemoryUsage(LZ4_dict), byU32);
         int i;
         DEBUGLOG(4, "LZ4_renormDictT");
-        for (i=0; i<LZ4_HASH_SIZE_U32; i++) {
+        for (i=0; i<nbEntries; i++) {
             if (LZ4_dict->hashTable[i] < delta) LZ4_dict->hashTable[i]=0;
             else LZ4_dict->hashTable[i] -= delta;
         }
@@ -1704,6 +2253,7 @@ static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
 }
 
 
+LZ4_MULTIVERSION
 int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream,
                                 const char* source, char* dest,
                                 int inputSize, int maxOutputSize,
@@ -1759,12 +2309,15 @@ int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream,
              * dictCtx->currentOffset - dictCtx->dictSize. This makes it safe
              * to use noDictIssue even when the dict isn't a full 64 KB.
              */
-            if (inputSize > 4 KB) {
+            if ( (inputSize > 4 KB)
+              && (LZ4_streamMemoryUsage(streamPtr) == LZ4_streamMemoryUsage(streamPtr->dictCtx)) ) {
                 /* For compressing large blobs, it is faster to pay the setup
                  * cost to copy the dictionary's tables into the active context,
                  * so that the compression loop is only looking into one table.
                  */
-                LZ4_memcpy(streamPtr, streamPtr->dictCtx, sizeof(*streamPtr));
+                U32 const memoryUsage = streamPtr->memoryUsage;
+                LZ4_memcpy(streamPtr, streamPtr->dictCtx, LZ4_sizeofStreamInternal(LZ4_streamMemoryUsage(streamPtr)));
+                streamPtr->memoryUsage = memoryUsage;
                 result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingExtDict, noDictIssue, acceleration);
             } else {
                 result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingDictCtx, noDictIssue, acceleration);
@@ -1784,6 +2337,7 @@ int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream,
 
 
 /* Hidden debug function, to force-test external dictionary mode */
+LZ4_MULTIVERSION
 int LZ4_compress_forceExtDict (LZ4_stream_t* LZ4_dict, const char* source, char* dest, int srcSize)
 {
     LZ4_stream_t_internal* const streamPtr = &LZ4_dict->internal_donotuse;
@@ -2013,14 +2567,35 @@ read_variable_length(const BYTE** ip, const BYTE* ilimit,
     return length;
 }
 
-/*! LZ4_decompress_generic() :
+/* decoded tiles reporting, see LZ4_decompress_safe_usingDict_tiles() */
+typedef struct {
+    LZ4_decodeTile_f tileFn;
+    void* opaque;
+    size_t tileSize;
+} LZ4_decodeTiles_t;
+
+/* reports input consumed and output decoded since previous tile,
+ * @return : end of next tile */
+static BYTE* LZ4_reportTile(const LZ4_decodeTiles_t* tiles,
+                            const BYTE** tileIp, const BYTE* ip,
+                                  BYTE** tileOp, BYTE* op, BYTE* oend)
+{
+    tiles->tileFn(tiles->opaque, (const char*)*tileIp, (size_t)(ip - *tileIp),
+                                 (const char*)*tileOp, (size_t)(op - *tileOp));
+    *tileIp = ip;
+    *tileOp = op;
+    return ((size_t)(oend - op) > tiles->tileSize) ? op + tiles->tileSize : oend;
+}
+
+/*! LZ4_decompress_generic_tiles() :
  *  This generic decompression function covers all use cases.
  *  It shall be instantiated several times, using different sets of directives.
  *  Note that it is important for performance that this function really get inlined,
  *  in order to remove useless branches during compilation optimization.
+ *  @tiles, when not NULL, is invoked at sequence boundaries, every time tileSize more bytes are decoded.
  */
 LZ4_FORCE_INLINE int
-LZ4_decompress_generic(
+LZ4_decompress_generic_tiles(
                  const char* const src,
                  char* const dst,
                  int srcSize,
@@ -2030,7 +2605,8 @@ LZ4_decompress_generic(
                  dict_directive dict,                 /* noDict, withPrefix64k, usingExtDict */
                  const BYTE* const lowPrefix,  /* always <= dst, == dst when no prefix */
                  const BYTE* const dictStart,  /* only if dict==usingExtDict */
-                 const size_t dictSize         /* note : = 0 if noDict */
+                 const size_t dictSize,        /* note : = 0 if noDict */
+                 const LZ4_decodeTiles_t* const tiles  /* NULL for regular decoding */
                  )
 {
     if ((src == NULL) || (outputSize < 0)) { return -1; }
@@ -2042,6 +2618,10 @@ LZ4_decompress_generic(
         BYTE* const oend = op + outputSize;
         BYTE* cpy;
 
+        const BYTE* tileIp = ip;
+        BYTE* tileOp = op;
+        BYTE* tileEnd = ((tiles == NULL) || ((size_t)outputSize <= tiles->tileSize)) ? oend : op + tiles->tileSize;
+
         const BYTE* const dictEnd = (dictStart == NULL) ? NULL : dictStart + dictSize;
 
         const int checkOffset = (dictSize < (int)(64 KB));
@@ -2064,7 +2644,11 @@ LZ4_decompress_generic(
         if (unlikely(outputSize==0)) {
             /* Empty output buffer */
             if (partialDecoding) return 0;
-            return ((srcSize==1) && (*ip==0)) ? 0 : -1;
+            if ((srcSize==1) && (*ip==0)) {
+                if (tiles != NULL) (void)LZ4_reportTile(tiles, &tileIp, ip+1, &tileOp, op, oend);
+                return 0;
+            }
+            return -1;
         }
         if (unlikely(srcSize==0)) { return -1; }
 
@@ -2084,6 +2668,8 @@ LZ4_decompress_generic(
             /* Main fastloop assertion: We can always wildcopy FASTLOOP_SAFE_DISTANCE */
             assert(oend - op >= FASTLOOP_SAFE_DISTANCE);
             assert(ip < iend);
+            if ((tiles != NULL) && unlikely(op >= tileEnd))
+                tileEnd = LZ4_reportTile(tiles, &tileIp, ip, &tileOp, op, oend);
             token = *ip++;
             length = token >> ML_BITS;  /* literal length */
             DEBUGLOG(7, "blockPos%6u: litLength token = %u", (unsigned)(op-(BYTE*)dst), (unsigned)length);
@@ -2214,6 +2800,8 @@ LZ4_decompress_generic(
         DEBUGLOG(6, "using safe decode loop");
         while (1) {
             assert(ip < iend);
+            if ((tiles != NULL) && unlikely(op >= tileEnd))
+                tileEnd = LZ4_reportTile(tiles, &tileIp, ip, &tileOp, op, oend);
             token = *ip++;
             length = token >> ML_BITS;  /* literal length */
             DEBUGLOG(7, "blockPos%6u: litLength token = %u", (unsigned)(op-(BYTE*)dst), (unsigned)length);
@@ -2436,6 +3024,7 @@ LZ4_decompress_generic(
 
         /* end of decoding */
         DEBUGLOG(5, "decoded %i bytes", (int) (((char*)op)-dst));
+        if (tiles != NULL) (void)LZ4_reportTile(tiles, &tileIp, ip, &tileOp, op, oend);
         return (int) (((char*)op)-dst);     /* Nb of output bytes decoded */
 
         /* Overflow error detected */
@@ -2444,10 +3033,27 @@ LZ4_decompress_generic(
     }
 }
 
+LZ4_FORCE_INLINE int
+LZ4_decompress_generic(
+                 const char* const src,
+                 char* const dst,
+                 int srcSize,
+                 int outputSize,
+                 earlyEnd_directive partialDecoding,
+                 dict_directive dict,
+                 const BYTE* const lowPrefix,
+                 const BYTE* const dictStart,
+                 const size_t dictSize)
+{
+    return LZ4_decompress_generic_tiles(src, dst, srcSize, outputSize,
+                                        partialDecoding, dict, lowPrefix, dictStart, dictSize,
+                                        NULL);
+}
+
 
 /*===== Instantiate the API decoding functions. =====*/
 
-LZ4_FORCE_O2
+LZ4_FORCE_O2 LZ4_MULTIVERSION
 int LZ4_decompress_safe(const char* source, char* dest, int compressedSize, int maxDecompressedSize)
 {
     return LZ4_decompress_generic(source, dest, compressedSize, maxDecompressedSize,
@@ -2455,7 +3061,26 @@ int LZ4_decompress_safe(const char* source, char* dest, int compressedSize, int
                                   (BYTE*)dest, NULL, 0);
 }
 
-LZ4_FORCE_O2
+int LZ4_decompress_safe_batch(const char* const srcs[], const int srcSizes[],
+                                    char* const dsts[], const int dstCapacities[],
+                                    int nbBlocks, int results[])
+{
+    int n, nbDecoded = 0;
+    DEBUGLOG(5, "LZ4_decompress_safe_batch (%i blocks)", nbBlocks);
+    for (n = 0; n < nbBlocks; n++) {
+        /* blocks are typically scattered : start loading next one while decoding current one */
+        if (n+1 < nbBlocks) {
+            LZ4_PREFETCH_R(srcs[n+1]);
+            if (srcSizes[n+1] > 64) LZ4_PREFETCH_R(srcs[n+1] + 64);   /* stay within block */
+            LZ4_PREFETCH_W(dsts[n+1]);
+        }
+        results[n] = LZ4_decompress_safe(srcs[n], dsts[n], srcSizes[n], dstCapacities[n]);
+        nbDecoded += (results[n] >= 0);
+    }
+    return nbDecoded;
+}
+
+LZ4_FORCE_O2 LZ4_MULTIVERSION
 int LZ4_decompress_safe_partial(const char* src, char* dst, int compressedSize, int targetOutputSize, int dstCapacity)
 {
     dstCapacity = MIN(targetOutputSize, dstCapacity);
@@ -2464,6 +3089,140 @@ int LZ4_decompress_safe_partial(const char* src, char* dst, int compressedSize,
                                   noDict, (BYTE*)dst, NULL, 0);
 }
 
+void LZ4_initPartialDecode(LZ4_partialDecode_t* state)
+{
+    MEM_INIT(state, 0, sizeof(*state));
+    state->token = -1;
+}
+
+int LZ4_partialDecode_done(const LZ4_partialDecode_t* state)
+{
+    return state->finished;
+}
+
+/* LZ4_decompress_safe_partial_resume() :
+ * a dedicated decoding loop, which can stop and resume anywhere within a sequence.
+ * LZ4_decompress_generic() can't report where it stopped within the input,
+ * and its wild copies are not designed to resume from arbitrary positions.
+ * Most sequences still use 16-bytes stripes, only the last ones before target are copied exactly. */
+int LZ4_decompress_safe_partial_resume(LZ4_partialDecode_t* state,
+                                 const char* src, char* dst,
+                                       int srcSize, int targetOutputSize, int dstCapacity)
+{
+    const BYTE* ip;
+    const BYTE* const iend = (const BYTE*)src + srcSize;
+    BYTE* const lowPrefix = (BYTE*)dst;
+    BYTE* op;
+    BYTE* oend;
+    unsigned token;
+    size_t litLength, matchLength, offset;
+
+    if ((state == NULL) || (src == NULL) || (dst == NULL) || (srcSize < 0) || (dstCapacity < 0)) return -1;
+    if (state->finished) return state->dstPos;
+    if (state->srcPos > srcSize || state->dstPos > dstCapacity) return -1;
+    targetOutputSize = MIN(targetOutputSize, dstCapacity);
+    if (targetOutputSize <= state->dstPos) return state->dstPos;
+
+    ip = (const BYTE*)src + state->srcPos;
+    op = (BYTE*)dst + state->dstPos;
+    oend = (BYTE*)dst + targetOutputSize;
+    token = (unsigned)state->token;
+    litLength = (size_t)state->litLength;
+    matchLength = (size_t)state->matchLength;
+    offset = (size_t)state->offset;
+    DEBUGLOG(5, "LZ4_decompress_safe_partial_resume (srcPos=%i, dstPos=%i, target=%i)",
+                state->srcPos, state->dstPos, targetOutputSize);
+
+    /* resume within current sequence */
+    if (matchLength) goto _copy_match;
+    if (state->token >= 0) goto _copy_literals;
+
+    while (1) {
+        if (op == oend) {
+            if ((ip + 1 == iend) && (*ip == 0)) { ip++; state->finished = 1; }   /* empty last literals */
+            state->token = -1; goto _save;
+        }
+        if (ip >= iend) goto _output_error;
+        token = *ip++;
+        litLength = token >> ML_BITS;
+
+        /* shortcut : short literals and short match, far from both ends */
+        if ( (litLength != RUN_MASK) && ((token & ML_MASK) != ML_MASK)
+          && (ip + 16 + 2 <= iend) && (op + 16 + 18 <= oend) ) {
+            LZ4_memcpy(op, ip, 16);
+            op += litLength; ip += litLength;
+            offset = LZ4_readLE16(ip);
+            if ((offset >= 8) && (offset <= (size_t)(op - lowPrefix))) {
+                ip += 2;
+                LZ4_memcpy(op, op - offset, 8);
+                LZ4_memcpy(op + 8, op - offset + 8, 8);
+                LZ4_memcpy(op + 16, op - offset + 16, 2);
+                op += (token & ML_MASK) + MINMATCH;
+                continue;
+            }
+            /* literals are copied, proceed with match */
+            litLength = 0;
+            goto _read_offset;
+        }
+
+        if (litLength == RUN_MASK) {
+            size_t const addl = read_variable_length(&ip, iend-1, 1);
+            if (addl == rvl_error) goto _output_error;
+            litLength += addl;
+        }
+
+    _copy_literals:
+        {   size_t const toCopy = MIN(litLength, (size_t)(oend - op));
+            if ((size_t)(iend - ip) < litLength) goto _output_error;   /* literals beyond input */
+            LZ4_memmove(op, ip, toCopy);
+            ip += toCopy; op += toCopy; litLength -= toCopy;
+            if (litLength) { state->token = (int)token; goto _save; }   /* target reached within literals */
+        }
+        if (ip == iend) { state->finished = 1; state->token = -1; goto _save; }   /* last sequence : literals only */
+        if (op == oend) { state->token = (int)token; goto _save; }   /* match of this sequence not decoded yet */
+
+    _read_offset:
+        if (ip + 2 > iend) goto _output_error;
+        offset = LZ4_readLE16(ip); ip += 2;
+        matchLength = token & ML_MASK;
+        if (matchLength == ML_MASK) {
+            size_t const addl = read_variable_length(&ip, iend-1, 1);
+            if (addl == rvl_error) goto _output_error;
+            matchLength += addl;
+        }
+        matchLength += MINMATCH;
+        if ((offset == 0) || (offset > (size_t)(op - lowPrefix))) goto _output_error;   /* offset outside block */
+
+    _copy_match:
+        {   size_t toCopy = MIN(matchLength, (size_t)(oend - op));
+            const BYTE* match = op - offset;
+            matchLength -= toCopy;
+            if (toCopy <= offset) {
+                LZ4_memcpy(op, match, toCopy);
+                op += toCopy;
+            } else {
+                /* overlap : each copy doubles the distance to match */
+                while (toCopy) {
+                    size_t const chunk = MIN(toCopy, (size_t)(op - match));
+                    LZ4_memcpy(op, match, chunk);
+                    op += chunk; toCopy -= chunk;
+            }   }
+            if (matchLength) { state->token = (int)token; goto _save; }   /* target reached within match */
+        }
+    }
+
+_save:
+    state->srcPos = (int)(ip - (const BYTE*)src);
+    state->dstPos = (int)(op - lowPrefix);
+    state->litLength = (int)litLength;
+    state->matchLength = (int)matchLength;
+    state->offset = (int)offset;
+    return state->dstPos;
+
+_output_error:
+    return (int)(-(ip - (const BYTE*)src)) - 1;
+}
+
 LZ4_FORCE_O2
 int LZ4_decompress_fast(const char* source, char* dest, int originalSize)
 {
@@ -2475,7 +3234,7 @@ int LZ4_decompress_fast(const char* source, char* dest, int originalSize)
 
 /*===== Instantiate a few more decoding cases, used more than once. =====*/
 
-LZ4_FORCE_O2 /* Exported, an obsolete API function. */
+LZ4_FORCE_O2 LZ4_MULTIVERSION /* Exported, an obsolete API function. */
 int LZ4_decompress_safe_withPrefix64k(const char* source, char* dest, int compressedSize, int maxOutputSize)
 {
     return LZ4_decompress_generic(source, dest, compressedSize, maxOutputSize,
@@ -2483,7 +3242,7 @@ int LZ4_decompress_safe_withPrefix64k(const char* source, char* dest, int compre
                                   (BYTE*)dest - 64 KB, NULL, 0);
 }
 
-LZ4_FORCE_O2
+LZ4_FORCE_O2 LZ4_MULTIVERSION
 static int LZ4_decompress_safe_partial_withPrefix64k(const char* source, char* dest, int compressedSize, int targetOutputSize, int dstCapacity)
 {
     dstCapacity = MIN(targetOutputSize, dstCapacity);
@@ -2500,7 +3259,7 @@ int LZ4_decompress_fast_withPrefix64k(const char* source, char* dest, int origin
                 64 KB, NULL, 0);
 }
 
-LZ4_FORCE_O2
+LZ4_FORCE_O2 LZ4_MULTIVERSION
 static int LZ4_decompress_safe_withSmallPrefix(const char* source, char* dest, int compressedSize, int maxOutputSize,
                                                size_t prefixSize)
 {
@@ -2509,7 +3268,7 @@ static int LZ4_decompress_safe_withSmallPrefix(const char* source, char* dest, i
                                   (BYTE*)dest-prefixSize, NULL, 0);
 }
 
-LZ4_FORCE_O2
+LZ4_FORCE_O2 LZ4_MULTIVERSION
 static int LZ4_decompress_safe_partial_withSmallPrefix(const char* source, char* dest, int compressedSize, int targetOutputSize, int dstCapacity,
                                                size_t prefixSize)
 {
@@ -2519,7 +3278,7 @@ static int LZ4_decompress_safe_partial_withSmallPrefix(const char* source, char*
                                   (BYTE*)dest-prefixSize, NULL, 0);
 }
 
-LZ4_FORCE_O2
+LZ4_FORCE_O2 LZ4_MULTIVERSION
 int LZ4_decompress_safe_forceExtDict(const char* source, char* dest,
                                      int compressedSize, int maxOutputSize,
                                      const void* dictStart, size_t dictSize)
@@ -2530,7 +3289,7 @@ int LZ4_decompress_safe_forceExtDict(const char* source, char* dest,
                                   (BYTE*)dest, (const BYTE*)dictStart, dictSize);
 }
 
-LZ4_FORCE_O2
+LZ4_FORCE_O2 LZ4_MULTIVERSION
 int LZ4_decompress_safe_partial_forceExtDict(const char* source, char* dest,
                                      int compressedSize, int targetOutputSize, int dstCapacity,
                                      const void* dictStart, size_t dictSize)
@@ -2550,6 +3309,141 @@ static int LZ4_decompress_fast_extDict(const char* source, char* dest, int origi
                 0, (const BYTE*)dictStart, dictSize);
 }
 
+/* LZ4_decompress_extDictHead() :
+ * Decodes the beginning of a block which references an external dictionary,
+ * one full sequence at a time, and stops at the first sequence boundary
+ * beyond 64 KB of output : past this point, no offset can reach the dictionary.
+ * *ipPtr is updated to the first unread input byte.
+ * @return : nb of bytes decoded, or a negative value (same convention as LZ4_decompress_generic())
+ */
+LZ4_FORCE_O2
+static int LZ4_decompress_extDictHead(const BYTE* const src, const BYTE** ipPtr, const BYTE* const iend,
+                                      BYTE* const dst, BYTE* const oend,
+                                      const BYTE* const dictStart, size_t dictSize)
+{
+    const BYTE* ip = *ipPtr;
+    BYTE* op = dst;
+    BYTE* const headEnd = dst + 64 KB;
+    const BYTE* const dictEnd = dictStart + dictSize;
+    const BYTE* const shortiend = iend - 14 /*maxLL*/ - 2 /*offset*/;
+    const BYTE* const shortoend = oend - 14 /*maxLL*/ - 18 /*maxML*/;
+
+    while (op < headEnd) {
+        unsigned token;
+        size_t length;
+        size_t offset;
+        const BYTE* match;
+        BYTE* cpy;
+
+        if (ip >= iend) goto _output_error;
+        token = *ip++;
+        length = token >> ML_BITS;
+
+        /* shortcut for the most common case : short literals, then short match within block */
+        if ( (length != RUN_MASK)
+          && likely((ip < shortiend) & (op <= shortoend)) ) {
+            LZ4_memcpy(op, ip, 16);
+            op += length; ip += length;
+            length = token & ML_MASK;
+            offset = LZ4_readLE16(ip); ip += 2;
+            if ( (length != ML_MASK)
+              && (offset >= 8)
+              && (offset <= (size_t)(op-dst)) ) {
+                match = op - offset;
+                LZ4_memcpy(op + 0, match + 0, 8);
+                LZ4_memcpy(op + 8, match + 8, 8);
+                LZ4_memcpy(op +16, match +16, 2);
+                op += length + MINMATCH;
+                continue;
+            }
+            goto _copy_match;
+        }
+
+        /* literals */
+        if (length == RUN_MASK) {
+            size_t const addl = read_variable_length(&ip, iend-RUN_MASK, 1);
+            if (addl == rvl_error) goto _output_error;
+            length += addl;
+        }
+        if ((length > (size_t)(oend-op)) || (length > (size_t)(iend-ip))) goto _output_error;
+        cpy = op + length;
+        if ((cpy > oend-MFLIMIT) || (ip+length > iend-(2+1+LASTLITERALS))) {
+            /* necessarily the last sequence */
+            if (ip+length != iend) goto _output_error;
+            LZ4_memmove(op, ip, length);
+            ip += length;
+            op = cpy;
+            break;
+        }
+        LZ4_wildCopy8(op, ip, cpy);
+        ip += length; op = cpy;
+
+        /* match */
+        offset = LZ4_readLE16(ip); ip+=2;
+        length = token & ML_MASK;
+    _copy_match:
+        if (length == ML_MASK) {
+            size_t const addl = read_variable_length(&ip, iend - LASTLITERALS + 1, 0);
+            if (addl == rvl_error) goto _output_error;
+            length += addl;
+        }
+        length += MINMATCH;
+        if (length > (size_t)(oend-LASTLITERALS-op)) goto _output_error;   /* last LASTLITERALS bytes must be literals */
+        cpy = op + length;
+
+        if (offset > (size_t)(op-dst)) {
+            /* match starting within external dictionary */
+            size_t const copySize = offset - (size_t)(op-dst);
+            if (copySize > dictSize) goto _output_error;   /* offset outside buffers */
+            if (length <= copySize) {
+                LZ4_memmove(op, dictEnd - copySize, length);
+                op = cpy;
+                continue;
+            }
+            LZ4_memcpy(op, dictEnd - copySize, copySize);
+            op += copySize;
+            match = dst;
+            if ((size_t)(cpy-op) > (size_t)(op-dst)) {   /* overlap copy */
+                while (op < cpy) { *op++ = *match++; }
+            } else {
+                LZ4_memcpy(op, match, (size_t)(cpy-op));
+                op = cpy;
+            }
+            continue;
+        }
+
+        /* copy match within block */
+        match = op - offset;
+        if (cpy > oend-MATCH_SAFEGUARD_DISTANCE) {
+            while (op < cpy) { *op++ = *match++; }
+            continue;
+        }
+        if (unlikely(offset<8)) {
+            LZ4_write32(op, 0);   /* silence msan warning when offset==0 */
+            op[0] = match[0];
+            op[1] = match[1];
+            op[2] = match[2];
+            op[3] = match[3];
+            match += inc32table[offset];
+            LZ4_memcpy(op+4, match, 4);
+            match -= dec64table[offset];
+        } else {
+            LZ4_memcpy(op, match, 8);
+            match += 8;
+        }
+        op += 8;
+        LZ4_memcpy(op, match, 8);
+        if (length > 16) { LZ4_wildCopy8(op+8, match+8, cpy); }
+        op = cpy;   /* wildcopy correction */
+    }
+
+    *ipPtr = ip;
+    return (int)(op-dst);
+
+_output_error:
+    return (int)(-(ip-src))-1;
+}
+
 /* The "double dictionary" mode, for use with e.g. ring buffers: the first part
  * of the dictionary is passed as prefix, and the second via dictStart + dictSize.
  * These routines are used only once, in LZ4_decompress_*_continue().
@@ -2731,6 +3625,30 @@ int LZ4_decompress_safe_usingDict(const char* source, char* dest, int compressed
     return LZ4_decompress_safe_forceExtDict(source, dest, compressedSize, maxOutputSize, dictStart, (size_t)dictSize);
 }
 
+int LZ4_decompress_safe_usingDict_fast(const char* source, char* dest, int compressedSize, int maxOutputSize, const char* dictStart, int dictSize)
+{
+    if ( (dictSize==0) || (dictStart+dictSize == dest)
+      || (maxOutputSize <= 64 KB) || (source == NULL) || (compressedSize <= 0) )
+        return LZ4_decompress_safe_usingDict(source, dest, compressedSize, maxOutputSize, dictStart, dictSize);
+    assert(dictSize > 0);
+    {   const BYTE* const istart = (const BYTE*)source;
+        const BYTE* ip = istart;
+        int const headSize = LZ4_decompress_extDictHead(istart, &ip, istart + compressedSize,
+                                    (BYTE*)dest, (BYTE*)dest + maxOutputSize,
+                                    (const BYTE*)dictStart, (size_t)dictSize);
+        int const consumed = (int)(ip - istart);
+        int tailSize;
+        if (headSize < 0) return headSize;
+        if (consumed == compressedSize) return headSize;
+        assert(headSize >= 64 KB);
+        /* rest of the block : references stay within the block, decode as prefix */
+        tailSize = LZ4_decompress_safe_withPrefix64k((const char*)ip, dest + headSize,
+                                    compressedSize - consumed, maxOutputSize - headSize);
+        if (tailSize < 0) return tailSize - consumed;
+        return headSize + tailSize;
+    }
+}
+
 int LZ4_decompress_safe_partial_usingDict(const char* source, char* dest, int compressedSize, int targetOutputSize, int dstCapacity, const char* dictStart, int dictSize)
 {
     if (dictSize==0)
@@ -2746,6 +3664,79 @@ int LZ4_decompress_safe_partial_usingDict(const char* source, char* dest, int co
     return LZ4_decompress_safe_partial_forceExtDict(source, dest, compressedSize, targetOutputSize, dstCapacity, dictStart, (size_t)dictSize);
 }
 
+/* history is @prefixSize bytes right before @dest, then @dictSize bytes at @dictStart (older) */
+LZ4_FORCE_O2 LZ4_MULTIVERSION
+static int LZ4_decompress_safe_tiles(const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                     size_t prefixSize, const void* dictStart, size_t dictSize,
+                                     const LZ4_decodeTiles_t* tiles)
+{
+    if (prefixSize >= 64 KB - 1)
+        return LZ4_decompress_generic_tiles(source, dest, compressedSize, maxOutputSize,
+                                            decode_full_block, withPrefix64k,
+                                            (BYTE*)dest - 64 KB, NULL, 0, tiles);
+    if (dictSize == 0)
+        return LZ4_decompress_generic_tiles(source, dest, compressedSize, maxOutputSize,
+                                            decode_full_block, noDict,
+                                            (BYTE*)dest - prefixSize, NULL, 0, tiles);
+    return LZ4_decompress_generic_tiles(source, dest, compressedSize, maxOutputSize,
+                                        decode_full_block, usingExtDict,
+                                        (BYTE*)dest - prefixSize, (const BYTE*)dictStart, dictSize, tiles);
+}
+
+int LZ4_decompress_safe_usingDict_tiles(const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                        const char* dictStart, int dictSize,
+                                        size_t tileSize, LZ4_decodeTile_f tileFn, void* opaque)
+{
+    LZ4_decodeTiles_t tiles;
+    if (tileFn == NULL) return LZ4_decompress_safe_usingDict(source, dest, compressedSize, maxOutputSize, dictStart, dictSize);
+    if (dictSize < 0) return -1;
+    tiles.tileFn = tileFn;
+    tiles.opaque = opaque;
+    tiles.tileSize = tileSize;
+    if ((dictSize > 0) && (dictStart + dictSize == dest))
+        return LZ4_decompress_safe_tiles(source, dest, compressedSize, maxOutputSize, (size_t)dictSize, NULL, 0, &tiles);
+    return LZ4_decompress_safe_tiles(source, dest, compressedSize, maxOutputSize, 0, dictStart, (size_t)dictSize, &tiles);
+}
+
+/* same state transitions as LZ4_decompress_safe_continue() */
+int LZ4_decompress_safe_continue_tiles(LZ4_streamDecode_t* LZ4_streamDecode,
+                                 const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                       size_t tileSize, LZ4_decodeTile_f tileFn, void* opaque)
+{
+    LZ4_streamDecode_t_internal* const lz4sd = &LZ4_streamDecode->internal_donotuse;
+    LZ4_decodeTiles_t tiles;
+    int result;
+
+    if (tileFn == NULL) return LZ4_decompress_safe_continue(LZ4_streamDecode, source, dest, compressedSize, maxOutputSize);
+    tiles.tileFn = tileFn;
+    tiles.opaque = opaque;
+    tiles.tileSize = tileSize;
+
+    if (lz4sd->prefixSize == 0) {
+        assert(lz4sd->extDictSize == 0);
+        result = LZ4_decompress_safe_tiles(source, dest, compressedSize, maxOutputSize, 0, NULL, 0, &tiles);
+        if (result <= 0) return result;
+        lz4sd->prefixSize = (size_t)result;
+        lz4sd->prefixEnd = (BYTE*)dest + result;
+    } else if (lz4sd->prefixEnd == (BYTE*)dest) {
+        result = LZ4_decompress_safe_tiles(source, dest, compressedSize, maxOutputSize,
+                                           lz4sd->prefixSize, lz4sd->externalDict, lz4sd->extDictSize, &tiles);
+        if (result <= 0) return result;
+        lz4sd->prefixSize += (size_t)result;
+        lz4sd->prefixEnd  += result;
+    } else {
+        lz4sd->extDictSize = lz4sd->prefixSize;
+        lz4sd->externalDict = lz4sd->prefixEnd - lz4sd->extDictSize;
+        result = LZ4_decompress_safe_tiles(source, dest, compressedSize, maxOutputSize,
+                                           0, lz4sd->externalDict, lz4sd->extDictSize, &tiles);
+        if (result <= 0) return result;
+        lz4sd->prefixSize = (size_t)result;
+        lz4sd->prefixEnd  = (BYTE*)dest + result;
+    }
+
+    return result;
+}
+
 int LZ4_decompress_fast_usingDict(const char* source, char* dest, int originalSize, const char* dictStart, int dictSize)
 {
     if (dictSize==0 || dictStart+dictSize == dest)
@@ -574,12 +574,159 @@ LZ4_decompress_safe_partial_usingDict(const char* src, char* dst,
  */
 LZ4LIB_STATIC_API int LZ4_compress_fast_extState_fastReset (void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration);
 
+/*! LZ4_compress_lazy() :
+ *  Same as LZ4_compress_default(), with a slower but stronger strategy :
+ *  before emitting a match, the next position is also probed, and its match is preferred when it's longer.
+ *  Speed and compression ratio sit between LZ4_compress_default() and LZ4_compress_HC() at level 2 (LZ4MID).
+ *  Output is a regular LZ4 block, decodable with LZ4_decompress_safe().
+ *  LZ4_compress_lazy_extState() uses an externally allocated LZ4_stream_t @state,
+ *  which is fully initialized on each call, like LZ4_compress_fast_extState().
+ * @return : the number of bytes written into @dst, or 0 if compression fails.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_lazy(const char* src, char* dst, int srcSize, int dstCapacity);
+LZ4LIB_STATIC_API int LZ4_compress_lazy_extState(void* state, const char* src, char* dst, int srcSize, int dstCapacity);
+
+/*! LZ4_estimateCompressedSize() :
+ *  Runs the match finder of LZ4_compress_fast() over @src, without writing any output.
+ *  Useful to decide whether, and how, to compress some data, without a scratch output buffer.
+ *  It's a bit faster than compressing, since sequences and literals are neither written nor copied,
+ *  but cost remains dominated by match search.
+ * @return : the exact size LZ4_compress_fast(src, dst, srcSize, LZ4_compressBound(srcSize), acceleration) would produce,
+ *           or 0 if @srcSize is invalid (< 0 or > LZ4_MAX_INPUT_SIZE).
+ *
+ *  LZ4_estimateCompressedSize_sampled() :
+ *  Cheaper variant for large inputs : @src is cut into chunks of LZ4_ESTIMATE_CHUNK_SIZE bytes,
+ *  and only one chunk out of (1 << @sampleLog) is estimated, after its preceding 64 KB of history.
+ *  The total is extrapolated from sampled chunks.
+ *  Each sampled chunk costs about twice its size, so sampleLog 3 is ~4x faster than a full estimation.
+ *  When @errorBoundPtr is not NULL, it receives a sampling error bound, in bytes,
+ *  equal to 2 standard deviations of the extrapolated total (~95% confidence).
+ *  When @sampleLog==0, or input is too small to sample at least 2 chunks,
+ *  result is exactly LZ4_estimateCompressedSize(), and *errorBoundPtr is 0.
+ */
+#define LZ4_ESTIMATE_CHUNK_SIZE (64 * 1024)
+LZ4LIB_STATIC_API int LZ4_estimateCompressedSize(const char* src, int srcSize, int acceleration);
+LZ4LIB_STATIC_API int LZ4_estimateCompressedSize_sampled(const char* src, int srcSize, int acceleration,
+                                                         int sampleLog, int* errorBoundPtr);
+
+/*! LZ4_compress_fast_batch() :
+ *  Compresses @nbInputs independent inputs, one after another, using the same @state.
+ *  Input n is read from srcs[n] (srcSizes[n] bytes) and compressed into dsts[n] (dstCapacities[n] bytes).
+ *  Each input produces an independent block, decodable with LZ4_decompress_safe().
+ *  Result is the same as invoking LZ4_compress_fast_extState_fastReset() on each input,
+ *  but state validation and parameter clamping are only done once.
+ *  @state must be correctly initialized (see LZ4_resetStream_fast()), for example by LZ4_initStream() or LZ4_initStream_advanced().
+ *  This is meant to compress many small messages, for which a full state initialization would cost more than compression itself.
+ *  cSizes[n] receives the compressed size of input n, or 0 if it failed (typically, dstCapacities[n] too small).
+ * @return : nb of inputs successfully compressed (== @nbInputs when all succeeded),
+ *           or 0 if @state is not correctly aligned.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_fast_batch(void* state,
+                                        const char* const srcs[], const int srcSizes[],
+                                              char* const dsts[], const int dstCapacities[],
+                                              int cSizes[], int nbInputs, int acceleration);
+
+/*! LZ4_decompress_safe_batch() :
+ *  Decompresses @nbBlocks independent blocks, one after another.
+ *  Block n is read from srcs[n] (srcSizes[n] bytes) and decoded into dsts[n] (dstCapacities[n] bytes).
+ *  results[n] receives the same value LZ4_decompress_safe() would return for this block :
+ *  the decompressed size, or a negative value if the block is malformed or doesn't fit.
+ *  While a block is decoded, the start of the next block and its destination are prefetched,
+ *  which hides part of the memory latency when many small blocks are scattered in memory.
+ * @return : nb of blocks successfully decoded (== @nbBlocks when all succeeded).
+ */
+LZ4LIB_STATIC_API int LZ4_decompress_safe_batch(const char* const srcs[], const int srcSizes[],
+                                                      char* const dsts[], const int dstCapacities[],
+                                                      int nbBlocks, int results[]);
+
+/*! LZ4_decompress_safe_usingDict_fast() :
+ *  Same as LZ4_decompress_safe_usingDict(), and same result,
+ *  but faster for blocks larger than 64 KB using a dictionary which doesn't sit right before @dst :
+ *  only the first 64 KB of output can reference the dictionary,
+ *  so the rest of the block is decoded at prefix-mode speed.
+ */
+LZ4LIB_STATIC_API int LZ4_decompress_safe_usingDict_fast(const char* src, char* dst,
+                                                        int srcSize, int dstCapacity,
+                                                        const char* dictStart, int dictSize);
+
+/*! LZ4_decompress_safe_usingDict_tiles() :
+ *  Same as LZ4_decompress_safe_usingDict(), with the same result,
+ *  but @tileFn is invoked while decoding, each time about @tileSize more bytes are decoded,
+ *  with the input consumed and the output decoded since previous invocation.
+ *  Reported output is final, and still in cache :
+ *  checksumming or scanning it there avoids reading the whole block again once decoded.
+ *  Tiles are reported in order, and end at sequence boundaries, so they can be larger than @tileSize.
+ *  When decoding succeeds, a last invocation reports the rest of the block :
+ *  tiles then cover exactly @src and the decoded output.
+ *  After an error, nothing more is reported, and tiles already reported must be ignored.
+ *  @src must not overlap @dst.
+ */
+typedef void (*LZ4_decodeTile_f)(void* opaque, const char* src, size_t srcSize, const char* dst, size_t dstSize);
+LZ4LIB_STATIC_API int LZ4_decompress_safe_usingDict_tiles(const char* src, char* dst,
+                                                          int srcSize, int dstCapacity,
+                                                          const char* dictStart, int dictSize,
+                                                          size_t tileSize, LZ4_decodeTile_f tileFn, void* opaque);
+
+/*! LZ4_decompress_safe_continue_tiles() :
+ *  Same as LZ4_decompress_safe_continue(), reporting tiles like LZ4_decompress_safe_usingDict_tiles().
+ */
+LZ4LIB_STATIC_API int LZ4_decompress_safe_continue_tiles(LZ4_streamDecode_t* LZ4_streamDecode,
+                                                   const char* src, char* dst,
+                                                         int srcSize, int dstCapacity,
+                                                         size_t tileSize, LZ4_decodeTile_f tileFn, void* opaque);
+
+/*! LZ4_decompress_safe_partial_resume() :
+ *  Same as LZ4_decompress_safe_partial(), but decoding can be resumed later on, up to a larger target,
+ *  without decoding the beginning of the block again.
+ *  Decoding progress is recorded into @state, which must be initialized with LZ4_initPartialDecode()
+ *  before first invocation on a block.
+ *  Each invocation must provide the same @src, @srcSize and @dst, with @dst content preserved between invocations :
+ *  previously decoded data is used as reference by following matches.
+ *  Decoding stops exactly at @targetOutputSize (or @dstCapacity if smaller), even within a sequence.
+ *  Dictionaries are not supported.
+ * @return : total nb of bytes decoded in @dst since beginning of the block,
+ *           or a negative value if the block is malformed.
+ *  A result < @targetOutputSize implies the block is fully decoded,
+ *  but a block which ends exactly at @targetOutputSize returns @targetOutputSize too :
+ *  use LZ4_partialDecode_done() to tell a completed block from a stop at target.
+ *  Example : decode first 1 KB, then later first 16 KB :
+ *      LZ4_initPartialDecode(&state);
+ *      LZ4_decompress_safe_partial_resume(&state, src, dst, srcSize, 1 KB, dstCapacity);
+ *      ...
+ *      LZ4_decompress_safe_partial_resume(&state, src, dst, srcSize, 16 KB, dstCapacity);
+ */
+typedef struct {
+    int srcPos;        /* nb of input bytes consumed */
+    int dstPos;        /* nb of output bytes decoded */
+    int token;         /* current sequence token, or -1 between sequences */
+    int litLength;     /* literals of current sequence not copied yet */
+    int matchLength;   /* match bytes of current sequence not copied yet */
+    int offset;        /* match offset of current sequence */
+    int finished;      /* block entirely decoded */
+} LZ4_partialDecode_t;   /* fields are private */
+
+LZ4LIB_STATIC_API void LZ4_initPartialDecode(LZ4_partialDecode_t* state);
+LZ4LIB_STATIC_API int LZ4_decompress_safe_partial_resume(LZ4_partialDecode_t* state,
+                                                   const char* src, char* dst,
+                                                         int srcSize, int targetOutputSize, int dstCapacity);
+/*! LZ4_partialDecode_done() :
+ * @return : 1 once the whole block has been decoded into @dst (all input consumed), 0 otherwise.
+ *  Further invocations of LZ4_decompress_safe_partial_resume() on a done @state just return the block's decoded size. */
+LZ4LIB_STATIC_API int LZ4_partialDecode_done(const LZ4_partialDecode_t* state);
+
 /*! LZ4_compress_destSize_extState() :
  *  Same as LZ4_compress_destSize(), but using an externally allocated state.
  *  Also: exposes @acceleration
  */
 int LZ4_compress_destSize_extState(void* state, const char* src, char* dst, int* srcSizePtr, int targetDstSize, int acceleration);
 
+/*! LZ4_compress_destSize_extState_fastReset() :
+ *  Same as LZ4_compress_destSize_extState(), but @state is only reset like LZ4_compress_fast_extState_fastReset() does,
+ *  hence must already be correctly initialized, for example by LZ4_initStream() or LZ4_initStream_advanced().
+ *  Useful to compress many small inputs with the same state, the hash table size selected by LZ4_initStream_advanced() being preserved.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_destSize_extState_fastReset(void* state, const char* src, char* dst, int* srcSizePtr, int targetDstSize, int acceleration);
+
 /*! LZ4_attach_dictionary() :
  *  This is an experimental API that allows
  *  efficient use of a static dictionary many times.
@@ -610,6 +757,40 @@ LZ4LIB_STATIC_API void
 LZ4_attach_dictionary(LZ4_stream_t* workingStream,
                 const LZ4_stream_t* dictionaryStream);
 
+/*! LZ4_sizeofStream_advanced() :
+ * @return : size of a state using a hash table of (1 << @memoryUsage) bytes,
+ *           or 0 if @memoryUsage is not within [LZ4_MEMORY_USAGE_MIN, LZ4_MEMORY_USAGE_MAX].
+ */
+LZ4LIB_STATIC_API int LZ4_sizeofStream_advanced(int memoryUsage);
+
+/*! LZ4_initStream_advanced() :
+ *  Same as LZ4_initStream(), but selects the hash table size of this state at runtime,
+ *  instead of LZ4_MEMORY_USAGE which applies to the whole library.
+ *  Small tables reset faster and stay in L1 cache, large tables improve compression ratio.
+ *  @size must be >= LZ4_sizeofStream_advanced(@memoryUsage), which can be larger than sizeof(LZ4_stream_t).
+ * @return : the initialized state, or NULL on failure (invalid @memoryUsage, insufficient @size, bad alignment).
+ *
+ *  The returned state works with all streaming functions,
+ *  such as LZ4_resetStream_fast(), LZ4_loadDict(), LZ4_attach_dictionary() and LZ4_compress_fast_continue(),
+ *  and with LZ4_compress_fast_extState_fastReset() or LZ4_compress_destSize_extState_fastReset() for one-shot compression.
+ *  All of them preserve the selected size.
+ *  Since its size may differ from LZ4_stream_t, it must never be copied by value,
+ *  nor be passed to functions which fully re-initialize a standard state :
+ *  LZ4_initStream(), LZ4_resetStream(), LZ4_compress_fast_extState() and LZ4_compress_destSize_extState().
+ */
+LZ4LIB_STATIC_API LZ4_stream_t* LZ4_initStream_advanced(void* buffer, size_t size, int memoryUsage);
+
+/*! LZ4_cloneStream() :
+ *  Forks @srcStream in its current state into @dstBuffer, for example to compress next data
+ *  with different parameters, then keep the best result, and continue from the selected state.
+ *  Only the part of the hash table actually used by @srcStream is copied (see LZ4_initStream_advanced()).
+ *  Referenced data is shared, not copied : previous input and attached dictionary stream
+ *  must remain accessible and unmodified while either stream uses them.
+ *  @dstSize must be >= the size of @srcStream, and @dstBuffer must be aligned like LZ4_stream_t.
+ * @return : the cloned stream, or NULL on failure (insufficient @dstSize, bad alignment).
+ */
+LZ4LIB_STATIC_API LZ4_stream_t* LZ4_cloneStream(void* dstBuffer, size_t dstSize, const LZ4_stream_t* srcStream);
+
 
 /*! In-place compression and decompression
  *
@@ -672,6 +853,33 @@ LZ4_attach_dictionary(LZ4_stream_t* workingStream,
 #define LZ4_COMPRESS_INPLACE_MARGIN                           (LZ4_DISTANCE_MAX + 32)   /* LZ4_DISTANCE_MAX can be safely replaced by srcSize when it's smaller */
 #define LZ4_COMPRESS_INPLACE_BUFFER_SIZE(maxCompressedSize)   ((maxCompressedSize) + LZ4_COMPRESS_INPLACE_MARGIN)  /**< maxCompressedSize is generally LZ4_COMPRESSBOUND(inputSize), but can be set to any lower value, with the risk that compression can fail (return code 0(zero)) */
 
+/*-************************************************************
+ *  Runtime CPU dispatch
+ *************************************************************/
+/* LZ4_CPU_DISPATCH : build macro
+ * When set to 1, hot compression and decompression functions are compiled
+ * several times, once per instruction set listed in LZ4_CPU_DISPATCH_TARGETS,
+ * and the loader selects the best variant for the host cpu (gnu ifunc).
+ * A single generic binary can then make use of wider instructions where available.
+ * Requires gcc >= 6 or clang >= 14, on x86-64 with glibc.
+ * Default : 0 (disabled)
+ * LZ4_MULTIVERSION is the resulting function attribute, used by lz4 library and programs sources.
+ * It's not part of the API. */
+#ifndef LZ4_CPU_DISPATCH
+#  define LZ4_CPU_DISPATCH 0
+#endif
+#ifndef LZ4_CPU_DISPATCH_TARGETS
+#  define LZ4_CPU_DISPATCH_TARGETS "avx2", "default"
+#endif
+
+#if LZ4_CPU_DISPATCH && defined(__x86_64__) && defined(__GLIBC__) \
+    && ( (defined(__clang__) && (__clang_major__ >= 14)) \
+      || (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ >= 6)) )
+#  define LZ4_MULTIVERSION __attribute__((target_clones(LZ4_CPU_DISPATCH_TARGETS)))
+#else
+#  define LZ4_MULTIVERSION
+#endif
+
 #endif   /* LZ4_STATIC_3504398509 */
 #endif   /* LZ4_STATIC_LINKING_ONLY */
 
@@ -712,12 +920,13 @@ LZ4_attach_dictionary(LZ4_stream_t* workingStream,
 
 typedef struct LZ4_stream_t_internal LZ4_stream_t_internal;
 struct LZ4_stream_t_internal {
-    LZ4_u32 hashTable[LZ4_HASH_SIZE_U32];
     const LZ4_byte* dictionary;
     const LZ4_stream_t_internal* dictCtx;
     LZ4_u32 currentOffset;
     LZ4_u32 tableType;
     LZ4_u32 dictSize;
+    LZ4_u32 memoryUsage;   /* hashTable size (log2, in bytes) when selected at runtime; 0 means LZ4_MEMORY_USAGE */
+    LZ4_u32 hashTable[LZ4_HASH_SIZE_U32];   /* must remain last : effective size depends on memoryUsage */
     /* Implicit padding to ensure structure is aligned */
 };
 
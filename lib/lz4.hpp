@@ -0,0 +1,170 @@
+/*
+ *  LZ4 - Fast LZ compression algorithm
+ *  C++ Header File : compile-time specialized entry points
+ *  Copyright (C) 2011-2023, Yann Collet.
+
+   BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are
+   met:
+
+       * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   You can contact the author at :
+    - LZ4 homepage : http://www.lz4.org
+    - LZ4 source repository : https://github.com/lz4/lz4
+*/
+#ifndef LZ4_HPP_2983827168210
+#define LZ4_HPP_2983827168210
+
+/*
+ * lz4.hpp exposes the internal generic functions of lz4.c,
+ * LZ4_compress_generic() and LZ4_decompress_generic(),
+ * with their directives as template parameters.
+ * The caller selects the exact variant it needs, which is then fully inlined into its own code,
+ * without runtime dispatch on table type, dictionary mode or input size.
+ *
+ * Since generic functions are static, lz4.hpp requires lz4.c source
+ * within the same translation unit (amalgamation) :
+ *     #include "lz4.c"
+ *     #include "lz4.hpp"
+ * This translation unit then provides all lz4.c symbols :
+ * don't link it with another copy of lz4.o within the same binary.
+ *
+ * These entry points skip the validations and state preparations of regular API functions.
+ * Preconditions are listed for each one; they are only checked by assert() in debug mode.
+ * Breaking them results in corrupted output, or undefined behavior.
+ * As with other static linking only API, it may change in future versions.
+ */
+
+#if !defined(__cplusplus) || (__cplusplus < 201103L)
+#  error "lz4.hpp requires C++11 or later"
+#endif
+
+#if !defined(LZ4_SRC_INCLUDED) || defined(LZ4_COMMONDEFS_ONLY)
+#  error "lz4.hpp requires lz4.c to be included first, within the same translation unit"
+#endif
+
+namespace lz4 {
+
+/* table types */
+using ::byPtr;             /* 32-bit only : table stores pointers */
+using ::byU32;             /* table stores 32-bit indexes; any input size */
+using ::byU16;             /* table stores 16-bit indexes, with more entries; srcSize < LZ4_64Klimit only */
+
+/* dictionary modes */
+using ::noDict;
+using ::withPrefix64k;     /* history immediately precedes src (prefix) */
+using ::usingExtDict;      /* history in a separate buffer */
+using ::usingDictCtx;      /* compression only : history in an attached LZ4_stream_t (LZ4_attach_dictionary()) */
+
+/* output modes */
+using ::notLimited;        /* compression only : dstCapacity >= LZ4_compressBound(srcSize) */
+using ::limitedOutput;
+
+/* decoding modes */
+using ::decode_full_block;
+using ::partial_decode;    /* stops once dstCapacity bytes are decoded */
+
+
+/*! compress<TableType, Dict, Output>() :
+ *  Compresses @src into @dst, using @state, with the same result as regular API functions.
+ *  Like LZ4_compress_fast_extState_fastReset(), @state must have been initialized once (LZ4_initStream()).
+ *  - Dict == noDict : compresses @src as an independent block. The table is reset only when needed.
+ *  - other modes : continue the stream, like LZ4_compress_fast_continue(),
+ *    after history was set by LZ4_loadDict(), LZ4_attach_dictionary() or previous blocks.
+ *    Dict must match current history : withPrefix64k when it ends exactly at @src,
+ *    usingDictCtx when a dictionary is attached and no block was compressed since,
+ *    usingExtDict otherwise. History must not overlap @src, and must be >= 4 bytes.
+ *    Only byU32 tables support dictionaries.
+ * @return : compressed size, or 0 if compression failed (@dst too small, or @srcSize out of range for TableType).
+ */
+template <tableType_t TableType, dict_directive Dict = noDict, limitedOutput_directive Output = limitedOutput>
+inline int compress(LZ4_stream_t* state, const char* src, char* dst, int srcSize, int dstCapacity,
+                    int acceleration = LZ4_ACCELERATION_DEFAULT)
+{
+    static_assert(TableType == byPtr || TableType == byU32 || TableType == byU16, "invalid table type");
+    static_assert(TableType != byPtr || sizeof(void*) == 4, "byPtr is only valid on 32-bit targets");
+    static_assert(Dict == noDict || TableType == byU32, "dictionary modes require byU32 tables");
+    static_assert(Output == notLimited || Output == limitedOutput, "fill mode : use LZ4_compress_destSize()");
+    LZ4_stream_t_internal* const ctx = &state->internal_donotuse;
+
+    if (TableType == byU16 && srcSize >= LZ4_64Klimit) return 0;
+    assert(Output == limitedOutput || dstCapacity >= LZ4_compressBound(srcSize));
+    assert(TableType != byPtr || (uptrval)src > LZ4_DISTANCE_MAX);
+    if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
+    if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
+
+    if (Dict == noDict) {
+        LZ4_prepareTable(ctx, srcSize, TableType);
+        /* byU16 : table may be kept from a previous block, with entries before current input */
+        if (TableType == byU16 && ctx->currentOffset)
+            return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, Output, TableType, noDict, dictSmall, acceleration);
+        return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, Output, TableType, noDict, noDictIssue, acceleration);
+    }
+
+    LZ4_renormDictT(ctx, srcSize);
+    assert(Dict != withPrefix64k || (const char*)ctx->dictionary + ctx->dictSize == src);
+    assert(Dict != usingExtDict || (ctx->dictCtx == NULL && ctx->dictSize >= 4));
+    assert(Dict != usingDictCtx || ctx->dictCtx != NULL);
+    {   int result;
+        if (Dict != usingDictCtx && (ctx->dictSize < 64 KB) && (ctx->dictSize < ctx->currentOffset))
+            result = LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, Output, TableType, Dict, dictSmall, acceleration);
+        else
+            result = LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, Output, TableType, Dict, noDictIssue, acceleration);
+        if (Dict != withPrefix64k) {
+            /* next block can use this one as prefix */
+            ctx->dictionary = (const BYTE*)src;
+            ctx->dictSize = (U32)srcSize;
+        }
+        return result;
+    }
+}
+
+
+/*! decompress<Mode, Dict>() :
+ *  Decodes block @src of @srcSize bytes into @dst, with the same guarantees as LZ4_decompress_safe() :
+ *  it never reads beyond @src + @srcSize, nor writes beyond @dst + @dstCapacity, even on malformed input.
+ *  - Mode == partial_decode : stops after @dstCapacity bytes, like LZ4_decompress_safe_partial().
+ *  - Dict == noDict : @dict, when present, must be a prefix, ending exactly at @dst.
+ *  - Dict == withPrefix64k : at least 64 KB of history precede @dst; @dict is ignored.
+ *  - Dict == usingExtDict : history is @dict, of @dictSize bytes, anywhere in memory.
+ * @return : nb of bytes written into @dst, or a negative value if @src is malformed.
+ */
+template <earlyEnd_directive Mode = decode_full_block, dict_directive Dict = noDict>
+inline int decompress(const char* src, char* dst, int srcSize, int dstCapacity,
+                      const char* dict = NULL, size_t dictSize = 0)
+{
+    static_assert(Dict == noDict || Dict == withPrefix64k || Dict == usingExtDict, "invalid dictionary mode for decompression");
+    assert(Dict != noDict || dictSize == 0 || dict + dictSize == dst);
+    if (Dict == withPrefix64k)
+        return LZ4_decompress_generic(src, dst, srcSize, dstCapacity, Mode, withPrefix64k,
+                                      (BYTE*)dst - 64 KB, NULL, 0);
+    if (Dict == usingExtDict)
+        return LZ4_decompress_generic(src, dst, srcSize, dstCapacity, Mode, usingExtDict,
+                                      (BYTE*)dst, (const BYTE*)dict, dictSize);
+    return LZ4_decompress_generic(src, dst, srcSize, dstCapacity, Mode, noDict,
+                                  (BYTE*)dst - dictSize, NULL, 0);
+}
+
+} /* namespace lz4 */
+
+#endif /* LZ4_HPP_2983827168210 */
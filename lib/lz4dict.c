@@ -0,0 +1,264 @@
+/*
+    LZ4 dictionary builder
+    Copyright (C) 2011-2020, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+       - LZ4 source repository : https://github.com/lz4/lz4
+       - LZ4 public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+/* note : lz4dict is not an independent module, it requires lz4.h/lz4.c for proper compilation */
+
+
+/*===    Dependency    ===*/
+#include "lz4dict.h"
+
+
+/*===   Shared lz4.c code   ===*/
+#ifndef LZ4_SRC_INCLUDED
+# if defined(__GNUC__)
+#  pragma GCC diagnostic ignored "-Wunused-function"
+# endif
+# if defined (__clang__)
+#  pragma clang diagnostic ignored "-Wunused-function"
+# endif
+# define LZ4_COMMONDEFS_ONLY
+# include "lz4.c"   /* mem, ALLOC, DEBUGLOG */
+#endif
+
+
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+
+/*===   Constants   ===*/
+#define LZ4DICT_DMER        8   /* repetitions are identified by their first 8 bytes */
+#define LZ4DICT_HASHLOG    20
+#define LZ4DICT_NODMER     (1U << LZ4DICT_HASHLOG)   /* position not starting a usable dmer */
+#define LZ4DICT_HOLDOUT     8   /* 1 sample out of 8 is held out to evaluate candidate dictionaries */
+
+static const size_t LZ4DICT_segmentSizes[] = { 64, 128, 256, 512, 1024 };
+
+
+static U32 LZ4DICT_hashDmer(const BYTE* p)
+{
+    U64 v;
+    LZ4_memcpy(&v, p, sizeof(v));
+    return (U32)((v * 11400714785074694791ULL) >> (64 - LZ4DICT_HASHLOG));
+}
+
+typedef struct {
+    const BYTE* src;
+    const int* sampleSizes;
+    int nbSamples;
+    size_t totalSize;
+    U32* hashes;   /* dmer starting at each position */
+    U32* freqs;    /* score of each dmer */
+    U32* marks;    /* nb of occurrences in current window */
+} LZ4DICT_ctx;
+
+static int LZ4DICT_isHeldOut(const LZ4DICT_ctx* ctx, int n, int holdout)
+{
+    return holdout && (ctx->nbSamples >= 2 * LZ4DICT_HOLDOUT) && (n % LZ4DICT_HOLDOUT == 0);
+}
+
+/* LZ4DICT_select() :
+ * Segment selection follows the "cover" principle :
+ * each dmer (group of LZ4DICT_DMER bytes) is scored by the nb of samples it appears in.
+ * Samples are cut into epochs, and in each epoch, the segment of size @segmentSize
+ * covering the largest total score of distinct dmers is selected.
+ * Dmers of a selected segment are then scored 0, so that later segments cover new content.
+ * Dmers present in a single sample are ignored : LZ4 already finds them without a dictionary.
+ * Epochs are visited round-robin until the dictionary is full or no segment scores anymore.
+ * Dictionary is filled from its end, so that first selected segments are the closest to input.
+ * When @holdout is set, held out samples are not used.
+ * @return : size of dictionary written at the beginning of @dict */
+static size_t LZ4DICT_select(LZ4DICT_ctx* ctx, BYTE* dict, size_t dictMax, size_t segmentSize, int holdout)
+{
+    const BYTE* const src = ctx->src;
+    U32* const hashes = ctx->hashes;
+    U32* const freqs = ctx->freqs;
+    U32* const marks = ctx->marks;
+    size_t const tableSize = ((size_t)LZ4DICT_NODMER + 1) * sizeof(U32);
+    size_t const window = segmentSize - LZ4DICT_DMER + 1;   /* nb of dmers starting within a segment */
+    size_t const totalSize = ctx->totalSize;
+    size_t dictStart = dictMax;
+
+    /* count nb of samples containing each dmer */
+    MEM_INIT(freqs, 0, tableSize);
+    MEM_INIT(marks, 0, tableSize);
+    {   size_t pos = 0;
+        int n;
+        for (n = 0; n < ctx->nbSamples; n++) {
+            size_t const end = pos + (size_t)ctx->sampleSizes[n];
+            int const skip = LZ4DICT_isHeldOut(ctx, n, holdout);
+            for ( ; pos < end; pos++) {
+                U32 h;
+                if (skip || pos + LZ4DICT_DMER > end) { hashes[pos] = LZ4DICT_NODMER; continue; }
+                h = LZ4DICT_hashDmer(src + pos);
+                hashes[pos] = h;
+                if (marks[h] != (U32)n + 1) { marks[h] = (U32)n + 1; freqs[h]++; }
+    }   }   }
+    {   U32 h;
+        for (h = 0; h < LZ4DICT_NODMER; h++) if (freqs[h] < 2) freqs[h] = 0;
+        assert(freqs[LZ4DICT_NODMER] == 0);
+        MEM_INIT(marks, 0, tableSize);
+    }
+
+    /* select segments */
+    {   size_t const nbSegments = dictMax / segmentSize + 1;
+        size_t const epochSize = (totalSize / nbSegments > 4 * segmentSize) ?
+                                  totalSize / nbSegments : 4 * segmentSize;
+        size_t const nbEpochs = (totalSize + epochSize - 1) / epochSize;
+        size_t epoch = 0, nbIdleEpochs = 0;
+
+        while (dictStart >= LZ4DICT_DMER && nbIdleEpochs < nbEpochs) {
+            size_t const epochStart = epoch * epochSize;
+            size_t const epochEnd = (epochStart + epochSize < totalSize) ? epochStart + epochSize : totalSize;
+            size_t begin = epochStart, pos;
+            size_t bestBegin = 0, bestEnd = 0;
+            size_t score = 0, bestScore = 0;
+
+            /* sliding window over dmers [begin, pos] */
+            for (pos = epochStart; pos < epochEnd; pos++) {
+                U32 const h = hashes[pos];
+                if (marks[h]++ == 0) score += freqs[h];
+                if (pos - begin >= window) {
+                    U32 const oldh = hashes[begin++];
+                    if (--marks[oldh] == 0) score -= freqs[oldh];
+                }
+                if (score > bestScore) { bestScore = score; bestBegin = begin; bestEnd = pos + 1; }
+            }
+            for ( ; begin < epochEnd; begin++) marks[hashes[begin]]--;
+
+            if (bestScore == 0) {
+                nbIdleEpochs++;
+            } else {
+                size_t segSize;
+                /* trim useless dmers on both sides */
+                while (freqs[hashes[bestBegin]] == 0) bestBegin++;
+                while (freqs[hashes[bestEnd-1]] == 0) bestEnd--;
+                segSize = bestEnd - 1 + LZ4DICT_DMER - bestBegin;
+                if (segSize > dictStart) segSize = dictStart;
+                dictStart -= segSize;
+                LZ4_memcpy(dict + dictStart, src + bestBegin, segSize);
+                for (pos = bestBegin; pos < bestEnd; pos++) freqs[hashes[pos]] = 0;
+                nbIdleEpochs = 0;
+            }
+            epoch = (epoch + 1 == nbEpochs) ? 0 : epoch + 1;
+    }   }
+
+    if (dictStart > 0) LZ4_memmove(dict, dict + dictStart, dictMax - dictStart);
+    return dictMax - dictStart;
+}
+
+/* LZ4DICT_evaluate() :
+ * @return : total compressed size of held out samples, using @dict with LZ4's fast compressor */
+static size_t LZ4DICT_evaluate(const LZ4DICT_ctx* ctx, const BYTE* dict, size_t dictSize,
+                               LZ4_stream_t* stream, char* dst, int dstCapacity)
+{
+    size_t pos = 0, cSize = 0;
+    int n;
+    for (n = 0; n < ctx->nbSamples; n++) {
+        int const sampleSize = ctx->sampleSizes[n];
+        if (LZ4DICT_isHeldOut(ctx, n, 1)) {
+            LZ4_resetStream_fast(stream);
+            LZ4_loadDict(stream, (const char*)dict, (int)dictSize);
+            cSize += (size_t)LZ4_compress_fast_continue(stream, (const char*)ctx->src + pos, dst, sampleSize, dstCapacity, 1);
+        }
+        pos += (size_t)sampleSize;
+    }
+    return cSize;
+}
+
+/* LZ4_trainDictionary() :
+ * When there are enough samples, each candidate segment size is tried on a subset of samples,
+ * and evaluated by compressing the held out ones.
+ * The final dictionary is then selected from all samples, using the best segment size. */
+int LZ4_trainDictionary(void* dictBuffer, int dictCapacity,
+                  const void* samplesBuffer, const int sampleSizes[], int nbSamples)
+{
+    BYTE* const dict = (BYTE*)dictBuffer;
+    size_t const tableSize = ((size_t)LZ4DICT_NODMER + 1) * sizeof(U32);
+    size_t const dictMax = (dictCapacity < 0) ? 0 :
+                           (dictCapacity > LZ4DICT_SIZE_MAX) ? LZ4DICT_SIZE_MAX : (size_t)dictCapacity;
+    size_t dictSize = 0;
+    size_t segmentSize = LZ4DICT_segmentSizes[0];
+    int sampleSizeMax = 0;
+    LZ4DICT_ctx ctx;
+    LZ4_stream_t* stream = NULL;
+    char* dst = NULL;
+    int n;
+
+    DEBUGLOG(4, "LZ4_trainDictionary (%i samples, capacity %i)", nbSamples, dictCapacity);
+    if (dictBuffer == NULL || samplesBuffer == NULL || sampleSizes == NULL || nbSamples <= 0) return 0;
+    ctx.src = (const BYTE*)samplesBuffer;
+    ctx.sampleSizes = sampleSizes;
+    ctx.nbSamples = nbSamples;
+    ctx.totalSize = 0;
+    for (n = 0; n < nbSamples; n++) {
+        if (sampleSizes[n] < 0 || sampleSizes[n] > LZ4_MAX_INPUT_SIZE) return 0;
+        if (sampleSizes[n] > sampleSizeMax) sampleSizeMax = sampleSizes[n];
+        ctx.totalSize += (size_t)sampleSizes[n];
+    }
+    if (ctx.totalSize < LZ4DICT_DMER || dictMax < LZ4DICT_segmentSizes[0]) return 0;
+
+    ctx.hashes = (U32*)ALLOC(ctx.totalSize * sizeof(U32));
+    ctx.freqs = (U32*)ALLOC(tableSize);
+    ctx.marks = (U32*)ALLOC(tableSize);
+    if (ctx.hashes == NULL || ctx.freqs == NULL || ctx.marks == NULL) goto _cleanup;
+
+    if (nbSamples >= 2 * LZ4DICT_HOLDOUT) {
+        int const dstCapacity = LZ4_compressBound(sampleSizeMax);
+        size_t bestCSize = (size_t)-1;
+        size_t u;
+        stream = LZ4_createStream();
+        dst = (char*)ALLOC((size_t)dstCapacity);
+        if (stream == NULL || dst == NULL) goto _cleanup;
+        for (u = 0; u < sizeof(LZ4DICT_segmentSizes) / sizeof(LZ4DICT_segmentSizes[0]); u++) {
+            size_t const candidate = LZ4DICT_segmentSizes[u];
+            size_t cSize;
+            if (candidate > dictMax) break;
+            dictSize = LZ4DICT_select(&ctx, dict, dictMax, candidate, 1);
+            cSize = LZ4DICT_evaluate(&ctx, dict, dictSize, stream, dst, dstCapacity);
+            DEBUGLOG(5, "segments of %u bytes : held out samples compressed into %u bytes",
+                        (unsigned)candidate, (unsigned)cSize);
+            if (cSize < bestCSize) { bestCSize = cSize; segmentSize = candidate; }
+    }   }
+
+    dictSize = LZ4DICT_select(&ctx, dict, dictMax, segmentSize, 0);
+
+_cleanup:
+    FREEMEM(ctx.hashes);
+    FREEMEM(ctx.freqs);
+    FREEMEM(ctx.marks);
+    FREEMEM(dst);
+    LZ4_freeStream(stream);
+    DEBUGLOG(4, "LZ4_trainDictionary : dictionary of %u bytes (segments of %u bytes)",
+                (unsigned)dictSize, (unsigned)segmentSize);
+    return (int)dictSize;
+}
+
+#endif /* !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION) */
@@ -0,0 +1,80 @@
+/*
+ *  LZ4 dictionary builder
+ *  Header File
+ *  Copyright (C) 2011-2020, Yann Collet.
+
+   BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are
+   met:
+
+       * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   You can contact the author at :
+    - LZ4 source repository : https://github.com/lz4/lz4
+    - LZ4 public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+#ifndef LZ4DICT_H_98237428734687
+#define LZ4DICT_H_98237428734687
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* --- Dependency --- */
+/* note : lz4dict requires lz4.h/lz4.c for compilation */
+#include "lz4.h"   /* stddef, LZ4LIB_API */
+
+
+/* --- Useful constants --- */
+#define LZ4DICT_SIZE_MAX   (64 * 1024)   /* LZ4_loadDict() only uses the last 64 KB of a dictionary */
+
+
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+/*! LZ4_trainDictionary() :
+ *  Builds a dictionary from a set of samples, such as a few thousand small messages.
+ *  Samples are stored one after another in @samplesBuffer,
+ *  sample n being sampleSizes[n] bytes long.
+ *  The resulting dictionary is written into @dictBuffer,
+ *  and can be used with LZ4_loadDict(), LZ4_loadDictHC(), LZ4F_createCDict() or `lz4 -D`.
+ *
+ *  Content is selected for LZ4's matcher, which has no entropy stage :
+ *  the dictionary is made of segments of samples covering the longest and most widespread
+ *  repetitions found across different samples, all within reach of LZ4_DISTANCE_MAX.
+ *  The most useful segments are placed at the end of the dictionary,
+ *  where they are the least likely to be pushed out of the history window.
+ *  With at least 16 samples, segment size is chosen by compressing held out samples.
+ *  @dictCapacity beyond LZ4DICT_SIZE_MAX is not used.
+ *
+ *  This function allocates a workspace of ~4x the total size of samples, plus 8 MB.
+ * @return : size of the dictionary written into @dictBuffer,
+ *           or 0 if no content is shared between samples (or on allocation failure).
+ */
+LZ4LIB_API int LZ4_trainDictionary(void* dictBuffer, int dictCapacity,
+                             const void* samplesBuffer, const int sampleSizes[], int nbSamples);
+#endif /* !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION) */
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* LZ4DICT_H_98237428734687 */
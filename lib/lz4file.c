@@ -31,11 +31,36 @@
  * - LZ4 homepage : http://www.lz4.org
  * - LZ4 source repository : https://github.com/lz4/lz4
  */
+/* Large file support : 64-bit off_t for fseeko() and ftello() on 32-bit Unix targets */
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+#  define _FILE_OFFSET_BITS 64
+#endif
+#if !defined(_WIN32) && !defined(_LARGEFILE_SOURCE)
+#  define _LARGEFILE_SOURCE 1
+#endif
 #include <stdlib.h>  /* malloc, free */
 #include <string.h>
 #include <assert.h>
 #include "lz4.h"
 #include "lz4file.h"
+#define XXH_STATIC_LINKING_ONLY
+#include "xxhash.h"
+
+/* File positions are 64-bit : fseek() and ftell() are limited to 2 GB on Windows and 32-bit targets */
+#if defined(_MSC_VER) && (_MSC_VER >= 1400)
+#  define LZ4FILE_FSEEK(f, pos, origin)  _fseeki64((f), (__int64)(pos), (origin))
+#  define LZ4FILE_FTELL(f)               ((long long)_ftelli64(f))
+#elif defined(__MINGW32__) && defined(__MSVCRT__) && !defined(__STRICT_ANSI__) && !defined(__NO_MINGW_LFS)
+#  define LZ4FILE_FSEEK(f, pos, origin)  fseeko64((f), (off64_t)(pos), (origin))
+#  define LZ4FILE_FTELL(f)               ((long long)ftello64(f))
+#elif defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#  include <sys/types.h>   /* off_t */
+#  define LZ4FILE_FSEEK(f, pos, origin)  fseeko((f), (off_t)(pos), (origin))
+#  define LZ4FILE_FTELL(f)               ((long long)ftello(f))
+#else
+#  define LZ4FILE_FSEEK(f, pos, origin)  fseek((f), (long)(pos), (origin))
+#  define LZ4FILE_FTELL(f)               ((long long)ftell(f))
+#endif
 
 static LZ4F_errorCode_t returnErrorCode(LZ4F_errorCodes code)
 {
@@ -46,6 +71,11 @@ static LZ4F_errorCode_t returnErrorCode(LZ4F_errorCodes code)
 
 /* =====   read API   ===== */
 
+typedef struct {
+  long long cPos;       /* relative to first block */
+  unsigned long long dPos;
+} LZ4F_blockIndexEntry_t;
+
 struct LZ4_readFile_s {
   LZ4F_dctx* dctxPtr;
   FILE* fp;
@@ -53,6 +83,27 @@ struct LZ4_readFile_s {
   size_t srcBufNext;
   size_t srcBufSize;
   size_t srcBufMaxSize;
+  LZ4_byte* ringBuf;    /* decoded data exposed by LZ4F_readPeek(), allocated on first use */
+  size_t ringBufSize;
+  size_t ringNext;      /* where next decoded data goes */
+  size_t peekStart;
+  size_t peekSize;      /* decoded bytes not consumed yet, at ringBuf + peekStart */
+  unsigned long long readPos;   /* decoded position, as seen by the caller */
+  LZ4F_decompressOptions_t dOpt;
+  /* random access (LZ4F_seek()) */
+  LZ4_byte header[LZ4F_HEADER_SIZE_MAX];
+  size_t headerSize;
+  long long frameStart;   /* file position of first block, -1 if fp is not seekable */
+  int blockIndependent;
+  int blockChecksum;
+  int contentChecksum;
+  LZ4F_blockIndexEntry_t* blockIndex;   /* start of each block scanned so far */
+  size_t nbIndexed;
+  size_t indexCapacity;
+  long long indexCEnd;  /* end of last indexed block, relative to frameStart */
+  unsigned long long indexDEnd;
+  int indexComplete;    /* end mark reached */
+  int seekTableTried;
 };
 
 static void LZ4F_freeReadFile(LZ4_readFile_t* lz4fRead)
@@ -60,6 +111,8 @@ static void LZ4F_freeReadFile(LZ4_readFile_t* lz4fRead)
   if (lz4fRead==NULL) return;
   LZ4F_freeDecompressionContext(lz4fRead->dctxPtr);
   free(lz4fRead->srcBuf);
+  free(lz4fRead->ringBuf);
+  free(lz4fRead->blockIndex);
   free(lz4fRead);
 }
 
@@ -105,6 +158,16 @@ LZ4F_errorCode_t LZ4F_readOpen(LZ4_readFile_t** lz4fRead, FILE* fp)
       return r;
     }
 
+    /* kept for LZ4F_seek() */
+    memcpy((*lz4fRead)->header, buf, consumedSize);
+    (*lz4fRead)->headerSize = consumedSize;
+    (*lz4fRead)->blockIndependent = (info.blockMode == LZ4F_blockIndependent);
+    (*lz4fRead)->blockChecksum = (info.blockChecksumFlag == LZ4F_blockChecksumEnabled);
+    (*lz4fRead)->contentChecksum = (info.contentChecksumFlag == LZ4F_contentChecksumEnabled);
+    { long long const pos = LZ4FILE_FTELL(fp);
+      (*lz4fRead)->frameStart = (pos >= 0) ? pos - (long long)(sizeof(buf) - consumedSize) : -1;
+    }
+
     switch (info.blockSizeID) {
       case LZ4F_default :
       case LZ4F_max64KB :
@@ -145,6 +208,16 @@ size_t LZ4F_read(LZ4_readFile_t* lz4fRead, void* buf, size_t size)
   if (lz4fRead == NULL || buf == NULL)
     RETURN_ERROR(parameter_null);
 
+  /* data already decoded by LZ4F_readPeek() comes first */
+  if (lz4fRead->peekSize > 0) {
+    size_t const n = (size < lz4fRead->peekSize) ? size : lz4fRead->peekSize;
+    memcpy(p, lz4fRead->ringBuf + lz4fRead->peekStart, n);
+    lz4fRead->peekStart += n;
+    lz4fRead->peekSize -= n;
+    next += n;
+    p += n;
+  }
+
   while (next < size) {
     size_t srcsize = lz4fRead->srcBufSize - lz4fRead->srcBufNext;
     size_t dstsize = size - next;
@@ -167,8 +240,9 @@ size_t LZ4F_read(LZ4_readFile_t* lz4fRead, void* buf, size_t size)
                           p, &dstsize,
                           lz4fRead->srcBuf + lz4fRead->srcBufNext,
                           &srcsize,
-                          NULL);
+                          &lz4fRead->dOpt);
     if (LZ4F_isError(ret)) {
+        lz4fRead->readPos += next;
         return ret;
     }
 
@@ -177,9 +251,333 @@ size_t LZ4F_read(LZ4_readFile_t* lz4fRead, void* buf, size_t size)
     p += dstsize;
   }
 
+  lz4fRead->readPos += next;
   return next;
 }
 
+static LZ4F_errorCode_t LZ4F_readAllocRing(LZ4_readFile_t* lz4fRead)
+{
+  if (lz4fRead->ringBuf == NULL) {
+    /* blocks are decoded in place, and history stays within the ring : no copy */
+    lz4fRead->ringBufSize = LZ4F_DECODER_RING_BUFFER_SIZE(lz4fRead->srcBufMaxSize);
+    lz4fRead->ringBuf = (LZ4_byte*)calloc(1, lz4fRead->ringBufSize);
+    if (lz4fRead->ringBuf == NULL) {
+      RETURN_ERROR(allocation_failed);
+    }
+    LZ4F_setDecoderRingBuffer(lz4fRead->dctxPtr, lz4fRead->ringBuf, lz4fRead->ringBufSize);
+  }
+  return LZ4F_OK_NoError;
+}
+
+LZ4F_errorCode_t LZ4F_readPeek(LZ4_readFile_t* lz4fRead, const void** ptr, size_t* len)
+{
+  size_t const maxBlockSize = lz4fRead ? lz4fRead->srcBufMaxSize : 0;
+
+  if (lz4fRead == NULL || ptr == NULL || len == NULL)
+    RETURN_ERROR(parameter_null);
+
+  { LZ4F_errorCode_t const r = LZ4F_readAllocRing(lz4fRead);
+    if (LZ4F_isError(r)) return r;
+  }
+
+  while (lz4fRead->peekSize == 0) {
+    size_t srcsize = lz4fRead->srcBufSize - lz4fRead->srcBufNext;
+    size_t dstsize;
+    size_t ret;
+
+    if (srcsize == 0) {
+      ret = fread(lz4fRead->srcBuf, 1, lz4fRead->srcBufMaxSize, lz4fRead->fp);
+      if (ret == 0) break;   /* end of file */
+      lz4fRead->srcBufSize = ret;
+      lz4fRead->srcBufNext = 0;
+      srcsize = ret;
+    }
+
+    if (lz4fRead->ringBufSize - lz4fRead->ringNext < maxBlockSize)
+      lz4fRead->ringNext = 0;   /* wrap around */
+    dstsize = lz4fRead->ringBufSize - lz4fRead->ringNext;
+    ret = LZ4F_decompress(lz4fRead->dctxPtr,
+                          lz4fRead->ringBuf + lz4fRead->ringNext, &dstsize,
+                          lz4fRead->srcBuf + lz4fRead->srcBufNext, &srcsize,
+                          &lz4fRead->dOpt);
+    if (LZ4F_isError(ret)) {
+      return ret;
+    }
+    lz4fRead->srcBufNext += srcsize;
+    lz4fRead->peekStart = lz4fRead->ringNext;
+    lz4fRead->peekSize = dstsize;
+    lz4fRead->ringNext += dstsize;
+  }
+
+  *ptr = lz4fRead->ringBuf + lz4fRead->peekStart;
+  *len = lz4fRead->peekSize;
+  return LZ4F_OK_NoError;
+}
+
+LZ4F_errorCode_t LZ4F_readConsume(LZ4_readFile_t* lz4fRead, size_t size)
+{
+  if (lz4fRead == NULL)
+    RETURN_ERROR(parameter_null);
+  if (size > lz4fRead->peekSize)
+    RETURN_ERROR(parameter_invalid);
+  lz4fRead->peekStart += size;
+  lz4fRead->peekSize -= size;
+  lz4fRead->readPos += size;
+  return LZ4F_OK_NoError;
+}
+
+static unsigned LZ4F_readLE32(const LZ4_byte* p)
+{
+  return (unsigned)p[0] + ((unsigned)p[1] << 8) + ((unsigned)p[2] << 16) + ((unsigned)p[3] << 24);
+}
+
+static LZ4F_errorCode_t LZ4F_indexBlock(LZ4_readFile_t* lz4fRead, size_t cBlockSize, size_t dBlockSize)
+{
+  if (lz4fRead->nbIndexed == lz4fRead->indexCapacity) {
+    size_t const newCapacity = lz4fRead->indexCapacity ? lz4fRead->indexCapacity * 2 : 64;
+    LZ4F_blockIndexEntry_t* const newIndex =
+        (LZ4F_blockIndexEntry_t*)realloc(lz4fRead->blockIndex, newCapacity * sizeof(LZ4F_blockIndexEntry_t));
+    if (newIndex == NULL)
+      RETURN_ERROR(allocation_failed);
+    lz4fRead->blockIndex = newIndex;
+    lz4fRead->indexCapacity = newCapacity;
+  }
+  lz4fRead->blockIndex[lz4fRead->nbIndexed].cPos = lz4fRead->indexCEnd;
+  lz4fRead->blockIndex[lz4fRead->nbIndexed].dPos = lz4fRead->indexDEnd;
+  lz4fRead->nbIndexed++;
+  lz4fRead->indexCEnd += (long long)cBlockSize;
+  lz4fRead->indexDEnd += dBlockSize;
+  return LZ4F_OK_NoError;
+}
+
+/* LZ4F_loadSeekTable() :
+ * fills the block index from a seek table ending the file, if there is one.
+ * A missing or inconsistent seek table is not an error : blocks are scanned instead. */
+static LZ4F_errorCode_t LZ4F_loadSeekTable(LZ4_readFile_t* lz4fRead)
+{
+  LZ4_byte footer[LZ4F_SEEKTABLE_FOOTER_SIZE];
+  LZ4_byte* table;
+  size_t tableFrameSize, nbBlocks, n;
+  long long fileSize, frameEnd;
+  long long cTotal = 0;
+
+  if (LZ4FILE_FSEEK(lz4fRead->fp, -(long long)sizeof(footer), SEEK_END) != 0) return LZ4F_OK_NoError;
+  fileSize = LZ4FILE_FTELL(lz4fRead->fp) + (long long)sizeof(footer);
+  if (fread(footer, 1, sizeof(footer), lz4fRead->fp) != sizeof(footer)) return LZ4F_OK_NoError;
+  tableFrameSize = LZ4F_seekTableFrameSize(footer, sizeof(footer));
+  if (LZ4F_isError(tableFrameSize)) return LZ4F_OK_NoError;
+  frameEnd = fileSize - (long long)tableFrameSize;
+  if (frameEnd < lz4fRead->frameStart) return LZ4F_OK_NoError;
+
+  table = (LZ4_byte*)malloc(tableFrameSize);
+  if (table == NULL)
+    RETURN_ERROR(allocation_failed);
+  if (LZ4FILE_FSEEK(lz4fRead->fp, frameEnd, SEEK_SET) != 0
+    || fread(table, 1, tableFrameSize, lz4fRead->fp) != tableFrameSize
+    || LZ4F_readLE32(table) != LZ4F_SEEKTABLE_MAGICNUMBER
+    || LZ4F_readLE32(table + 4) != tableFrameSize - 8) {
+    free(table);
+    return LZ4F_OK_NoError;
+  }
+  nbBlocks = (tableFrameSize - 8 - LZ4F_SEEKTABLE_FOOTER_SIZE) / LZ4F_SEEKTABLE_ENTRY_SIZE;
+  for (n = 0; n < nbBlocks; n++)
+    cTotal += LZ4F_readLE32(table + 8 + n * LZ4F_SEEKTABLE_ENTRY_SIZE);
+  /* the table must describe exactly the frame it follows */
+  if (lz4fRead->frameStart + cTotal + 4 + (lz4fRead->contentChecksum ? 4 : 0) == frameEnd) {
+    for (n = 0; n < nbBlocks; n++) {
+      const LZ4_byte* const entry = table + 8 + n * LZ4F_SEEKTABLE_ENTRY_SIZE;
+      LZ4F_errorCode_t const r = LZ4F_indexBlock(lz4fRead, LZ4F_readLE32(entry), LZ4F_readLE32(entry + 4));
+      if (LZ4F_isError(r)) {
+        free(table);
+        return r;
+      }
+    }
+    lz4fRead->indexComplete = 1;
+  }
+  free(table);
+  return LZ4F_OK_NoError;
+}
+
+/* LZ4F_blockDecodedSize() :
+ * walks the sequences of an LZ4 block, without decoding it.
+ * @return : decoded size, or an error code if block is malformed */
+static size_t LZ4F_blockDecodedSize(const LZ4_byte* src, size_t srcSize, size_t maxBlockSize)
+{
+  const LZ4_byte* ip = src;
+  const LZ4_byte* const iend = src + srcSize;
+  size_t dSize = 0;
+
+  while (ip < iend) {
+    unsigned const token = *ip++;
+    size_t length = token >> 4;
+    if (length == 15) {
+      unsigned s;
+      do {
+        if (ip >= iend) RETURN_ERROR(decompressionFailed);
+        s = *ip++;
+        length += s;
+      } while (s == 255);
+    }
+    if (length > (size_t)(iend - ip)) RETURN_ERROR(decompressionFailed);
+    ip += length;
+    dSize += length;
+    if (ip == iend) break;   /* last sequence : literals only */
+
+    if ((size_t)(iend - ip) < 2) RETURN_ERROR(decompressionFailed);
+    ip += 2;   /* offset */
+    length = token & 15;
+    if (length == 15) {
+      unsigned s;
+      do {
+        if (ip >= iend) RETURN_ERROR(decompressionFailed);
+        s = *ip++;
+        length += s;
+      } while (s == 255);
+    }
+    dSize += length + 4;
+    if (dSize > maxBlockSize) RETURN_ERROR(decompressionFailed);
+  }
+  if (dSize > maxBlockSize) RETURN_ERROR(decompressionFailed);
+  return dSize;
+}
+
+/* LZ4F_scanBlock() :
+ * adds next block to the index, reading its header and walking its sequences.
+ * @return : 0, or an error code */
+static LZ4F_errorCode_t LZ4F_scanBlock(LZ4_readFile_t* lz4fRead)
+{
+  LZ4_byte bh[4];
+  size_t cSize, dSize;
+  size_t const crcSize = lz4fRead->blockChecksum ? 4 : 0;
+
+  if (LZ4FILE_FSEEK(lz4fRead->fp, lz4fRead->frameStart + lz4fRead->indexCEnd, SEEK_SET) != 0
+    || fread(bh, 1, sizeof(bh), lz4fRead->fp) != sizeof(bh))
+    RETURN_ERROR(io_read);
+  cSize = LZ4F_readLE32(bh) & 0x7FFFFFFFU;
+  if (cSize == 0) {   /* end mark */
+    lz4fRead->indexComplete = 1;
+    return LZ4F_OK_NoError;
+  }
+  if (cSize > lz4fRead->srcBufMaxSize)
+    RETURN_ERROR(maxBlockSize_invalid);
+  if (LZ4F_readLE32(bh) & 0x80000000U) {
+    dSize = cSize;   /* uncompressed block */
+  } else {
+    /* srcBuf content is discarded by LZ4F_seek() anyway */
+    if (fread(lz4fRead->srcBuf, 1, cSize, lz4fRead->fp) != cSize)
+      RETURN_ERROR(io_read);
+    dSize = LZ4F_blockDecodedSize(lz4fRead->srcBuf, cSize, lz4fRead->srcBufMaxSize);
+    if (LZ4F_isError(dSize)) return dSize;
+  }
+  return LZ4F_indexBlock(lz4fRead, sizeof(bh) + cSize + crcSize, dSize);
+}
+
+/* LZ4F_readSkip() :
+ * decodes and discards `size` bytes. */
+static LZ4F_errorCode_t LZ4F_readSkip(LZ4_readFile_t* lz4fRead, unsigned long long size)
+{
+  while (size > 0) {
+    const void* ptr = NULL;
+    size_t len = 0;
+    LZ4F_errorCode_t const r = LZ4F_readPeek(lz4fRead, &ptr, &len);
+    if (LZ4F_isError(r)) return r;
+    if (len == 0)
+      RETURN_ERROR(parameter_invalid);   /* beyond end of file */
+    if (len > size) len = (size_t)size;
+    LZ4F_readConsume(lz4fRead, len);
+    size -= len;
+  }
+  return LZ4F_OK_NoError;
+}
+
+/* LZ4F_readRestart() :
+ * resumes decoding from file position `cPos` (relative to first block), at decoded position `dPos`.
+ * Only the frame header is fed back to the decoder : when resuming mid-frame,
+ * content size is removed from it, and checksums can't be verified anymore. */
+static LZ4F_errorCode_t LZ4F_readRestart(LZ4_readFile_t* lz4fRead, long long cPos, unsigned long long dPos)
+{
+  LZ4_byte header[LZ4F_HEADER_SIZE_MAX];
+  size_t headerSize = lz4fRead->headerSize;
+  size_t dstSize = 0;
+  LZ4F_errorCode_t r;
+
+  memcpy(header, lz4fRead->header, headerSize);
+  if (cPos > 0 && (header[4] & 0x08)) {
+    /* FLG.ContentSize : remove the 8-byte field, then fix header checksum */
+    memmove(header + 6, header + 14, headerSize - 14);
+    headerSize -= 8;
+    header[4] &= (LZ4_byte)~0x08;
+    header[headerSize - 1] = (LZ4_byte)(XXH32(header + 4, headerSize - 5, 0) >> 8);
+  }
+  if (LZ4FILE_FSEEK(lz4fRead->fp, lz4fRead->frameStart + cPos, SEEK_SET) != 0)
+    RETURN_ERROR(io_read);
+
+  LZ4F_resetDecompressionContext(lz4fRead->dctxPtr);
+  lz4fRead->dOpt.skipChecksums = (cPos > 0);
+  r = LZ4F_decompress(lz4fRead->dctxPtr, lz4fRead->srcBuf, &dstSize, header, &headerSize, &lz4fRead->dOpt);
+  if (LZ4F_isError(r)) return r;
+
+  lz4fRead->srcBufSize = 0;
+  lz4fRead->srcBufNext = 0;
+  lz4fRead->ringNext = 0;
+  lz4fRead->peekStart = 0;
+  lz4fRead->peekSize = 0;
+  lz4fRead->readPos = dPos;
+  return LZ4F_OK_NoError;
+}
+
+LZ4F_errorCode_t LZ4F_seek(LZ4_readFile_t* lz4fRead, unsigned long long offset)
+{
+  LZ4F_errorCode_t r;
+
+  if (lz4fRead == NULL)
+    RETURN_ERROR(parameter_null);
+  if (!lz4fRead->blockIndependent)
+    RETURN_ERROR(blockMode_invalid);   /* linked blocks : no random access */
+  if (offset == lz4fRead->readPos)
+    return LZ4F_OK_NoError;
+
+  if (lz4fRead->frameStart < 0) {
+    /* fp is not seekable : only forward, by decoding */
+    if (offset < lz4fRead->readPos)
+      RETURN_ERROR(io_read);
+    return LZ4F_readSkip(lz4fRead, offset - lz4fRead->readPos);
+  }
+
+  /* independent blocks : restart from the block containing offset */
+  if (!lz4fRead->seekTableTried) {
+    lz4fRead->seekTableTried = 1;
+    r = LZ4F_loadSeekTable(lz4fRead);
+    if (LZ4F_isError(r)) return r;
+  }
+  while (!lz4fRead->indexComplete && lz4fRead->indexDEnd <= offset) {
+    r = LZ4F_scanBlock(lz4fRead);
+    if (LZ4F_isError(r)) return r;
+  }
+  if (offset > lz4fRead->indexDEnd)
+    RETURN_ERROR(parameter_invalid);   /* beyond end of frame */
+  if (offset == lz4fRead->indexDEnd)
+    return LZ4F_readRestart(lz4fRead, lz4fRead->indexCEnd, offset);   /* at end mark */
+
+  { size_t lo = 0, hi = lz4fRead->nbIndexed - 1;
+    while (lo < hi) {   /* last block starting at or before offset */
+      size_t const mid = (lo + hi + 1) / 2;
+      if (lz4fRead->blockIndex[mid].dPos <= offset) lo = mid; else hi = mid - 1;
+    }
+    r = LZ4F_readRestart(lz4fRead, lz4fRead->blockIndex[lo].cPos, lz4fRead->blockIndex[lo].dPos);
+    if (LZ4F_isError(r)) return r;
+  }
+  return LZ4F_readSkip(lz4fRead, offset - lz4fRead->readPos);
+}
+
+LZ4F_errorCode_t LZ4F_readSetCodec(LZ4_readFile_t* lz4fRead, const LZ4F_BlockCodec* codec)
+{
+  if (lz4fRead == NULL)
+    RETURN_ERROR(parameter_null);
+  LZ4F_setDecompressionCodec(lz4fRead->dctxPtr, codec);
+  return LZ4F_OK_NoError;
+}
+
 LZ4F_errorCode_t LZ4F_readClose(LZ4_readFile_t* lz4fRead)
 {
   if (lz4fRead == NULL)
@@ -190,6 +588,35 @@ LZ4F_errorCode_t LZ4F_readClose(LZ4_readFile_t* lz4fRead)
 
 /* =====   write API   ===== */
 
+/* Background compression : a job's completion is published to the writing thread
+ * through one flag per buffer. Without atomics, the writer waits for all jobs instead. */
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  define LZ4FILE_LOAD_ACQUIRE(p)      _InterlockedOr((p), 0)
+#  define LZ4FILE_STORE_RELEASE(p, v)  _InterlockedExchange((p), (v))
+#  define LZ4FILE_HAS_ATOMICS 1
+#elif defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#  define LZ4FILE_LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#  define LZ4FILE_STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#  define LZ4FILE_HAS_ATOMICS 1
+#else
+#  define LZ4FILE_LOAD_ACQUIRE(p)      (*(p))
+#  define LZ4FILE_STORE_RELEASE(p, v)  (void)(*(p) = (v))
+#  define LZ4FILE_HAS_ATOMICS 0
+#endif
+
+typedef enum { wb_free = 0, wb_submitted, wb_done } LZ4F_writeBufferState_e;
+
+typedef struct {
+  LZ4F_cctx* cctxPtr;   /* own context, emitting one independent block per compressUpdate() */
+  LZ4_byte* srcBuf;
+  size_t srcSize;
+  LZ4_byte* dstBuf;
+  size_t dstSize;       /* or error code */
+  size_t dstCapacity;
+  long state;           /* LZ4F_writeBufferState_e, written by the job when done */
+} LZ4F_writeBuffer_t;
+
 struct LZ4_writeFile_s {
   LZ4F_cctx* cctxPtr;
   FILE* fp;
@@ -197,6 +624,17 @@ struct LZ4_writeFile_s {
   size_t maxWriteSize;
   size_t dstBufMaxSize;
   LZ4F_errorCode_t errCode;
+  /* background compression only (LZ4F_writeOpen_MT()) */
+  LZ4F_writeBuffer_t* buffers;
+  unsigned nbBuffers;
+  unsigned fillIdx;     /* buffer receiving LZ4F_write() data */
+  unsigned writeIdx;    /* oldest buffer not yet written to file */
+  LZ4F_Executor executor;
+  int hasExecutor;
+  int contentChecksum;
+  XXH32_state_t xxh;
+  unsigned long long contentSize;   /* as announced in frame header, 0 if none */
+  unsigned long long totalInSize;
 };
 
 static void LZ4F_freeWriteFile(LZ4_writeFile_t* state)
@@ -204,6 +642,15 @@ static void LZ4F_freeWriteFile(LZ4_writeFile_t* state)
   if (state == NULL) return;
   LZ4F_freeCompressionContext(state->cctxPtr);
   free(state->dstBuf);
+  if (state->buffers != NULL) {
+    unsigned n;
+    for (n = 0; n < state->nbBuffers; n++) {
+      LZ4F_freeCompressionContext(state->buffers[n].cctxPtr);
+      free(state->buffers[n].srcBuf);
+      free(state->buffers[n].dstBuf);
+    }
+    free(state->buffers);
+  }
   free(state);
 }
 
@@ -214,7 +661,9 @@ static void LZ4F_freeAndNullWriteFile(LZ4_writeFile_t** statePtr)
   *statePtr = NULL;
 }
 
-LZ4F_errorCode_t LZ4F_writeOpen(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr)
+/* LZ4F_writeOpen_internal() :
+ * `append` : continue the frame ending `fp`, see LZ4F_writeOpenAppend() */
+static LZ4F_errorCode_t LZ4F_writeOpen_internal(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr, int append)
 {
   LZ4_byte buf[LZ4F_HEADER_SIZE_MAX];
   size_t ret;
@@ -262,7 +711,10 @@ LZ4F_errorCode_t LZ4F_writeOpen(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4
       return ret;
   }
 
-  ret = LZ4F_compressBegin((*lz4fWrite)->cctxPtr, buf, LZ4F_HEADER_SIZE_MAX, prefsPtr);
+  if (append)
+    ret = LZ4F_compressBegin_append((*lz4fWrite)->cctxPtr, prefsPtr);   /* header already in file */
+  else
+    ret = LZ4F_compressBegin((*lz4fWrite)->cctxPtr, buf, LZ4F_HEADER_SIZE_MAX, prefsPtr);
   if (LZ4F_isError(ret)) {
       LZ4F_freeAndNullWriteFile(lz4fWrite);
       return ret;
@@ -278,6 +730,412 @@ LZ4F_errorCode_t LZ4F_writeOpen(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4
   return LZ4F_OK_NoError;
 }
 
+LZ4F_errorCode_t LZ4F_writeOpen(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr)
+{
+  return LZ4F_writeOpen_internal(lz4fWrite, fp, prefsPtr, 0);
+}
+
+/* LZ4F_findAppendPoint() :
+ * walks the frames of `fp` from its beginning, reading frame and block headers only.
+ * The last frame must be an LZ4 frame, ending the file.
+ * `frameInfo` receives its parameters, `blocksStart` the position of its first block,
+ * and `endMark` the position of its EndMark. `blocksStart` is -1 when `fp` is empty.
+ * @return : 0, or an error code */
+static LZ4F_errorCode_t LZ4F_findAppendPoint(FILE* fp, LZ4F_frameInfo_t* frameInfo, long long* blocksStart, long long* endMark)
+{
+  LZ4F_dctx* dctx;
+  LZ4_byte header[LZ4F_HEADER_SIZE_MAX];
+  long long pos = 0;
+  int lastIsFrame = 0;
+  LZ4F_errorCode_t err;
+
+  *blocksStart = -1;
+  if (LZ4FILE_FSEEK(fp, 0, SEEK_SET) != 0)
+    RETURN_ERROR(io_read);
+  err = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+  if (LZ4F_isError(err))
+    return err;
+
+  while (!LZ4F_isError(err)) {
+    size_t hSize = fread(header, 1, 4, fp);
+    if (hSize == 0 && feof(fp))
+      break;
+    if (hSize != 4) {
+      err = returnErrorCode(LZ4F_ERROR_io_read);
+      break;
+    }
+    if ((LZ4F_readLE32(header) & 0xFFFFFFF0U) == LZ4F_MAGIC_SKIPPABLE_START) {
+      if (fread(header + 4, 1, 4, fp) != 4) {
+        err = returnErrorCode(LZ4F_ERROR_io_read);
+        break;
+      }
+      pos += 8 + (long long)LZ4F_readLE32(header + 4);
+      if (LZ4FILE_FSEEK(fp, pos, SEEK_SET) != 0)
+        err = returnErrorCode(LZ4F_ERROR_io_read);
+      lastIsFrame = 0;
+      continue;
+    }
+    if (LZ4F_readLE32(header) != LZ4F_MAGICNUMBER) {
+      err = returnErrorCode(LZ4F_ERROR_frameType_unknown);   /* legacy frame, or not LZ4 data */
+      break;
+    }
+
+    /* frame header */
+    if (fread(header + 4, 1, LZ4F_HEADER_SIZE_MIN - 4, fp) != LZ4F_HEADER_SIZE_MIN - 4) {
+      err = returnErrorCode(LZ4F_ERROR_io_read);
+      break;
+    }
+    hSize = LZ4F_headerSize(header, LZ4F_HEADER_SIZE_MIN);
+    if (LZ4F_isError(hSize)) {
+      err = hSize;
+      break;
+    }
+    if (fread(header + LZ4F_HEADER_SIZE_MIN, 1, hSize - LZ4F_HEADER_SIZE_MIN, fp) != hSize - LZ4F_HEADER_SIZE_MIN) {
+      err = returnErrorCode(LZ4F_ERROR_io_read);
+      break;
+    }
+    LZ4F_resetDecompressionContext(dctx);
+    err = LZ4F_getFrameInfo(dctx, frameInfo, header, &hSize);
+    if (LZ4F_isError(err))
+      break;
+    pos += (long long)hSize;
+    *blocksStart = pos;
+
+    /* block headers, up to EndMark */
+    { size_t const maxBlockSize = LZ4F_getBlockSize(frameInfo->blockSizeID);
+      size_t const crcSize = frameInfo->blockChecksumFlag ? 4 : 0;
+      while (1) {
+        size_t cSize;
+        if (fread(header, 1, 4, fp) != 4) {
+          err = returnErrorCode(LZ4F_ERROR_io_read);
+          break;
+        }
+        cSize = LZ4F_readLE32(header) & 0x7FFFFFFFU;
+        if (cSize == 0)
+          break;
+        if (cSize > maxBlockSize) {
+          err = returnErrorCode(LZ4F_ERROR_maxBlockSize_invalid);
+          break;
+        }
+        pos += (long long)(4 + cSize + crcSize);
+        if (LZ4FILE_FSEEK(fp, pos, SEEK_SET) != 0) {
+          err = returnErrorCode(LZ4F_ERROR_io_read);
+          break;
+        }
+      }
+      if (LZ4F_isError(err))
+        break;
+    }
+    *endMark = pos;
+    pos += 4 + (frameInfo->contentChecksumFlag ? 4 : 0);
+    if (LZ4FILE_FSEEK(fp, pos, SEEK_SET) != 0)
+      err = returnErrorCode(LZ4F_ERROR_io_read);
+    lastIsFrame = 1;
+  }
+  LZ4F_freeDecompressionContext(dctx);
+  if (LZ4F_isError(err))
+    return err;
+
+  /* seeking beyond end of file succeeds : check that last frame is complete */
+  if (LZ4FILE_FSEEK(fp, 0, SEEK_END) != 0 || LZ4FILE_FTELL(fp) != pos)
+    RETURN_ERROR(io_read);
+  if (pos > 0 && !lastIsFrame)
+    RETURN_ERROR(frameType_unknown);   /* can't continue a frame followed by skippable frames */
+  return LZ4F_OK_NoError;
+}
+
+/* LZ4F_appendPriorFrame() :
+ * verifies the block checksums of the frame being continued, if any.
+ * When the frame has a content checksum, its blocks are also decoded, so that the new checksum covers them,
+ * and the prior checksum, stored after its EndMark, is verified. */
+static LZ4F_errorCode_t LZ4F_appendPriorFrame(LZ4_writeFile_t* lz4fWrite, long long blocksStart, long long endMark,
+                                              const LZ4F_frameInfo_t* frameInfo)
+{
+  size_t const maxBlockSize = LZ4F_getBlockSize(frameInfo->blockSizeID);
+  size_t const crcSize = frameInfo->blockChecksumFlag ? 4 : 0;
+  int const contentChecksum = (frameInfo->contentChecksumFlag == LZ4F_contentChecksumEnabled);
+  LZ4_byte* const cBuf = (LZ4_byte*)malloc(2 * maxBlockSize);
+  LZ4_byte* const dBuf = cBuf + maxBlockSize;
+  XXH32_state_t xxh;
+  LZ4_byte bh[4];
+  long long pos = blocksStart;
+  LZ4F_errorCode_t err = LZ4F_OK_NoError;
+
+  if (cBuf == NULL)
+    RETURN_ERROR(allocation_failed);
+  XXH32_reset(&xxh, 0);
+  if (LZ4FILE_FSEEK(lz4fWrite->fp, pos, SEEK_SET) != 0)
+    err = returnErrorCode(LZ4F_ERROR_io_read);
+  while (!LZ4F_isError(err) && pos < endMark) {
+    size_t cSize;
+    const LZ4_byte* decoded = cBuf;
+    int dSize;
+    if (fread(bh, 1, 4, lz4fWrite->fp) != 4) {
+      err = returnErrorCode(LZ4F_ERROR_io_read);
+      break;
+    }
+    cSize = LZ4F_readLE32(bh) & 0x7FFFFFFFU;
+    assert(cSize <= maxBlockSize);   /* checked by LZ4F_findAppendPoint() */
+    if (fread(cBuf, 1, cSize + crcSize, lz4fWrite->fp) != cSize + crcSize) {
+      err = returnErrorCode(LZ4F_ERROR_io_read);
+      break;
+    }
+    if (crcSize && LZ4F_readLE32(cBuf + cSize) != XXH32(cBuf, cSize, 0)) {
+      err = returnErrorCode(LZ4F_ERROR_blockChecksum_invalid);
+      break;
+    }
+    pos += (long long)(4 + cSize + crcSize);
+    if (!contentChecksum)
+      continue;
+    dSize = (int)cSize;
+    if (!(LZ4F_readLE32(bh) & 0x80000000U)) {
+      dSize = LZ4_decompress_safe((const char*)cBuf, (char*)dBuf, (int)cSize, (int)maxBlockSize);
+      if (dSize < 0) {
+        err = returnErrorCode(LZ4F_ERROR_decompressionFailed);
+        break;
+      }
+      decoded = dBuf;
+    }
+    XXH32_update(&xxh, decoded, (size_t)dSize);
+    err = LZ4F_appendPriorContent(lz4fWrite->cctxPtr, decoded, (size_t)dSize);
+  }
+  if (!LZ4F_isError(err) && contentChecksum) {
+    /* skip EndMark, then compare content checksum */
+    if (fread(cBuf, 1, 8, lz4fWrite->fp) != 8)
+      err = returnErrorCode(LZ4F_ERROR_io_read);
+    else if (LZ4F_readLE32(cBuf + 4) != XXH32_digest(&xxh))
+      err = returnErrorCode(LZ4F_ERROR_contentChecksum_invalid);
+  }
+  free(cBuf);
+  return err;
+}
+
+LZ4F_errorCode_t LZ4F_writeOpenAppend(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr)
+{
+  LZ4F_preferences_t prefs;
+  LZ4F_frameInfo_t frameInfo;
+  long long blocksStart, endMark = 0;
+  LZ4F_errorCode_t ret;
+
+  if (fp == NULL || lz4fWrite == NULL)
+    RETURN_ERROR(parameter_null);
+  if (prefsPtr != NULL) {
+    prefs = *prefsPtr;
+  } else {
+    memset(&prefs, 0, sizeof(prefs));
+  }
+
+  ret = LZ4F_findAppendPoint(fp, &frameInfo, &blocksStart, &endMark);
+  if (LZ4F_isError(ret))
+    return ret;
+  if (blocksStart < 0) {
+    /* empty file : start a frame which can be continued next time */
+    prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    prefs.frameInfo.contentSize = 0;
+    if (LZ4FILE_FSEEK(fp, 0, SEEK_SET) != 0)
+      RETURN_ERROR(io_write);
+    return LZ4F_writeOpen(lz4fWrite, fp, &prefs);
+  }
+
+  prefs.frameInfo = frameInfo;
+  ret = LZ4F_writeOpen_internal(lz4fWrite, fp, &prefs, 1);
+  if (LZ4F_isError(ret))
+    return ret;
+  if (frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled
+    || frameInfo.blockChecksumFlag == LZ4F_blockChecksumEnabled) {
+    ret = LZ4F_appendPriorFrame(*lz4fWrite, blocksStart, endMark, &frameInfo);
+    if (LZ4F_isError(ret)) {
+      LZ4F_freeAndNullWriteFile(lz4fWrite);
+      return ret;
+    }
+  }
+  /* new blocks overwrite EndMark and content checksum */
+  if (LZ4FILE_FSEEK(fp, endMark, SEEK_SET) != 0) {
+    LZ4F_freeAndNullWriteFile(lz4fWrite);
+    RETURN_ERROR(io_write);
+  }
+  return LZ4F_OK_NoError;
+}
+
+LZ4F_errorCode_t LZ4F_writeOpen_MT(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr,
+                                   const LZ4F_Executor* executor, unsigned nbBuffers)
+{
+  LZ4F_preferences_t prefs;
+  LZ4F_preferences_t bufferPrefs;
+  LZ4_byte header[LZ4F_HEADER_SIZE_MAX];
+  LZ4F_errorCode_t ret;
+  unsigned n;
+
+  if (executor != NULL && (executor->submitJob == NULL || executor->completeJobs == NULL))
+    RETURN_ERROR(parameter_invalid);
+  if (nbBuffers == 0)
+    RETURN_ERROR(parameter_invalid);
+
+  if (prefsPtr != NULL) {
+    prefs = *prefsPtr;
+  } else {
+    memset(&prefs, 0, sizeof(prefs));
+  }
+  prefs.frameInfo.blockMode = LZ4F_blockIndependent;   /* required to compress blocks concurrently */
+
+  /* frame header, and structures shared with the serial writer */
+  ret = LZ4F_writeOpen(lz4fWrite, fp, &prefs);
+  if (LZ4F_isError(ret))
+    return ret;
+
+  (*lz4fWrite)->buffers = (LZ4F_writeBuffer_t*)calloc(nbBuffers, sizeof(LZ4F_writeBuffer_t));
+  if ((*lz4fWrite)->buffers == NULL) {
+    LZ4F_freeAndNullWriteFile(lz4fWrite);
+    RETURN_ERROR(allocation_failed);
+  }
+  (*lz4fWrite)->nbBuffers = nbBuffers;
+  if (executor != NULL) {
+    (*lz4fWrite)->executor = *executor;
+    (*lz4fWrite)->hasExecutor = 1;
+  }
+  (*lz4fWrite)->contentChecksum = (prefs.frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled);
+  (*lz4fWrite)->contentSize = prefs.frameInfo.contentSize;
+  XXH32_reset(&(*lz4fWrite)->xxh, 0);
+
+  /* each buffer gets its own context, producing bare blocks : frame-level fields are handled here */
+  bufferPrefs = prefs;
+  bufferPrefs.autoFlush = 1;
+  bufferPrefs.frameInfo.contentChecksumFlag = LZ4F_noContentChecksum;
+  bufferPrefs.frameInfo.contentSize = 0;
+  for (n = 0; n < nbBuffers; n++) {
+    LZ4F_writeBuffer_t* const wb = (*lz4fWrite)->buffers + n;
+    wb->srcBuf = (LZ4_byte*)malloc((*lz4fWrite)->maxWriteSize);
+    wb->dstCapacity = LZ4F_compressBound((*lz4fWrite)->maxWriteSize, &bufferPrefs);
+    wb->dstBuf = (LZ4_byte*)malloc(wb->dstCapacity);
+    if (wb->srcBuf == NULL || wb->dstBuf == NULL) {
+      LZ4F_freeAndNullWriteFile(lz4fWrite);
+      RETURN_ERROR(allocation_failed);
+    }
+    ret = LZ4F_createCompressionContext(&wb->cctxPtr, LZ4F_VERSION);
+    if (!LZ4F_isError(ret))
+      ret = LZ4F_compressBegin(wb->cctxPtr, header, sizeof(header), &bufferPrefs);
+    if (LZ4F_isError(ret)) {
+      LZ4F_freeAndNullWriteFile(lz4fWrite);
+      return ret;
+    }
+  }
+  return LZ4F_OK_NoError;
+}
+
+static void LZ4F_compressBufferJob(void* arg)
+{
+  LZ4F_writeBuffer_t* const wb = (LZ4F_writeBuffer_t*)arg;
+  wb->dstSize = LZ4F_compressUpdate(wb->cctxPtr,
+                                    wb->dstBuf, wb->dstCapacity,
+                                    wb->srcBuf, wb->srcSize,
+                                    NULL);
+  LZ4FILE_STORE_RELEASE(&wb->state, wb_done);
+}
+
+static void LZ4F_submitBuffer(LZ4_writeFile_t* lz4fWrite, LZ4F_writeBuffer_t* wb)
+{
+  wb->state = wb_submitted;
+  if (lz4fWrite->hasExecutor) {
+    lz4fWrite->executor.submitJob(lz4fWrite->executor.opaqueState, LZ4F_compressBufferJob, wb);
+  } else {
+    LZ4F_compressBufferJob(wb);
+  }
+}
+
+/* LZ4F_writeCompleted() :
+ * writes compressed buffers to file, in order, as long as they are completed.
+ * When `wait` is set, waits for all submitted buffers.
+ * @return : 0, or an error code */
+static LZ4F_errorCode_t LZ4F_writeCompleted(LZ4_writeFile_t* lz4fWrite, int wait)
+{
+  while (1) {
+    LZ4F_writeBuffer_t* const wb = lz4fWrite->buffers + lz4fWrite->writeIdx;
+    long state = LZ4FILE_LOAD_ACQUIRE(&wb->state);
+    if (state == wb_free) break;   /* nothing more submitted */
+    if (state != wb_done) {
+      if (!wait && LZ4FILE_HAS_ATOMICS) break;
+      lz4fWrite->executor.completeJobs(lz4fWrite->executor.opaqueState);
+      state = LZ4FILE_LOAD_ACQUIRE(&wb->state);
+      assert(state == wb_done);
+    }
+    if (LZ4F_isError(wb->dstSize)) {
+      lz4fWrite->errCode = wb->dstSize;
+      return wb->dstSize;
+    }
+    if (wb->dstSize != fwrite(wb->dstBuf, 1, wb->dstSize, lz4fWrite->fp)) {
+      lz4fWrite->errCode = returnErrorCode(LZ4F_ERROR_io_write);
+      RETURN_ERROR(io_write);
+    }
+    if (lz4fWrite->contentChecksum)
+      XXH32_update(&lz4fWrite->xxh, wb->srcBuf, wb->srcSize);
+    wb->srcSize = 0;
+    wb->state = wb_free;
+    lz4fWrite->writeIdx = (lz4fWrite->writeIdx + 1) % lz4fWrite->nbBuffers;
+  }
+  return LZ4F_OK_NoError;
+}
+
+static size_t LZ4F_write_MT(LZ4_writeFile_t* lz4fWrite, const void* buf, size_t size)
+{
+  const LZ4_byte* p = (const LZ4_byte*)buf;
+  size_t remain = size;
+
+  while (remain) {
+    LZ4F_writeBuffer_t* wb = lz4fWrite->buffers + lz4fWrite->fillIdx;
+    size_t chunk;
+    if (wb->state != wb_free) {
+      /* all buffers in flight : wait for the oldest one */
+      LZ4F_errorCode_t const err = LZ4F_writeCompleted(lz4fWrite, 1);
+      if (LZ4F_isError(err)) return err;
+      assert(wb->state == wb_free);
+    }
+    chunk = lz4fWrite->maxWriteSize - wb->srcSize;
+    if (chunk > remain) chunk = remain;
+    memcpy(wb->srcBuf + wb->srcSize, p, chunk);
+    wb->srcSize += chunk;
+    p += chunk;
+    remain -= chunk;
+    if (wb->srcSize == lz4fWrite->maxWriteSize) {
+      LZ4F_submitBuffer(lz4fWrite, wb);
+      lz4fWrite->fillIdx = (lz4fWrite->fillIdx + 1) % lz4fWrite->nbBuffers;
+    }
+  }
+  lz4fWrite->totalInSize += size;
+
+  {   LZ4F_errorCode_t const err = LZ4F_writeCompleted(lz4fWrite, 0);
+      if (LZ4F_isError(err)) return err;
+  }
+  return size;
+}
+
+static LZ4F_errorCode_t LZ4F_writeEnd_MT(LZ4_writeFile_t* lz4fWrite)
+{
+  LZ4_byte trailer[8];
+  size_t trailerSize = 4;
+  LZ4F_writeBuffer_t* const wb = lz4fWrite->buffers + lz4fWrite->fillIdx;
+  LZ4F_errorCode_t err;
+
+  if (wb->state == wb_free && wb->srcSize > 0)
+    LZ4F_submitBuffer(lz4fWrite, wb);   /* last, partial block */
+  err = LZ4F_writeCompleted(lz4fWrite, 1);
+  if (LZ4F_isError(err)) return err;
+  if (lz4fWrite->contentSize != 0 && lz4fWrite->contentSize != lz4fWrite->totalInSize)
+    RETURN_ERROR(frameSize_wrong);
+
+  memset(trailer, 0, 4);   /* endMark */
+  if (lz4fWrite->contentChecksum) {
+    XXH32_hash_t const xxh = XXH32_digest(&lz4fWrite->xxh);
+    trailer[4] = (LZ4_byte)xxh;
+    trailer[5] = (LZ4_byte)(xxh >> 8);
+    trailer[6] = (LZ4_byte)(xxh >> 16);
+    trailer[7] = (LZ4_byte)(xxh >> 24);
+    trailerSize += 4;
+  }
+  if (trailerSize != fwrite(trailer, 1, trailerSize, lz4fWrite->fp))
+    RETURN_ERROR(io_write);
+  return LZ4F_OK_NoError;
+}
+
 size_t LZ4F_write(LZ4_writeFile_t* lz4fWrite, const void* buf, size_t size)
 {
   const LZ4_byte* p = (const LZ4_byte*)buf;
@@ -287,6 +1145,8 @@ size_t LZ4F_write(LZ4_writeFile_t* lz4fWrite, const void* buf, size_t size)
 
   if (lz4fWrite == NULL || buf == NULL)
     RETURN_ERROR(parameter_null);
+  if (lz4fWrite->buffers != NULL)
+    return LZ4F_write_MT(lz4fWrite, buf, size);
   while (remain) {
     if (remain > lz4fWrite->maxWriteSize)
       chunk = lz4fWrite->maxWriteSize;
@@ -314,6 +1174,19 @@ size_t LZ4F_write(LZ4_writeFile_t* lz4fWrite, const void* buf, size_t size)
   return size;
 }
 
+LZ4F_errorCode_t LZ4F_writeSetCodec(LZ4_writeFile_t* lz4fWrite, const LZ4F_BlockCodec* codec)
+{
+  if (lz4fWrite == NULL)
+    RETURN_ERROR(parameter_null);
+  LZ4F_setCompressionCodec(lz4fWrite->cctxPtr, codec);
+  if (lz4fWrite->buffers != NULL) {
+    unsigned n;
+    for (n = 0; n < lz4fWrite->nbBuffers; n++)
+      LZ4F_setCompressionCodec(lz4fWrite->buffers[n].cctxPtr, codec);
+  }
+  return LZ4F_OK_NoError;
+}
+
 LZ4F_errorCode_t LZ4F_writeClose(LZ4_writeFile_t* lz4fWrite)
 {
   LZ4F_errorCode_t ret = LZ4F_OK_NoError;
@@ -322,7 +1195,13 @@ LZ4F_errorCode_t LZ4F_writeClose(LZ4_writeFile_t* lz4fWrite)
     RETURN_ERROR(parameter_null);
   }
 
-  if (lz4fWrite->errCode == LZ4F_OK_NoError) {
+  if (lz4fWrite->buffers != NULL) {
+    if (lz4fWrite->errCode == LZ4F_OK_NoError)
+      ret = LZ4F_writeEnd_MT(lz4fWrite);
+    /* jobs still in flight after an error must not outlive their buffers */
+    if (lz4fWrite->hasExecutor)
+      lz4fWrite->executor.completeJobs(lz4fWrite->executor.opaqueState);
+  } else if (lz4fWrite->errCode == LZ4F_OK_NoError) {
     ret =  LZ4F_compressEnd(lz4fWrite->cctxPtr,
                             lz4fWrite->dstBuf, lz4fWrite->dstBufMaxSize,
                             NULL);
@@ -56,9 +56,47 @@ LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_readOpen(LZ4_readFile_t** lz4fRead, FIL
  * `lz4f` must use LZ4_readOpen to set first.
  * `buf` read data buffer.
  * `size` read data buffer size.
+ * Blocks are decoded straight into `buf` when it has room for a whole block.
  */
 LZ4FLIB_STATIC_API size_t LZ4F_read(LZ4_readFile_t* lz4fRead, void* buf, size_t size);
 
+/*! LZ4F_readPeek() :
+ * Expose decoded content in place, without copying it into a caller buffer.
+ * `ptr` receives the position of decoded data, `len` its size.
+ * At least one byte is provided, unless end of file is reached, in which case `len` is 0.
+ * Data remains available, and `ptr` valid, until it is consumed,
+ * using LZ4F_readConsume() or LZ4F_read().
+ * When all provided data has been consumed, next invocation decodes the following block.
+ * @return : 0, or an error code (testable with LZ4F_isError()).
+ */
+LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_readPeek(LZ4_readFile_t* lz4fRead, const void** ptr, size_t* len);
+
+/*! LZ4F_readConsume() :
+ * Mark `size` bytes provided by LZ4F_readPeek() as read.
+ * `size` must be <= `len` returned by the last LZ4F_readPeek(), minus bytes consumed since.
+ * Remaining bytes are provided again by the next LZ4F_readPeek() or LZ4F_read().
+ */
+LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_readConsume(LZ4_readFile_t* lz4fRead, size_t size);
+
+/*! LZ4F_seek() :
+ * Move read position to decompressed position `offset`, within the first frame of the file.
+ * The frame must use independent blocks : frames with linked blocks are refused (blockMode_invalid).
+ * Decoding restarts from the block containing `offset`.
+ * Block positions come from the seek table when the file ends with one (see LZ4F_writeSeekTable()),
+ * otherwise they are indexed the first time they are needed, by reading block headers,
+ * so that later seeks are cheap. Checksums are no longer verified after such a seek.
+ * `fp` must be seekable, except for forward seeks.
+ * Seeking beyond the end of the frame fails (parameter_invalid).
+ * @return : 0, or an error code (testable with LZ4F_isError()).
+ */
+LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_seek(LZ4_readFile_t* lz4fRead, unsigned long long offset);
+
+/*! LZ4F_readSetCodec() :
+ * Decode next blocks with `codec` when possible, see LZ4F_setDecompressionCodec().
+ * `codec` == NULL restores CPU-only decoding.
+ */
+LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_readSetCodec(LZ4_readFile_t* lz4fRead, const LZ4F_BlockCodec* codec);
+
 /*! LZ4F_readClose() :
  * Close lz4file handle.
  * `lz4f` must use LZ4_readOpen to set first.
@@ -72,6 +110,32 @@ LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_readClose(LZ4_readFile_t* lz4fRead);
  */
 LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_writeOpen(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr);
 
+/*! LZ4F_writeOpen_MT() :
+ * Same as LZ4F_writeOpen(), but LZ4F_write() only copies data into one of `nbBuffers` block buffers.
+ * Each full buffer is compressed by a job submitted to `executor`,
+ * while LZ4F_write() keeps accepting data into the next one.
+ * Compressed blocks are written to `fp` in order, as soon as they are completed.
+ * LZ4F_write() only waits when all buffers are in flight.
+ * Blocks are necessarily independent : prefsPtr->frameInfo.blockMode is ignored.
+ * `executor` is optional : when NULL, each block is compressed in the calling thread.
+ */
+LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_writeOpen_MT(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr,
+                                                      const LZ4F_Executor* executor, unsigned nbBuffers);
+
+/*! LZ4F_writeOpenAppend() :
+ * Same as LZ4F_writeOpen(), but continues the last frame of an existing file, instead of starting a new one :
+ * its EndMark and content checksum are overwritten by next blocks, then written again by LZ4F_writeClose().
+ * `fp` must be opened in "r+b" mode, and end with an LZ4 frame using independent blocks,
+ * without content size nor dictID (skippable frames, such as a seek table, can't follow it).
+ * Frame and block headers are read to find the EndMark. When the frame has a content checksum,
+ * its content is also decoded, to rebuild and verify the checksum.
+ * Frame parameters come from the existing frame : `prefsPtr->frameInfo` is ignored,
+ * while other preferences (compressionLevel, autoFlush, etc.) apply to next blocks.
+ * An empty `fp` receives a new frame, with independent blocks and no content size.
+ * The file is left invalid when writing fails before LZ4F_writeClose() completes.
+ */
+LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_writeOpenAppend(LZ4_writeFile_t** lz4fWrite, FILE* fp, const LZ4F_preferences_t* prefsPtr);
+
 /*! LZ4F_write() :
  * Write buffer to lz4file.
  * `lz4f` must use LZ4F_writeOpen to set first.
@@ -80,6 +144,13 @@ LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_writeOpen(LZ4_writeFile_t** lz4fWrite,
  */
 LZ4FLIB_STATIC_API size_t LZ4F_write(LZ4_writeFile_t* lz4fWrite, const void* buf, size_t size);
 
+/*! LZ4F_writeSetCodec() :
+ * Compress next blocks with `codec` when possible, see LZ4F_setCompressionCodec().
+ * With LZ4F_writeOpen_MT(), `codec` is invoked from executor jobs, hence must support concurrent calls.
+ * `codec` == NULL restores CPU-only compression.
+ */
+LZ4FLIB_STATIC_API LZ4F_errorCode_t LZ4F_writeSetCodec(LZ4_writeFile_t* lz4fWrite, const LZ4F_BlockCodec* codec);
+
 /*! LZ4F_writeClose() :
  * Close lz4file handle.
  * `lz4f` must use LZ4F_writeOpen to set first.
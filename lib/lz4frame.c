@@ -62,6 +62,15 @@
 #  define LZ4F_HEAPMODE 0
 #endif
 
+/*
+ * LZ4F_COMPRESSION_STATS :
+ * Support for LZ4F_enableCompressionStats() (1:default).
+ * When 0, statistics code is removed, and LZ4F_enableCompressionStats() returns an error.
+ */
+#ifndef LZ4F_COMPRESSION_STATS
+#  define LZ4F_COMPRESSION_STATS 1
+#endif
+
 
 /*-************************************
 *  Library declarations
@@ -274,11 +283,27 @@ typedef struct LZ4F_cctx_s
     BYTE*  tmpIn;      /* starting position of data compress within internal buffer (>= tmpBuff) */
     size_t tmpInSize;  /* amount of data to compress after tmpIn */
     U64    totalInSize;
+    U32    inputStarted; /* new input was provided since frame start : prior content can no longer be appended */
     XXH32_state_t xxh;
     void*  lz4CtxPtr;
     U16    lz4CtxAlloc; /* sized for: 0 = none, 1 = lz4 ctx, 2 = lz4hc ctx */
     U16    lz4CtxType;  /* in use as: 0 = none, 1 = lz4 ctx, 2 = lz4hc ctx */
+    U32    lz4CtxMemoryUsage;  /* hash table size of lz4 ctx, as initialized : 0 = default */
     LZ4F_BlockCompressMode_e  blockCompressMode;
+    U32*   seekTable;   /* (cSize, dSize) pairs, one per block, when seek table is enabled */
+    size_t seekTableNbBlocks;
+    size_t seekTableCapacity;   /* in nb of blocks */
+    U32    seekTableMode;       /* 0 : disabled ; 1 : recording ; 2 : allocation failed */
+    U32    historyValid;        /* previous frame ended with linked history, see LZ4F_compressBegin_continue() */
+    LZ4F_BlockCodec codec;      /* external block compressor, see LZ4F_setCompressionCodec() */
+    LZ4HC_resume_t pending;     /* pending.srcPos > 0 : block within tmpIn is partially compressed, see LZ4F_compressUpdate_budget() */
+    BYTE*  pendingBuff;         /* compressed content of partially compressed block */
+    size_t pendingBuffSize;
+#if LZ4F_COMPRESSION_STATS
+    U32    statsEnabled;
+    LZ4F_compressionStats stats;
+#endif
+    struct LZ4F_cctx_s* poolNext;   /* link, while idle within a LZ4F_ctxPool */
 } LZ4F_cctx_t;
 
 
@@ -498,7 +523,8 @@ size_t LZ4F_compressFrame(void* dstBuffer, size_t dstCapacity,
     cctx.version = LZ4F_VERSION;
     cctx.maxBufferSize = 5 MB;   /* mess with real buffer size to prevent dynamic allocation; works only because autoflush==1 & stableSrc==1 */
     if ( preferencesPtr == NULL
-      || preferencesPtr->compressionLevel < LZ4HC_CLEVEL_MIN ) {
+      || ( preferencesPtr->compressionLevel < LZ4HC_CLEVEL_MIN
+        && preferencesPtr->memoryUsage == 0 ) ) {
         LZ4_initStream(&lz4ctx, sizeof(lz4ctx));
         cctxPtr->lz4CtxPtr = &lz4ctx;
         cctxPtr->lz4CtxAlloc = 1;
@@ -514,8 +540,7 @@ size_t LZ4F_compressFrame(void* dstBuffer, size_t dstCapacity,
 #if (LZ4F_HEAPMODE)
     LZ4F_freeCompressionContext(cctxPtr);
 #else
-    if ( preferencesPtr != NULL
-      && preferencesPtr->compressionLevel >= LZ4HC_CLEVEL_MIN ) {
+    if (cctxPtr->lz4CtxPtr != &lz4ctx) {
         LZ4F_free(cctxPtr->lz4CtxPtr, cctxPtr->cmem);
     }
 #endif
@@ -523,44 +548,144 @@ size_t LZ4F_compressFrame(void* dstBuffer, size_t dstCapacity,
 }
 
 
+/*-***************************************************
+*   Atomics
+*****************************************************/
+
+/* Critical sections are short (push or pop one list element, build one table) : spin locks are enough,
+ * shared with lz4page.c. Lazily built objects are published with release semantics,
+ * and read with acquire semantics, so that readers only take the lock when the object doesn't exist yet.
+ * Without atomic support, pool accesses must be serialized by the caller (as documented in lz4frame.h),
+ * and CDict tables are built at creation time instead of first use. */
+#include "lz4lock.h"
+#define LZ4F_ATOMICS  LZ4_LOCK_ATOMICS
+#define LZ4F_LOCK(p)   LZ4_spinLock(&(p)->lock)
+#define LZ4F_UNLOCK(p) LZ4_spinUnlock(&(p)->lock)
+#define LZ4F_LOAD_ACQUIRE_PTR(pp)     LZ4_LOAD_ACQUIRE_PTR(pp)
+#define LZ4F_STORE_RELEASE_PTR(pp, v) LZ4_STORE_RELEASE_PTR(pp, v)
+
+
 /*-***************************************************
 *   Dictionary compression
 *****************************************************/
 
+/* Tables are built on first use, by the first compression needing them,
+ * since most users only ever compress with one level family (fast or HC).
+ * They are reached through a pointer, so that they can be built from a const LZ4F_CDict*. */
+typedef struct {
+    long lock;
+    LZ4_stream_t* fastCtx;     /* NULL until first compression at level < LZ4HC_CLEVEL_MIN */
+    LZ4_streamHC_t* HCCtx;     /* NULL until first compression at level >= LZ4HC_CLEVEL_MIN */
+} LZ4F_CDictTables;
+
 struct LZ4F_CDict_s {
     LZ4F_CustomMem cmem;
     void* dictContent;
-    LZ4_stream_t* fastCtx;
-    LZ4_streamHC_t* HCCtx;
+    size_t dictSize;
+    int mapped;                /* content and tables belong to a serialized image, see LZ4F_mapCDict() */
+    LZ4F_CDictTables* tables;  /* == &tablesSpace */
+    LZ4F_CDictTables tablesSpace;
 }; /* typedef'd to LZ4F_CDict within lz4frame_static.h */
 
+static LZ4_stream_t* LZ4F_CDict_buildFastCtx(const LZ4F_CDict* cdict)
+{
+    LZ4_stream_t* const fastCtx = (LZ4_stream_t*)LZ4F_malloc(sizeof(LZ4_stream_t), cdict->cmem);
+    if (fastCtx == NULL) return NULL;
+    LZ4_initStream(fastCtx, sizeof(LZ4_stream_t));
+    LZ4_loadDictSlow(fastCtx, (const char*)cdict->dictContent, (int)cdict->dictSize);
+    return fastCtx;
+}
+
+static LZ4_streamHC_t* LZ4F_CDict_buildHCCtx(const LZ4F_CDict* cdict)
+{
+    LZ4_streamHC_t* const HCCtx = (LZ4_streamHC_t*)LZ4F_malloc(sizeof(LZ4_streamHC_t), cdict->cmem);
+    if (HCCtx == NULL) return NULL;
+    LZ4_initStreamHC(HCCtx, sizeof(LZ4_streamHC_t));
+    LZ4_setCompressionLevel(HCCtx, LZ4HC_CLEVEL_DEFAULT);
+    LZ4_loadDictHC(HCCtx, (const char*)cdict->dictContent, (int)cdict->dictSize);
+    return HCCtx;
+}
+
+/* LZ4F_CDict_fastCtx(), LZ4F_CDict_HCCtx() :
+ * @return : dictionary tables of requested family, built on first call,
+ *           or NULL if they could not be allocated.
+ *  Safe to call concurrently on a shared @cdict : only one thread builds the tables. */
+static const LZ4_stream_t* LZ4F_CDict_fastCtx(const LZ4F_CDict* cdict)
+{
+    LZ4F_CDictTables* const t = cdict->tables;
+    LZ4_stream_t* fastCtx = (LZ4_stream_t*)LZ4F_LOAD_ACQUIRE_PTR(&t->fastCtx);
+    if (fastCtx != NULL) return fastCtx;
+    LZ4F_LOCK(t);
+    fastCtx = t->fastCtx;
+    if (fastCtx == NULL) {
+        DEBUGLOG(4, "LZ4F_CDict_fastCtx : building tables");
+        fastCtx = LZ4F_CDict_buildFastCtx(cdict);
+        LZ4F_STORE_RELEASE_PTR(&t->fastCtx, fastCtx);
+    }
+    LZ4F_UNLOCK(t);
+    return fastCtx;
+}
+
+static const LZ4_streamHC_t* LZ4F_CDict_HCCtx(const LZ4F_CDict* cdict)
+{
+    LZ4F_CDictTables* const t = cdict->tables;
+    LZ4_streamHC_t* HCCtx = (LZ4_streamHC_t*)LZ4F_LOAD_ACQUIRE_PTR(&t->HCCtx);
+    if (HCCtx != NULL) return HCCtx;
+    LZ4F_LOCK(t);
+    HCCtx = t->HCCtx;
+    if (HCCtx == NULL) {
+        DEBUGLOG(4, "LZ4F_CDict_HCCtx : building tables");
+        HCCtx = LZ4F_CDict_buildHCCtx(cdict);
+        LZ4F_STORE_RELEASE_PTR(&t->HCCtx, HCCtx);
+    }
+    LZ4F_UNLOCK(t);
+    return HCCtx;
+}
+
+/* LZ4F_CDict_prepare() :
+ *  ensures tables needed to compress at @level exist,
+ *  so that LZ4F_initStream() can't fail afterwards.
+ * @return : 0, or an error code if tables could not be allocated */
+static size_t LZ4F_CDict_prepare(const LZ4F_CDict* cdict, int level)
+{
+    if (cdict == NULL) return 0;
+    if (level < LZ4HC_CLEVEL_MIN) {
+        RETURN_ERROR_IF(LZ4F_CDict_fastCtx(cdict) == NULL, allocation_failed);
+    } else {
+        RETURN_ERROR_IF(LZ4F_CDict_HCCtx(cdict) == NULL, allocation_failed);
+    }
+    return 0;
+}
+
 LZ4F_CDict*
 LZ4F_createCDict_advanced(LZ4F_CustomMem cmem, const void* dictBuffer, size_t dictSize)
 {
     const char* dictStart = (const char*)dictBuffer;
-    LZ4F_CDict* const cdict = (LZ4F_CDict*)LZ4F_malloc(sizeof(*cdict), cmem);
+    LZ4F_CDict* const cdict = (LZ4F_CDict*)LZ4F_calloc(sizeof(*cdict), cmem);
     DEBUGLOG(4, "LZ4F_createCDict_advanced");
     if (!cdict) return NULL;
     cdict->cmem = cmem;
+    cdict->tables = &cdict->tablesSpace;
     if (dictSize > 64 KB) {
         dictStart += dictSize - 64 KB;
         dictSize = 64 KB;
     }
     cdict->dictContent = LZ4F_malloc(dictSize, cmem);
-    cdict->fastCtx = (LZ4_stream_t*)LZ4F_malloc(sizeof(LZ4_stream_t), cmem);
-    if (cdict->fastCtx)
-        LZ4_initStream(cdict->fastCtx, sizeof(LZ4_stream_t));
-    cdict->HCCtx = (LZ4_streamHC_t*)LZ4F_malloc(sizeof(LZ4_streamHC_t), cmem);
-    if (cdict->HCCtx)
-        LZ4_initStreamHC(cdict->HCCtx, sizeof(LZ4_streamHC_t));
-    if (!cdict->dictContent || !cdict->fastCtx || !cdict->HCCtx) {
+    if (!cdict->dictContent) {
         LZ4F_freeCDict(cdict);
         return NULL;
     }
     memcpy(cdict->dictContent, dictStart, dictSize);
-    LZ4_loadDictSlow(cdict->fastCtx, (const char*)cdict->dictContent, (int)dictSize);
-    LZ4_setCompressionLevel(cdict->HCCtx, LZ4HC_CLEVEL_DEFAULT);
-    LZ4_loadDictHC(cdict->HCCtx, (const char*)cdict->dictContent, (int)dictSize);
+    cdict->dictSize = dictSize;
+#if !LZ4F_ATOMICS
+    /* tables can't be built safely on first use : build them now */
+    cdict->tables->fastCtx = LZ4F_CDict_buildFastCtx(cdict);
+    cdict->tables->HCCtx = LZ4F_CDict_buildHCCtx(cdict);
+    if (!cdict->tables->fastCtx || !cdict->tables->HCCtx) {
+        LZ4F_freeCDict(cdict);
+        return NULL;
+    }
+#endif
     return cdict;
 }
 
@@ -568,6 +693,7 @@ LZ4F_createCDict_advanced(LZ4F_CustomMem cmem, const void* dictBuffer, size_t di
  *  When compressing multiple messages / blocks with the same dictionary, it's recommended to load it just once.
  *  LZ4F_createCDict() will create a digested dictionary, ready to start future compression operations without startup delay.
  *  LZ4F_CDict can be created once and shared by multiple threads concurrently, since its usage is read-only.
+ *  Its tables are built by the first compression needing them (fast or HC levels).
  * @dictBuffer can be released after LZ4F_CDict creation, since its content is copied within CDict
  * @return : digested dictionary for compression, or NULL if failed */
 LZ4F_CDict* LZ4F_createCDict(const void* dictBuffer, size_t dictSize)
@@ -579,12 +705,185 @@ LZ4F_CDict* LZ4F_createCDict(const void* dictBuffer, size_t dictSize)
 void LZ4F_freeCDict(LZ4F_CDict* cdict)
 {
     if (cdict==NULL) return;  /* support free on NULL */
-    LZ4F_free(cdict->dictContent, cdict->cmem);
-    LZ4F_free(cdict->fastCtx, cdict->cmem);
-    LZ4F_free(cdict->HCCtx, cdict->cmem);
+    if (!cdict->mapped) {
+        LZ4F_free(cdict->dictContent, cdict->cmem);
+        LZ4F_free(cdict->tables->fastCtx, cdict->cmem);
+        LZ4F_free(cdict->tables->HCCtx, cdict->cmem);
+    }
     LZ4F_free(cdict, cdict->cmem);
 }
 
+/* Serialized CDict image :
+ *  header (LZ4F_CDICT_HEADER_SIZE bytes, native endianness)
+ *  dictionary content
+ *  LZ4_stream_t, at a page boundary
+ *  LZ4_streamHC_t, at a page boundary
+ * Each table image starts with its pointer fields : they are stored as offsets within the header,
+ * and relocated by LZ4F_mapCDict(). Page alignment ensures that relocation only writes
+ * into the first page of each table, so that, within a private file mapping,
+ * all other pages remain shared between processes. */
+#define LZ4F_CDICT_MAGIC        0x4443345AU   /* "Z4CD", in little endian */
+#define LZ4F_CDICT_HEADER_SIZE  64
+#define LZ4F_CDICT_PAGE_SIZE    4096
+
+typedef struct {
+    U32 magic;
+    U32 libVersion;    /* LZ4_versionNumber() : table layout and hash functions are version specific */
+    U32 ptrSize;
+    U32 fastCtxSize;
+    U32 HCCtxSize;
+    U32 dictSize;
+    U32 dictHash;      /* XXH32 of dictionary content */
+    U32 tablesHash;    /* XXH32 of table images, excluding their pointer fields */
+    U32 fastDictionary;  /* pointer fields, as offsets within dictionary content, + 1 (0 == NULL) */
+    U32 HCEnd;
+    U32 HCPrefixStart;
+    U32 HCDictStart;
+} LZ4F_CDictImageHeader;
+
+#define LZ4F_CDICT_FAST_PTRS_SIZE  offsetof(LZ4_stream_t_internal, currentOffset)
+#define LZ4F_CDICT_HC_PTRS_SIZE    offsetof(LZ4HC_CCtx_internal, dictLimit)
+
+static size_t LZ4F_CDict_alignPage(size_t pos)
+{
+    return (pos + LZ4F_CDICT_PAGE_SIZE - 1) & ~(size_t)(LZ4F_CDICT_PAGE_SIZE - 1);
+}
+
+/* LZ4F_CDict_imageLayout() :
+ * @return : total image size, for a dictionary of @dictSize bytes.
+ *           *fastPosPtr and *HCPosPtr receive positions of table images */
+static size_t LZ4F_CDict_imageLayout(size_t dictSize, size_t* fastPosPtr, size_t* HCPosPtr)
+{
+    size_t const fastPos = LZ4F_CDict_alignPage(LZ4F_CDICT_HEADER_SIZE + dictSize);
+    size_t const HCPos = LZ4F_CDict_alignPage(fastPos + sizeof(LZ4_stream_t));
+    *fastPosPtr = fastPos;
+    *HCPosPtr = HCPos;
+    return HCPos + sizeof(LZ4_streamHC_t);
+}
+
+static U32 LZ4F_CDict_tablesHash(const BYTE* image, size_t fastPos, size_t HCPos)
+{
+    XXH32_state_t xxh;
+    (void)XXH32_reset(&xxh, 0);
+    (void)XXH32_update(&xxh, image + fastPos + LZ4F_CDICT_FAST_PTRS_SIZE, sizeof(LZ4_stream_t) - LZ4F_CDICT_FAST_PTRS_SIZE);
+    (void)XXH32_update(&xxh, image + HCPos + LZ4F_CDICT_HC_PTRS_SIZE, sizeof(LZ4_streamHC_t) - LZ4F_CDICT_HC_PTRS_SIZE);
+    return XXH32_digest(&xxh);
+}
+
+static U32 LZ4F_CDict_ptrToOffset(const BYTE* ptr, const void* dictContent)
+{
+    if (ptr == NULL) return 0;
+    return (U32)(ptr - (const BYTE*)dictContent) + 1;
+}
+
+static const BYTE* LZ4F_CDict_offsetToPtr(U32 offset, const void* dictContent)
+{
+    if (offset == 0) return NULL;
+    return (const BYTE*)dictContent + offset - 1;
+}
+
+size_t LZ4F_serializedCDictSize(const LZ4F_CDict* cdict)
+{
+    size_t fastPos, HCPos;
+    if (cdict == NULL) return 0;
+    return LZ4F_CDict_imageLayout(cdict->dictSize, &fastPos, &HCPos);
+}
+
+size_t LZ4F_serializeCDict(const LZ4F_CDict* cdict, void* dst, size_t dstCapacity)
+{
+    BYTE* const image = (BYTE*)dst;
+    size_t fastPos, HCPos;
+    size_t imageSize;
+    const LZ4_stream_t* fastCtx;
+    const LZ4_streamHC_t* HCCtx;
+    LZ4F_CDictImageHeader header;
+    DEBUGLOG(4, "LZ4F_serializeCDict");
+    RETURN_ERROR_IF(cdict == NULL || dst == NULL, parameter_null);
+    imageSize = LZ4F_CDict_imageLayout(cdict->dictSize, &fastPos, &HCPos);
+    RETURN_ERROR_IF(dstCapacity < imageSize, dstMaxSize_tooSmall);
+    fastCtx = LZ4F_CDict_fastCtx(cdict);
+    HCCtx = LZ4F_CDict_HCCtx(cdict);
+    RETURN_ERROR_IF(fastCtx == NULL || HCCtx == NULL, allocation_failed);
+
+    memset(image, 0, imageSize);
+    memcpy(image + LZ4F_CDICT_HEADER_SIZE, cdict->dictContent, cdict->dictSize);
+    /* pointer fields are left zeroed : they are meaningless outside of this process */
+    memcpy(image + fastPos + LZ4F_CDICT_FAST_PTRS_SIZE, (const BYTE*)fastCtx + LZ4F_CDICT_FAST_PTRS_SIZE,
+           sizeof(LZ4_stream_t) - LZ4F_CDICT_FAST_PTRS_SIZE);
+    memcpy(image + HCPos + LZ4F_CDICT_HC_PTRS_SIZE, (const BYTE*)HCCtx + LZ4F_CDICT_HC_PTRS_SIZE,
+           sizeof(LZ4_streamHC_t) - LZ4F_CDICT_HC_PTRS_SIZE);
+    assert(fastCtx->internal_donotuse.dictCtx == NULL);
+    assert(HCCtx->internal_donotuse.dictCtx == NULL);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = LZ4F_CDICT_MAGIC;
+    header.libVersion = (U32)LZ4_versionNumber();
+    header.ptrSize = (U32)sizeof(void*);
+    header.fastCtxSize = (U32)sizeof(LZ4_stream_t);
+    header.HCCtxSize = (U32)sizeof(LZ4_streamHC_t);
+    header.dictSize = (U32)cdict->dictSize;
+    header.dictHash = XXH32(cdict->dictContent, cdict->dictSize, 0);
+    header.tablesHash = LZ4F_CDict_tablesHash(image, fastPos, HCPos);
+    header.fastDictionary = LZ4F_CDict_ptrToOffset(fastCtx->internal_donotuse.dictionary, cdict->dictContent);
+    header.HCEnd = LZ4F_CDict_ptrToOffset(HCCtx->internal_donotuse.end, cdict->dictContent);
+    header.HCPrefixStart = LZ4F_CDict_ptrToOffset(HCCtx->internal_donotuse.prefixStart, cdict->dictContent);
+    header.HCDictStart = LZ4F_CDict_ptrToOffset(HCCtx->internal_donotuse.dictStart, cdict->dictContent);
+    LZ4F_STATIC_ASSERT(sizeof(header) <= LZ4F_CDICT_HEADER_SIZE);
+    memcpy(image, &header, sizeof(header));
+    return imageSize;
+}
+
+LZ4F_CDict* LZ4F_mapCDict(void* image, size_t imageSize)
+{
+    BYTE* const base = (BYTE*)image;
+    LZ4F_CDictImageHeader header;
+    size_t fastPos, HCPos;
+    LZ4F_CDict* cdict;
+    LZ4_stream_t_internal* fast;
+    LZ4HC_CCtx_internal* hc;
+    DEBUGLOG(4, "LZ4F_mapCDict (%u bytes)", (unsigned)imageSize);
+    if (image == NULL || imageSize < LZ4F_CDICT_HEADER_SIZE) return NULL;
+    if (((size_t)base & (sizeof(void*) - 1)) != 0) return NULL;  /* tables can't be used in place */
+    memcpy(&header, base, sizeof(header));
+    if (header.magic != LZ4F_CDICT_MAGIC
+     || header.libVersion != (U32)LZ4_versionNumber()
+     || header.ptrSize != sizeof(void*)
+     || header.fastCtxSize != sizeof(LZ4_stream_t)
+     || header.HCCtxSize != sizeof(LZ4_streamHC_t)
+     || header.dictSize > 64 KB
+     || header.fastDictionary > header.dictSize + 1
+     || header.HCEnd > header.dictSize + 1
+     || header.HCPrefixStart > header.dictSize + 1
+     || header.HCDictStart > header.dictSize + 1) {
+        DEBUGLOG(4, "LZ4F_mapCDict : image generated by a different library version or platform");
+        return NULL;
+    }
+    if (imageSize < LZ4F_CDict_imageLayout(header.dictSize, &fastPos, &HCPos)) return NULL;
+    if (XXH32(base + LZ4F_CDICT_HEADER_SIZE, header.dictSize, 0) != header.dictHash) return NULL;
+    if (LZ4F_CDict_tablesHash(base, fastPos, HCPos) != header.tablesHash) return NULL;
+
+    cdict = (LZ4F_CDict*)LZ4F_calloc(sizeof(*cdict), LZ4F_defaultCMem);
+    if (cdict == NULL) return NULL;
+    cdict->cmem = LZ4F_defaultCMem;
+    cdict->mapped = 1;
+    cdict->dictContent = base + LZ4F_CDICT_HEADER_SIZE;
+    cdict->dictSize = header.dictSize;
+    cdict->tables = &cdict->tablesSpace;
+    cdict->tables->fastCtx = (LZ4_stream_t*)(void*)(base + fastPos);
+    cdict->tables->HCCtx = (LZ4_streamHC_t*)(void*)(base + HCPos);
+
+    /* relocation */
+    fast = &cdict->tables->fastCtx->internal_donotuse;
+    fast->dictionary = LZ4F_CDict_offsetToPtr(header.fastDictionary, cdict->dictContent);
+    fast->dictCtx = NULL;
+    hc = &cdict->tables->HCCtx->internal_donotuse;
+    hc->end = LZ4F_CDict_offsetToPtr(header.HCEnd, cdict->dictContent);
+    hc->prefixStart = LZ4F_CDict_offsetToPtr(header.HCPrefixStart, cdict->dictContent);
+    hc->dictStart = LZ4F_CDict_offsetToPtr(header.HCDictStart, cdict->dictContent);
+    hc->dictCtx = NULL;
+    return cdict;
+}
+
 
 /*-*********************************
 *  Advanced compression functions
@@ -629,6 +928,9 @@ LZ4F_errorCode_t LZ4F_freeCompressionContext(LZ4F_cctx* cctxPtr)
     if (cctxPtr != NULL) {  /* support free on NULL */
        LZ4F_free(cctxPtr->lz4CtxPtr, cctxPtr->cmem);  /* note: LZ4_streamHC_t and LZ4_stream_t are simple POD types */
        LZ4F_free(cctxPtr->tmpBuff, cctxPtr->cmem);
+       LZ4F_free(cctxPtr->seekTable, cctxPtr->cmem);
+       LZ4F_free(cctxPtr->pendingBuff, cctxPtr->cmem);
+       LZ4HC_resume_release(&cctxPtr->pending);   /* block abandoned while in progress */
        LZ4F_free(cctxPtr, cctxPtr->cmem);
     }
     return LZ4F_OK_NoError;
@@ -657,7 +959,7 @@ static void LZ4F_initStream(void* ctx,
              * would be misguided / wasted work. */
             LZ4_resetStream_fast((LZ4_stream_t*)ctx);
             if (cdict)
-                LZ4_attach_dictionary((LZ4_stream_t*)ctx, cdict->fastCtx);
+                LZ4_attach_dictionary((LZ4_stream_t*)ctx, LZ4F_CDict_fastCtx(cdict));
         }
         /* In these cases, we'll call a one-shot API.
          * The non-continued APIs internally perform their own resets
@@ -667,7 +969,27 @@ static void LZ4F_initStream(void* ctx,
     } else {
         LZ4_resetStreamHC_fast((LZ4_streamHC_t*)ctx, level);
         if (cdict)
-            LZ4_attach_HC_dictionary((LZ4_streamHC_t*)ctx, cdict->HCCtx);
+            LZ4_attach_HC_dictionary((LZ4_streamHC_t*)ctx, LZ4F_CDict_HCCtx(cdict));
+    }
+}
+
+/* LZ4F_fastCtxSize() :
+ * allocation size of a lz4 ctx using a hash table of (1 << memoryUsage) bytes (0 = default).
+ * Never smaller than LZ4_stream_t, so that any fast ctx can be re-initialized with default size. */
+static size_t LZ4F_fastCtxSize(unsigned memoryUsage)
+{
+    size_t const advSize = memoryUsage ? (size_t)LZ4_sizeofStream_advanced((int)memoryUsage) : 0;
+    return (advSize > sizeof(LZ4_stream_t)) ? advSize : sizeof(LZ4_stream_t);
+}
+
+/* LZ4F_initFastCtx() :
+ * @ctx must be at least LZ4F_fastCtxSize(memoryUsage) bytes */
+static void LZ4F_initFastCtx(void* ctx, unsigned memoryUsage)
+{
+    if (memoryUsage) {
+        LZ4_initStream_advanced(ctx, LZ4F_fastCtxSize(memoryUsage), (int)memoryUsage);
+    } else {
+        LZ4_initStream(ctx, sizeof(LZ4_stream_t));
     }
 }
 
@@ -682,6 +1004,100 @@ static int ctxTypeID_to_size(int ctxTypeID) {
     }
 }
 
+/* LZ4F_prepareCtx() :
+ * ensures cctx->lz4CtxPtr is allocated and initialized
+ * for the context type required by cctx->prefs.compressionLevel.
+ * An existing context of the right type is left untouched.
+ * @return : 0, or an error code */
+static size_t LZ4F_prepareCtx(LZ4F_cctx* cctx)
+{   U16 const ctxTypeID = (cctx->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) ? 1 : 2;
+    unsigned const memoryUsage = (ctxTypeID == 1) ? cctx->prefs.memoryUsage : 0;
+    size_t const requiredSize = (ctxTypeID == 1) ? LZ4F_fastCtxSize(memoryUsage) : (size_t)ctxTypeID_to_size(ctxTypeID);
+    size_t allocatedSize = (size_t)ctxTypeID_to_size(cctx->lz4CtxAlloc);
+    if (cctx->lz4CtxAlloc == 1 && cctx->lz4CtxType == 1)
+        allocatedSize = LZ4F_fastCtxSize(cctx->lz4CtxMemoryUsage);
+    if (allocatedSize < requiredSize) {
+        /* not enough space allocated */
+        LZ4F_free(cctx->lz4CtxPtr, cctx->cmem);
+        if (cctx->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) {
+            /* must take ownership of memory allocation,
+             * in order to respect custom allocator contract */
+            cctx->lz4CtxPtr = LZ4F_malloc(requiredSize, cctx->cmem);
+            if (cctx->lz4CtxPtr)
+                LZ4F_initFastCtx(cctx->lz4CtxPtr, memoryUsage);
+        } else {
+            cctx->lz4CtxPtr = LZ4F_malloc(sizeof(LZ4_streamHC_t), cctx->cmem);
+            if (cctx->lz4CtxPtr)
+                LZ4_initStreamHC(cctx->lz4CtxPtr, sizeof(LZ4_streamHC_t));
+        }
+        RETURN_ERROR_IF(cctx->lz4CtxPtr == NULL, allocation_failed);
+        cctx->lz4CtxAlloc = ctxTypeID;
+        cctx->lz4CtxType = ctxTypeID;
+    } else if (cctx->lz4CtxType != ctxTypeID
+            || (ctxTypeID == 1 && cctx->lz4CtxMemoryUsage != memoryUsage)) {
+        /* otherwise, a sufficient buffer is already allocated,
+         * but we need to reset it to the correct context type */
+        if (cctx->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) {
+            LZ4F_initFastCtx(cctx->lz4CtxPtr, memoryUsage);
+        } else {
+            LZ4_initStreamHC((LZ4_streamHC_t*)cctx->lz4CtxPtr, sizeof(LZ4_streamHC_t));
+            LZ4_setCompressionLevel((LZ4_streamHC_t*)cctx->lz4CtxPtr, cctx->prefs.compressionLevel);
+        }
+        cctx->lz4CtxType = ctxTypeID;
+    }
+    cctx->lz4CtxMemoryUsage = memoryUsage;
+    return 0;
+}
+
+/* LZ4F_writeFrameHeader() :
+ * assumption : dstBuffer capacity is >= maxFHSize
+ * @return : size of the frame header written into dstBuffer */
+static size_t LZ4F_writeFrameHeader(void* dstBuffer, const LZ4F_frameInfo_t* frameInfo)
+{
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+
+    /* Magic Number */
+    LZ4F_writeLE32(dstPtr, LZ4F_MAGICNUMBER);
+    dstPtr += 4;
+    {   BYTE* const headerStart = dstPtr;
+
+        /* FLG Byte */
+        *dstPtr++ = (BYTE)(((1 & _2BITS) << 6)    /* Version('01') */
+            + ((frameInfo->blockMode & _1BIT ) << 5)
+            + ((frameInfo->blockChecksumFlag & _1BIT ) << 4)
+            + ((unsigned)(frameInfo->contentSize > 0) << 3)
+            + ((frameInfo->contentChecksumFlag & _1BIT ) << 2)
+            +  (frameInfo->dictID > 0) );
+        /* BD Byte */
+        *dstPtr++ = (BYTE)((frameInfo->blockSizeID & _3BITS) << 4);
+        /* Optional Frame content size field */
+        if (frameInfo->contentSize) {
+            LZ4F_writeLE64(dstPtr, frameInfo->contentSize);
+            dstPtr += 8;
+        }
+        /* Optional dictionary ID field */
+        if (frameInfo->dictID) {
+            LZ4F_writeLE32(dstPtr, frameInfo->dictID);
+            dstPtr += 4;
+        }
+        /* Header CRC Byte */
+        *dstPtr = LZ4F_headerChecksum(headerStart, (size_t)(dstPtr - headerStart));
+        dstPtr++;
+    }
+
+    return (size_t)(dstPtr - dstStart);
+}
+
+/* LZ4F_requiredBuffSize() :
+ * size of @tmpBuff needed to compress a frame with @prefs */
+static size_t LZ4F_requiredBuffSize(const LZ4F_preferences_t* prefs, size_t maxBlockSize)
+{
+    int const linked = (prefs->frameInfo.blockMode == LZ4F_blockLinked);
+    if (prefs->autoFlush) return linked ? 64 KB : 0;   /* only needs past data up to window size */
+    return maxBlockSize + (linked ? 128 KB : 0);
+}
+
 /* LZ4F_compressBegin_internal()
  * Note: only accepts @cdict _or_ @dictBuffer as non NULL.
  */
@@ -692,54 +1108,22 @@ size_t LZ4F_compressBegin_internal(LZ4F_cctx* cctx,
                           const LZ4F_preferences_t* preferencesPtr)
 {
     LZ4F_preferences_t const prefNull = LZ4F_INIT_PREFERENCES;
-    BYTE* const dstStart = (BYTE*)dstBuffer;
-    BYTE* dstPtr = dstStart;
 
     RETURN_ERROR_IF(dstCapacity < maxFHSize, dstMaxSize_tooSmall);
     if (preferencesPtr == NULL) preferencesPtr = &prefNull;
     cctx->prefs = *preferencesPtr;
+    RETURN_ERROR_IF(cctx->prefs.memoryUsage != 0
+                 && LZ4_sizeofStream_advanced((int)cctx->prefs.memoryUsage) == 0, parameter_invalid);
 
     /* cctx Management */
-    {   U16 const ctxTypeID = (cctx->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) ? 1 : 2;
-        int requiredSize = ctxTypeID_to_size(ctxTypeID);
-        int allocatedSize = ctxTypeID_to_size(cctx->lz4CtxAlloc);
-        if (allocatedSize < requiredSize) {
-            /* not enough space allocated */
-            LZ4F_free(cctx->lz4CtxPtr, cctx->cmem);
-            if (cctx->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) {
-                /* must take ownership of memory allocation,
-                 * in order to respect custom allocator contract */
-                cctx->lz4CtxPtr = LZ4F_malloc(sizeof(LZ4_stream_t), cctx->cmem);
-                if (cctx->lz4CtxPtr)
-                    LZ4_initStream(cctx->lz4CtxPtr, sizeof(LZ4_stream_t));
-            } else {
-                cctx->lz4CtxPtr = LZ4F_malloc(sizeof(LZ4_streamHC_t), cctx->cmem);
-                if (cctx->lz4CtxPtr)
-                    LZ4_initStreamHC(cctx->lz4CtxPtr, sizeof(LZ4_streamHC_t));
-            }
-            RETURN_ERROR_IF(cctx->lz4CtxPtr == NULL, allocation_failed);
-            cctx->lz4CtxAlloc = ctxTypeID;
-            cctx->lz4CtxType = ctxTypeID;
-        } else if (cctx->lz4CtxType != ctxTypeID) {
-            /* otherwise, a sufficient buffer is already allocated,
-             * but we need to reset it to the correct context type */
-            if (cctx->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) {
-                LZ4_initStream((LZ4_stream_t*)cctx->lz4CtxPtr, sizeof(LZ4_stream_t));
-            } else {
-                LZ4_initStreamHC((LZ4_streamHC_t*)cctx->lz4CtxPtr, sizeof(LZ4_streamHC_t));
-                LZ4_setCompressionLevel((LZ4_streamHC_t*)cctx->lz4CtxPtr, cctx->prefs.compressionLevel);
-            }
-            cctx->lz4CtxType = ctxTypeID;
-    }   }
+    FORWARD_IF_ERROR(LZ4F_prepareCtx(cctx));
 
     /* Buffer Management */
     if (cctx->prefs.frameInfo.blockSizeID == 0)
         cctx->prefs.frameInfo.blockSizeID = LZ4F_BLOCKSIZEID_DEFAULT;
     cctx->maxBlockSize = LZ4F_getBlockSize(cctx->prefs.frameInfo.blockSizeID);
 
-    {   size_t const requiredBuffSize = preferencesPtr->autoFlush ?
-                ((cctx->prefs.frameInfo.blockMode == LZ4F_blockLinked) ? 64 KB : 0) :  /* only needs past data up to window size */
-                cctx->maxBlockSize + ((cctx->prefs.frameInfo.blockMode == LZ4F_blockLinked) ? 128 KB : 0);
+    {   size_t const requiredBuffSize = LZ4F_requiredBuffSize(&cctx->prefs, cctx->maxBlockSize);
 
         if (cctx->maxBufferSize < requiredBuffSize) {
             cctx->maxBufferSize = 0;
@@ -750,9 +1134,12 @@ size_t LZ4F_compressBegin_internal(LZ4F_cctx* cctx,
     }   }
     cctx->tmpIn = cctx->tmpBuff;
     cctx->tmpInSize = 0;
+    LZ4HC_resume_release(&cctx->pending);   /* previous frame may have been abandoned mid-block */
+    cctx->historyValid = 0;
     (void)XXH32_reset(&(cctx->xxh), 0);
 
     /* context init */
+    FORWARD_IF_ERROR(LZ4F_CDict_prepare(cdict, cctx->prefs.compressionLevel));
     cctx->cdict = cdict;
     if (cctx->prefs.frameInfo.blockMode == LZ4F_blockLinked) {
         /* frame init only for blockLinked : blockIndependent will be init at each block */
@@ -775,39 +1162,12 @@ size_t LZ4F_compressBegin_internal(LZ4F_cctx* cctx,
     }
 
     /* Stage 2 : Write Frame Header */
-
-    /* Magic Number */
-    LZ4F_writeLE32(dstPtr, LZ4F_MAGICNUMBER);
-    dstPtr += 4;
-    {   BYTE* const headerStart = dstPtr;
-
-        /* FLG Byte */
-        *dstPtr++ = (BYTE)(((1 & _2BITS) << 6)    /* Version('01') */
-            + ((cctx->prefs.frameInfo.blockMode & _1BIT ) << 5)
-            + ((cctx->prefs.frameInfo.blockChecksumFlag & _1BIT ) << 4)
-            + ((unsigned)(cctx->prefs.frameInfo.contentSize > 0) << 3)
-            + ((cctx->prefs.frameInfo.contentChecksumFlag & _1BIT ) << 2)
-            +  (cctx->prefs.frameInfo.dictID > 0) );
-        /* BD Byte */
-        *dstPtr++ = (BYTE)((cctx->prefs.frameInfo.blockSizeID & _3BITS) << 4);
-        /* Optional Frame content size field */
-        if (cctx->prefs.frameInfo.contentSize) {
-            LZ4F_writeLE64(dstPtr, cctx->prefs.frameInfo.contentSize);
-            dstPtr += 8;
-            cctx->totalInSize = 0;
-        }
-        /* Optional dictionary ID field */
-        if (cctx->prefs.frameInfo.dictID) {
-            LZ4F_writeLE32(dstPtr, cctx->prefs.frameInfo.dictID);
-            dstPtr += 4;
-        }
-        /* Header CRC Byte */
-        *dstPtr = LZ4F_headerChecksum(headerStart, (size_t)(dstPtr - headerStart));
-        dstPtr++;
-    }
-
+    cctx->totalInSize = 0;
+    cctx->inputStarted = 0;
+    cctx->seekTableNbBlocks = 0;
+    if (cctx->seekTableMode) cctx->seekTableMode = 1;
     cctx->cStage = 1;   /* header written, now request input data block */
-    return (size_t)(dstPtr - dstStart);
+    return LZ4F_writeFrameHeader(dstBuffer, &cctx->prefs.frameInfo);
 }
 
 size_t LZ4F_compressBegin(LZ4F_cctx* cctx,
@@ -857,6 +1217,7 @@ size_t LZ4F_compressBegin_usingCDict(LZ4F_cctx* cctx,
 }
 
 
+
 /*  LZ4F_compressBound() :
  * @return minimum capacity of dstBuffer for a given srcSize to handle worst case scenario.
  *  LZ4F_preferences_t structure is optional : if NULL, preferences will be set to cover worst case scenario.
@@ -874,23 +1235,24 @@ size_t LZ4F_compressBound(size_t srcSize, const LZ4F_preferences_t* preferencesP
 typedef int (*compressFunc_t)(void* ctx, const char* src, char* dst, int srcSize, int dstSize, int level, const LZ4F_CDict* cdict);
 
 
-/*! LZ4F_makeBlock():
- *  compress a single block, add header and optional checksum.
- *  assumption : dst buffer capacity is >= BHSize + srcSize + crcSize
- */
-static size_t LZ4F_makeBlock(void* dst,
-                       const void* src, size_t srcSize,
-                             compressFunc_t compress, void* lz4ctx, int level,
-                       const LZ4F_CDict* cdict,
-                             LZ4F_blockChecksum_t crcFlag)
+/*! LZ4F_hashInput() :
+ *  content checksum is updated as input gets consumed, block after block,
+ *  while it's still in cache, rather than reading the whole input again at the end. */
+static void LZ4F_hashInput(LZ4F_cctx* cctxPtr, const void* src, size_t srcSize)
 {
-    BYTE* const cSizePtr = (BYTE*)dst;
-    U32 cSize;
-    assert(compress != NULL);
-    cSize = (U32)compress(lz4ctx, (const char*)src, (char*)(cSizePtr+BHSize),
-                          (int)(srcSize), (int)(srcSize-1),
-                          level, cdict);
+    if (cctxPtr->prefs.frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled)
+        (void)XXH32_update(&(cctxPtr->xxh), src, srcSize);
+}
 
+/*! LZ4F_closeBlock():
+ *  @cSize bytes of compressed content are already in place after block header at @cSizePtr :
+ *  writes header and optional checksum, or stores @src uncompressed if compression failed or didn't shrink it.
+ * @return : total block size */
+static size_t LZ4F_closeBlock(BYTE* cSizePtr,
+                        const void* src, size_t srcSize,
+                              U32 cSize,
+                              LZ4F_blockChecksum_t crcFlag)
+{
     if (cSize == 0 || cSize >= srcSize) {
         cSize = (U32)srcSize;
         LZ4F_writeLE32(cSizePtr, cSize | LZ4F_BLOCKUNCOMPRESSED_FLAG);
@@ -905,6 +1267,112 @@ static size_t LZ4F_makeBlock(void* dst,
     return BHSize + cSize + ((U32)crcFlag)*BFSize;
 }
 
+/*! LZ4F_makeBlock():
+ *  compress a single block, add header and optional checksum.
+ *  Block is compressed by @codec when provided, unless it declines, in which case @compress is used.
+ *  assumption : dst buffer capacity is >= BHSize + srcSize + crcSize
+ */
+static size_t LZ4F_makeBlock(void* dst,
+                       const void* src, size_t srcSize,
+                             compressFunc_t compress, void* lz4ctx, int level,
+                       const LZ4F_CDict* cdict,
+                       const LZ4F_BlockCodec* codec,
+                             LZ4F_blockChecksum_t crcFlag)
+{
+    BYTE* const cSizePtr = (BYTE*)dst;
+    int const dstCapacity = (int)(srcSize-1);
+    int r = -1;
+    assert(compress != NULL);
+    if (codec != NULL) {
+        r = codec->compressBlock(codec->opaqueState, (const char*)src, (char*)(cSizePtr+BHSize),
+                                 (int)srcSize, dstCapacity, level);
+        if (r > dstCapacity) r = -1;   /* invalid result : don't trust it */
+    }
+    if (r < 0) {
+        r = compress(lz4ctx, (const char*)src, (char*)(cSizePtr+BHSize),
+                     (int)(srcSize), dstCapacity,
+                     level, cdict);
+    }
+    return LZ4F_closeBlock(cSizePtr, src, srcSize, (U32)r, crcFlag);
+}
+
+
+#if LZ4F_COMPRESSION_STATS
+static unsigned LZ4F_statsBucket(size_t value)
+{
+    unsigned bucket = 0;
+    while (value) { bucket++; value >>= 1; }
+    return MIN(bucket, LZ4F_STATS_NBBUCKETS-1);
+}
+
+/*! LZ4F_statsBlock() :
+ *  accounts for block @block (starting with its block header), by parsing its sequences. */
+static void LZ4F_statsBlock(LZ4F_compressionStats* stats, const BYTE* block, size_t cBlockSize, size_t srcSize)
+{
+    U32 const blockHeader = LZ4F_readLE32(block);
+    const BYTE* ip = block + BHSize;
+    const BYTE* const iend = ip + (blockHeader & 0x7FFFFFFFU);
+
+    stats->nbBlocks++;
+    stats->srcSize += srcSize;
+    stats->blocksSize += cBlockSize;
+    if (blockHeader & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
+        stats->nbUncompressedBlocks++;
+        return;
+    }
+    while (ip < iend) {
+        unsigned const token = *ip++;
+        size_t length = token >> 4;
+        if (length == 15) {
+            unsigned s;
+            do { s = (ip < iend) ? *ip++ : 0; length += s; } while (s == 255);
+        }
+        stats->literalsSize += length;
+        stats->litLengths[LZ4F_statsBucket(length)]++;
+        ip += length;
+        if (ip + 2 > iend) break;   /* last literals */
+        {   size_t const offset = (size_t)ip[0] + ((size_t)ip[1] << 8);
+            ip += 2;
+            length = token & 15;
+            if (length == 15) {
+                unsigned s;
+                do { s = (ip < iend) ? *ip++ : 0; length += s; } while (s == 255);
+            }
+            length += 4;   /* minimum match length */
+            stats->nbSequences++;
+            stats->matchesSize += length;
+            stats->matchLengths[LZ4F_statsBucket(length)]++;
+            stats->offsets[LZ4F_statsBucket(offset)]++;
+    }   }
+}
+#endif
+
+/*! LZ4F_recordBlock() :
+ *  registers a block just produced by LZ4F_makeBlock() at @block
+ *  into the seek table and compression statistics, if enabled.
+ *  An allocation failure is only reported by LZ4F_writeSeekTable(). */
+static void LZ4F_recordBlock(LZ4F_cctx_t* cctxPtr, const BYTE* block, size_t cBlockSize, size_t srcSize)
+{
+#if LZ4F_COMPRESSION_STATS
+    if (cctxPtr->statsEnabled) LZ4F_statsBlock(&cctxPtr->stats, block, cBlockSize, srcSize);
+#else
+    (void)block;
+#endif
+    if (cctxPtr->seekTableMode != 1) return;
+    if (cctxPtr->seekTableNbBlocks == cctxPtr->seekTableCapacity) {
+        size_t const newCapacity = cctxPtr->seekTableCapacity ? cctxPtr->seekTableCapacity * 2 : 64;
+        U32* const newTable = (U32*)LZ4F_malloc(newCapacity * 2 * sizeof(U32), cctxPtr->cmem);
+        if (newTable == NULL) { cctxPtr->seekTableMode = 2; return; }
+        if (cctxPtr->seekTableNbBlocks)
+            memcpy(newTable, cctxPtr->seekTable, cctxPtr->seekTableNbBlocks * 2 * sizeof(U32));
+        LZ4F_free(cctxPtr->seekTable, cctxPtr->cmem);
+        cctxPtr->seekTable = newTable;
+        cctxPtr->seekTableCapacity = newCapacity;
+    }
+    cctxPtr->seekTable[2*cctxPtr->seekTableNbBlocks] = (U32)cBlockSize;
+    cctxPtr->seekTable[2*cctxPtr->seekTableNbBlocks+1] = (U32)srcSize;
+    cctxPtr->seekTableNbBlocks++;
+}
 
 static int LZ4F_compressBlock(void* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int level, const LZ4F_CDict* cdict)
 {
@@ -941,13 +1409,85 @@ static int LZ4F_compressBlockHC_continue(void* ctx, const char* src, char* dst,
     return LZ4_compress_HC_continue((LZ4_streamHC_t*)ctx, src, dst, srcSize, dstCapacity);
 }
 
+/*! LZ4F_isIncompressible() :
+ *  Cheap estimation, used to skip compression attempts of blocks which wouldn't shrink.
+ *  Positions are probed with an increasing step, as LZ4 fast mode does when it doesn't find matches,
+ *  and registered into a small hash table.
+ *  Block is considered compressible as soon as matches found this way cover 1/LZ4F_PROBE_MINCOVER of it.
+ *  On incompressible data, the sparse probing costs a small fraction of a compression attempt.
+ * @return : 1 if @src is estimated incompressible */
+#define LZ4F_PROBE_HASHLOG  12
+#define LZ4F_PROBE_MINCOVER 64
+static int LZ4F_isIncompressible(const BYTE* src, size_t srcSize)
+{
+    U32 table[1 << LZ4F_PROBE_HASHLOG];
+    const BYTE* ip = src;
+    const BYTE* const ilimit = src + srcSize - 16;
+    size_t const minCover = srcSize / LZ4F_PROBE_MINCOVER;
+    size_t cover = 0;
+    unsigned searchMatchNb = 1 << 6;
+
+    if (srcSize < 1 KB) return 0;   /* not worth probing */
+    memset(table, 0, sizeof(table));
+    while (ip < ilimit) {
+        U32 sequence, h;
+        const BYTE* match;
+        memcpy(&sequence, ip, sizeof(sequence));
+        h = (sequence * 2654435761U) >> (32 - LZ4F_PROBE_HASHLOG);
+        match = src + table[h];
+        table[h] = (U32)(ip - src);
+        if ((match < ip) && (ip - match <= 65535) && !memcmp(match, ip, 4)) {
+            const BYTE* const start = ip;
+            ip += 4; match += 4;
+            while ((ip < ilimit) && (*ip == *match)) { ip++; match++; }
+            cover += (size_t)(ip - start);
+            if (cover > minCover) return 0;
+            searchMatchNb = 1 << 6;
+        } else {
+            ip += searchMatchNb++ >> 6;
+        }
+    }
+    return 1;
+}
+
+static int LZ4F_compressBlockHC_skipIncompressible(void* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int level, const LZ4F_CDict* cdict)
+{
+    if (LZ4F_isIncompressible((const BYTE*)src, (size_t)srcSize)) {
+        DEBUGLOG(5, "block estimated incompressible : store it uncompressed");
+        return 0;   /* LZ4F_makeBlock() stores block uncompressed */
+    }
+    return LZ4F_compressBlockHC(ctx, src, dst, srcSize, dstCapacity, level, cdict);
+}
+
 static int LZ4F_doNotCompressBlock(void* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int level, const LZ4F_CDict* cdict)
 {
     (void)ctx; (void)src; (void)dst; (void)srcSize; (void)dstCapacity; (void)level; (void)cdict;
     return 0;
 }
 
-static compressFunc_t LZ4F_selectCompression(LZ4F_blockMode_t blockMode, int level, LZ4F_BlockCompressMode_e  compressMode)
+/* LZ4F_cctxCodec() :
+ * @return : codec registered within @cctxPtr, if it can replace @compress for next blocks, or NULL.
+ *  Linked blocks and dictionaries require history, which only exists within the CPU compression context. */
+static const LZ4F_BlockCodec* LZ4F_cctxCodec(const LZ4F_cctx_t* cctxPtr, compressFunc_t compress)
+{
+    if ( (cctxPtr->codec.compressBlock == NULL)
+      || (cctxPtr->prefs.frameInfo.blockMode != LZ4F_blockIndependent)
+      || (cctxPtr->cdict != NULL)
+      || (compress == LZ4F_doNotCompressBlock) )
+        return NULL;
+    return &cctxPtr->codec;
+}
+
+void LZ4F_setCompressionCodec(LZ4F_cctx* cctx, const LZ4F_BlockCodec* codec)
+{
+    if (codec == NULL) {
+        memset(&cctx->codec, 0, sizeof(cctx->codec));
+    } else {
+        cctx->codec = *codec;
+    }
+}
+
+static compressFunc_t LZ4F_selectCompression(LZ4F_blockMode_t blockMode, int level, LZ4F_BlockCompressMode_e  compressMode, unsigned skipIncompressible)
 {
     if (compressMode == LZ4B_UNCOMPRESSED)
         return LZ4F_doNotCompressBlock;
@@ -955,7 +1495,10 @@ static compressFunc_t LZ4F_selectCompression(LZ4F_blockMode_t blockMode, int lev
         if (blockMode == LZ4F_blockIndependent) return LZ4F_compressBlock;
         return LZ4F_compressBlock_continue;
     }
-    if (blockMode == LZ4F_blockIndependent) return LZ4F_compressBlockHC;
+    if (blockMode == LZ4F_blockIndependent) {
+        if (skipIncompressible) return LZ4F_compressBlockHC_skipIncompressible;
+        return LZ4F_compressBlockHC;
+    }
     return LZ4F_compressBlockHC_continue;
 }
 
@@ -967,6 +1510,106 @@ static int LZ4F_localSaveDict(LZ4F_cctx_t* cctxPtr)
     return LZ4_saveDictHC ((LZ4_streamHC_t*)(cctxPtr->lz4CtxPtr), (char*)(cctxPtr->tmpBuff), 64 KB);
 }
 
+/*! LZ4F_setCompressionLevel() :
+ *  Switching between fast and HC contexts with linked blocks
+ *  transfers history through @tmpBuff, followed by buffered input, if any. */
+size_t LZ4F_setCompressionLevel(LZ4F_cctx* cctxPtr, int compressionLevel)
+{
+    U16 const ctxTypeID = (compressionLevel < LZ4HC_CLEVEL_MIN) ? ctxFast : ctxHC;
+    int dictSize = 0;
+    DEBUGLOG(4, "LZ4F_setCompressionLevel (%i)", compressionLevel);
+    RETURN_ERROR_IF(cctxPtr->cStage != 1, compressionState_uninitialized);
+    RETURN_ERROR_IF(cctxPtr->pending.srcPos > 0, compressionState_uninitialized);   /* block in progress must be flushed first */
+
+    if (ctxTypeID == cctxPtr->lz4CtxType) {
+        /* same context type : new level applies from next block */
+        cctxPtr->prefs.compressionLevel = compressionLevel;
+        if (ctxTypeID == ctxHC)
+            LZ4_setCompressionLevel((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, compressionLevel);
+        return 0;
+    }
+    FORWARD_IF_ERROR(LZ4F_CDict_prepare(cctxPtr->cdict, compressionLevel));  /* before any state change */
+
+    if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked) {
+        /* make room for history at beginning of tmpBuff, keeping buffered input after it */
+        if (cctxPtr->tmpInSize > 0 && cctxPtr->tmpIn < cctxPtr->tmpBuff + 64 KB) {
+            assert(cctxPtr->maxBufferSize >= 64 KB + cctxPtr->tmpInSize);
+            memmove(cctxPtr->tmpBuff + 64 KB, cctxPtr->tmpIn, cctxPtr->tmpInSize);
+            cctxPtr->tmpIn = cctxPtr->tmpBuff + 64 KB;
+        }
+        dictSize = LZ4F_localSaveDict(cctxPtr);
+        if (cctxPtr->tmpInSize > 0)
+            memmove(cctxPtr->tmpBuff + dictSize, cctxPtr->tmpIn, cctxPtr->tmpInSize);
+        cctxPtr->tmpIn = cctxPtr->tmpBuff + dictSize;
+    }
+
+    cctxPtr->prefs.compressionLevel = compressionLevel;
+    FORWARD_IF_ERROR(LZ4F_prepareCtx(cctxPtr));
+    assert(cctxPtr->lz4CtxType == ctxTypeID);
+
+    if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked) {
+        if (dictSize == 0) {
+            /* nothing compressed yet */
+            LZ4F_initStream(cctxPtr->lz4CtxPtr, cctxPtr->cdict, compressionLevel, LZ4F_blockLinked);
+        } else if (ctxTypeID == ctxFast) {
+            LZ4_loadDict((LZ4_stream_t*)cctxPtr->lz4CtxPtr, (const char*)cctxPtr->tmpBuff, dictSize);
+        } else {
+            LZ4_setCompressionLevel((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, compressionLevel);
+            LZ4_loadDictHC((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, (const char*)cctxPtr->tmpBuff, dictSize);
+    }   }
+    if (ctxTypeID == ctxHC)
+        LZ4_favorDecompressionSpeed((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, (int)cctxPtr->prefs.favorDecSpeed);
+    return 0;
+}
+
+/*! LZ4F_compressBegin_continue() :
+ *  After a frame with linked blocks, history remains within lz4 state and @tmpBuff :
+ *  when new frame is compatible, both are kept as they are. */
+size_t LZ4F_compressBegin_continue(LZ4F_cctx* cctx,
+                          void* dstBuffer, size_t dstCapacity,
+                          const LZ4F_preferences_t* preferencesPtr)
+{
+    LZ4F_preferences_t const prefNull = LZ4F_INIT_PREFERENCES;
+    LZ4F_preferences_t prefs;
+    U16 ctxTypeID;
+    DEBUGLOG(4, "LZ4F_compressBegin_continue");
+    RETURN_ERROR_IF(dstCapacity < maxFHSize, dstMaxSize_tooSmall);
+    prefs = (preferencesPtr == NULL) ? prefNull : *preferencesPtr;
+    RETURN_ERROR_IF(prefs.frameInfo.blockMode != LZ4F_blockLinked, blockMode_invalid);
+    if (prefs.frameInfo.blockSizeID == 0) prefs.frameInfo.blockSizeID = LZ4F_BLOCKSIZEID_DEFAULT;
+    ctxTypeID = (prefs.compressionLevel < LZ4HC_CLEVEL_MIN) ? ctxFast : ctxHC;
+
+    if ( !cctx->historyValid
+      || cctx->cStage != 0
+      || ctxTypeID != cctx->lz4CtxType
+      || (ctxTypeID == ctxFast && prefs.memoryUsage != cctx->prefs.memoryUsage)
+      || LZ4F_requiredBuffSize(&prefs, LZ4F_getBlockSize(prefs.frameInfo.blockSizeID)) > cctx->maxBufferSize ) {
+        /* history can't be continued in place : start without it */
+        DEBUGLOG(5, "LZ4F_compressBegin_continue : history not reusable");
+        return LZ4F_compressBegin_internal(cctx, dstBuffer, dstCapacity, NULL, 0, NULL, &prefs);
+    }
+
+    /* keep lz4 state, and history within tmpBuff */
+    cctx->prefs = prefs;
+    cctx->maxBlockSize = LZ4F_getBlockSize(prefs.frameInfo.blockSizeID);
+    assert(cctx->tmpInSize == 0);
+    if ((cctx->tmpIn + cctx->maxBlockSize) > (cctx->tmpBuff + cctx->maxBufferSize))
+        cctx->tmpIn = cctx->tmpBuff + LZ4F_localSaveDict(cctx);
+    (void)XXH32_reset(&(cctx->xxh), 0);
+    cctx->cdict = NULL;
+    if (ctxTypeID == ctxHC) {
+        LZ4_setCompressionLevel((LZ4_streamHC_t*)cctx->lz4CtxPtr, prefs.compressionLevel);
+        LZ4_favorDecompressionSpeed((LZ4_streamHC_t*)cctx->lz4CtxPtr, (int)prefs.favorDecSpeed);
+    }
+
+    cctx->totalInSize = 0;
+    cctx->inputStarted = 0;
+    cctx->seekTableNbBlocks = 0;
+    if (cctx->seekTableMode) cctx->seekTableMode = 1;
+    cctx->cStage = 1;
+    return LZ4F_writeFrameHeader(dstBuffer, &cctx->prefs.frameInfo);
+}
+
 typedef enum { notDone, fromTmpBuffer, fromSrcBuffer } LZ4F_lastBlockStatus;
 
 static const LZ4F_compressOptions_t k_cOptionsNull = { 0, { 0, 0, 0 } };
@@ -996,7 +1639,7 @@ static size_t LZ4F_compressUpdateImpl(LZ4F_cctx* cctxPtr,
     BYTE* const dstStart = (BYTE*)dstBuffer;
     BYTE* dstPtr = dstStart;
     LZ4F_lastBlockStatus lastBlockCompressed = notDone;
-    compressFunc_t const compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, blockCompression);
+    compressFunc_t const compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, blockCompression, cctxPtr->prefs.skipIncompressible);
     size_t bytesWritten;
     DEBUGLOG(4, "LZ4F_compressUpdate (srcSize=%zu)", srcSize);
 
@@ -1007,8 +1650,9 @@ static size_t LZ4F_compressUpdateImpl(LZ4F_cctx* cctxPtr,
     if (blockCompression == LZ4B_UNCOMPRESSED && dstCapacity < srcSize)
         RETURN_ERROR(dstMaxSize_tooSmall);
 
-    /* flush currently written block, to continue with new block compression */
-    if (cctxPtr->blockCompressMode != blockCompression) {
+    /* flush currently written block, to continue with new block compression,
+     * or complete block left pending by LZ4F_compressUpdate_budget() */
+    if (cctxPtr->blockCompressMode != blockCompression || LZ4F_compressPending(cctxPtr)) {
         bytesWritten = LZ4F_flush(cctxPtr, dstBuffer, dstCapacity, compressOptionsPtr);
         dstPtr += bytesWritten;
         cctxPtr->blockCompressMode = blockCompression;
@@ -1023,20 +1667,25 @@ static size_t LZ4F_compressUpdateImpl(LZ4F_cctx* cctxPtr,
         if (sizeToCopy > srcSize) {
             /* add src to tmpIn buffer */
             memcpy(cctxPtr->tmpIn + cctxPtr->tmpInSize, srcBuffer, srcSize);
+            LZ4F_hashInput(cctxPtr, srcBuffer, srcSize);
             srcPtr = srcEnd;
             cctxPtr->tmpInSize += srcSize;
-            /* still needs some CRC */
         } else {
             /* complete tmpIn block and then compress it */
             lastBlockCompressed = fromTmpBuffer;
             memcpy(cctxPtr->tmpIn + cctxPtr->tmpInSize, srcBuffer, sizeToCopy);
+            LZ4F_hashInput(cctxPtr, srcBuffer, sizeToCopy);
             srcPtr += sizeToCopy;
 
-            dstPtr += LZ4F_makeBlock(dstPtr,
+            {   size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
                                      cctxPtr->tmpIn, blockSize,
                                      compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
                                      cctxPtr->cdict,
+                                     LZ4F_cctxCodec(cctxPtr, compress),
                                      cctxPtr->prefs.frameInfo.blockChecksumFlag);
+                LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, blockSize);
+                dstPtr += cBlockSize;
+            }
             if (cctxPtr->prefs.frameInfo.blockMode==LZ4F_blockLinked) cctxPtr->tmpIn += blockSize;
             cctxPtr->tmpInSize = 0;
     }   }
@@ -1044,22 +1693,32 @@ static size_t LZ4F_compressUpdateImpl(LZ4F_cctx* cctxPtr,
     while ((size_t)(srcEnd - srcPtr) >= blockSize) {
         /* compress full blocks */
         lastBlockCompressed = fromSrcBuffer;
-        dstPtr += LZ4F_makeBlock(dstPtr,
+        {   size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
                                  srcPtr, blockSize,
                                  compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
                                  cctxPtr->cdict,
+                                 LZ4F_cctxCodec(cctxPtr, compress),
                                  cctxPtr->prefs.frameInfo.blockChecksumFlag);
+            LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, blockSize);
+            dstPtr += cBlockSize;
+        }
+        LZ4F_hashInput(cctxPtr, srcPtr, blockSize);
         srcPtr += blockSize;
     }
 
     if ((cctxPtr->prefs.autoFlush) && (srcPtr < srcEnd)) {
         /* autoFlush : remaining input (< blockSize) is compressed */
         lastBlockCompressed = fromSrcBuffer;
-        dstPtr += LZ4F_makeBlock(dstPtr,
+        {   size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
                                  srcPtr, (size_t)(srcEnd - srcPtr),
                                  compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
                                  cctxPtr->cdict,
+                                 LZ4F_cctxCodec(cctxPtr, compress),
                                  cctxPtr->prefs.frameInfo.blockChecksumFlag);
+            LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, (size_t)(srcEnd - srcPtr));
+            dstPtr += cBlockSize;
+        }
+        LZ4F_hashInput(cctxPtr, srcPtr, (size_t)(srcEnd - srcPtr));
         srcPtr = srcEnd;
     }
 
@@ -1092,13 +1751,12 @@ static size_t LZ4F_compressUpdateImpl(LZ4F_cctx* cctxPtr,
         /* fill tmp buffer */
         size_t const sizeToCopy = (size_t)(srcEnd - srcPtr);
         memcpy(cctxPtr->tmpIn, srcPtr, sizeToCopy);
+        LZ4F_hashInput(cctxPtr, srcPtr, sizeToCopy);
         cctxPtr->tmpInSize = sizeToCopy;
     }
 
-    if (cctxPtr->prefs.frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled)
-        (void)XXH32_update(&(cctxPtr->xxh), srcBuffer, srcSize);
-
     cctxPtr->totalInSize += srcSize;
+    cctxPtr->inputStarted = 1;
     return (size_t)(dstPtr - dstStart);
 }
 
@@ -1146,38 +1804,265 @@ size_t LZ4F_uncompressedUpdate(LZ4F_cctx* cctxPtr,
 }
 
 
-/*! LZ4F_flush() :
- *  When compressed data must be sent immediately, without waiting for a block to be filled,
- *  invoke LZ4_flush(), which will immediately compress any remaining data stored within LZ4F_cctx.
- *  The result of the function is the number of bytes written into dstBuffer.
- *  It can be zero, this means there was no data left within LZ4F_cctx.
- *  The function outputs an error code if it fails (can be tested using LZ4F_isError())
- *  LZ4F_compressOptions_t* is optional. NULL is a valid argument.
- */
-size_t LZ4F_flush(LZ4F_cctx* cctxPtr,
-                  void* dstBuffer, size_t dstCapacity,
-            const LZ4F_compressOptions_t* compressOptionsPtr)
+/* LZ4F_prepareTmpIn() :
+ * makes room for a new block within @tmpIn.
+ * When previous linked block was compressed directly from caller's buffer,
+ * its history is first saved within @tmpBuff, unless caller's buffer remains stable. */
+static void LZ4F_prepareTmpIn(LZ4F_cctx_t* cctxPtr, LZ4F_lastBlockStatus lastBlockCompressed, unsigned stableSrc)
 {
-    BYTE* const dstStart = (BYTE*)dstBuffer;
-    BYTE* dstPtr = dstStart;
-    compressFunc_t compress;
-
-    if (cctxPtr->tmpInSize == 0) return 0;   /* nothing to flush */
+    if (cctxPtr->prefs.frameInfo.blockMode != LZ4F_blockLinked) return;
+    if (lastBlockCompressed == fromSrcBuffer) {
+        if (stableSrc) {
+            cctxPtr->tmpIn = cctxPtr->tmpBuff;
+        } else {
+            cctxPtr->tmpIn = cctxPtr->tmpBuff + LZ4F_localSaveDict(cctxPtr);
+        }
+    }
+    if ((cctxPtr->tmpIn + cctxPtr->maxBlockSize) > (cctxPtr->tmpBuff + cctxPtr->maxBufferSize)) {
+        cctxPtr->tmpIn = cctxPtr->tmpBuff + LZ4F_localSaveDict(cctxPtr);
+    }
+}
+
+/*! LZ4F_compressUpdatev() :
+ *  Same as LZ4F_compressUpdate(), for input scattered across @iovcnt fragments.
+ *  Blocks are cut across fragment boundaries : the result is the same as compressing
+ *  the concatenation of all fragments in a single LZ4F_compressUpdate() call.
+ *  Only data not contained in a single fragment is gathered within @tmpIn.
+ *  Fragments only need to remain valid during the call, unless @stableSrc is set.
+ * @dstCapacity MUST be >= LZ4F_compressBound(totalSize, preferencesPtr). */
+size_t LZ4F_compressUpdatev(LZ4F_cctx* cctxPtr,
+                            void* dstBuffer, size_t dstCapacity,
+                      const LZ4F_iovec* iov, int iovcnt,
+                      const LZ4F_compressOptions_t* compressOptionsPtr)
+{
+    size_t const blockSize = cctxPtr->maxBlockSize;
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+    LZ4F_lastBlockStatus lastBlockCompressed = notDone;
+    compressFunc_t const compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, LZ4B_COMPRESSED, cctxPtr->prefs.skipIncompressible);
+    size_t totalSize = 0;
+    int n;
+    DEBUGLOG(4, "LZ4F_compressUpdatev (iovcnt=%i)", iovcnt);
+
     RETURN_ERROR_IF(cctxPtr->cStage != 1, compressionState_uninitialized);
-    RETURN_ERROR_IF(dstCapacity < (cctxPtr->tmpInSize + BHSize + BFSize), dstMaxSize_tooSmall);
-    (void)compressOptionsPtr;   /* not useful (yet) */
+    RETURN_ERROR_IF(iovcnt < 0, parameter_invalid);
+    RETURN_ERROR_IF(iov == NULL && iovcnt > 0, parameter_null);
+    for (n = 0; n < iovcnt; n++) totalSize += iov[n].iov_len;
+    if (dstCapacity < LZ4F_compressBound_internal(totalSize, &(cctxPtr->prefs), cctxPtr->tmpInSize))
+        RETURN_ERROR(dstMaxSize_tooSmall);
+    if (compressOptionsPtr == NULL) compressOptionsPtr = &k_cOptionsNull;
 
-    /* select compression function */
-    compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, cctxPtr->blockCompressMode);
+    /* flush currently written block, to continue with new block compression,
+     * or complete block left pending by LZ4F_compressUpdate_budget() */
+    if (cctxPtr->blockCompressMode != LZ4B_COMPRESSED || LZ4F_compressPending(cctxPtr)) {
+        dstPtr += LZ4F_flush(cctxPtr, dstBuffer, dstCapacity, compressOptionsPtr);
+        cctxPtr->blockCompressMode = LZ4B_COMPRESSED;
+    }
 
-    /* compress tmp buffer */
-    dstPtr += LZ4F_makeBlock(dstPtr,
-                             cctxPtr->tmpIn, cctxPtr->tmpInSize,
-                             compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
-                             cctxPtr->cdict,
-                             cctxPtr->prefs.frameInfo.blockChecksumFlag);
-    assert(((void)"flush overflows dstBuffer!", (size_t)(dstPtr - dstStart) <= dstCapacity));
+    for (n = 0; n < iovcnt; n++) {
+        const BYTE* srcPtr = (const BYTE*)iov[n].iov_base;
+        const BYTE* const srcEnd = srcPtr + iov[n].iov_len;
+        int const lastFragment = (n == iovcnt - 1);
+
+        while (srcPtr < srcEnd) {
+            size_t const srcSize = (size_t)(srcEnd - srcPtr);
+            size_t sizeToCopy;
+            if (cctxPtr->tmpInSize == 0
+              && ( (srcSize >= blockSize)
+                || (lastFragment && cctxPtr->prefs.autoFlush) )) {
+                /* block entirely within fragment : compress it in place */
+                size_t const bSize = MIN(srcSize, blockSize);
+                size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
+                                     srcPtr, bSize,
+                                     compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
+                                     cctxPtr->cdict,
+                                     LZ4F_cctxCodec(cctxPtr, compress),
+                                     cctxPtr->prefs.frameInfo.blockChecksumFlag);
+                LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, bSize);
+                LZ4F_hashInput(cctxPtr, srcPtr, bSize);
+                dstPtr += cBlockSize;
+                srcPtr += bSize;
+                lastBlockCompressed = fromSrcBuffer;
+                continue;
+            }
+
+            /* gather into tmpIn */
+            if (cctxPtr->tmpInSize == 0) {
+                LZ4F_prepareTmpIn(cctxPtr, lastBlockCompressed, compressOptionsPtr->stableSrc);
+                lastBlockCompressed = notDone;
+            }
+            sizeToCopy = MIN(srcSize, blockSize - cctxPtr->tmpInSize);
+            memcpy(cctxPtr->tmpIn + cctxPtr->tmpInSize, srcPtr, sizeToCopy);
+            LZ4F_hashInput(cctxPtr, srcPtr, sizeToCopy);
+            cctxPtr->tmpInSize += sizeToCopy;
+            srcPtr += sizeToCopy;
 
+            if (cctxPtr->tmpInSize == blockSize) {
+                size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
+                                     cctxPtr->tmpIn, blockSize,
+                                     compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
+                                     cctxPtr->cdict,
+                                     LZ4F_cctxCodec(cctxPtr, compress),
+                                     cctxPtr->prefs.frameInfo.blockChecksumFlag);
+                LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, blockSize);
+                dstPtr += cBlockSize;
+                if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked) cctxPtr->tmpIn += blockSize;
+                cctxPtr->tmpInSize = 0;
+                lastBlockCompressed = fromTmpBuffer;
+            }
+        }
+    }
+
+    if (cctxPtr->prefs.autoFlush && cctxPtr->tmpInSize > 0) {
+        /* autoFlush : data gathered from last fragments is compressed */
+        size_t const flushed = LZ4F_flush(cctxPtr, dstPtr, dstCapacity - (size_t)(dstPtr - dstStart), compressOptionsPtr);
+        FORWARD_IF_ERROR(flushed);
+        dstPtr += flushed;
+    } else if (cctxPtr->tmpInSize == 0) {
+        /* leave history in a state valid for next invocation */
+        LZ4F_prepareTmpIn(cctxPtr, lastBlockCompressed, compressOptionsPtr->stableSrc);
+    }
+
+    cctxPtr->totalInSize += totalSize;
+    cctxPtr->inputStarted = 1;
+    return (size_t)(dstPtr - dstStart);
+}
+
+/* LZ4F_compressBlock_destSize() :
+ *  compresses as much of @src as fits into @dstCapacity bytes, as a single block payload.
+ *  The fast mode has no streaming destSize variant : its cut block is compressed
+ *  independently of history and dictionary, which remains a valid block in any frame.
+ * @return : compressed size, or 0 if nothing could be compressed,
+ *  *srcSizePtr is updated to the amount of input consumed. */
+static int LZ4F_compressBlock_destSize(LZ4F_cctx_t* cctxPtr, const char* src, char* dst, int* srcSizePtr, int dstCapacity)
+{
+    int const level = cctxPtr->prefs.compressionLevel;
+    if (level < LZ4HC_CLEVEL_MIN) {
+        int const acceleration = (level < 0) ? -level + 1 : 1;
+        int const cSize = LZ4_compress_destSize_extState(cctxPtr->lz4CtxPtr, src, dst, srcSizePtr, dstCapacity, acceleration);
+        /* LZ4_compress_destSize_extState() leaves the state unusable for next blocks */
+        LZ4F_initFastCtx(cctxPtr->lz4CtxPtr, cctxPtr->lz4CtxMemoryUsage);
+        return cSize;
+    }
+    if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockIndependent)
+        LZ4F_initStream(cctxPtr->lz4CtxPtr, cctxPtr->cdict, level, LZ4F_blockIndependent);
+    return LZ4_compress_HC_continue_destSize((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, src, dst, srcSizePtr, dstCapacity);
+}
+
+/* LZ4F_reloadHistory() :
+ *  linked blocks : after a cut block, the compression context may reference input it didn't consume.
+ *  History is rebuilt within @tmpBuff, from previous history (@dictSize bytes at beginning of @tmpBuff)
+ *  followed by the @consumed bytes at @src, and reloaded into the context. */
+static void LZ4F_reloadHistory(LZ4F_cctx_t* cctxPtr, int dictSize, const BYTE* src, size_t consumed)
+{
+    size_t const keep = MIN((size_t)dictSize + consumed, 64 KB);
+    BYTE* const hist = cctxPtr->tmpBuff;
+    assert(cctxPtr->maxBufferSize >= 64 KB);
+    if (consumed >= keep) {
+        memcpy(hist, src + consumed - keep, keep);
+    } else {
+        memmove(hist, hist + (size_t)dictSize - (keep - consumed), keep - consumed);
+        memcpy(hist + keep - consumed, src, consumed);
+    }
+    if (cctxPtr->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) {
+        LZ4_loadDict((LZ4_stream_t*)cctxPtr->lz4CtxPtr, (const char*)hist, (int)keep);
+    } else {
+        LZ4_loadDictHC((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, (const char*)hist, (int)keep);
+        LZ4_setCompressionLevel((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel);
+        LZ4_favorDecompressionSpeed((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr, (int)cctxPtr->prefs.favorDecSpeed);
+    }
+    cctxPtr->tmpIn = hist + keep;
+}
+
+/*! LZ4F_compressUpdate_destSize() :
+ *  Fills @dstCapacity with complete blocks, as long as they fit whatever their compressibility,
+ *  then cuts a last block using the destSize variants, so that output fills @dstCapacity.
+ *  Input is never buffered : data which doesn't fit is left to the caller.
+ *  A last block which can't shrink input is stored uncompressed. */
+size_t LZ4F_compressUpdate_destSize(LZ4F_cctx* cctxPtr,
+                                    void* dstBuffer, size_t dstCapacity,
+                              const void* srcBuffer, size_t* srcSizePtr,
+                              const LZ4F_compressOptions_t* compressOptionsPtr)
+{
+    size_t const blockSize = cctxPtr->maxBlockSize;
+    size_t const crcSize = (size_t)cctxPtr->prefs.frameInfo.blockChecksumFlag * BFSize;
+    const BYTE* const srcStart = (const BYTE*)srcBuffer;
+    const BYTE* srcPtr = srcStart;
+    const BYTE* srcEnd;
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+    BYTE* const dstEnd = dstStart + dstCapacity;
+    LZ4F_lastBlockStatus lastBlockCompressed = notDone;
+    int cut = 0;
+    compressFunc_t const compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, LZ4B_COMPRESSED, cctxPtr->prefs.skipIncompressible);
+
+    RETURN_ERROR_IF(srcSizePtr == NULL, parameter_null);
+    DEBUGLOG(4, "LZ4F_compressUpdate_destSize (srcSize=%zu, dstCapacity=%zu)", *srcSizePtr, dstCapacity);
+    RETURN_ERROR_IF(cctxPtr->cStage != 1, compressionState_uninitialized);
+    RETURN_ERROR_IF(cctxPtr->tmpInSize > 0, compressionState_uninitialized);   /* buffered input must be flushed first */
+    RETURN_ERROR_IF(srcBuffer == NULL && *srcSizePtr > 0, parameter_null);
+    if (compressOptionsPtr == NULL) compressOptionsPtr = &k_cOptionsNull;
+    cctxPtr->blockCompressMode = LZ4B_COMPRESSED;
+    srcEnd = srcStart + *srcSizePtr;
+
+    while ((srcPtr < srcEnd) && ((size_t)(dstEnd - dstPtr) > BHSize + crcSize)) {
+        size_t const bSize = MIN((size_t)(srcEnd - srcPtr), blockSize);
+        size_t const payloadCapacity = (size_t)(dstEnd - dstPtr) - BHSize - crcSize;
+
+        if (payloadCapacity >= bSize) {
+            /* full block : fits even if stored uncompressed */
+            size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
+                                 srcPtr, bSize,
+                                 compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
+                                 cctxPtr->cdict,
+                                 LZ4F_cctxCodec(cctxPtr, compress),
+                                 cctxPtr->prefs.frameInfo.blockChecksumFlag);
+            LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, bSize);
+            LZ4F_hashInput(cctxPtr, srcPtr, bSize);
+            dstPtr += cBlockSize;
+            srcPtr += bSize;
+            lastBlockCompressed = fromSrcBuffer;
+            continue;
+        }
+
+        /* block which may not fit : cut to fill remaining capacity */
+        {   int const dictSize = (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked) ? LZ4F_localSaveDict(cctxPtr) : 0;
+            int consumed = (int)bSize;
+            U32 cSize = (U32)LZ4F_compressBlock_destSize(cctxPtr, (const char*)srcPtr, (char*)(dstPtr+BHSize), &consumed, (int)payloadCapacity);
+            if (cSize == 0 || (size_t)consumed <= payloadCapacity) {
+                /* storing raw input consumes more */
+                cSize = (U32)payloadCapacity;
+                consumed = (int)payloadCapacity;
+                LZ4F_writeLE32(dstPtr, cSize | LZ4F_BLOCKUNCOMPRESSED_FLAG);
+                memcpy(dstPtr+BHSize, srcPtr, payloadCapacity);
+            } else {
+                LZ4F_writeLE32(dstPtr, cSize);
+            }
+            if (crcSize) LZ4F_writeLE32(dstPtr+BHSize+cSize, XXH32(dstPtr+BHSize, cSize, 0));
+            LZ4F_recordBlock(cctxPtr, dstPtr, BHSize + cSize + crcSize, (size_t)consumed);
+            if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked)
+                LZ4F_reloadHistory(cctxPtr, dictSize, srcPtr, (size_t)consumed);
+            LZ4F_hashInput(cctxPtr, srcPtr, (size_t)consumed);
+            dstPtr += BHSize + cSize + crcSize;
+            srcPtr += consumed;
+            if ((size_t)consumed < bSize) { cut = 1; break; }
+            lastBlockCompressed = fromTmpBuffer;   /* whole block compressed : continue, with history within @tmpBuff */
+    }   }
+
+    /* leave history in a state valid for next invocation */
+    if (!cut) LZ4F_prepareTmpIn(cctxPtr, lastBlockCompressed, compressOptionsPtr->stableSrc);
+
+    cctxPtr->totalInSize += (U64)(srcPtr - srcStart);
+    cctxPtr->inputStarted = 1;
+    *srcSizePtr = (size_t)(srcPtr - srcStart);
+    assert(dstPtr <= dstEnd);
+    return (size_t)(dstPtr - dstStart);
+}
+
+/* LZ4F_releaseTmpIn() :
+ *  block within @tmpIn has been compressed : make room for next one. */
+static void LZ4F_releaseTmpIn(LZ4F_cctx_t* cctxPtr)
+{
     if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked)
         cctxPtr->tmpIn += cctxPtr->tmpInSize;
     cctxPtr->tmpInSize = 0;
@@ -1187,7 +2072,239 @@ size_t LZ4F_flush(LZ4F_cctx* cctxPtr,
         int const realDictSize = LZ4F_localSaveDict(cctxPtr);
         cctxPtr->tmpIn = cctxPtr->tmpBuff + realDictSize;
     }
+}
+
+/*! LZ4F_compressTmpIn_budget() :
+ *  compresses block within @tmpIn, parsing about @budget bytes of input.
+ *  Only HC levels can stop before the end of the block : it then remains pending within @tmpIn,
+ *  while its compressed content accumulates within @pendingBuff.
+ * @return : size written into @dstPtr, header and checksum included, once block is complete,
+ *           0 while it's still in progress, or an error code */
+static size_t LZ4F_compressTmpIn_budget(LZ4F_cctx_t* cctxPtr, BYTE* dstPtr, int budget)
+{
+    size_t const srcSize = cctxPtr->tmpInSize;
+    int cSize;
+    assert(srcSize > 0);
+    assert(cctxPtr->blockCompressMode == LZ4B_COMPRESSED);
+
+    if (cctxPtr->pending.srcPos == 0) {
+        compressFunc_t const compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, LZ4B_COMPRESSED, cctxPtr->prefs.skipIncompressible);
+        if ( (cctxPtr->prefs.compressionLevel < LZ4HC_CLEVEL_MIN)
+          || (LZ4F_cctxCodec(cctxPtr, compress) != NULL)
+          || (compress == LZ4F_compressBlockHC_skipIncompressible && LZ4F_isIncompressible(cctxPtr->tmpIn, srcSize)) ) {
+            /* can't be interrupted, or cheap : whole block at once */
+            size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
+                                 cctxPtr->tmpIn, srcSize,
+                                 compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
+                                 cctxPtr->cdict,
+                                 LZ4F_cctxCodec(cctxPtr, compress),
+                                 cctxPtr->prefs.frameInfo.blockChecksumFlag);
+            LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, srcSize);
+            return cBlockSize;
+        }
+        if (cctxPtr->pendingBuffSize < cctxPtr->maxBlockSize) {
+            LZ4F_free(cctxPtr->pendingBuff, cctxPtr->cmem);
+            cctxPtr->pendingBuffSize = 0;
+            cctxPtr->pendingBuff = (BYTE*)LZ4F_malloc(cctxPtr->maxBlockSize, cctxPtr->cmem);
+            RETURN_ERROR_IF(cctxPtr->pendingBuff == NULL, allocation_failed);
+            cctxPtr->pendingBuffSize = cctxPtr->maxBlockSize;
+        }
+        if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockIndependent)
+            LZ4F_initStream(cctxPtr->lz4CtxPtr, cctxPtr->cdict, cctxPtr->prefs.compressionLevel, LZ4F_blockIndependent);
+    }
+
+    cSize = LZ4_compress_HC_continue_budget((LZ4_streamHC_t*)cctxPtr->lz4CtxPtr,
+                        (const char*)cctxPtr->tmpIn, (char*)cctxPtr->pendingBuff,
+                        (int)srcSize, (int)srcSize - 1,
+                        &cctxPtr->pending, budget);
+    if (cSize < 0) return 0;   /* in progress */
+    if (cSize > 0) memcpy(dstPtr + BHSize, cctxPtr->pendingBuff, (size_t)cSize);
+    {   size_t const cBlockSize = LZ4F_closeBlock(dstPtr, cctxPtr->tmpIn, srcSize, (U32)cSize, cctxPtr->prefs.frameInfo.blockChecksumFlag);
+        LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, srcSize);
+        return cBlockSize;
+    }
+}
+
+int LZ4F_compressPending(const LZ4F_cctx* cctxPtr)
+{
+    return (cctxPtr->pending.srcPos > 0)
+        || (cctxPtr->tmpInSize > 0 && cctxPtr->tmpInSize == cctxPtr->maxBlockSize);
+}
+
+/*! LZ4F_compressUpdate_budget() :
+ *  Input goes through @tmpIn, one block at a time, so that a block in progress remains available across invocations.
+ *  Input is only consumed while there is no block in progress. */
+size_t LZ4F_compressUpdate_budget(LZ4F_cctx* cctxPtr,
+                                  void* dstBuffer, size_t dstCapacity,
+                            const void* srcBuffer, size_t* srcSizePtr,
+                                  size_t budget,
+                            const LZ4F_compressOptions_t* compressOptionsPtr)
+{
+    size_t const blockSize = cctxPtr->maxBlockSize;
+    const BYTE* const srcStart = (const BYTE*)srcBuffer;
+    const BYTE* srcPtr = srcStart;
+    const BYTE* srcEnd;
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+
+    RETURN_ERROR_IF(srcSizePtr == NULL, parameter_null);
+    DEBUGLOG(4, "LZ4F_compressUpdate_budget (srcSize=%zu, budget=%zu)", *srcSizePtr, budget);
+    RETURN_ERROR_IF(cctxPtr->cStage != 1, compressionState_uninitialized);
+    RETURN_ERROR_IF(srcBuffer == NULL && *srcSizePtr > 0, parameter_null);
+    if (dstCapacity < LZ4F_compressBound_internal(*srcSizePtr, &(cctxPtr->prefs), cctxPtr->tmpInSize))
+        RETURN_ERROR(dstMaxSize_tooSmall);
+    srcEnd = srcStart + *srcSizePtr;
+
+    /* flush currently written block, to continue with new block compression */
+    if (cctxPtr->blockCompressMode != LZ4B_COMPRESSED) {
+        size_t const flushed = LZ4F_flush(cctxPtr, dstBuffer, dstCapacity, compressOptionsPtr);
+        FORWARD_IF_ERROR(flushed);
+        dstPtr += flushed;
+        cctxPtr->blockCompressMode = LZ4B_COMPRESSED;
+    }
 
+    while (1) {
+        if (cctxPtr->pending.srcPos == 0) {
+            /* gather input for next block */
+            size_t const sizeToCopy = MIN(blockSize - cctxPtr->tmpInSize, (size_t)(srcEnd - srcPtr));
+            if (sizeToCopy > 0) {
+                memcpy(cctxPtr->tmpIn + cctxPtr->tmpInSize, srcPtr, sizeToCopy);
+                LZ4F_hashInput(cctxPtr, srcPtr, sizeToCopy);
+                srcPtr += sizeToCopy;
+                cctxPtr->tmpInSize += sizeToCopy;
+            }
+            if (cctxPtr->tmpInSize == 0) break;
+            if (cctxPtr->tmpInSize < blockSize
+              && !(cctxPtr->prefs.autoFlush && srcPtr == srcEnd) )
+                break;   /* wait for more input */
+        }
+        if (budget == 0) break;
+
+        {   size_t const remaining = cctxPtr->tmpInSize - (size_t)cctxPtr->pending.srcPos;
+            size_t const cBlockSize = LZ4F_compressTmpIn_budget(cctxPtr, dstPtr, (int)MIN(budget, INT_MAX));
+            FORWARD_IF_ERROR(cBlockSize);
+            if (cBlockSize == 0) break;   /* budget exhausted within block */
+            dstPtr += cBlockSize;
+            budget -= MIN(budget, remaining);
+            LZ4F_releaseTmpIn(cctxPtr);
+    }   }
+
+    cctxPtr->totalInSize += (U64)(srcPtr - srcStart);
+    cctxPtr->inputStarted = 1;
+    *srcSizePtr = (size_t)(srcPtr - srcStart);
+    return (size_t)(dstPtr - dstStart);
+}
+
+/*! LZ4F_appendBlock() :
+ *  Block is copied as is, hence it must be valid for the frame being written :
+ *  independent blocks, same block size limit, same dictionary. */
+size_t LZ4F_appendBlock(LZ4F_cctx* cctxPtr,
+                        void* dstBuffer, size_t dstCapacity,
+                  const void* block, size_t blockSize,
+                  const void* decoded, size_t decodedSize)
+{
+    BYTE* const dstPtr = (BYTE*)dstBuffer;
+    size_t const crcSize = (size_t)cctxPtr->prefs.frameInfo.blockChecksumFlag * BFSize;
+    U32 blockHeader;
+    size_t cSize;
+
+    RETURN_ERROR_IF(cctxPtr->cStage != 1, compressionState_uninitialized);
+    RETURN_ERROR_IF(cctxPtr->tmpInSize > 0, compressionState_uninitialized);   /* buffered input must be flushed first */
+    RETURN_ERROR_IF(cctxPtr->prefs.frameInfo.blockMode != LZ4F_blockIndependent, blockMode_invalid);
+    RETURN_ERROR_IF(block == NULL, parameter_null);
+    RETURN_ERROR_IF(blockSize < BHSize, srcPtr_wrong);
+    blockHeader = LZ4F_readLE32(block);
+    cSize = blockHeader & 0x7FFFFFFFU;
+    RETURN_ERROR_IF(cSize == 0, srcPtr_wrong);   /* end mark */
+    RETURN_ERROR_IF(BHSize + cSize != blockSize, srcPtr_wrong);
+    RETURN_ERROR_IF(decodedSize > cctxPtr->maxBlockSize || cSize > cctxPtr->maxBlockSize, maxBlockSize_invalid);
+    RETURN_ERROR_IF((blockHeader & LZ4F_BLOCKUNCOMPRESSED_FLAG) && (cSize != decodedSize), srcPtr_wrong);
+    RETURN_ERROR_IF(dstCapacity < blockSize + crcSize, dstMaxSize_tooSmall);
+    if (cctxPtr->prefs.frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled) {
+        RETURN_ERROR_IF(decoded == NULL && decodedSize > 0, parameter_null);
+        (void)XXH32_update(&(cctxPtr->xxh), decoded, decodedSize);
+    }
+
+    memcpy(dstPtr, block, blockSize);
+    if (crcSize) LZ4F_writeLE32(dstPtr + blockSize, XXH32(dstPtr + BHSize, cSize, 0));
+    LZ4F_recordBlock(cctxPtr, dstPtr, blockSize + crcSize, decodedSize);
+    cctxPtr->totalInSize += decodedSize;
+    cctxPtr->inputStarted = 1;
+    return blockSize + crcSize;
+}
+
+/*! LZ4F_compressBegin_append() :
+ *  Independent blocks don't depend on previous ones, so continuing a frame only needs
+ *  the same frame parameters, and the content checksum state, rebuilt by LZ4F_appendPriorContent(). */
+size_t LZ4F_compressBegin_append(LZ4F_cctx* cctx, const LZ4F_preferences_t* preferencesPtr)
+{
+    BYTE header[LZ4F_HEADER_SIZE_MAX];
+    DEBUGLOG(4, "LZ4F_compressBegin_append");
+    RETURN_ERROR_IF(preferencesPtr == NULL, parameter_null);
+    RETURN_ERROR_IF(preferencesPtr->frameInfo.blockMode != LZ4F_blockIndependent, blockMode_invalid);
+    RETURN_ERROR_IF(preferencesPtr->frameInfo.frameType == LZ4F_skippableFrame, parameter_invalid);
+    RETURN_ERROR_IF(preferencesPtr->frameInfo.contentSize != 0, parameter_invalid);
+    RETURN_ERROR_IF(preferencesPtr->frameInfo.dictID != 0, parameter_invalid);
+    RETURN_ERROR_IF(cctx->seekTableMode != 0, parameter_invalid);   /* table would only index new blocks */
+    /* header is generated as usual, then dropped : the existing frame keeps its own */
+    FORWARD_IF_ERROR(LZ4F_compressBegin_internal(cctx, header, sizeof(header), NULL, 0, NULL, preferencesPtr));
+    return 0;
+}
+
+size_t LZ4F_appendPriorContent(LZ4F_cctx* cctxPtr, const void* content, size_t contentSize)
+{
+    RETURN_ERROR_IF(cctxPtr->cStage != 1, compressionState_uninitialized);
+    RETURN_ERROR_IF(cctxPtr->inputStarted, compressionState_uninitialized);   /* prior content must come before new input */
+    RETURN_ERROR_IF(content == NULL && contentSize > 0, parameter_null);
+    LZ4F_hashInput(cctxPtr, content, contentSize);
+    cctxPtr->totalInSize += contentSize;
+    return 0;
+}
+
+/*! LZ4F_flush() :
+ *  When compressed data must be sent immediately, without waiting for a block to be filled,
+ *  invoke LZ4_flush(), which will immediately compress any remaining data stored within LZ4F_cctx.
+ *  The result of the function is the number of bytes written into dstBuffer.
+ *  It can be zero, this means there was no data left within LZ4F_cctx.
+ *  The function outputs an error code if it fails (can be tested using LZ4F_isError())
+ *  LZ4F_compressOptions_t* is optional. NULL is a valid argument.
+ */
+size_t LZ4F_flush(LZ4F_cctx* cctxPtr,
+                  void* dstBuffer, size_t dstCapacity,
+            const LZ4F_compressOptions_t* compressOptionsPtr)
+{
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+    compressFunc_t compress;
+
+    if (cctxPtr->tmpInSize == 0) return 0;   /* nothing to flush */
+    RETURN_ERROR_IF(cctxPtr->cStage != 1, compressionState_uninitialized);
+    RETURN_ERROR_IF(dstCapacity < (cctxPtr->tmpInSize + BHSize + BFSize), dstMaxSize_tooSmall);
+    (void)compressOptionsPtr;   /* not useful (yet) */
+
+    if (cctxPtr->pending.srcPos > 0) {
+        /* block started by LZ4F_compressUpdate_budget() : complete it */
+        size_t const cBlockSize = LZ4F_compressTmpIn_budget(cctxPtr, dstPtr, INT_MAX);
+        FORWARD_IF_ERROR(cBlockSize);
+        assert(cBlockSize > 0);
+        dstPtr += cBlockSize;
+    } else {
+        /* select compression function */
+        compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, cctxPtr->blockCompressMode, cctxPtr->prefs.skipIncompressible);
+
+        /* compress tmp buffer */
+        {   size_t const cBlockSize = LZ4F_makeBlock(dstPtr,
+                                 cctxPtr->tmpIn, cctxPtr->tmpInSize,
+                                 compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
+                                 cctxPtr->cdict,
+                                 LZ4F_cctxCodec(cctxPtr, compress),
+                                 cctxPtr->prefs.frameInfo.blockChecksumFlag);
+            LZ4F_recordBlock(cctxPtr, dstPtr, cBlockSize, cctxPtr->tmpInSize);
+            dstPtr += cBlockSize;
+    }   }
+    assert(((void)"flush overflows dstBuffer!", (size_t)(dstPtr - dstStart) <= dstCapacity));
+
+    LZ4F_releaseTmpIn(cctxPtr);
     return (size_t)(dstPtr - dstStart);
 }
 
@@ -1229,6 +2346,7 @@ size_t LZ4F_compressEnd(LZ4F_cctx* cctxPtr,
     }
 
     cctxPtr->cStage = 0;   /* state is now re-usable (with identical preferences) */
+    cctxPtr->historyValid = (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked);
 
     if (cctxPtr->prefs.frameInfo.contentSize) {
         if (cctxPtr->prefs.frameInfo.contentSize != cctxPtr->totalInSize)
@@ -1239,6 +2357,272 @@ size_t LZ4F_compressEnd(LZ4F_cctx* cctxPtr,
 }
 
 
+/*-***************************************************
+*   Seek table
+*****************************************************/
+
+/* Seek table layout (skippable frame, appended after the frame it indexes) :
+ *  - magic number LZ4F_SEEKTABLE_MAGICNUMBER (4 bytes)
+ *  - skippable frame size (4 bytes)
+ *  - one entry per block : compressed block size, including block header and checksum (4 bytes)
+ *                          decompressed block size (4 bytes)
+ *  - footer : nb of entries (4 bytes), descriptor (1 byte, reserved, must be zero),
+ *             LZ4F_SEEKTABLE_FOOTER_MAGIC (4 bytes)
+ *  All fields are little-endian. The footer is last, so the table can be located from the end of data. */
+
+size_t LZ4F_enableSeekTable(LZ4F_cctx* cctx, unsigned enable)
+{
+    RETURN_ERROR_IF(cctx->cStage != 0, compressionState_uninitialized);   /* must be set before LZ4F_compressBegin() */
+    cctx->seekTableMode = (enable != 0);
+    cctx->seekTableNbBlocks = 0;
+    return 0;
+}
+
+size_t LZ4F_seekTableSize(const LZ4F_cctx* cctx)
+{
+    if (cctx->seekTableMode == 0) return 0;
+    return 8 + cctx->seekTableNbBlocks * LZ4F_SEEKTABLE_ENTRY_SIZE + LZ4F_SEEKTABLE_FOOTER_SIZE;
+}
+
+size_t LZ4F_writeSeekTable(LZ4F_cctx* cctx, void* dstBuffer, size_t dstCapacity)
+{
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+    size_t const tableSize = LZ4F_seekTableSize(cctx);
+    size_t n;
+
+    RETURN_ERROR_IF(cctx->seekTableMode == 0, parameter_invalid);
+    RETURN_ERROR_IF(cctx->seekTableMode == 2, allocation_failed);
+    RETURN_ERROR_IF(cctx->cStage != 0, compressionState_uninitialized);   /* frame must be completed by LZ4F_compressEnd() */
+    RETURN_ERROR_IF(cctx->seekTableNbBlocks > 0xFFFFFFFFU, seekTable_invalid);
+    RETURN_ERROR_IF(dstCapacity < tableSize, dstMaxSize_tooSmall);
+
+    LZ4F_writeLE32(dstPtr, LZ4F_SEEKTABLE_MAGICNUMBER); dstPtr += 4;
+    LZ4F_writeLE32(dstPtr, (U32)(tableSize - 8)); dstPtr += 4;
+    for (n=0; n<cctx->seekTableNbBlocks; n++) {
+        LZ4F_writeLE32(dstPtr, cctx->seekTable[2*n]); dstPtr += 4;
+        LZ4F_writeLE32(dstPtr, cctx->seekTable[2*n+1]); dstPtr += 4;
+    }
+    LZ4F_writeLE32(dstPtr, (U32)cctx->seekTableNbBlocks); dstPtr += 4;
+    *dstPtr++ = 0;   /* descriptor : reserved */
+    LZ4F_writeLE32(dstPtr, LZ4F_SEEKTABLE_FOOTER_MAGIC); dstPtr += 4;
+
+    assert((size_t)(dstPtr - dstStart) == tableSize);
+    return tableSize;
+}
+
+
+/*-***************************************************
+*   Compression statistics
+*****************************************************/
+
+size_t LZ4F_enableCompressionStats(LZ4F_cctx* cctx, unsigned enable)
+{
+    RETURN_ERROR_IF(cctx == NULL, parameter_null);
+#if LZ4F_COMPRESSION_STATS
+    cctx->statsEnabled = (enable != 0);
+    MEM_INIT(&cctx->stats, 0, sizeof(cctx->stats));
+    return 0;
+#else
+    (void)enable;
+    RETURN_ERROR(parameter_invalid);
+#endif
+}
+
+size_t LZ4F_getCompressionStats(const LZ4F_cctx* cctx, LZ4F_compressionStats* stats)
+{
+    RETURN_ERROR_IF(cctx == NULL || stats == NULL, parameter_null);
+#if LZ4F_COMPRESSION_STATS
+    RETURN_ERROR_IF(!cctx->statsEnabled, parameter_invalid);
+    *stats = cctx->stats;
+    return 0;
+#else
+    RETURN_ERROR(parameter_invalid);
+#endif
+}
+
+
+/*-***************************************************
+*   Parallel frame compression
+*****************************************************/
+
+#define LZ4F_MT_SEGMENT_SIZE (4 MB)   /* each job should be "sufficiently large"; multiple of all block sizes */
+
+typedef struct {
+    const BYTE* src;
+    size_t srcSize;
+    BYTE*  dst;          /* reserved slot, large enough for worst case */
+    size_t blockSize;
+    const LZ4F_preferences_t* prefs;
+    void*  lz4ctx;       /* allocated by the calling thread, initialized by the job */
+    size_t result;       /* compressed size, or an error code */
+} LZ4F_MTSegment;
+
+typedef struct {
+    const void* src;
+    size_t srcSize;
+    U32 xxh;
+} LZ4F_MTChecksum;
+
+/* compress a segment of consecutive independent blocks, using its own state */
+static void LZ4F_compressSegment(void* arg)
+{
+    LZ4F_MTSegment* const seg = (LZ4F_MTSegment*)arg;
+    int const level = seg->prefs->compressionLevel;
+    compressFunc_t const compress = LZ4F_selectCompression(LZ4F_blockIndependent, level, LZ4B_COMPRESSED, seg->prefs->skipIncompressible);
+    const BYTE* srcPtr = seg->src;
+    const BYTE* const srcEnd = srcPtr + seg->srcSize;
+    BYTE* dstPtr = seg->dst;
+    void* const lz4ctx = seg->lz4ctx;
+
+    if (level < LZ4HC_CLEVEL_MIN) {
+        LZ4F_initFastCtx(lz4ctx, seg->prefs->memoryUsage);
+    } else {
+        LZ4_initStreamHC(lz4ctx, sizeof(LZ4_streamHC_t));
+        LZ4_favorDecompressionSpeed((LZ4_streamHC_t*)lz4ctx, (int)seg->prefs->favorDecSpeed);
+    }
+
+    while (srcPtr < srcEnd) {
+        size_t const blockSize = MIN(seg->blockSize, (size_t)(srcEnd - srcPtr));
+        dstPtr += LZ4F_makeBlock(dstPtr, srcPtr, blockSize,
+                                 compress, lz4ctx, level,
+                                 NULL, NULL, seg->prefs->frameInfo.blockChecksumFlag);
+        srcPtr += blockSize;
+    }
+
+    seg->result = (size_t)(dstPtr - seg->dst);
+}
+
+static void LZ4F_checksumContent(void* arg)
+{
+    LZ4F_MTChecksum* const csj = (LZ4F_MTChecksum*)arg;
+    csj->xxh = XXH32(csj->src, csj->srcSize, 0);
+}
+
+static void LZ4F_runJob(const LZ4F_Executor* executor, LZ4F_JobFunction job, void* jobArg)
+{
+    if (executor == NULL) {
+        job(jobArg);
+    } else {
+        executor->submitJob(executor->opaqueState, job, jobArg);
+    }
+}
+
+/*! LZ4F_compressFrame_MT_advanced() :
+ *  Each segment of LZ4F_MT_SEGMENT_SIZE bytes is compressed by its own job,
+ *  directly into a reserved slot of dstBuffer, sized for worst case.
+ *  Once all jobs are completed, slots are compacted and the frame is finalized.
+ *  Content checksum is calculated by a separate job, concurrently with compression.
+ *  All allocations happen in the calling thread, before jobs start :
+ *  jobs never invoke @cmem, so it doesn't need to be thread-safe.
+ */
+size_t LZ4F_compressFrame_MT_advanced(LZ4F_CustomMem cmem,
+                       void* dstBuffer, size_t dstCapacity,
+                       const void* srcBuffer, size_t srcSize,
+                       const LZ4F_preferences_t* preferencesPtr,
+                       const LZ4F_Executor* executor)
+{
+    LZ4F_preferences_t prefs;
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+    LZ4F_MTChecksum csj;
+    LZ4F_MTSegment* segments;
+    size_t blockSize, slotSize, ctxSize, nbSegments, n;
+    size_t result = 0;
+
+    DEBUGLOG(4, "LZ4F_compressFrame_MT_advanced (srcSize=%u)", (unsigned)srcSize);
+    RETURN_ERROR_IF(executor != NULL && (executor->submitJob == NULL || executor->completeJobs == NULL), parameter_invalid);
+    if (preferencesPtr!=NULL)
+        prefs = *preferencesPtr;
+    else
+        MEM_INIT(&prefs, 0, sizeof(prefs));
+    RETURN_ERROR_IF(prefs.memoryUsage != 0
+                 && LZ4_sizeofStream_advanced((int)prefs.memoryUsage) == 0, parameter_invalid);
+    if (prefs.frameInfo.contentSize != 0)
+        prefs.frameInfo.contentSize = (U64)srcSize;   /* auto-correct content size if selected (!=0) */
+    prefs.frameInfo.blockSizeID = LZ4F_optimalBSID(prefs.frameInfo.blockSizeID, srcSize);
+    if (prefs.frameInfo.blockSizeID == 0)
+        prefs.frameInfo.blockSizeID = LZ4F_BLOCKSIZEID_DEFAULT;
+    prefs.frameInfo.blockMode = LZ4F_blockIndependent;   /* required to compress blocks concurrently */
+    prefs.autoFlush = 1;
+
+    blockSize = LZ4F_getBlockSize(prefs.frameInfo.blockSizeID);
+    FORWARD_IF_ERROR(blockSize);
+    RETURN_ERROR_IF(dstCapacity < LZ4F_compressFrameBound(srcSize, &prefs), dstMaxSize_tooSmall);
+    assert(LZ4F_MT_SEGMENT_SIZE % blockSize == 0);
+    slotSize = (LZ4F_MT_SEGMENT_SIZE / blockSize) * (blockSize + BHSize + BFSize * prefs.frameInfo.blockChecksumFlag);
+    nbSegments = (srcSize + LZ4F_MT_SEGMENT_SIZE - 1) / LZ4F_MT_SEGMENT_SIZE;
+    segments = (LZ4F_MTSegment*)LZ4F_calloc((nbSegments+1) * sizeof(*segments), cmem);
+    RETURN_ERROR_IF(segments == NULL, allocation_failed);
+    ctxSize = (prefs.compressionLevel < LZ4HC_CLEVEL_MIN) ? LZ4F_fastCtxSize(prefs.memoryUsage) : sizeof(LZ4_streamHC_t);
+    for (n=0; n<nbSegments; n++) {
+        segments[n].lz4ctx = LZ4F_malloc(ctxSize, cmem);
+        if (segments[n].lz4ctx == NULL) {
+            result = LZ4F_returnErrorCode(LZ4F_ERROR_allocation_failed);
+            break;
+    }   }
+    if (LZ4F_isError(result)) {
+        for (n=0; n<nbSegments; n++) LZ4F_free(segments[n].lz4ctx, cmem);
+        LZ4F_free(segments, cmem);
+        return result;
+    }
+
+    dstPtr += LZ4F_writeFrameHeader(dstPtr, &prefs.frameInfo);
+
+    /* start jobs */
+    csj.src = srcBuffer;
+    csj.srcSize = srcSize;
+    csj.xxh = 0;
+    if (prefs.frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled)
+        LZ4F_runJob(executor, LZ4F_checksumContent, &csj);
+    for (n=0; n<nbSegments; n++) {
+        size_t const segStart = n * LZ4F_MT_SEGMENT_SIZE;
+        segments[n].src = (const BYTE*)srcBuffer + segStart;
+        segments[n].srcSize = MIN(LZ4F_MT_SEGMENT_SIZE, srcSize - segStart);
+        segments[n].dst = dstPtr + n * slotSize;
+        segments[n].blockSize = blockSize;
+        segments[n].prefs = &prefs;
+        segments[n].result = 0;
+        LZ4F_runJob(executor, LZ4F_compressSegment, segments + n);
+    }
+    if (executor != NULL)
+        executor->completeJobs(executor->opaqueState);
+
+    /* compact segments */
+    for (n=0; n<nbSegments; n++) {
+        if (LZ4F_isError(segments[n].result)) {
+            result = segments[n].result;
+            break;
+        }
+        memmove(dstPtr, segments[n].dst, segments[n].result);
+        dstPtr += segments[n].result;
+    }
+    for (n=0; n<nbSegments; n++) LZ4F_free(segments[n].lz4ctx, cmem);
+    LZ4F_free(segments, cmem);
+    FORWARD_IF_ERROR(result);
+
+    /* endMark */
+    LZ4F_writeLE32(dstPtr, 0);
+    dstPtr += 4;
+    if (prefs.frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled) {
+        LZ4F_writeLE32(dstPtr, csj.xxh);
+        dstPtr += 4;
+    }
+
+    assert(dstPtr <= dstStart + dstCapacity);
+    return (size_t)(dstPtr - dstStart);
+}
+
+size_t LZ4F_compressFrame_MT(void* dstBuffer, size_t dstCapacity,
+                       const void* srcBuffer, size_t srcSize,
+                       const LZ4F_preferences_t* preferencesPtr,
+                       const LZ4F_Executor* executor)
+{
+    return LZ4F_compressFrame_MT_advanced(LZ4F_defaultCMem,
+                dstBuffer, dstCapacity, srcBuffer, srcSize, preferencesPtr, executor);
+}
+
+
 /*-***************************************************
 *   Frame Decompression
 *****************************************************/
@@ -1269,13 +2653,26 @@ struct LZ4F_dctx_s {
     BYTE*  tmpOutBuffer;
     const BYTE* dict;
     size_t dictSize;
+    const BYTE* extDict;     /* older history segment, only used with a ring buffer */
+    size_t extDictSize;
+    const BYTE* ringStart;   /* output ring buffer, NULL if none */
+    size_t ringSize;
+    const LZ4F_DDict* ddict;          /* dictionary of current frame, NULL if none */
+    BYTE*  ddictScratch;              /* copy of ddict content, followed by room for one block */
+    size_t ddictScratchSize;
+    const LZ4F_DDict* ddictLoaded;    /* ddict which content is currently within ddictScratch */
+    U32    ddictLoadedHash;
     BYTE*  tmpOut;
     size_t tmpOutSize;
     size_t tmpOutStart;
     XXH32_state_t xxh;
     XXH32_state_t blockChecksum;
     int    skipChecksum;
+    U32    keepHistory;   /* set during LZ4F_decompress_continue() */
+    size_t histSize;      /* history kept from previous frames, at beginning of tmpOutBuffer */
+    LZ4F_BlockCodec codec;   /* external block decoder, see LZ4F_setDecompressionCodec() */
     BYTE   header[LZ4F_HEADER_SIZE_MAX];
+    LZ4F_dctx* poolNext;   /* link, while idle within a LZ4F_ctxPool */
 };  /* typedef'd to LZ4F_dctx in lz4frame.h */
 
 
@@ -1315,6 +2712,7 @@ LZ4F_errorCode_t LZ4F_freeDecompressionContext(LZ4F_dctx* dctx)
       result = (LZ4F_errorCode_t)dctx->dStage;
       LZ4F_free(dctx->tmpIn, dctx->cmem);
       LZ4F_free(dctx->tmpOutBuffer, dctx->cmem);
+      LZ4F_free(dctx->ddictScratch, dctx->cmem);
       LZ4F_free(dctx, dctx->cmem);
     }
     return result;
@@ -1322,16 +2720,128 @@ LZ4F_errorCode_t LZ4F_freeDecompressionContext(LZ4F_dctx* dctx)
 
 
 /*==---   Streaming Decompression operations   ---==*/
-void LZ4F_resetDecompressionContext(LZ4F_dctx* dctx)
+
+/* LZ4F_resetFrameState() :
+ *  prepares @dctx for a new frame. History kept for LZ4F_decompress_continue() is preserved. */
+static void LZ4F_resetFrameState(LZ4F_dctx* dctx)
 {
-    DEBUGLOG(5, "LZ4F_resetDecompressionContext");
     dctx->dStage = dstage_getFrameHeader;
     dctx->dict = NULL;
     dctx->dictSize = 0;
+    dctx->extDict = NULL;
+    dctx->extDictSize = 0;
+    dctx->ddict = NULL;
     dctx->skipChecksum = 0;
     dctx->frameRemainingSize = 0;
 }
 
+void LZ4F_resetDecompressionContext(LZ4F_dctx* dctx)
+{
+    DEBUGLOG(5, "LZ4F_resetDecompressionContext");
+    LZ4F_resetFrameState(dctx);
+    dctx->histSize = 0;
+}
+
+void LZ4F_setDecoderRingBuffer(LZ4F_dctx* dctx, const void* ringBuffer, size_t ringSize)
+{
+    DEBUGLOG(5, "LZ4F_setDecoderRingBuffer (ringSize=%u)", (unsigned)ringSize);
+    dctx->ringStart = (ringSize > 0) ? (const BYTE*)ringBuffer : NULL;
+    dctx->ringSize = (dctx->ringStart != NULL) ? ringSize : 0;
+}
+
+void LZ4F_setDecompressionCodec(LZ4F_dctx* dctx, const LZ4F_BlockCodec* codec)
+{
+    if (codec == NULL) {
+        memset(&dctx->codec, 0, sizeof(dctx->codec));
+    } else {
+        dctx->codec = *codec;
+    }
+}
+
+/* LZ4F_decodeWithCodec() :
+ *  decodes a block without history, using the codec registered within @dctx.
+ * @return : decoded size, or < 0 if the codec declined or failed : block must then be decoded by the CPU */
+static int LZ4F_decodeWithCodec(const LZ4F_dctx* dctx, const BYTE* src, BYTE* dst, int srcSize, int dstCapacity)
+{
+    int r;
+    if (dctx->codec.decompressBlock == NULL) return -1;
+    r = dctx->codec.decompressBlock(dctx->codec.opaqueState, (const char*)src, (char*)dst, srcSize, dstCapacity);
+    return (r > dstCapacity) ? -1 : r;   /* invalid result : don't trust it */
+}
+
+
+/*! LZ4F_allocDecodingBuffers() :
+ *  ensures internal buffers are large enough for current frame parameters.
+ * @return : 0, or an error code */
+static size_t LZ4F_allocDecodingBuffers(LZ4F_dctx* dctx)
+{
+    size_t const bufferNeeded = dctx->maxBlockSize
+        + ((dctx->frameInfo.blockMode==LZ4F_blockLinked) ? 128 KB : 0);
+    if (bufferNeeded > dctx->maxBufferSize) {   /* tmp buffers too small */
+        BYTE* const oldOutBuffer = dctx->tmpOutBuffer;
+        dctx->maxBufferSize = 0;   /* ensure allocation will be re-attempted on next entry*/
+        LZ4F_free(dctx->tmpIn, dctx->cmem);
+        dctx->tmpIn = (BYTE*)LZ4F_malloc(dctx->maxBlockSize + BFSize /* block checksum */, dctx->cmem);
+        RETURN_ERROR_IF(dctx->tmpIn == NULL, allocation_failed);
+        dctx->tmpOutBuffer= (BYTE*)LZ4F_malloc(bufferNeeded, dctx->cmem);
+        if (dctx->tmpOutBuffer != NULL && dctx->dict == oldOutBuffer && oldOutBuffer != NULL) {
+            /* history of previous frames, see LZ4F_decompress_continue() */
+            memcpy(dctx->tmpOutBuffer, oldOutBuffer, dctx->dictSize);
+            dctx->dict = dctx->tmpOutBuffer;
+        }
+        LZ4F_free(oldOutBuffer, dctx->cmem);
+        RETURN_ERROR_IF(dctx->tmpOutBuffer== NULL, allocation_failed);
+        dctx->maxBufferSize = bufferNeeded;
+    }
+    return 0;
+}
+
+
+/*! LZ4F_parseFrameHeader() :
+ *  decodes a complete header of a regular frame, which size is @frameHeaderSize,
+ *  as determined by LZ4F_headerSize(), into @frameInfo.
+ * @return : 0, or an error code (testable with LZ4F_isError()) */
+static size_t LZ4F_parseFrameHeader(LZ4F_frameInfo_t* frameInfo, const BYTE* srcPtr, size_t frameHeaderSize)
+{
+    U32 const FLG = srcPtr[4];
+    U32 const version = (FLG>>6) & _2BITS;
+    U32 const blockChecksumFlag = (FLG>>4) & _1BIT;
+    U32 const blockMode = (FLG>>5) & _1BIT;
+    U32 const contentSizeFlag = (FLG>>3) & _1BIT;
+    U32 const contentChecksumFlag = (FLG>>2) & _1BIT;
+    U32 const dictIDFlag = FLG & _1BIT;
+    U32 const BD = srcPtr[5];
+    U32 const blockSizeID = (BD>>4) & _3BITS;
+
+    /* validate */
+    if (((FLG>>1)&_1BIT) != 0) RETURN_ERROR(reservedFlag_set); /* Reserved bit */
+    if (version != 1) RETURN_ERROR(headerVersion_wrong);       /* Version Number, only supported value */
+    assert(frameHeaderSize == minFHSize + (contentSizeFlag?8:0) + (dictIDFlag?4:0));
+    if (((BD>>7)&_1BIT) != 0) RETURN_ERROR(reservedFlag_set);   /* Reserved bit */
+    if (blockSizeID < 4) RETURN_ERROR(maxBlockSize_invalid);    /* 4-7 only supported values for the time being */
+    if (((BD>>0)&_4BITS) != 0) RETURN_ERROR(reservedFlag_set);  /* Reserved bits */
+
+    /* check header */
+    assert(frameHeaderSize > 5);
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+    {   BYTE const HC = LZ4F_headerChecksum(srcPtr+4, frameHeaderSize-5);
+        RETURN_ERROR_IF(HC != srcPtr[frameHeaderSize-1], headerChecksum_invalid);
+    }
+#endif
+
+    /* save */
+    MEM_INIT(frameInfo, 0, sizeof(*frameInfo));
+    frameInfo->frameType = LZ4F_frame;
+    frameInfo->blockMode = (LZ4F_blockMode_t)blockMode;
+    frameInfo->blockChecksumFlag = (LZ4F_blockChecksum_t)blockChecksumFlag;
+    frameInfo->contentChecksumFlag = (LZ4F_contentChecksum_t)contentChecksumFlag;
+    frameInfo->blockSizeID = (LZ4F_blockSizeID_t)blockSizeID;
+    if (contentSizeFlag)
+        frameInfo->contentSize = LZ4F_readLE64(srcPtr+6);
+    if (dictIDFlag)
+        frameInfo->dictID = LZ4F_readLE32(srcPtr + frameHeaderSize - 5);
+    return 0;
+}
 
 /*! LZ4F_decodeHeader() :
  *  input   : `src` points at the **beginning of the frame**
@@ -1343,7 +2853,7 @@ void LZ4F_resetDecompressionContext(LZ4F_dctx* dctx)
  */
 static size_t LZ4F_decodeHeader(LZ4F_dctx* dctx, const void* src, size_t srcSize)
 {
-    unsigned blockMode, blockChecksumFlag, contentSizeFlag, contentChecksumFlag, dictIDFlag, blockSizeID;
+    unsigned contentSizeFlag, dictIDFlag;
     size_t frameHeaderSize;
     const BYTE* srcPtr = (const BYTE*)src;
 
@@ -1377,10 +2887,7 @@ static size_t LZ4F_decodeHeader(LZ4F_dctx* dctx, const void* src, size_t srcSize
     /* Flags */
     {   U32 const FLG = srcPtr[4];
         U32 const version = (FLG>>6) & _2BITS;
-        blockChecksumFlag = (FLG>>4) & _1BIT;
-        blockMode = (FLG>>5) & _1BIT;
         contentSizeFlag = (FLG>>3) & _1BIT;
-        contentChecksumFlag = (FLG>>2) & _1BIT;
         dictIDFlag = FLG & _1BIT;
         /* validate */
         if (((FLG>>1)&_1BIT) != 0) RETURN_ERROR(reservedFlag_set); /* Reserved bit */
@@ -1401,33 +2908,11 @@ static size_t LZ4F_decodeHeader(LZ4F_dctx* dctx, const void* src, size_t srcSize
         return srcSize;
     }
 
-    {   U32 const BD = srcPtr[5];
-        blockSizeID = (BD>>4) & _3BITS;
-        /* validate */
-        if (((BD>>7)&_1BIT) != 0) RETURN_ERROR(reservedFlag_set);   /* Reserved bit */
-        if (blockSizeID < 4) RETURN_ERROR(maxBlockSize_invalid);    /* 4-7 only supported values for the time being */
-        if (((BD>>0)&_4BITS) != 0) RETURN_ERROR(reservedFlag_set);  /* Reserved bits */
-    }
-
-    /* check header */
-    assert(frameHeaderSize > 5);
-#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
-    {   BYTE const HC = LZ4F_headerChecksum(srcPtr+4, frameHeaderSize-5);
-        RETURN_ERROR_IF(HC != srcPtr[frameHeaderSize-1], headerChecksum_invalid);
-    }
-#endif
-
-    /* save */
-    dctx->frameInfo.blockMode = (LZ4F_blockMode_t)blockMode;
-    dctx->frameInfo.blockChecksumFlag = (LZ4F_blockChecksum_t)blockChecksumFlag;
-    dctx->frameInfo.contentChecksumFlag = (LZ4F_contentChecksum_t)contentChecksumFlag;
-    dctx->frameInfo.blockSizeID = (LZ4F_blockSizeID_t)blockSizeID;
-    dctx->maxBlockSize = LZ4F_getBlockSize((LZ4F_blockSizeID_t)blockSizeID);
+    FORWARD_IF_ERROR( LZ4F_parseFrameHeader(&dctx->frameInfo, srcPtr, frameHeaderSize) );
+    dctx->maxBlockSize = LZ4F_getBlockSize(dctx->frameInfo.blockSizeID);
     if (contentSizeFlag) {
-        dctx->frameRemainingSize = dctx->frameInfo.contentSize = LZ4F_readLE64(srcPtr+6);
+        dctx->frameRemainingSize = dctx->frameInfo.contentSize;
     }
-    if (dictIDFlag)
-        dctx->frameInfo.dictID = LZ4F_readLE32(srcPtr + frameHeaderSize - 5);
 
     dctx->dStage = dstage_init;
 
@@ -1522,11 +3007,57 @@ LZ4F_errorCode_t LZ4F_getFrameInfo(LZ4F_dctx* dctx,
  * only used for LZ4F_blockLinked mode
  * Condition : @dstPtr != NULL
  */
+/* LZ4F_isWithinRing() :
+ * @return : 1 if [p, p+size[ is entirely within the ring buffer */
+static int LZ4F_isWithinRing(const LZ4F_dctx* dctx, const BYTE* p, size_t size)
+{
+    if (dctx->ringStart == NULL) return 0;
+    if (p < dctx->ringStart) return 0;
+    return (size <= dctx->ringSize) && ((size_t)(p - dctx->ringStart) <= dctx->ringSize - size);
+}
+
+/* LZ4F_flattenHistory() :
+ * joins both history segments (extDict + dict) into tmpOutBuffer,
+ * for cases which can only reference a single segment.
+ * Only needed with a ring buffer, when output doesn't follow the expected pattern. */
+static void LZ4F_flattenHistory(LZ4F_dctx* dctx)
+{
+    size_t const prefixSize = MIN(dctx->dictSize, 64 KB);
+    size_t const extSize = MIN(dctx->extDictSize, 64 KB - prefixSize);
+    assert(dctx->extDictSize > 0);
+    assert(dctx->tmpOutBuffer != NULL);
+    /* extDict might already be within tmpOutBuffer */
+    memmove(dctx->tmpOutBuffer, dctx->extDict + dctx->extDictSize - extSize, extSize);
+    memcpy(dctx->tmpOutBuffer + extSize, dctx->dict + dctx->dictSize - prefixSize, prefixSize);
+    dctx->dict = dctx->tmpOutBuffer;
+    dctx->dictSize = extSize + prefixSize;
+    dctx->extDict = NULL;
+    dctx->extDictSize = 0;
+}
+
 static void LZ4F_updateDict(LZ4F_dctx* dctx,
                       const BYTE* dstPtr, size_t dstSize, const BYTE* dstBufferStart,
                       unsigned withinTmp)
 {
     assert(dstPtr != NULL);
+
+    /* ring buffer : history stays in place, up to 2 segments */
+    if (!withinTmp && LZ4F_isWithinRing(dctx, dstPtr, dstSize)) {
+        if (dctx->dictSize == 0) {
+            dctx->dict = dstPtr;
+        } else if (dctx->dict + dctx->dictSize != dstPtr) {   /* wrapped around : current history becomes the older segment */
+            if (dctx->extDictSize && dctx->dictSize < 64 KB) LZ4F_flattenHistory(dctx);
+            dctx->extDictSize = MIN(dctx->dictSize, 64 KB);
+            dctx->extDict = dctx->dict + dctx->dictSize - dctx->extDictSize;
+            dctx->dict = dstPtr;
+            dctx->dictSize = 0;
+        }
+        dctx->dictSize += dstSize;
+        if (dctx->dictSize >= 64 KB) dctx->extDictSize = 0;   /* older segment no longer needed */
+        return;
+    }
+    if (dctx->extDictSize) LZ4F_flattenHistory(dctx);
+
     if (dctx->dictSize==0) dctx->dict = (const BYTE*)dstPtr;  /* will lead to prefix mode */
     assert(dctx->dict != NULL);
 
@@ -1542,53 +3073,283 @@ static void LZ4F_updateDict(LZ4F_dctx* dctx,
         return;
     }
 
-    assert(dstSize < 64 KB);   /* if dstSize >= 64 KB, dictionary would be set into dstBuffer directly */
+    assert(dstSize < 64 KB);   /* if dstSize >= 64 KB, dictionary would be set into dstBuffer directly */
+
+    /* dstBuffer does not contain whole useful history (64 KB), so it must be saved within tmpOutBuffer */
+    assert(dctx->tmpOutBuffer != NULL);
+
+    if (withinTmp && (dctx->dict == dctx->tmpOutBuffer)) {   /* continue history within tmpOutBuffer */
+        /* withinTmp expectation : content of [dstPtr,dstSize] is same as [dict+dictSize,dstSize], so we just extend it */
+        assert(dctx->dict + dctx->dictSize == dctx->tmpOut + dctx->tmpOutStart);
+        dctx->dictSize += dstSize;
+        return;
+    }
+
+    if (withinTmp) { /* copy relevant dict portion in front of tmpOut within tmpOutBuffer */
+        size_t const preserveSize = (size_t)(dctx->tmpOut - dctx->tmpOutBuffer);
+        size_t copySize = 64 KB - dctx->tmpOutSize;
+        const BYTE* const oldDictEnd = dctx->dict + dctx->dictSize - dctx->tmpOutStart;
+        if (dctx->tmpOutSize > 64 KB) copySize = 0;
+        if (copySize > preserveSize) copySize = preserveSize;
+
+        memcpy(dctx->tmpOutBuffer + preserveSize - copySize, oldDictEnd - copySize, copySize);
+
+        dctx->dict = dctx->tmpOutBuffer;
+        dctx->dictSize = preserveSize + dctx->tmpOutStart + dstSize;
+        return;
+    }
+
+    if (dctx->dict == dctx->tmpOutBuffer) {    /* copy dst into tmp to complete dict */
+        if (dctx->dictSize + dstSize > dctx->maxBufferSize) {  /* tmp buffer not large enough */
+            size_t const preserveSize = 64 KB - dstSize;
+            memcpy(dctx->tmpOutBuffer, dctx->dict + dctx->dictSize - preserveSize, preserveSize);
+            dctx->dictSize = preserveSize;
+        }
+        memcpy(dctx->tmpOutBuffer + dctx->dictSize, dstPtr, dstSize);
+        dctx->dictSize += dstSize;
+        return;
+    }
+
+    /* join dict & dest into tmp */
+    {   size_t preserveSize = 64 KB - dstSize;
+        if (preserveSize > dctx->dictSize) preserveSize = dctx->dictSize;
+        memcpy(dctx->tmpOutBuffer, dctx->dict + dctx->dictSize - preserveSize, preserveSize);
+        memcpy(dctx->tmpOutBuffer + preserveSize, dstPtr, dstSize);
+        dctx->dict = dctx->tmpOutBuffer;
+        dctx->dictSize = preserveSize + dstSize;
+    }
+}
+
+
+/*-***************************************************
+*   Dictionary decompression
+*****************************************************/
+
+/* Blocks up to this compressed size are decoded within ddictScratch, right after the dictionary.
+ * Prefix mode is faster than external dictionary mode, but the result must then be copied,
+ * which only pays off for small blocks. */
+#define LZ4F_DDICT_PREFIX_CSIZE_MAX (2 KB)
+
+struct LZ4F_DDict_s {
+    LZ4F_CustomMem cmem;
+    void* dictContent;
+    size_t dictSize;
+    U32 dictHash;   /* identifies content, to detect reuse of a ddict address */
+}; /* typedef'd to LZ4F_DDict within lz4frame.h */
+
+LZ4F_DDict*
+LZ4F_createDDict_advanced(LZ4F_CustomMem cmem, const void* dictBuffer, size_t dictSize)
+{
+    const char* dictStart = (const char*)dictBuffer;
+    LZ4F_DDict* const ddict = (LZ4F_DDict*)LZ4F_malloc(sizeof(*ddict), cmem);
+    DEBUGLOG(4, "LZ4F_createDDict_advanced");
+    if (!ddict) return NULL;
+    ddict->cmem = cmem;
+    if (dictSize > 64 KB) {
+        dictStart += dictSize - 64 KB;
+        dictSize = 64 KB;
+    }
+    ddict->dictContent = LZ4F_malloc(dictSize + !dictSize, cmem);
+    if (!ddict->dictContent) {
+        LZ4F_freeDDict(ddict);
+        return NULL;
+    }
+    if (dictSize) memcpy(ddict->dictContent, dictStart, dictSize);
+    ddict->dictSize = dictSize;
+    ddict->dictHash = XXH32(ddict->dictContent, dictSize, 0);
+    return ddict;
+}
+
+/*! LZ4F_createDDict() :
+ *  When decompressing multiple frames with the same dictionary, it's recommended to prepare it just once.
+ *  LZ4F_DDict can be created once and shared by multiple threads concurrently, since its usage is read-only.
+ * @dictBuffer can be released after LZ4F_DDict creation, since its content is copied within DDict
+ * @return : prepared dictionary for decompression, or NULL if failed */
+LZ4F_DDict* LZ4F_createDDict(const void* dictBuffer, size_t dictSize)
+{
+    DEBUGLOG(4, "LZ4F_createDDict");
+    return LZ4F_createDDict_advanced(LZ4F_defaultCMem, dictBuffer, dictSize);
+}
+
+void LZ4F_freeDDict(LZ4F_DDict* ddict)
+{
+    if (ddict==NULL) return;  /* support free on NULL */
+    LZ4F_free(ddict->dictContent, ddict->cmem);
+    LZ4F_free(ddict, ddict->cmem);
+}
+
+/* LZ4F_loadDDictScratch() :
+ * ensures ddictScratch contains dctx->ddict content, followed by room for one block.
+ * ddict content is only copied when it changes, so that it's done once for many frames.
+ * @return : 0, or an error code */
+static size_t LZ4F_loadDDictScratch(LZ4F_dctx* dctx)
+{
+    const LZ4F_DDict* const ddict = dctx->ddict;
+    size_t const neededSize = 64 KB + dctx->maxBlockSize;
+    assert(ddict != NULL);
+    if (neededSize > dctx->ddictScratchSize) {
+        LZ4F_free(dctx->ddictScratch, dctx->cmem);
+        dctx->ddictScratchSize = 0;
+        dctx->ddictLoaded = NULL;
+        dctx->ddictScratch = (BYTE*)LZ4F_malloc(neededSize, dctx->cmem);
+        RETURN_ERROR_IF(dctx->ddictScratch == NULL, allocation_failed);
+        dctx->ddictScratchSize = neededSize;
+    }
+    if ((dctx->ddictLoaded != ddict) || (dctx->ddictLoadedHash != ddict->dictHash)) {
+        if (ddict->dictSize) memcpy(dctx->ddictScratch, ddict->dictContent, ddict->dictSize);
+        dctx->ddictLoaded = ddict;
+        dctx->ddictLoadedHash = ddict->dictHash;
+    }
+    return 0;
+}
+
+
+/* LZ4F_endFrame() :
+ *  With LZ4F_decompress_continue(), the last 64 KB of history are kept
+ *  at the beginning of tmpOutBuffer for next frame.
+ *  History usually already lies there, since small frames are accumulated within tmpOutBuffer. */
+static void LZ4F_endFrame(LZ4F_dctx* dctx)
+{
+    dctx->histSize = 0;
+    if (dctx->keepHistory && dctx->frameInfo.blockMode == LZ4F_blockLinked && dctx->dictSize > 0) {
+        assert(dctx->tmpOutBuffer != NULL);
+        if (dctx->extDictSize) LZ4F_flattenHistory(dctx);
+        if (dctx->dict != dctx->tmpOutBuffer) {
+            size_t const histSize = MIN(dctx->dictSize, 64 KB);
+            memcpy(dctx->tmpOutBuffer, dctx->dict + dctx->dictSize - histSize, histSize);
+            dctx->dictSize = histSize;
+        } else if (dctx->dictSize > 128 KB) {
+            /* leave room for a full block after history */
+            memmove(dctx->tmpOutBuffer, dctx->dict + dctx->dictSize - 64 KB, 64 KB);
+            dctx->dictSize = 64 KB;
+        }
+        dctx->histSize = dctx->dictSize;
+    }
+    LZ4F_resetFrameState(dctx);
+}
+
+#ifndef LZ4F_CHECKSUM_TILE_SIZE
+#  define LZ4F_CHECKSUM_TILE_SIZE (16 KB)   /* decoded data is checksummed while still within L1 cache */
+#endif
+
+typedef struct {
+    XXH32_state_t* blockChecksum;     /* over compressed data, or NULL */
+    XXH32_state_t* contentChecksum;   /* over decoded data, or NULL */
+} LZ4F_checksumTiles;
 
-    /* dstBuffer does not contain whole useful history (64 KB), so it must be saved within tmpOutBuffer */
-    assert(dctx->tmpOutBuffer != NULL);
+static void LZ4F_checksumTile(void* opaque, const char* src, size_t srcSize, const char* dst, size_t dstSize)
+{
+    const LZ4F_checksumTiles* const cs = (const LZ4F_checksumTiles*)opaque;
+    if (cs->blockChecksum) (void)XXH32_update(cs->blockChecksum, src, srcSize);
+    if (cs->contentChecksum) (void)XXH32_update(cs->contentChecksum, dst, dstSize);
+}
 
-    if (withinTmp && (dctx->dict == dctx->tmpOutBuffer)) {   /* continue history within tmpOutBuffer */
-        /* withinTmp expectation : content of [dstPtr,dstSize] is same as [dict+dictSize,dstSize], so we just extend it */
-        assert(dctx->dict + dctx->dictSize == dctx->tmpOut + dctx->tmpOutStart);
-        dctx->dictSize += dstSize;
-        return;
-    }
+/* LZ4F_checkBlockChecksum() :
+ *  controls checksum of block @src, of @cSize bytes, once decoded by tiles into @blockChecksum.
+ *  When decoding failed, input was only partially hashed :
+ *  it's hashed again, since corrupted input is more likely to fail decoding.
+ * @return : 0, or an error code */
+static size_t LZ4F_checkBlockChecksum(XXH32_state_t* blockChecksum, const BYTE* src, size_t cSize, int decodedSize)
+{
+    U32 const readBlockCrc = LZ4F_readLE32(src + cSize);
+    U32 const calcBlockCrc = (decodedSize >= 0) ? XXH32_digest(blockChecksum) : XXH32(src, cSize, 0);
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+    RETURN_ERROR_IF(readBlockCrc != calcBlockCrc, blockChecksum_invalid);
+#else
+    (void)readBlockCrc;
+    (void)calcBlockCrc;
+#endif
+    return 0;
+}
 
-    if (withinTmp) { /* copy relevant dict portion in front of tmpOut within tmpOutBuffer */
-        size_t const preserveSize = (size_t)(dctx->tmpOut - dctx->tmpOutBuffer);
-        size_t copySize = 64 KB - dctx->tmpOutSize;
-        const BYTE* const oldDictEnd = dctx->dict + dctx->dictSize - dctx->tmpOutStart;
-        if (dctx->tmpOutSize > 64 KB) copySize = 0;
-        if (copySize > preserveSize) copySize = preserveSize;
+#ifndef LZ4F_CHECKSUM_BATCH
+#  define LZ4F_CHECKSUM_BATCH 8   /* block checksums verified together, one per XXH32_multi() lane */
+#endif
 
-        memcpy(dctx->tmpOutBuffer + preserveSize - copySize, oldDictEnd - copySize, copySize);
+/* LZ4F_verifyBlockChecksums() :
+ *  verifies checksums of up to LZ4F_CHECKSUM_BATCH blocks, the first one starting with its block header at @src.
+ *  Stops at end mark, or before a block which doesn't fit within @srcSize or @maxBlockSize,
+ *  leaving such errors to the caller.
+ * @return : nb of bytes of @src verified, or an error code */
+static size_t LZ4F_verifyBlockChecksums(const BYTE* src, size_t srcSize, size_t maxBlockSize)
+{
+    const BYTE* const srcEnd = src + srcSize;
+    const BYTE* ip = src;
+    const void* blocks[LZ4F_CHECKSUM_BATCH] = { NULL };
+    size_t cSizes[LZ4F_CHECKSUM_BATCH] = { 0 };
+    XXH32_hash_t crcs[LZ4F_CHECKSUM_BATCH];
+    size_t nbBlocks = 0, n;
+
+    while (nbBlocks < LZ4F_CHECKSUM_BATCH && (size_t)(srcEnd - ip) >= BHSize) {
+        U32 const blockHeader = LZ4F_readLE32(ip);
+        size_t const cSize = blockHeader & 0x7FFFFFFFU;
+        if (blockHeader == 0) break;   /* endMark */
+        if (cSize > maxBlockSize || (size_t)(srcEnd - ip) - BHSize < cSize + BFSize) break;
+        blocks[nbBlocks] = ip + BHSize;
+        cSizes[nbBlocks] = cSize;
+        nbBlocks++;
+        ip += BHSize + cSize + BFSize;
+    }
 
-        dctx->dict = dctx->tmpOutBuffer;
-        dctx->dictSize = preserveSize + dctx->tmpOutStart + dstSize;
-        return;
+    XXH32_multi(blocks, cSizes, nbBlocks, 0, crcs);
+    for (n = 0; n < nbBlocks; n++) {
+        RETURN_ERROR_IF(LZ4F_readLE32((const BYTE*)blocks[n] + cSizes[n]) != crcs[n], blockChecksum_invalid);
     }
+    return (size_t)(ip - src);
+}
 
-    if (dctx->dict == dctx->tmpOutBuffer) {    /* copy dst into tmp to complete dict */
-        if (dctx->dictSize + dstSize > dctx->maxBufferSize) {  /* tmp buffer not large enough */
-            size_t const preserveSize = 64 KB - dstSize;
-            memcpy(dctx->tmpOutBuffer, dctx->dict + dctx->dictSize - preserveSize, preserveSize);
-            dctx->dictSize = preserveSize;
+/* LZ4F_decodeBlock() :
+ *  decodes block @src, of dctx->tmpInTarget bytes, into @dst,
+ *  using @dict as history, or @lz4sd when history is split in 2 segments.
+ *  Checksums are updated tile by tile during decoding, over data still in cache,
+ *  instead of reading the whole block again before or after decoding it.
+ *  Block checksum, when present, follows @src.
+ * @return : decoded size, or an error code */
+static size_t LZ4F_decodeBlock(LZ4F_dctx* dctx, const BYTE* src, BYTE* dst,
+                               const char* dict, size_t dictSize, LZ4_streamDecode_t* lz4sd)
+{
+    int const cSize = (int)dctx->tmpInTarget;
+    int const dstCapacity = (int)dctx->maxBlockSize;
+    LZ4F_checksumTiles cs;
+    int decodedSize;
+
+    cs.blockChecksum = dctx->frameInfo.blockChecksumFlag ? &dctx->blockChecksum : NULL;
+    cs.contentChecksum = (dctx->frameInfo.contentChecksumFlag && !dctx->skipChecksum) ? &dctx->xxh : NULL;
+    if (cs.blockChecksum) (void)XXH32_reset(cs.blockChecksum, 0);
+
+    /* offloaded to codec : only for blocks without history. Checksums remain controlled here. */
+    if (dctx->codec.decompressBlock != NULL && lz4sd == NULL && dictSize == 0) {
+        if (cs.blockChecksum) {
+            (void)XXH32_update(cs.blockChecksum, src, (size_t)cSize);
+            FORWARD_IF_ERROR( LZ4F_checkBlockChecksum(cs.blockChecksum, src, (size_t)cSize, 0) );
+            cs.blockChecksum = NULL;   /* verified */
         }
-        memcpy(dctx->tmpOutBuffer + dctx->dictSize, dstPtr, dstSize);
-        dctx->dictSize += dstSize;
-        return;
+        decodedSize = LZ4F_decodeWithCodec(dctx, src, dst, cSize, dstCapacity);
+        if (decodedSize >= 0) {
+            if (cs.contentChecksum) (void)XXH32_update(cs.contentChecksum, dst, (size_t)decodedSize);
+            return (size_t)decodedSize;
+        }
+        /* codec declined : decode with CPU */
     }
 
-    /* join dict & dest into tmp */
-    {   size_t preserveSize = 64 KB - dstSize;
-        if (preserveSize > dctx->dictSize) preserveSize = dctx->dictSize;
-        memcpy(dctx->tmpOutBuffer, dctx->dict + dctx->dictSize - preserveSize, preserveSize);
-        memcpy(dctx->tmpOutBuffer + preserveSize, dstPtr, dstSize);
-        dctx->dict = dctx->tmpOutBuffer;
-        dctx->dictSize = preserveSize + dstSize;
+    if (cs.blockChecksum == NULL && cs.contentChecksum == NULL) {
+        decodedSize = (lz4sd != NULL) ?
+            LZ4_decompress_safe_continue(lz4sd, (const char*)src, (char*)dst, cSize, dstCapacity) :
+            LZ4_decompress_safe_usingDict((const char*)src, (char*)dst, cSize, dstCapacity, dict, (int)dictSize);
+    } else {
+        decodedSize = (lz4sd != NULL) ?
+            LZ4_decompress_safe_continue_tiles(lz4sd, (const char*)src, (char*)dst, cSize, dstCapacity,
+                                               LZ4F_CHECKSUM_TILE_SIZE, LZ4F_checksumTile, &cs) :
+            LZ4_decompress_safe_usingDict_tiles((const char*)src, (char*)dst, cSize, dstCapacity,
+                                                dict, (int)dictSize,
+                                                LZ4F_CHECKSUM_TILE_SIZE, LZ4F_checksumTile, &cs);
     }
-}
 
+    if (cs.blockChecksum)
+        FORWARD_IF_ERROR( LZ4F_checkBlockChecksum(cs.blockChecksum, src, (size_t)cSize, decodedSize) );
+    RETURN_ERROR_IF(decodedSize < 0, decompressionFailed);
+    return (size_t)decodedSize;
+}
 
 /*! LZ4F_decompress() :
  *  Call this function repetitively to regenerate compressed data in srcBuffer.
@@ -1674,22 +3435,15 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
         case dstage_init:
             DEBUGLOG(6, "dstage_init");
             if (dctx->frameInfo.contentChecksumFlag) (void)XXH32_reset(&(dctx->xxh), 0);
-            /* internal buffers allocation */
-            {   size_t const bufferNeeded = dctx->maxBlockSize
-                    + ((dctx->frameInfo.blockMode==LZ4F_blockLinked) ? 128 KB : 0);
-                if (bufferNeeded > dctx->maxBufferSize) {   /* tmp buffers too small */
-                    dctx->maxBufferSize = 0;   /* ensure allocation will be re-attempted on next entry*/
-                    LZ4F_free(dctx->tmpIn, dctx->cmem);
-                    dctx->tmpIn = (BYTE*)LZ4F_malloc(dctx->maxBlockSize + BFSize /* block checksum */, dctx->cmem);
-                    RETURN_ERROR_IF(dctx->tmpIn == NULL, allocation_failed);
-                    LZ4F_free(dctx->tmpOutBuffer, dctx->cmem);
-                    dctx->tmpOutBuffer= (BYTE*)LZ4F_malloc(bufferNeeded, dctx->cmem);
-                    RETURN_ERROR_IF(dctx->tmpOutBuffer== NULL, allocation_failed);
-                    dctx->maxBufferSize = bufferNeeded;
-            }   }
+            FORWARD_IF_ERROR( LZ4F_allocDecodingBuffers(dctx) );
             dctx->tmpInSize = 0;
             dctx->tmpInTarget = 0;
             dctx->tmpOut = dctx->tmpOutBuffer;
+            if (dctx->dict == dctx->tmpOutBuffer && dctx->dict != NULL) {
+                /* history of previous frames, see LZ4F_decompress_continue() */
+                RETURN_ERROR_IF(dctx->frameInfo.blockMode != LZ4F_blockLinked, blockMode_invalid);
+                dctx->tmpOut = dctx->tmpOutBuffer + dctx->dictSize;
+            }
             dctx->tmpOutStart = 0;
             dctx->tmpOutSize = 0;
 
@@ -1865,20 +3619,31 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
 
             /* At this stage, input is large enough to decode a block */
 
-            /* First, decode and control block checksum if it exists */
+            /* block checksum, if present, is controlled while decoding (see LZ4F_decodeBlock()) */
             if (dctx->frameInfo.blockChecksumFlag) {
                 assert(dctx->tmpInTarget >= 4);
                 dctx->tmpInTarget -= 4;
-                assert(selectedIn != NULL);  /* selectedIn is defined at this stage (either srcPtr, or dctx->tmpIn) */
-                {   U32 const readBlockCrc = LZ4F_readLE32(selectedIn + dctx->tmpInTarget);
-                    U32 const calcBlockCrc = XXH32(selectedIn, dctx->tmpInTarget, 0);
-#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
-                    RETURN_ERROR_IF(readBlockCrc != calcBlockCrc, blockChecksum_invalid);
-#else
-                    (void)readBlockCrc;
-                    (void)calcBlockCrc;
-#endif
-            }   }
+            }
+            assert(selectedIn != NULL);  /* selectedIn is defined at this stage (either srcPtr, or dctx->tmpIn) */
+
+            /* small independent block with a prepared dictionary : decode after dictionary, in prefix mode */
+            if ( (dctx->ddict != NULL)
+              && (dctx->frameInfo.blockMode == LZ4F_blockIndependent)
+              && (dctx->tmpInTarget <= LZ4F_DDICT_PREFIX_CSIZE_MAX) ) {
+                size_t const dictSize = dctx->ddict->dictSize;
+                size_t decodedSize;
+                FORWARD_IF_ERROR( LZ4F_loadDDictScratch(dctx) );
+                dctx->tmpOut = dctx->ddictScratch + dictSize;
+                decodedSize = LZ4F_decodeBlock(dctx, selectedIn, dctx->tmpOut,
+                                               (const char*)dctx->ddictScratch, dictSize, NULL);
+                FORWARD_IF_ERROR(decodedSize);
+                if (dctx->frameInfo.contentSize)
+                    dctx->frameRemainingSize -= decodedSize;
+                dctx->tmpOutSize = decodedSize;
+                dctx->tmpOutStart = 0;
+                dctx->dStage = dstage_flushOut;
+                break;
+            }
 
             /* decode directly into destination buffer if there is enough room */
             if ( ((size_t)(dstEnd-dstPtr) >= dctx->maxBlockSize)
@@ -1887,28 +3652,38 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
                   * to benefit from prefix speedup */
               && !(dctx->dict!= NULL && (const BYTE*)dctx->dict + dctx->dictSize == dctx->tmpOut) )
             {
-                const char* dict = (const char*)dctx->dict;
-                size_t dictSize = dctx->dictSize;
-                int decodedSize;
+                const char* dict;
+                size_t dictSize;
+                size_t decodedSize;
                 assert(dstPtr != NULL);
+                if (dctx->extDictSize && (dctx->dict + dctx->dictSize != dstPtr))
+                    LZ4F_flattenHistory(dctx);
+                dict = (const char*)dctx->dict;
+                dictSize = dctx->dictSize;
                 if (dict && dictSize > 1 GB) {
                     /* overflow control : dctx->dictSize is an int, avoid truncation / sign issues */
                     dict += dictSize - 64 KB;
                     dictSize = 64 KB;
                 }
-                decodedSize = LZ4_decompress_safe_usingDict(
-                        (const char*)selectedIn, (char*)dstPtr,
-                        (int)dctx->tmpInTarget, (int)dctx->maxBlockSize,
-                        dict, (int)dictSize);
-                RETURN_ERROR_IF(decodedSize < 0, decompressionFailed);
-                if ((dctx->frameInfo.contentChecksumFlag) && (!dctx->skipChecksum))
-                    XXH32_update(&(dctx->xxh), dstPtr, (size_t)decodedSize);
+                if (dctx->extDictSize) {
+                    /* history in 2 segments, within ring buffer : no copy needed */
+                    LZ4_streamDecode_t lz4sd;
+                    LZ4_streamDecode_t_internal* const sd = &lz4sd.internal_donotuse;
+                    sd->externalDict = dctx->extDict;
+                    sd->extDictSize = dctx->extDictSize;
+                    sd->prefixEnd = (const BYTE*)dict + dictSize;
+                    sd->prefixSize = dictSize;
+                    decodedSize = LZ4F_decodeBlock(dctx, selectedIn, dstPtr, NULL, 0, &lz4sd);
+                } else {
+                    decodedSize = LZ4F_decodeBlock(dctx, selectedIn, dstPtr, dict, dictSize, NULL);
+                }
+                FORWARD_IF_ERROR(decodedSize);
                 if (dctx->frameInfo.contentSize)
-                    dctx->frameRemainingSize -= (size_t)decodedSize;
+                    dctx->frameRemainingSize -= decodedSize;
 
                 /* dictionary management */
                 if (dctx->frameInfo.blockMode==LZ4F_blockLinked) {
-                    LZ4F_updateDict(dctx, dstPtr, (size_t)decodedSize, dstStart, 0);
+                    LZ4F_updateDict(dctx, dstPtr, decodedSize, dstStart, 0);
                 }
 
                 dstPtr += decodedSize;
@@ -1920,6 +3695,7 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
 
             /* manage dictionary */
             if (dctx->frameInfo.blockMode == LZ4F_blockLinked) {
+                if (dctx->extDictSize) LZ4F_flattenHistory(dctx);
                 if (dctx->dict == dctx->tmpOutBuffer) {
                     /* truncate dictionary to 64 KB if too big */
                     if (dctx->dictSize > 128 KB) {
@@ -1935,22 +3711,17 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
             /* Decode block into tmpOut */
             {   const char* dict = (const char*)dctx->dict;
                 size_t dictSize = dctx->dictSize;
-                int decodedSize;
+                size_t decodedSize;
                 if (dict && dictSize > 1 GB) {
                     /* the dictSize param is an int, avoid truncation / sign issues */
                     dict += dictSize - 64 KB;
                     dictSize = 64 KB;
                 }
-                decodedSize = LZ4_decompress_safe_usingDict(
-                        (const char*)selectedIn, (char*)dctx->tmpOut,
-                        (int)dctx->tmpInTarget, (int)dctx->maxBlockSize,
-                        dict, (int)dictSize);
-                RETURN_ERROR_IF(decodedSize < 0, decompressionFailed);
-                if (dctx->frameInfo.contentChecksumFlag && !dctx->skipChecksum)
-                    XXH32_update(&(dctx->xxh), dctx->tmpOut, (size_t)decodedSize);
+                decodedSize = LZ4F_decodeBlock(dctx, selectedIn, dctx->tmpOut, dict, dictSize, NULL);
+                FORWARD_IF_ERROR(decodedSize);
                 if (dctx->frameInfo.contentSize)
-                    dctx->frameRemainingSize -= (size_t)decodedSize;
-                dctx->tmpOutSize = (size_t)decodedSize;
+                    dctx->frameRemainingSize -= decodedSize;
+                dctx->tmpOutSize = decodedSize;
                 dctx->tmpOutStart = 0;
                 dctx->dStage = dstage_flushOut;
             }
@@ -1982,7 +3753,7 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
             RETURN_ERROR_IF(dctx->frameRemainingSize, frameSize_wrong);   /* incorrect frame size decoded */
             if (!dctx->frameInfo.contentChecksumFlag) {  /* no checksum, frame is completed */
                 nextSrcSizeHint = 0;
-                LZ4F_resetDecompressionContext(dctx);
+                LZ4F_endFrame(dctx);
                 doAnotherStage = 0;
                 break;
             }
@@ -2023,7 +3794,7 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
 #endif
             }
             nextSrcSizeHint = 0;
-            LZ4F_resetDecompressionContext(dctx);
+            LZ4F_endFrame(dctx);
             doAnotherStage = 0;
             break;
 
@@ -2070,7 +3841,7 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
                 nextSrcSizeHint = dctx->tmpInTarget;
                 if (nextSrcSizeHint) break;  /* still more to skip */
                 /* frame fully skipped : prepare context for a new frame */
-                LZ4F_resetDecompressionContext(dctx);
+                LZ4F_resetFrameState(dctx);
                 break;
             }
         }   /* switch (dctx->dStage) */
@@ -2082,6 +3853,7 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
       && (dctx->dict != dctx->tmpOutBuffer)             /* dictionary is not already within tmp */
       && (dctx->dict != NULL)                           /* dictionary exists */
       && (!decompressOptionsPtr->stableDst)             /* cannot rely on dst data to remain there for next call */
+      && (!LZ4F_isWithinRing(dctx, dctx->dict, dctx->dictSize))  /* ring buffer content remains there */
       && ((unsigned)(dctx->dStage)-2 < (unsigned)(dstage_getSuffix)-2) )  /* valid stages : [init ... getSuffix[ */
     {
         if (dctx->dStage == dstage_flushOut) {
@@ -2127,8 +3899,645 @@ size_t LZ4F_decompress_usingDict(LZ4F_dctx* dctx,
     if (dctx->dStage <= dstage_init) {
         dctx->dict = (const BYTE*)dict;
         dctx->dictSize = dictSize;
+        dctx->extDict = NULL;
+        dctx->extDictSize = 0;
+        dctx->ddict = NULL;
+    }
+    return LZ4F_decompress(dctx, dstBuffer, dstSizePtr,
+                           srcBuffer, srcSizePtr,
+                           decompressOptionsPtr);
+}
+
+size_t LZ4F_decompress_continue(LZ4F_dctx* dctx,
+                       void* dstBuffer, size_t* dstSizePtr,
+                       const void* srcBuffer, size_t* srcSizePtr,
+                       const LZ4F_decompressOptions_t* decompressOptionsPtr)
+{
+    size_t result;
+    if (dctx->dStage <= dstage_init && dctx->histSize > 0) {
+        dctx->dict = dctx->tmpOutBuffer;
+        dctx->dictSize = dctx->histSize;
+        dctx->extDict = NULL;
+        dctx->extDictSize = 0;
+        dctx->ddict = NULL;
+    }
+    dctx->keepHistory = 1;
+    result = LZ4F_decompress(dctx, dstBuffer, dstSizePtr,
+                             srcBuffer, srcSizePtr,
+                             decompressOptionsPtr);
+    dctx->keepHistory = 0;
+    return result;
+}
+
+/*! LZ4F_decompressv() :
+ *  Same as LZ4F_decompress(), scattering decoded data across @iovcnt fragments, in order.
+ *  Each fragment is filled before moving to the next one. */
+size_t LZ4F_decompressv(LZ4F_dctx* dctx,
+                        const LZ4F_iovec* iov, int iovcnt, size_t* dstSizePtr,
+                        const void* srcBuffer, size_t* srcSizePtr,
+                        const LZ4F_decompressOptions_t* decompressOptionsPtr)
+{
+    const BYTE* srcPtr = (const BYTE*)srcBuffer;
+    size_t srcRemaining = *srcSizePtr;
+    size_t nextSrcSizeHint = 1;
+    size_t totalOut = 0;
+    int n;
+
+    *srcSizePtr = 0;
+    *dstSizePtr = 0;
+    RETURN_ERROR_IF(iovcnt < 0, parameter_invalid);
+    RETURN_ERROR_IF(iov == NULL && iovcnt > 0, parameter_null);
+
+    for (n = 0; n < iovcnt; n++) {
+        size_t dstSize = iov[n].iov_len;
+        size_t srcSize = srcRemaining;
+        nextSrcSizeHint = LZ4F_decompress(dctx, iov[n].iov_base, &dstSize,
+                                          srcPtr, &srcSize,
+                                          decompressOptionsPtr);
+        srcPtr += srcSize;
+        srcRemaining -= srcSize;
+        totalOut += dstSize;
+        *srcSizePtr += srcSize;
+        *dstSizePtr = totalOut;
+        FORWARD_IF_ERROR(nextSrcSizeHint);
+        if (dstSize < iov[n].iov_len) break;   /* src exhausted, or end of frame */
+        if (nextSrcSizeHint == 0) break;
+    }
+    return nextSrcSizeHint;
+}
+
+/*! LZ4F_decompress_usingDDict() :
+ *  Same as LZ4F_decompress_usingDict(), using a dictionary prepared with LZ4F_createDDict().
+ *  @ddict must remain accessible throughout the entire frame decoding.
+ */
+size_t LZ4F_decompress_usingDDict(LZ4F_dctx* dctx,
+                       void* dstBuffer, size_t* dstSizePtr,
+                       const void* srcBuffer, size_t* srcSizePtr,
+                       const LZ4F_DDict* ddict,
+                       const LZ4F_decompressOptions_t* decompressOptionsPtr)
+{
+    if (dctx->dStage <= dstage_init) {
+        dctx->dict = ddict ? (const BYTE*)ddict->dictContent : NULL;
+        dctx->dictSize = ddict ? ddict->dictSize : 0;
+        dctx->extDict = NULL;
+        dctx->extDictSize = 0;
+        dctx->ddict = ddict;
     }
     return LZ4F_decompress(dctx, dstBuffer, dstSizePtr,
                            srcBuffer, srcSizePtr,
                            decompressOptionsPtr);
 }
+
+/*! LZ4F_decompressFrame_internal() :
+ *  One-shot variant : blocks are walked linearly and decoded directly into dstBuffer,
+ *  which also serves as history for linked blocks.
+ *  No context, no intermediate buffer.
+ *  When @inplace is set, srcBuffer is located within dstBuffer, ahead of decoded data :
+ *  each block is then only decoded if its output remains behind its own input, by a safety margin. */
+static size_t
+LZ4F_decompressFrame_internal(void* dstBuffer, size_t dstCapacity,
+                        const void* srcBuffer, size_t srcSize,
+                        const void* dict, size_t dictSize,
+                              int inplace)
+{
+    const BYTE* const srcStart = (const BYTE*)srcBuffer;
+    const BYTE* const srcEnd = srcStart + srcSize;
+    const BYTE* srcPtr = srcStart;
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* const dstEnd = dstStart + dstCapacity;
+    BYTE* dstPtr = dstStart;
+    LZ4F_frameInfo_t frameInfo;
+    LZ4_streamDecode_t lz4sd;
+    XXH32_state_t contentXxh;
+    LZ4F_checksumTiles cs;
+    LZ4_decodeTile_f tileFn;
+    size_t maxBlockSize;
+    size_t crcSize;
+    const BYTE* verifiedEnd = srcStart;   /* blocks before this position have a verified checksum */
+
+    DEBUGLOG(5, "LZ4F_decompressFrame_internal (srcSize=%u, dstCapacity=%u, inplace=%i)",
+                (unsigned)srcSize, (unsigned)dstCapacity, inplace);
+    if (dict == NULL) dictSize = 0;
+
+    /* frame header */
+    {   size_t const hSize = LZ4F_headerSize(srcStart, srcSize);
+        FORWARD_IF_ERROR(hSize);
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+        RETURN_ERROR_IF(LZ4F_readLE32(srcStart) != LZ4F_MAGICNUMBER, frameType_unknown);  /* includes skippable frames */
+#endif
+        RETURN_ERROR_IF(srcSize < hSize, frameHeader_incomplete);
+        FORWARD_IF_ERROR( LZ4F_parseFrameHeader(&frameInfo, srcStart, hSize) );
+        srcPtr += hSize;
+    }
+    maxBlockSize = LZ4F_getBlockSize(frameInfo.blockSizeID);
+    crcSize = frameInfo.blockChecksumFlag * BFSize;
+    if (frameInfo.contentSize) {
+        RETURN_ERROR_IF(frameInfo.contentSize > (U64)dstCapacity, dstMaxSize_tooSmall);
+    }
+    if (frameInfo.blockMode == LZ4F_blockLinked) {
+        LZ4_setStreamDecode(&lz4sd, (const char*)dict, (int)dictSize);
+    }
+    /* content checksum is updated while decoding, see LZ4F_decodeBlock().
+     * Block checksums are controlled before decoding, several blocks at a time, since all blocks are present. */
+    cs.contentChecksum = frameInfo.contentChecksumFlag ? &contentXxh : NULL;
+    cs.blockChecksum = NULL;
+    tileFn = cs.contentChecksum ? LZ4F_checksumTile : NULL;
+    if (cs.contentChecksum) (void)XXH32_reset(cs.contentChecksum, 0);
+
+    /* blocks */
+    for (;;) {
+        U32 blockHeader;
+        size_t cSize;
+        RETURN_ERROR_IF((size_t)(srcEnd - srcPtr) < BHSize, frameSize_wrong);
+        blockHeader = LZ4F_readLE32(srcPtr);
+        srcPtr += BHSize;
+        if (blockHeader == 0) break;   /* endMark */
+        cSize = blockHeader & 0x7FFFFFFFU;
+        RETURN_ERROR_IF(cSize > maxBlockSize, maxBlockSize_invalid);
+        RETURN_ERROR_IF((size_t)(srcEnd - srcPtr) < cSize + crcSize, frameSize_wrong);
+
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+        if (crcSize && srcPtr > verifiedEnd) {
+            size_t const verified = LZ4F_verifyBlockChecksums(srcPtr - BHSize, (size_t)(srcEnd - srcPtr) + BHSize, maxBlockSize);
+            FORWARD_IF_ERROR(verified);
+            verifiedEnd = srcPtr - BHSize + verified;
+            assert(verifiedEnd >= srcPtr + cSize + crcSize);   /* current block passed the same controls */
+        }
+#endif
+
+        if (blockHeader & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
+            RETURN_ERROR_IF(cSize > (size_t)(dstEnd - dstPtr), dstMaxSize_tooSmall);
+            if (inplace) {
+                RETURN_ERROR_IF(dstPtr > srcPtr, dstMaxSize_tooSmall);   /* would overwrite unread input */
+                memmove(dstPtr, srcPtr, cSize);
+            } else {
+                memcpy(dstPtr, srcPtr, cSize);
+            }
+            if (frameInfo.blockMode == LZ4F_blockLinked) {
+                /* uncompressed block is part of history : extend the prefix, like LZ4_decompress_safe_continue() would */
+                LZ4_streamDecode_t_internal* const sd = &lz4sd.internal_donotuse;
+                if (sd->prefixEnd != dstPtr) {   /* first block : dictionary becomes external */
+                    sd->externalDict = sd->prefixEnd - sd->prefixSize;
+                    sd->extDictSize = sd->prefixSize;
+                    sd->prefixSize = 0;
+                }
+                sd->prefixSize += cSize;
+                sd->prefixEnd = dstPtr + cSize;
+            }
+            if (cs.contentChecksum) (void)XXH32_update(cs.contentChecksum, dstPtr, cSize);
+            dstPtr += cSize;
+        } else {
+            size_t dstRoom = MIN(maxBlockSize, (size_t)(dstEnd - dstPtr));
+            int decodedSize;
+            if (inplace) {
+                /* decoded block must end before its own input, by LZ4_DECOMPRESS_INPLACE_MARGIN() */
+                const BYTE* const blockEnd = srcPtr + cSize;
+                size_t const margin = LZ4_DECOMPRESS_INPLACE_MARGIN(cSize);
+                RETURN_ERROR_IF(dstPtr + margin > blockEnd, dstMaxSize_tooSmall);
+                dstRoom = MIN(dstRoom, (size_t)(blockEnd - margin - dstPtr));
+            }
+            decodedSize = (frameInfo.blockMode == LZ4F_blockLinked) ?
+                LZ4_decompress_safe_continue_tiles(&lz4sd, (const char*)srcPtr, (char*)dstPtr, (int)cSize, (int)dstRoom,
+                                                   LZ4F_CHECKSUM_TILE_SIZE, tileFn, &cs) :
+                LZ4_decompress_safe_usingDict_tiles((const char*)srcPtr, (char*)dstPtr, (int)cSize, (int)dstRoom,
+                                                    (const char*)dict, (int)dictSize,
+                                                    LZ4F_CHECKSUM_TILE_SIZE, tileFn, &cs);
+            RETURN_ERROR_IF(decodedSize < 0, decompressionFailed);
+            dstPtr += decodedSize;
+        }
+        srcPtr += cSize + crcSize;
+    }
+
+    /* frame footer */
+    if (frameInfo.contentSize) {
+        RETURN_ERROR_IF((U64)(dstPtr - dstStart) != frameInfo.contentSize, frameSize_wrong);
+    }
+    if (frameInfo.contentChecksumFlag) {
+        RETURN_ERROR_IF((size_t)(srcEnd - srcPtr) < 4, frameSize_wrong);
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+        {   U32 const readCRC = LZ4F_readLE32(srcPtr);
+            U32 const resultCRC = XXH32_digest(cs.contentChecksum);
+            RETURN_ERROR_IF(readCRC != resultCRC, contentChecksum_invalid);
+        }
+#endif
+        srcPtr += 4;
+    }
+    RETURN_ERROR_IF(srcPtr != srcEnd, srcSize_tooLarge);
+
+    return (size_t)(dstPtr - dstStart);
+}
+
+size_t LZ4F_decompressFrame(void* dstBuffer, size_t dstCapacity,
+                      const void* srcBuffer, size_t srcSize,
+                      const void* dict, size_t dictSize)
+{
+    return LZ4F_decompressFrame_internal(dstBuffer, dstCapacity, srcBuffer, srcSize, dict, dictSize, 0);
+}
+
+size_t LZ4F_decompressInplaceBound(size_t contentSize, const LZ4F_frameInfo_t* frameInfoPtr)
+{
+    LZ4F_blockSizeID_t const bid = frameInfoPtr ? frameInfoPtr->blockSizeID : LZ4F_max4MB;
+    size_t const blockSize = LZ4F_getBlockSize(bid == LZ4F_default ? LZ4F_max64KB : bid);
+    size_t const nbBlocks = (contentSize + blockSize - 1) / blockSize;
+    size_t const blockCRCSize = (frameInfoPtr == NULL || frameInfoPtr->blockChecksumFlag) ? BFSize : 0;
+    size_t const frameCRCSize = (frameInfoPtr == NULL || frameInfoPtr->contentChecksumFlag) ? 4 : 0;
+    /* Input of each block ends at least (margin - block overhead of following blocks) after its output.
+     * LZ4_DECOMPRESS_INPLACE_MARGIN() is larger than maxFHSize, so the frame header also fits. */
+    size_t const margin = LZ4_DECOMPRESS_INPLACE_MARGIN(blockSize)
+                        + nbBlocks * (BHSize + blockCRCSize)
+                        + BHSize /* endMark */ + frameCRCSize;
+    assert(LZ4_DECOMPRESS_INPLACE_MARGIN(0) >= maxFHSize);
+    return contentSize + margin;
+}
+
+size_t LZ4F_decompress_inplace(void* buffer, size_t bufferSize, size_t frameSize)
+{
+    RETURN_ERROR_IF(buffer == NULL, parameter_null);
+    RETURN_ERROR_IF(frameSize > bufferSize, srcSize_tooLarge);
+    return LZ4F_decompressFrame_internal(buffer, bufferSize,
+                                         (const BYTE*)buffer + (bufferSize - frameSize), frameSize,
+                                         NULL, 0, 1);
+}
+
+
+/*-***************************************************
+*   Seekable decompression
+*****************************************************/
+
+size_t LZ4F_seekTableFrameSize(const void* footer, size_t footerSize)
+{
+    const BYTE* fPtr;
+    RETURN_ERROR_IF(footerSize < LZ4F_SEEKTABLE_FOOTER_SIZE, frameHeader_incomplete);
+    fPtr = (const BYTE*)footer + footerSize - LZ4F_SEEKTABLE_FOOTER_SIZE;
+    RETURN_ERROR_IF(LZ4F_readLE32(fPtr+5) != LZ4F_SEEKTABLE_FOOTER_MAGIC, seekTable_invalid);
+    RETURN_ERROR_IF(fPtr[4] != 0, seekTable_invalid);   /* reserved descriptor */
+    {   U64 const nbBlocks = LZ4F_readLE32(fPtr);
+        U64 const frameSize = 8 + nbBlocks * LZ4F_SEEKTABLE_ENTRY_SIZE + LZ4F_SEEKTABLE_FOOTER_SIZE;
+        RETURN_ERROR_IF(frameSize - 8 > 0xFFFFFFFFU, seekTable_invalid);
+        return (size_t)frameSize;
+    }
+}
+
+size_t LZ4F_seekableDecompress(LZ4F_dctx* dctx,
+                               void* dstBuffer, size_t dstCapacity,
+                         const void* srcBuffer, size_t srcSize,
+                               unsigned long long offset)
+{
+    const BYTE* const srcStart = (const BYTE*)srcBuffer;
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+    unsigned long long const rangeEnd = offset + dstCapacity;
+    unsigned long long dPos = 0;
+    size_t tableFrameSize, cPos, framEnd, nbBlocks, n;
+    const BYTE* entries;
+    const BYTE* verifiedEnd = srcStart;   /* blocks before this position have a verified checksum */
+
+    DEBUGLOG(5, "LZ4F_seekableDecompress (offset=%llu, size=%u)", offset, (unsigned)dstCapacity);
+    RETURN_ERROR_IF(srcSize < minFHSize + 8 + LZ4F_SEEKTABLE_FOOTER_SIZE, frameHeader_incomplete);
+
+    /* locate seek table */
+    tableFrameSize = LZ4F_seekTableFrameSize(srcStart, srcSize);
+    FORWARD_IF_ERROR(tableFrameSize);
+    RETURN_ERROR_IF(tableFrameSize > srcSize - minFHSize, seekTable_invalid);
+    framEnd = srcSize - tableFrameSize;
+    RETURN_ERROR_IF(LZ4F_readLE32(srcStart + framEnd) != LZ4F_SEEKTABLE_MAGICNUMBER, seekTable_invalid);
+    RETURN_ERROR_IF(LZ4F_readLE32(srcStart + framEnd + 4) != tableFrameSize - 8, seekTable_invalid);
+    entries = srcStart + framEnd + 8;
+    nbBlocks = (tableFrameSize - 8 - LZ4F_SEEKTABLE_FOOTER_SIZE) / LZ4F_SEEKTABLE_ENTRY_SIZE;
+
+    /* decode frame header */
+    LZ4F_resetDecompressionContext(dctx);
+    {   size_t const hSize = LZ4F_decodeHeader(dctx, srcStart, framEnd);
+        FORWARD_IF_ERROR(hSize);
+        RETURN_ERROR_IF(dctx->dStage != dstage_init, frameType_unknown);
+        RETURN_ERROR_IF(dctx->frameInfo.blockMode != LZ4F_blockIndependent, blockMode_invalid);
+        RETURN_ERROR_IF(dctx->frameInfo.dictID != 0, parameter_invalid);   /* dictionary can't be provided */
+        cPos = hSize;
+    }
+    FORWARD_IF_ERROR( LZ4F_allocDecodingBuffers(dctx) );
+
+    for (n=0; (n<nbBlocks) && (dPos < rangeEnd); n++) {
+        size_t const cBlockSize = LZ4F_readLE32(entries + n*LZ4F_SEEKTABLE_ENTRY_SIZE);
+        size_t const dBlockSize = LZ4F_readLE32(entries + n*LZ4F_SEEKTABLE_ENTRY_SIZE + 4);
+        RETURN_ERROR_IF(cBlockSize > framEnd - cPos, seekTable_invalid);
+        RETURN_ERROR_IF(dBlockSize > dctx->maxBlockSize, seekTable_invalid);
+
+        if (dPos + dBlockSize > offset) {
+            /* block overlaps requested range */
+            const BYTE* const blockStart = srcStart + cPos;
+            U32 const blockHeader = LZ4F_readLE32(blockStart);
+            size_t const cSize = blockHeader & 0x7FFFFFFFU;
+            size_t const crcSize = dctx->frameInfo.blockChecksumFlag * BFSize;
+            size_t const skipped = (dPos < offset) ? (size_t)(offset - dPos) : 0;
+            size_t const wanted = (size_t)MIN((unsigned long long)(dBlockSize - skipped), rangeEnd - (dPos + skipped));
+            RETURN_ERROR_IF(cBlockSize != BHSize + cSize + crcSize, seekTable_invalid);
+
+            if (crcSize && !dctx->skipChecksum && blockStart >= verifiedEnd) {
+                /* verify this block and next requested ones together */
+                size_t batchSize = 0, verified, b;
+                unsigned long long bPos = dPos;
+                for (b = n; (b < nbBlocks) && (b < n + LZ4F_CHECKSUM_BATCH) && (bPos < rangeEnd); b++) {
+                    batchSize += LZ4F_readLE32(entries + b*LZ4F_SEEKTABLE_ENTRY_SIZE);
+                    bPos += LZ4F_readLE32(entries + b*LZ4F_SEEKTABLE_ENTRY_SIZE + 4);
+                }
+                verified = LZ4F_verifyBlockChecksums(blockStart, MIN(batchSize, framEnd - cPos), dctx->maxBlockSize);
+                FORWARD_IF_ERROR(verified);
+                RETURN_ERROR_IF(verified < cBlockSize, seekTable_invalid);
+                verifiedEnd = blockStart + verified;
+            }
+
+            if (blockHeader & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
+                RETURN_ERROR_IF(cSize != dBlockSize, seekTable_invalid);
+                memcpy(dstPtr, blockStart + BHSize + skipped, wanted);
+            } else if (wanted == dBlockSize) {
+                /* entire block requested : decode directly into dst */
+                int decodedSize = LZ4F_decodeWithCodec(dctx, blockStart + BHSize, dstPtr, (int)cSize, (int)dBlockSize);
+                if (decodedSize < 0)
+                    decodedSize = LZ4_decompress_safe((const char*)blockStart + BHSize, (char*)dstPtr,
+                                                      (int)cSize, (int)dBlockSize);
+                RETURN_ERROR_IF((size_t)decodedSize != dBlockSize, decompressionFailed);
+            } else {
+                int decodedSize = LZ4F_decodeWithCodec(dctx, blockStart + BHSize, dctx->tmpOutBuffer, (int)cSize, (int)dctx->maxBlockSize);
+                if (decodedSize < 0)
+                    decodedSize = LZ4_decompress_safe((const char*)blockStart + BHSize, (char*)dctx->tmpOutBuffer,
+                                                      (int)cSize, (int)dctx->maxBlockSize);
+                RETURN_ERROR_IF((size_t)decodedSize != dBlockSize, decompressionFailed);
+                memcpy(dstPtr, dctx->tmpOutBuffer + skipped, wanted);
+            }
+            dstPtr += wanted;
+        }
+
+        cPos += cBlockSize;
+        dPos += dBlockSize;
+    }
+
+    LZ4F_resetDecompressionContext(dctx);
+    return (size_t)(dstPtr - dstStart);
+}
+
+
+/*-***************************************************
+*   Context pool
+*****************************************************/
+
+#define LZ4F_POOL_NB_BSID 4   /* LZ4F_max64KB .. LZ4F_max4MB */
+
+struct LZ4F_ctxPool_s {
+    LZ4F_CustomMem cmem;
+    unsigned maxPerKey;
+    long lock;
+    LZ4F_cctx* cctxList[2][LZ4F_POOL_NB_BSID];   /* [fast, HC][blockSizeID] */
+    unsigned   cctxCount[2][LZ4F_POOL_NB_BSID];
+    LZ4F_dctx* dctxList[LZ4F_POOL_NB_BSID];
+    unsigned   dctxCount[LZ4F_POOL_NB_BSID];
+};  /* typedef'd to LZ4F_ctxPool within lz4frame.h */
+
+LZ4F_ctxPool* LZ4F_createCtxPool(LZ4F_CustomMem customMem, unsigned maxPerKey)
+{
+    LZ4F_ctxPool* const pool = (LZ4F_ctxPool*)LZ4F_calloc(sizeof(LZ4F_ctxPool), customMem);
+    if (pool == NULL) return NULL;
+    pool->cmem = customMem;
+    pool->maxPerKey = maxPerKey;
+    return pool;
+}
+
+void LZ4F_freeCtxPool(LZ4F_ctxPool* pool)
+{
+    int f, b;
+    if (pool == NULL) return;   /* support free on NULL */
+    for (b = 0; b < LZ4F_POOL_NB_BSID; b++) {
+        for (f = 0; f < 2; f++) {
+            while (pool->cctxList[f][b] != NULL) {
+                LZ4F_cctx* const cctx = pool->cctxList[f][b];
+                pool->cctxList[f][b] = cctx->poolNext;
+                LZ4F_freeCompressionContext(cctx);
+        }   }
+        while (pool->dctxList[b] != NULL) {
+            LZ4F_dctx* const dctx = pool->dctxList[b];
+            pool->dctxList[b] = dctx->poolNext;
+            LZ4F_freeDecompressionContext(dctx);
+    }   }
+    LZ4F_free(pool, pool->cmem);
+}
+
+/* LZ4F_poolBSIndex() :
+ * @return : index of the largest block size which frames can use
+ *           with a tmp buffer of @bufferSize bytes in blockLinked mode, or -1 if none */
+static int LZ4F_poolBSIndex(size_t bufferSize)
+{
+    int b;
+    for (b = LZ4F_POOL_NB_BSID-1; b >= 0; b--) {
+        if (LZ4F_getBlockSize((LZ4F_blockSizeID_t)(LZ4F_max64KB + b)) + 128 KB <= bufferSize)
+            return b;
+    }
+    return -1;
+}
+
+LZ4F_cctx* LZ4F_ctxPool_getCCtx(LZ4F_ctxPool* pool, const LZ4F_preferences_t* preferencesPtr)
+{
+    LZ4F_preferences_t const prefNull = LZ4F_INIT_PREFERENCES;
+    LZ4F_preferences_t const* const prefs = (preferencesPtr != NULL) ? preferencesPtr : &prefNull;
+    LZ4F_blockSizeID_t const bsid = (prefs->frameInfo.blockSizeID == LZ4F_default) ?
+                                    LZ4F_BLOCKSIZEID_DEFAULT : prefs->frameInfo.blockSizeID;
+    int const family = (prefs->compressionLevel >= LZ4HC_CLEVEL_MIN);
+    int const b = (int)bsid - LZ4F_max64KB;
+    LZ4F_cctx* cctx;
+    DEBUGLOG(5, "LZ4F_ctxPool_getCCtx (family=%i, bsid=%i)", family, (int)bsid);
+    if (b < 0 || b >= LZ4F_POOL_NB_BSID) return NULL;
+
+    LZ4F_LOCK(pool);
+    cctx = pool->cctxList[family][b];
+    if (cctx != NULL) {
+        pool->cctxList[family][b] = cctx->poolNext;
+        pool->cctxCount[family][b]--;
+    }
+    LZ4F_UNLOCK(pool);
+    if (cctx != NULL) {
+        cctx->poolNext = NULL;
+        return cctx;
+    }
+
+    /* pool is empty for this key : create a context, sized for worst case (blockLinked, no autoFlush) */
+    cctx = LZ4F_createCompressionContext_advanced(pool->cmem, LZ4F_VERSION);
+    if (cctx == NULL) return NULL;
+    cctx->prefs = *prefs;
+    {   size_t const buffSize = LZ4F_getBlockSize(bsid) + 128 KB;
+        cctx->tmpBuff = (BYTE*)LZ4F_malloc(buffSize, cctx->cmem);
+        if ( (cctx->tmpBuff == NULL)
+          || LZ4F_isError(LZ4F_prepareCtx(cctx)) ) {
+            LZ4F_freeCompressionContext(cctx);
+            return NULL;
+        }
+        cctx->maxBufferSize = buffSize;
+    }
+    return cctx;
+}
+
+void LZ4F_ctxPool_releaseCCtx(LZ4F_ctxPool* pool, LZ4F_cctx* cctx)
+{
+    int const b = (cctx != NULL) ? LZ4F_poolBSIndex(cctx->maxBufferSize) : -1;
+    int family;
+    if (cctx == NULL) return;
+    family = (cctx->lz4CtxAlloc == ctxHC);
+    if (b < 0 || cctx->lz4CtxAlloc == ctxNone) {
+        LZ4F_freeCompressionContext(cctx);
+        return;
+    }
+    /* forget anything tied to last usage */
+    cctx->cStage = 0;
+    cctx->cdict = NULL;
+    cctx->seekTableMode = 0;
+    cctx->seekTableNbBlocks = 0;
+    LZ4F_setCompressionCodec(cctx, NULL);
+#if LZ4F_COMPRESSION_STATS
+    cctx->statsEnabled = 0;
+#endif
+
+    LZ4F_LOCK(pool);
+    if (pool->cctxCount[family][b] < pool->maxPerKey) {
+        cctx->poolNext = pool->cctxList[family][b];
+        pool->cctxList[family][b] = cctx;
+        pool->cctxCount[family][b]++;
+        cctx = NULL;
+    }
+    LZ4F_UNLOCK(pool);
+    LZ4F_freeCompressionContext(cctx);   /* pool full for this key */
+}
+
+LZ4F_dctx* LZ4F_ctxPool_getDCtx(LZ4F_ctxPool* pool, LZ4F_blockSizeID_t blockSizeID)
+{
+    LZ4F_blockSizeID_t const bsid = (blockSizeID == LZ4F_default) ? LZ4F_max4MB : blockSizeID;
+    int const b = (int)bsid - LZ4F_max64KB;
+    LZ4F_dctx* dctx;
+    DEBUGLOG(5, "LZ4F_ctxPool_getDCtx (bsid=%i)", (int)bsid);
+    if (b < 0 || b >= LZ4F_POOL_NB_BSID) return NULL;
+
+    LZ4F_LOCK(pool);
+    dctx = pool->dctxList[b];
+    if (dctx != NULL) {
+        pool->dctxList[b] = dctx->poolNext;
+        pool->dctxCount[b]--;
+    }
+    LZ4F_UNLOCK(pool);
+    if (dctx != NULL) {
+        dctx->poolNext = NULL;
+        return dctx;
+    }
+
+    /* pool is empty for this key : create a context, sized for blockLinked frames */
+    dctx = LZ4F_createDecompressionContext_advanced(pool->cmem, LZ4F_VERSION);
+    if (dctx == NULL) return NULL;
+    dctx->maxBlockSize = LZ4F_getBlockSize(bsid);
+    dctx->frameInfo.blockMode = LZ4F_blockLinked;
+    if (LZ4F_isError(LZ4F_allocDecodingBuffers(dctx))) {
+        LZ4F_freeDecompressionContext(dctx);
+        return NULL;
+    }
+    return dctx;
+}
+
+void LZ4F_ctxPool_releaseDCtx(LZ4F_ctxPool* pool, LZ4F_dctx* dctx)
+{
+    int const b = (dctx != NULL) ? LZ4F_poolBSIndex(dctx->maxBufferSize) : -1;
+    if (dctx == NULL) return;
+    if (b < 0) {
+        LZ4F_freeDecompressionContext(dctx);
+        return;
+    }
+    /* forget anything tied to last usage */
+    LZ4F_resetDecompressionContext(dctx);
+    LZ4F_setDecoderRingBuffer(dctx, NULL, 0);
+    LZ4F_setDecompressionCodec(dctx, NULL);
+
+    LZ4F_LOCK(pool);
+    if (pool->dctxCount[b] < pool->maxPerKey) {
+        dctx->poolNext = pool->dctxList[b];
+        pool->dctxList[b] = dctx;
+        pool->dctxCount[b]++;
+        dctx = NULL;
+    }
+    LZ4F_UNLOCK(pool);
+    LZ4F_freeDecompressionContext(dctx);   /* pool full for this key */
+}
+
+
+/*-***************************************************
+*   Arena allocation
+*****************************************************/
+
+#define LZ4F_ARENA_ALIGNMENT 16   /* enough for all internal states */
+
+static void* LZ4F_arenaAlloc(void* opaqueState, size_t size)
+{
+    LZ4F_Arena* const arena = (LZ4F_Arena*)opaqueState;
+    BYTE* const next = (BYTE*)arena->buffer + arena->used;
+    size_t const pad = (size_t)(0 - (size_t)next) & (LZ4F_ARENA_ALIGNMENT-1);
+    size_t const available = arena->capacity - arena->used;
+    if ((size > available) || (pad > available - size)) {
+        DEBUGLOG(4, "LZ4F_arenaAlloc : arena exhausted (%u bytes requested, %u available)",
+                    (unsigned)size, (unsigned)available);
+        return NULL;
+    }
+    arena->used += pad + size;
+    return next + pad;
+}
+
+static void* LZ4F_arenaCalloc(void* opaqueState, size_t size)
+{
+    void* const p = LZ4F_arenaAlloc(opaqueState, size);
+    if (p != NULL) MEM_INIT(p, 0, size);
+    return p;
+}
+
+static void LZ4F_arenaFree(void* opaqueState, void* address)
+{
+    (void)opaqueState; (void)address;   /* memory is reclaimed all at once, by LZ4F_resetArena() */
+}
+
+void LZ4F_initArena(LZ4F_Arena* arena, void* buffer, size_t capacity)
+{
+    arena->buffer = buffer;
+    arena->capacity = (buffer != NULL) ? capacity : 0;
+    arena->used = 0;
+}
+
+void LZ4F_resetArena(LZ4F_Arena* arena)
+{
+    arena->used = 0;
+}
+
+LZ4F_CustomMem LZ4F_arenaCustomMem(LZ4F_Arena* arena)
+{
+    LZ4F_CustomMem cmem;
+    cmem.customAlloc = LZ4F_arenaAlloc;
+    cmem.customCalloc = LZ4F_arenaCalloc;
+    cmem.customFree = LZ4F_arenaFree;
+    cmem.opaqueState = arena;
+    return cmem;
+}
+
+size_t LZ4F_cctxArenaSize(const LZ4F_preferences_t* preferencesPtr)
+{
+    LZ4F_preferences_t const prefNull = LZ4F_INIT_PREFERENCES;
+    LZ4F_preferences_t const* const prefs = (preferencesPtr != NULL) ? preferencesPtr : &prefNull;
+    LZ4F_blockSizeID_t const bsid = (prefs->frameInfo.blockSizeID == LZ4F_default) ?
+                                    LZ4F_BLOCKSIZEID_DEFAULT : prefs->frameInfo.blockSizeID;
+    size_t const blockSize = LZ4F_getBlockSize(bsid);
+    size_t const linked = (prefs->frameInfo.blockMode == LZ4F_blockLinked);
+    size_t const buffSize = prefs->autoFlush ? (linked ? 64 KB : 0) : blockSize + (linked ? 128 KB : 0);
+    size_t const stateSize = (prefs->compressionLevel < LZ4HC_CLEVEL_MIN) ?
+                             LZ4F_fastCtxSize(prefs->memoryUsage) : sizeof(LZ4_streamHC_t);
+    if (LZ4F_isError(blockSize)) return 0;
+    return sizeof(LZ4F_cctx) + buffSize + stateSize + 3 * (LZ4F_ARENA_ALIGNMENT-1);
+}
+
+size_t LZ4F_dctxArenaSize(LZ4F_blockSizeID_t blockSizeID)
+{
+    LZ4F_blockSizeID_t const bsid = (blockSizeID == LZ4F_default) ? LZ4F_max4MB : blockSizeID;
+    size_t const blockSize = LZ4F_getBlockSize(bsid);
+    if (LZ4F_isError(blockSize)) return 0;
+    return sizeof(LZ4F_dctx)
+         + (blockSize + BFSize)    /* tmpIn */
+         + (blockSize + 128 KB)    /* tmpOutBuffer, blockLinked */
+         + 3 * (LZ4F_ARENA_ALIGNMENT-1);
+}
@@ -188,16 +188,21 @@ typedef struct {
  *  makes it possible to supply advanced compression instructions to streaming interface.
  *  Structure must be first init to 0, using memset() or LZ4F_INIT_PREFERENCES,
  *  setting all parameters to default.
- *  All reserved fields must be set to zero. */
+ *  All reserved fields must be set to zero.
+ *  Note : `memoryUsage` and `skipIncompressible` occupy what used to be `reserved` slots.
+ *  Positional initializers written against earlier versions must be updated ;
+ *  LZ4F_INIT_PREFERENCES or memset() are not affected. */
 typedef struct {
   LZ4F_frameInfo_t frameInfo;
   int      compressionLevel;    /* 0: default (fast mode); values > LZ4HC_CLEVEL_MAX count as LZ4HC_CLEVEL_MAX; values < 0 trigger "fast acceleration" */
   unsigned autoFlush;           /* 1: always flush; reduces usage of internal buffers */
   unsigned favorDecSpeed;       /* 1: parser favors decompression speed vs compression ratio. Only works for high compression modes (>= LZ4HC_CLEVEL_OPT_MIN) */  /* v1.8.2+ */
-  unsigned reserved[3];         /* must be zero for forward compatibility */
+  unsigned memoryUsage;         /* 0: default (LZ4_MEMORY_USAGE); otherwise hash table size (log2, in bytes) of fast mode, within [10, 20]. Ignored by high compression modes */
+  unsigned skipIncompressible;  /* 1: blocks estimated incompressible, by a quick probe, are stored uncompressed without attempting compression. Only for high compression modes with independent blocks */
+  unsigned reserved[1];         /* must be zero for forward compatibility */
 } LZ4F_preferences_t;
 
-#define LZ4F_INIT_PREFERENCES   { LZ4F_INIT_FRAMEINFO, 0, 0u, 0u, { 0u, 0u, 0u } }    /* v1.8.3+ */
+#define LZ4F_INIT_PREFERENCES   { LZ4F_INIT_FRAMEINFO, 0, 0u, 0u, 0u, 0u, { 0u } }    /* v1.8.3+ */
 
 
 /*-*********************************
@@ -496,6 +501,12 @@ LZ4F_getFrameInfo(LZ4F_dctx* dctx,
  *  After a decompression error, the `dctx` context is not resumable.
  *  Use LZ4F_resetDecompressionContext() to return to clean state.
  *
+ *  Note : block checksums are verified while (or after) decoding the block, not before :
+ *  when a block is corrupted, dstBuffer may already contain its decoded (invalid) data
+ *  when LZ4F_decompress() returns LZ4F_ERROR_blockChecksum_invalid.
+ *  The same applies to content checksum, which is only verified at end of frame.
+ *  dstBuffer content written by an invocation which returns an error must be discarded.
+ *
  *  After a frame is fully decoded, dctx can be used again to decompress another frame.
  */
 LZ4FLIB_API size_t
@@ -572,6 +583,7 @@ extern "C" {
         ITEM(ERROR_parameter_null) \
         ITEM(ERROR_io_write) \
         ITEM(ERROR_io_read) \
+        ITEM(ERROR_seekTable_invalid) \
         ITEM(ERROR_maxCode)
 
 #define LZ4F_GENERATE_ENUM(ENUM) LZ4F_##ENUM,
@@ -612,6 +624,320 @@ LZ4F_uncompressedUpdate(LZ4F_cctx* cctx,
                   const void* srcBuffer, size_t srcSize,
                   const LZ4F_compressOptions_t* cOptPtr);
 
+/**********************************
+ *  Vectored (scatter / gather) API
+ *********************************/
+
+/*! LZ4F_iovec :
+ *  A buffer fragment. Layout matches POSIX `struct iovec`. */
+typedef struct {
+    void*  iov_base;
+    size_t iov_len;
+} LZ4F_iovec;
+
+/*! LZ4F_compressUpdatev() :
+ *  Same as LZ4F_compressUpdate(), for input scattered across @iovcnt fragments (gather).
+ *  Output is identical to a single LZ4F_compressUpdate() invocation on the concatenated input :
+ *  blocks are cut across fragment boundaries, and autoFlush only applies at the end of the vector.
+ *  Blocks entirely contained within a fragment are compressed in place,
+ *  only blocks spanning multiple fragments are gathered within the context.
+ * @dstCapacity MUST be >= LZ4F_compressBound(totalSize, preferencesPtr),
+ *  with totalSize the sum of all fragment sizes.
+ * @return : number of bytes written into dstBuffer (can be zero),
+ *           or an error code if it fails (which can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressUpdatev(LZ4F_cctx* cctx,
+                     void* dstBuffer, size_t dstCapacity,
+               const LZ4F_iovec* iov, int iovcnt,
+               const LZ4F_compressOptions_t* cOptPtr);
+
+/*! LZ4F_compressUpdate_destSize() :
+ *  Compresses as much input as fits into @dstCapacity, for frames which must fit a fixed budget
+ *  (a flash page, a network datagram, etc.).
+ *  Complete blocks are written as long as they fit, even stored uncompressed.
+ *  Then a last block is cut, using LZ4_compress_destSize() or LZ4_compress_HC_continue_destSize(),
+ *  so that output fills @dstCapacity, save for a few bytes.
+ *  Input which doesn't fit is not buffered : it's left to the caller, for next call or next frame.
+ *  Room for frame header and frame footer must be reserved by the caller :
+ *  an entire frame fits into `budget` bytes when @dstCapacity is
+ *  `budget - headerSize - 4 (endMark) - 4 (if content checksum enabled)`.
+ *  Input buffered by a previous LZ4F_compressUpdate() must be flushed first, with LZ4F_flush().
+ *  In fast mode, the last block doesn't use history nor dictionary.
+ * @srcSizePtr : in : size of @srcBuffer ; out : nb of bytes consumed from @srcBuffer.
+ * @return : number of bytes written into dstBuffer,
+ *           or an error code if it fails (which can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressUpdate_destSize(LZ4F_cctx* cctx,
+                             void* dstBuffer, size_t dstCapacity,
+                       const void* srcBuffer, size_t* srcSizePtr,
+                       const LZ4F_compressOptions_t* cOptPtr);
+
+/*! LZ4F_compressUpdate_budget() :
+ *  Same as LZ4F_compressUpdate(), but stops after parsing about @budget bytes of input,
+ *  so that an event loop can interleave compression with other work.
+ *  The library has no clock : the budget is counted in input bytes, calibrated by the caller.
+ *  With HC levels, compression can stop in the middle of a block : it remains pending within @cctx,
+ *  and resumes on next invocation. Faster levels compress one whole block at a time.
+ *  Input is only consumed while no block is pending. Input not consumed must be provided again.
+ *  LZ4F_flush(), LZ4F_compressEnd() and LZ4F_compressUpdate() complete a pending block.
+ *  Block boundaries are the same as with LZ4F_compressUpdate(), and so is output for levels 3 - 9.
+ *  From level 10, match finder state restarts on each resume, so output can differ slightly.
+ * @srcSizePtr : in : size of @srcBuffer ; out : nb of bytes consumed from @srcBuffer.
+ * @dstCapacity MUST be >= LZ4F_compressBound(*srcSizePtr, preferencesPtr).
+ * @return : number of bytes written into dstBuffer (can be zero),
+ *           or an error code if it fails (which can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressUpdate_budget(LZ4F_cctx* cctx,
+                           void* dstBuffer, size_t dstCapacity,
+                     const void* srcBuffer, size_t* srcSizePtr,
+                           size_t budget,
+                     const LZ4F_compressOptions_t* cOptPtr);
+
+/*! LZ4F_compressPending() :
+ * @return 1 if @cctx holds a block which LZ4F_compressUpdate_budget() has yet to compress,
+ *  either in progress, or full and waiting for budget, 0 otherwise. */
+LZ4FLIB_STATIC_API int LZ4F_compressPending(const LZ4F_cctx* cctx);
+
+/*! LZ4F_appendBlock() :
+ *  Appends to current frame a block compressed elsewhere, without recompressing it,
+ *  typically a block copied from another frame, to merge frames.
+ * @block points at the block as stored within a frame : 4-byte block header followed by block data,
+ *  without block checksum. @blockSize includes the block header.
+ *  Block checksum is calculated when @cctx frame uses them.
+ * @decodedSize : decompressed size of the block, necessarily <= max block size of @cctx frame.
+ * @decoded : decompressed content, only needed when content checksum is enabled, otherwise can be NULL.
+ *  @cctx frame must use LZ4F_blockIndependent, and no input must be buffered (see LZ4F_flush()).
+ *  Block must have been compressed with the same dictionary as @cctx frame, if any : this is not checked.
+ * @dstCapacity MUST be >= @blockSize + 4.
+ * @return : number of bytes written into dstBuffer,
+ *           or an error code if it fails (which can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_appendBlock(LZ4F_cctx* cctx,
+                 void* dstBuffer, size_t dstCapacity,
+           const void* block, size_t blockSize,
+           const void* decoded, size_t decodedSize);
+
+/*! LZ4F_compressBegin_append() :
+ *  Prepares @cctx to continue an existing frame, instead of starting a new one : nothing is written.
+ *  The existing frame must then be overwritten from its EndMark onward :
+ *  next blocks take its place, and LZ4F_compressEnd() writes a new EndMark and content checksum.
+ *  @prefsPtr->frameInfo must describe the existing frame, as provided by LZ4F_getFrameInfo().
+ *  This frame must use LZ4F_blockIndependent, and neither content size nor dictID.
+ *  Seek table must be disabled (see LZ4F_enableSeekTable()).
+ *  When the frame has a content checksum, its whole content must be provided to LZ4F_appendPriorContent(),
+ *  before any new input. Other fields of @prefsPtr apply to new blocks only.
+ * @return : 0, or an error code (which can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressBegin_append(LZ4F_cctx* cctx, const LZ4F_preferences_t* prefsPtr);
+
+/*! LZ4F_appendPriorContent() :
+ *  Accounts for decoded content already present in the frame continued by @cctx,
+ *  so that the content checksum written by LZ4F_compressEnd() covers it.
+ *  Content must be provided in order, possibly in several pieces, right after LZ4F_compressBegin_append().
+ *  Nothing is compressed nor written. Does nothing when frame has no content checksum.
+ * @return : 0, or an error code (which can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_appendPriorContent(LZ4F_cctx* cctx, const void* content, size_t contentSize);
+
+/*! LZ4F_decompressv() :
+ *  Same as LZ4F_decompress(), with decoded data scattered across @iovcnt fragments.
+ *  Fragments are filled in order, each one completely before the next.
+ *  Decoding stops when input is exhausted or the frame is completed.
+ * @dstSizePtr receives the total number of bytes written across all fragments,
+ * @srcSizePtr is updated with the number of bytes consumed from srcBuffer.
+ * @return : same as LZ4F_decompress() : a hint of the next srcSize, 0 when frame is completed,
+ *           or an error code (which can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_decompressv(LZ4F_dctx* dctx,
+           const LZ4F_iovec* iov, int iovcnt, size_t* dstSizePtr,
+           const void* srcBuffer, size_t* srcSizePtr,
+           const LZ4F_decompressOptions_t* dOptPtr);
+
+/**********************************
+ *  Parallel compression API
+ *********************************/
+
+/*! LZ4F_Executor :
+ *  Lets the caller provide its own job scheduler (thread pool, task system, etc.),
+ *  so that the library itself doesn't depend on any threading implementation.
+ * `submitJob` must invoke job(jobArg) exactly once, from any thread.
+ *  It may also run the job synchronously, before returning.
+ * `completeJobs` must only return once all previously submitted jobs are completed.
+ */
+typedef void (*LZ4F_JobFunction) (void* jobArg);
+typedef struct {
+    void (*submitJob) (void* opaqueState, LZ4F_JobFunction job, void* jobArg);
+    void (*completeJobs) (void* opaqueState);
+    void* opaqueState;
+} LZ4F_Executor;
+
+/*! LZ4F_compressFrame_MT() :
+ *  Same as LZ4F_compressFrame(), but input is cut into segments of 4 MB,
+ *  which are compressed concurrently, as jobs submitted to @executor.
+ *  Blocks are necessarily independent : preferencesPtr->frameInfo.blockMode is ignored.
+ *  Block checksums and content checksum are supported, and calculated by jobs too.
+ * @executor is optional : when NULL, all jobs are run serially, in the calling thread.
+ *  Memory is allocated with malloc(); see LZ4F_compressFrame_MT_advanced() for custom allocators.
+ * @dstCapacity MUST be >= LZ4F_compressFrameBound(srcSize, preferencesPtr).
+ * @return : number of bytes written into dstBuffer,
+ *           or an error code if it fails (can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressFrame_MT(void* dstBuffer, size_t dstCapacity,
+                const void* srcBuffer, size_t srcSize,
+                const LZ4F_preferences_t* preferencesPtr,
+                const LZ4F_Executor* executor);
+
+/**********************************
+ *  Block codec offload
+ *********************************/
+
+/*! LZ4F_BlockCodec :
+ *  External implementation of the LZ4 block format, typically a hardware accelerator.
+ *  LZ4F keeps handling frame and block headers, checksums, and block order :
+ *  only compression and decoding of block content are delegated.
+ *  The codec is only invoked for blocks which don't depend on any history,
+ *  i.e. independent blocks, without dictionary. Other blocks are processed by the CPU.
+ * `compressBlock` : compresses @srcSize bytes from @src into @dst, of capacity @dstCapacity, as one LZ4 block.
+ *                   @level is the frame's compression level, it can be ignored.
+ *                   @return : compressed size,
+ *                             0 if it doesn't fit into @dstCapacity : block is then stored uncompressed,
+ *                             or < 0 if the block can't be processed now (device busy or unavailable) :
+ *                             it's then compressed by the CPU.
+ * `decompressBlock` : decodes LZ4 block @src, of @srcSize bytes, into @dst, of capacity @dstCapacity.
+ *                   @return : decoded size,
+ *                             or < 0 if the block isn't decoded, for any reason : it's then decoded by the CPU,
+ *                             which is also in charge of reporting corrupted blocks.
+ *  Either function can be NULL, to only offload one direction.
+ *  Functions are invoked synchronously, by the thread using the context.
+ */
+typedef struct {
+    int (*compressBlock) (void* opaqueState, const char* src, char* dst, int srcSize, int dstCapacity, int level);
+    int (*decompressBlock) (void* opaqueState, const char* src, char* dst, int srcSize, int dstCapacity);
+    void* opaqueState;
+} LZ4F_BlockCodec;
+
+/*! LZ4F_setCompressionCodec() :
+ *  Registers @codec, which is copied, for next blocks compressed by @cctx, including following frames.
+ *  Use @codec==NULL to compress with the CPU only. */
+LZ4FLIB_STATIC_API void LZ4F_setCompressionCodec(LZ4F_cctx* cctx, const LZ4F_BlockCodec* codec);
+
+/*! LZ4F_setDecompressionCodec() :
+ *  Registers @codec, which is copied, for next blocks decoded by @dctx, including following frames.
+ *  Used by LZ4F_decompress() and its variants, but not by one-shot functions without context,
+ *  such as LZ4F_decompressFrame(). Use @codec==NULL to decode with the CPU only. */
+LZ4FLIB_STATIC_API void LZ4F_setDecompressionCodec(LZ4F_dctx* dctx, const LZ4F_BlockCodec* codec);
+
+/**********************************
+ *  Seekable frames
+ *********************************/
+
+/* A seek table is a skippable frame, appended right after the frame it indexes.
+ * It lists, for each block, its compressed size (including block header and checksum)
+ * and its decompressed size, and ends with a fixed-size footer,
+ * so that it can be found starting from the end of data.
+ * Decoders unaware of seek tables simply skip it.
+ * Random access requires independent blocks (LZ4F_blockIndependent).
+ * Entries index blocks, not frames : the layout is not compatible with zstd's seekable format,
+ * so magic numbers are distinct from the ones it uses (0x184D2A5E, 0x8F92EAB1). */
+#define LZ4F_SEEKTABLE_MAGICNUMBER  0x184D2A5BU
+#define LZ4F_SEEKTABLE_FOOTER_MAGIC 0x53345A4CU   /* "LZ4S" */
+#define LZ4F_SEEKTABLE_ENTRY_SIZE   8
+#define LZ4F_SEEKTABLE_FOOTER_SIZE  9
+
+/*! LZ4F_setCompressionLevel() :
+ *  Changes compression level of an ongoing frame, between LZ4F_compressUpdate() calls.
+ *  Takes effect from next block, including input already buffered within @cctx.
+ *  Any level can be selected, with independent or linked blocks :
+ *  when switching between fast (< LZ4HC_CLEVEL_MIN) and high compression levels,
+ *  history of linked blocks is transferred to the new context (up to 64 KB).
+ *  The frame header doesn't record compression level, so decoders are not impacted.
+ *  Must be invoked after LZ4F_compressBegin(), and before LZ4F_compressEnd().
+ * @return : 0, or an error code (can be tested using LZ4F_isError()).
+ *  After an error, @cctx must be re-initialized with LZ4F_compressBegin(). */
+LZ4FLIB_STATIC_API size_t LZ4F_setCompressionLevel(LZ4F_cctx* cctx, int compressionLevel);
+
+/*! LZ4F_enableSeekTable() :
+ *  Starts (or stops) recording block sizes while compressing with @cctx.
+ *  Must be invoked before LZ4F_compressBegin(). Setting is sticky across frames.
+ * @return : 0, or an error code (can be tested using LZ4F_isError()) */
+LZ4FLIB_STATIC_API size_t LZ4F_enableSeekTable(LZ4F_cctx* cctx, unsigned enable);
+
+/*! LZ4F_seekTableSize() :
+ * @return : size of the seek table for blocks compressed so far, 0 if seek table is disabled. */
+LZ4FLIB_STATIC_API size_t LZ4F_seekTableSize(const LZ4F_cctx* cctx);
+
+/*! LZ4F_writeSeekTable() :
+ *  Writes the seek table of the frame just completed by LZ4F_compressEnd().
+ *  Result must be appended immediately after the frame.
+ * @return : number of bytes written into dstBuffer (== LZ4F_seekTableSize()),
+ *           or an error code if it fails (can be tested using LZ4F_isError()) */
+LZ4FLIB_STATIC_API size_t LZ4F_writeSeekTable(LZ4F_cctx* cctx, void* dstBuffer, size_t dstCapacity);
+
+/*! LZ4F_seekTableFrameSize() :
+ * @footer : points at (at least) the last LZ4F_SEEKTABLE_FOOTER_SIZE bytes of data,
+ *           @footerSize is the number of bytes available, ending at end of data.
+ * @return : total size of the seek table skippable frame,
+ *           or an error code if footer isn't a valid seek table footer. */
+LZ4FLIB_STATIC_API size_t LZ4F_seekTableFrameSize(const void* footer, size_t footerSize);
+
+/*! LZ4F_seekableDecompress() :
+ *  Decompresses @dstCapacity bytes, starting at decompressed position @offset,
+ *  from @srcBuffer, which must contain a single frame immediately followed by its seek table.
+ *  Only blocks overlapping the requested range are decoded.
+ *  Frames with a dictID are rejected (parameter_invalid) : there is no way to provide their dictionary.
+ *  @dctx is reset at start and at end of operation.
+ * @return : number of bytes written into dstBuffer,
+ *           which can be less than @dstCapacity if range reaches end of frame,
+ *           or an error code if it fails (can be tested using LZ4F_isError()) */
+LZ4FLIB_STATIC_API size_t
+LZ4F_seekableDecompress(LZ4F_dctx* dctx,
+                        void* dstBuffer, size_t dstCapacity,
+                  const void* srcBuffer, size_t srcSize,
+                        unsigned long long offset);
+
+/**********************************
+ *  Compression statistics
+ *********************************/
+
+/* Histograms use log2 buckets : bucket 0 counts value 0, bucket n counts values within [2^(n-1), 2^n). */
+#define LZ4F_STATS_NBBUCKETS 24
+
+typedef struct {
+    unsigned long long nbBlocks;
+    unsigned long long nbUncompressedBlocks;  /* stored raw, because compression did not save space */
+    unsigned long long srcSize;               /* total input of all blocks */
+    unsigned long long blocksSize;            /* total size of blocks, including block headers and checksums */
+    unsigned long long nbSequences;           /* nb of matches, within compressed blocks */
+    unsigned long long literalsSize;          /* literals within compressed blocks */
+    unsigned long long matchesSize;
+    unsigned long long litLengths[LZ4F_STATS_NBBUCKETS];   /* literal run preceding each match, and last literals of each block */
+    unsigned long long matchLengths[LZ4F_STATS_NBBUCKETS];
+    unsigned long long offsets[LZ4F_STATS_NBBUCKETS];
+} LZ4F_compressionStats;
+
+/*! LZ4F_enableCompressionStats() :
+ *  Starts (or stops) collecting statistics on blocks produced by @cctx,
+ *  and resets statistics collected so far.
+ *  Statistics accumulate across frames, until next invocation.
+ *  Each block is analyzed after being compressed, which costs a small fraction of fast compression speed.
+ *  Blocks compressed by LZ4F_compressFrame_MT() are not accounted for.
+ * @return : 0, or an error code (can be tested using LZ4F_isError()),
+ *           notably if the library was compiled with LZ4F_COMPRESSION_STATS=0 */
+LZ4FLIB_STATIC_API size_t LZ4F_enableCompressionStats(LZ4F_cctx* cctx, unsigned enable);
+
+/*! LZ4F_getCompressionStats() :
+ *  Copies statistics collected so far into @stats.
+ * @return : 0, or an error code (can be tested using LZ4F_isError()) if statistics are not enabled. */
+LZ4FLIB_STATIC_API size_t LZ4F_getCompressionStats(const LZ4F_cctx* cctx, LZ4F_compressionStats* stats);
+
 /**********************************
  *  Dictionary compression API
  *********************************/
@@ -659,6 +985,88 @@ LZ4F_decompress_usingDict(LZ4F_dctx* dctxPtr,
                     const void* dict, size_t dictSize,
                     const LZ4F_decompressOptions_t* decompressOptionsPtr);
 
+/*! LZ4F_compressBegin_continue() :
+ *  Starts a new frame using previous frames compressed by @cctx as dictionary,
+ *  without reloading anything : only the new frame's own input is processed.
+ *  Intended for persistent connections exchanging many small frames.
+ *  The frame header doesn't tell that previous frames are required to decode this one :
+ *  peers must agree on it, for example with a reserved value of `dictID`.
+ *  Frames must use linked blocks. History is kept when previous frame also used linked blocks,
+ *  same block size or smaller, and same level family (fast or HC) and `memoryUsage`.
+ *  Otherwise, the frame starts without history, which is still decodable the same way.
+ *  When previous frames were compressed with `stableSrc`, their input must still be valid.
+ * @return : number of bytes written into dstBuffer for the header,
+ *           or an error code (which can be tested using LZ4F_isError()) */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressBegin_continue(LZ4F_cctx* cctx,
+                            void* dstBuffer, size_t dstCapacity,
+                      const LZ4F_preferences_t* prefsPtr);
+
+/*! LZ4F_decompress_continue() :
+ *  Same as LZ4F_decompress(), for frames produced by LZ4F_compressBegin_continue() :
+ *  the last 64 KB of previous frames decoded by @dctx serve as dictionary of next frame.
+ *  History is kept between frames, including across skippable frames, as long as frames
+ *  are decoded with LZ4F_decompress_continue(). Decoding a frame with LZ4F_decompress(),
+ *  or LZ4F_resetDecompressionContext(), discards it. */
+LZ4FLIB_STATIC_API size_t
+LZ4F_decompress_continue(LZ4F_dctx* dctxPtr,
+                         void* dstBuffer, size_t* dstSizePtr,
+                   const void* srcBuffer, size_t* srcSizePtr,
+                   const LZ4F_decompressOptions_t* decompressOptionsPtr);
+
+/*! LZ4F_decompressFrame() :
+ *  One-shot decompression of a complete frame, for frames small enough to be processed at once.
+ *  Blocks are decoded directly into @dstBuffer, without decompression context nor intermediate buffer,
+ *  and all checksums present in the frame are verified.
+ *  @srcBuffer must contain exactly one frame (skippable frames are not supported),
+ *  and @dstBuffer must be large enough for the whole decompressed content.
+ *  @dict is optional (can be NULL), and must be the dictionary used at compression time.
+ * @return : number of bytes written into @dstBuffer,
+ *           or an error code if it fails (can be tested using LZ4F_isError()) */
+LZ4FLIB_STATIC_API size_t
+LZ4F_decompressFrame(void* dstBuffer, size_t dstCapacity,
+               const void* srcBuffer, size_t srcSize,
+               const void* dict, size_t dictSize);
+
+/*! LZ4F_decompress_inplace() :
+ *  Same as LZ4F_decompressFrame(), without dictionary, but decoding within a single buffer.
+ *  The frame, of size @frameSize, must be stored at the end of @buffer,
+ *  and it's decompressed into the beginning of the same @buffer.
+ *  @bufferSize must be large enough for decoded data to never overwrite input not yet read :
+ *  LZ4F_decompressInplaceBound() provides a sufficient size.
+ *  If the margin is too small, decoding stops with an error before any input is overwritten.
+ * @return : number of bytes decoded at the beginning of @buffer,
+ *           or an error code if it fails (can be tested using LZ4F_isError()) */
+LZ4FLIB_STATIC_API size_t
+LZ4F_decompress_inplace(void* buffer, size_t bufferSize, size_t frameSize);
+
+/*! LZ4F_decompressInplaceBound() :
+ *  Provides the buffer size required by LZ4F_decompress_inplace()
+ *  to decode a frame of @contentSize bytes, i.e. @contentSize plus a margin.
+ *  @frameInfoPtr describes the frame (block size, checksums), it can be NULL (worst case).
+ *  The bound presumes that all blocks but the last one are full,
+ *  and that no block is larger than its decoded content,
+ *  which is the case of frames generated by LZ4F_compressFrame(),
+ *  or by LZ4F_compressUpdate() without any intermediate LZ4F_flush() nor autoFlush. */
+LZ4FLIB_STATIC_API size_t
+LZ4F_decompressInplaceBound(size_t contentSize, const LZ4F_frameInfo_t* frameInfoPtr);
+
+/*! LZ4F_setDecoderRingBuffer() :
+ *  For frames using linked blocks.
+ *  Declares that decoded data is written sequentially into a ring buffer [@ringBuffer, @ringBuffer+@ringSize[,
+ *  wrapping back to @ringBuffer when remaining space is too small, and that it remains there until overwritten.
+ *  History of previous blocks is then referenced in place, instead of being copied into the context.
+ *  @ringSize should be >= LZ4F_DECODER_RING_BUFFER_SIZE(maxBlockSize),
+ *  and wrapping should happen when remaining space is < maxBlockSize,
+ *  so that each block is decoded directly into the ring buffer.
+ *  Other output patterns remain valid, but make history copies necessary again.
+ *  Setting stays active for following frames. Set it between frames only.
+ *  Use @ringBuffer==NULL to disable. */
+LZ4FLIB_STATIC_API void
+LZ4F_setDecoderRingBuffer(LZ4F_dctx* dctx, const void* ringBuffer, size_t ringSize);
+
+#define LZ4F_DECODER_RING_BUFFER_SIZE(maxBlockSize) (65536 + 2 * (maxBlockSize))
+
 /**********************************
  *  Bulk processing dictionary API
  *********************************/
@@ -674,10 +1082,35 @@ typedef struct LZ4F_CDict_s LZ4F_CDict;
  *  When compressing multiple messages / blocks using the same dictionary, it's recommended to load it just once.
  *  LZ4_createCDict() will create a digested dictionary, ready to start future compression operations without startup delay.
  *  LZ4_CDict can be created once and shared by multiple threads concurrently, since its usage is read-only.
+ *  Its tables are built by the first compression needing them (fast or HC levels).
  * `dictBuffer` can be released after LZ4_CDict creation, since its content is copied within CDict */
 LZ4FLIB_STATIC_API LZ4F_CDict* LZ4F_createCDict(const void* dictBuffer, size_t dictSize);
 LZ4FLIB_STATIC_API void        LZ4F_freeCDict(LZ4F_CDict* CDict);
 
+/*! LZ4F_serializeCDict() :
+ *  Tables of a CDict are built on first use, separately for fast levels and HC levels.
+ *  To skip their construction entirely, for example in many short-lived processes,
+ *  a CDict can be saved once as an image, with both tables built, and mapped back later.
+ * `dstCapacity` must be >= LZ4F_serializedCDictSize(cdict) (~350 KB for a 64 KB dictionary).
+ * @return : image size, or an error code (which can be tested using LZ4F_isError()).
+ *  The image is only valid for same library version and platform.
+ *  A convenient cache key is the dictionary hash combined with LZ4_versionString(). */
+LZ4FLIB_STATIC_API size_t LZ4F_serializedCDictSize(const LZ4F_CDict* cdict);
+LZ4FLIB_STATIC_API size_t LZ4F_serializeCDict(const LZ4F_CDict* cdict, void* dst, size_t dstCapacity);
+
+/*! LZ4F_mapCDict() :
+ *  Creates a CDict using an image produced by LZ4F_serializeCDict() in place, without copy.
+ * `image` must be aligned on pointer size, remain valid and not move during CDict lifetime,
+ *  and must not be used by another CDict. Pointers within the image are relocated in place,
+ *  they are located at the beginning of one page per table : with a private writable file mapping
+ *  (mmap() with PROT_READ|PROT_WRITE and MAP_PRIVATE), only these pages become process-private,
+ *  the rest of the image stays shared between all processes mapping it.
+ *  The image is checked (version, platform, checksums) but is otherwise trusted :
+ *  it must come from a trusted source, like the library itself.
+ *  LZ4F_freeCDict() doesn't release `image`.
+ * @return : CDict, or NULL if `image` is invalid, or was produced by a different library version or platform */
+LZ4FLIB_STATIC_API LZ4F_CDict* LZ4F_mapCDict(void* image, size_t imageSize);
+
 /*! LZ4_compressFrame_usingCDict() :
  *  Compress an entire srcBuffer into a valid LZ4 frame using a digested Dictionary.
  *  cctx must point to a context created by LZ4F_createCompressionContext().
@@ -709,6 +1142,29 @@ LZ4F_compressBegin_usingCDict(LZ4F_cctx* cctx,
                         const LZ4F_CDict* cdict,
                         const LZ4F_preferences_t* prefsPtr);
 
+/* Decompression side : a prepared dictionary can be shared by any number of
+ * decompression contexts, even concurrently. Each context keeps its own copy of it,
+ * made once, and small blocks of independent-blocks frames are decoded right after it,
+ * at prefix speed instead of external dictionary speed.
+ */
+typedef struct LZ4F_DDict_s LZ4F_DDict;
+
+/*! LZ4F_createDDict() :
+ *  LZ4F_DDict can be created once and shared by multiple threads concurrently, since its usage is read-only.
+ * `dictBuffer` can be released after LZ4F_DDict creation, since its content is copied within DDict */
+LZ4FLIB_STATIC_API LZ4F_DDict* LZ4F_createDDict(const void* dictBuffer, size_t dictSize);
+LZ4FLIB_STATIC_API void        LZ4F_freeDDict(LZ4F_DDict* ddict);
+
+/*! LZ4F_decompress_usingDDict() :
+ *  Same as LZ4F_decompress_usingDict(), using a dictionary prepared with LZ4F_createDDict().
+ * `ddict` must outlive the decompression of current frame. */
+LZ4FLIB_STATIC_API size_t
+LZ4F_decompress_usingDDict(LZ4F_dctx* dctxPtr,
+                           void* dstBuffer, size_t* dstSizePtr,
+                     const void* srcBuffer, size_t* srcSizePtr,
+                     const LZ4F_DDict* ddict,
+                     const LZ4F_decompressOptions_t* decompressOptionsPtr);
+
 
 /**********************************
  *  Custom memory allocation
@@ -737,6 +1193,76 @@ LZ4F_CustomMem const LZ4F_defaultCMem = { NULL, NULL, NULL, NULL };  /**< this c
 LZ4FLIB_STATIC_API LZ4F_cctx* LZ4F_createCompressionContext_advanced(LZ4F_CustomMem customMem, unsigned version);
 LZ4FLIB_STATIC_API LZ4F_dctx* LZ4F_createDecompressionContext_advanced(LZ4F_CustomMem customMem, unsigned version);
 LZ4FLIB_STATIC_API LZ4F_CDict* LZ4F_createCDict_advanced(LZ4F_CustomMem customMem, const void* dictBuffer, size_t dictSize);
+LZ4FLIB_STATIC_API LZ4F_DDict* LZ4F_createDDict_advanced(LZ4F_CustomMem customMem, const void* dictBuffer, size_t dictSize);
+
+/*! LZ4F_compressFrame_MT_advanced() :
+ *  Same as LZ4F_compressFrame_MT(), with all allocations served by @customMem.
+ *  One state per segment is allocated, from the calling thread, before any job is submitted :
+ *  @customMem is never invoked from jobs, hence doesn't need to be thread-safe (LZ4F_Arena is fine).
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressFrame_MT_advanced(LZ4F_CustomMem customMem,
+                void* dstBuffer, size_t dstCapacity,
+                const void* srcBuffer, size_t srcSize,
+                const LZ4F_preferences_t* preferencesPtr,
+                const LZ4F_Executor* executor);
+
+/*! Arena allocation :
+ *  LZ4F_Arena is a bump allocator over a caller-provided buffer.
+ *  LZ4F_arenaCustomMem() returns a LZ4F_CustomMem which carves every allocation from @arena :
+ *  contexts and dictionaries created with it (LZ4F_create*_advanced()) place all their buffers there,
+ *  including internal streaming buffers and lz4 / lz4hc states.
+ *  Memory is never released individually : LZ4F_free*() functions become no-ops on the arena,
+ *  and memory abandoned when a context resizes a buffer (block size or compression family change)
+ *  stays in use until the next reset.
+ *  LZ4F_resetArena() makes the whole buffer available again in O(1) :
+ *  all objects allocated from the arena become invalid, and must not be used anymore.
+ *  When the arena is exhausted, allocation fails, reported as LZ4F_ERROR_allocation_failed.
+ *  An arena is not thread-safe : it must be used by one thread at a time.
+ *  An arena over huge pages (mmap() + madvise(MADV_HUGEPAGE), or large pages on Windows)
+ *  places lz4hc tables there, which reduces TLB misses of the match finder.
+ *
+ *  LZ4F_cctxArenaSize() and LZ4F_dctxArenaSize() tell how much arena space
+ *  one context needs for frames using given parameters, excluding seek table and LZ4F_DDict scratch.
+ *  LZ4F_dctxArenaSize() sizes for blockLinked frames; LZ4F_default means LZ4F_max4MB.
+ */
+typedef struct {
+    void*  buffer;
+    size_t capacity;
+    size_t used;       /* high-water mark since last reset */
+} LZ4F_Arena;
+LZ4FLIB_STATIC_API void           LZ4F_initArena(LZ4F_Arena* arena, void* buffer, size_t capacity);
+LZ4FLIB_STATIC_API void           LZ4F_resetArena(LZ4F_Arena* arena);
+LZ4FLIB_STATIC_API LZ4F_CustomMem LZ4F_arenaCustomMem(LZ4F_Arena* arena);
+LZ4FLIB_STATIC_API size_t         LZ4F_cctxArenaSize(const LZ4F_preferences_t* preferencesPtr);
+LZ4FLIB_STATIC_API size_t         LZ4F_dctxArenaSize(LZ4F_blockSizeID_t blockSizeID);
+
+/*! Context pool :
+ *  Keeps idle contexts warm, with their internal buffers already allocated,
+ *  so that short-lived users don't pay for allocation and release at each frame.
+ *  Compression contexts are keyed by block size and compression family (fast or HC),
+ *  decompression contexts by block size.
+ *  LZ4F_ctxPool_get*() return a context ready to start a new frame,
+ *  taken from the pool, or created and pre-sized when none is available for this key.
+ *  LZ4F_ctxPool_release*() return a context to the pool, without releasing its memory,
+ *  or free it when the pool already holds @maxPerKey contexts for this key.
+ *  Thread safety : when compiled with gcc, clang or MSVC, get and release operations
+ *  can be invoked concurrently from multiple threads (waiting threads spin, then yield).
+ *  With any other compiler, the pool has no locking at all :
+ *  the caller must serialize every get and release operation on a shared pool.
+ *  Contexts still in use when LZ4F_freeCtxPool() is invoked must be freed by the caller.
+ */
+typedef struct LZ4F_ctxPool_s LZ4F_ctxPool;
+LZ4FLIB_STATIC_API LZ4F_ctxPool* LZ4F_createCtxPool(LZ4F_CustomMem customMem, unsigned maxPerKey);
+LZ4FLIB_STATIC_API void          LZ4F_freeCtxPool(LZ4F_ctxPool* pool);
+/* @preferencesPtr can be NULL; only blockSizeID and compressionLevel are used to select a context.
+ * @return : a compression context, or NULL on allocation failure or invalid blockSizeID */
+LZ4FLIB_STATIC_API LZ4F_cctx* LZ4F_ctxPool_getCCtx(LZ4F_ctxPool* pool, const LZ4F_preferences_t* preferencesPtr);
+LZ4FLIB_STATIC_API void       LZ4F_ctxPool_releaseCCtx(LZ4F_ctxPool* pool, LZ4F_cctx* cctx);
+/* @blockSizeID : largest block size of frames to decode; LZ4F_default means LZ4F_max4MB.
+ * @return : a decompression context, or NULL on allocation failure or invalid blockSizeID */
+LZ4FLIB_STATIC_API LZ4F_dctx* LZ4F_ctxPool_getDCtx(LZ4F_ctxPool* pool, LZ4F_blockSizeID_t blockSizeID);
+LZ4FLIB_STATIC_API void       LZ4F_ctxPool_releaseDCtx(LZ4F_ctxPool* pool, LZ4F_dctx* dctx);
 
 
 #if defined (__cplusplus)
@@ -48,6 +48,32 @@
 #  define LZ4HC_HEAPMODE 1
 #endif
 
+/*! LZ4HC_OPT_STATS :
+ *  Collect activity counters of the optimal parser (levels 10+),
+ *  exposed by LZ4_getOptimalParserStats(). Meant for tuning, disabled by default :
+ *  counters are global, and add a small cost to the match finder.
+**/
+#ifndef LZ4HC_OPT_STATS
+#  define LZ4HC_OPT_STATS 0
+#endif
+
+/*! LZ4HC_PREFETCH_CHAIN :
+ *  Prefetch the next candidate of the hash chain while the current one is compared (levels 3-9).
+ *  May help on cpus with a small L2 cache, or shared by many threads, when tables and window miss the cache.
+ *  When they fit in cache, it only adds work (measured ~3-5% slower), hence disabled by default.
+**/
+#ifndef LZ4HC_PREFETCH_CHAIN
+#  define LZ4HC_PREFETCH_CHAIN 0
+#endif
+
+/*! LZ4HC_WORKLIMIT_DEFAULT :
+ *  Default bound on match finder effort, in mean candidates examined per input byte (see LZ4_setWorkLimitHC()).
+ *  Typical data stays far below it : it only triggers on inputs crafted, or unlucky enough, to defeat the match finder.
+**/
+#ifndef LZ4HC_WORKLIMIT_DEFAULT
+#  define LZ4HC_WORKLIMIT_DEFAULT 16
+#endif
+
 
 /*===    Dependency    ===*/
 #define LZ4_HC_STATIC_LINKING_ONLY
@@ -72,6 +98,16 @@
 typedef enum { noDictCtx, usingDictCtxHc } dictCtx_directive;
 
 
+/*===   Suspendable parsing   ===*/
+/* see LZ4_compress_HC_continue_budget() */
+typedef struct {
+    LZ4HC_resume_t* progress;   /* where the block stands, updated when suspending */
+    int budget;                 /* nb of input positions to parse before suspending */
+} LZ4HC_suspend_t;
+#define LZ4HC_SUSPENDED (-1)
+#define LZ4HC_RESUMED(susp) ((susp) != NULL && (susp)->progress->srcPos > 0)
+
+
 /*===   Constants   ===*/
 #define OPTIMAL_ML (int)((ML_MASK-1)+MINMATCH)
 #define LZ4_OPT_NUM   (1<<12)
@@ -81,14 +117,117 @@ typedef enum { noDictCtx, usingDictCtxHc } dictCtx_directive;
 #define MIN(a,b)   ( (a) < (b) ? (a) : (b) )
 #define MAX(a,b)   ( (a) > (b) ? (a) : (b) )
 #define DELTANEXTU16(table, pos) table[(U16)(pos)]   /* faster */
+#define DELTANEXTMASK(table, pos, mask) table[(pos) & (mask)]
 /* Make fields passed to, and updated by LZ4HC_encodeSequence explicit */
 #define UPDATABLE(ip, op, anchor) &ip, &op, &anchor
 
 
+/*===   Optimal parser statistics   ===*/
+#if LZ4HC_OPT_STATS
+static LZ4HC_optStats_t g_optStats;
+#  define OPT_STAT(counter, n) (g_optStats.counter += (unsigned long long)(n))
+#else
+#  define OPT_STAT(counter, n) ((void)0)
+#endif
+
+int LZ4_getOptimalParserStats(LZ4HC_optStats_t* stats)
+{
+    assert(stats != NULL);
+#if LZ4HC_OPT_STATS
+    *stats = g_optStats;
+    return 1;
+#else
+    MEM_INIT(stats, 0, sizeof(*stats));
+    return 0;
+#endif
+}
+
+void LZ4_resetOptimalParserStats(void)
+{
+#if LZ4HC_OPT_STATS
+    MEM_INIT(&g_optStats, 0, sizeof(g_optStats));
+#endif
+}
+
+
+/*===   Work limit   ===*/
+/* Some inputs make every search examine a long list of candidates, each compared over a long length,
+ * slowing levels 9+ down by an order of magnitude. The parsers account candidates examined,
+ * and check them every LZ4HC_WORK_WINDOW input bytes against the stream's limit (mean per byte) :
+ * - once a block has spent its budget, limit x block size, the rest of it uses the minimum search depth ;
+ * - a window above LZ4HC_WORK_BURST x limit per byte divides search depth by 4, for the rest of the block.
+ * Windows are tolerant, since typical data has local bursts, such as zero padding within executables.
+ * Depth is never reduced below LZ4HC_WORK_MIN_DEPTH, nor restored within the block. */
+#define LZ4HC_WORK_WINDOW    (4 KB)
+#define LZ4HC_WORK_BURST     32
+#define LZ4HC_WORK_MIN_DEPTH 8
+#define LZ4HC_WORKLIMIT_NONE 255   /* stored limit value which disables the work limit */
+
+typedef struct {
+    const BYTE* windowStart;
+    const BYTE* checkpoint;   /* next evaluation, beyond the end of block when unlimited */
+    U32 spent;                /* candidates examined within current window */
+    U32 limit;                /* mean candidates per byte */
+    U64 blockSpent;           /* candidates examined within previous windows */
+    U64 blockBudget;
+} LZ4HC_work_t;
+
+static void LZ4HC_work_init(LZ4HC_work_t* w, const LZ4HC_CCtx_internal* ctx, const BYTE* ip, const BYTE* iend)
+{
+    w->limit = ctx->workLimit ? ctx->workLimit : LZ4HC_WORKLIMIT_DEFAULT;
+    w->windowStart = ip;
+    w->checkpoint = (w->limit == LZ4HC_WORKLIMIT_NONE) ? iend : ip + LZ4HC_WORK_WINDOW;
+    w->spent = 0;
+    w->blockSpent = 0;
+    w->blockBudget = (U64)(iend - ip) * w->limit;
+}
+
+/* LZ4HC_work_check() :
+ * Invoked when @ip reaches w->checkpoint.
+ * @return : search depth for next window */
+static int LZ4HC_work_check(LZ4HC_work_t* w, const BYTE* ip, int depth)
+{
+    U64 const windowBudget = (U64)(ip - w->windowStart) * w->limit * LZ4HC_WORK_BURST;
+    w->blockSpent += w->spent;
+    if (depth > LZ4HC_WORK_MIN_DEPTH) {
+        if (w->blockSpent > w->blockBudget) {
+            depth = LZ4HC_WORK_MIN_DEPTH;
+            OPT_STAT(nbWorkLimits, 1);
+        } else if (w->spent > windowBudget) {
+            depth = MAX(depth / 4, LZ4HC_WORK_MIN_DEPTH);
+            OPT_STAT(nbWorkLimits, 1);
+    }   }
+    w->spent = 0;
+    w->windowStart = ip;
+    w->checkpoint = ip + LZ4HC_WORK_WINDOW;
+    return depth;
+}
+
+/* LZ4HC_work_suspend(), LZ4HC_work_resume() :
+ * a block compressed over several invocations (LZ4_compress_HC_continue_budget())
+ * keeps a single work budget, and the search depth it has reduced so far. */
+static void LZ4HC_work_suspend(const LZ4HC_work_t* w, int depth, LZ4HC_resume_t* r, const BYTE* source)
+{
+    r->workWindowPos = (int)(w->windowStart - source);
+    r->workDepth = depth;
+    r->workSpent = w->spent;
+    r->workBlockSpent = w->blockSpent;
+}
+
+static void LZ4HC_work_resume(LZ4HC_work_t* w, int* depth, const LZ4HC_resume_t* r, const BYTE* source)
+{
+    w->windowStart = source + r->workWindowPos;
+    if (w->limit != LZ4HC_WORKLIMIT_NONE) w->checkpoint = w->windowStart + LZ4HC_WORK_WINDOW;
+    w->spent = r->workSpent;
+    w->blockSpent = r->workBlockSpent;
+    *depth = r->workDepth;
+}
+
+
 /*===   Hashing   ===*/
 #define LZ4HC_HASHSIZE 4
-#define HASH_FUNCTION(i)         (((i) * 2654435761U) >> ((MINMATCH*8)-LZ4HC_HASH_LOG))
-static U32 LZ4HC_hashPtr(const void* ptr) { return HASH_FUNCTION(LZ4_read32(ptr)); }
+#define HASH_FUNCTION(i, hLog)   (((i) * 2654435761U) >> ((MINMATCH*8)-(hLog)))
+static U32 LZ4HC_hashPtr(const void* ptr, U32 hashLog) { return HASH_FUNCTION(LZ4_read32(ptr), hashLog); }
 
 #if defined(LZ4_FORCE_MEMORY_ACCESS) && (LZ4_FORCE_MEMORY_ACCESS==2)
 /* lie to the compiler about data alignment; use with caution */
@@ -108,16 +247,15 @@ static U64 LZ4_read64(const void* memPtr)
 #endif /* LZ4_FORCE_MEMORY_ACCESS */
 
 #define LZ4MID_HASHSIZE 8
-#define LZ4MID_HASHLOG (LZ4HC_HASH_LOG-1)
-#define LZ4MID_HASHTABLESIZE (1 << LZ4MID_HASHLOG)
+/* level 2 splits the hash table into 2 halves, of (hashLog-1) each */
 
-static U32 LZ4MID_hash4(U32 v) { return (v * 2654435761U) >> (32-LZ4MID_HASHLOG); }
-static U32 LZ4MID_hash4Ptr(const void* ptr) { return LZ4MID_hash4(LZ4_read32(ptr)); }
+static U32 LZ4MID_hash4(U32 v, U32 hLog) { return (v * 2654435761U) >> (32-hLog); }
+static U32 LZ4MID_hash4Ptr(const void* ptr, U32 hLog) { return LZ4MID_hash4(LZ4_read32(ptr), hLog); }
 /* note: hash7 hashes the lower 56-bits.
  * It presumes input was read using little endian.*/
-static U32 LZ4MID_hash7(U64 v) { return (U32)(((v  << (64-56)) * 58295818150454627ULL) >> (64-LZ4MID_HASHLOG)) ; }
+static U32 LZ4MID_hash7(U64 v, U32 hLog) { return (U32)(((v  << (64-56)) * 58295818150454627ULL) >> (64-hLog)) ; }
 static U64 LZ4_readLE64(const void* memPtr);
-static U32 LZ4MID_hash8Ptr(const void* ptr) { return LZ4MID_hash7(LZ4_readLE64(ptr)); }
+static U32 LZ4MID_hash8Ptr(const void* ptr, U32 hLog) { return LZ4MID_hash7(LZ4_readLE64(ptr), hLog); }
 
 static U64 LZ4_readLE64(const void* memPtr)
 {
@@ -194,15 +332,70 @@ int LZ4HC_countBack(const BYTE* const ip, const BYTE* const match,
 }
 
 
+/**************************************
+*  Table geometry
+**************************************/
+/* A state initialized by LZ4_initStreamHC_advanced() uses reduced tables.
+ * chainTable then starts right after the last hashTable entry,
+ * and the state ends after the last chainTable entry.
+ * A zero reduction corresponds to the standard LZ4_streamHC_t layout. */
+LZ4_FORCE_INLINE U32 LZ4HC_hashLog(const LZ4HC_CCtx_internal* hc4)
+{
+    return LZ4HC_HASH_LOG - hc4->hashLogReduction;
+}
+
+LZ4_FORCE_INLINE U32 LZ4HC_chainMask(const LZ4HC_CCtx_internal* hc4)
+{
+    return LZ4HC_MAXD_MASK >> hc4->chainLogReduction;
+}
+
+LZ4_FORCE_INLINE U16* LZ4HC_chainTable(const LZ4HC_CCtx_internal* hc4)
+{
+    return (U16*)((uptrval)hc4->hashTable + (sizeof(U32) << LZ4HC_hashLog(hc4)));
+}
+
+/* LZ4HC_maxDistance() :
+ * chainTable only tracks the last (1 << chainLog) positions,
+ * which bounds the history window that can be searched. */
+LZ4_FORCE_INLINE U32 LZ4HC_maxDistance(const LZ4HC_CCtx_internal* hc4)
+{
+    return MIN(LZ4_DISTANCE_MAX, LZ4HC_chainMask(hc4));
+}
+
+static size_t LZ4HC_sizeofState(int hashLog, int chainLog)
+{
+    return offsetof(LZ4HC_CCtx_internal, hashTable)
+         + (sizeof(U32) << hashLog)
+         + (sizeof(U16) << chainLog);
+}
+
+static int LZ4HC_chainLog(const LZ4HC_CCtx_internal* hc4)
+{
+    return LZ4HC_DICTIONARY_LOGSIZE - hc4->chainLogReduction;
+}
+
+static int LZ4HC_sameGeometry(const LZ4HC_CCtx_internal* a, const LZ4HC_CCtx_internal* b)
+{
+    return (a->hashLogReduction == b->hashLogReduction)
+        && (a->chainLogReduction == b->chainLogReduction);
+}
+
+
 /**************************************
 *  Init
 **************************************/
 static void LZ4HC_clearTables (LZ4HC_CCtx_internal* hc4)
 {
-    MEM_INIT(hc4->hashTable, 0, sizeof(hc4->hashTable));
-    MEM_INIT(hc4->chainTable, 0xFF, sizeof(hc4->chainTable));
+    MEM_INIT(hc4->hashTable, 0, sizeof(U32) << LZ4HC_hashLog(hc4));
+    MEM_INIT(LZ4HC_chainTable(hc4), 0xFF, sizeof(U16) * (LZ4HC_chainMask(hc4) + 1));
 }
 
+/* LZ4HC_init_internal() :
+ * Starts a new generation of indexes, 64 KB beyond the last position referenced so far.
+ * Entries left in tables by previous generations are then either < lowLimit,
+ * or > LZ4_DISTANCE_MAX away from the end of a dictCtx, so they are filtered on lookup
+ * and tables don't need to be cleared.
+ * This only happens once indexes exceed 1 GB. */
 static void LZ4HC_init_internal (LZ4HC_CCtx_internal* hc4, const BYTE* start)
 {
     size_t const bufferSize = (size_t)(hc4->end - hc4->prefixStart);
@@ -330,7 +523,9 @@ LZ4HC_match_t LZ4HC_searchExtDict(const BYTE* ip, U32 ipIndex,
         int currentBestML, int nbAttempts)
 {
     size_t const lDictEndIndex = (size_t)(dictCtx->end - dictCtx->prefixStart) + dictCtx->dictLimit;
-    U32 lDictMatchIndex = dictCtx->hashTable[LZ4HC_hashPtr(ip)];
+    const U16* const dictChainTable = LZ4HC_chainTable(dictCtx);
+    U32 const dictChainMask = LZ4HC_chainMask(dictCtx);
+    U32 lDictMatchIndex = dictCtx->hashTable[LZ4HC_hashPtr(ip, LZ4HC_hashLog(dictCtx))];
     U32 matchIndex = lDictMatchIndex + gDictEndIndex - (U32)lDictEndIndex;
     int offset = 0, sBack = 0;
     assert(lDictEndIndex <= 1 GB);
@@ -354,7 +549,7 @@ LZ4HC_match_t LZ4HC_searchExtDict(const BYTE* ip, U32 ipIndex,
                 DEBUGLOG(7, "found match of length %i within extDictCtx", currentBestML);
         }   }
 
-        {   U32 const nextOffset = DELTANEXTU16(dictCtx->chainTable, lDictMatchIndex);
+        {   U32 const nextOffset = DELTANEXTMASK(dictChainTable, lDictMatchIndex, dictChainMask);
             lDictMatchIndex -= nextOffset;
             matchIndex -= nextOffset;
     }   }
@@ -377,9 +572,10 @@ LZ4MID_addPosition(U32* hTable, U32 hValue, U32 index)
     hTable[hValue] = index;
 }
 
-#define ADDPOS8(_p, _idx) LZ4MID_addPosition(hash8Table, LZ4MID_hash8Ptr(_p), _idx)
-#define ADDPOS4(_p, _idx) LZ4MID_addPosition(hash4Table, LZ4MID_hash4Ptr(_p), _idx)
+#define ADDPOS8(_p, _idx) LZ4MID_addPosition(hash8Table, LZ4MID_hash8Ptr(_p, midHashLog), _idx)
+#define ADDPOS4(_p, _idx) LZ4MID_addPosition(hash4Table, LZ4MID_hash4Ptr(_p, midHashLog), _idx)
 
+LZ4_MULTIVERSION
 static int LZ4HC_compress_2hashes (
     LZ4HC_CCtx_internal* const ctx,
     const char* const src,
@@ -390,8 +586,9 @@ static int LZ4HC_compress_2hashes (
     const dictCtx_directive dict
     )
 {
+    U32 const midHashLog = LZ4HC_hashLog(ctx) - 1;
     U32* const hash4Table = ctx->hashTable;
-    U32* const hash8Table = hash4Table + LZ4MID_HASHTABLESIZE;
+    U32* const hash8Table = hash4Table + ((size_t)1 << midHashLog);
     const BYTE* ip = (const BYTE*)src;
     const BYTE* anchor = ip;
     const BYTE* const iend = ip + *srcSizePtr;
@@ -427,9 +624,9 @@ static int LZ4HC_compress_2hashes (
     while (ip <= mflimit) {
         const U32 ipIndex = (U32)(ip - prefixPtr) + prefixIdx;
         /* search long match */
-        {   U32 h8 = LZ4MID_hash8Ptr(ip);
+        {   U32 h8 = LZ4MID_hash8Ptr(ip, midHashLog);
             U32 pos8 = hash8Table[h8];
-            assert(h8 < LZ4MID_HASHTABLESIZE);
+            assert(h8 < (1U << midHashLog));
             assert(h8 < ipIndex);
             LZ4MID_addPosition(hash8Table, h8, ipIndex);
             if ( ipIndex - pos8 <= LZ4_DISTANCE_MAX
@@ -446,9 +643,9 @@ static int LZ4HC_compress_2hashes (
                 }
         }   }
         /* search short match */
-        {   U32 h4 = LZ4MID_hash4Ptr(ip);
+        {   U32 h4 = LZ4MID_hash4Ptr(ip, midHashLog);
             U32 pos4 = hash4Table[h4];
-            assert(h4 < LZ4MID_HASHTABLESIZE);
+            assert(h4 < (1U << midHashLog));
             assert(pos4 < ipIndex);
             LZ4MID_addPosition(hash4Table, h4, ipIndex);
             if (ipIndex - pos4 <= LZ4_DISTANCE_MAX
@@ -461,7 +658,7 @@ static int LZ4HC_compress_2hashes (
                 matchLength = LZ4_count(ip, matchPtr, matchlimit);
                 if (matchLength >= MINMATCH) {
                     /* short match found, let's just check ip+1 for longer */
-                    U32 const h8 = LZ4MID_hash8Ptr(ip+1);
+                    U32 const h8 = LZ4MID_hash8Ptr(ip+1, midHashLog);
                     U32 const pos8 = hash8Table[h8];
                     U32 const m2Distance = ipIndex + 1 - pos8;
                     matchDistance = ipIndex - pos4;
@@ -614,8 +811,10 @@ _lz4mid_dest_overflow:
 /* Update chains up to ip (excluded) */
 LZ4_FORCE_INLINE void LZ4HC_Insert (LZ4HC_CCtx_internal* hc4, const BYTE* ip)
 {
-    U16* const chainTable = hc4->chainTable;
+    U16* const chainTable = LZ4HC_chainTable(hc4);
     U32* const hashTable  = hc4->hashTable;
+    U32 const hashLog = LZ4HC_hashLog(hc4);
+    U32 const chainMask = LZ4HC_chainMask(hc4);
     const BYTE* const prefixPtr = hc4->prefixStart;
     U32 const prefixIdx = hc4->dictLimit;
     U32 const target = (U32)(ip - prefixPtr) + prefixIdx;
@@ -624,10 +823,10 @@ LZ4_FORCE_INLINE void LZ4HC_Insert (LZ4HC_CCtx_internal* hc4, const BYTE* ip)
     assert(target >= prefixIdx);
 
     while (idx < target) {
-        U32 const h = LZ4HC_hashPtr(prefixPtr+idx-prefixIdx);
+        U32 const h = LZ4HC_hashPtr(prefixPtr+idx-prefixIdx, hashLog);
         size_t delta = idx - hashTable[h];
         if (delta>LZ4_DISTANCE_MAX) delta = LZ4_DISTANCE_MAX;
-        DELTANEXTU16(chainTable, idx) = (U16)delta;
+        DELTANEXTMASK(chainTable, idx, chainMask) = (U16)delta;
         hashTable[h] = idx;
         idx++;
     }
@@ -724,16 +923,19 @@ LZ4HC_InsertAndGetWiderMatch (
         const int maxNbAttempts,
         const int patternAnalysis, const int chainSwap,
         const dictCtx_directive dict,
-        const HCfavor_e favorDecSpeed)
+        const HCfavor_e favorDecSpeed,
+        int* const nbAttemptsUsed)
 {
-    U16* const chainTable = hc4->chainTable;
+    U16* const chainTable = LZ4HC_chainTable(hc4);
     U32* const hashTable = hc4->hashTable;
+    U32 const chainMask = LZ4HC_chainMask(hc4);
+    U32 const maxDistance = LZ4HC_maxDistance(hc4);
     const LZ4HC_CCtx_internal* const dictCtx = hc4->dictCtx;
     const BYTE* const prefixPtr = hc4->prefixStart;
     const U32 prefixIdx = hc4->dictLimit;
     const U32 ipIndex = (U32)(ip - prefixPtr) + prefixIdx;
-    const int withinStartDistance = (hc4->lowLimit + (LZ4_DISTANCE_MAX + 1) > ipIndex);
-    const U32 lowestMatchIndex = (withinStartDistance) ? hc4->lowLimit : ipIndex - LZ4_DISTANCE_MAX;
+    const int withinStartDistance = (hc4->lowLimit + (maxDistance + 1) > ipIndex);
+    const U32 lowestMatchIndex = (withinStartDistance) ? hc4->lowLimit : ipIndex - maxDistance;
     const BYTE* const dictStart = hc4->dictStart;
     const U32 dictIdx = hc4->lowLimit;
     const BYTE* const dictEnd = dictStart + prefixIdx - dictIdx;
@@ -749,7 +951,7 @@ LZ4HC_InsertAndGetWiderMatch (
     DEBUGLOG(7, "LZ4HC_InsertAndGetWiderMatch");
     /* First Match */
     LZ4HC_Insert(hc4, ip);  /* insert all prior positions up to ip (excluded) */
-    matchIndex = hashTable[LZ4HC_hashPtr(ip)];
+    matchIndex = hashTable[LZ4HC_hashPtr(ip, LZ4HC_hashLog(hc4))];
     DEBUGLOG(7, "First candidate match for pos %u found at index %u / %u (lowestMatchIndex)",
                 ipIndex, matchIndex, lowestMatchIndex);
 
@@ -757,6 +959,17 @@ LZ4HC_InsertAndGetWiderMatch (
         int matchLength=0;
         nbAttempts--;
         assert(matchIndex < ipIndex);
+#if LZ4HC_PREFETCH_CHAIN
+        /* Walking the chain is a sequence of dependent loads, each likely to miss the cache.
+         * Request the most likely next candidate (current chain, no swap) while this one is compared. */
+        if (nbAttempts > 0) {
+            U32 const nextIndex = matchIndex - DELTANEXTMASK(chainTable, matchIndex + matchChainPos, chainMask);
+            if ((nextIndex >= prefixIdx) & (nextIndex >= lowestMatchIndex) & (nextIndex < matchIndex)) {
+                const BYTE* const nextPtr = prefixPtr + (nextIndex - prefixIdx);
+                LZ4_PREFETCH_R(nextPtr);
+                LZ4_PREFETCH_R(&chainTable[nextIndex & chainMask]);
+        }   }
+#endif
         if (favorDecSpeed && (ipIndex - matchIndex < 8)) {
             /* do nothing:
              * favorDecSpeed intentionally skips matches with offset < 8 */
@@ -805,7 +1018,7 @@ LZ4HC_InsertAndGetWiderMatch (
                 int accel = 1 << kTrigger;
                 int pos;
                 for (pos = 0; pos < end; pos += step) {
-                    U32 const candidateDist = DELTANEXTU16(chainTable, matchIndex + (U32)pos);
+                    U32 const candidateDist = DELTANEXTMASK(chainTable, matchIndex + (U32)pos, chainMask);
                     step = (accel++ >> kTrigger);
                     if (candidateDist > distanceToNextMatch) {
                         distanceToNextMatch = candidateDist;
@@ -818,7 +1031,7 @@ LZ4HC_InsertAndGetWiderMatch (
                     continue;
         }   }   }
 
-        {   U32 const distNextMatch = DELTANEXTU16(chainTable, matchIndex);
+        {   U32 const distNextMatch = DELTANEXTMASK(chainTable, matchIndex, chainMask);
             if (patternAnalysis && distNextMatch==1 && matchChainPos==0) {
                 U32 const matchCandidateIdx = matchIndex-1;
                 /* may be a repeated pattern */
@@ -877,14 +1090,14 @@ LZ4HC_InsertAndGetWiderMatch (
                                         size_t const maxML = MIN(currentSegmentLength, srcPatternLength);
                                         if ((size_t)longest < maxML) {
                                             assert(prefixPtr - prefixIdx + matchIndex != ip);
-                                            if ((size_t)(ip - prefixPtr) + prefixIdx - matchIndex > LZ4_DISTANCE_MAX) break;
+                                            if ((size_t)(ip - prefixPtr) + prefixIdx - matchIndex > maxDistance) break;
                                             assert(maxML < 2 GB);
                                             longest = (int)maxML;
                                             offset = (int)(ipIndex - matchIndex);
                                             assert(sBack == 0);
                                             DEBUGLOG(7, "Found repeat pattern match of len=%i, offset=%i", longest, offset);
                                         }
-                                        {   U32 const distToNextPattern = DELTANEXTU16(chainTable, matchIndex);
+                                        {   U32 const distToNextPattern = DELTANEXTMASK(chainTable, matchIndex, chainMask);
                                             if (distToNextPattern > matchIndex) break;  /* avoid overflow */
                                             matchIndex -= distToNextPattern;
                         }   }   }   }   }
@@ -893,7 +1106,7 @@ LZ4HC_InsertAndGetWiderMatch (
         }   }   /* PA optimization */
 
         /* follow current chain */
-        matchIndex -= DELTANEXTU16(chainTable, matchIndex + matchChainPos);
+        matchIndex -= DELTANEXTMASK(chainTable, matchIndex + matchChainPos, chainMask);
 
     }  /* while ((matchIndex>=lowestMatchIndex) && (nbAttempts)) */
 
@@ -901,11 +1114,13 @@ LZ4HC_InsertAndGetWiderMatch (
       && nbAttempts > 0
       && withinStartDistance) {
         size_t const dictEndOffset = (size_t)(dictCtx->end - dictCtx->prefixStart) + dictCtx->dictLimit;
-        U32 dictMatchIndex = dictCtx->hashTable[LZ4HC_hashPtr(ip)];
+        const U16* const dictChainTable = LZ4HC_chainTable(dictCtx);
+        U32 const dictChainMask = LZ4HC_chainMask(dictCtx);
+        U32 dictMatchIndex = dictCtx->hashTable[LZ4HC_hashPtr(ip, LZ4HC_hashLog(dictCtx))];
         assert(dictEndOffset <= 1 GB);
         matchIndex = dictMatchIndex + lowestMatchIndex - (U32)dictEndOffset;
         if (dictMatchIndex>0) DEBUGLOG(7, "dictEndOffset = %zu, dictMatchIndex = %u => relative matchIndex = %i", dictEndOffset, dictMatchIndex, (int)dictMatchIndex - (int)dictEndOffset);
-        while (ipIndex - matchIndex <= LZ4_DISTANCE_MAX && nbAttempts--) {
+        while (ipIndex - matchIndex <= maxDistance && nbAttempts--) {
             const BYTE* const matchPtr = dictCtx->prefixStart - dictCtx->dictLimit + dictMatchIndex;
 
             if (LZ4_read32(matchPtr) == pattern) {
@@ -923,11 +1138,12 @@ LZ4HC_InsertAndGetWiderMatch (
                     DEBUGLOG(7, "found match of length %i within extDictCtx", longest);
             }   }
 
-            {   U32 const nextOffset = DELTANEXTU16(dictCtx->chainTable, dictMatchIndex);
+            {   U32 const nextOffset = DELTANEXTMASK(dictChainTable, dictMatchIndex, dictChainMask);
                 dictMatchIndex -= nextOffset;
                 matchIndex -= nextOffset;
     }   }   }
 
+    if (nbAttemptsUsed != NULL) *nbAttemptsUsed = maxNbAttempts - nbAttempts;
     {   LZ4HC_match_t md;
         assert(longest >= 0);
         md.len = longest;
@@ -942,13 +1158,14 @@ LZ4HC_InsertAndFindBestMatch(LZ4HC_CCtx_internal* const hc4,   /* Index table wi
                        const BYTE* const ip, const BYTE* const iLimit,
                        const int maxNbAttempts,
                        const int patternAnalysis,
-                       const dictCtx_directive dict)
+                       const dictCtx_directive dict,
+                       int* const nbAttemptsUsed)
 {
     DEBUGLOG(7, "LZ4HC_InsertAndFindBestMatch");
     /* note : LZ4HC_InsertAndGetWiderMatch() is able to modify the starting position of a match (*startpos),
      * but this won't be the case here, as we define iLowLimit==ip,
      * so LZ4HC_InsertAndGetWiderMatch() won't be allowed to search past ip */
-    return LZ4HC_InsertAndGetWiderMatch(hc4, ip, ip, iLimit, MINMATCH-1, maxNbAttempts, patternAnalysis, 0 /*chainSwap*/, dict, favorCompressionRatio);
+    return LZ4HC_InsertAndGetWiderMatch(hc4, ip, ip, iLimit, MINMATCH-1, maxNbAttempts, patternAnalysis, 0 /*chainSwap*/, dict, favorCompressionRatio, nbAttemptsUsed);
 }
 
 
@@ -960,7 +1177,8 @@ LZ4_FORCE_INLINE int LZ4HC_compress_hashChain (
     int const maxOutputSize,
     int maxNbAttempts,
     const limitedOutput_directive limit,
-    const dictCtx_directive dict
+    const dictCtx_directive dict,
+    const LZ4HC_suspend_t* susp
     )
 {
     const int inputSize = *srcSizePtr;
@@ -971,6 +1189,7 @@ LZ4_FORCE_INLINE int LZ4HC_compress_hashChain (
     const BYTE* const iend = ip + inputSize;
     const BYTE* const mflimit = iend - MFLIMIT;
     const BYTE* const matchlimit = (iend - LASTLITERALS);
+    const BYTE* ilimit = mflimit;   /* main loop limit, lower when parsing is suspendable */
 
     BYTE* optr = (BYTE*) dest;
     BYTE* op = (BYTE*) dest;
@@ -981,16 +1200,29 @@ LZ4_FORCE_INLINE int LZ4HC_compress_hashChain (
     const BYTE* start3 = NULL;
     LZ4HC_match_t m0, m1, m2, m3;
     const LZ4HC_match_t nomatch = {0, 0, 0};
+    LZ4HC_work_t work;
+    int nbAttempts;
 
     /* init */
     DEBUGLOG(5, "LZ4HC_compress_hashChain (dict?=>%i)", dict);
     *srcSizePtr = 0;
     if (limit == fillOutput) oend -= LASTLITERALS;                  /* Hack for support LZ4 format restriction */
     if (inputSize < LZ4_minLength) goto _last_literals;             /* Input too small, no compression (all literals) */
+    LZ4HC_work_init(&work, ctx, ip, iend);
+    if (susp != NULL) {
+        if (LZ4HC_RESUMED(susp))
+            LZ4HC_work_resume(&work, &maxNbAttempts, susp->progress, (const BYTE*)source);
+        ip = (const BYTE*)source + susp->progress->srcPos;
+        anchor = (const BYTE*)source + susp->progress->anchorPos;
+        op = (BYTE*)dest + susp->progress->dstPos;
+        if (ilimit - ip >= susp->budget) ilimit = ip + susp->budget - 1;
+    }
 
     /* Main Loop */
-    while (ip <= mflimit) {
-        m1 = LZ4HC_InsertAndFindBestMatch(ctx, ip, matchlimit, maxNbAttempts, patternAnalysis, dict);
+    while (ip <= ilimit) {
+        if (ip >= work.checkpoint) maxNbAttempts = LZ4HC_work_check(&work, ip, maxNbAttempts);
+        m1 = LZ4HC_InsertAndFindBestMatch(ctx, ip, matchlimit, maxNbAttempts, patternAnalysis, dict, &nbAttempts);
+        work.spent += (U32)nbAttempts;
         if (m1.len<MINMATCH) { ip++; continue; }
 
         /* saved, in case we would skip too much */
@@ -1002,7 +1234,8 @@ _Search2:
             start2 = ip + m1.len - 2;
             m2 = LZ4HC_InsertAndGetWiderMatch(ctx,
                             start2, ip + 0, matchlimit, m1.len,
-                            maxNbAttempts, patternAnalysis, 0, dict, favorCompressionRatio);
+                            maxNbAttempts, patternAnalysis, 0, dict, favorCompressionRatio, &nbAttempts);
+            work.spent += (U32)nbAttempts;
             start2 += m2.back;
         } else {
             m2 = nomatch;  /* do not search further */
@@ -1047,7 +1280,8 @@ _Search3:
             start3 = start2 + m2.len - 3;
             m3 = LZ4HC_InsertAndGetWiderMatch(ctx,
                             start3, start2, matchlimit, m2.len,
-                            maxNbAttempts, patternAnalysis, 0, dict, favorCompressionRatio);
+                            maxNbAttempts, patternAnalysis, 0, dict, favorCompressionRatio, &nbAttempts);
+            work.spent += (U32)nbAttempts;
             start3 += m3.back;
         } else {
             m3 = nomatch;  /* do not search further */
@@ -1139,6 +1373,16 @@ _Search3:
         goto _Search3;
     }
 
+    if (ip <= mflimit) {
+        /* budget exhausted : suspend, between two sequences */
+        assert(susp != NULL);
+        susp->progress->srcPos = (int)(ip - (const BYTE*)source);
+        susp->progress->anchorPos = (int)(anchor - (const BYTE*)source);
+        susp->progress->dstPos = (int)(op - (BYTE*)dest);
+        LZ4HC_work_suspend(&work, maxNbAttempts, susp->progress, (const BYTE*)source);
+        return LZ4HC_SUSPENDED;
+    }
+
 _last_literals:
     /* Encode Last Literals */
     {   size_t lastRunSize = (size_t)(iend - anchor);  /* literals */
@@ -1196,13 +1440,15 @@ _dest_overflow:
 }
 
 
+LZ4_MULTIVERSION
 static int LZ4HC_compress_optimal( LZ4HC_CCtx_internal* ctx,
     const char* const source, char* dst,
     int* srcSizePtr, int dstCapacity,
-    int const nbSearches, size_t sufficient_len,
+    int nbSearches, size_t sufficient_len,
     const limitedOutput_directive limit, int const fullUpdate,
     const dictCtx_directive dict,
-    const HCfavor_e favorDecSpeed);
+    const HCfavor_e favorDecSpeed,
+    const LZ4HC_suspend_t* susp);
 
 
 LZ4_FORCE_INLINE int
@@ -1214,7 +1460,8 @@ LZ4HC_compress_generic_internal (
             int const dstCapacity,
             int cLevel,
             const limitedOutput_directive limit,
-            const dictCtx_directive dict
+            const dictCtx_directive dict,
+            const LZ4HC_suspend_t* susp
             )
 {
     typedef enum { lz4mid, lz4hc, lz4opt } lz4hc_strat_e;
@@ -1245,7 +1492,7 @@ LZ4HC_compress_generic_internal (
     if (limit == fillOutput && dstCapacity < 1) return 0;   /* Impossible to store anything */
     if ((U32)*srcSizePtr > (U32)LZ4_MAX_INPUT_SIZE) return 0;    /* Unsupported input size (too large or negative) */
 
-    ctx->end += *srcSizePtr;
+    if (!LZ4HC_RESUMED(susp)) ctx->end += *srcSizePtr;
     /* note : clevel convention is a bit different from lz4frame,
      * possibly something worth revisiting for consistency */
     if (cLevel < 1)
@@ -1262,23 +1509,23 @@ LZ4HC_compress_generic_internal (
         } else if (cParam.strat == lz4hc) {
             result = LZ4HC_compress_hashChain(ctx,
                                 src, dst, srcSizePtr, dstCapacity,
-                                cParam.nbSearches, limit, dict);
+                                cParam.nbSearches, limit, dict, susp);
         } else {
             assert(cParam.strat == lz4opt);
             result = LZ4HC_compress_optimal(ctx,
                                 src, dst, srcSizePtr, dstCapacity,
                                 cParam.nbSearches, cParam.targetLength, limit,
                                 cLevel == LZ4HC_CLEVEL_MAX,   /* ultra mode */
-                                dict, favor);
+                                dict, favor, susp);
         }
-        if (result <= 0) ctx->dirty = 1;
+        if (result == 0) ctx->dirty = 1;
         return result;
     }
 }
 
 static void LZ4HC_setExternalDict(LZ4HC_CCtx_internal* ctxPtr, const BYTE* newBlock);
 
-static int
+LZ4_MULTIVERSION static int
 LZ4HC_compress_generic_noDictCtx (
         LZ4HC_CCtx_internal* const ctx,
         const char* const src,
@@ -1286,14 +1533,15 @@ LZ4HC_compress_generic_noDictCtx (
         int* const srcSizePtr,
         int const dstCapacity,
         int cLevel,
-        limitedOutput_directive limit
+        limitedOutput_directive limit,
+        const LZ4HC_suspend_t* susp
         )
 {
     assert(ctx->dictCtx == NULL);
-    return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, noDictCtx);
+    return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, noDictCtx, susp);
 }
 
-static int
+LZ4_MULTIVERSION static int
 LZ4HC_compress_generic_dictCtx (
         LZ4HC_CCtx_internal* const ctx,
         const char* const src,
@@ -1301,22 +1549,24 @@ LZ4HC_compress_generic_dictCtx (
         int* const srcSizePtr,
         int const dstCapacity,
         int cLevel,
-        limitedOutput_directive limit
+        limitedOutput_directive limit,
+        const LZ4HC_suspend_t* susp
         )
 {
     const size_t position = (size_t)(ctx->end - ctx->prefixStart) + (ctx->dictLimit - ctx->lowLimit);
     assert(ctx->dictCtx != NULL);
-    if (position >= 64 KB) {
+    if (LZ4HC_RESUMED(susp)) {
+        /* dictionary decision was made when block started */
+    } else if (position >= 64 KB) {
         ctx->dictCtx = NULL;
-        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
-    } else if (position == 0 && *srcSizePtr > 4 KB) {
-        LZ4_memcpy(ctx, ctx->dictCtx, sizeof(LZ4HC_CCtx_internal));
+        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, susp);
+    } else if (position == 0 && *srcSizePtr > 4 KB && LZ4HC_sameGeometry(ctx, ctx->dictCtx)) {
+        LZ4_memcpy(ctx, ctx->dictCtx, LZ4HC_sizeofState((int)LZ4HC_hashLog(ctx), LZ4HC_chainLog(ctx)));
         LZ4HC_setExternalDict(ctx, (const BYTE *)src);
         ctx->compressionLevel = (short)cLevel;
-        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
-    } else {
-        return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, usingDictCtxHc);
+        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, susp);
     }
+    return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, usingDictCtxHc, susp);
 }
 
 static int
@@ -1327,13 +1577,14 @@ LZ4HC_compress_generic (
         int* const srcSizePtr,
         int const dstCapacity,
         int cLevel,
-        limitedOutput_directive limit
+        limitedOutput_directive limit,
+        const LZ4HC_suspend_t* susp
         )
 {
     if (ctx->dictCtx == NULL) {
-        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
+        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, susp);
     } else {
-        return LZ4HC_compress_generic_dictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
+        return LZ4HC_compress_generic_dictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, susp);
     }
 }
 
@@ -1359,9 +1610,33 @@ int LZ4_compress_HC_extStateHC_fastReset (void* state, const char* src, char* ds
     LZ4_resetStreamHC_fast((LZ4_streamHC_t*)state, compressionLevel);
     LZ4HC_init_internal (ctx, (const BYTE*)src);
     if (dstCapacity < LZ4_compressBound(srcSize))
-        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, compressionLevel, limitedOutput);
+        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, compressionLevel, limitedOutput, NULL);
     else
-        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, compressionLevel, notLimited);
+        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, compressionLevel, notLimited, NULL);
+}
+
+int LZ4_compress_HC_batch(void* state,
+                    const char* const srcs[], const int srcSizes[],
+                          char* const dsts[], const int dstCapacities[],
+                          int cSizes[], int nbInputs, int compressionLevel)
+{
+    LZ4HC_CCtx_internal* ctx;
+    int n, nbCompressed = 0;
+    DEBUGLOG(5, "LZ4_compress_HC_batch (%i inputs)", nbInputs);
+    if (!LZ4_isAligned(state, LZ4_streamHC_t_alignment())) return 0;
+    ctx = &((LZ4_streamHC_t*)state)->internal_donotuse;   /* only once alignment is validated */
+    LZ4_resetStreamHC_fast((LZ4_streamHC_t*)state, compressionLevel);   /* once : level clamping, dictCtx dropped */
+    for (n = 0; n < nbInputs; n++) {
+        int srcSize = srcSizes[n];
+        /* a failed input leaves state dirty : its settings are reset, as LZ4_resetStreamHC_fast() would */
+        if (ctx->dirty) LZ4_resetStreamHC_fast((LZ4_streamHC_t*)state, compressionLevel);
+        /* new generation, starting beyond previous input */
+        LZ4HC_init_internal(ctx, (const BYTE*)srcs[n]);
+        cSizes[n] = LZ4HC_compress_generic(ctx, srcs[n], dsts[n], &srcSize, dstCapacities[n], compressionLevel,
+                                           (dstCapacities[n] < LZ4_compressBound(srcSizes[n])) ? limitedOutput : notLimited, NULL);
+        nbCompressed += (cSizes[n] > 0);
+    }
+    return nbCompressed;
 }
 
 int LZ4_compress_HC_extStateHC (void* state, const char* src, char* dst, int srcSize, int dstCapacity, int compressionLevel)
@@ -1396,10 +1671,177 @@ int LZ4_compress_HC_destSize(void* state, const char* source, char* dest, int* s
     if (ctx==NULL) return 0;   /* init failure */
     LZ4HC_init_internal(&ctx->internal_donotuse, (const BYTE*) source);
     LZ4_setCompressionLevel(ctx, cLevel);
-    return LZ4HC_compress_generic(&ctx->internal_donotuse, source, dest, sourceSizePtr, targetDestSize, cLevel, fillOutput);
+    return LZ4HC_compress_generic(&ctx->internal_donotuse, source, dest, sourceSizePtr, targetDestSize, cLevel, fillOutput, NULL);
 }
 
 
+/*===   Parallel compression of a single block   ===*/
+
+#ifndef LZ4HC_SEGMENT_MIN
+#  define LZ4HC_SEGMENT_MIN (256 KB)   /* smaller segments cost more to seed than they save */
+#endif
+
+typedef struct {
+    void* state;
+    const char* src;      /* whole input : segment is preceded by its prefix */
+    int start;            /* segment position within src */
+    int size;
+    char* dst;
+    int dstCapacity;
+    int cLevel;
+    int cSize;            /* result, 0 on failure */
+} LZ4HC_segmentJob_t;
+
+static void LZ4HC_compressSegment(void* arg)
+{
+    LZ4HC_segmentJob_t* const job = (LZ4HC_segmentJob_t*)arg;
+    LZ4_streamHC_t* const stream = LZ4_initStreamHC(job->state, sizeof(LZ4_streamHC_t));
+    job->cSize = 0;
+    if (stream == NULL) return;
+    LZ4_setCompressionLevel(stream, job->cLevel);
+    /* previous 64 KB of input are a prefix : segment continues the same history,
+     * so its matches remain valid within the joined block */
+    if (job->start > 0) {
+        int const prefixSize = MIN(job->start, 64 KB);
+        LZ4_loadDictHC(stream, job->src + job->start - prefixSize, prefixSize);
+    }
+    job->cSize = LZ4_compress_HC_continue(stream, job->src + job->start, job->dst, job->size, job->dstCapacity);
+}
+
+/* LZ4HC_readLitLength() :
+ * reads literal length of the sequence starting at @token,
+ * and sets *@literals to the position of its literals */
+static size_t LZ4HC_readLitLength(const BYTE* token, const BYTE** literals)
+{
+    const BYTE* ip = token + 1;
+    size_t ll = *token >> ML_BITS;
+    if (ll == RUN_MASK) {
+        BYTE b;
+        do { b = *ip++; ll += b; } while (b == 255);
+    }
+    *literals = ip;
+    return ll;
+}
+
+/* LZ4HC_lastSequence() :
+ * @return : position of the last sequence (literals only) of a compressed block */
+static const BYTE* LZ4HC_lastSequence(const BYTE* cSrc, size_t cSize)
+{
+    const BYTE* const cEnd = cSrc + cSize;
+    const BYTE* ip = cSrc;
+    while (1) {
+        const BYTE* const token = ip;
+        size_t const ll = LZ4HC_readLitLength(token, &ip);
+        ip += ll;
+        if (ip >= cEnd) return token;
+        ip += 2;   /* offset */
+        if ((*token & ML_MASK) == ML_MASK) {
+            BYTE b;
+            do { b = *ip++; } while (b == 255);
+    }   }
+}
+
+/* LZ4HC_writeLiterals() :
+ * writes the token and literals of a sequence, with match length bits @mlBits.
+ * @return : position after literals */
+static BYTE* LZ4HC_writeLiterals(BYTE* op, const BYTE* literals, size_t ll, BYTE mlBits)
+{
+    if (ll >= RUN_MASK) {
+        size_t len = ll - RUN_MASK;
+        *op++ = (BYTE)((RUN_MASK << ML_BITS) | mlBits);
+        for (; len >= 255; len -= 255) *op++ = 255;
+        *op++ = (BYTE)len;
+    } else {
+        *op++ = (BYTE)((ll << ML_BITS) | mlBits);
+    }
+    LZ4_memmove(op, literals, ll);
+    return op + ll;
+}
+
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+/* Each segment is compressed as an independent block, into a reserved slot sized for worst case,
+ * directly within @dst when it's large enough, otherwise within a temporary buffer.
+ * Blocks are then joined : the trailing literals of each segment are merged
+ * with the leading literals of the next one, which are contiguous in source.
+ * The merged sequence is never larger than the 2 sequences it replaces,
+ * so that joining can proceed forward within @dst. */
+int LZ4_compress_HC_parallel(void* states[], int nbStates,
+                       const char* src, char* dst, int srcSize, int dstCapacity,
+                             int compressionLevel, const LZ4HC_Executor* executor)
+{
+    int const nbSegments = MAX(1, MIN(nbStates, srcSize / LZ4HC_SEGMENT_MIN));
+    LZ4HC_segmentJob_t* jobs;
+    char* slots;
+    size_t slotsSize = 0;
+    BYTE* op = (BYTE*)dst;
+    BYTE* const oend = op + dstCapacity;
+    size_t pending = 0;   /* literals preceding current segment, not yet written */
+    int n, result = 0;
+
+    DEBUGLOG(4, "LZ4_compress_HC_parallel (srcSize=%i, nbStates=%i)", srcSize, nbStates);
+    if (states == NULL || nbStates < 1 || srcSize < 0 || (unsigned)srcSize > LZ4_MAX_INPUT_SIZE) return 0;
+    if (executor != NULL && (executor->submitJob == NULL || executor->completeJobs == NULL)) return 0;
+    if (nbSegments == 1)
+        return LZ4_compress_HC_extStateHC(states[0], src, dst, srcSize, dstCapacity, compressionLevel);
+
+    jobs = (LZ4HC_segmentJob_t*)ALLOC(sizeof(LZ4HC_segmentJob_t) * (size_t)nbSegments);
+    if (jobs == NULL) return 0;
+    for (n = 0; n < nbSegments; n++) {
+        jobs[n].start = (int)(((U64)srcSize * (U64)n) / (U64)nbSegments);
+        jobs[n].size = (int)(((U64)srcSize * (U64)(n+1)) / (U64)nbSegments) - jobs[n].start;
+        jobs[n].dstCapacity = LZ4_compressBound(jobs[n].size);
+        slotsSize += (size_t)jobs[n].dstCapacity;
+    }
+    slots = (slotsSize <= (size_t)MAX(dstCapacity, 0)) ? dst : (char*)ALLOC(slotsSize);
+    if (slots == NULL) { FREEMEM(jobs); return 0; }
+
+    {   char* slot = slots;
+        for (n = 0; n < nbSegments; n++) {
+            jobs[n].state = states[n];
+            jobs[n].src = src;
+            jobs[n].dst = slot;
+            jobs[n].cLevel = compressionLevel;
+            slot += jobs[n].dstCapacity;
+            if (executor == NULL) LZ4HC_compressSegment(jobs + n);
+            else executor->submitJob(executor->opaqueState, LZ4HC_compressSegment, jobs + n);
+    }   }
+    if (executor != NULL) executor->completeJobs(executor->opaqueState);
+
+    /* join segments */
+    for (n = 0; n < nbSegments; n++) {
+        const BYTE* const cSeg = (const BYTE*)jobs[n].dst;
+        const BYTE* last;
+        const BYTE* literals;
+        size_t ll;
+        if (jobs[n].cSize <= 0) goto _end;
+        last = LZ4HC_lastSequence(cSeg, (size_t)jobs[n].cSize);
+        ll = LZ4HC_readLitLength(cSeg, &literals);
+        if (last == cSeg) {   /* segment is only literals */
+            pending += ll;
+            continue;
+        }
+        {   size_t const seqsSize = (size_t)(last - (literals + ll));   /* remaining sequences of segment */
+            size_t const headSize = 1 + (pending + ll + 255 - RUN_MASK) / 255 + pending + ll;
+            if ((size_t)(oend - op) < headSize + seqsSize) goto _end;
+            op = LZ4HC_writeLiterals(op, (const BYTE*)src + jobs[n].start - pending, pending + ll, (BYTE)(*cSeg & ML_MASK));
+            LZ4_memmove(op, literals + ll, seqsSize);
+            op += seqsSize;
+        }
+        pending = LZ4HC_readLitLength(last, &literals);
+    }
+    /* last literals */
+    if ((size_t)(oend - op) < 1 + (pending + 255 - RUN_MASK) / 255 + pending) goto _end;
+    op = LZ4HC_writeLiterals(op, (const BYTE*)src + srcSize - pending, pending, 0);
+    result = (int)((char*)op - dst);
+
+_end:
+    if (slots != dst) FREEMEM(slots);
+    FREEMEM(jobs);
+    return result;
+}
+#endif
+
+
 
 /**************************************
 *  Streaming Functions
@@ -1427,15 +1869,34 @@ int LZ4_freeStreamHC (LZ4_streamHC_t* LZ4_streamHCPtr)
 
 LZ4_streamHC_t* LZ4_initStreamHC (void* buffer, size_t size)
 {
-    LZ4_streamHC_t* const LZ4_streamHCPtr = (LZ4_streamHC_t*)buffer;
     DEBUGLOG(4, "LZ4_initStreamHC(%p, %u)", buffer, (unsigned)size);
+    if (size < sizeof(LZ4_streamHC_t)) return NULL;
+    return LZ4_initStreamHC_advanced(buffer, size, LZ4HC_HASH_LOG, LZ4HC_DICTIONARY_LOGSIZE);
+}
+
+int LZ4_sizeofStreamHC_advanced(int hashLog, int chainLog)
+{
+    if ((hashLog < LZ4HC_HASHLOG_MIN) || (hashLog > LZ4HC_HASH_LOG)) return 0;
+    if ((chainLog < LZ4HC_CHAINLOG_MIN) || (chainLog > LZ4HC_DICTIONARY_LOGSIZE)) return 0;
+    return (int)LZ4HC_sizeofState(hashLog, chainLog);
+}
+
+LZ4_streamHC_t* LZ4_initStreamHC_advanced (void* buffer, size_t size, int hashLog, int chainLog)
+{
+    LZ4_streamHC_t* const LZ4_streamHCPtr = (LZ4_streamHC_t*)buffer;
+    size_t const stateSize = (size_t)LZ4_sizeofStreamHC_advanced(hashLog, chainLog);
+    DEBUGLOG(4, "LZ4_initStreamHC_advanced(%p, %u, %i, %i)", buffer, (unsigned)size, hashLog, chainLog);
+    LZ4_STATIC_ASSERT(sizeof(LZ4HC_CCtx_internal) <= LZ4_STREAMHC_MINSIZE);
     /* check conditions */
     if (buffer == NULL) return NULL;
-    if (size < sizeof(LZ4_streamHC_t)) return NULL;
+    if (stateSize == 0) return NULL;   /* invalid parameters */
+    if (size < stateSize) return NULL;
     if (!LZ4_isAligned(buffer, LZ4_streamHC_t_alignment())) return NULL;
     /* init */
     { LZ4HC_CCtx_internal* const hcstate = &(LZ4_streamHCPtr->internal_donotuse);
-      MEM_INIT(hcstate, 0, sizeof(*hcstate)); }
+      MEM_INIT(hcstate, 0, stateSize);
+      hcstate->hashLogReduction = (BYTE)(LZ4HC_HASH_LOG - hashLog);
+      hcstate->chainLogReduction = (BYTE)(LZ4HC_DICTIONARY_LOGSIZE - chainLog); }
     LZ4_setCompressionLevel(LZ4_streamHCPtr, LZ4HC_CLEVEL_DEFAULT);
     return LZ4_streamHCPtr;
 }
@@ -1452,14 +1913,17 @@ void LZ4_resetStreamHC_fast (LZ4_streamHC_t* LZ4_streamHCPtr, int compressionLev
     LZ4HC_CCtx_internal* const s = &LZ4_streamHCPtr->internal_donotuse;
     DEBUGLOG(5, "LZ4_resetStreamHC_fast(%p, %d)", LZ4_streamHCPtr, compressionLevel);
     if (s->dirty) {
-        LZ4_initStreamHC(LZ4_streamHCPtr, sizeof(*LZ4_streamHCPtr));
-    } else {
-        assert(s->end >= s->prefixStart);
-        s->dictLimit += (U32)(s->end - s->prefixStart);
-        s->prefixStart = NULL;
-        s->end = NULL;
-        s->dictCtx = NULL;
+        /* a failed compression only inserted positions < end,
+         * skipping them is enough : settings are reset, but tables are not cleared */
+        s->favorDecSpeed = 0;
+        s->workLimit = 0;
+        s->dirty = 0;
     }
+    assert(s->end >= s->prefixStart);
+    s->dictLimit += (U32)(s->end - s->prefixStart);
+    s->prefixStart = NULL;
+    s->end = NULL;
+    s->dictCtx = NULL;
     LZ4_setCompressionLevel(LZ4_streamHCPtr, compressionLevel);
 }
 
@@ -1476,6 +1940,13 @@ void LZ4_favorDecompressionSpeed(LZ4_streamHC_t* LZ4_streamHCPtr, int favor)
     LZ4_streamHCPtr->internal_donotuse.favorDecSpeed = (favor!=0);
 }
 
+void LZ4_setWorkLimitHC(LZ4_streamHC_t* LZ4_streamHCPtr, int limit)
+{
+    if (limit < 0) limit = 0;
+    if (limit > LZ4HC_WORKLIMIT_NONE) limit = LZ4HC_WORKLIMIT_NONE;
+    LZ4_streamHCPtr->internal_donotuse.workLimit = (BYTE)limit;
+}
+
 /* LZ4_loadDictHC() :
  * LZ4_streamHCPtr is presumed properly initialized */
 int LZ4_loadDictHC (LZ4_streamHC_t* LZ4_streamHCPtr,
@@ -1488,11 +1959,11 @@ int LZ4_loadDictHC (LZ4_streamHC_t* LZ4_streamHCPtr,
         dictionary += (size_t)dictSize - 64 KB;
         dictSize = 64 KB;
     }
-    /* need a full initialization, there are bad side-effects when using resetFast() */
-    {   int const cLevel = ctxPtr->compressionLevel;
-        LZ4_initStreamHC(LZ4_streamHCPtr, sizeof(*LZ4_streamHCPtr));
-        LZ4_setCompressionLevel(LZ4_streamHCPtr, cLevel);
-    }
+    /* start a new generation : stale entries can't reach into the dictionary,
+     * see LZ4HC_init_internal(). Settings other than compression level are reset. */
+    LZ4_resetStreamHC_fast(LZ4_streamHCPtr, ctxPtr->compressionLevel);
+    ctxPtr->favorDecSpeed = 0;
+    ctxPtr->workLimit = 0;
     LZ4HC_init_internal (ctxPtr, (const BYTE*)dictionary);
     ctxPtr->end = (const BYTE*)dictionary + dictSize;
     if (dictSize >= LZ4HC_HASHSIZE) LZ4HC_Insert (ctxPtr, ctxPtr->end-3);
@@ -1503,6 +1974,37 @@ void LZ4_attach_HC_dictionary(LZ4_streamHC_t *working_stream, const LZ4_streamHC
     working_stream->internal_donotuse.dictCtx = dictionary_stream != NULL ? &(dictionary_stream->internal_donotuse) : NULL;
 }
 
+LZ4_streamHC_t* LZ4_cloneStreamHC(void* dstBuffer, size_t dstSize, const LZ4_streamHC_t* srcStream)
+{
+    const LZ4HC_CCtx_internal* const src = &srcStream->internal_donotuse;
+    LZ4HC_CCtx_internal* dst;
+    DEBUGLOG(5, "LZ4_cloneStreamHC (%p => %p)", srcStream, dstBuffer);
+    if ((dstBuffer == NULL) || (srcStream == NULL)) return NULL;
+    if (!LZ4_isAligned(dstBuffer, LZ4_streamHC_t_alignment())) return NULL;
+    if (dstSize < LZ4HC_sizeofState(LZ4HC_hashLog(src), LZ4HC_chainLog(src))) return NULL;
+    if (dstBuffer == (const void*)srcStream) return (LZ4_streamHC_t*)dstBuffer;
+    dst = &((LZ4_streamHC_t*)dstBuffer)->internal_donotuse;
+
+    /* header and hashTable : history buffers and dictCtx are referenced, not copied */
+    LZ4_memcpy(dst, src, offsetof(LZ4HC_CCtx_internal, hashTable) + (sizeof(U32) << LZ4HC_hashLog(src)));
+
+    /* chainTable : searches never go below lowLimit, nor further than LZ4_DISTANCE_MAX,
+     * and positions >= nextToUpdate are written before being read.
+     * So only the entries of the current window are needed. */
+    {   U32 const chainSize = LZ4HC_chainMask(src) + 1;
+        U32 const windowStart = (src->nextToUpdate - src->lowLimit > LZ4_DISTANCE_MAX) ?
+                                src->nextToUpdate - LZ4_DISTANCE_MAX : src->lowLimit;
+        U32 const nbEntries = MIN(src->nextToUpdate - windowStart, chainSize);
+        U32 const start = windowStart & (chainSize - 1);
+        U32 const firstPart = MIN(nbEntries, chainSize - start);
+        const U16* const srcChain = LZ4HC_chainTable(src);
+        U16* const dstChain = LZ4HC_chainTable(dst);
+        LZ4_memcpy(dstChain + start, srcChain + start, firstPart * sizeof(U16));
+        LZ4_memcpy(dstChain, srcChain, (nbEntries - firstPart) * sizeof(U16));
+    }
+    return (LZ4_streamHC_t*)dstBuffer;
+}
+
 /* compression */
 
 static void LZ4HC_setExternalDict(LZ4HC_CCtx_internal* ctxPtr, const BYTE* newBlock)
@@ -1510,6 +2012,16 @@ static void LZ4HC_setExternalDict(LZ4HC_CCtx_internal* ctxPtr, const BYTE* newBl
     DEBUGLOG(4, "LZ4HC_setExternalDict(%p, %p)", ctxPtr, newBlock);
     if (ctxPtr->end >= ctxPtr->prefixStart + 4)
         LZ4HC_Insert (ctxPtr, ctxPtr->end-3);   /* Referencing remaining dictionary content */
+    /* Last positions are never inserted, yet chain swapping reads their chain entries.
+     * Tables are not cleared between generations (see LZ4HC_init_internal()) :
+     * give these entries their initial value, so that output doesn't depend on previous use of the state */
+    {   U16* const chainTable = LZ4HC_chainTable(ctxPtr);
+        U32 const chainMask = LZ4HC_chainMask(ctxPtr);
+        U32 const endIdx = ctxPtr->dictLimit + (U32)(ctxPtr->end - ctxPtr->prefixStart);
+        U32 idx;
+        for (idx = MAX(ctxPtr->nextToUpdate, ctxPtr->dictLimit); idx < endIdx; idx++)
+            DELTANEXTMASK(chainTable, idx, chainMask) = 0;
+    }
 
     /* Only one memory segment for extDict, so any previous extDict is lost at this stage */
     ctxPtr->lowLimit  = ctxPtr->dictLimit;
@@ -1527,7 +2039,8 @@ static int
 LZ4_compressHC_continue_generic (LZ4_streamHC_t* LZ4_streamHCPtr,
                                  const char* src, char* dst,
                                  int* srcSizePtr, int dstCapacity,
-                                 limitedOutput_directive limit)
+                                 limitedOutput_directive limit,
+                                 const LZ4HC_suspend_t* susp)
 {
     LZ4HC_CCtx_internal* const ctxPtr = &LZ4_streamHCPtr->internal_donotuse;
     DEBUGLOG(5, "LZ4_compressHC_continue_generic(ctx=%p, src=%p, srcSize=%d, limit=%d)",
@@ -1561,21 +2074,43 @@ LZ4_compressHC_continue_generic (LZ4_streamHC_t* LZ4_streamHCPtr,
                 ctxPtr->dictStart = ctxPtr->prefixStart;
     }   }   }
 
-    return LZ4HC_compress_generic (ctxPtr, src, dst, srcSizePtr, dstCapacity, ctxPtr->compressionLevel, limit);
+    return LZ4HC_compress_generic (ctxPtr, src, dst, srcSizePtr, dstCapacity, ctxPtr->compressionLevel, limit, susp);
 }
 
 int LZ4_compress_HC_continue (LZ4_streamHC_t* LZ4_streamHCPtr, const char* src, char* dst, int srcSize, int dstCapacity)
 {
     DEBUGLOG(5, "LZ4_compress_HC_continue");
     if (dstCapacity < LZ4_compressBound(srcSize))
-        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, limitedOutput);
+        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, limitedOutput, NULL);
     else
-        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, notLimited);
+        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, notLimited, NULL);
 }
 
 int LZ4_compress_HC_continue_destSize (LZ4_streamHC_t* LZ4_streamHCPtr, const char* src, char* dst, int* srcSizePtr, int targetDestSize)
 {
-    return LZ4_compressHC_continue_generic(LZ4_streamHCPtr, src, dst, srcSizePtr, targetDestSize, fillOutput);
+    return LZ4_compressHC_continue_generic(LZ4_streamHCPtr, src, dst, srcSizePtr, targetDestSize, fillOutput, NULL);
+}
+
+int LZ4_compress_HC_continue_budget (LZ4_streamHC_t* LZ4_streamHCPtr, const char* src, char* dst, int srcSize, int dstCapacity,
+                                     LZ4HC_resume_t* resume, int budget)
+{
+    LZ4HC_CCtx_internal* const ctxPtr = &LZ4_streamHCPtr->internal_donotuse;
+    limitedOutput_directive const limit = (dstCapacity < LZ4_compressBound(srcSize)) ? limitedOutput : notLimited;
+    LZ4HC_suspend_t susp;
+    int result;
+    DEBUGLOG(5, "LZ4_compress_HC_continue_budget (srcPos=%i, budget=%i)", resume->srcPos, budget);
+    susp.progress = resume;
+    susp.budget = MAX(budget, 1);
+    if (resume->srcPos == 0) {
+        result = LZ4_compressHC_continue_generic(LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, limit, &susp);
+    } else {
+        /* block already registered within context */
+        assert(srcSize > resume->srcPos);
+        result = LZ4HC_compress_generic(ctxPtr, src, dst, &srcSize, dstCapacity, ctxPtr->compressionLevel, limit, &susp);
+    }
+    if (result == LZ4HC_SUSPENDED) return -1;
+    MEM_INIT(resume, 0, sizeof(*resume));   /* ready for next block */
+    return result;
 }
 
 
@@ -1661,12 +2196,12 @@ int LZ4_freeHC (void* LZ4HC_Data)
 
 int LZ4_compressHC2_continue (void* LZ4HC_Data, const char* src, char* dst, int srcSize, int cLevel)
 {
-    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, 0, cLevel, notLimited);
+    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, 0, cLevel, notLimited, NULL);
 }
 
 int LZ4_compressHC2_limitedOutput_continue (void* LZ4HC_Data, const char* src, char* dst, int srcSize, int dstCapacity, int cLevel)
 {
-    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, dstCapacity, cLevel, limitedOutput);
+    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, dstCapacity, cLevel, limitedOutput, NULL);
 }
 
 char* LZ4_slideInputBufferHC(void* LZ4HC_Data)
@@ -1717,18 +2252,262 @@ LZ4_FORCE_INLINE int LZ4HC_sequencePrice(int litlen, int mlen)
 
 
 
+/* ================================================
+ *  Binary tree match finder (optimal parser)
+ * ===============================================*/
+/* Each position of the current window is a node of a binary search tree,
+ * sorted by the content starting at this position. A single descent visits
+ * candidates sharing progressively longer prefixes with the searched position,
+ * while inserting it as the new root. Unlike the hash chain, its cost doesn't grow
+ * with the number of candidates sharing the same first bytes.
+ * The tree lives in a workspace allocated by the compression call which needs it,
+ * and is built from prefix history at that point.
+ * Matches into an extDict segment are still searched using the hash chain. */
+#define LZ4HC_BT_LOG      16
+#define LZ4HC_BT_SIZE     (1 << LZ4HC_BT_LOG)
+#define LZ4HC_BT_MASK     (LZ4HC_BT_SIZE - 1)
+#define LZ4HC_BT_CMP_MAX  LZ4_OPT_NUM   /* comparison limit when only indexing a position */
+#define LZ4HC_BT_MIN_SRCSIZE (16 KB) /* below this size, workspace setup costs more than it saves */
+#define LZ4HC_BT_SAMPLE   4096       /* nb of hash chain searches between evaluations */
+#define LZ4HC_BT_SWITCH   128        /* avg nb of chain candidates per search triggering the switch */
+
+typedef struct {
+    U32 hashTable[LZ4HC_HASHTABLESIZE];
+    U32 tree[2 * LZ4HC_BT_SIZE];   /* {smaller, larger} children of each position, modulo window size */
+    U32 nextToUpdate;              /* index of next position to insert */
+} LZ4HC_bt_t;
+
+static void LZ4HC_bt_init(LZ4HC_bt_t* bt, const LZ4HC_CCtx_internal* ctx, const BYTE* src)
+{
+    U32 const srcIdx = (U32)(src - ctx->prefixStart) + ctx->dictLimit;
+    LZ4_STATIC_ASSERT(LZ4_DISTANCE_MAX < LZ4HC_BT_SIZE);
+    MEM_INIT(bt->hashTable, 0, sizeof(bt->hashTable));
+    /* history already present in prefix gets indexed on first search */
+    bt->nextToUpdate = (srcIdx - ctx->dictLimit > LZ4_DISTANCE_MAX) ? srcIdx - LZ4_DISTANCE_MAX : ctx->dictLimit;
+}
+
+/* LZ4HC_bt_descend() :
+ * Walks the tree from the root of @ip's hash bucket, and inserts @ip as new root when @insert is set.
+ * Comparisons stop at @cmpLimit, candidates identical up to there are ordered by their next byte.
+ * Candidates examined are added to *@nbCandidates.
+ * @return : longest match found, with len==0 if none.
+ *  When @insert is set, @ip must be the next position to insert. */
+LZ4_FORCE_INLINE LZ4HC_match_t
+LZ4HC_bt_descend(LZ4HC_bt_t* const bt,
+                 const BYTE* const prefixPtr, U32 const prefixIdx,
+                 const BYTE* const ip, const BYTE* const cmpLimit,
+                 int nbCompares, int const insert,
+                 const HCfavor_e favorDecSpeed,
+                 U32* const nbCandidates)
+{
+    U32 const ipIndex = (U32)(ip - prefixPtr) + prefixIdx;
+    U32 const lowestMatchIndex = (ipIndex - prefixIdx > LZ4_DISTANCE_MAX) ? ipIndex - LZ4_DISTANCE_MAX : prefixIdx;
+    U32* const head = &bt->hashTable[LZ4HC_hashPtr(ip, LZ4HC_HASH_LOG)];
+    U32* smallerPtr = &bt->tree[2*(ipIndex & LZ4HC_BT_MASK)];
+    U32* largerPtr  = smallerPtr + 1;
+    size_t commonLengthSmaller = 0, commonLengthLarger = 0;
+    U32 matchIndex = *head;
+    int n = 0;
+    LZ4HC_match_t md;
+
+    md.off = 0; md.len = 0; md.back = 0;
+    if (insert) *head = ipIndex;
+
+    while ((matchIndex >= lowestMatchIndex) && (n < nbCompares)) {
+        U32* const nextPtr = &bt->tree[2*(matchIndex & LZ4HC_BT_MASK)];
+        const BYTE* const matchPtr = prefixPtr + (matchIndex - prefixIdx);
+        size_t ml = MIN(commonLengthSmaller, commonLengthLarger);
+        assert(matchIndex < ipIndex);
+        n++;
+        ml += LZ4_count(ip+ml, matchPtr+ml, cmpLimit);
+
+        if ( (ml >= MINMATCH) && ((int)ml > md.len)
+          && !(favorDecSpeed && (ipIndex - matchIndex < 8)) ) {
+            md.len = (int)ml;
+            md.off = (int)(ipIndex - matchIndex);
+        }
+
+        if (matchPtr[ml] < ip[ml]) {
+            if (insert) *smallerPtr = matchIndex;
+            commonLengthSmaller = ml;
+            smallerPtr = nextPtr + 1;
+            matchIndex = nextPtr[1];
+        } else {
+            if (insert) *largerPtr = matchIndex;
+            commonLengthLarger = ml;
+            largerPtr = nextPtr;
+            matchIndex = nextPtr[0];
+    }   }
+
+    if (insert) *smallerPtr = *largerPtr = 0;
+    OPT_STAT(nbCandidates, n);
+    *nbCandidates += (U32)n;
+    return md;
+}
+
+/* LZ4HC_bt_searchExtDict() :
+ * Follows the hash chain, which still references extDict positions, within reach of @ip.
+ * The tree already covers prefix positions, which are skipped. */
+static LZ4HC_match_t
+LZ4HC_bt_searchExtDict(const LZ4HC_CCtx_internal* const hc4,
+                       const BYTE* const ip, const BYTE* const iHighLimit,
+                       LZ4HC_match_t md, int nbAttempts,
+                       const HCfavor_e favorDecSpeed,
+                       U32* const nbCandidates)
+{
+    const BYTE* const prefixPtr = hc4->prefixStart;
+    U32 const prefixIdx = hc4->dictLimit;
+    U32 const ipIndex = (U32)(ip - prefixPtr) + prefixIdx;
+    U32 const lowestMatchIndex = (hc4->lowLimit + LZ4_DISTANCE_MAX > ipIndex) ? hc4->lowLimit : ipIndex - LZ4_DISTANCE_MAX;
+    const BYTE* const dictStart = hc4->dictStart;
+    U32 const dictIdx = hc4->lowLimit;
+    U32 const pattern = LZ4_read32(ip);
+    const U16* const chainTable = LZ4HC_chainTable(hc4);
+    U32 matchIndex = hc4->hashTable[LZ4HC_hashPtr(ip, LZ4HC_HASH_LOG)];
+    assert(hc4->hashLogReduction == 0 && hc4->chainLogReduction == 0);
+
+    while ((matchIndex >= lowestMatchIndex) && (matchIndex < ipIndex) && (nbAttempts-- > 0)) {
+        OPT_STAT(nbCandidates, 1);
+        (*nbCandidates)++;
+        if ( (matchIndex <= prefixIdx - 4)
+          && !(favorDecSpeed && (ipIndex - matchIndex < 8)) ) {
+            const BYTE* const matchPtr = dictStart + (matchIndex - dictIdx);
+            if (LZ4_read32(matchPtr) == pattern) {
+                const BYTE* vLimit = ip + (prefixIdx - matchIndex);
+                int matchLength;
+                if (vLimit > iHighLimit) vLimit = iHighLimit;
+                matchLength = (int)LZ4_count(ip+MINMATCH, matchPtr+MINMATCH, vLimit) + MINMATCH;
+                if ((ip+matchLength == vLimit) && (vLimit < iHighLimit))
+                    matchLength += (int)LZ4_count(ip+matchLength, prefixPtr, iHighLimit);
+                if (matchLength > md.len) {
+                    md.len = matchLength;
+                    md.off = (int)(ipIndex - matchIndex);
+        }   }   }
+        {   U32 const delta = DELTANEXTU16(chainTable, matchIndex);
+            if (delta == 0 || delta > matchIndex) break;
+            matchIndex -= delta;
+    }   }
+    return md;
+}
+
+/* LZ4HC_bt_findLongest() :
+ * Indexes all positions up to @ip, and returns the longest match for @ip.
+ * Candidates examined are added to *@nbCandidates. */
+LZ4_FORCE_INLINE LZ4HC_match_t
+LZ4HC_bt_findLongest(LZ4HC_bt_t* const bt, const LZ4HC_CCtx_internal* const ctx,
+                     const BYTE* const ip, const BYTE* const iHighLimit,
+                     int const nbCompares, const HCfavor_e favorDecSpeed,
+                     U32* const nbCandidates)
+{
+    const BYTE* const prefixPtr = ctx->prefixStart;
+    U32 const prefixIdx = ctx->dictLimit;
+    U32 const ipIndex = (U32)(ip - prefixPtr) + prefixIdx;
+    LZ4HC_match_t md;
+
+    while (bt->nextToUpdate < ipIndex) {
+        const BYTE* const pos = prefixPtr + (bt->nextToUpdate - prefixIdx);
+        const BYTE* const cmpLimit = (iHighLimit - pos > LZ4HC_BT_CMP_MAX) ? pos + LZ4HC_BT_CMP_MAX : iHighLimit;
+        (void)LZ4HC_bt_descend(bt, prefixPtr, prefixIdx, pos, cmpLimit, nbCompares, 1, favorCompressionRatio, nbCandidates);
+        bt->nextToUpdate++;
+    }
+
+    if (bt->nextToUpdate == ipIndex) {
+        md = LZ4HC_bt_descend(bt, prefixPtr, prefixIdx, ip, iHighLimit, nbCompares, 1, favorDecSpeed, nbCandidates);
+        bt->nextToUpdate++;
+    } else {
+        md = LZ4HC_bt_descend(bt, prefixPtr, prefixIdx, ip, iHighLimit, nbCompares, 0, favorDecSpeed, nbCandidates);
+    }
+
+    if ( (ctx->lowLimit < prefixIdx) && (ipIndex - prefixIdx < LZ4_DISTANCE_MAX) ) {
+        md = LZ4HC_bt_searchExtDict(ctx, ip, iHighLimit, md, nbCompares, favorDecSpeed, nbCandidates);
+    }
+    return md;
+}
+
+/* Match finder of the optimal parser.
+ * Hash chains are cheap to maintain, and fast whenever candidates are few or quickly sorted out.
+ * When they average more than LZ4HC_BT_SWITCH candidates per search, which is only possible
+ * at levels with a larger search budget, the rest of the block is searched with a binary tree. */
+typedef struct {
+    LZ4HC_bt_t* bt;      /* NULL while searching with hash chain */
+    int allowTree;
+    U32 nbSearches;      /* within current sample */
+    U32 nbAttempts;
+} LZ4HC_finder_t;
+
+static void LZ4HC_finder_sample(LZ4HC_finder_t* f, const LZ4HC_CCtx_internal* ctx, const BYTE* ip, int nbAttempts)
+{
+    f->nbSearches++;
+    if (nbAttempts > 0) f->nbAttempts += (U32)nbAttempts;
+    if (f->nbSearches < LZ4HC_BT_SAMPLE) return;
+    if (f->nbAttempts > LZ4HC_BT_SWITCH * LZ4HC_BT_SAMPLE) {
+        f->allowTree = 0;   /* decision is final for this block */
+#if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
+        f->bt = (LZ4HC_bt_t*)ALLOC(sizeof(LZ4HC_bt_t));
+        if (f->bt != NULL) { LZ4HC_bt_init(f->bt, ctx, ip); OPT_STAT(nbTreeSwitches, 1); }
+#else
+        (void)ctx; (void)ip;
+#endif
+    }
+    f->nbSearches = 0;
+    f->nbAttempts = 0;
+}
+
+/* LZ4HC_bt_updateHashChain() :
+ * Positions indexed by the tree are absent from the hash chain.
+ * Reference the last window up to @ip, for the benefit of future blocks. */
+static void LZ4HC_bt_updateHashChain(LZ4HC_CCtx_internal* ctx, const BYTE* ip)
+{
+    U32 const target = (U32)(ip - ctx->prefixStart) + ctx->dictLimit;
+    if (ctx->nextToUpdate + LZ4_DISTANCE_MAX < target)
+        ctx->nextToUpdate = target - LZ4_DISTANCE_MAX;
+    LZ4HC_Insert(ctx, ip);
+}
+
+#define TRAILING_LITERALS 3
+
+#if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
+/* Optimal parser workspace.
+ * A block compressed by LZ4_compress_HC_continue_budget() keeps it across invocations,
+ * within LZ4HC_resume_t, so that neither the allocation nor the tree are redone at each step. */
+typedef struct {
+    LZ4HC_optimal_t opt[LZ4_OPT_NUM + TRAILING_LITERALS];
+    LZ4HC_finder_t finder;
+} LZ4HC_optWksp_t;
+
+static void LZ4HC_optWksp_free(LZ4HC_optWksp_t* wksp)
+{
+    if (wksp == NULL) return;
+    if (wksp->finder.bt) FREEMEM(wksp->finder.bt);
+    FREEMEM(wksp);
+}
+#endif
+
+
 LZ4_FORCE_INLINE LZ4HC_match_t
-LZ4HC_FindLongerMatch(LZ4HC_CCtx_internal* const ctx,
+LZ4HC_FindLongerMatch(LZ4HC_CCtx_internal* const ctx, LZ4HC_finder_t* const finder,
                       const BYTE* ip, const BYTE* const iHighLimit,
                       int minLen, int nbSearches,
                       const dictCtx_directive dict,
-                      const HCfavor_e favorDecSpeed)
+                      const HCfavor_e favorDecSpeed,
+                      LZ4HC_work_t* const work)
 {
     LZ4HC_match_t const match0 = { 0 , 0, 0 };
-    /* note : LZ4HC_InsertAndGetWiderMatch() is able to modify the starting position of a match (*startpos),
-     * but this won't be the case here, as we define iLowLimit==ip,
-    ** so LZ4HC_InsertAndGetWiderMatch() won't be allowed to search past ip */
-    LZ4HC_match_t md = LZ4HC_InsertAndGetWiderMatch(ctx, ip, ip, iHighLimit, minLen, nbSearches, 1 /*patternAnalysis*/, 1 /*chainSwap*/, dict, favorDecSpeed);
+    LZ4HC_match_t md;
+    OPT_STAT(nbSearches, 1);
+    if (finder->bt != NULL) {
+        assert(dict == noDictCtx);
+        md = LZ4HC_bt_findLongest(finder->bt, ctx, ip, iHighLimit, nbSearches, favorDecSpeed, &work->spent);
+    } else {
+        int nbAttempts;
+        /* note : LZ4HC_InsertAndGetWiderMatch() is able to modify the starting position of a match (*startpos),
+         * but this won't be the case here, as we define iLowLimit==ip,
+        ** so LZ4HC_InsertAndGetWiderMatch() won't be allowed to search past ip */
+        md = LZ4HC_InsertAndGetWiderMatch(ctx, ip, ip, iHighLimit, minLen, nbSearches, 1 /*patternAnalysis*/, 1 /*chainSwap*/, dict, favorDecSpeed, &nbAttempts);
+        OPT_STAT(nbCandidates, nbAttempts);
+        work->spent += (U32)nbAttempts;
+        if (finder->allowTree) LZ4HC_finder_sample(finder, ctx, ip, nbAttempts);
+    }
     assert(md.back == 0);
     if (md.len <= minLen) return match0;
     if (favorDecSpeed) {
@@ -1738,31 +2517,40 @@ LZ4HC_FindLongerMatch(LZ4HC_CCtx_internal* const ctx,
 }
 
 
+LZ4_MULTIVERSION
 static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
                                     const char* const source,
                                     char* dst,
                                     int* srcSizePtr,
                                     int dstCapacity,
-                                    int const nbSearches,
+                                    int nbSearches,
                                     size_t sufficient_len,
                                     const limitedOutput_directive limit,
                                     int const fullUpdate,
                                     const dictCtx_directive dict,
-                                    const HCfavor_e favorDecSpeed)
+                                    const HCfavor_e favorDecSpeed,
+                                    const LZ4HC_suspend_t* susp)
 {
     int retval = 0;
-#define TRAILING_LITERALS 3
 #if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
-    LZ4HC_optimal_t* const opt = (LZ4HC_optimal_t*)ALLOC(sizeof(LZ4HC_optimal_t) * (LZ4_OPT_NUM + TRAILING_LITERALS));
+    LZ4HC_optWksp_t* wksp = (susp != NULL) ? (LZ4HC_optWksp_t*)susp->progress->optWksp : NULL;
+    int const fresh = (wksp == NULL);
+    LZ4HC_optimal_t* opt;
+    LZ4HC_finder_t* finder;
 #else
     LZ4HC_optimal_t opt[LZ4_OPT_NUM + TRAILING_LITERALS];   /* ~64 KB, which is a bit large for stack... */
+    LZ4HC_finder_t finderSpace;
+    LZ4HC_finder_t* const finder = &finderSpace;
+    int const fresh = 1;
 #endif
+    LZ4HC_work_t work;
 
     const BYTE* ip = (const BYTE*) source;
     const BYTE* anchor = ip;
     const BYTE* const iend = ip + *srcSizePtr;
     const BYTE* const mflimit = iend - MFLIMIT;
     const BYTE* const matchlimit = iend - LASTLITERALS;
+    const BYTE* ilimit = mflimit;   /* main loop limit, lower when parsing is suspendable */
     BYTE* op = (BYTE*) dst;
     BYTE* opSaved = (BYTE*) dst;
     BYTE* oend = op + dstCapacity;
@@ -1770,26 +2558,54 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
     int ovoff = 0;
 
     /* init */
+    LZ4HC_work_init(&work, ctx, ip, iend);
+    if (susp != NULL) {
+        if (LZ4HC_RESUMED(susp))
+            LZ4HC_work_resume(&work, &nbSearches, susp->progress, (const BYTE*)source);
+        ip = (const BYTE*)source + susp->progress->srcPos;
+        anchor = (const BYTE*)source + susp->progress->anchorPos;
+        op = (BYTE*)dst + susp->progress->dstPos;
+        if (ilimit - ip >= susp->budget) ilimit = ip + susp->budget - 1;
+    }
 #if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
-    if (opt == NULL) goto _return_label;
+    if (fresh) {
+        wksp = (LZ4HC_optWksp_t*)ALLOC(sizeof(LZ4HC_optWksp_t));
+        if (wksp == NULL) return 0;
+        /* kept across invocations of a budgeted block, released on completion */
+        if (susp != NULL) susp->progress->optWksp = wksp;
+    }
+    opt = wksp->opt;
+    finder = &wksp->finder;
 #endif
+    if (fresh) {
+        finder->bt = NULL;
+        finder->nbSearches = finder->nbAttempts = 0;
+        /* binary tree workspace (~640 KB) requires heap mode,
+         * and would defeat the purpose of a state with reduced tables */
+        finder->allowTree = (LZ4HC_HEAPMODE==1) && (dict == noDictCtx) && (iend - ip >= LZ4HC_BT_MIN_SRCSIZE)
+                         && (ctx->hashLogReduction == 0) && (ctx->chainLogReduction == 0);
+    }
     DEBUGLOG(5, "LZ4HC_compress_optimal(dst=%p, dstCapa=%u)", dst, (unsigned)dstCapacity);
     *srcSizePtr = 0;
     if (limit == fillOutput) oend -= LASTLITERALS;   /* Hack for support LZ4 format restriction */
     if (sufficient_len >= LZ4_OPT_NUM) sufficient_len = LZ4_OPT_NUM-1;
+    OPT_STAT(srcSize, iend - ip);
 
     /* Main Loop */
-    while (ip <= mflimit) {
+    while (ip <= ilimit) {
          int const llen = (int)(ip - anchor);
          int best_mlen, best_off;
          int cur, last_match_pos = 0;
+         LZ4HC_match_t firstMatch;
 
-         LZ4HC_match_t const firstMatch = LZ4HC_FindLongerMatch(ctx, ip, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed);
+         if (ip >= work.checkpoint) nbSearches = LZ4HC_work_check(&work, ip, nbSearches);
+         firstMatch = LZ4HC_FindLongerMatch(ctx, finder, ip, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed, &work);
          if (firstMatch.len==0) { ip++; continue; }
 
          if ((size_t)firstMatch.len > sufficient_len) {
              /* good enough solution : immediate encoding */
              int const firstML = firstMatch.len;
+             OPT_STAT(nbDirectEncodes, 1);
              opSaved = op;
              if ( LZ4HC_encodeSequence(UPDATABLE(ip, op, anchor), firstML, firstMatch.off, limit, oend) ) {  /* updates ip, op and anchor */
                  ovml = firstML;
@@ -1799,6 +2615,7 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
              continue;
          }
 
+         OPT_STAT(nbParses, 1);
          /* set prices for first positions (literals) */
          {   int rPos;
              for (rPos = 0 ; rPos < MINMATCH ; rPos++) {
@@ -1856,15 +2673,17 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
 
              DEBUGLOG(7, "search at rPos:%u", cur);
              if (fullUpdate)
-                 newMatch = LZ4HC_FindLongerMatch(ctx, curPtr, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed);
+                 newMatch = LZ4HC_FindLongerMatch(ctx, finder, curPtr, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed, &work);
              else
                  /* only test matches of minimum length; slightly faster, but misses a few bytes */
-                 newMatch = LZ4HC_FindLongerMatch(ctx, curPtr, matchlimit, last_match_pos - cur, nbSearches, dict, favorDecSpeed);
+                 newMatch = LZ4HC_FindLongerMatch(ctx, finder, curPtr, matchlimit, last_match_pos - cur, nbSearches, dict, favorDecSpeed, &work);
              if (!newMatch.len) continue;
 
              if ( ((size_t)newMatch.len > sufficient_len)
                || (newMatch.len + cur >= LZ4_OPT_NUM) ) {
                  /* immediate encoding */
+                 if ((size_t)newMatch.len > sufficient_len) OPT_STAT(nbSufficientExits, 1);
+                 else OPT_STAT(nbWindowEnds, 1);
                  best_mlen = newMatch.len;
                  best_off = newMatch.off;
                  last_match_pos = cur + 1;
@@ -1939,6 +2758,7 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
 
 encode: /* cur, last_match_pos, best_mlen, best_off must be set */
          assert(cur < LZ4_OPT_NUM);
+         OPT_STAT(parsedLength, cur + best_mlen);
          assert(last_match_pos >= 1);  /* == 1 when only one candidate */
          DEBUGLOG(6, "reverse traversal, looking for shortest path (last_match_pos=%i)", last_match_pos);
          {   int candidate_pos = cur;
@@ -1972,7 +2792,18 @@ encode: /* cur, last_match_pos, best_mlen, best_off must be set */
                      ovoff = offset;
                      goto _dest_overflow;
          }   }   }
-     }  /* while (ip <= mflimit) */
+     }  /* while (ip <= ilimit) */
+
+     if (ip <= mflimit) {
+         /* budget exhausted : suspend, between two parsing windows */
+         assert(susp != NULL);
+         susp->progress->srcPos = (int)(ip - (const BYTE*)source);
+         susp->progress->anchorPos = (int)(anchor - (const BYTE*)source);
+         susp->progress->dstPos = (int)(op - (BYTE*)dst);
+         LZ4HC_work_suspend(&work, nbSearches, susp->progress, (const BYTE*)source);
+         retval = LZ4HC_SUSPENDED;
+         goto _return_label;
+     }
 
 _last_literals:
      /* Encode Last Literals */
@@ -2035,7 +2866,22 @@ if (limit == fillOutput) {
 }
 _return_label:
 #if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
-     if (opt) FREEMEM(opt);
+     if (retval == LZ4HC_SUSPENDED) return retval;   /* workspace and tree remain valid until next invocation */
+     if (finder->bt) LZ4HC_bt_updateHashChain(ctx, MIN(ip, mflimit));
+     if (susp != NULL) susp->progress->optWksp = NULL;
+     LZ4HC_optWksp_free(wksp);
 #endif
      return retval;
 }
+
+
+/* LZ4HC_resume_release() :
+ * defined after the optimal parser, which owns the workspace */
+void LZ4HC_resume_release(LZ4HC_resume_t* resume)
+{
+    if (resume == NULL) return;
+#if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
+    LZ4HC_optWksp_free((LZ4HC_optWksp_t*)resume->optWksp);
+#endif
+    MEM_INIT(resume, 0, sizeof(*resume));
+}
@@ -197,6 +197,9 @@ LZ4LIB_API int LZ4_saveDictHC (LZ4_streamHC_t* streamHCPtr, char* safeBuffer, in
 #define LZ4HC_HASHTABLESIZE (1 << LZ4HC_HASH_LOG)
 #define LZ4HC_HASH_MASK (LZ4HC_HASHTABLESIZE - 1)
 
+#define LZ4HC_HASHLOG_MIN  8   /* see LZ4_initStreamHC_advanced() */
+#define LZ4HC_CHAINLOG_MIN 8
+
 
 /* Never ever use these definitions directly !
  * Declare or allocate an LZ4_streamHC_t instead.
@@ -204,19 +207,23 @@ LZ4LIB_API int LZ4_saveDictHC (LZ4_streamHC_t* streamHCPtr, char* safeBuffer, in
 typedef struct LZ4HC_CCtx_internal LZ4HC_CCtx_internal;
 struct LZ4HC_CCtx_internal
 {
-    LZ4_u32   hashTable[LZ4HC_HASHTABLESIZE];
-    LZ4_u16   chainTable[LZ4HC_MAXD];
     const LZ4_byte* end;       /* next block here to continue on current prefix */
     const LZ4_byte* prefixStart;  /* Indexes relative to this position */
     const LZ4_byte* dictStart; /* alternate reference for extDict */
+    const LZ4HC_CCtx_internal* dictCtx;
     LZ4_u32   dictLimit;       /* below that point, need extDict */
     LZ4_u32   lowLimit;        /* below that point, no more dict */
     LZ4_u32   nextToUpdate;    /* index from which to continue dictionary update */
     short     compressionLevel;
     LZ4_i8    favorDecSpeed;   /* favor decompression speed if this flag set,
                                   otherwise, favor compression ratio */
-    LZ4_i8    dirty;           /* stream has to be fully reset if this flag is set */
-    const LZ4HC_CCtx_internal* dictCtx;
+    LZ4_i8    dirty;           /* history and settings are dropped on next reset if this flag is set */
+    LZ4_byte  hashLogReduction;  /* hashTable has (LZ4HC_HASHTABLESIZE >> hashLogReduction) entries */
+    LZ4_byte  chainLogReduction; /* chainTable has (LZ4HC_MAXD >> chainLogReduction) entries */
+    LZ4_byte  workLimit;       /* match candidates per input byte, 0 = default, see LZ4_setWorkLimitHC() */
+    /* tables must remain last : a reduced state ends after its last used entry */
+    LZ4_u32   hashTable[LZ4HC_HASHTABLESIZE];
+    LZ4_u16   chainTable[LZ4HC_MAXD];  /* effectively starts right after the last used hashTable entry */
 };
 
 #define LZ4_STREAMHC_MINSIZE  262200  /* static size, for inter-version compatibility */
@@ -241,6 +248,8 @@ union LZ4_streamHC_u {
 /* LZ4_initStreamHC() : v1.9.0+
  * Required before first use of a statically allocated LZ4_streamHC_t.
  * Before v1.9.0 : use LZ4_resetStreamHC() instead
+ * Since @buffer is provided by the caller, it can be placed on memory of its choosing,
+ * such as huge pages (mmap() + madvise(MADV_HUGEPAGE), or MAP_HUGETLB), to reduce TLB misses of the match finder.
  */
 LZ4LIB_API LZ4_streamHC_t* LZ4_initStreamHC(void* buffer, size_t size);
 
@@ -333,6 +342,21 @@ LZ4LIB_STATIC_API void LZ4_setCompressionLevel(
 LZ4LIB_STATIC_API void LZ4_favorDecompressionSpeed(
     LZ4_streamHC_t* LZ4_streamHCPtr, int favor);
 
+/*! LZ4_setWorkLimitHC() :
+ *  Bounds match finder effort, for services which compress untrusted data.
+ *  Some inputs (long runs with rare variations, near-duplicate records, tiny alphabets)
+ *  can make levels 9+ an order of magnitude slower than typical data.
+ *  Effort is measured in match candidates examined, evaluated every 4 KB of input :
+ *  once a block has examined @limit candidates per byte of its size, the rest of it uses a minimal search depth,
+ *  and a section far above @limit (32x) divides search depth by 4, for the rest of the block.
+ *  Decisions only depend on input, so output remains deterministic.
+ *  Typical data stays well below the default limit (16), and compresses exactly as without limit.
+ *  @limit : 0 restores the default, values >= 255 disable the limit, smaller values bound worst case speed further,
+ *  at the cost of compression ratio on inputs which trigger it.
+ *  Like LZ4_favorDecompressionSpeed(), this setting is reset by LZ4_loadDictHC() and after a failed compression.
+ */
+LZ4LIB_STATIC_API void LZ4_setWorkLimitHC(LZ4_streamHC_t* LZ4_streamHCPtr, int limit);
+
 /*! LZ4_resetStreamHC_fast() : v1.9.0+
  *  When an LZ4_streamHC_t is known to be in a internally coherent state,
  *  it can often be prepared for a new compression with almost no work, only
@@ -353,8 +377,11 @@ LZ4LIB_STATIC_API void LZ4_favorDecompressionSpeed(
  *
  *  Note:
  *  A stream that was last used in a compression call that returned an error
- *  may be passed to this function. However, it will be fully reset, which will
- *  clear any existing history and settings from the context.
+ *  may be passed to this function. However, it will clear any existing history
+ *  and settings from the context, as a full reset would.
+ *
+ *  Tables are not cleared : indexes of the new stream start beyond all previous ones,
+ *  so that stale entries are ignored. Tables are only cleared after ~1 GB of indexes.
  */
 LZ4LIB_STATIC_API void LZ4_resetStreamHC_fast(
     LZ4_streamHC_t* LZ4_streamHCPtr, int compressionLevel);
@@ -376,6 +403,92 @@ LZ4LIB_STATIC_API int LZ4_compress_HC_extStateHC_fastReset (
     int srcSize, int dstCapacity,
     int compressionLevel);
 
+/*! LZ4_compress_HC_batch() :
+ *  Compresses @nbInputs independent inputs, one after another, using the same @state,
+ *  with the same semantics as LZ4_compress_fast_batch().
+ *  Result is the same as invoking LZ4_compress_HC_extStateHC_fastReset() on each input,
+ *  but state validation and level clamping are only done once : each input then only starts new indexes.
+ *  @state must be correctly initialized (see LZ4_resetStreamHC_fast()),
+ *  for example by LZ4_initStreamHC() or LZ4_initStreamHC_advanced().
+ *  Reduced tables (LZ4_initStreamHC_advanced()) are a good fit for small inputs.
+ *  cSizes[n] receives the compressed size of input n, or 0 if it failed.
+ * @return : nb of inputs successfully compressed, or 0 if @state is not correctly aligned.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_HC_batch(void* state,
+                                      const char* const srcs[], const int srcSizes[],
+                                            char* const dsts[], const int dstCapacities[],
+                                            int cSizes[], int nbInputs, int compressionLevel);
+
+/*! LZ4HC_Executor :
+ *  Job scheduler provided by the caller (thread pool, task system, etc.),
+ *  with the same contract as LZ4F_Executor (see lz4frame.h) :
+ * `submitJob` must invoke job(jobArg) exactly once, from any thread.
+ *  It may also run the job synchronously, before returning.
+ * `completeJobs` must only return once all previously submitted jobs are completed.
+ */
+typedef void (*LZ4HC_JobFunction) (void* jobArg);
+typedef struct {
+    void (*submitJob) (void* opaqueState, LZ4HC_JobFunction job, void* jobArg);
+    void (*completeJobs) (void* opaqueState);
+    void* opaqueState;
+} LZ4HC_Executor;
+
+/*! LZ4_compress_HC_parallel() :
+ *  Same as LZ4_compress_HC_extStateHC(), producing a single block,
+ *  but input is cut into up to @nbStates segments of at least 256 KB,
+ *  which are compressed concurrently, as jobs submitted to @executor, each one using its own state.
+ *  Each segment is seeded with the previous 64 KB of input, as a prefix (see LZ4_loadDictHC()),
+ *  so that compression ratio remains very close to LZ4_compress_HC(),
+ *  only losing matches which would cross a segment boundary.
+ *  Result only depends on input, level and @nbStates, not on scheduling.
+ * @states : @nbStates states, each of size LZ4_sizeofStateHC(), aligned like LZ4_streamHC_t.
+ *           They are fully initialized, like LZ4_compress_HC_extStateHC() does.
+ * @executor is optional : when NULL, all jobs are run serially, in the calling thread.
+ *  When @dstCapacity < (LZ4_compressBound(srcSize) + 16 * @nbStates), a temporary buffer is allocated.
+ * @return : compressed size, or 0 if compression fails (dst too small, allocation failure, invalid parameters).
+ */
+LZ4LIB_STATIC_API int LZ4_compress_HC_parallel(void* states[], int nbStates,
+                                         const char* src, char* dst, int srcSize, int dstCapacity,
+                                               int compressionLevel, const LZ4HC_Executor* executor);
+
+/*! LZ4HC_resume_t :
+ *  Progress of a block compressed in several steps by LZ4_compress_HC_continue_budget().
+ *  Must be zero-initialized before first use. It's reset when a block completes.
+ *  At levels 10+, it also owns the parser workspace while a block is in progress :
+ *  a block abandoned before completion must be released with LZ4HC_resume_release(). */
+typedef struct {
+    int srcPos;      /* input parsed so far; 0 : no block in progress */
+    int anchorPos;   /* input not yet encoded starts here */
+    int dstPos;      /* output produced so far */
+    /* work limit progress (see LZ4_setWorkLimitHC()), carried across invocations */
+    int workWindowPos;
+    int workDepth;
+    unsigned workSpent;
+    unsigned long long workBlockSpent;
+    void* optWksp;   /* internal : optimal parser workspace, kept across invocations */
+} LZ4HC_resume_t;
+
+/*! LZ4_compress_HC_continue_budget() :
+ *  Same as LZ4_compress_HC_continue(), but can return before the block is complete,
+ *  after having parsed about @budget bytes of input, between two sequences.
+ *  It allows a single thread, such as an event loop, to interleave compression of a large block with other tasks.
+ *  To continue, invoke again with same arguments, until the block is complete.
+ *  Meanwhile, @src and @dst must remain valid and unmodified, and @LZ4_streamHCPtr must not be used for anything else.
+ *  Output is the same as LZ4_compress_HC_continue(), and the work limit applies to the whole block.
+ *  Levels below 3 are not interrupted : the whole block is compressed on first invocation.
+ * @return : compressed size when block is complete,
+ *           0 if compression failed (@dstCapacity too small),
+ *           or < 0 when block is not complete yet.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_HC_continue_budget(LZ4_streamHC_t* LZ4_streamHCPtr,
+                                                const char* src, char* dst, int srcSize, int dstCapacity,
+                                                      LZ4HC_resume_t* resume, int budget);
+
+/*! LZ4HC_resume_release() :
+ *  Abandons the block in progress within @resume, if any, releasing its workspace.
+ *  @resume is then ready for a new block. Not needed once a block is complete. */
+LZ4LIB_STATIC_API void LZ4HC_resume_release(LZ4HC_resume_t* resume);
+
 /*! LZ4_attach_HC_dictionary() :
  *  This is an experimental API that allows for the efficient use of a
  *  static dictionary many times.
@@ -405,6 +518,73 @@ LZ4LIB_STATIC_API void LZ4_attach_HC_dictionary(
           LZ4_streamHC_t *working_stream,
     const LZ4_streamHC_t *dictionary_stream);
 
+/*! LZ4_sizeofStreamHC_advanced() :
+ *  @return : size of an LZ4_streamHC_t state using reduced tables,
+ *            or 0 if parameters are invalid (see LZ4_initStreamHC_advanced()).
+ */
+LZ4LIB_STATIC_API int LZ4_sizeofStreamHC_advanced(int hashLog, int chainLog);
+
+/*! LZ4_initStreamHC_advanced() :
+ *  Initializes a streaming HC state within a @buffer smaller than sizeof(LZ4_streamHC_t),
+ *  using a hash table of (1 << @hashLog) entries and a chain table of (1 << @chainLog) entries.
+ *  This is useful for applications which keep many streams alive at once, typically compressing small messages.
+ *  @hashLog must be within [LZ4HC_HASHLOG_MIN, LZ4HC_HASH_LOG],
+ *  @chainLog must be within [LZ4HC_CHAINLOG_MIN, LZ4HC_DICTIONARY_LOGSIZE].
+ *  @chainLog also bounds the match distance (history window) to (1 << @chainLog) - 1 bytes.
+ *  @size must be >= LZ4_sizeofStreamHC_advanced(hashLog, chainLog), and @buffer must be aligned like LZ4_streamHC_t.
+ *  @return : the initialized state, or NULL on failure (invalid parameters, insufficient size, bad alignment).
+ *
+ *  The returned state works with all streaming functions, including
+ *  LZ4_resetStreamHC_fast(), LZ4_loadDictHC(), LZ4_attach_HC_dictionary() and LZ4_saveDictHC(),
+ *  and with LZ4_compress_HC_extStateHC_fastReset() for one-shot compression.
+ *  Table sizes are preserved by all of them.
+ *  Since it may be smaller than LZ4_streamHC_t, it must never be copied by value,
+ *  nor be passed to functions which fully re-initialize a standard state :
+ *  LZ4_initStreamHC(), LZ4_resetStreamHC(), LZ4_compress_HC_extStateHC() and LZ4_compress_HC_destSize().
+ *  Using full-size parameters (LZ4HC_HASH_LOG, LZ4HC_DICTIONARY_LOGSIZE) is equivalent to LZ4_initStreamHC().
+ */
+LZ4LIB_STATIC_API LZ4_streamHC_t* LZ4_initStreamHC_advanced(void* buffer, size_t size, int hashLog, int chainLog);
+
+/*! LZ4_cloneStreamHC() :
+ *  Forks @srcStream in its current state into @dstBuffer, including compression level and attached dictionary.
+ *  Cheaper than a full state copy : the chain table is only copied for the current history window,
+ *  and reduced tables (see LZ4_initStreamHC_advanced()) are copied at their own size.
+ *  Referenced data is shared, not copied : previous input and attached dictionary stream
+ *  must remain accessible and unmodified while either stream uses them.
+ *  @dstSize must be >= the size of @srcStream, and @dstBuffer must be aligned like LZ4_streamHC_t.
+ * @return : the cloned stream, or NULL on failure (insufficient @dstSize, bad alignment).
+ */
+LZ4LIB_STATIC_API LZ4_streamHC_t* LZ4_cloneStreamHC(void* dstBuffer, size_t dstSize, const LZ4_streamHC_t* srcStream);
+
+/*! LZ4HC_optStats_t :
+ *  Activity of the optimal parser, used by levels >= LZ4HC_CLEVEL_OPT_MIN.
+ *  A "parse" starts when the first match found at a position is not longer than the level's sufficient length,
+ *  and ends when its best path is encoded. Useful ratios :
+ *  nbSearches / srcSize (match finder calls per byte), nbCandidates / nbSearches (mean candidates examined),
+ *  nbSufficientExits and nbWindowEnds relative to nbParses (how often a parse was cut short).
+ */
+typedef struct {
+    unsigned long long srcSize;            /* bytes submitted to the optimal parser */
+    unsigned long long nbSearches;         /* match finder invocations */
+    unsigned long long nbCandidates;       /* match candidates examined by the match finder (including binary tree updates) */
+    unsigned long long nbParses;           /* optimal parses started */
+    unsigned long long parsedLength;       /* total length covered by optimal parses */
+    unsigned long long nbDirectEncodes;    /* first matches longer than sufficient length, encoded without parse */
+    unsigned long long nbSufficientExits;  /* parses ended early by a match longer than sufficient length */
+    unsigned long long nbWindowEnds;       /* parses ended early by a match reaching the end of the LZ4_OPT_NUM window */
+    unsigned long long nbTreeSwitches;     /* blocks which switched to the binary tree match finder */
+    unsigned long long nbWorkLimits;       /* search depth reductions by the work limit, all levels >= 3 */
+} LZ4HC_optStats_t;
+
+/*! LZ4_getOptimalParserStats() :
+ *  Copies counters accumulated since program start or last LZ4_resetOptimalParserStats() into @stats.
+ *  Counters are only collected when lz4hc.c is compiled with LZ4HC_OPT_STATS=1 (default: 0),
+ *  they are process-wide and not thread-safe : concurrent compressions make them approximate.
+ *  @return : 1 when counters are collected, 0 otherwise (in which case @stats is zeroed).
+ */
+LZ4LIB_STATIC_API int LZ4_getOptimalParserStats(LZ4HC_optStats_t* stats);
+LZ4LIB_STATIC_API void LZ4_resetOptimalParserStats(void);
+
 #if defined (__cplusplus)
 }
 #endif
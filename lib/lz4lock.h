@@ -0,0 +1,110 @@
+/*
+    LZ4 spin locks - private header
+    Copyright (C) 2011-2020, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+       - LZ4 source repository : https://github.com/lz4/lz4
+       - LZ4 public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+/* note : private header, shared by lz4frame.c and lz4page.c ; it is not installed */
+
+#ifndef LZ4LOCK_H_3471293
+#define LZ4LOCK_H_3471293
+
+/* Spin locks, for short critical sections (a list push or pop, a table build, a page copy).
+ * A waiting thread first pauses the cpu, then yields its core once in a while,
+ * in case the lock owner was preempted (more threads than cores).
+ * Lazily built objects are published with release semantics, and read with acquire semantics.
+ *
+ * LZ4_LOCK_ATOMICS == 0 means no atomic support is known for this compiler :
+ * locks then do nothing, and every user of these locks must document
+ * that concurrent accesses have to be serialized by the caller. */
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  define LZ4_LOCK_ATOMICS 1
+#  define LZ4_LOCK_TRY(l)                (_InterlockedExchange((l), 1) == 0)
+#  define LZ4_LOCK_RELEASE(l)            (void)_InterlockedExchange((l), 0)
+#  define LZ4_LOAD_ACQUIRE_PTR(pp)       _InterlockedCompareExchangePointer((void* volatile*)(pp), NULL, NULL)
+#  define LZ4_STORE_RELEASE_PTR(pp, v)   (void)_InterlockedExchangePointer((void* volatile*)(pp), (v))
+#  if defined(_M_IX86) || defined(_M_X64)
+#    define LZ4_CPU_PAUSE()  _mm_pause()
+#  endif
+#elif defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#  define LZ4_LOCK_ATOMICS 1
+#  define LZ4_LOCK_TRY(l)                (__atomic_exchange_n((l), 1, __ATOMIC_ACQUIRE) == 0)
+#  define LZ4_LOCK_RELEASE(l)            __atomic_store_n((l), 0, __ATOMIC_RELEASE)
+#  define LZ4_LOAD_ACQUIRE_PTR(pp)       __atomic_load_n((pp), __ATOMIC_ACQUIRE)
+#  define LZ4_STORE_RELEASE_PTR(pp, v)   __atomic_store_n((pp), (v), __ATOMIC_RELEASE)
+#  if defined(__i386__) || defined(__x86_64__)
+#    define LZ4_CPU_PAUSE()  __builtin_ia32_pause()
+#  endif
+#else
+#  define LZ4_LOCK_ATOMICS 0
+#  define LZ4_LOCK_TRY(l)                ((void)(l), 1)
+#  define LZ4_LOCK_RELEASE(l)            (void)(l)
+#  define LZ4_LOAD_ACQUIRE_PTR(pp)       (*(pp))
+#  define LZ4_STORE_RELEASE_PTR(pp, v)   (*(pp) = (v))
+#endif
+
+#ifndef LZ4_CPU_PAUSE
+#  define LZ4_CPU_PAUSE()  do {} while (0)
+#endif
+
+#if defined(_WIN32)
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#  define LZ4_LOCK_YIELD()  (void)SwitchToThread()
+#elif defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#  include <sched.h>
+#  define LZ4_LOCK_YIELD()  (void)sched_yield()
+#else
+#  define LZ4_LOCK_YIELD()  do {} while (0)
+#endif
+
+#define LZ4_LOCK_SPINS_MAX  1024   /* ~ a few page decompressions */
+
+static void LZ4_spinLock(long* lock)
+{
+    unsigned nbSpins = 0;
+    while (!LZ4_LOCK_TRY(lock)) {
+        LZ4_CPU_PAUSE();
+        if (++nbSpins == LZ4_LOCK_SPINS_MAX) { LZ4_LOCK_YIELD(); nbSpins = 0; }
+    }
+}
+
+static void LZ4_spinUnlock(long* lock)
+{
+    LZ4_LOCK_RELEASE(lock);
+}
+
+#endif /* LZ4LOCK_H_3471293 */
@@ -0,0 +1,459 @@
+/*
+    LZ4 compressed page store
+    Copyright (C) 2011-2020, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+       - LZ4 source repository : https://github.com/lz4/lz4
+       - LZ4 public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+/* note : lz4page is not an independent module, it requires lz4.h/lz4.c for proper compilation */
+
+
+/*===    Dependency    ===*/
+#include "lz4page.h"
+
+
+/*===   Shared lz4.c code   ===*/
+#ifndef LZ4_SRC_INCLUDED
+# if defined(__GNUC__)
+#  pragma GCC diagnostic ignored "-Wunused-function"
+# endif
+# if defined (__clang__)
+#  pragma clang diagnostic ignored "-Wunused-function"
+# endif
+# define LZ4_COMMONDEFS_ONLY
+# include "lz4.c"   /* mem, ALLOC, DEBUGLOG */
+#endif
+
+
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+
+/*===   Constants   ===*/
+#define LZ4PAGE_CLASS_STEPS  64   /* size classes are 1/64th of page size apart */
+#define LZ4PAGE_RAW_STEPS    56   /* pages which don't compress within 56/64 = 7/8 of page size are stored raw */
+#define LZ4PAGE_NB_CLASSES   (LZ4PAGE_RAW_STEPS + 1)   /* last class holds raw pages */
+#define LZ4PAGE_SLAB_PAGES    4   /* slabs are ~4 pages large */
+#define LZ4PAGE_NB_LOCKS    256   /* page n is protected by lock n % LZ4PAGE_NB_LOCKS */
+#define LZ4PAGE_CACHELINE    64
+#define LZ4PAGE_NONE         0xFFFFFFFFU
+
+
+/*===   Locks   ===*/
+/* Spin locks shared with lz4frame.c : critical sections are one page copy or decompression at most.
+ * Without atomic support, all operations must be serialized by the caller. */
+#include "lz4lock.h"
+
+typedef struct {
+    long lock;
+    BYTE pad[LZ4PAGE_CACHELINE - sizeof(long)];   /* neighbouring pages are protected by different lines */
+} LZ4PAGE_lock_t;
+
+
+/*===   Slabs   ===*/
+/* A slab is an array of same-size slots. Its slots are handed out in order first,
+ * then from its free list, free slots being linked through their first 4 bytes.
+ * Slabs with both used and free slots are linked into their class partial list,
+ * from which allocations are served, so that they fill up before new slabs get allocated.
+ * Each class keeps at most one empty slab as a spare, and releases memory of other ones.
+ * Descriptors of released slabs remain in the class array, ready to be reused. */
+typedef struct {
+    BYTE* mem;        /* NULL once released */
+    U32 nbUsed;
+    U32 nbInit;       /* slots >= nbInit have not been handed out since allocation */
+    U32 freeHead;     /* first free slot < nbInit, or LZ4PAGE_NONE */
+    U32 prev;         /* links within partial list, or released list */
+    U32 next;
+} LZ4PAGE_slab;
+
+typedef struct {
+    long lock;
+    U32 slotSize;
+    U32 nbSlots;          /* per slab */
+    LZ4PAGE_slab* slabs;  /* descriptors; can move while class is locked */
+    U32 nbSlabs;          /* descriptors in use */
+    U32 capacity;
+    U32 partialHead;      /* slabs with used and free slots */
+    U32 releasedHead;     /* slabs without memory */
+    U32 spare;            /* empty slab keeping its memory */
+    U32 nbAllocated;      /* slabs with memory */
+    size_t nbObjects;
+    size_t storedSize;
+} LZ4PAGE_class;
+
+static void LZ4PAGE_push(LZ4PAGE_class* cl, U32* headPtr, U32 sIdx)
+{
+    LZ4PAGE_slab* const s = cl->slabs + sIdx;
+    s->prev = LZ4PAGE_NONE;
+    s->next = *headPtr;
+    if (*headPtr != LZ4PAGE_NONE) cl->slabs[*headPtr].prev = sIdx;
+    *headPtr = sIdx;
+}
+
+static void LZ4PAGE_unlink(LZ4PAGE_class* cl, U32* headPtr, U32 sIdx)
+{
+    LZ4PAGE_slab* const s = cl->slabs + sIdx;
+    if (s->prev != LZ4PAGE_NONE) cl->slabs[s->prev].next = s->next;
+    else { assert(*headPtr == sIdx); *headPtr = s->next; }
+    if (s->next != LZ4PAGE_NONE) cl->slabs[s->next].prev = s->prev;
+}
+
+/* LZ4PAGE_newSlab() :
+ * Provides an empty slab with memory, and inserts it into the partial list.
+ * Class must be locked.
+ * @return : slab index, or LZ4PAGE_NONE on allocation failure */
+static U32 LZ4PAGE_newSlab(LZ4PAGE_class* cl)
+{
+    LZ4PAGE_slab* s;
+    U32 sIdx = cl->spare;
+    if (sIdx != LZ4PAGE_NONE) {
+        cl->spare = LZ4PAGE_NONE;
+        LZ4PAGE_push(cl, &cl->partialHead, sIdx);
+        return sIdx;
+    }
+
+    if (cl->releasedHead != LZ4PAGE_NONE) {
+        sIdx = cl->releasedHead;
+        LZ4PAGE_unlink(cl, &cl->releasedHead, sIdx);
+    } else {
+        if (cl->nbSlabs == cl->capacity) {
+            U32 const newCapacity = cl->capacity ? cl->capacity * 2 : 4;
+            LZ4PAGE_slab* const newSlabs = (LZ4PAGE_slab*)ALLOC((size_t)newCapacity * sizeof(LZ4PAGE_slab));
+            if (newSlabs == NULL || newCapacity < cl->capacity) { FREEMEM(newSlabs); return LZ4PAGE_NONE; }
+            if (cl->nbSlabs) LZ4_memcpy(newSlabs, cl->slabs, (size_t)cl->nbSlabs * sizeof(LZ4PAGE_slab));
+            FREEMEM(cl->slabs);
+            cl->slabs = newSlabs;
+            cl->capacity = newCapacity;
+        }
+        sIdx = cl->nbSlabs++;
+    }
+
+    s = cl->slabs + sIdx;
+    s->mem = (BYTE*)ALLOC((size_t)cl->nbSlots * cl->slotSize);
+    if (s->mem == NULL) {
+        LZ4PAGE_push(cl, &cl->releasedHead, sIdx);
+        return LZ4PAGE_NONE;
+    }
+    s->nbUsed = 0;
+    s->nbInit = 0;
+    s->freeHead = LZ4PAGE_NONE;
+    LZ4PAGE_push(cl, &cl->partialHead, sIdx);
+    cl->nbAllocated++;
+    return sIdx;
+}
+
+/* LZ4PAGE_allocSlot() :
+ * @return : a slot of class @cl, which will hold @size bytes, with its slab index written into *sIdxPtr,
+ *           or NULL on allocation failure */
+static BYTE* LZ4PAGE_allocSlot(LZ4PAGE_class* cl, U32 size, U32* sIdxPtr)
+{
+    LZ4PAGE_slab* s;
+    BYTE* slot;
+    U32 sIdx;
+
+    LZ4_spinLock(&cl->lock);
+    sIdx = cl->partialHead;
+    if (sIdx == LZ4PAGE_NONE) {
+        sIdx = LZ4PAGE_newSlab(cl);
+        if (sIdx == LZ4PAGE_NONE) { LZ4_spinUnlock(&cl->lock); return NULL; }
+    }
+    s = cl->slabs + sIdx;
+    if (s->freeHead != LZ4PAGE_NONE) {
+        slot = s->mem + (size_t)s->freeHead * cl->slotSize;
+        LZ4_memcpy(&s->freeHead, slot, sizeof(U32));
+    } else {
+        assert(s->nbInit < cl->nbSlots);
+        slot = s->mem + (size_t)s->nbInit * cl->slotSize;
+        s->nbInit++;
+    }
+    if (++s->nbUsed == cl->nbSlots)
+        LZ4PAGE_unlink(cl, &cl->partialHead, sIdx);
+    cl->nbObjects++;
+    cl->storedSize += size;
+    LZ4_spinUnlock(&cl->lock);
+
+    *sIdxPtr = sIdx;
+    return slot;
+}
+
+static void LZ4PAGE_freeSlot(LZ4PAGE_class* cl, U32 sIdx, BYTE* slot, U32 size)
+{
+    BYTE* released = NULL;
+    LZ4PAGE_slab* s;
+    U32 slotNb;
+
+    LZ4_spinLock(&cl->lock);
+    s = cl->slabs + sIdx;
+    assert(slot >= s->mem && slot < s->mem + (size_t)cl->nbSlots * cl->slotSize);
+    slotNb = (U32)((size_t)(slot - s->mem) / cl->slotSize);
+    if (s->nbUsed == cl->nbSlots)
+        LZ4PAGE_push(cl, &cl->partialHead, sIdx);
+    LZ4_memcpy(slot, &s->freeHead, sizeof(U32));
+    s->freeHead = slotNb;
+    cl->nbObjects--;
+    cl->storedSize -= size;
+    if (--s->nbUsed == 0) {
+        LZ4PAGE_unlink(cl, &cl->partialHead, sIdx);
+        if (cl->spare == LZ4PAGE_NONE) {
+            cl->spare = sIdx;
+        } else {
+            released = s->mem;
+            s->mem = NULL;
+            LZ4PAGE_push(cl, &cl->releasedHead, sIdx);
+            cl->nbAllocated--;
+    }   }
+    LZ4_spinUnlock(&cl->lock);
+    FREEMEM(released);
+}
+
+
+/*===   Page store   ===*/
+typedef struct {
+    BYTE* slot;      /* page content, NULL when page is empty */
+    U32 size;        /* == pageSize when stored raw */
+    U32 slab;        /* index of slot's slab, within its size class */
+} LZ4PAGE_entry;
+
+typedef struct {
+    long lock;
+    LZ4_stream_t* stream;   /* hash table sized for a single page, see LZ4_initStream_advanced() */
+    BYTE* buffer;           /* compressed page, before it's copied into its slot */
+    BYTE pad[LZ4PAGE_CACHELINE - sizeof(long) - 2 * sizeof(void*)];
+} LZ4PAGE_state;
+
+struct LZ4_pageStore_s {
+    size_t pageSize;
+    size_t nbPages;
+    int acceleration;
+    int targetSize;         /* largest compressed size not stored raw */
+    unsigned nbStates;
+    U32 stepSize;
+    size_t fixedSize;       /* memory used, besides slabs */
+    LZ4PAGE_entry* entries;
+    LZ4PAGE_state* states;
+    void* workspace;        /* states' streams and buffers */
+    LZ4PAGE_lock_t locks[LZ4PAGE_NB_LOCKS];
+    LZ4PAGE_class classes[LZ4PAGE_NB_CLASSES];
+};  /* typedef'd to LZ4_pageStore within lz4page.h */
+
+static unsigned LZ4PAGE_classOf(const LZ4_pageStore* store, U32 size)
+{
+    if (size == store->pageSize) return LZ4PAGE_NB_CLASSES - 1;
+    assert(size > 0 && size <= (U32)store->targetSize);
+    return (size - 1) / store->stepSize;
+}
+
+static long* LZ4PAGE_pageLock(LZ4_pageStore* store, size_t pageIndex)
+{
+    return &store->locks[pageIndex & (LZ4PAGE_NB_LOCKS - 1)].lock;
+}
+
+/* LZ4PAGE_acquireState() :
+ * Each thread is expected to find a free state within a few attempts,
+ * starting from one selected by @hint, since there are as many states as threads compressing at the same time. */
+static LZ4PAGE_state* LZ4PAGE_acquireState(LZ4_pageStore* store, size_t hint)
+{
+    unsigned const first = (unsigned)(hint % store->nbStates);
+    unsigned n;
+    for (n = 0; n < store->nbStates; n++) {
+        LZ4PAGE_state* const state = store->states + (first + n) % store->nbStates;
+        if (LZ4_LOCK_TRY(&state->lock)) return state;
+    }
+    LZ4_spinLock(&store->states[first].lock);
+    return store->states + first;
+}
+
+LZ4_pageStore* LZ4_createPageStore(size_t pageSize, size_t nbPages, unsigned nbStates, int acceleration)
+{
+    LZ4_pageStore* store;
+    int memoryUsage = LZ4_MEMORY_USAGE_MIN;
+    size_t streamSize;
+    unsigned n;
+
+    if (pageSize < LZ4PAGE_SIZE_MIN || pageSize > LZ4PAGE_SIZE_MAX || (pageSize & (pageSize - 1)))
+        return NULL;
+    if (nbPages == 0 || nbPages > ((size_t)-1) / sizeof(LZ4PAGE_entry))
+        return NULL;
+    if (nbStates < 1) nbStates = 1;
+    if (nbStates > LZ4PAGE_NB_STATES_MAX) nbStates = LZ4PAGE_NB_STATES_MAX;
+    while (((size_t)1 << memoryUsage) < 2 * pageSize && memoryUsage < LZ4_MEMORY_USAGE) memoryUsage++;   /* ratio within 0.2% of default table */
+    streamSize = ((size_t)LZ4_sizeofStream_advanced(memoryUsage) + LZ4PAGE_CACHELINE - 1) & ~(size_t)(LZ4PAGE_CACHELINE - 1);
+
+    store = (LZ4_pageStore*)ALLOC_AND_ZERO(sizeof(LZ4_pageStore));
+    if (store == NULL) return NULL;
+    store->pageSize = pageSize;
+    store->nbPages = nbPages;
+    store->acceleration = acceleration;
+    store->nbStates = nbStates;
+    store->stepSize = (U32)(pageSize / LZ4PAGE_CLASS_STEPS);
+    store->targetSize = (int)(store->stepSize * LZ4PAGE_RAW_STEPS);
+    for (n = 0; n < LZ4PAGE_NB_CLASSES; n++) {
+        LZ4PAGE_class* const cl = store->classes + n;
+        cl->slotSize = (n == LZ4PAGE_NB_CLASSES - 1) ? (U32)pageSize : (n + 1) * store->stepSize;
+        cl->nbSlots = (U32)(LZ4PAGE_SLAB_PAGES * pageSize / cl->slotSize);
+        cl->partialHead = LZ4PAGE_NONE;
+        cl->releasedHead = LZ4PAGE_NONE;
+        cl->spare = LZ4PAGE_NONE;
+    }
+
+    store->entries = (LZ4PAGE_entry*)ALLOC_AND_ZERO(nbPages * sizeof(LZ4PAGE_entry));
+    store->states = (LZ4PAGE_state*)ALLOC_AND_ZERO(nbStates * sizeof(LZ4PAGE_state));
+    store->workspace = ALLOC(nbStates * (streamSize + pageSize));
+    if (store->entries == NULL || store->states == NULL || store->workspace == NULL) {
+        LZ4_freePageStore(store);
+        return NULL;
+    }
+    for (n = 0; n < nbStates; n++) {
+        BYTE* const ws = (BYTE*)store->workspace;
+        store->states[n].stream = LZ4_initStream_advanced(ws + n * streamSize, streamSize, memoryUsage);
+        store->states[n].buffer = ws + nbStates * streamSize + n * pageSize;
+        assert(store->states[n].stream != NULL);
+    }
+    store->fixedSize = sizeof(LZ4_pageStore) + nbPages * sizeof(LZ4PAGE_entry)
+                     + nbStates * (sizeof(LZ4PAGE_state) + streamSize + pageSize);
+    return store;
+}
+
+void LZ4_freePageStore(LZ4_pageStore* store)
+{
+    unsigned c;
+    if (store == NULL) return;   /* support free on NULL */
+    for (c = 0; c < LZ4PAGE_NB_CLASSES; c++) {
+        LZ4PAGE_class* const cl = store->classes + c;
+        U32 s;
+        for (s = 0; s < cl->nbSlabs; s++) FREEMEM(cl->slabs[s].mem);
+        FREEMEM(cl->slabs);
+    }
+    FREEMEM(store->workspace);
+    FREEMEM(store->states);
+    FREEMEM(store->entries);
+    FREEMEM(store);
+}
+
+int LZ4_pageStore_put(LZ4_pageStore* store, size_t pageIndex, const void* src)
+{
+    LZ4PAGE_entry entry, previous;
+    LZ4PAGE_state* state;
+    LZ4PAGE_class* cl;
+    const BYTE* content = (const BYTE*)src;
+    int srcSize, cSize;
+    long* lock;
+
+    if (store == NULL || src == NULL || pageIndex >= store->nbPages) return 0;
+    srcSize = (int)store->pageSize;
+
+    /* compress, or store raw when page doesn't fit within targetSize */
+    state = LZ4PAGE_acquireState(store, pageIndex);
+    cSize = LZ4_compress_destSize_extState_fastReset(state->stream, (const char*)src, (char*)state->buffer,
+                                                     &srcSize, store->targetSize, store->acceleration);
+    if (cSize > 0 && (size_t)srcSize == store->pageSize) {
+        content = state->buffer;
+        entry.size = (U32)cSize;
+    } else {
+        LZ4_spinUnlock(&state->lock);
+        state = NULL;
+        entry.size = (U32)store->pageSize;
+    }
+    cl = store->classes + LZ4PAGE_classOf(store, entry.size);
+    entry.slot = LZ4PAGE_allocSlot(cl, entry.size, &entry.slab);
+    if (entry.slot != NULL) LZ4_memcpy(entry.slot, content, entry.size);
+    if (state != NULL) LZ4_spinUnlock(&state->lock);
+    if (entry.slot == NULL) return 0;
+
+    lock = LZ4PAGE_pageLock(store, pageIndex);
+    LZ4_spinLock(lock);
+    previous = store->entries[pageIndex];
+    store->entries[pageIndex] = entry;
+    LZ4_spinUnlock(lock);
+
+    if (previous.slot != NULL)
+        LZ4PAGE_freeSlot(store->classes + LZ4PAGE_classOf(store, previous.size), previous.slab, previous.slot, previous.size);
+    return (int)entry.size;
+}
+
+int LZ4_pageStore_get(LZ4_pageStore* store, size_t pageIndex, void* dst)
+{
+    int result;
+    long* lock;
+    const LZ4PAGE_entry* entry;
+
+    if (store == NULL || dst == NULL || pageIndex >= store->nbPages) return -1;
+    lock = LZ4PAGE_pageLock(store, pageIndex);
+    entry = store->entries + pageIndex;
+
+    /* slot can't be released while page is locked */
+    LZ4_spinLock(lock);
+    if (entry->slot == NULL) {
+        result = 0;
+    } else if (entry->size == store->pageSize) {
+        LZ4_memcpy(dst, entry->slot, store->pageSize);
+        result = (int)store->pageSize;
+    } else {
+        int const dSize = LZ4_decompress_safe((const char*)entry->slot, (char*)dst, (int)entry->size, (int)store->pageSize);
+        result = ((size_t)dSize == store->pageSize) ? dSize : -2;
+    }
+    LZ4_spinUnlock(lock);
+    return result;
+}
+
+int LZ4_pageStore_discard(LZ4_pageStore* store, size_t pageIndex)
+{
+    LZ4PAGE_entry previous;
+    long* lock;
+
+    if (store == NULL || pageIndex >= store->nbPages) return -1;
+    lock = LZ4PAGE_pageLock(store, pageIndex);
+    LZ4_spinLock(lock);
+    previous = store->entries[pageIndex];
+    store->entries[pageIndex].slot = NULL;
+    LZ4_spinUnlock(lock);
+
+    if (previous.slot == NULL) return 0;
+    LZ4PAGE_freeSlot(store->classes + LZ4PAGE_classOf(store, previous.size), previous.slab, previous.slot, previous.size);
+    return 1;
+}
+
+void LZ4_pageStore_getStats(LZ4_pageStore* store, LZ4_pageStoreStats* stats)
+{
+    unsigned c;
+    if (stats == NULL) return;
+    MEM_INIT(stats, 0, sizeof(*stats));
+    if (store == NULL) return;
+    stats->memoryUsed = store->fixedSize;
+    for (c = 0; c < LZ4PAGE_NB_CLASSES; c++) {
+        LZ4PAGE_class* const cl = store->classes + c;
+        LZ4_spinLock(&cl->lock);
+        stats->nbPages += cl->nbObjects;
+        stats->storedSize += cl->storedSize;
+        stats->memoryUsed += (size_t)cl->nbAllocated * cl->nbSlots * cl->slotSize
+                           + (size_t)cl->capacity * sizeof(LZ4PAGE_slab);
+        if (c == LZ4PAGE_NB_CLASSES - 1) stats->nbRawPages = cl->nbObjects;
+        LZ4_spinUnlock(&cl->lock);
+    }
+}
+
+#endif /* !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION) */
@@ -0,0 +1,125 @@
+/*
+ *  LZ4 compressed page store
+ *  Header File
+ *  Copyright (C) 2011-2020, Yann Collet.
+
+   BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are
+   met:
+
+       * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   You can contact the author at :
+    - LZ4 source repository : https://github.com/lz4/lz4
+    - LZ4 public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+#ifndef LZ4PAGE_H_30981733457612
+#define LZ4PAGE_H_30981733457612
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* --- Dependency --- */
+/* note : lz4page requires lz4.h/lz4.c for compilation */
+#include "lz4.h"   /* stddef, LZ4LIB_API */
+
+
+/* --- Useful constants --- */
+#define LZ4PAGE_SIZE_MIN     (1 * 1024)
+#define LZ4PAGE_SIZE_MAX    (64 * 1024)
+#define LZ4PAGE_NB_STATES_MAX      256
+
+
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+/*! Compressed page store :
+ *  Keeps a fixed number of fixed-size pages compressed in memory, like a zram device or a swap cache.
+ *  Page n is written with LZ4_pageStore_put() and read back with LZ4_pageStore_get(),
+ *  in any order, and any number of times.
+ *
+ *  Each page is compressed with LZ4_compress_destSize(), targeting 7/8 of page size :
+ *  pages which don't fit are stored raw, so reading them is a plain copy.
+ *  Compressed pages are stored into slabs of same-size slots, one slab list per size class,
+ *  size classes being 1/64th of page size apart. Slabs are released when they become empty,
+ *  except one spare per size class, so that memory follows the amount of data actually stored.
+ *  Metadata costs 16 bytes per page on 64-bit systems.
+ *
+ *  The store holds @nbStates compression states, with a hash table sized for a single page,
+ *  so that up to @nbStates threads can compress pages at the same time.
+ *  get, put and discard operations can be invoked concurrently from multiple threads
+ *  (when compiled with gcc, clang or MSVC; otherwise, caller must serialize them) :
+ *  pages are protected by striped locks, and each size class by its own lock.
+ *  Locks are held for a single page copy or decompression at most : waiting threads spin, then yield.
+ *  Concurrent operations on the same page are applied in some order, one at a time.
+ *
+ * @pageSize must be a power of 2, within [LZ4PAGE_SIZE_MIN, LZ4PAGE_SIZE_MAX].
+ * @nbStates is clamped within [1, LZ4PAGE_NB_STATES_MAX].
+ * @acceleration is the same as LZ4_compress_fast() one; values < 1 select the default.
+ * @return : a store of @nbPages empty pages, or NULL on invalid parameter or allocation failure.
+ */
+typedef struct LZ4_pageStore_s LZ4_pageStore;
+LZ4LIB_API LZ4_pageStore* LZ4_createPageStore(size_t pageSize, size_t nbPages, unsigned nbStates, int acceleration);
+LZ4LIB_API void           LZ4_freePageStore(LZ4_pageStore* store);
+
+/*! LZ4_pageStore_put() :
+ *  Stores a copy of @src, which is exactly pageSize bytes long, as page @pageIndex.
+ *  Previous content of this page, if any, is released.
+ * @return : nb of bytes used to store the page, == pageSize when stored raw,
+ *           or 0 on error (@pageIndex out of range, or allocation failure, in which case previous content is preserved).
+ */
+LZ4LIB_API int LZ4_pageStore_put(LZ4_pageStore* store, size_t pageIndex, const void* src);
+
+/*! LZ4_pageStore_get() :
+ *  Writes content of page @pageIndex into @dst, which must be at least pageSize bytes large.
+ * @return : pageSize,
+ *           or 0 if this page is empty (never stored, or discarded), in which case @dst is not modified,
+ *           or a negative value on error (@pageIndex out of range, or corrupted store).
+ */
+LZ4LIB_API int LZ4_pageStore_get(LZ4_pageStore* store, size_t pageIndex, void* dst);
+
+/*! LZ4_pageStore_discard() :
+ *  Releases content of page @pageIndex, which becomes empty.
+ * @return : 1 if page had content, 0 if it was already empty, or a negative value if @pageIndex is out of range.
+ */
+LZ4LIB_API int LZ4_pageStore_discard(LZ4_pageStore* store, size_t pageIndex);
+
+typedef struct {
+    size_t nbPages;       /* pages currently stored */
+    size_t nbRawPages;    /* among them, pages stored uncompressed */
+    size_t storedSize;    /* total size of stored pages, as returned by LZ4_pageStore_put() */
+    size_t memoryUsed;    /* total memory used by the store : slabs, metadata and compression states */
+} LZ4_pageStoreStats;
+
+/*! LZ4_pageStore_getStats() :
+ *  Fills @stats with current usage of @store.
+ *  When other threads modify the store at the same time, result is a consistent view of each size class,
+ *  but not necessarily of the whole store.
+ */
+LZ4LIB_API void LZ4_pageStore_getStats(LZ4_pageStore* store, LZ4_pageStoreStats* stats);
+#endif /* !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION) */
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* LZ4PAGE_H_30981733457612 */
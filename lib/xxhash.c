@@ -271,6 +271,12 @@ static U32 XXH32_round(U32 seed, U32 input)
     seed += input * PRIME32_2;
     seed  = XXH_rotl32(seed, 13);
     seed *= PRIME32_1;
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__aarch64__)) && !defined(XXH_ENABLE_AUTOVECTORIZE)
+    /* Compiler fence : prevents auto-vectorization of the 4 accumulators,
+     * notably within XXH32_update(), where they are adjacent in memory.
+     * Without a 32-bit vector multiply (pre-SSE4.1), it runs about 2x slower. */
+    __asm__("" : "+r" (seed));
+#endif
     return seed;
 }
 
@@ -416,6 +422,372 @@ XXH_PUBLIC_API unsigned int XXH32 (const void* input, size_t len, unsigned int s
 }
 
 
+/*======   Multi-lane hashing   ======*/
+
+/*!XXH_MULTI_SIMD :
+ * XXH32_multi() runs one input per vector lane :
+ * 8 lanes with AVX2, or 4 lanes with SSE4.1, selected at runtime (x86-64, gcc >= 6 or clang),
+ * 4 lanes with NEON (aarch64, little-endian).
+ * Set it to 0 to hash inputs one after another instead.
+ * Default : 1 (enabled where supported)
+ */
+#ifndef XXH_MULTI_SIMD
+#  define XXH_MULTI_SIMD 1
+#endif
+
+#if XXH_MULTI_SIMD && defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 6)))
+#  define XXH_MULTI_X86 1
+#  define XXH_MULTI_NEON 0
+#  include <immintrin.h>
+#elif XXH_MULTI_SIMD && defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#  define XXH_MULTI_X86 0
+#  define XXH_MULTI_NEON 1
+#  include <arm_neon.h>
+#else
+#  define XXH_MULTI_X86 0
+#  define XXH_MULTI_NEON 0
+#endif
+
+#if !XXH_MULTI_NEON
+static void XXH32_multi_scalar(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                               U32 seed, XXH32_hash_t results[])
+{
+    size_t n;
+    for (n=0; n<nbInputs; n++) results[n] = XXH32(inputs[n], lengths[n], seed);
+}
+#endif
+
+#if XXH_MULTI_X86 || XXH_MULTI_NEON
+
+#define XXH_MULTI_LANES_MAX 8
+
+/* XXH32_stripes_f :
+ * Runs @nbStripes stripes of 16 bytes on each lane, in lockstep.
+ * Lane n reads from ptr[n], which progresses by step[n] bytes per stripe (0 for an idle lane).
+ * acc[k][n] is accumulator k of lane n. */
+typedef void (*XXH32_stripes_f)(U32 acc[4][XXH_MULTI_LANES_MAX],
+                                const BYTE* ptr[XXH_MULTI_LANES_MAX],
+                                const size_t step[XXH_MULTI_LANES_MAX],
+                                size_t nbStripes);
+
+/* XXH32_completeLane() :
+ * Finishes the hash of @input (>= 16 bytes), from accumulators which have processed it up to @p.
+ * Only used on little-endian targets. */
+static U32 XXH32_completeLane(const void* input, size_t len, const BYTE* p,
+                              U32 v1, U32 v2, U32 v3, U32 v4)
+{
+    const BYTE* const limit = (const BYTE*)input + (len & ~(size_t)15);
+    U32 h32;
+
+    while (p < limit) {
+        v1 = XXH32_round(v1, XXH_readLE32(p, XXH_littleEndian)); p+=4;
+        v2 = XXH32_round(v2, XXH_readLE32(p, XXH_littleEndian)); p+=4;
+        v3 = XXH32_round(v3, XXH_readLE32(p, XXH_littleEndian)); p+=4;
+        v4 = XXH32_round(v4, XXH_readLE32(p, XXH_littleEndian)); p+=4;
+    }
+    h32 = XXH_rotl32(v1, 1)  + XXH_rotl32(v2, 7)
+        + XXH_rotl32(v3, 12) + XXH_rotl32(v4, 18);
+    h32 += (U32)len;
+    return XXH32_finalize(h32, p, len&15, XXH_littleEndian, XXH_unaligned);
+}
+
+/* XXH32_multi_lanes() :
+ * Each lane hashes one input at a time. Lanes run in lockstep until the shortest input is complete,
+ * then the freed lane is given the next input, so that lanes stay busy despite different lengths.
+ * Inputs shorter than a stripe, and the last input still running, are completed by scalar code. */
+static void XXH32_multi_lanes(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                              U32 seed, XXH32_hash_t results[],
+                              XXH32_stripes_f runStripes, unsigned nbLanes)
+{
+    static const BYTE idleInput[16] = { 0 };
+    U32 acc[4][XXH_MULTI_LANES_MAX];
+    const BYTE* ptr[XXH_MULTI_LANES_MAX];
+    size_t step[XXH_MULTI_LANES_MAX];
+    size_t left[XXH_MULTI_LANES_MAX];   /* stripes left to run, for active lanes */
+    size_t id[XXH_MULTI_LANES_MAX];
+    size_t next = 0;
+    unsigned nbActive = 0;
+    unsigned n;
+
+    assert(nbLanes <= XXH_MULTI_LANES_MAX);
+    memset(acc, 0, sizeof(acc));
+    for (n=0; n<XXH_MULTI_LANES_MAX; n++) {
+        ptr[n] = idleInput; step[n] = 0; left[n] = 0; id[n] = 0;
+    }
+
+    for (;;) {
+        size_t nbStripes = (size_t)-1;
+
+        /* give next inputs to idle lanes */
+        for (n=0; n<nbLanes; n++) {
+            while (step[n] == 0 && next < nbInputs) {
+                size_t const i = next++;
+                if (lengths[i] < 16) {
+                    results[i] = XXH32(inputs[i], lengths[i], seed);
+                    continue;
+                }
+                ptr[n] = (const BYTE*)inputs[i];
+                step[n] = 16;
+                left[n] = lengths[i] / 16;
+                id[n] = i;
+                acc[0][n] = seed + PRIME32_1 + PRIME32_2;
+                acc[1][n] = seed + PRIME32_2;
+                acc[2][n] = seed + 0;
+                acc[3][n] = seed - PRIME32_1;
+                nbActive++;
+            }
+            if (step[n] && left[n] < nbStripes) nbStripes = left[n];
+        }
+        if (nbActive < 2) break;   /* all inputs given : no more parallelism */
+
+        runStripes(acc, ptr, step, nbStripes);
+
+        for (n=0; n<nbLanes; n++) {
+            if (step[n] == 0) continue;
+            left[n] -= nbStripes;
+            if (left[n] == 0) {
+                size_t const i = id[n];
+                results[i] = XXH32_completeLane(inputs[i], lengths[i], ptr[n],
+                                                acc[0][n], acc[1][n], acc[2][n], acc[3][n]);
+                ptr[n] = idleInput;
+                step[n] = 0;
+                nbActive--;
+    }   }   }
+
+    for (n=0; n<nbLanes; n++) {
+        if (step[n]) {
+            size_t const i = id[n];
+            results[i] = XXH32_completeLane(inputs[i], lengths[i], ptr[n],
+                                            acc[0][n], acc[1][n], acc[2][n], acc[3][n]);
+    }   }
+}
+
+#endif  /* XXH_MULTI_X86 || XXH_MULTI_NEON */
+
+#if XXH_MULTI_X86
+
+/* 4 rows of 4 words => 4 columns of 4 words, row n being lane n */
+#define XXH_TRANSPOSE_4x4(set, unpacklo32, unpackhi32, unpacklo64, unpackhi64, r0, r1, r2, r3) { \
+    set const t0 = unpacklo32(r0, r1);   /* a0 b0 a1 b1 */  \
+    set const t1 = unpacklo32(r2, r3);   /* c0 d0 c1 d1 */  \
+    set const t2 = unpackhi32(r0, r1);   /* a2 b2 a3 b3 */  \
+    set const t3 = unpackhi32(r2, r3);   /* c2 d2 c3 d3 */  \
+    r0 = unpacklo64(t0, t1);                                \
+    r1 = unpackhi64(t0, t1);                                \
+    r2 = unpacklo64(t2, t3);                                \
+    r3 = unpackhi64(t2, t3);                                \
+}
+
+#define XXH32_ROUND_SSE(v, in)                                  \
+    v = _mm_add_epi32(v, _mm_mullo_epi32(in, prime2));          \
+    v = _mm_or_si128(_mm_slli_epi32(v, 13), _mm_srli_epi32(v, 32-13)); \
+    v = _mm_mullo_epi32(v, prime1)
+
+#define XXH32_ROUND_AVX2(v, in)                                 \
+    v = _mm256_add_epi32(v, _mm256_mullo_epi32(in, prime2));    \
+    v = _mm256_or_si256(_mm256_slli_epi32(v, 13), _mm256_srli_epi32(v, 32-13)); \
+    v = _mm256_mullo_epi32(v, prime1)
+
+#define XXH_LOADU_128(p) _mm_loadu_si128((const __m128i*)(const void*)(p))
+
+__attribute__((target("sse4.1")))
+static void XXH32_stripes_sse41(U32 acc[4][XXH_MULTI_LANES_MAX],
+                                const BYTE* ptr[XXH_MULTI_LANES_MAX],
+                                const size_t step[XXH_MULTI_LANES_MAX],
+                                size_t nbStripes)
+{
+    __m128i const prime1 = _mm_set1_epi32((int)PRIME32_1);
+    __m128i const prime2 = _mm_set1_epi32((int)PRIME32_2);
+    __m128i v0 = XXH_LOADU_128(acc[0]);
+    __m128i v1 = XXH_LOADU_128(acc[1]);
+    __m128i v2 = XXH_LOADU_128(acc[2]);
+    __m128i v3 = XXH_LOADU_128(acc[3]);
+    const BYTE* p0 = ptr[0]; const BYTE* p1 = ptr[1]; const BYTE* p2 = ptr[2]; const BYTE* p3 = ptr[3];
+    size_t const s0 = step[0], s1 = step[1], s2 = step[2], s3 = step[3];
+
+    while (nbStripes--) {
+        __m128i in0 = XXH_LOADU_128(p0);
+        __m128i in1 = XXH_LOADU_128(p1);
+        __m128i in2 = XXH_LOADU_128(p2);
+        __m128i in3 = XXH_LOADU_128(p3);
+        XXH_TRANSPOSE_4x4(__m128i, _mm_unpacklo_epi32, _mm_unpackhi_epi32, _mm_unpacklo_epi64, _mm_unpackhi_epi64,
+                          in0, in1, in2, in3);
+        XXH32_ROUND_SSE(v0, in0);
+        XXH32_ROUND_SSE(v1, in1);
+        XXH32_ROUND_SSE(v2, in2);
+        XXH32_ROUND_SSE(v3, in3);
+        p0 += s0; p1 += s1; p2 += s2; p3 += s3;
+    }
+    _mm_storeu_si128((__m128i*)(void*)acc[0], v0);
+    _mm_storeu_si128((__m128i*)(void*)acc[1], v1);
+    _mm_storeu_si128((__m128i*)(void*)acc[2], v2);
+    _mm_storeu_si128((__m128i*)(void*)acc[3], v3);
+    ptr[0] = p0; ptr[1] = p1; ptr[2] = p2; ptr[3] = p3;
+}
+
+/* lane n in low 128-bit half, lane n+4 in high half : each half is transposed like SSE */
+#define XXH_LOADU2_128(lo, hi) _mm256_inserti128_si256(_mm256_castsi128_si256(XXH_LOADU_128(lo)), XXH_LOADU_128(hi), 1)
+
+__attribute__((target("avx2")))
+static void XXH32_stripes_avx2(U32 acc[4][XXH_MULTI_LANES_MAX],
+                               const BYTE* ptr[XXH_MULTI_LANES_MAX],
+                               const size_t step[XXH_MULTI_LANES_MAX],
+                               size_t nbStripes)
+{
+    __m256i const prime1 = _mm256_set1_epi32((int)PRIME32_1);
+    __m256i const prime2 = _mm256_set1_epi32((int)PRIME32_2);
+    __m256i v0 = _mm256_loadu_si256((const __m256i*)(const void*)acc[0]);
+    __m256i v1 = _mm256_loadu_si256((const __m256i*)(const void*)acc[1]);
+    __m256i v2 = _mm256_loadu_si256((const __m256i*)(const void*)acc[2]);
+    __m256i v3 = _mm256_loadu_si256((const __m256i*)(const void*)acc[3]);
+    const BYTE* p0 = ptr[0]; const BYTE* p1 = ptr[1]; const BYTE* p2 = ptr[2]; const BYTE* p3 = ptr[3];
+    const BYTE* p4 = ptr[4]; const BYTE* p5 = ptr[5]; const BYTE* p6 = ptr[6]; const BYTE* p7 = ptr[7];
+    size_t const s0 = step[0], s1 = step[1], s2 = step[2], s3 = step[3];
+    size_t const s4 = step[4], s5 = step[5], s6 = step[6], s7 = step[7];
+
+    while (nbStripes--) {
+        __m256i in0 = XXH_LOADU2_128(p0, p4);
+        __m256i in1 = XXH_LOADU2_128(p1, p5);
+        __m256i in2 = XXH_LOADU2_128(p2, p6);
+        __m256i in3 = XXH_LOADU2_128(p3, p7);
+        XXH_TRANSPOSE_4x4(__m256i, _mm256_unpacklo_epi32, _mm256_unpackhi_epi32, _mm256_unpacklo_epi64, _mm256_unpackhi_epi64,
+                          in0, in1, in2, in3);
+        XXH32_ROUND_AVX2(v0, in0);
+        XXH32_ROUND_AVX2(v1, in1);
+        XXH32_ROUND_AVX2(v2, in2);
+        XXH32_ROUND_AVX2(v3, in3);
+        p0 += s0; p1 += s1; p2 += s2; p3 += s3;
+        p4 += s4; p5 += s5; p6 += s6; p7 += s7;
+    }
+    _mm256_storeu_si256((__m256i*)(void*)acc[0], v0);
+    _mm256_storeu_si256((__m256i*)(void*)acc[1], v1);
+    _mm256_storeu_si256((__m256i*)(void*)acc[2], v2);
+    _mm256_storeu_si256((__m256i*)(void*)acc[3], v3);
+    ptr[0] = p0; ptr[1] = p1; ptr[2] = p2; ptr[3] = p3;
+    ptr[4] = p4; ptr[5] = p5; ptr[6] = p6; ptr[7] = p7;
+}
+
+static void XXH32_multi_sse41(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                              U32 seed, XXH32_hash_t results[])
+{
+    XXH32_multi_lanes(inputs, lengths, nbInputs, seed, results, XXH32_stripes_sse41, 4);
+}
+
+static void XXH32_multi_avx2(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                             U32 seed, XXH32_hash_t results[])
+{
+    XXH32_multi_lanes(inputs, lengths, nbInputs, seed, results, XXH32_stripes_avx2, 8);
+}
+
+typedef void (*XXH32_multi_f)(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                              U32 seed, XXH32_hash_t results[]);
+
+static void XXH32_multi_init(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                             U32 seed, XXH32_hash_t results[]);
+
+/* Selected on first use, or by XXH32_multi_selectKernel().
+ * Concurrent first calls may all select, and store the same value.
+ * Pointed code never changes, so relaxed atomic accesses are enough. */
+static XXH32_multi_f XXH32_multi_impl = XXH32_multi_init;
+#define XXH32_MULTI_LOAD_IMPL()   __atomic_load_n(&XXH32_multi_impl, __ATOMIC_RELAXED)
+#define XXH32_MULTI_STORE_IMPL(f) __atomic_store_n(&XXH32_multi_impl, (f), __ATOMIC_RELAXED)
+
+static XXH32_multi_f XXH32_multi_detect(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return XXH32_multi_avx2;
+    if (__builtin_cpu_supports("sse4.1")) return XXH32_multi_sse41;
+    return XXH32_multi_scalar;
+}
+
+static void XXH32_multi_init(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                             U32 seed, XXH32_hash_t results[])
+{
+    XXH32_multi_f const f = XXH32_multi_detect();
+    XXH32_MULTI_STORE_IMPL(f);
+    f(inputs, lengths, nbInputs, seed, results);
+}
+
+#endif  /* XXH_MULTI_X86 */
+
+#if XXH_MULTI_NEON
+
+static void XXH32_stripes_neon(U32 acc[4][XXH_MULTI_LANES_MAX],
+                               const BYTE* ptr[XXH_MULTI_LANES_MAX],
+                               const size_t step[XXH_MULTI_LANES_MAX],
+                               size_t nbStripes)
+{
+    uint32x4_t const prime1 = vdupq_n_u32(PRIME32_1);
+    uint32x4_t const prime2 = vdupq_n_u32(PRIME32_2);
+    uint32x4_t v[4];
+    const BYTE* p0 = ptr[0]; const BYTE* p1 = ptr[1]; const BYTE* p2 = ptr[2]; const BYTE* p3 = ptr[3];
+    size_t const s0 = step[0], s1 = step[1], s2 = step[2], s3 = step[3];
+    int k;
+
+    for (k=0; k<4; k++) v[k] = vld1q_u32(acc[k]);
+    while (nbStripes--) {
+        uint32x4_t const r0 = vreinterpretq_u32_u8(vld1q_u8(p0));
+        uint32x4_t const r1 = vreinterpretq_u32_u8(vld1q_u8(p1));
+        uint32x4_t const r2 = vreinterpretq_u32_u8(vld1q_u8(p2));
+        uint32x4_t const r3 = vreinterpretq_u32_u8(vld1q_u8(p3));
+        uint32x4x2_t const t01 = vtrnq_u32(r0, r1);   /* a0 b0 a2 b2 , a1 b1 a3 b3 */
+        uint32x4x2_t const t23 = vtrnq_u32(r2, r3);   /* c0 d0 c2 d2 , c1 d1 c3 d3 */
+        uint32x4_t in[4];
+        in[0] = vcombine_u32(vget_low_u32(t01.val[0]),  vget_low_u32(t23.val[0]));
+        in[1] = vcombine_u32(vget_low_u32(t01.val[1]),  vget_low_u32(t23.val[1]));
+        in[2] = vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0]));
+        in[3] = vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1]));
+        for (k=0; k<4; k++) {
+            v[k] = vmlaq_u32(v[k], in[k], prime2);
+            v[k] = vsriq_n_u32(vshlq_n_u32(v[k], 13), v[k], 32-13);
+            v[k] = vmulq_u32(v[k], prime1);
+        }
+        p0 += s0; p1 += s1; p2 += s2; p3 += s3;
+    }
+    for (k=0; k<4; k++) vst1q_u32(acc[k], v[k]);
+    ptr[0] = p0; ptr[1] = p1; ptr[2] = p2; ptr[3] = p3;
+}
+
+#endif  /* XXH_MULTI_NEON */
+
+XXH_PUBLIC_API void XXH32_multi(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                                unsigned int seed, XXH32_hash_t results[])
+{
+#if XXH_MULTI_X86
+    XXH32_MULTI_LOAD_IMPL()(inputs, lengths, nbInputs, seed, results);
+#elif XXH_MULTI_NEON
+    XXH32_multi_lanes(inputs, lengths, nbInputs, seed, results, XXH32_stripes_neon, 4);
+#else
+    XXH32_multi_scalar(inputs, lengths, nbInputs, seed, results);
+#endif
+}
+
+XXH_PUBLIC_API int XXH32_multi_selectKernel(XXH32_multiKernel_e kernel)
+{
+#if XXH_MULTI_X86
+    XXH32_multi_f f;
+    switch (kernel) {
+    case XXH32_multiKernel_auto:   f = XXH32_multi_init; break;
+    case XXH32_multiKernel_scalar: f = XXH32_multi_scalar; break;
+    case XXH32_multiKernel_sse41:
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("sse4.1")) return 0;
+        f = XXH32_multi_sse41; break;
+    case XXH32_multiKernel_avx2:
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("avx2")) return 0;
+        f = XXH32_multi_avx2; break;
+    default: return 0;
+    }
+    XXH32_MULTI_STORE_IMPL(f);
+    return 1;
+#elif XXH_MULTI_NEON
+    return (kernel == XXH32_multiKernel_auto);
+#else
+    return (kernel == XXH32_multiKernel_auto) || (kernel == XXH32_multiKernel_scalar);
+#endif
+}
+
 
 /*======   Hash streaming   ======*/
 
@@ -134,6 +134,8 @@ typedef enum { XXH_OK=0, XXH_ERROR } XXH_errorcode;
 #  define XXH32_copyState XXH_NAME2(XXH_NAMESPACE, XXH32_copyState)
 #  define XXH32_canonicalFromHash XXH_NAME2(XXH_NAMESPACE, XXH32_canonicalFromHash)
 #  define XXH32_hashFromCanonical XXH_NAME2(XXH_NAMESPACE, XXH32_hashFromCanonical)
+#  define XXH32_multi XXH_NAME2(XXH_NAMESPACE, XXH32_multi)
+#  define XXH32_multi_selectKernel XXH_NAME2(XXH_NAMESPACE, XXH32_multi_selectKernel)
 #  define XXH64 XXH_NAME2(XXH_NAMESPACE, XXH64)
 #  define XXH64_createState XXH_NAME2(XXH_NAMESPACE, XXH64_createState)
 #  define XXH64_freeState XXH_NAME2(XXH_NAMESPACE, XXH64_freeState)
@@ -314,6 +316,29 @@ struct XXH64_state_s {
 # endif
 
 
+/*! XXH32_multi() :
+ *  Calculates the 32-bit hash of @nbInputs independent inputs, @inputs[n] being @lengths[n] bytes long,
+ *  and writes it into @results[n]. Each result is identical to XXH32(@inputs[n], @lengths[n], @seed).
+ *  Inputs are hashed in parallel, one per vector lane (8 with AVX2, 4 with SSE4.1 or NEON),
+ *  which is faster than successive XXH32() calls when inputs are several KB or more.
+ *  Inputs can have different lengths. */
+XXH_PUBLIC_API void XXH32_multi(const void* const inputs[], const size_t lengths[], size_t nbInputs,
+                                unsigned int seed, XXH32_hash_t results[]);
+
+/*! XXH32_multi_selectKernel() :
+ *  Test hook : forces the kernel used by following XXH32_multi() calls, in the whole process.
+ *  XXH32_multiKernel_auto restores runtime detection (the default).
+ *  Kernels are only available on matching builds and cpus (SSE4.1 and AVX2 : x86-64 with gcc >= 6 or clang).
+ * @return : 1 if @kernel is now in use, 0 if it's not available (selection unchanged). */
+typedef enum {
+    XXH32_multiKernel_auto = 0,
+    XXH32_multiKernel_scalar,
+    XXH32_multiKernel_sse41,
+    XXH32_multiKernel_avx2
+} XXH32_multiKernel_e;
+XXH_PUBLIC_API int XXH32_multi_selectKernel(XXH32_multiKernel_e kernel);
+
+
 #if defined(XXH_INLINE_ALL) || defined(XXH_PRIVATE_API)
 #  include "xxhash.c"   /* include xxhash function bodies as `static`, for inlining */
 #endif
@@ -31,28 +31,49 @@
 #  pragma warning(disable : 4127)    /* disable: C4127: conditional expression is constant */
 #endif
 
+/* per-thread hardware counters (--bench-shared-dict) require Linux perf_event_open() */
+#ifndef BMK_PERF
+#  if defined(__linux__)
+#    define BMK_PERF 1
+#  else
+#    define BMK_PERF 0
+#  endif
+#endif
+#if BMK_PERF && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* syscall() */
+#endif
+
 
 /* *************************************
 *  Includes
 ***************************************/
 #include "platform.h"    /* Compiler options */
+#include "lz4conf.h"     /* LZ4IO_MULTITHREAD */
 #include "util.h"        /* UTIL_GetFileSize, UTIL_sleep */
 #include <stdlib.h>      /* malloc, free */
 #include <string.h>      /* memset */
 #include <stdio.h>       /* fprintf, fopen, ftello */
 #include <time.h>        /* clock_t, clock, CLOCKS_PER_SEC */
 #include <assert.h>      /* assert */
+#if BMK_PERF
+#  include <linux/perf_event.h>  /* perf_event_attr */
+#  include <sys/ioctl.h>   /* ioctl */
+#  include <sys/syscall.h> /* SYS_perf_event_open */
+#  include <unistd.h>      /* syscall, read, close */
+#endif
 
 #include "lorem.h"       /* LOREM_genBuffer */
 #include "xxhash.h"
 #include "bench.h"
 #include "timefn.h"
+#include "threadpool.h"
 
 #define LZ4_STATIC_LINKING_ONLY
 #include "lz4.h"
 #define LZ4_HC_STATIC_LINKING_ONLY
 #include "lz4hc.h"
-#include "lz4frame.h"   /* LZ4F_decompress */
+#define LZ4F_STATIC_LINKING_ONLY
+#include "lz4frame.h"   /* LZ4F_decompress, LZ4F_CDict */
 
 
 /* *************************************
@@ -77,6 +98,9 @@
 
 #define LZ4_MAX_DICT_SIZE (64 KB)
 
+#define MIN(a,b) ((a)<(b) ? (a) : (b))
+#define MAX(a,b) ((a)>(b) ? (a) : (b))
+
 static const size_t maxMemory = (sizeof(size_t)==4)  ?  (2 GB - 64 MB) : (size_t)(1ULL << ((sizeof(size_t)*8)-31));
 
 
@@ -124,6 +148,15 @@ int g_additionalParam = 0;
 int g_benchSeparately = 0;
 int g_decodeOnly = 0;
 unsigned g_skipChecksums = 0;
+unsigned g_nbThreads = 1;
+int g_replicate = 0;
+int g_frameMode = 0;
+int g_blockLinked = 0;
+int g_blockChecksum = 0;
+int g_contentSize = 0;
+size_t g_latencyMsgSize = 0;
+size_t g_sharedDictMsgSize = 0;
+BMK_outputFormat_e g_outputFormat = BMK_format_text;
 
 void BMK_setNotificationLevel(unsigned level) { g_displayLevel=level; }
 
@@ -143,6 +176,124 @@ void BMK_setDecodeOnlyMode(int set) { g_decodeOnly = (set!=0); }
 
 void BMK_skipChecksums(int skip) { g_skipChecksums = (skip!=0); }
 
+void BMK_setNbThreads(unsigned nbThreads) { g_nbThreads = nbThreads ? nbThreads : 1; }
+
+void BMK_setReplicate(int replicate) { g_replicate = (replicate!=0); }
+
+void BMK_setFrameMode(int set) { g_frameMode = (set!=0); }
+
+void BMK_setBlockLinked(int linked) { g_blockLinked = (linked!=0); }
+
+void BMK_setBlockChecksum(int enable) { g_blockChecksum = (enable!=0); }
+
+void BMK_setContentSize(int enable) { g_contentSize = (enable!=0); }
+
+void BMK_setLatencyMode(size_t msgSize) { g_latencyMsgSize = msgSize; }
+
+void BMK_setSharedDictMode(size_t msgSize) { g_sharedDictMsgSize = msgSize; }
+
+void BMK_setOutputFormat(BMK_outputFormat_e format) { g_outputFormat = format; }
+
+
+/* *************************************
+*  Structured output (json, csv)
+***************************************/
+#ifdef LZ4_FAST_DEC_LOOP
+#  define BMK_FAST_DEC_LOOP_STRING LZ4_EXPAND_AND_QUOTE(LZ4_FAST_DEC_LOOP)
+#else
+#  define BMK_FAST_DEC_LOOP_STRING "default"
+#endif
+#if defined(__clang__)
+#  define BMK_COMPILER_STRING __VERSION__
+#elif defined(__GNUC__)
+#  define BMK_COMPILER_STRING "gcc " __VERSION__
+#elif defined(_MSC_VER)
+#  define BMK_COMPILER_STRING "msvc " LZ4_EXPAND_AND_QUOTE(_MSC_FULL_VER)
+#else
+#  define BMK_COMPILER_STRING "unknown"
+#endif
+
+typedef struct {
+    const char* file;
+    int cLevel;
+    size_t blockSize;
+    const char* api;
+    unsigned nbThreads;
+    U64 srcSize;
+    U64 cSize;
+    double cSpeed;   /* MB/s, < 0 when not measured */
+    double dSpeed;   /* MB/s */
+} BMK_record_t;
+
+static void BMK_outputString(const char* s)
+{
+    if (g_outputFormat == BMK_format_json) {
+        DISPLAYOUT("\"");
+        for ( ; *s; s++) {
+            if (*s == '"' || *s == '\\') DISPLAYOUT("\\%c", *s);
+            else if ((unsigned char)*s < 0x20) DISPLAYOUT("\\u%04x", (unsigned)*s);
+            else DISPLAYOUT("%c", *s);
+        }
+        DISPLAYOUT("\"");
+    } else {   /* csv */
+        DISPLAYOUT("\"");
+        for ( ; *s; s++) {
+            if (*s == '"') DISPLAYOUT("\"\"");
+            else DISPLAYOUT("%c", *s);
+        }
+        DISPLAYOUT("\"");
+    }
+}
+
+static void BMK_outputSpeed(double speed)
+{
+    if (speed >= 0) DISPLAYOUT("%.2f", speed);
+    else if (g_outputFormat == BMK_format_json) DISPLAYOUT("null");
+}
+
+/*! BMK_outputRecord() :
+ *  Writes one result on stdout, as a json object on a single line, or as a csv row.
+ *  Host and build description are repeated in each record, so that records are self-contained. */
+static void BMK_outputRecord(const BMK_record_t* r)
+{
+    static char cpuModel[128] = { 0 };
+    static int headerDone = 0;
+    int const json = (g_outputFormat == BMK_format_json);
+    if (cpuModel[0] == 0) UTIL_getCpuModel(cpuModel, sizeof(cpuModel));
+    if (!json && !headerDone) {
+        DISPLAYOUT("file,level,blockSize,api,threads,srcSize,cSize,ratio,cSpeedMBs,dSpeedMBs,iterations,"
+                   "cpu,version,compiler,LZ4_MEMORY_USAGE,LZ4_FAST_DEC_LOOP\n");
+        headerDone = 1;
+    }
+    if (json) DISPLAYOUT("{\"file\":");
+    BMK_outputString(r->file);
+    DISPLAYOUT(json ? ",\"level\":%i,\"blockSize\":%u,\"api\":" : ",%i,%u,", r->cLevel, (unsigned)r->blockSize);
+    BMK_outputString(r->api);
+    DISPLAYOUT(json ? ",\"threads\":%u,\"srcSize\":%llu,\"cSize\":%llu,\"ratio\":%.4f,\"cSpeedMBs\":" : ",%u,%llu,%llu,%.4f,",
+               r->nbThreads, (unsigned long long)r->srcSize, (unsigned long long)r->cSize,
+               (double)r->srcSize / (double)(r->cSize + !r->cSize));
+    BMK_outputSpeed(r->cSpeed);
+    DISPLAYOUT(json ? ",\"dSpeedMBs\":" : ",");
+    BMK_outputSpeed(r->dSpeed);
+    DISPLAYOUT(json ? ",\"iterations\":%u,\"cpu\":" : ",%u,", g_nbSeconds);
+    BMK_outputString(cpuModel);
+    DISPLAYOUT(json ? ",\"version\":" : ",");
+    BMK_outputString(LZ4_VERSION_STRING);
+    DISPLAYOUT(json ? ",\"compiler\":" : ",");
+    BMK_outputString(BMK_COMPILER_STRING);
+    DISPLAYOUT(json ? ",\"LZ4_MEMORY_USAGE\":%i,\"LZ4_FAST_DEC_LOOP\":" : ",%i,", LZ4_MEMORY_USAGE);
+    BMK_outputString(BMK_FAST_DEC_LOOP_STRING);
+    DISPLAYOUT(json ? "}\n" : "\n");
+    fflush(stdout);
+}
+
+static const char* BMK_apiName(int cLevel)
+{
+    if (g_decodeOnly) return "LZ4F_decompress";
+    if (g_frameMode) return "LZ4F_compressUpdate";
+    return (cLevel >= LZ4HC_CLEVEL_MIN) ? "LZ4_compress_HC" : "LZ4_compress_fast";
+}
+
 
 /* *************************************
  *  Compression state management
@@ -159,6 +310,10 @@ struct compressionParameters
     LZ4_streamHC_t* LZ4_streamHC;
     LZ4_streamHC_t* LZ4_dictStreamHC;
 
+    LZ4F_cctx* cctx;
+    LZ4F_CDict* cdict;
+    LZ4F_preferences_t prefs;
+
     void (*initFunction)(
         struct compressionParameters* pThis);
     void (*resetFunction)(
@@ -275,6 +430,85 @@ LZ4_compressCleanupStreamHC(const struct compressionParameters* pThis)
     LZ4_freeStreamHC(pThis->LZ4_dictStreamHC);
 }
 
+/* Frame mode : same path as `lz4` command, one frame per block,
+ * fed to LZ4F_compressUpdate() one frame block at a time */
+static LZ4F_blockSizeID_t BMK_frameBlockSizeID(void)
+{
+    if (g_blockSize == 0) return LZ4F_max4MB;   /* same default as `lz4` */
+    if (g_blockSize <= 64 KB) return LZ4F_max64KB;
+    if (g_blockSize <= 256 KB) return LZ4F_max256KB;
+    if (g_blockSize <= 1 MB) return LZ4F_max1MB;
+    return LZ4F_max4MB;
+}
+
+static void
+LZ4F_compressInitFrame(struct compressionParameters* pThis)
+{
+    LZ4_compressInitNoStream(pThis);
+    memset(&pThis->prefs, 0, sizeof(pThis->prefs));
+    pThis->prefs.compressionLevel = pThis->cLevel;
+    pThis->prefs.autoFlush = 1;
+    pThis->prefs.frameInfo.blockSizeID = BMK_frameBlockSizeID();
+    pThis->prefs.frameInfo.blockMode = g_blockLinked ? LZ4F_blockLinked : LZ4F_blockIndependent;
+    pThis->prefs.frameInfo.blockChecksumFlag = g_blockChecksum ? LZ4F_blockChecksumEnabled : LZ4F_noBlockChecksum;
+    pThis->prefs.frameInfo.contentChecksumFlag = g_skipChecksums ? LZ4F_noContentChecksum : LZ4F_contentChecksumEnabled;
+    if (LZ4F_isError(LZ4F_createCompressionContext(&pThis->cctx, LZ4F_VERSION)))
+        END_PROCESS(1, "allocation error - compression state");
+    pThis->cdict = NULL;
+    if (pThis->dictSize) {
+        pThis->cdict = LZ4F_createCDict(pThis->dictBuf, (size_t)pThis->dictSize);
+        if (pThis->cdict == NULL)
+            END_PROCESS(1, "allocation error - dictionary");
+    }
+}
+
+static int
+LZ4F_compressBlockFrame(const struct compressionParameters* pThis,
+                        const char* src, char* dst,
+                        int srcSize, int dstSize)
+{
+    LZ4F_preferences_t prefs = pThis->prefs;
+    size_t const blockSize = LZ4F_getBlockSize(prefs.frameInfo.blockSizeID);
+    size_t pos = 0, cSize;
+    if (g_contentSize) prefs.frameInfo.contentSize = (unsigned long long)srcSize;
+    cSize = LZ4F_compressBegin_usingCDict(pThis->cctx, dst, (size_t)dstSize, pThis->cdict, &prefs);
+    if (LZ4F_isError(cSize)) return 0;
+    while (pos < (size_t)srcSize) {
+        size_t const chunkSize = MIN(blockSize, (size_t)srcSize - pos);
+        size_t const r = LZ4F_compressUpdate(pThis->cctx, dst + cSize, (size_t)dstSize - cSize, src + pos, chunkSize, NULL);
+        if (LZ4F_isError(r)) return 0;
+        cSize += r;
+        pos += chunkSize;
+    }
+    {   size_t const r = LZ4F_compressEnd(pThis->cctx, dst + cSize, (size_t)dstSize - cSize, NULL);
+        if (LZ4F_isError(r)) return 0;
+        cSize += r;
+    }
+    return (int)cSize;
+}
+
+static void
+LZ4F_compressCleanupFrame(const struct compressionParameters* pThis)
+{
+    LZ4F_freeCompressionContext(pThis->cctx);
+    LZ4F_freeCDict(pThis->cdict);
+}
+
+/* BMK_compressBound() :
+ * room reserved for each compressed block */
+static size_t BMK_compressBound(size_t srcSize)
+{
+    if (g_frameMode) {
+        LZ4F_preferences_t prefs;
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = BMK_frameBlockSizeID();
+        prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+        prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+        return LZ4F_compressFrameBound(srcSize, &prefs);
+    }
+    return (size_t)LZ4_compressBound((int)srcSize);
+}
+
 static void
 LZ4_buildCompressionParameters(struct compressionParameters* pParams,
                                int cLevel,
@@ -284,7 +518,12 @@ LZ4_buildCompressionParameters(struct compressionParameters* pParams,
     pParams->dictBuf = dictBuf;
     pParams->dictSize = dictSize;
 
-    if (dictSize) {
+    if (g_frameMode) {
+        pParams->initFunction = LZ4F_compressInitFrame;
+        pParams->resetFunction = LZ4_compressResetNoStream;
+        pParams->blockFunction = LZ4F_compressBlockFrame;
+        pParams->cleanupFunction = LZ4F_compressCleanupFrame;
+    } else if (dictSize) {
         if (cLevel < LZ4HC_CLEVEL_MIN) {
             pParams->initFunction = LZ4_compressInitStream;
             pParams->resetFunction = LZ4_compressResetStream;
@@ -315,27 +554,37 @@ typedef int (*DecFunction_f)(const char* src, char* dst,
                              const char* dictStart, int dictSize);
 
 static LZ4F_dctx* g_dctx = NULL;
+static LZ4F_DDict* g_ddict = NULL;   /* frame mode with dictionary */
 
 static int
-LZ4F_decompress_binding(const char* src, char* dst,
-                        int srcSize, int dstCapacity,
-                  const char* dictStart, int dictSize)
+BMK_decompressFrame(LZ4F_dctx* dctx,
+                    const char* src, char* dst,
+                    int srcSize, int dstCapacity)
 {
     size_t dstSize = (size_t)dstCapacity;
     size_t readSize = (size_t)srcSize;
     LZ4F_decompressOptions_t dOpt = { 1, 0, 0, 0 };
     size_t decStatus;
     dOpt.skipChecksums = g_skipChecksums;
-    decStatus = LZ4F_decompress(g_dctx,
+    decStatus = LZ4F_decompress_usingDDict(dctx,
                     dst, &dstSize,
                     src, &readSize,
-                    &dOpt);
+                    g_ddict, &dOpt);
     if ( (decStatus == 0)   /* decompression successful */
       && ((int)readSize==srcSize) /* consume all input */ )
         return (int)dstSize;
     /* else, error */
+    LZ4F_resetDecompressionContext(dctx);
     return -1;
-    (void)dictStart; (void)dictSize;  /* not compatible with dictionary yet */
+}
+
+static int
+LZ4F_decompress_binding(const char* src, char* dst,
+                        int srcSize, int dstCapacity,
+                  const char* dictStart, int dictSize)
+{
+    (void)dictStart; (void)dictSize;  /* dictionary is provided by g_ddict */
+    return BMK_decompressFrame(g_dctx, src, dst, srcSize, dstCapacity);
 }
 
 
@@ -352,18 +601,35 @@ typedef struct {
     size_t resSize;
 } blockParam_t;
 
-#define MIN(a,b) ((a)<(b) ? (a) : (b))
-#define MAX(a,b) ((a)>(b) ? (a) : (b))
+/*! BMK_displayOptStats() :
+ *  Activity of the HC optimal parser during last benchmark,
+ *  only available when lz4hc.c is compiled with LZ4HC_OPT_STATS=1. */
+static void BMK_displayOptStats(void)
+{
+    LZ4HC_optStats_t st;
+    if (!LZ4_getOptimalParserStats(&st)) return;
+    if (st.srcSize == 0 || st.nbSearches == 0) return;
+    DISPLAYLEVEL(3, "    optimal parser : %.3f searches/byte, %.1f candidates/search, ",
+                 (double)st.nbSearches / (double)st.srcSize,
+                 (double)st.nbCandidates / (double)st.nbSearches);
+    DISPLAYLEVEL(3, "%.1f%% matches encoded directly, parses : mean length %.1f, %.2f%% sufficient_len exits, %.2f%% LZ4_OPT_NUM window ends",
+                 100. * (double)st.nbDirectEncodes / (double)(st.nbDirectEncodes + st.nbParses + !(st.nbDirectEncodes + st.nbParses)),
+                 (double)st.parsedLength / (double)(st.nbParses + !st.nbParses),
+                 100. * (double)st.nbSufficientExits / (double)(st.nbParses + !st.nbParses),
+                 100. * (double)st.nbWindowEnds / (double)(st.nbParses + !st.nbParses));
+    if (st.nbTreeSwitches) DISPLAYLEVEL(3, ", binary tree searches");
+    DISPLAYLEVEL(3, " \n");
+}
 
 static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
                         const char* displayName, int cLevel,
                         const size_t* fileSizes, U32 nbFiles,
                         const char* dictBuf, int dictSize)
 {
-    size_t const blockSize = (g_blockSize>=32 && !g_decodeOnly ? g_blockSize : srcSize) + (!srcSize) /* avoid div by 0 */ ;
+    size_t const blockSize = (g_blockSize>=32 && !g_decodeOnly && !g_frameMode ? g_blockSize : srcSize) + (!srcSize) /* avoid div by 0 */ ;
     U32 const maxNbBlocks = (U32)((srcSize + (blockSize-1)) / blockSize) + nbFiles;
     blockParam_t* const blockTable = (blockParam_t*) malloc(maxNbBlocks * sizeof(blockParam_t));
-    size_t const maxCompressedSize = (size_t)LZ4_compressBound((int)srcSize) + (maxNbBlocks * 1024);   /* add some room for safety */
+    size_t const maxCompressedSize = BMK_compressBound(srcSize) + (maxNbBlocks * 1024);   /* add some room for safety */
     void* const compressedBuffer = malloc(maxCompressedSize);
     size_t const decMultiplier = g_decodeOnly ? 255 : 1;
     size_t const maxInSize = (size_t)LZ4_MAX_INPUT_SIZE / decMultiplier;
@@ -405,7 +671,7 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
                 blockTable[nbBlocks].cPtr = cPtr;
                 blockTable[nbBlocks].resPtr = resPtr;
                 blockTable[nbBlocks].srcSize = thisBlockSize;
-                blockTable[nbBlocks].cRoom = (size_t)LZ4_compressBound((int)thisBlockSize);
+                blockTable[nbBlocks].cRoom = BMK_compressBound(thisBlockSize);
                 srcPtr += thisBlockSize;
                 cPtr += blockTable[nbBlocks].cRoom;
                 resPtr += resCapa;
@@ -440,6 +706,7 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
         double ratio = 0.;
 
         DISPLAYLEVEL(2, "\r%79s\r", "");
+        LZ4_resetOptimalParserStats();
         if (g_nbSeconds==0) { nbCompressionLoops = 1; nbDecodeLoops = 1; }
         while (!cCompleted || !dCompleted) {
             /* overheat protection */
@@ -509,9 +776,9 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
             TIME_waitForNextTick();
 
             if (!dCompleted) {
-                const DecFunction_f decFunction = g_decodeOnly ?
+                const DecFunction_f decFunction = (g_decodeOnly || g_frameMode) ?
                     LZ4F_decompress_binding : LZ4_decompress_safe_usingDict;
-                const char* const decString = g_decodeOnly ?
+                const char* const decString = (g_decodeOnly || g_frameMode) ?
                     "LZ4F_decompress" : "LZ4_decompress_safe_usingDict";
                 TIME_t const timeStart = TIME_getTime();
                 U32 nbLoops;
@@ -593,7 +860,19 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
 #endif
         }   /* for (testNb = 1; testNb <= (g_nbSeconds + !g_nbSeconds); testNb++) */
 
-        if (g_displayLevel == 1) {
+        if (g_outputFormat != BMK_format_text) {
+            BMK_record_t record;
+            record.file = displayName;
+            record.cLevel = cLevel;
+            record.blockSize = blockSize;
+            record.api = BMK_apiName(cLevel);
+            record.nbThreads = 1;
+            record.srcSize = totalRSize;
+            record.cSize = cSize;
+            record.cSpeed = g_decodeOnly ? -1. : ((double)totalRSize / (double)fastestC) * 1000;
+            record.dSpeed = ((double)totalRSize / (double)fastestD) * 1000;
+            BMK_outputRecord(&record);
+        } else if (g_displayLevel == 1) {
             double const cSpeed = ((double)srcSize / (double)fastestC) * 1000;
             double const dSpeed = ((double)srcSize / (double)fastestD) * 1000;
             if (g_additionalParam)
@@ -602,6 +881,7 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
                 DISPLAYOUT("-%-3i%11i (%5.3f) %6.2f MB/s %6.1f MB/s  %s\n", cLevel, (int)cSize, ratio, cSpeed, dSpeed, displayName);
         }
         DISPLAYLEVEL(2, "%2i#\n", cLevel);
+        if (!g_decodeOnly && cLevel >= LZ4HC_CLEVEL_OPT_MIN) BMK_displayOptStats();
     }   /* Bench */
 
     /* clean up */
@@ -613,6 +893,973 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
 }
 
 
+/* *************************************
+*  Multi-threaded scaling benchmark
+***************************************/
+
+/* BMK_cutBlocks() :
+ * cuts @src into blocks of @blockSize, never crossing file boundaries.
+ * Each block gets LZ4_compressBound() room in @cBuffer, and its own size in @resBuffer.
+ * @return : nb of blocks */
+static U32 BMK_cutBlocks(blockParam_t* blockTable,
+                         const char* src, char* cBuffer, char* resBuffer,
+                         const size_t* fileSizes, U32 nbFiles, size_t blockSize)
+{
+    U32 nbBlocks = 0;
+    U32 fileNb;
+    for (fileNb=0; fileNb<nbFiles; fileNb++) {
+        size_t remaining = fileSizes[fileNb];
+        while (remaining) {
+            size_t const thisBlockSize = MIN(remaining, blockSize);
+            blockTable[nbBlocks].srcPtr = src;
+            blockTable[nbBlocks].srcSize = thisBlockSize;
+            blockTable[nbBlocks].cPtr = cBuffer;
+            blockTable[nbBlocks].cRoom = BMK_compressBound(thisBlockSize);
+            blockTable[nbBlocks].cSize = 0;
+            blockTable[nbBlocks].resPtr = resBuffer;
+            blockTable[nbBlocks].resSize = 0;
+            src += thisBlockSize;
+            cBuffer += blockTable[nbBlocks].cRoom;
+            resBuffer += thisBlockSize;
+            remaining -= thisBlockSize;
+            nbBlocks++;
+    }   }
+    return nbBlocks;
+}
+
+typedef enum { bmk_init, bmk_compress, bmk_decompress } BMK_phase_e;
+
+typedef struct {
+    BMK_phase_e phase;
+    blockParam_t* blocks;
+    U32 nbBlocks;
+    /* replicated mode : own copy of input, allocated by the thread using it */
+    const void* srcBuffer;
+    size_t srcSize;
+    const size_t* fileSizes;
+    U32 nbFiles;
+    size_t blockSize;
+    void* ownBuffers;
+    /* parameters */
+    int cLevel;
+    const char* dictBuf;
+    int dictSize;
+    Duration_ns minDuration;
+    /* results */
+    U64 nbBytes;
+    Duration_ns duration;
+    int error;
+} BMK_threadJob_t;
+
+static void BMK_threadJob(void* arg)
+{
+    BMK_threadJob_t* const job = (BMK_threadJob_t*)arg;
+    struct compressionParameters compP;
+    LZ4F_dctx* dctx = NULL;
+    U64 passBytes = 0, nbPasses = 0;
+    TIME_t timeStart = TIME_getTime();
+    int pass;
+    U32 blockNb;
+
+    if (job->phase == bmk_init) {
+        /* memory is first touched by the thread using it (NUMA locality) */
+        U32 const maxNbBlocks = (U32)((job->srcSize + job->blockSize - 1) / job->blockSize) + job->nbFiles;
+        size_t const cCapacity = BMK_compressBound(job->srcSize) + (maxNbBlocks * 1024);
+        size_t const tableSize = maxNbBlocks * sizeof(blockParam_t);
+        char* const buffers = (char*)malloc(tableSize + job->srcSize + cCapacity + job->srcSize);
+        char* const src = buffers + tableSize;
+        job->ownBuffers = buffers;
+        if (buffers == NULL) { job->error = 1; return; }
+        memcpy(src, job->srcBuffer, job->srcSize);
+        memset(src + job->srcSize, 0, cCapacity + job->srcSize);
+        job->blocks = (blockParam_t*)(void*)buffers;
+        job->nbBlocks = BMK_cutBlocks(job->blocks,
+                                      src, src + job->srcSize, src + job->srcSize + cCapacity,
+                                      job->fileSizes, job->nbFiles, job->blockSize);
+        return;
+    }
+
+    for (blockNb=0; blockNb<job->nbBlocks; blockNb++) passBytes += job->blocks[blockNb].srcSize;
+    if (job->phase == bmk_compress) {
+        LZ4_buildCompressionParameters(&compP, job->cLevel, job->dictBuf, job->dictSize);
+        compP.initFunction(&compP);
+    }
+    if (job->phase == bmk_decompress && g_frameMode) {
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))) { job->error = 1; return; }
+    }
+
+    for (pass = -1; !job->error; pass++) {   /* pass -1 warms up caches, and is not measured */
+        if (pass == 0) timeStart = TIME_getTime();
+        if (job->phase == bmk_compress) {
+            compP.resetFunction(&compP);
+            for (blockNb=0; blockNb<job->nbBlocks; blockNb++) {
+                blockParam_t* const b = job->blocks + blockNb;
+                int const cSize = compP.blockFunction(&compP, b->srcPtr, b->cPtr, (int)b->srcSize, (int)b->cRoom);
+                if (cSize <= 0) job->error = 1;
+                b->cSize = (size_t)cSize;
+            }
+        } else {
+            for (blockNb=0; blockNb<job->nbBlocks; blockNb++) {
+                blockParam_t* const b = job->blocks + blockNb;
+                int const rSize = g_frameMode ?
+                    BMK_decompressFrame(dctx, b->cPtr, b->resPtr, (int)b->cSize, (int)b->srcSize) :
+                    LZ4_decompress_safe_usingDict(b->cPtr, b->resPtr, (int)b->cSize, (int)b->srcSize,
+                                                  job->dictBuf, job->dictSize);
+                if (rSize != (int)b->srcSize) job->error = 1;
+                b->resSize = (size_t)rSize;
+            }
+        }
+        if (pass >= 0) {
+            nbPasses++;
+            if (TIME_clockSpan_ns(timeStart) >= job->minDuration) break;
+        }
+    }
+    job->duration = TIME_clockSpan_ns(timeStart);
+    job->nbBytes = nbPasses * passBytes;
+
+    if (job->phase == bmk_compress) compP.cleanupFunction(&compP);
+    LZ4F_freeDecompressionContext(dctx);
+}
+
+/* BMK_runThreads() :
+ * runs @phase on @nbThreads jobs concurrently.
+ * @return : sum of per-thread speeds, in bytes per ns */
+static double BMK_runThreads(BMK_threadJob_t* jobs, unsigned nbThreads, BMK_phase_e phase, double* slowest)
+{
+    static const char* const phaseNames[] = { "allocation", "compression", "decompression" };
+    TPOOL_ctx* const pool = TPOOL_create((int)nbThreads, (int)nbThreads);
+    double total = 0.;
+    unsigned n;
+    if (pool == NULL) END_PROCESS(32, "could not create thread pool");
+    for (n=0; n<nbThreads; n++) {
+        jobs[n].phase = phase;
+        TPOOL_submitJob(pool, BMK_threadJob, jobs + n);
+    }
+    TPOOL_completeJobs(pool);
+    TPOOL_free(pool);
+    *slowest = 0.;
+    for (n=0; n<nbThreads; n++) {
+        double const speed = (double)jobs[n].nbBytes / (double)(jobs[n].duration + !jobs[n].duration);
+        if (jobs[n].error) END_PROCESS(33, "%s failed in thread %u", phaseNames[phase], n);
+        total += speed;
+        if (n==0 || speed < *slowest) *slowest = speed;
+    }
+    return total;
+}
+
+/* BMK_benchMemMT() :
+ * measures aggregated speed of 1, 2, 4, ... up to g_nbThreads concurrent threads,
+ * each one working either on its own range of blocks, or on its own copy of input (g_replicate).
+ * Scaling efficiency compares aggregated speed with single-thread speed multiplied by nb of threads. */
+static int BMK_benchMemMT(const void* srcBuffer, size_t srcSize,
+                          const char* displayName, int cLevel,
+                          const size_t* fileSizes, U32 nbFiles,
+                          const char* dictBuf, int dictSize)
+{
+    size_t const blockSize = (g_blockSize>=32 && !g_frameMode ? g_blockSize : srcSize) + (!srcSize);
+    U32 const maxNbBlocks = (U32)((srcSize + (blockSize-1)) / blockSize) + nbFiles;
+    BMK_threadJob_t* const jobs = (BMK_threadJob_t*)calloc(g_nbThreads, sizeof(BMK_threadJob_t));
+    blockParam_t* blockTable = NULL;
+    void* compressedBuffer = NULL;
+    void* resultBuffer = NULL;
+    U32 nbBlocks = 0;
+    int replicate = g_replicate;
+    double cSpeed1 = 0., dSpeed1 = 0.;
+    unsigned nbThreads, n;
+
+    if (jobs == NULL) END_PROCESS(31, "allocation error : not enough memory");
+    if (strlen(displayName)>17) displayName += strlen(displayName)-17;   /* can only display 17 characters */
+
+    if (!replicate) {
+        size_t const maxCompressedSize = BMK_compressBound(srcSize) + (maxNbBlocks * 1024);
+        blockTable = (blockParam_t*)malloc(maxNbBlocks * sizeof(blockParam_t));
+        compressedBuffer = malloc(maxCompressedSize);
+        resultBuffer = malloc(srcSize + !srcSize);
+        if (!blockTable || !compressedBuffer || !resultBuffer)
+            END_PROCESS(31, "allocation error : not enough memory");
+        memset(compressedBuffer, 0, maxCompressedSize);
+        memset(resultBuffer, 0, srcSize);
+        nbBlocks = BMK_cutBlocks(blockTable, (const char*)srcBuffer, (char*)compressedBuffer, (char*)resultBuffer,
+                                 fileSizes, nbFiles, blockSize);
+        if (nbBlocks < g_nbThreads) {
+            DISPLAYLEVEL(2, "%u blocks for %u threads : each thread benchmarks its own copy of input (use -B# for smaller blocks) \n",
+                        nbBlocks, g_nbThreads);
+            replicate = 1;
+    }   }
+
+    for (n=0; n<g_nbThreads; n++) {
+        jobs[n].cLevel = cLevel;
+        jobs[n].dictBuf = dictBuf;
+        jobs[n].dictSize = dictSize;
+        jobs[n].minDuration = (Duration_ns)g_nbSeconds * TIMELOOP_NANOSEC;
+        if (replicate) {
+            jobs[n].srcBuffer = srcBuffer;
+            jobs[n].srcSize = srcSize;
+            jobs[n].fileSizes = fileSizes;
+            jobs[n].nbFiles = nbFiles;
+            jobs[n].blockSize = blockSize;
+    }   }
+    if (replicate) {
+        double unused;
+        (void)BMK_runThreads(jobs, g_nbThreads, bmk_init, &unused);
+    }
+
+    DISPLAYLEVEL(2, "%-17.17s : %u bytes, level %i, %s, %u KB blocks \n",
+                displayName, (U32)srcSize, cLevel,
+                replicate ? "one copy of input per thread" : "input shared between threads",
+                (U32)(blockSize >> 10));
+    DISPLAYLEVEL(2, "threads :  compression (per thread)   eff. : decompression (per thread)  eff. \n");
+
+    for (nbThreads = 1; ; nbThreads = MIN(nbThreads * 2, g_nbThreads)) {
+        double cSlowest, dSlowest, cSpeed, dSpeed;
+        if (!replicate) {
+            /* each thread gets a contiguous range of blocks */
+            for (n=0; n<nbThreads; n++) {
+                U32 const first = (U32)(((U64)nbBlocks * n) / nbThreads);
+                U32 const last = (U32)(((U64)nbBlocks * (n+1)) / nbThreads);
+                jobs[n].blocks = blockTable + first;
+                jobs[n].nbBlocks = last - first;
+        }   }
+        cSpeed = BMK_runThreads(jobs, nbThreads, bmk_compress, &cSlowest);
+        dSpeed = BMK_runThreads(jobs, nbThreads, bmk_decompress, &dSlowest);
+
+        /* check round trip */
+        if (replicate) {
+            U64 const crcOrig = XXH64(srcBuffer, srcSize, 0);
+            for (n=0; n<nbThreads; n++) {
+                if (XXH64(jobs[n].blocks[0].resPtr, srcSize, 0) != crcOrig)
+                    END_PROCESS(34, "Invalid checksum in thread %u", n);
+        }   } else {
+            if (XXH64(resultBuffer, srcSize, 0) != XXH64(srcBuffer, srcSize, 0))
+                END_PROCESS(34, "Invalid checksum");
+        }
+
+        if (nbThreads == 1) { cSpeed1 = cSpeed; dSpeed1 = dSpeed; }
+        {   double const cEff = 100. * cSpeed / (cSpeed1 * nbThreads);
+            double const dEff = 100. * dSpeed / (dSpeed1 * nbThreads);
+            DISPLAYLEVEL(2, "%7u : %8.1f MB/s (%7.1f MB/s) %5.1f%% : %8.1f MB/s (%7.1f MB/s) %5.1f%% \n",
+                        nbThreads,
+                        cSpeed * 1000, cSpeed * 1000 / nbThreads, cEff,
+                        dSpeed * 1000, dSpeed * 1000 / nbThreads, dEff);
+            if (g_outputFormat != BMK_format_text) {
+                BMK_record_t record;
+                const blockParam_t* const blocks = replicate ? jobs[0].blocks : blockTable;
+                U32 const nbRecordBlocks = replicate ? jobs[0].nbBlocks : nbBlocks;
+                U32 b;
+                record.file = displayName;
+                record.cLevel = cLevel;
+                record.blockSize = blockSize;
+                record.api = BMK_apiName(cLevel);
+                record.nbThreads = nbThreads;
+                record.srcSize = srcSize;
+                record.cSize = 0;
+                for (b=0; b<nbRecordBlocks; b++) record.cSize += blocks[b].cSize;
+                record.cSpeed = cSpeed * 1000;
+                record.dSpeed = dSpeed * 1000;
+                BMK_outputRecord(&record);
+            } else if (g_displayLevel == 1)
+                DISPLAYOUT("-%-3i T%-4u %9.1f MB/s %9.1f MB/s %5.1f%% %5.1f%%  %s\n",
+                        cLevel, nbThreads, cSpeed * 1000, dSpeed * 1000, cEff, dEff, displayName);
+            DISPLAYLEVEL(3, "          slowest thread : %7.1f MB/s, %7.1f MB/s \n", cSlowest * 1000, dSlowest * 1000);
+        }
+        if (nbThreads == g_nbThreads) break;
+    }
+
+    /* clean up */
+    for (n=0; n<g_nbThreads; n++) free(jobs[n].ownBuffers);
+    free(jobs);
+    free(blockTable);
+    free(compressedBuffer);
+    free(resultBuffer);
+    return 0;
+}
+
+
+/* *************************************
+*  Latency benchmark
+***************************************/
+
+/* Per-call latencies are collected into a log-linear histogram :
+ * 2^BMK_LAT_SUBBITS buckets per power of 2, hence ~12% resolution. */
+#define BMK_LAT_SUBBITS   3
+#define BMK_LAT_NBBUCKETS ((64 - BMK_LAT_SUBBITS + 1) << BMK_LAT_SUBBITS)
+
+typedef struct {
+    const char* name;
+    U64 count[BMK_LAT_NBBUCKETS];
+    U64 nbCalls;
+    Duration_ns min;
+    Duration_ns max;
+} BMK_latHistogram_t;
+
+static unsigned BMK_latBucket(Duration_ns d)
+{
+    unsigned highBit = 0;
+    if (d < (1 << BMK_LAT_SUBBITS)) return (unsigned)d;
+    while (d >> (highBit+1)) highBit++;
+    return ((highBit - BMK_LAT_SUBBITS + 1) << BMK_LAT_SUBBITS)
+         + (unsigned)((d >> (highBit - BMK_LAT_SUBBITS)) & ((1 << BMK_LAT_SUBBITS) - 1));
+}
+
+/* lowest duration counted into bucket @b */
+static Duration_ns BMK_latBucketStart(unsigned b)
+{
+    unsigned const sub = b & ((1 << BMK_LAT_SUBBITS) - 1);
+    if (b < (1 << BMK_LAT_SUBBITS)) return b;
+    return (Duration_ns)((1 << BMK_LAT_SUBBITS) + sub) << ((b >> BMK_LAT_SUBBITS) - 1);
+}
+
+static void BMK_latRecord(BMK_latHistogram_t* h, Duration_ns d)
+{
+    h->count[BMK_latBucket(d)]++;
+    if (h->nbCalls == 0 || d < h->min) h->min = d;
+    if (d > h->max) h->max = d;
+    h->nbCalls++;
+}
+
+static Duration_ns BMK_latPercentile(const BMK_latHistogram_t* h, double p)
+{
+    U64 const rank = (U64)((double)h->nbCalls * p / 100.) + 1;
+    U64 total = 0;
+    unsigned b;
+    for (b=0; b<BMK_LAT_NBBUCKETS; b++) {
+        total += h->count[b];
+        if (total >= rank) return MAX(BMK_latBucketStart(b), h->min);
+    }
+    return h->max;
+}
+
+static void BMK_latDisplayHistogram(const BMK_latHistogram_t* h)
+{
+    unsigned b;
+    for (b=0; b<BMK_LAT_NBBUCKETS; b += (1 << BMK_LAT_SUBBITS)) {
+        /* one line per power of 2 */
+        U64 count = 0;
+        unsigned s;
+        for (s=0; s < (1 << BMK_LAT_SUBBITS); s++) count += h->count[b+s];
+        if (count == 0) continue;
+        {   double const share = 100. * (double)count / (double)h->nbCalls;
+            int const barLength = (int)(share / 2 + 0.5);
+            DISPLAYLEVEL(3, "    >= %8llu ns : %6.2f%% %10llu %.*s \n",
+                        (unsigned long long)BMK_latBucketStart(b), share, (unsigned long long)count,
+                        barLength, "##################################################");
+    }   }
+}
+
+typedef struct {
+    const char* src;
+    size_t srcSize;
+    size_t msgSize;
+    int cLevel;
+    const char* dictBuf;
+    int dictSize;
+
+    LZ4_stream_t* stream;
+    LZ4_stream_t* dictStream;
+    LZ4_streamHC_t* streamHC;
+    LZ4_streamHC_t* dictStreamHC;
+    LZ4F_cctx* cctx;
+    LZ4F_CDict* cdict;
+    LZ4F_dctx* dctx;
+    LZ4F_preferences_t prefs;
+
+    char* cBuf;         /* block compressed messages, cCap bytes apart */
+    size_t cCap;
+    int* cSizes;
+    char* fBuf;         /* frame compressed messages, fCap bytes apart */
+    size_t fCap;
+    size_t* fSizes;
+    char* resBuf;
+} BMK_latState_t;
+
+/* Each function processes message @n, and returns produced size, or 0 on error */
+typedef size_t (*BMK_latFunction_f)(BMK_latState_t* s, size_t n);
+
+static size_t BMK_latMsgSize(const BMK_latState_t* s, size_t n)
+{
+    return MIN(s->msgSize, s->srcSize - n * s->msgSize);
+}
+
+static size_t BMK_latInitStream(BMK_latState_t* s, size_t n)
+{
+    int const acceleration = (s->cLevel < 0) ? -s->cLevel + 1 : 1;
+    LZ4_stream_t* const stream = LZ4_initStream(s->stream, sizeof(*s->stream));
+    if (s->dictStream) LZ4_attach_dictionary(stream, s->dictStream);
+    s->cSizes[n] = LZ4_compress_fast_continue(stream, s->src + n * s->msgSize, s->cBuf + n * s->cCap,
+                                (int)BMK_latMsgSize(s, n), (int)s->cCap, acceleration);
+    return (size_t)s->cSizes[n];
+}
+
+static size_t BMK_latResetStream(BMK_latState_t* s, size_t n)
+{
+    int const acceleration = (s->cLevel < 0) ? -s->cLevel + 1 : 1;
+    LZ4_resetStream_fast(s->stream);
+    if (s->dictStream) LZ4_attach_dictionary(s->stream, s->dictStream);
+    s->cSizes[n] = LZ4_compress_fast_continue(s->stream, s->src + n * s->msgSize, s->cBuf + n * s->cCap,
+                                (int)BMK_latMsgSize(s, n), (int)s->cCap, acceleration);
+    return (size_t)s->cSizes[n];
+}
+
+static size_t BMK_latInitStreamHC(BMK_latState_t* s, size_t n)
+{
+    LZ4_streamHC_t* const streamHC = LZ4_initStreamHC(s->streamHC, sizeof(*s->streamHC));
+    LZ4_setCompressionLevel(streamHC, s->cLevel);
+    if (s->dictStreamHC) LZ4_attach_HC_dictionary(streamHC, s->dictStreamHC);
+    s->cSizes[n] = LZ4_compress_HC_continue(streamHC, s->src + n * s->msgSize, s->cBuf + n * s->cCap,
+                                (int)BMK_latMsgSize(s, n), (int)s->cCap);
+    return (size_t)s->cSizes[n];
+}
+
+static size_t BMK_latResetStreamHC(BMK_latState_t* s, size_t n)
+{
+    LZ4_resetStreamHC_fast(s->streamHC, s->cLevel);
+    if (s->dictStreamHC) LZ4_attach_HC_dictionary(s->streamHC, s->dictStreamHC);
+    s->cSizes[n] = LZ4_compress_HC_continue(s->streamHC, s->src + n * s->msgSize, s->cBuf + n * s->cCap,
+                                (int)BMK_latMsgSize(s, n), (int)s->cCap);
+    return (size_t)s->cSizes[n];
+}
+
+static size_t BMK_latFrame(BMK_latState_t* s, LZ4F_cctx* cctx, size_t n)
+{
+    size_t const r = LZ4F_compressFrame_usingCDict(cctx, s->fBuf + n * s->fCap, s->fCap,
+                                s->src + n * s->msgSize, BMK_latMsgSize(s, n),
+                                s->cdict, &s->prefs);
+    s->fSizes[n] = LZ4F_isError(r) ? 0 : r;
+    return s->fSizes[n];
+}
+
+static size_t BMK_latCreateFrame(BMK_latState_t* s, size_t n)
+{
+    LZ4F_cctx* cctx;
+    size_t r;
+    if (LZ4F_isError(LZ4F_createCompressionContext(&cctx, LZ4F_VERSION))) return 0;
+    r = BMK_latFrame(s, cctx, n);
+    LZ4F_freeCompressionContext(cctx);
+    return r;
+}
+
+static size_t BMK_latReuseFrame(BMK_latState_t* s, size_t n)
+{
+    return BMK_latFrame(s, s->cctx, n);
+}
+
+static size_t BMK_latDecompress(BMK_latState_t* s, size_t n)
+{
+    int const r = LZ4_decompress_safe_usingDict(s->cBuf + n * s->cCap, s->resBuf,
+                                s->cSizes[n], (int)s->msgSize,
+                                s->dictBuf, s->dictSize);
+    return (r < 0) ? 0 : (size_t)r;
+}
+
+static size_t BMK_latDecompressFrame(BMK_latState_t* s, LZ4F_dctx* dctx, size_t n)
+{
+    size_t dstSize = s->msgSize;
+    size_t srcSize = s->fSizes[n];
+    LZ4F_decompressOptions_t dOpt = { 1, 0, 0, 0 };
+    size_t r;
+    dOpt.skipChecksums = g_skipChecksums;
+    r = LZ4F_decompress_usingDict(dctx, s->resBuf, &dstSize,
+                                s->fBuf + n * s->fCap, &srcSize,
+                                s->dictBuf, (size_t)s->dictSize, &dOpt);
+    if (r != 0 || srcSize != s->fSizes[n]) {
+        LZ4F_resetDecompressionContext(dctx);
+        return 0;
+    }
+    return dstSize;
+}
+
+static size_t BMK_latCreateDecompressFrame(BMK_latState_t* s, size_t n)
+{
+    LZ4F_dctx* dctx;
+    size_t r;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))) return 0;
+    r = BMK_latDecompressFrame(s, dctx, n);
+    LZ4F_freeDecompressionContext(dctx);
+    return r;
+}
+
+static size_t BMK_latReuseDecompressFrame(BMK_latState_t* s, size_t n)
+{
+    return BMK_latDecompressFrame(s, s->dctx, n);
+}
+
+/*! BMK_benchLatency() :
+ *  Cuts input into messages of g_latencyMsgSize bytes,
+ *  and times each call separately, including state initialization or reset,
+ *  so that tail latencies can be reported, rather than average throughput.
+ *  Compression functions run first, since decompression functions decode their output. */
+static int BMK_benchLatency(const void* srcBuffer, size_t srcSize,
+                            const char* displayName, int cLevel,
+                            const char* dictBuf, int dictSize)
+{
+    int const useHC = (cLevel >= LZ4HC_CLEVEL_MIN);
+    typedef enum { lat_anyLevel, lat_fastLevels, lat_hcLevels, lat_decompression } BMK_latKind_e;
+    struct {
+        const char* name;
+        BMK_latFunction_f function;
+        BMK_latKind_e kind;
+    } const apis[] = {
+        { "LZ4_initStream + compress",                      BMK_latInitStream,           lat_fastLevels },
+        { "LZ4_resetStream_fast + compress",                BMK_latResetStream,          lat_fastLevels },
+        { "LZ4_initStreamHC + compress",                    BMK_latInitStreamHC,         lat_hcLevels },
+        { "LZ4_resetStreamHC_fast + compress",              BMK_latResetStreamHC,        lat_hcLevels },
+        { "LZ4F_createCompressionContext + compressFrame",  BMK_latCreateFrame,          lat_anyLevel },
+        { "LZ4F_compressFrame (reused cctx)",               BMK_latReuseFrame,           lat_anyLevel },
+        { "LZ4_decompress_safe_usingDict",                  BMK_latDecompress,           lat_decompression },
+        { "LZ4F_createDecompressionContext + decompress",   BMK_latCreateDecompressFrame, lat_decompression },
+        { "LZ4F_decompress (reused dctx)",                  BMK_latReuseDecompressFrame, lat_decompression },
+    };
+    unsigned const nbApis = (unsigned)(sizeof(apis) / sizeof(apis[0]));
+    BMK_latHistogram_t* const histograms = (BMK_latHistogram_t*)calloc(nbApis, sizeof(BMK_latHistogram_t));
+    BMK_latState_t s;
+    size_t nbMsgs, n;
+    U64 cTotal = 0, fTotal = 0;
+    unsigned a;
+
+    if (strlen(displayName)>17) displayName += strlen(displayName)-17;   /* can only display 17 characters */
+    memset(&s, 0, sizeof(s));
+    s.src = (const char*)srcBuffer;
+    s.srcSize = srcSize;
+    s.msgSize = MIN(g_latencyMsgSize, srcSize);
+    s.cLevel = cLevel;
+    s.dictBuf = dictBuf;
+    s.dictSize = dictSize;
+    nbMsgs = (srcSize + s.msgSize - 1) / s.msgSize;
+
+    s.prefs.compressionLevel = cLevel;
+    s.prefs.frameInfo.blockMode = g_blockLinked ? LZ4F_blockLinked : LZ4F_blockIndependent;
+    s.prefs.frameInfo.blockChecksumFlag = g_blockChecksum ? LZ4F_blockChecksumEnabled : LZ4F_noBlockChecksum;
+    s.prefs.frameInfo.contentChecksumFlag = g_skipChecksums ? LZ4F_noContentChecksum : LZ4F_contentChecksumEnabled;
+    s.prefs.frameInfo.contentSize = (unsigned long long)g_contentSize;   /* replaced by actual size */
+
+    s.cCap = (size_t)LZ4_compressBound((int)s.msgSize);
+    s.fCap = LZ4F_compressFrameBound(s.msgSize, &s.prefs);
+    s.cBuf = (char*)malloc(nbMsgs * s.cCap);
+    s.fBuf = (char*)malloc(nbMsgs * s.fCap);
+    s.cSizes = (int*)calloc(nbMsgs, sizeof(int));
+    s.fSizes = (size_t*)calloc(nbMsgs, sizeof(size_t));
+    s.resBuf = (char*)malloc(s.msgSize);
+    if (useHC) {
+        s.streamHC = LZ4_createStreamHC();
+        if (dictSize) {
+            s.dictStreamHC = LZ4_createStreamHC();
+            if (s.dictStreamHC) LZ4_loadDictHC(s.dictStreamHC, dictBuf, dictSize);
+        }
+    } else {
+        s.stream = LZ4_createStream();
+        if (dictSize) {
+            s.dictStream = LZ4_createStream();
+            if (s.dictStream) LZ4_loadDict(s.dictStream, dictBuf, dictSize);
+    }   }
+    if (dictSize) s.cdict = LZ4F_createCDict(dictBuf, (size_t)dictSize);
+    if ( !histograms || !s.cBuf || !s.fBuf || !s.cSizes || !s.fSizes || !s.resBuf
+      || (useHC ? !s.streamHC : !s.stream)
+      || (dictSize && ((useHC ? !s.dictStreamHC : !s.dictStream) || !s.cdict))
+      || LZ4F_isError(LZ4F_createCompressionContext(&s.cctx, LZ4F_VERSION))
+      || LZ4F_isError(LZ4F_createDecompressionContext(&s.dctx, LZ4F_VERSION)) )
+        END_PROCESS(41, "allocation error : not enough memory");
+    /* touch all memory ahead of measurements */
+    memset(s.cBuf, 0, nbMsgs * s.cCap);
+    memset(s.fBuf, 0, nbMsgs * s.fCap);
+    memset(s.resBuf, 0, s.msgSize);
+
+    for (a=0; a<nbApis; a++) {
+        BMK_latHistogram_t* const h = histograms + a;
+        Duration_ns const minDuration = (Duration_ns)g_nbSeconds * TIMELOOP_NANOSEC;
+        TIME_t const start = TIME_getTime();
+        h->name = apis[a].name;
+        if (apis[a].kind == (useHC ? lat_fastLevels : lat_hcLevels)) continue;
+        DISPLAYUPDATE(2, "%-40.40s \r", h->name);
+        do {
+            for (n=0; n<nbMsgs; n++) {
+                size_t const msgSize = BMK_latMsgSize(&s, n);
+                TIME_t const callStart = TIME_getTime();
+                size_t const r = apis[a].function(&s, n);
+                Duration_ns const callDuration = TIME_clockSpan_ns(callStart);
+                if (r == 0)
+                    END_PROCESS(42, "%s failed on message %u", h->name, (unsigned)n);
+                BMK_latRecord(h, callDuration);
+                if (apis[a].kind == lat_decompression
+                  && (r != msgSize || memcmp(s.resBuf, s.src + n * s.msgSize, msgSize)))
+                    END_PROCESS(43, "%s : wrong result on message %u", h->name, (unsigned)n);
+            }
+        } while (TIME_clockSpan_ns(start) < minDuration);
+    }
+
+    for (n=0; n<nbMsgs; n++) { cTotal += (U64)s.cSizes[n]; fTotal += s.fSizes[n]; }
+    DISPLAYLEVEL(2, "%-17.17s : %u bytes, level %i, %u messages of %u bytes : blocks %llu bytes (%.3f), frames %llu bytes (%.3f) \n",
+                displayName, (U32)srcSize, cLevel, (U32)nbMsgs, (U32)s.msgSize,
+                (unsigned long long)cTotal, (double)srcSize / (double)cTotal, (unsigned long long)fTotal, (double)srcSize / (double)fTotal);
+    DISPLAYLEVEL(2, "%-46s %8s %8s %8s %8s %8s %8s  (ns) \n", "per call latency", "min", "p50", "p90", "p99", "p99.9", "max");
+    for (a=0; a<nbApis; a++) {
+        const BMK_latHistogram_t* const h = histograms + a;
+        if (h->nbCalls == 0) continue;
+        DISPLAYLEVEL(2, "%-46.46s %8llu %8llu %8llu %8llu %8llu %8llu \n", h->name,
+                    (unsigned long long)h->min,
+                    (unsigned long long)BMK_latPercentile(h, 50.),
+                    (unsigned long long)BMK_latPercentile(h, 90.),
+                    (unsigned long long)BMK_latPercentile(h, 99.),
+                    (unsigned long long)BMK_latPercentile(h, 99.9),
+                    (unsigned long long)h->max);
+        if (g_displayLevel == 1 && g_outputFormat == BMK_format_text)
+            DISPLAYOUT("-%-3i %-46.46s %8llu %8llu %8llu %8llu %8llu %8llu  %s\n", cLevel, h->name,
+                    (unsigned long long)h->min,
+                    (unsigned long long)BMK_latPercentile(h, 50.),
+                    (unsigned long long)BMK_latPercentile(h, 90.),
+                    (unsigned long long)BMK_latPercentile(h, 99.),
+                    (unsigned long long)BMK_latPercentile(h, 99.9),
+                    (unsigned long long)h->max, displayName);
+    }
+    for (a=0; a<nbApis; a++) {
+        const BMK_latHistogram_t* const h = histograms + a;
+        if (h->nbCalls == 0) continue;
+        DISPLAYLEVEL(3, "%s : %llu calls \n", h->name, (unsigned long long)h->nbCalls);
+        BMK_latDisplayHistogram(h);
+    }
+
+    /* clean up */
+    LZ4_freeStream(s.stream);
+    LZ4_freeStream(s.dictStream);
+    LZ4_freeStreamHC(s.streamHC);
+    LZ4_freeStreamHC(s.dictStreamHC);
+    LZ4F_freeCompressionContext(s.cctx);
+    LZ4F_freeCDict(s.cdict);
+    LZ4F_freeDecompressionContext(s.dctx);
+    free(s.cBuf);
+    free(s.fBuf);
+    free(s.cSizes);
+    free(s.fSizes);
+    free(s.resBuf);
+    free(histograms);
+    return 0;
+}
+
+
+/* *************************************
+*  Shared dictionary benchmark
+***************************************/
+
+/* Hardware counters are opened by each thread, and only count that thread.
+ * They are reported per message. */
+#define BMK_SD_NBCOUNTERS 3
+static const char* const g_sdCounterNames[BMK_SD_NBCOUNTERS] = { "cycles/msg", "L1D-miss/msg", "LLC-miss/msg" };
+
+typedef struct {
+    int fd[BMK_SD_NBCOUNTERS];   /* < 0 when not available */
+} BMK_sdCounters_t;
+
+#if BMK_PERF
+static void BMK_sdCountersOpen(BMK_sdCounters_t* pc)
+{
+    static const struct { U32 type; U64 config; } events[BMK_SD_NBCOUNTERS] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                              | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                              | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },   /* last level cache */
+    };
+    int n;
+    for (n=0; n<BMK_SD_NBCOUNTERS; n++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[n].type;
+        attr.config = events[n].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        pc->fd[n] = (int)syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1, 0);
+    }
+}
+
+static void BMK_sdCountersControl(const BMK_sdCounters_t* pc, unsigned long request)
+{
+    int n;
+    for (n=0; n<BMK_SD_NBCOUNTERS; n++)
+        if (pc->fd[n] >= 0) (void)ioctl(pc->fd[n], request, 0);
+}
+
+/* @counts : counts since start, scaled when counters were multiplexed, < 0 when not available */
+static void BMK_sdCountersClose(BMK_sdCounters_t* pc, double counts[BMK_SD_NBCOUNTERS])
+{
+    int n;
+    BMK_sdCountersControl(pc, PERF_EVENT_IOC_DISABLE);
+    for (n=0; n<BMK_SD_NBCOUNTERS; n++) {
+        U64 values[3];   /* value, time enabled, time running */
+        counts[n] = -1.;
+        if (pc->fd[n] < 0) continue;
+        if ( (read(pc->fd[n], values, sizeof(values)) == (ssize_t)sizeof(values))
+          && (values[2] != 0) )
+            counts[n] = (double)values[0] * ((double)values[1] / (double)values[2]);
+        close(pc->fd[n]);
+        pc->fd[n] = -1;
+    }
+}
+#  define BMK_sdCountersStart(pc) do { BMK_sdCountersControl(pc, PERF_EVENT_IOC_RESET); \
+                                       BMK_sdCountersControl(pc, PERF_EVENT_IOC_ENABLE); } while (0)
+#else
+static void BMK_sdCountersOpen(BMK_sdCounters_t* pc) { int n; for (n=0; n<BMK_SD_NBCOUNTERS; n++) pc->fd[n] = -1; }
+static void BMK_sdCountersClose(BMK_sdCounters_t* pc, double counts[BMK_SD_NBCOUNTERS])
+{ int n; (void)pc; for (n=0; n<BMK_SD_NBCOUNTERS; n++) counts[n] = -1.; }
+#  define BMK_sdCountersStart(pc) do { (void)(pc); } while (0)
+#endif
+
+typedef enum { sd_attach, sd_block, sd_frame } BMK_sdApi_e;
+
+typedef struct {
+    /* shared, read-only */
+    const char* src;
+    size_t srcSize;
+    size_t msgSize;
+    int cLevel;
+    const char* dictBuf;
+    int dictSize;
+    const LZ4_stream_t* dictStream;
+    const LZ4_streamHC_t* dictStreamHC;
+    const LZ4F_CDict* cdict;
+    const LZ4F_preferences_t* prefs;
+    BMK_sdApi_e api;
+    Duration_ns minDuration;
+    /* own range of messages */
+    size_t firstMsg;
+    size_t nbMsgs;
+    /* results */
+    U64 nbCalls;
+    U64 nbBytes;
+    U64 rSize;      /* size of own range */
+    U64 cSize;      /* compressed size of own range */
+    Duration_ns duration;
+    double counts[BMK_SD_NBCOUNTERS];
+    int error;
+} BMK_sdJob_t;
+
+/* BMK_sdThreadJob() :
+ * each thread owns its compression state and output buffer,
+ * while source, dictionary and CDict are shared and only read.
+ * First pass warms up caches and verifies results, it is not measured. */
+static void BMK_sdThreadJob(void* arg)
+{
+    BMK_sdJob_t* const job = (BMK_sdJob_t*)arg;
+    int const useHC = (job->cLevel >= LZ4HC_CLEVEL_MIN);
+    int const acceleration = (job->cLevel < 0) ? -job->cLevel + 1 : 1;
+    size_t const cCap = MAX((size_t)LZ4_compressBound((int)job->msgSize), LZ4F_compressFrameBound(job->msgSize, job->prefs));
+    char* const cBuf = (char*)malloc(cCap);
+    char* const resBuf = (char*)malloc(job->msgSize);
+    LZ4_stream_t* const stream = useHC ? NULL : LZ4_createStream();
+    LZ4_streamHC_t* const streamHC = useHC ? LZ4_createStreamHC() : NULL;
+    LZ4F_cctx* cctx = NULL;
+    LZ4F_dctx* dctx = NULL;
+    BMK_sdCounters_t pc;
+    TIME_t timeStart = TIME_getTime();
+    U64 nbPasses = 0;
+    int pass;
+
+    job->rSize = job->cSize = 0;
+    if ( !cBuf || !resBuf || (useHC ? !streamHC : !stream)
+      || LZ4F_isError(LZ4F_createCompressionContext(&cctx, LZ4F_VERSION))
+      || LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)) ) {
+        job->error = 1;
+    }
+    BMK_sdCountersOpen(&pc);
+
+    for (pass = -1; !job->error; pass++) {
+        size_t n;
+        if (pass == 0) {
+            timeStart = TIME_getTime();
+            BMK_sdCountersStart(&pc);
+        }
+        for (n = job->firstMsg; n < job->firstMsg + job->nbMsgs; n++) {
+            const char* const msg = job->src + n * job->msgSize;
+            size_t const msgSize = MIN(job->msgSize, job->srcSize - n * job->msgSize);
+            size_t cSize = 0;
+            if (job->api != sd_frame) {
+                if (useHC) {
+                    LZ4_resetStreamHC_fast(streamHC, job->cLevel);
+                    LZ4_attach_HC_dictionary(streamHC, job->dictStreamHC);
+                } else {
+                    LZ4_resetStream_fast(stream);
+                    LZ4_attach_dictionary(stream, job->dictStream);
+            }   }
+            if (job->api == sd_block) {
+                int const r = useHC ?
+                    LZ4_compress_HC_continue(streamHC, msg, cBuf, (int)msgSize, (int)cCap) :
+                    LZ4_compress_fast_continue(stream, msg, cBuf, (int)msgSize, (int)cCap, acceleration);
+                if (r <= 0) { job->error = 1; break; }
+                cSize = (size_t)r;
+            }
+            if (job->api == sd_frame) {
+                cSize = LZ4F_compressFrame_usingCDict(cctx, cBuf, cCap, msg, msgSize, job->cdict, job->prefs);
+                if (LZ4F_isError(cSize)) { job->error = 1; break; }
+            }
+            if (pass < 0 && job->api != sd_attach) {
+                /* verify round trip */
+                size_t rSize = job->msgSize;
+                if (job->api == sd_block) {
+                    int const r = LZ4_decompress_safe_usingDict(cBuf, resBuf, (int)cSize, (int)job->msgSize, job->dictBuf, job->dictSize);
+                    rSize = (r < 0) ? 0 : (size_t)r;
+                } else {
+                    size_t srcSize = cSize;
+                    LZ4F_decompressOptions_t dOpt = { 1, 0, 0, 0 };
+                    size_t const r = LZ4F_decompress_usingDict(dctx, resBuf, &rSize, cBuf, &srcSize,
+                                                job->dictBuf, (size_t)job->dictSize, &dOpt);
+                    if (r != 0 || srcSize != cSize) rSize = 0;
+                }
+                if (rSize != msgSize || memcmp(resBuf, msg, msgSize)) { job->error = 1; break; }
+                job->rSize += msgSize;
+                job->cSize += cSize;
+            }
+        }
+        if (pass >= 0) {
+            nbPasses++;
+            if (TIME_clockSpan_ns(timeStart) >= job->minDuration) break;
+        }
+    }
+    job->duration = TIME_clockSpan_ns(timeStart);
+    BMK_sdCountersClose(&pc, job->counts);
+    job->nbCalls = nbPasses * job->nbMsgs;
+    job->nbBytes = nbPasses * job->rSize;
+
+    LZ4_freeStream(stream);
+    LZ4_freeStreamHC(streamHC);
+    LZ4F_freeCompressionContext(cctx);
+    LZ4F_freeDecompressionContext(dctx);
+    free(cBuf);
+    free(resBuf);
+}
+
+/*! BMK_benchSharedDict() :
+ *  Cuts input into messages of g_sharedDictMsgSize bytes,
+ *  and measures 1, 2, 4, ... up to g_nbThreads threads compressing their own range of messages concurrently,
+ *  all of them referencing the same dictionary state, created once :
+ *  LZ4_attach_dictionary() or LZ4_attach_HC_dictionary() for blocks, LZ4F_CDict for frames.
+ *  "attach" only measures state reset and dictionary attachment, without compression.
+ *  Efficiency compares aggregated speed with single-thread speed multiplied by nb of threads :
+ *  any contention on shared dictionary tables shows up as lower efficiency, and more cache misses per message. */
+static int BMK_benchSharedDict(const void* srcBuffer, size_t srcSize,
+                               const char* displayName, int cLevel,
+                               const char* dictBuf, int dictSize)
+{
+    int const useHC = (cLevel >= LZ4HC_CLEVEL_MIN);
+    static const char* const apiNames[] = { "attach", "block", "frame" };
+    size_t const msgSize = MIN(g_sharedDictMsgSize, srcSize);
+    size_t const nbMsgs = (srcSize + msgSize - 1) / msgSize;
+    BMK_sdJob_t* const jobs = (BMK_sdJob_t*)calloc(g_nbThreads, sizeof(BMK_sdJob_t));
+    LZ4_stream_t* dictStream = NULL;
+    LZ4_streamHC_t* dictStreamHC = NULL;
+    LZ4F_CDict* const cdict = LZ4F_createCDict(dictBuf, (size_t)dictSize);
+    LZ4F_preferences_t prefs;
+    int api;
+
+    assert(dictSize > 0);
+    if (strlen(displayName)>17) displayName += strlen(displayName)-17;   /* can only display 17 characters */
+    if (useHC) {
+        dictStreamHC = LZ4_createStreamHC();
+        if (dictStreamHC) {
+            LZ4_resetStreamHC_fast(dictStreamHC, cLevel);
+            LZ4_loadDictHC(dictStreamHC, dictBuf, dictSize);
+        }
+    } else {
+        dictStream = LZ4_createStream();
+        if (dictStream) LZ4_loadDict(dictStream, dictBuf, dictSize);
+    }
+    if (!jobs || !cdict || (useHC ? !dictStreamHC : !dictStream))
+        END_PROCESS(44, "allocation error : not enough memory");
+
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.compressionLevel = cLevel;
+    prefs.frameInfo.blockMode = g_blockLinked ? LZ4F_blockLinked : LZ4F_blockIndependent;
+    prefs.frameInfo.blockChecksumFlag = g_blockChecksum ? LZ4F_blockChecksumEnabled : LZ4F_noBlockChecksum;
+    prefs.frameInfo.contentChecksumFlag = g_skipChecksums ? LZ4F_noContentChecksum : LZ4F_contentChecksumEnabled;
+    prefs.frameInfo.contentSize = (unsigned long long)g_contentSize;   /* replaced by actual size */
+
+    DISPLAYLEVEL(2, "%-17.17s : %u bytes, level %i, %u messages of %u bytes, shared dictionary of %u bytes \n",
+                displayName, (U32)srcSize, cLevel, (U32)nbMsgs, (U32)msgSize, (U32)dictSize);
+    DISPLAYLEVEL(2, "API    threads :      msg/s (per thread)     MB/s   eff.   ns/msg  ratio |");
+    {   int c; for (c=0; c<BMK_SD_NBCOUNTERS; c++) DISPLAYLEVEL(2, " %12s", g_sdCounterNames[c]); }
+    DISPLAYLEVEL(2, " \n");
+
+    for (api = sd_attach; api <= sd_frame; api++) {
+        double rate1 = 0.;
+        unsigned nbThreads, n;
+        for (nbThreads = 1; ; nbThreads = MIN(nbThreads * 2, g_nbThreads)) {
+            TPOOL_ctx* const pool = TPOOL_create((int)nbThreads, (int)nbThreads);
+            double rate = 0., speed = 0., nsPerMsg = 0.;
+            double counts[BMK_SD_NBCOUNTERS] = { 0 };
+            U64 nbCalls = 0, cSize = 0, rSize = 0;
+            if (pool == NULL) END_PROCESS(32, "could not create thread pool");
+            for (n=0; n<nbThreads; n++) {
+                BMK_sdJob_t* const job = jobs + n;
+                memset(job, 0, sizeof(*job));
+                job->src = (const char*)srcBuffer;
+                job->srcSize = srcSize;
+                job->msgSize = msgSize;
+                job->cLevel = cLevel;
+                job->dictBuf = dictBuf;
+                job->dictSize = dictSize;
+                job->dictStream = dictStream;
+                job->dictStreamHC = dictStreamHC;
+                job->cdict = cdict;
+                job->prefs = &prefs;
+                job->api = (BMK_sdApi_e)api;
+                job->minDuration = (Duration_ns)g_nbSeconds * TIMELOOP_NANOSEC;
+                if (nbMsgs >= nbThreads) {
+                    job->firstMsg = (size_t)(((U64)nbMsgs * n) / nbThreads);
+                    job->nbMsgs = (size_t)(((U64)nbMsgs * (n+1)) / nbThreads) - job->firstMsg;
+                } else {
+                    job->firstMsg = 0;   /* not enough messages : all threads compress all messages */
+                    job->nbMsgs = nbMsgs;
+                }
+                TPOOL_submitJob(pool, BMK_sdThreadJob, job);
+            }
+            TPOOL_completeJobs(pool);
+            TPOOL_free(pool);
+
+            for (n=0; n<nbThreads; n++) {
+                const BMK_sdJob_t* const job = jobs + n;
+                double const duration = (double)(job->duration + !job->duration);
+                int c;
+                if (job->error) END_PROCESS(45, "%s failed in thread %u", apiNames[api], n);
+                rate += (double)job->nbCalls / duration;
+                speed += (double)job->nbBytes / duration;
+                nsPerMsg += duration / (double)(job->nbCalls + !job->nbCalls) / nbThreads;
+                nbCalls += job->nbCalls;
+                rSize += job->rSize;
+                cSize += job->cSize;
+                for (c=0; c<BMK_SD_NBCOUNTERS; c++) {
+                    if (job->counts[c] < 0 || counts[c] < 0) counts[c] = -1.;
+                    else counts[c] += job->counts[c];
+            }   }
+            if (nbThreads == 1) rate1 = rate;
+
+            DISPLAYLEVEL(2, "%-6s %7u : %10.0f (%10.0f) ", apiNames[api], nbThreads, rate * 1000000000., rate * 1000000000. / nbThreads);
+            if (api == sd_attach) {
+                DISPLAYLEVEL(2, "%8s %5.1f%% %8.0f %6s", "-", 100. * rate / (rate1 * nbThreads), nsPerMsg, "-");
+            } else {
+                DISPLAYLEVEL(2, "%8.1f %5.1f%% %8.0f %6.3f", speed * 1000, 100. * rate / (rate1 * nbThreads), nsPerMsg,
+                            (double)rSize / (double)(cSize + !cSize));
+            }
+            DISPLAYLEVEL(2, " |");
+            {   int c;
+                for (c=0; c<BMK_SD_NBCOUNTERS; c++) {
+                    if (counts[c] < 0) {
+                        DISPLAYLEVEL(2, " %12s", "n/a");
+                    } else {
+                        DISPLAYLEVEL(2, " %12.1f", counts[c] / (double)(nbCalls + !nbCalls));
+            }   }   }
+            DISPLAYLEVEL(2, " \n");
+            if (nbThreads == g_nbThreads) break;
+        }
+    }
+
+    LZ4_freeStream(dictStream);
+    LZ4_freeStreamHC(dictStreamHC);
+    LZ4F_freeCDict(cdict);
+    free(jobs);
+    return 0;
+}
+
+
 static size_t BMK_findMaxMem(U64 requiredMem)
 {
     size_t step = 64 MB;
@@ -650,12 +1897,34 @@ static int BMK_benchCLevel(void* srcBuffer, size_t benchedSize,
 
     SET_REALTIME_PRIORITY;
 
-    if (g_displayLevel == 1 && !g_additionalParam)
+    if (g_displayLevel == 1 && !g_additionalParam && g_outputFormat == BMK_format_text)
         DISPLAY("bench %s %s: input %u bytes, %u seconds, %u KB blocks\n", LZ4_VERSION_STRING, LZ4_GIT_COMMIT_STRING, (U32)benchedSize, g_nbSeconds, (U32)(g_blockSize>>10));
 
     if (cLevelLast < cLevel) cLevelLast = cLevel;
 
     for (l=cLevel; l <= cLevelLast; l++) {
+        if (g_sharedDictMsgSize) {
+            benchError |= BMK_benchSharedDict(
+                            srcBuffer, benchedSize,
+                            displayName, l,
+                            dictBuf, dictSize);
+            continue;
+        }
+        if (g_latencyMsgSize) {
+            benchError |= BMK_benchLatency(
+                            srcBuffer, benchedSize,
+                            displayName, l,
+                            dictBuf, dictSize);
+            continue;
+        }
+        if (g_nbThreads > 1) {
+            benchError |= BMK_benchMemMT(
+                            srcBuffer, benchedSize,
+                            displayName, l,
+                            fileSizes, nbFiles,
+                            dictBuf, dictSize);
+            continue;
+        }
         benchError |= BMK_benchMem(
                             srcBuffer, benchedSize,
                             displayName, l,
@@ -802,6 +2071,29 @@ int BMK_benchFiles(const char** fileNamesTable, unsigned nbFiles,
     size_t dictSize = 0;
 
     if (cLevel > LZ4HC_CLEVEL_MAX) cLevel = LZ4HC_CLEVEL_MAX;
+    if (g_nbThreads > 1) {
+#if LZ4IO_MULTITHREAD
+        if (g_decodeOnly) {
+            DISPLAYLEVEL(2, "warning : decode-only benchmark is single-threaded \n");
+            g_nbThreads = 1;
+        }
+#else
+        DISPLAYLEVEL(2, "warning : this executable doesn't support multithreading, benchmark is single-threaded \n");
+        g_nbThreads = 1;
+#endif
+    }
+    if (g_latencyMsgSize) {
+        if (g_decodeOnly) END_PROCESS(27, "Error : latency benchmark not compatible with decode-only mode");
+        if (g_nbThreads > 1) DISPLAYLEVEL(2, "warning : latency benchmark is single-threaded \n");
+        g_nbThreads = 1;
+        g_frameMode = 0;   /* frames are measured anyway */
+    }
+    if (g_sharedDictMsgSize) {
+        if (g_decodeOnly) END_PROCESS(27, "Error : shared dictionary benchmark not compatible with decode-only mode");
+        if (g_latencyMsgSize) END_PROCESS(27, "Error : shared dictionary benchmark not compatible with latency benchmark");
+        if (!dictFileName) END_PROCESS(27, "Error : shared dictionary benchmark requires a dictionary (-D)");
+        g_frameMode = 0;   /* frames are measured anyway */
+    }
     if (g_decodeOnly) {
         DISPLAYLEVEL(2, "Benchmark Decompression of LZ4 Frame ");
         if (g_skipChecksums) {
@@ -845,6 +2137,18 @@ int BMK_benchFiles(const char** fileNamesTable, unsigned nbFiles,
         fclose(dictFile);
     }
 
+    if (g_frameMode) {
+        DISPLAYLEVEL(2, "Benchmark LZ4 Frame : %s blocks%s%s%s%s \n",
+                    g_blockLinked ? "linked" : "independent",
+                    g_blockChecksum ? ", block checksums" : "",
+                    g_skipChecksums ? "" : ", content checksum",
+                    g_contentSize ? ", content size" : "",
+                    dictSize ? ", dictionary" : "");
+        if (dictSize) {
+            g_ddict = LZ4F_createDDict(dictBuf, dictSize);
+            if (g_ddict == NULL) END_PROCESS(25, "Allocation error : not enough memory");
+    }   }
+
     if (nbFiles == 0) {
         benchError = BMK_syntheticTest(cLevel, cLevelLast, dictBuf, (int)dictSize);
     } else {
@@ -854,6 +2158,8 @@ int BMK_benchFiles(const char** fileNamesTable, unsigned nbFiles,
             benchError = BMK_benchFileTable(fileNamesTable, nbFiles, cLevel, cLevelLast, dictBuf, (int)dictSize);
     }
 
+    LZ4F_freeDDict(g_ddict);
+    g_ddict = NULL;
     free(dictBuf);
     return benchError;
 }
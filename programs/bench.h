@@ -48,6 +48,16 @@ void BMK_setNotificationLevel(unsigned level);  /* Influence verbosity level */
 void BMK_setBenchSeparately(int separate);  /* When providing multiple files, output one result per file */
 void BMK_setDecodeOnlyMode(int set);        /* v1.9.4+: set benchmark mode to decode only */
 void BMK_skipChecksums(int skip);           /* v1.9.4+: only useful for DecodeOnlyMode; do not calculate checksum when present, to save CPU time */
+void BMK_setNbThreads(unsigned nbThreads);  /* > 1 : measure scaling, from 1 thread up to nbThreads running concurrently */
+void BMK_setReplicate(int replicate);       /* multi-threaded mode : each thread benchmarks its own copy of input, instead of its own range of blocks */
+void BMK_setFrameMode(int set);             /* benchmark LZ4 Frame compression and decompression, as done by `lz4`, one frame per file */
+void BMK_setBlockLinked(int linked);        /* frame mode : blocks are linked (default: independent) */
+void BMK_setBlockChecksum(int enable);      /* frame mode : add block checksums (default: disabled) */
+void BMK_setContentSize(int enable);        /* frame mode : frame header includes content size (default: disabled) */
+void BMK_setLatencyMode(size_t msgSize);    /* > 0 : measure latency of each call on messages of msgSize bytes, instead of throughput */
+void BMK_setSharedDictMode(size_t msgSize); /* > 0 : threads compress messages of msgSize bytes concurrently, using one shared dictionary (requires a dictionary) */
+typedef enum { BMK_format_text, BMK_format_json, BMK_format_csv } BMK_outputFormat_e;
+void BMK_setOutputFormat(BMK_outputFormat_e format);  /* json, csv : also write one record per result on stdout, for scripts (not in latency mode) */
 
 void BMK_setAdditionalParam(int additionalParam); /* hidden param, influence output format, for python parsing */
 
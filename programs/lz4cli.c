@@ -51,6 +51,7 @@
 #include "bench.h"    /* BMK_benchFile, BMK_SetNbIterations, BMK_SetBlocksize, BMK_SetPause */
 #include "lz4io.h"    /* LZ4IO_compressFilename, LZ4IO_decompressFilename, LZ4IO_compressMultipleFilenames */
 #include "lz4hc.h"    /* LZ4HC_CLEVEL_MAX */
+#include "lz4dict.h"  /* LZ4DICT_SIZE_MAX */
 #include "lz4.h"      /* LZ4_VERSION_STRING */
 
 
@@ -131,7 +132,7 @@ static int usage(const char* exeName)
     DISPLAY( "Arguments : \n");
     DISPLAY( " -1     : fast compression (default) \n");
     DISPLAY( " -%2d    : slowest compression level \n", LZ4HC_CLEVEL_MAX);
-    DISPLAY( " -T#    : use # threads for compression (default:%i==auto) \n", LZ4_NBWORKERS_DEFAULT);
+    DISPLAY( " -T#    : use # threads (default:%i==auto) \n", LZ4_NBWORKERS_DEFAULT);
     DISPLAY( " -d     : decompression (default for %s extension)\n", LZ4_EXTENSION);
     DISPLAY( " -f     : overwrite output without prompting \n");
     DISPLAY( " -k     : preserve source files(s)  (default) \n");
@@ -158,6 +159,9 @@ static int usage_advanced(const char* exeName)
     DISPLAY( " -l     : compress using Legacy format (Linux kernel compression)\n");
     DISPLAY( " -z     : force compression \n");
     DISPLAY( " -D FILE: use FILE as dictionary (compression & decompression)\n");
+    DISPLAY( "--train FILES : build a dictionary from sample FILES, saved into -D FILE \n");
+    DISPLAY( "--maxdict=# : max size of trained dictionary (default: %i) \n", LZ4DICT_SIZE_MAX);
+    DISPLAY( "--merge=FILE : merge frames of input FILES into a single frame, without recompression \n");
     DISPLAY( " -B#    : cut file into blocks of size # bytes [32+] \n");
     DISPLAY( "                     or predefined block size [4-7] (default: %i) \n", LZ4_BLOCKSIZEID_DEFAULT);
     DISPLAY( " -BI    : Block Independence (default) \n");
@@ -166,14 +170,31 @@ static int usage_advanced(const char* exeName)
     DISPLAY( "--no-frame-crc : disable stream checksum (default:enabled) \n");
     DISPLAY( "--content-size : compressed frame includes original size (default:not present)\n");
     DISPLAY( "--list FILE : lists information about .lz4 files (useful for files compressed with --content-size flag)\n");
+    DISPLAY( "--json : --list output in JSON format \n");
     DISPLAY( "--[no-]sparse  : sparse mode (default:enabled on file, disabled on stdout)\n");
     DISPLAY( "--favor-decSpeed: compressed files decompress faster, but are less compressed \n");
+    DISPLAY( "--skip-incompressible: store blocks which look incompressible without trying (levels 2+) \n");
+    DISPLAY( "--adapt[=min=#,max=#]: adjust compression level to I/O speed (default: %i-%i) \n", 1, LZ4HC_CLEVEL_MAX);
+    DISPLAY( "--seekable: append a block index, for multi-threaded decompression \n");
+    DISPLAY( "--numa  : distribute threads across NUMA nodes (see -T#) \n");
+    DISPLAY( "--stats : report busy time of each stage (read, codec, checksum, write) \n");
+    DISPLAY( "--direct-io: compress without going through page cache (O_DIRECT) \n");
+    DISPLAY( "--rsyncable : compress in a way friendly to rsync and deduplication \n");
+    DISPLAY( "--append : continue last frame of existing output file, instead of overwriting it \n");
+    DISPLAY( "--max-memory=# : limit memory of multi-threaded compression to # bytes (default: no limit) \n");
+    DISPLAY( "--flush-interval=# : from a pipe, output data within # ms of its arrival (default: disabled) \n");
     DISPLAY( "--fast[=#]: switch to ultra fast compression level (default: %i)\n", 1);
     DISPLAY( "--best  : same as -%d\n", LZ4HC_CLEVEL_MAX);
     DISPLAY( "Benchmark arguments : \n");
     DISPLAY( " -b#    : benchmark file(s), using # compression level (default : 1) \n");
     DISPLAY( " -e#    : test all compression levels from -bX to # (default : 1)\n");
     DISPLAY( " -i#    : minimum evaluation time in seconds (default : 3s) \n");
+    DISPLAY( " -T#    : measure scaling, from 1 to # concurrent threads \n");
+    DISPLAY( "--bench-replicate: with -T#, each thread benchmarks its own copy of input \n");
+    DISPLAY( "--bench-frame: benchmark LZ4 Frame format, using -B#, -BD, -BX, --content-size, --no-frame-crc and -D \n");
+    DISPLAY( "--bench-latency=#: per call latency percentiles on messages of # bytes (-v: histograms) \n");
+    DISPLAY( "--bench-shared-dict=#: with -D and -T#, threads compress messages of # bytes using one shared dictionary \n");
+    DISPLAY( "--bench-format=json|csv: also write one record per result on stdout \n");
     if (g_lz4c_legacy_commands) {
         DISPLAY( "Legacy arguments : \n");
         DISPLAY( " -c0    : fast compression \n");
@@ -340,7 +361,7 @@ static int longCommandWArg(const char** stringPtr, const char* longCommand)
     return result;
 }
 
-typedef enum { om_auto, om_compress, om_decompress, om_test, om_bench, om_list } operationMode_e;
+typedef enum { om_auto, om_compress, om_decompress, om_test, om_bench, om_list, om_train, om_merge } operationMode_e;
 
 /** determineOpMode() :
  *  auto-determine operation mode, based on input filename extension
@@ -361,6 +382,7 @@ int main(int argCount, const char** argv)
         cLevel=1,
         cLevelLast=-10000,
         legacy_format=0,
+        appendMode=0,
         forceStdout=0,
         forceOverwrite=0,
         main_pause=0,
@@ -368,6 +390,8 @@ int main(int argCount, const char** argv)
         all_arguments_are_files=0,
         operationResult=0;
     unsigned nbWorkers = LZ4_NBWORKERS_DEFAULT;
+    int nbWorkersSet = 0;
+    unsigned maxDictSize = LZ4DICT_SIZE_MAX;
     operationMode_e mode = om_auto;
     const char* input_filename = NULL;
     const char* output_filename= NULL;
@@ -441,13 +465,24 @@ int main(int argCount, const char** argv)
                     || (!strcmp(argument, "--to-stdout"))) { forceStdout=1; output_filename=stdoutmark; continue; }
                 if (!strcmp(argument,  "--frame-crc")) { LZ4IO_setStreamChecksumMode(prefs, 1); BMK_skipChecksums(0); continue; }
                 if (!strcmp(argument,  "--no-frame-crc")) { LZ4IO_setStreamChecksumMode(prefs, 0); BMK_skipChecksums(1); continue; }
-                if (!strcmp(argument,  "--no-crc")) { LZ4IO_setStreamChecksumMode(prefs, 0); LZ4IO_setBlockChecksumMode(prefs, 0); BMK_skipChecksums(1); continue; }
-                if (!strcmp(argument,  "--content-size")) { LZ4IO_setContentSize(prefs, 1); continue; }
-                if (!strcmp(argument,  "--no-content-size")) { LZ4IO_setContentSize(prefs, 0); continue; }
+                if (!strcmp(argument,  "--no-crc")) { LZ4IO_setStreamChecksumMode(prefs, 0); LZ4IO_setBlockChecksumMode(prefs, 0); BMK_skipChecksums(1); BMK_setBlockChecksum(0); continue; }
+                if (!strcmp(argument,  "--content-size")) { LZ4IO_setContentSize(prefs, 1); BMK_setContentSize(1); continue; }
+                if (!strcmp(argument,  "--no-content-size")) { LZ4IO_setContentSize(prefs, 0); BMK_setContentSize(0); continue; }
                 if (!strcmp(argument,  "--list")) { mode = om_list; continue; }
+                if (!strcmp(argument,  "--json")) { LZ4IO_setListJSON(prefs, 1); continue; }
+                if (!strcmp(argument,  "--train")) { mode = om_train; multiple_inputs = 1; continue; }
                 if (!strcmp(argument,  "--sparse")) { LZ4IO_setSparseFile(prefs, 2); continue; }
                 if (!strcmp(argument,  "--no-sparse")) { LZ4IO_setSparseFile(prefs, 0); continue; }
                 if (!strcmp(argument,  "--favor-decSpeed")) { LZ4IO_favorDecSpeed(prefs, 1); continue; }
+                if (!strcmp(argument,  "--skip-incompressible")) { LZ4IO_skipIncompressible(prefs, 1); continue; }
+                if (!strcmp(argument,  "--seekable")) { LZ4IO_setSeekable(prefs, 1); continue; }
+                if (!strcmp(argument,  "--numa")) { LZ4IO_setNumaAware(prefs, 1); continue; }
+                if (!strcmp(argument,  "--stats")) { LZ4IO_setStats(prefs, 1); continue; }
+                if (!strcmp(argument,  "--direct-io")) { LZ4IO_setDirectIO(prefs, 1); continue; }
+                if (!strcmp(argument,  "--rsyncable")) { LZ4IO_setRsyncable(prefs, 1); continue; }
+                if (!strcmp(argument,  "--append")) { LZ4IO_setAppend(prefs, 1); appendMode = 1; continue; }
+                if (!strcmp(argument,  "--bench-replicate")) { BMK_setReplicate(1); continue; }
+                if (!strcmp(argument,  "--bench-frame")) { BMK_setFrameMode(1); continue; }
                 if (!strcmp(argument,  "--verbose")) { displayLevel++; continue; }
                 if (!strcmp(argument,  "--quiet")) { if (displayLevel) displayLevel--; continue; }
                 if (!strcmp(argument,  "--version")) { DISPLAYOUT(WELCOME_MESSAGE); goto _cleanup; }
@@ -457,6 +492,67 @@ int main(int argCount, const char** argv)
 
                 if (longCommandWArg(&argument, "--threads")) {
                     NEXT_UINT32(nbWorkers);
+                    nbWorkersSet = 1;
+                    continue;
+                }
+                if (longCommandWArg(&argument, "--bench-format=")) {
+                    if (!strcmp(argument, "json")) { BMK_setOutputFormat(BMK_format_json); continue; }
+                    if (!strcmp(argument, "csv")) { BMK_setOutputFormat(BMK_format_csv); continue; }
+                    if (!strcmp(argument, "text")) { BMK_setOutputFormat(BMK_format_text); continue; }
+                    badusage(exeName);
+                }
+                if (longCommandWArg(&argument, "--bench-latency")) {
+                    U32 msgSize;
+                    NEXT_UINT32(msgSize);
+                    if (msgSize == 0) badusage(exeName);
+                    BMK_setLatencyMode(msgSize);
+                    continue;
+                }
+                if (longCommandWArg(&argument, "--bench-shared-dict")) {
+                    U32 msgSize;
+                    NEXT_UINT32(msgSize);
+                    if (msgSize == 0) badusage(exeName);
+                    BMK_setSharedDictMode(msgSize);
+                    continue;
+                }
+                if (longCommandWArg(&argument, "--merge=")) {
+                    mode = om_merge;
+                    multiple_inputs = 1;
+                    output_filename = argument;
+                    continue;
+                }
+                if (longCommandWArg(&argument, "--max-memory")) {
+                    U32 maxMemory;
+                    NEXT_UINT32(maxMemory);
+                    LZ4IO_setMaxMemory(prefs, maxMemory);
+                    continue;
+                }
+                if (longCommandWArg(&argument, "--flush-interval")) {
+                    U32 interval;
+                    NEXT_UINT32(interval);
+                    LZ4IO_setFlushInterval(prefs, interval);
+                    continue;
+                }
+                if (longCommandWArg(&argument, "--maxdict")) {
+                    NEXT_UINT32(maxDictSize);
+                    if (maxDictSize > LZ4DICT_SIZE_MAX) maxDictSize = LZ4DICT_SIZE_MAX;
+                    continue;
+                }
+                if (longCommandWArg(&argument, "--adapt")) {
+                    /* Parse optional level range */
+                    unsigned minLevel = 1, maxLevel = LZ4HC_CLEVEL_MAX;
+                    if (*argument == '=') {
+                        do {
+                            argument++;
+                            if (longCommandWArg(&argument, "min=")) { minLevel = readU32FromChar(&argument); continue; }
+                            if (longCommandWArg(&argument, "max=")) { maxLevel = readU32FromChar(&argument); continue; }
+                            badusage(exeName);
+                        } while (*argument == ',');
+                    }
+                    if (*argument != 0 || minLevel == 0
+                      || !LZ4IO_setAdaptiveLevel(prefs, 1, (int)minLevel, (int)maxLevel)) {
+                        badusage(exeName);
+                    }
                     continue;
                 }
                 if (longCommandWArg(&argument, "--fast")) {
@@ -518,10 +614,11 @@ int main(int argCount, const char** argv)
                     /* Compression (default) */
                 case 'z': mode = om_compress; break;
 
-                    /* Modify Nb Worker threads (compression only) */
+                    /* Modify Nb Worker threads */
                 case 'T':
                     {   argument++;
                         nbWorkers = readU32FromChar(&argument);
+                        nbWorkersSet = 1;
                         argument--;
                     }
                     break;
@@ -579,9 +676,9 @@ int main(int argCount, const char** argv)
                         int exitBlockProperties=0;
                         switch(argument[1])
                         {
-                        case 'D': LZ4IO_setBlockMode(prefs, LZ4IO_blockLinked); argument++; break;
-                        case 'I': LZ4IO_setBlockMode(prefs, LZ4IO_blockIndependent); argument++; break;
-                        case 'X': LZ4IO_setBlockChecksumMode(prefs, 1); argument ++; break;   /* disabled by default */
+                        case 'D': LZ4IO_setBlockMode(prefs, LZ4IO_blockLinked); BMK_setBlockLinked(1); argument++; break;
+                        case 'I': LZ4IO_setBlockMode(prefs, LZ4IO_blockIndependent); BMK_setBlockLinked(0); argument++; break;
+                        case 'X': LZ4IO_setBlockChecksumMode(prefs, 1); BMK_setBlockChecksum(1); argument ++; break;   /* disabled by default */
                         default :
                             if (argument[1] < '0' || argument[1] > '9') {
                                 exitBlockProperties=1;
@@ -707,6 +804,20 @@ int main(int argCount, const char** argv)
 #endif
     }
 
+    if (mode == om_train) {
+        if (!dictionary_filename) {
+            DISPLAYLEVEL(1, "error: --train requires a destination dictionary (-D FILE) \n");
+            CLEAN_RETURN(1);
+        }
+        if (ifnIdx == 0) {
+            DISPLAYLEVEL(1, "error: --train requires sample files \n");
+            CLEAN_RETURN(1);
+        }
+        LZ4IO_setNotificationLevel((int)displayLevel);
+        operationResult = LZ4IO_trainDictionary(dictionary_filename, inFileNames, (int)ifnIdx, (int)maxDictSize, prefs);
+        goto _cleanup;
+    }
+
     if (dictionary_filename) {
         if (!strcmp(dictionary_filename, stdinmark) && IS_CONSOLE(stdin)) {
             DISPLAYLEVEL(1, "refusing to read from a console\n");
@@ -715,9 +826,25 @@ int main(int argCount, const char** argv)
         LZ4IO_setDictionaryFilename(prefs, dictionary_filename);
     }
 
+    if (mode == om_merge) {
+        if (ifnIdx == 0) {
+            DISPLAYLEVEL(1, "error: --merge requires compressed files \n");
+            CLEAN_RETURN(1);
+        }
+        if (!strcmp(output_filename, stdoutmark) && IS_CONSOLE(stdout) && !forceStdout) {
+            DISPLAYLEVEL(1, "refusing to write to console without -c \n");
+            CLEAN_RETURN(1);
+        }
+        LZ4IO_setNotificationLevel((int)displayLevel);
+        operationResult = LZ4IO_mergeFrames(output_filename, inFileNames, (int)ifnIdx, prefs);
+        goto _cleanup;
+    }
+
     /* benchmark and test modes */
     if (mode == om_bench) {
         BMK_setNotificationLevel(displayLevel);
+        if (nbWorkersSet)   /* scaling benchmark, only when explicitly requested */
+            BMK_setNbThreads(nbWorkers ? nbWorkers : (unsigned)LZ4IO_defaultNbWorkers());
         operationResult = BMK_benchFiles(inFileNames, ifnIdx, cLevel, cLevelLast, dictionary_filename);
         goto _cleanup;
     }
@@ -811,6 +938,14 @@ int main(int argCount, const char** argv)
     /* IO Stream/File */
     LZ4IO_setNotificationLevel((int)displayLevel);
     if (ifnIdx == 0) multiple_inputs = 0;
+#if LZ4IO_MULTITHREAD
+    if (nbWorkers != 1) {
+        if (nbWorkers==0)
+            nbWorkers = (unsigned)LZ4IO_defaultNbWorkers();
+        DISPLAYLEVEL(3, "Using %u threads \n", nbWorkers);
+    }
+    LZ4IO_setNbWorkers(prefs, (int)nbWorkers);
+#endif
     if (mode == om_decompress) {
         if (multiple_inputs) {
             const char* dec_extension = LZ4_EXTENSION;
@@ -822,16 +957,12 @@ int main(int argCount, const char** argv)
             operationResult = DEFAULT_DECOMPRESSOR(input_filename, output_filename, prefs);
         }
     } else if (mode == om_list){
-        operationResult = LZ4IO_displayCompressedFilesInfo(inFileNames, ifnIdx);
+        operationResult = LZ4IO_displayCompressedFilesInfo(inFileNames, ifnIdx, prefs);
     } else {   /* compression is default action */
-#if LZ4IO_MULTITHREAD
-        if (nbWorkers != 1) {
-            if (nbWorkers==0)
-                nbWorkers = (unsigned)LZ4IO_defaultNbWorkers();
-            DISPLAYLEVEL(3, "Using %u threads for compression \n", nbWorkers);
+        if (appendMode && (legacy_format || multiple_inputs)) {
+            DISPLAYLEVEL(1, "error: --append requires a single input, and frame format \n");
+            CLEAN_RETURN(1);
         }
-        LZ4IO_setNbWorkers(prefs, (int)nbWorkers);
-#endif
         if (legacy_format) {
             DISPLAYLEVEL(3, "! Generating LZ4 Legacy format (deprecated) ! \n");
             if(multiple_inputs){
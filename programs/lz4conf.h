@@ -32,6 +32,22 @@
 # define LZ4IO_MULTITHREAD 0
 #endif
 
+/* Determines if regular input files are memory-mapped, instead of read with fread()
+ * Only effective on POSIX systems
+ * Default: enabled */
+#ifndef LZ4IO_MMAP
+# define LZ4IO_MMAP 1
+#endif
+
+/* Determines if multithreaded compression uses asynchronous I/O :
+ * compressed chunks are written through io_uring, with several writes in flight,
+ * and memory-mapped input is read ahead.
+ * Only effective on Linux; falls back to fwrite() when io_uring is not available.
+ * Default: enabled */
+#ifndef LZ4IO_ASYNC_IO
+# define LZ4IO_ASYNC_IO 1
+#endif
+
 /* Determines default nb of threads for compression
  * Default value is 0, which means "auto" :
  * nb of threads is determined from detected local cpu.
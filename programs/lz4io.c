@@ -37,6 +37,9 @@
 #ifdef _MSC_VER    /* Visual Studio */
 #  pragma warning(disable : 4127)    /* disable: C4127: conditional expression is constant */
 #endif
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* syscall, for io_uring ; O_DIRECT */
+#endif
 #if defined(__MINGW32__) && !defined(_POSIX_SOURCE)
 #  define _POSIX_SOURCE 1          /* disable %llu warnings with MinGW on Windows */
 #endif
@@ -56,11 +59,15 @@
 #include <sys/stat.h>  /* stat64 */
 #include "lz4conf.h"   /* compile-time constants */
 #include "lz4io.h"
+#define LZ4_STATIC_LINKING_ONLY   /* LZ4_MULTIVERSION */
 #include "lz4.h"       /* required for legacy format */
 #include "lz4hc.h"     /* required for legacy format */
+#include "lz4dict.h"   /* LZ4_trainDictionary */
 #define LZ4F_STATIC_LINKING_ONLY
 #include "lz4frame.h"  /* LZ4F_* */
+#define XXH_STATIC_LINKING_ONLY   /* XXH32_multi */
 #include "xxhash.h"    /* frame checksum (MT mode) */
+#include "threadpool.h"  /* TPOOL_*, buffer pools */
 
 
 /*****************************
@@ -90,6 +97,8 @@
 
 #undef MIN
 #define MIN(a,b)  ((a)<(b)?(a):(b))
+#undef MAX
+#define MAX(a,b)  ((a)>(b)?(a):(b))
 
 /**************************************
 *  Time and Display
@@ -109,21 +118,58 @@ static int g_displayLevel = 0;   /* 0 : no display  ; 1: errors  ; 2 : + result
 static const Duration_ns refreshRate = 200000000;
 static TIME_t g_time = { 0 };
 
-static void LZ4IO_finalTimeDisplay(TIME_t timeStart, clock_t cpuStart, unsigned long long size)
+/* Per-stage statistics (--stats) :
+ * durations are "busy" times, summed over all threads running a stage.
+ * Each counter is updated by a single thread at any given time :
+ * parallel jobs hand their own durations over to the (single) write thread, which accumulates them. */
+typedef struct {
+    Duration_ns readTime;        /* input reads */
+    Duration_ns codecTime;       /* compression or decompression */
+    Duration_ns checksumTime;    /* content checksum, when processed separately from codec */
+    Duration_ns writerTime;      /* ordered writer, including out-of-order storage and output */
+    Duration_ns outputTime;      /* decoded output (LZ4IO_fwriteSparse) */
+    unsigned long long nbStalls; /* job submissions blocked by a full queue */
+    unsigned long long nbInlineJobs;  /* chunks compressed by the reader, because workers were all busy */
+    size_t maxBuffered;          /* peak nb of out-of-order blocks held in WriteRegister */
+    unsigned long long nbAllocs; /* chunk buffers allocated by pools (MT compression) */
+} LZ4IO_stats_t;
+static LZ4IO_stats_t g_stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static void LZ4IO_statsDisplay(Duration_ns duration_ns)
+{
+    double const wall = (double)(duration_ns + !duration_ns);
+#define LZ4IO_STAT_LINE(name, d) \
+    if (d) DISPLAYLEVEL(2, "%-15s: %8.3f s  (%5.1f%% of wall time) \n", name, (double)(d) / 1000000000., (double)(d) / wall * 100.)
+    DISPLAYLEVEL(2, "Stage statistics (busy time, summed over threads) : \n");
+    LZ4IO_STAT_LINE("read", g_stats.readTime);
+    LZ4IO_STAT_LINE("codec", g_stats.codecTime);
+    LZ4IO_STAT_LINE("checksum", g_stats.checksumTime);
+    LZ4IO_STAT_LINE("ordered writer", g_stats.writerTime);
+    LZ4IO_STAT_LINE("output", g_stats.outputTime);
+#undef LZ4IO_STAT_LINE
+    DISPLAYLEVEL(2, "%-15s: %llu \n", "queue stalls", g_stats.nbStalls);
+    DISPLAYLEVEL(2, "%-15s: %llu \n", "inline chunks", g_stats.nbInlineJobs);
+    DISPLAYLEVEL(2, "%-15s: %u \n", "peak buffered", (unsigned)g_stats.maxBuffered);
+    if (g_stats.nbAllocs) DISPLAYLEVEL(2, "%-15s: %llu \n", "buffer allocs", g_stats.nbAllocs);
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+static void LZ4IO_finalTimeDisplay(TIME_t timeStart, clock_t cpuStart, unsigned long long size, int stats)
 {
+    Duration_ns const duration_ns = TIME_clockSpan_ns(timeStart);
 #if LZ4IO_MULTITHREAD
     if (!TIME_support_MT_measurements()) {
         DISPLAYLEVEL(5, "time measurements not compatible with multithreading \n");
     } else
 #endif
     {
-        Duration_ns duration_ns = TIME_clockSpan_ns(timeStart);
         double const seconds = (double)(duration_ns + !duration_ns) / (double)1000000000.;
         double const cpuLoad_s = (double)(clock() - cpuStart) / CLOCKS_PER_SEC;
         DISPLAYLEVEL(3,"Done in %.2f s ==> %.2f MiB/s  (cpu load : %.0f%%)\n", seconds,
                         size / seconds / 1024 / 1024,
                         (cpuLoad_s / seconds) * 100.);
     }
+    if (stats) LZ4IO_statsDisplay(duration_ns);
 }
 
 /**************************************
@@ -179,9 +225,22 @@ struct LZ4IO_prefs_s {
     int contentSizeFlag;
     int useDictionary;
     unsigned favorDecSpeed;
+    unsigned skipIncompressible;
+    int adapt;
+    int adaptMinLevel;
+    int adaptMaxLevel;
     const char* dictionaryFilename;
     int removeSrcFile;
     int nbWorkers;
+    int numaAware;
+    int seekable;
+    int stats;
+    int directIO;
+    int rsyncable;
+    int append;
+    int listJSON;
+    size_t maxMemory;
+    unsigned flushInterval;
 };
 
 void LZ4IO_freePreferences(LZ4IO_prefs_t* prefs)
@@ -205,9 +264,22 @@ LZ4IO_prefs_t* LZ4IO_defaultPreferences(void)
     prefs->contentSizeFlag = 0;
     prefs->useDictionary = 0;
     prefs->favorDecSpeed = 0;
+    prefs->skipIncompressible = 0;
+    prefs->adapt = 0;
+    prefs->adaptMinLevel = 1;
+    prefs->adaptMaxLevel = LZ4HC_CLEVEL_MAX;
     prefs->dictionaryFilename = NULL;
     prefs->removeSrcFile = 0;
     prefs->nbWorkers = LZ4IO_defaultNbWorkers();
+    prefs->numaAware = 0;
+    prefs->seekable = 0;
+    prefs->stats = 0;
+    prefs->directIO = 0;
+    prefs->rsyncable = 0;
+    prefs->append = 0;
+    prefs->listJSON = 0;
+    prefs->maxMemory = 0;
+    prefs->flushInterval = 0;
     return prefs;
 }
 
@@ -219,6 +291,13 @@ int LZ4IO_setNbWorkers(LZ4IO_prefs_t* const prefs, int nbWorkers)
     return nbWorkers;
 }
 
+/* Default setting : 0 (disabled) */
+int LZ4IO_setNumaAware(LZ4IO_prefs_t* const prefs, int enable)
+{
+    prefs->numaAware = (enable!=0);
+    return prefs->numaAware;
+}
+
 int LZ4IO_setDictionaryFilename(LZ4IO_prefs_t* const prefs, const char* dictionaryFilename)
 {
     prefs->dictionaryFilename = dictionaryFilename;
@@ -324,11 +403,84 @@ void LZ4IO_favorDecSpeed(LZ4IO_prefs_t* const prefs, int favor)
     prefs->favorDecSpeed = (favor!=0);
 }
 
+/* Default setting : 0 (disabled) */
+void LZ4IO_skipIncompressible(LZ4IO_prefs_t* const prefs, int skip)
+{
+    prefs->skipIncompressible = (skip!=0);
+}
+
+/* Default setting : 0 (disabled), range [1, LZ4HC_CLEVEL_MAX] */
+int LZ4IO_setAdaptiveLevel(LZ4IO_prefs_t* const prefs, int enable, int minLevel, int maxLevel)
+{
+    if (maxLevel > LZ4HC_CLEVEL_MAX) maxLevel = LZ4HC_CLEVEL_MAX;
+    if (minLevel > maxLevel) return 0;
+    prefs->adapt = (enable!=0);
+    prefs->adaptMinLevel = minLevel;
+    prefs->adaptMaxLevel = maxLevel;
+    return prefs->adapt;
+}
+
 void LZ4IO_setRemoveSrcFile(LZ4IO_prefs_t* const prefs, unsigned flag)
 {
   prefs->removeSrcFile = (flag>0);
 }
 
+/* Default setting : 0 (disabled) */
+int LZ4IO_setSeekable(LZ4IO_prefs_t* const prefs, int enable)
+{
+    prefs->seekable = (enable!=0);
+    return prefs->seekable;
+}
+
+/* Default setting : 0 (disabled) */
+int LZ4IO_setStats(LZ4IO_prefs_t* const prefs, int enable)
+{
+    prefs->stats = (enable!=0);
+    return prefs->stats;
+}
+
+/* Default setting : 0 (disabled) */
+int LZ4IO_setDirectIO(LZ4IO_prefs_t* const prefs, int enable)
+{
+    prefs->directIO = (enable!=0);
+    return prefs->directIO;
+}
+
+/* Default setting : 0 (disabled) */
+int LZ4IO_setRsyncable(LZ4IO_prefs_t* const prefs, int enable)
+{
+    prefs->rsyncable = (enable!=0);
+    return prefs->rsyncable;
+}
+
+/* Default setting : 0 (disabled) */
+int LZ4IO_setAppend(LZ4IO_prefs_t* const prefs, int enable)
+{
+    prefs->append = (enable!=0);
+    return prefs->append;
+}
+
+/* Default setting : 0 (disabled) */
+int LZ4IO_setListJSON(LZ4IO_prefs_t* const prefs, int enable)
+{
+    prefs->listJSON = (enable!=0);
+    return prefs->listJSON;
+}
+
+/* Default setting : 0 (no limit) */
+size_t LZ4IO_setMaxMemory(LZ4IO_prefs_t* const prefs, size_t maxMemory)
+{
+    prefs->maxMemory = maxMemory;
+    return prefs->maxMemory;
+}
+
+/* Default setting : 0 (disabled) */
+unsigned LZ4IO_setFlushInterval(LZ4IO_prefs_t* const prefs, unsigned milliseconds)
+{
+    prefs->flushInterval = milliseconds;
+    return prefs->flushInterval;
+}
+
 
 /* ************************************************************************ **
 ** ********************** String functions ********************* **
@@ -383,6 +535,419 @@ static FILE* LZ4IO_openSrcFile(const char* srcFileName)
     return f;
 }
 
+
+/***************************************
+*   Memory-mapped input
+***************************************/
+/* A file truncated while it is mapped raises SIGBUS on access past its new end.
+ * Input is therefore only mapped when this signal can be intercepted (see LZ4IO_MG_handler()),
+ * which requires SA_SIGINFO, MAP_ANONYMOUS and atomics for the table of guarded mappings.
+ * Otherwise, regular files are read with fread(), like pipes. */
+#if LZ4IO_MMAP && (PLATFORM_POSIX_VERSION >= 200112L) \
+  && (defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#  include <sys/mman.h>   /* mmap, munmap, madvise */
+#  include <unistd.h>     /* sysconf */
+#  include <signal.h>     /* sigaction, SIGBUS */
+#  if defined(SA_SIGINFO) && defined(MAP_ANONYMOUS)
+#    define LZ4IO_USE_MMAP 1
+#  else
+#    define LZ4IO_USE_MMAP 0
+#  endif
+#else
+#  define LZ4IO_USE_MMAP 0
+#endif
+
+#if LZ4IO_USE_MMAP
+/* Mapping guard :
+ * input mappings are registered in a fixed table, scanned by the SIGBUS handler.
+ * On a fault within a registered mapping, the rest of it is replaced by zero pages,
+ * so that the faulting access completes, and the mapping is flagged as truncated.
+ * Its owner then reports a read error when releasing it (see LZ4IO_freeSrcReader()),
+ * instead of producing output from input which changed meanwhile.
+ * Files are only mapped while a slot is available (one per concurrently processed file). */
+#define LZ4IO_MG_SLOTS 64
+
+static int g_mgUsed[LZ4IO_MG_SLOTS];               /* claimed by an owner */
+static const char* g_mgStart[LZ4IO_MG_SLOTS];      /* != NULL : slot visible to the handler */
+static size_t g_mgSize[LZ4IO_MG_SLOTS];
+static volatile sig_atomic_t g_mgTruncated[LZ4IO_MG_SLOTS];
+static int g_mgState = 0;                          /* 0 : handler not installed, 1 : installing, 2 : installed */
+static size_t g_mgPageSize = 0;
+static struct sigaction g_mgPrevAction;
+
+static void LZ4IO_MG_handler(int sig, siginfo_t* info, void* uctx)
+{
+    const char* const addr = (const char*)info->si_addr;
+    int const savedErrno = errno;
+    int n;
+    (void)sig; (void)uctx;
+    for (n = 0; n < LZ4IO_MG_SLOTS; n++) {
+        const char* const start = __atomic_load_n(&g_mgStart[n], __ATOMIC_ACQUIRE);
+        if ((start != NULL) && (addr >= start) && (addr < start + g_mgSize[n])) {
+            char* const page = (char*)((size_t)addr & ~(g_mgPageSize - 1));
+            size_t const len = (size_t)(start + g_mgSize[n] - page);
+            if (mmap(page, len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED) {
+                g_mgTruncated[n] = 1;
+                errno = savedErrno;
+                return;   /* faulting access is restarted, and now reads zeroes */
+            }
+            break;
+    }   }
+    /* not an input mapping, or it can't be replaced : restore previous action, which then handles the fault */
+    (void)sigaction(SIGBUS, &g_mgPrevAction, NULL);
+    errno = savedErrno;
+}
+
+/* LZ4IO_MG_install() :
+ * installs the SIGBUS handler, on first use.
+ * @return : 1 when the handler is installed, 0 otherwise (another thread is installing it, or failure) */
+static int LZ4IO_MG_install(void)
+{
+    int expected = 0;
+    if (__atomic_load_n(&g_mgState, __ATOMIC_ACQUIRE) == 2) return 1;
+    if (!__atomic_compare_exchange_n(&g_mgState, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return 0;
+    {   struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = LZ4IO_MG_handler;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        g_mgPageSize = (size_t)sysconf(_SC_PAGESIZE);
+        if (sigaction(SIGBUS, &sa, &g_mgPrevAction) != 0) {
+            __atomic_store_n(&g_mgState, 0, __ATOMIC_RELEASE);
+            return 0;
+    }   }
+    __atomic_store_n(&g_mgState, 2, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* LZ4IO_MG_claim() :
+ * @return : index of a slot reserved for a new mapping, or -1 if input must not be mapped */
+static int LZ4IO_MG_claim(void)
+{
+    int n;
+    if (!LZ4IO_MG_install()) return -1;
+    for (n = 0; n < LZ4IO_MG_SLOTS; n++) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&g_mgUsed[n], &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            g_mgTruncated[n] = 0;
+            return n;
+    }   }
+    return -1;
+}
+
+static void LZ4IO_MG_register(int slot, const char* map, size_t mapSize)
+{
+    g_mgSize[slot] = mapSize;
+    __atomic_store_n(&g_mgStart[slot], map, __ATOMIC_RELEASE);
+}
+
+/* LZ4IO_MG_release() :
+ * @return : 1 if the mapping was truncated while registered */
+static int LZ4IO_MG_release(int slot)
+{
+    int const truncated = (g_mgTruncated[slot] != 0);
+    __atomic_store_n(&g_mgStart[slot], (const char*)NULL, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_mgUsed[slot], 0, __ATOMIC_RELEASE);
+    return truncated;
+}
+#endif
+
+
+/***************************************
+*   Direct I/O
+***************************************/
+#if defined(__linux__) && (PLATFORM_POSIX_VERSION >= 200112L)
+#  include <fcntl.h>      /* fcntl, O_DIRECT */
+#  include <unistd.h>     /* pread, pwrite */
+#  ifdef O_DIRECT
+#    define LZ4IO_USE_DIRECT_IO 1
+#  endif
+#endif
+#ifndef LZ4IO_USE_DIRECT_IO
+#  define LZ4IO_USE_DIRECT_IO 0
+#endif
+
+
+/***************************************
+*   Low-latency pipe input
+***************************************/
+#if (PLATFORM_POSIX_VERSION >= 200112L)
+#  include <poll.h>       /* poll */
+#  include <unistd.h>     /* read */
+#  define LZ4IO_USE_POLL 1
+#else
+#  define LZ4IO_USE_POLL 0
+#endif
+
+/* O_DIRECT transfers must use buffers, sizes and file positions
+ * aligned on logical block size of underlying device */
+#define LZ4IO_DIRECT_ALIGN (4 KB)
+
+#if LZ4IO_USE_DIRECT_IO
+
+/* LZ4IO_mallocAligned() :
+ * @return : buffer aligned for direct I/O, to be released with free(), or NULL */
+static void* LZ4IO_mallocAligned(size_t size)
+{
+    void* p = NULL;
+    if (posix_memalign(&p, LZ4IO_DIRECT_ALIGN, size)) return NULL;
+    return p;
+}
+
+/* LZ4IO_setDirect() :
+ * enables or disables O_DIRECT on @fd.
+ * @return : 0 on success, or -1 if the file system doesn't support it */
+static int LZ4IO_setDirect(int fd, int enable)
+{
+    int const flags = fcntl(fd, F_GETFL);
+    if (flags == -1) return -1;
+    return fcntl(fd, F_SETFL, enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT));
+}
+
+/* LZ4IO_preadDirect() :
+ * reads up to @size bytes at @pos, stopping early at end of file.
+ * @return : nb of bytes read */
+static size_t LZ4IO_preadDirect(int fd, void* buf, size_t size, size_t pos)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t const r = pread(fd, (char*)buf + done, size - done, (off_t)(pos + done));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            END_PROCESS(40, "Read error : %s", strerror(errno));
+        }
+        done += (size_t)r;
+        if ((r == 0) || ((size_t)r & (LZ4IO_DIRECT_ALIGN-1))) break;   /* end of file */
+    }
+    return done;
+}
+
+#endif  /* LZ4IO_USE_DIRECT_IO */
+
+/* LZ4IO_mallocSrcBuffer() :
+ * input buffers are aligned when input is read with O_DIRECT */
+static void* LZ4IO_mallocSrcBuffer(size_t size, int directIO)
+{
+#if LZ4IO_USE_DIRECT_IO
+    if (directIO) return LZ4IO_mallocAligned(size);
+#else
+    (void)directIO;
+#endif
+    return malloc(size);
+}
+
+
+/* Input reader : regular files are mapped in memory,
+ * so that input is passed directly to (de)compression functions,
+ * instead of being first copied by fread() into intermediate buffers.
+ * Pipes and stdin, as well as mapping failures, fall back to fread().
+ * In direct I/O mode, regular files are instead read with O_DIRECT,
+ * which bypasses the page cache. */
+typedef struct {
+    FILE* f;
+    const char* map;   /* NULL when input is not mapped */
+    size_t mapSize;
+    int mapSlot;       /* mapping guard slot, see LZ4IO_MG_claim() */
+    size_t pos;        /* for mapped and direct input */
+    int direct;        /* input is read with O_DIRECT */
+    void* bounce;      /* aligned buffer, for unaligned direct reads */
+    size_t bounceSize;
+    int eof;           /* end of input reached : no more read needed */
+    unsigned latencyMs;   /* != 0 : pipe input, reads return after this delay */
+} LZ4IO_SrcReader;
+
+static LZ4IO_SrcReader LZ4IO_initSrcReader(FILE* f, int directIO)
+{
+    LZ4IO_SrcReader sr;
+    sr.f = f;
+    sr.map = NULL;
+    sr.mapSize = 0;
+    sr.mapSlot = -1;
+    sr.pos = 0;
+    sr.direct = 0;
+    sr.bounce = NULL;
+    sr.bounceSize = 0;
+    sr.eof = 0;
+    sr.latencyMs = 0;
+#if LZ4IO_USE_DIRECT_IO
+    if (directIO && UTIL_getOpenFileSize(f) > 0) {
+        if (LZ4IO_setDirect(UTIL_fileno(f), 1) == 0) {
+            sr.direct = 1;
+            DISPLAYLEVEL(4, "Using direct I/O for input \n");
+            return sr;
+        }
+        DISPLAYLEVEL(2, "Warning : direct I/O not supported for input : %s \n", strerror(errno));
+    }
+#else
+    (void)directIO;
+#endif
+#if LZ4IO_USE_MMAP
+    {   U64 const fileSize = UTIL_getOpenFileSize(f);   /* 0 if not a regular file */
+        int const slot = ((fileSize > 0) && (fileSize == (U64)(size_t)fileSize)) ? LZ4IO_MG_claim() : -1;
+        if (slot >= 0) {
+            void* const map = mmap(NULL, (size_t)fileSize, PROT_READ, MAP_PRIVATE, UTIL_fileno(f), 0);
+            if (map != MAP_FAILED) {
+#  ifdef MADV_SEQUENTIAL
+                (void)madvise(map, (size_t)fileSize, MADV_SEQUENTIAL);
+#  endif
+                LZ4IO_MG_register(slot, (const char*)map, (size_t)fileSize);
+                sr.map = (const char*)map;
+                sr.mapSize = (size_t)fileSize;
+                sr.mapSlot = slot;
+                DISPLAYLEVEL(4, "Using memory-mapped input \n");
+            } else {
+                (void)LZ4IO_MG_release(slot);
+    }   }   }
+#endif
+    return sr;
+}
+
+/* LZ4IO_setSrcLatency() :
+ * with a flush interval, input which is neither mapped nor a regular file (pipe, terminal)
+ * is read with a time limit (see LZ4IO_readTimed()),
+ * instead of waiting for each read to be completely filled. */
+static void LZ4IO_setSrcLatency(LZ4IO_SrcReader* sr, unsigned latencyMs)
+{
+#if LZ4IO_USE_POLL
+    if (latencyMs && !sr->map && !sr->direct && UTIL_getOpenFileSize(sr->f) == 0) {
+        sr->latencyMs = latencyMs;
+        DISPLAYLEVEL(4, "Input read with %u ms latency \n", latencyMs);
+    }
+#else
+    (void)sr;
+    if (latencyMs) DISPLAYLEVEL(2, "Warning : --flush-interval not supported on this platform \n");
+#endif
+}
+
+/* LZ4IO_freeSrcReader() :
+ * must be invoked once input is fully processed, before output is considered valid :
+ * it terminates with an error if mapped input was truncated meanwhile. */
+static void LZ4IO_freeSrcReader(LZ4IO_SrcReader* sr)
+{
+#if LZ4IO_USE_MMAP
+    if (sr->map) {
+        int const truncated = LZ4IO_MG_release(sr->mapSlot);
+        munmap((void*)(size_t)sr->map, sr->mapSize);
+        if (truncated) END_PROCESS(40, "Read error : input file truncated while being read");
+    }
+#endif
+    sr->map = NULL;
+    free(sr->bounce);
+    sr->bounce = NULL;
+}
+
+#if LZ4IO_USE_DIRECT_IO
+/* LZ4IO_readDirect() :
+ * aligned requests are read straight into @buffer.
+ * Others go through an aligned bounce buffer, covering the surrounding aligned range. */
+static const void* LZ4IO_readDirect(LZ4IO_SrcReader* sr, void* buffer, size_t size, size_t* readSize)
+{
+    size_t const alignMask = LZ4IO_DIRECT_ALIGN - 1;
+    int const fd = UTIL_fileno(sr->f);
+    if (!(((size_t)buffer | size | sr->pos) & alignMask)) {
+        *readSize = LZ4IO_preadDirect(fd, buffer, size, sr->pos);
+    } else {
+        size_t const start = sr->pos & ~alignMask;
+        size_t const end = (sr->pos + size + alignMask) & ~alignMask;
+        size_t const skip = sr->pos - start;
+        size_t loaded;
+        if (sr->bounceSize < end - start) {
+            free(sr->bounce);
+            sr->bounce = LZ4IO_mallocAligned(end - start);
+            if (sr->bounce == NULL) END_PROCESS(41, "Allocation error : not enough memory");
+            sr->bounceSize = end - start;
+        }
+        loaded = LZ4IO_preadDirect(fd, sr->bounce, end - start, start);
+        *readSize = (loaded > skip) ? MIN(size, loaded - skip) : 0;
+        memcpy(buffer, (const char*)sr->bounce + skip, *readSize);
+    }
+    sr->pos += *readSize;
+    return buffer;
+}
+#endif
+
+#if LZ4IO_USE_POLL
+/* LZ4IO_readTimed() :
+ * waits for the first input byte, then reads until @size bytes are collected,
+ * input ends, or sr->latencyMs elapsed since the first byte.
+ * @return : nb of bytes read, 0 only at end of input */
+static size_t LZ4IO_readTimed(LZ4IO_SrcReader* sr, void* buffer, size_t size)
+{
+    int const fd = UTIL_fileno(sr->f);
+    Duration_ns const budget = (Duration_ns)sr->latencyMs * 1000000;
+    TIME_t start = TIME_getTime();
+    size_t done = 0;
+    while (done < size) {
+        ssize_t r;
+        if (done) {
+            Duration_ns const elapsed = TIME_clockSpan_ns(start);
+            struct pollfd pfd;
+            int ready;
+            if (elapsed >= budget) break;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            ready = poll(&pfd, 1, (int)((budget - elapsed + 999999) / 1000000));
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                END_PROCESS(40, "Read error : %s", strerror(errno));
+            }
+            if (ready == 0) break;   /* no more input within latency budget */
+        }
+        r = read(fd, (char*)buffer + done, size - done);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            END_PROCESS(40, "Read error : %s", strerror(errno));
+        }
+        if (r == 0) { sr->eof = 1; break; }
+        if (done == 0) start = TIME_getTime();
+        done += (size_t)r;
+    }
+    return done;
+}
+#endif
+
+/* LZ4IO_readSrc() :
+ * @return : pointer to the next *readSize bytes of input (*readSize <= size).
+ *           Points into the mapping when input is mapped, into @buffer otherwise.
+ *           sr->eof is set once input is known to be fully read :
+ *           a short read only means end of input when latency mode is not enabled. */
+static const void* LZ4IO_readSrc(LZ4IO_SrcReader* sr, void* buffer, size_t size, size_t* readSize)
+{
+    if (sr->map) {
+        const char* const p = sr->map + sr->pos;
+        *readSize = MIN(size, sr->mapSize - sr->pos);
+        sr->pos += *readSize;
+        sr->eof = (*readSize < size);
+#if LZ4IO_USE_MMAP && LZ4IO_ASYNC_IO && defined(MADV_WILLNEED)
+        /* read ahead : start loading next chunk while this one is processed */
+        if (sr->pos < sr->mapSize) {
+            size_t const pageMask = (size_t)sysconf(_SC_PAGESIZE) - 1;
+            size_t const start = sr->pos & ~pageMask;
+            size_t const end = MIN(sr->pos + size, sr->mapSize);
+            (void)madvise((void*)(size_t)(sr->map + start), end - start, MADV_WILLNEED);
+        }
+#endif
+        return p;
+    }
+#if LZ4IO_USE_POLL
+    if (sr->latencyMs) {
+        *readSize = LZ4IO_readTimed(sr, buffer, size);
+        return buffer;
+    }
+#endif
+#if LZ4IO_USE_DIRECT_IO
+    if (sr->direct) {
+        const void* const p = LZ4IO_readDirect(sr, buffer, size, readSize);
+        sr->eof = (*readSize < size);
+        return p;
+    }
+#endif
+    *readSize = fread(buffer, (size_t)1, size, sr->f);
+    sr->eof = (*readSize < size);
+    return buffer;
+}
+
 /** FIO_openDstFile() :
  *  prefs is writable, because sparseFileSupport might be updated.
  *  condition : `dstFileName` must be non-NULL.
@@ -432,11 +997,416 @@ LZ4IO_openDstFile(const char* dstFileName, const LZ4IO_prefs_t* const prefs)
 }
 
 
+/***************************************
+*   Asynchronous output
+***************************************/
+#if LZ4IO_ASYNC_IO && defined(__linux__) && defined(__GNUC__)
+#  include <sys/syscall.h>   /* __NR_io_uring_setup, __NR_io_uring_enter */
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#    include <sys/mman.h>    /* mmap, munmap */
+#    include <sys/uio.h>     /* struct iovec */
+#    include <unistd.h>      /* syscall, close, pwrite */
+#    include <linux/io_uring.h>
+#    define LZ4IO_USE_IO_URING 1
+#  endif
+#endif
+#ifndef LZ4IO_USE_IO_URING
+#  define LZ4IO_USE_IO_URING 0
+#endif
+
+#define LZ4IO_AIO_QUEUE_DEPTH 8   /* max nb of writes in flight */
+#define LZ4IO_DIRECT_STAGE_SIZE (4 MB)   /* direct I/O : size of aligned writes */
+
+/* LZ4IO_releaseBuffer() :
+ * @buf comes from @pool, or from malloc() when @pool is NULL */
+static void LZ4IO_releaseBuffer(TPOOL_bufPool* pool, void* buf)
+{
+    if (pool) TPOOL_bufPool_release(pool, buf);
+    else free(buf);
+}
+
+/* Asynchronous writer :
+ * compressed chunks are submitted to an io_uring instance,
+ * which keeps up to LZ4IO_AIO_QUEUE_DEPTH writes in flight,
+ * so that the write thread no longer waits for storage between chunks.
+ * Writes are positional, hence only regular files are eligible.
+ * Each buffer is released when its write completes.
+ * When io_uring is not available, output is written with fwrite().
+ * In direct I/O mode, chunks are gathered into aligned staging buffers,
+ * written with O_DIRECT (synchronously when io_uring is not available).
+ * Unaligned bytes, at beginning and end of output, are written without O_DIRECT. */
+typedef struct LZ4IO_AsyncWriter_s LZ4IO_AsyncWriter;
+
+#if LZ4IO_USE_IO_URING
+
+typedef struct {
+    void* buf;   /* NULL when slot is free */
+    TPOOL_bufPool* pool;   /* owner of buf; NULL : allocated by the writer itself */
+    struct iovec iov;
+    unsigned long long pos;
+} AIO_Slot;
+
+struct LZ4IO_AsyncWriter_s {
+    int ringFd;               /* < 0 : no io_uring, direct mode only */
+    int fd;
+    unsigned long long pos;   /* position of next write */
+    unsigned inFlight;
+    int direct;               /* output is written with O_DIRECT */
+    size_t headSize;          /* direct mode : bytes left before first aligned position */
+    char* stage;              /* direct mode : aligned buffer, collecting data at stagePos */
+    size_t stageFill;
+    unsigned long long stagePos;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+    AIO_Slot slots[LZ4IO_AIO_QUEUE_DEPTH];
+};
+
+static int AIO_enter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    int r;
+    do {
+        r = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+static void AIO_free(LZ4IO_AsyncWriter* aw)
+{
+    if (aw == NULL) return;
+    free(aw->stage);
+    if (aw->sqes) munmap(aw->sqes, aw->sqesSize);
+    if (aw->cqRing) munmap(aw->cqRing, aw->cqRingSize);
+    if (aw->sqRing) munmap(aw->sqRing, aw->sqRingSize);
+    if (aw->ringFd >= 0) close(aw->ringFd);
+    free(aw);
+}
+
+static void* AIO_mapRing(int ringFd, size_t size, off_t offset)
+{
+    void* const p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ringFd, offset);
+    return (p == MAP_FAILED) ? NULL : p;
+}
+
+#if LZ4IO_USE_DIRECT_IO
+/* AIO_enableDirect() :
+ * staging buffers start at the first aligned position following current position.
+ * Bytes before it (headSize) are written without O_DIRECT,
+ * which is only enabled once they are written.
+ * @return : 0 on success */
+static int AIO_enableDirect(LZ4IO_AsyncWriter* aw)
+{
+    aw->stagePos = (aw->pos + LZ4IO_DIRECT_ALIGN-1) & ~(unsigned long long)(LZ4IO_DIRECT_ALIGN-1);
+    aw->headSize = (size_t)(aw->stagePos - aw->pos);
+    aw->stageFill = 0;
+    aw->stage = (char*)LZ4IO_mallocAligned(LZ4IO_DIRECT_STAGE_SIZE);
+    if (aw->stage == NULL) return 1;
+    if (LZ4IO_setDirect(aw->fd, 1)) {
+        DISPLAYLEVEL(2, "Warning : direct I/O not supported for output : %s \n", strerror(errno));
+        return 1;
+    }
+    if (aw->headSize) LZ4IO_setDirect(aw->fd, 0);
+    aw->direct = 1;
+    DISPLAYLEVEL(4, "Using direct I/O for output \n");
+    return 0;
+}
+#endif
+
+/* AIO_create() :
+ * @return : an asynchronous writer, which continues at current position of @f,
+ *           or NULL if @f is not a regular file, or io_uring is not available (then use fwrite()).
+ *           With @directIO, a writer is still created without io_uring, and writes synchronously. */
+static LZ4IO_AsyncWriter* AIO_create(FILE* f, int directIO)
+{
+    LZ4IO_AsyncWriter* aw;
+    struct io_uring_params p;
+    stat_t st;
+    off_t pos;
+
+    if (fflush(f)) return NULL;
+    if (fstat(UTIL_fileno(f), &st) || !S_ISREG(st.st_mode)) return NULL;
+    pos = ftello(f);
+    if (pos < 0) return NULL;
+
+    aw = (LZ4IO_AsyncWriter*)calloc(1, sizeof(*aw));
+    if (aw == NULL) return NULL;
+    aw->fd = UTIL_fileno(f);
+    aw->pos = (unsigned long long)pos;
+#if LZ4IO_USE_DIRECT_IO
+    if (directIO && AIO_enableDirect(aw)) {
+        free(aw->stage);
+        aw->stage = NULL;
+    }
+#else
+    (void)directIO;
+#endif
+    memset(&p, 0, sizeof(p));
+    aw->ringFd = (int)syscall(__NR_io_uring_setup, LZ4IO_AIO_QUEUE_DEPTH, &p);
+    if (aw->ringFd < 0) {
+        if (aw->direct) {
+            DISPLAYLEVEL(4, "io_uring not available (%s) : using synchronous direct writes \n", strerror(errno));
+            return aw;
+        }
+        DISPLAYLEVEL(4, "io_uring not available (%s) : using fwrite() \n", strerror(errno));
+        AIO_free(aw);
+        return NULL;
+    }
+
+    aw->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    aw->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    aw->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    aw->sqRing = AIO_mapRing(aw->ringFd, aw->sqRingSize, IORING_OFF_SQ_RING);
+    aw->cqRing = AIO_mapRing(aw->ringFd, aw->cqRingSize, IORING_OFF_CQ_RING);
+    aw->sqes = (struct io_uring_sqe*)AIO_mapRing(aw->ringFd, aw->sqesSize, IORING_OFF_SQES);
+    if (!aw->sqRing || !aw->cqRing || !aw->sqes) {
+        if (aw->direct) LZ4IO_setDirect(aw->fd, 0);
+        AIO_free(aw);
+        return NULL;
+    }
+    aw->sqTail = (unsigned*)((char*)aw->sqRing + p.sq_off.tail);
+    aw->sqArray = (unsigned*)((char*)aw->sqRing + p.sq_off.array);
+    aw->sqMask = *(unsigned*)((char*)aw->sqRing + p.sq_off.ring_mask);
+    aw->cqHead = (unsigned*)((char*)aw->cqRing + p.cq_off.head);
+    aw->cqTail = (unsigned*)((char*)aw->cqRing + p.cq_off.tail);
+    aw->cqMask = *(unsigned*)((char*)aw->cqRing + p.cq_off.ring_mask);
+    aw->cqes = (struct io_uring_cqe*)((char*)aw->cqRing + p.cq_off.cqes);
+    DISPLAYLEVEL(4, "Using io_uring for output (%u writes in flight) \n", LZ4IO_AIO_QUEUE_DEPTH);
+    return aw;
+}
+
+/* AIO_reap() :
+ * collects completed writes, waiting for at least @minComplete of them */
+static void AIO_reap(LZ4IO_AsyncWriter* aw, unsigned minComplete)
+{
+    unsigned head = *aw->cqHead;
+    if (minComplete && AIO_enter(aw->ringFd, 0, minComplete, IORING_ENTER_GETEVENTS) < 0)
+        END_PROCESS(38, "Write error : io_uring wait failed : %s", strerror(errno));
+    while (head != __atomic_load_n(aw->cqTail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe const* const cqe = aw->cqes + (head & aw->cqMask);
+        AIO_Slot* const slot = aw->slots + cqe->user_data;
+        if (cqe->res < 0)
+            END_PROCESS(38, "Write error : cannot write compressed block : %s", strerror(-cqe->res));
+        {   /* short write : complete it synchronously */
+            size_t done = (size_t)cqe->res;
+            while (done < slot->iov.iov_len) {
+                ssize_t const r = pwrite(aw->fd, (const char*)slot->iov.iov_base + done, slot->iov.iov_len - done, (off_t)(slot->pos + done));
+                if (r <= 0) END_PROCESS(38, "Write error : cannot write compressed block : %s", strerror(errno));
+                done += (size_t)r;
+        }   }
+        LZ4IO_releaseBuffer(slot->pool, slot->buf);
+        slot->buf = NULL;
+        aw->inFlight--;
+        head++;
+    }
+    __atomic_store_n(aw->cqHead, head, __ATOMIC_RELEASE);
+}
+
+/* AIO_pwrite() :
+ * synchronous write of @buf at @pos, completing short writes */
+static void AIO_pwrite(int fd, const void* buf, size_t size, unsigned long long pos)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t const r = pwrite(fd, (const char*)buf + done, size - done, (off_t)(pos + done));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) END_PROCESS(38, "Write error : cannot write compressed block : %s", strerror(errno));
+        done += (size_t)r;
+    }
+}
+
+/* AIO_submit() :
+ * queues the write of @buf at @pos.
+ * Ownership of @buf is transferred : it's released to @pool once written. */
+static void AIO_submit(LZ4IO_AsyncWriter* aw, void* buf, size_t size, unsigned long long pos, TPOOL_bufPool* pool)
+{
+    unsigned slotNb;
+    if (aw->ringFd < 0) {
+        AIO_pwrite(aw->fd, buf, size, pos);
+        LZ4IO_releaseBuffer(pool, buf);
+        return;
+    }
+    if (aw->inFlight == LZ4IO_AIO_QUEUE_DEPTH) AIO_reap(aw, 1);
+    for (slotNb = 0; aw->slots[slotNb].buf != NULL; slotNb++) assert(slotNb < LZ4IO_AIO_QUEUE_DEPTH);
+    {   AIO_Slot* const slot = aw->slots + slotNb;
+        unsigned const tail = *aw->sqTail;
+        unsigned const index = tail & aw->sqMask;
+        struct io_uring_sqe* const sqe = aw->sqes + index;
+        slot->buf = buf;
+        slot->pool = pool;
+        slot->iov.iov_base = buf;
+        slot->iov.iov_len = size;
+        slot->pos = pos;
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->fd = aw->fd;
+        sqe->off = slot->pos;
+        sqe->addr = (unsigned long long)(size_t)&slot->iov;
+        sqe->len = 1;
+        sqe->user_data = slotNb;
+        aw->sqArray[index] = index;
+        __atomic_store_n(aw->sqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+    if (AIO_enter(aw->ringFd, 1, 0, 0) != 1)
+        END_PROCESS(38, "Write error : cannot submit compressed block : %s", strerror(errno));
+    aw->inFlight++;
+    AIO_reap(aw, 0);
+}
+
+/* AIO_write() :
+ * queues the write of @buf at the end of output.
+ * Ownership of @buf is transferred : it's released to @pool once written. */
+static void AIO_write(LZ4IO_AsyncWriter* aw, void* buf, size_t size, TPOOL_bufPool* pool)
+{
+    if (aw->direct) {
+        /* gather into staging buffer, submitted once full */
+        size_t done = 0;
+        if (aw->headSize) {
+            done = MIN(size, aw->headSize);
+            AIO_pwrite(aw->fd, buf, done, aw->pos);
+            aw->headSize -= done;
+            if ((aw->headSize == 0) && LZ4IO_setDirect(aw->fd, 1))
+                END_PROCESS(38, "Write error : cannot enable direct I/O : %s", strerror(errno));
+        }
+        while (done < size) {
+            size_t const toCopy = MIN(size - done, LZ4IO_DIRECT_STAGE_SIZE - aw->stageFill);
+            memcpy(aw->stage + aw->stageFill, (const char*)buf + done, toCopy);
+            aw->stageFill += toCopy;
+            done += toCopy;
+            if (aw->stageFill == LZ4IO_DIRECT_STAGE_SIZE) {
+                AIO_submit(aw, aw->stage, LZ4IO_DIRECT_STAGE_SIZE, aw->stagePos, NULL);
+                aw->stagePos += LZ4IO_DIRECT_STAGE_SIZE;
+                aw->stageFill = 0;
+                aw->stage = (char*)LZ4IO_mallocAligned(LZ4IO_DIRECT_STAGE_SIZE);
+                if (aw->stage == NULL) END_PROCESS(38, "Allocation error : can't allocate direct I/O buffer");
+        }   }
+        LZ4IO_releaseBuffer(pool, buf);
+    } else {
+        AIO_submit(aw, buf, size, aw->pos, pool);
+    }
+    aw->pos += size;
+}
+
+/* AIO_finish() :
+ * waits for all writes to complete, then releases @aw.
+ * @f is positioned at end of written data, so that it can continue with fwrite(). */
+static void AIO_finish(LZ4IO_AsyncWriter* aw, FILE* f)
+{
+#if LZ4IO_USE_DIRECT_IO
+    if (aw->direct) {
+        /* aligned part of last stage is written with O_DIRECT, the tail without */
+        size_t const alignedSize = aw->stageFill & ~(size_t)(LZ4IO_DIRECT_ALIGN-1);
+        size_t const tailSize = aw->stageFill - alignedSize;
+        char tail[LZ4IO_DIRECT_ALIGN];
+        memcpy(tail, aw->stage + alignedSize, tailSize);
+        if (alignedSize) {
+            AIO_submit(aw, aw->stage, alignedSize, aw->stagePos, NULL);
+        } else {
+            free(aw->stage);
+        }
+        aw->stage = NULL;
+        while (aw->inFlight) AIO_reap(aw, 1);
+        if (LZ4IO_setDirect(aw->fd, 0))
+            END_PROCESS(38, "Write error : cannot disable direct I/O : %s", strerror(errno));
+        AIO_pwrite(aw->fd, tail, tailSize, aw->stagePos + alignedSize);
+    }
+#endif
+    while (aw->inFlight) AIO_reap(aw, 1);
+    if (UTIL_fseek(f, (off_t)aw->pos, SEEK_SET))
+        END_PROCESS(38, "Write error : cannot seek to end of compressed data");
+    AIO_free(aw);
+}
+
+#else  /* !LZ4IO_USE_IO_URING */
+
+static LZ4IO_AsyncWriter* AIO_create(FILE* f, int directIO) { (void)f; (void)directIO; return NULL; }
+static void AIO_write(LZ4IO_AsyncWriter* aw, void* buf, size_t size, TPOOL_bufPool* pool) { (void)aw; (void)buf; (void)size; (void)pool; assert(0); }
+static void AIO_finish(LZ4IO_AsyncWriter* aw, FILE* f) { (void)aw; (void)f; assert(0); }
+
+#endif  /* LZ4IO_USE_IO_URING */
+
+
 /***************************************
 *   MT I/O
 ***************************************/
 
-#include "threadpool.h"
+static void LZ4IO_freePool(TPOOL_ctx* pool)
+{
+    if (pool) g_stats.nbStalls += TPOOL_nbStalls(pool);
+    TPOOL_free(pool);
+}
+
+/* Adaptive compression level (--adapt) :
+ * compression level is raised while I/O is slower than compression,
+ * and lowered when compression becomes slower than I/O.
+ * Decisions are taken after each LZ4IO_ADAPT_WINDOW of input. */
+#define LZ4IO_ADAPT_WINDOW (16 MB)
+
+/* In multi-threaded mode, cLevel is written by the writer thread, and read by the reader thread when starting new jobs.
+ * No other data is published through it, and a stale value just delays the change to next chunk :
+ * relaxed atomic accesses are enough. */
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#  define LZ4IO_ADAPT_LOAD(p)      __atomic_load_n((p), __ATOMIC_RELAXED)
+#  define LZ4IO_ADAPT_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#else   /* aligned int accesses are atomic on supported targets; volatile prevents caching */
+#  define LZ4IO_ADAPT_LOAD(p)      (*(volatile const int*)(p))
+#  define LZ4IO_ADAPT_STORE(p, v)  (*(volatile int*)(p) = (v))
+#endif
+
+typedef struct {
+    int minLevel;
+    int maxLevel;
+    int cLevel;           /* access with LZ4IO_ADAPT_LOAD() / LZ4IO_ADAPT_STORE() */
+    int parallelism;      /* nb of concurrent compression jobs, 0 when compression and I/O are sequential */
+    Duration_ns cTime;
+    Duration_ns readTime;
+    Duration_ns writeTime;
+    size_t inSize;
+} AdaptState;
+
+static void LZ4IO_adaptInit(AdaptState* as, const LZ4IO_prefs_t* prefs, int cLevel, int parallelism)
+{
+    memset(as, 0, sizeof(*as));
+    as->minLevel = prefs->adaptMinLevel;
+    as->maxLevel = prefs->adaptMaxLevel;
+    as->cLevel = MAX(MIN(cLevel, as->maxLevel), as->minLevel);
+    as->parallelism = parallelism;
+}
+
+/* LZ4IO_adaptLevel() :
+ * registers one processed chunk.
+ * @return : compression level to use for next chunks */
+static int LZ4IO_adaptLevel(AdaptState* as, size_t inSize,
+                            Duration_ns cTime, Duration_ns readTime, Duration_ns writeTime)
+{
+    as->inSize += inSize;
+    as->cTime += cTime;
+    as->readTime += readTime;
+    as->writeTime += writeTime;
+    if (as->inSize >= LZ4IO_ADAPT_WINDOW) {
+        /* sequential : every stage adds up ; overlapped : slowest stage sets the pace */
+        Duration_ns const ioTime = as->parallelism ? MAX(as->readTime, as->writeTime) : as->readTime + as->writeTime;
+        Duration_ns const compTime = as->parallelism ? as->cTime / (Duration_ns)as->parallelism : as->cTime;
+        int level = as->cLevel;
+        if (ioTime > compTime + compTime / 2) level++;  /* waiting for I/O : cpu can afford more compression */
+        else if (compTime > ioTime) level--;            /* cpu is the bottleneck */
+        level = MAX(MIN(level, as->maxLevel), as->minLevel);
+        if (level != as->cLevel) DISPLAYLEVEL(4, "\radaptive level : %i \n", level);
+        LZ4IO_ADAPT_STORE(&as->cLevel, level);   /* only this thread writes cLevel : its own reads need no atomic */
+        as->inSize = 0;
+        as->cTime = as->readTime = as->writeTime = 0;
+    }
+    return as->cLevel;
+}
 
 typedef struct {
     void* buf;
@@ -450,6 +1420,9 @@ typedef struct {
     size_t capacity;
     size_t blockSize;
     unsigned long long totalCSize;
+    AdaptState* adapt;   /* NULL when level is fixed */
+    LZ4IO_AsyncWriter* aio;   /* NULL : output is written with fwrite() */
+    int flush;   /* flush output after each write (low latency) */
 } WriteRegister;
 
 static void WR_destroy(WriteRegister* wr)
@@ -462,7 +1435,7 @@ static void WR_destroy(WriteRegister* wr)
  * check that wr->buffers!= NULL for success */
 static WriteRegister WR_init(size_t blockSize)
 {
-    WriteRegister wr = { 0, NULL, WR_INITIAL_BUFFER_POOL_SIZE, 0, 0 };
+    WriteRegister wr = { 0, NULL, WR_INITIAL_BUFFER_POOL_SIZE, 0, 0, NULL, NULL, 0 };
     wr.buffers = (BufferDesc*)calloc(1, WR_INITIAL_BUFFER_POOL_SIZE * sizeof(BufferDesc));
     wr.blockSize = blockSize;
     return wr;
@@ -484,6 +1457,7 @@ static void WR_addBufDesc(WriteRegister* wr, const BufferDesc* bd)
         memset(wr->buffers + oldCapacity, 0, addedCapacity * sizeof(BufferDesc));
         wr->buffers[oldCapacity] = bd[0];
         wr->capacity = newCapacity;
+        g_stats.maxBuffered = MAX(g_stats.maxBuffered, oldCapacity+1);
     } else {
         /* at least one position (the last one) is free, i.e. buffer==NULL */
         size_t n;
@@ -494,6 +1468,7 @@ static void WR_addBufDesc(WriteRegister* wr, const BufferDesc* bd)
             }
         }
         assert(n != wr->capacity);
+        g_stats.maxBuffered = MAX(g_stats.maxBuffered, n+1);
     }
 }
 
@@ -526,6 +1501,7 @@ static BufferDesc WR_getBufID(WriteRegister* wr, unsigned long long id)
     END_PROCESS(41, "buffer ID not found");
 }
 
+/* Note: buffer itself is not released, it's owned by caller */
 static void WR_removeBuffID(WriteRegister* wr, unsigned long long id)
 {
     size_t n;
@@ -534,10 +1510,8 @@ static void WR_removeBuffID(WriteRegister* wr, unsigned long long id)
             /* no more buffers stored */
             return;
         }
-        if (wr->buffers[n].rank == id) {
-            free(wr->buffers[n].buf);
+        if (wr->buffers[n].rank == id)
             break;
-        }
     }
     /* overwrite buffer descriptor, scale others down*/
     n++;
@@ -551,20 +1525,40 @@ static void WR_removeBuffID(WriteRegister* wr, unsigned long long id)
     }
 }
 
+/* Multi-threaded compression recycles its buffers and job descriptors through pools,
+ * which can be shared by all files of a run :
+ * once pools are warm, processing a chunk allocates nothing. */
+typedef struct {
+    TPOOL_bufPool* in;     /* input chunks */
+    TPOOL_bufPool* out;    /* compressed chunks */
+    TPOOL_bufPool* jobs;   /* job descriptors */
+} LZ4IO_MTPools;
+
 typedef struct {
     WriteRegister* wr;
     void* cBuf;
     size_t cSize;
     unsigned long long blockNb;
     FILE* out;
+    size_t inSize;
+    Duration_ns cTime;
+    Duration_ns readTime;
+    const LZ4IO_MTPools* pools;
 } WriteJobDesc;
 
-static void LZ4IO_writeBuffer(BufferDesc bufDesc, FILE* out)
+/* LZ4IO_writeBuffer() :
+ * ownership of bufDesc.buf is transferred : it's released to @pool once written */
+static void LZ4IO_writeBuffer(WriteRegister* wr, BufferDesc bufDesc, FILE* out, TPOOL_bufPool* pool)
 {
     size_t const size = bufDesc.size;
+    if (wr->aio) {
+        AIO_write(wr->aio, bufDesc.buf, size, pool);
+        return;
+    }
     if (fwrite(bufDesc.buf, 1, size, out) != size) {
         END_PROCESS(38, "Write error : cannot write compressed block");
     }
+    TPOOL_bufPool_release(pool, bufDesc.buf);
 }
 
 static void LZ4IO_checkWriteOrder(void* arg)
@@ -572,7 +1566,10 @@ static void LZ4IO_checkWriteOrder(void* arg)
     WriteJobDesc* const wjd = (WriteJobDesc*)arg;
     size_t const cSize = wjd->cSize;
     WriteRegister* const wr = wjd->wr;
+    TIME_t const writeStart = TIME_getTime();
 
+    g_stats.readTime += wjd->readTime;
+    g_stats.codecTime += wjd->cTime;
     if (wjd->blockNb != wr->expectedRank) {
         /* incorrect order : let's store this buffer for later write */
         BufferDesc bd;
@@ -580,7 +1577,10 @@ static void LZ4IO_checkWriteOrder(void* arg)
         bd.size = wjd->cSize;
         bd.rank = wjd->blockNb;
         WR_addBufDesc(wr, &bd);
-        free(wjd);  /* because wjd is pod */
+        if (wr->adapt)
+            LZ4IO_adaptLevel(wr->adapt, wjd->inSize, wjd->cTime, wjd->readTime, 0);
+        TPOOL_bufPool_release(wjd->pools->jobs, wjd);  /* because wjd is pod */
+        g_stats.writerTime += TIME_clockSpan_ns(writeStart);
         return;
     }
 
@@ -589,20 +1589,26 @@ static void LZ4IO_checkWriteOrder(void* arg)
         bd.buf = wjd->cBuf;
         bd.size = wjd->cSize;
         bd.rank = wjd->blockNb;
-        LZ4IO_writeBuffer(bd, wjd->out);
+        LZ4IO_writeBuffer(wr, bd, wjd->out, wjd->pools->out);
     }
     wr->expectedRank++;
     wr->totalCSize += cSize;
-    free(wjd->cBuf);
     /* and check for more blocks, previously saved */
     while (WR_isPresent(wr, wr->expectedRank)) {
         BufferDesc const bd = WR_getBufID(wr, wr->expectedRank);
-        LZ4IO_writeBuffer(bd, wjd->out);
+        LZ4IO_writeBuffer(wr, bd, wjd->out, wjd->pools->out);
         wr->totalCSize += bd.size;
         WR_removeBuffID(wr, wr->expectedRank);
         wr->expectedRank++;
     }
-    free(wjd);  /* because wjd is pod */
+    if (wr->flush && !wr->aio && fflush(wjd->out))
+        END_PROCESS(38, "Write error : cannot flush output");
+    {   Duration_ns const writeTime = TIME_clockSpan_ns(writeStart);
+        g_stats.writerTime += writeTime;
+        if (wr->adapt)
+            LZ4IO_adaptLevel(wr->adapt, wjd->inSize, wjd->cTime, wjd->readTime, writeTime);
+    }
+    TPOOL_bufPool_release(wjd->pools->jobs, wjd);  /* because wjd is pod */
     {   unsigned long long const processedSize = (unsigned long long)(wr->expectedRank-1) * wr->blockSize;
         DISPLAYUPDATE(2, "\rRead : %u MiB   ==> %.2f%%   ",
                 (unsigned)(processedSize >> 20),
@@ -616,11 +1622,47 @@ typedef size_t (*compress_f)(
     size_t dstCapacity,
     const void* src,
     size_t srcSize,
-    size_t prefixSize);
-
+    size_t prefixSize,
+    int cLevel);
+
+/* Frame content checksum (multi-threaded mode) :
+ * it's a serial operation, which is given its own thread (hpool),
+ * so that it runs concurrently with reading and compression.
+ * Jobs are queued in read order, into a single thread, hence processed in order.
+ * Releasing a read buffer is queued behind its checksum job, into the same thread. */
 typedef struct {
-    TPOOL_ctx* wpool;
-    void* buffer;
+    XXH32_state_t* xxh32;
+    const void* buffer;
+    size_t size;
+    TPOOL_bufPool* jobs;
+} ChecksumJobDesc;
+
+static void LZ4IO_checksumChunk(void* arg)
+{
+    ChecksumJobDesc* const hjd = (ChecksumJobDesc*)arg;
+    TIME_t const hStart = TIME_getTime();
+    XXH32_update(hjd->xxh32, hjd->buffer, hjd->size);
+    g_stats.checksumTime += TIME_clockSpan_ns(hStart);
+    TPOOL_bufPool_release(hjd->jobs, hjd);  /* because hjd is pod */
+}
+
+static void LZ4IO_submitChecksum(TPOOL_ctx* hpool, const LZ4IO_MTPools* pools, XXH32_state_t* xxh32, const void* buffer, size_t size)
+{
+    ChecksumJobDesc* const hjd = (ChecksumJobDesc*)TPOOL_bufPool_acquire(pools->jobs);
+    if (hjd == NULL)
+        END_PROCESS(33, "Allocation error : can't describe new checksum job");
+    hjd->xxh32 = xxh32;
+    hjd->buffer = buffer;
+    hjd->size = size;
+    hjd->jobs = pools->jobs;
+    TPOOL_submitJob(hpool, LZ4IO_checksumChunk, hjd);
+}
+
+typedef struct {
+    TPOOL_ctx* wpool;
+    TPOOL_ctx* hpool;    /* if set, ownedBuffer is released by checksum thread */
+    const void* buffer;
+    void* ownedBuffer;   /* freed after compression; NULL when buffer points into mapped input */
     size_t prefixSize;
     size_t inSize;
     unsigned long long blockNb;
@@ -630,20 +1672,26 @@ typedef struct {
     WriteRegister* wr;
     size_t maxCBlockSize;
     int lastBlock;
+    int cLevel;
+    Duration_ns readTime;
+    const LZ4IO_MTPools* pools;
 } CompressJobDesc;
 
 static void LZ4IO_compressChunk(void* arg)
 {
     CompressJobDesc* const cjd = (CompressJobDesc*)arg;
     size_t const outCapacity = cjd->maxCBlockSize;
-    void* const out_buff = malloc(outCapacity);
+    void* const out_buff = TPOOL_bufPool_acquire(cjd->pools->out);
+    assert(outCapacity <= TPOOL_bufPool_bufSize(cjd->pools->out));
     if (!out_buff)
         END_PROCESS(33, "Allocation error : can't allocate output buffer to compress new chunk");
-    {   char* const inBuff = (char*)cjd->buffer + cjd->prefixSize;
-        size_t const cSize = cjd->compress(cjd->compressParameters, out_buff, outCapacity, inBuff, cjd->inSize, cjd->prefixSize);
+    {   const char* const inBuff = (const char*)cjd->buffer + cjd->prefixSize;
+        TIME_t const cStart = TIME_getTime();
+        size_t const cSize = cjd->compress(cjd->compressParameters, out_buff, outCapacity, inBuff, cjd->inSize, cjd->prefixSize, cjd->cLevel);
+        Duration_ns const cTime = TIME_clockSpan_ns(cStart);
 
         /* check for write */
-        {   WriteJobDesc* const wjd = (WriteJobDesc*)malloc(sizeof(*wjd));
+        {   WriteJobDesc* const wjd = (WriteJobDesc*)TPOOL_bufPool_acquire(cjd->pools->jobs);
             if (wjd == NULL) {
                 END_PROCESS(35, "Allocation error : can't describe new write job");
             }
@@ -652,24 +1700,40 @@ static void LZ4IO_compressChunk(void* arg)
             wjd->blockNb = cjd->blockNb;
             wjd->out = cjd->fout;
             wjd->wr = cjd->wr;
+            wjd->inSize = cjd->inSize;
+            wjd->cTime = cTime;
+            wjd->readTime = cjd->readTime;
+            wjd->pools = cjd->pools;
             TPOOL_submitJob(cjd->wpool, LZ4IO_checkWriteOrder, wjd);
     }   }
 }
 
+static void LZ4IO_releaseChunk(void* arg)
+{
+    CompressJobDesc* const cjd = (CompressJobDesc*)arg;
+    TPOOL_bufPool_release(cjd->pools->in, cjd->ownedBuffer);
+    TPOOL_bufPool_release(cjd->pools->jobs, cjd);  /* because cjd is pod */
+}
+
 static void LZ4IO_compressAndFreeChunk(void* arg)
 {
     CompressJobDesc* const cjd = (CompressJobDesc*)arg;
     LZ4IO_compressChunk(arg);
     /* clean up */
-    free(cjd->buffer);
-    free(cjd); /* because cjd is pod */
+    if (cjd->hpool && cjd->ownedBuffer) {
+        /* buffer might still be needed by checksum */
+        TPOOL_submitJob(cjd->hpool, LZ4IO_releaseChunk, cjd);
+    } else {
+        LZ4IO_releaseChunk(cjd);
+    }
 }
 
 /* one ReadTracker per file to compress */
 typedef struct {
     TPOOL_ctx* tpool;
     TPOOL_ctx* wpool;
-    FILE* fin;
+    TPOOL_ctx* hpool;   /* checksum thread, only needed with xxh32 */
+    LZ4IO_SrcReader* src;
     size_t chunkSize;
     unsigned long long totalReadSize;
     unsigned long long blockNb;
@@ -680,6 +1744,9 @@ typedef struct {
     FILE* fout;
     WriteRegister* wr;
     size_t maxCBlockSize;
+    int cLevel;
+    const AdaptState* adapt;   /* if it exists, provides cLevel */
+    const LZ4IO_MTPools* pools;
 } ReadTracker;
 
 static void LZ4IO_readAndProcess(void* arg)
@@ -688,37 +1755,50 @@ static void LZ4IO_readAndProcess(void* arg)
     size_t const chunkSize = rjd->chunkSize;
     size_t const prefixSize = (rjd->prefix != NULL) * 64 KB;
     size_t const bufferSize = chunkSize + prefixSize;
-    void* const buffer = malloc(bufferSize);
-    if (!buffer)
+    /* mapped input is referenced directly, unless a prefix must precede it */
+    int const useMap = (rjd->src->map != NULL) && (prefixSize == 0);
+    void* const buffer = useMap ? NULL : TPOOL_bufPool_acquire(rjd->pools->in);
+    if (!useMap && !buffer)
         END_PROCESS(31, "Allocation error : can't allocate buffer to read new chunk");
+    assert(bufferSize <= TPOOL_bufPool_bufSize(rjd->pools->in));
     if (prefixSize) {
         memcpy(buffer, rjd->prefix, 64 KB);
     }
-    {   char* const in_buff = (char*)buffer + prefixSize;
-        size_t const inSize = fread(in_buff, (size_t)1, chunkSize, rjd->fin);
+    {   size_t inSize;
+        TIME_t const readStart = TIME_getTime();
+        const char* const in_buff = (const char*)LZ4IO_readSrc(rjd->src, (char*)buffer + prefixSize, chunkSize, &inSize);
+        Duration_ns const readTime = TIME_clockSpan_ns(readStart);
+        const void* const jobBuffer = useMap ? (const void*)in_buff : (const void*)buffer;
+        if (buffer && (const char*)buffer + prefixSize != in_buff) {
+            /* prefix mode with mapped input : input must follow prefix */
+            memcpy((char*)buffer + prefixSize, in_buff, inSize);
+        }
         if (inSize > chunkSize) {
             END_PROCESS(32, "Read error (read %u > %u [chunk size])", (unsigned)inSize, (unsigned)chunkSize);
         }
         rjd->totalReadSize += inSize;
         /* special case: nothing left: stop read operation */
         if (inSize == 0) {
-            free(buffer);
+            TPOOL_bufPool_release(rjd->pools->in, buffer);
             return;
         }
         /* process read input */
-        {   CompressJobDesc* const cjd = (CompressJobDesc*)malloc(sizeof(*cjd));
+        {   CompressJobDesc* const cjd = (CompressJobDesc*)TPOOL_bufPool_acquire(rjd->pools->jobs);
             if (cjd==NULL) {
                 END_PROCESS(33, "Allocation error : can't describe new compression job");
             }
             if (rjd->xxh32) {
-                XXH32_update(rjd->xxh32, in_buff, inSize);
+                LZ4IO_submitChecksum(rjd->hpool, rjd->pools, rjd->xxh32, in_buff, inSize);
             }
             if (rjd->prefix) {
-                /* dependent blocks mode */
-                memcpy(rjd->prefix, in_buff + inSize - 64 KB, 64 KB);
+                /* dependent blocks mode : buffer starts with previous prefix,
+                 * so it always holds 64 KB, even when chunk is shorter */
+                memcpy(rjd->prefix, (const char*)buffer + inSize, 64 KB);
             }
             cjd->wpool = rjd->wpool;
-            cjd->buffer = buffer; /* transfer ownership */
+            cjd->hpool = rjd->xxh32 ? rjd->hpool : NULL;
+            cjd->buffer = jobBuffer;
+            cjd->ownedBuffer = buffer; /* transfer ownership */
             cjd->prefixSize = prefixSize;
             cjd->inSize = inSize;
             cjd->blockNb = rjd->blockNb;
@@ -727,16 +1807,89 @@ static void LZ4IO_readAndProcess(void* arg)
             cjd->fout = rjd->fout;
             cjd->wr = rjd->wr;
             cjd->maxCBlockSize = rjd->maxCBlockSize;
-            cjd->lastBlock = inSize < chunkSize;
-            TPOOL_submitJob(rjd->tpool, LZ4IO_compressAndFreeChunk, cjd);
-            if (inSize == chunkSize) {
-                /* probably more ? read another chunk */
+            cjd->lastBlock = rjd->src->eof;
+            cjd->cLevel = rjd->adapt ? LZ4IO_ADAPT_LOAD(&rjd->adapt->cLevel) : rjd->cLevel;
+            cjd->readTime = readTime;
+            cjd->pools = rjd->pools;
+            if (!TPOOL_trySubmitJob(rjd->tpool, LZ4IO_compressAndFreeChunk, cjd, TPOOL_PRIORITY_NORMAL)) {
+                /* queue is full, hence all workers are busy :
+                 * rather than blocking, this thread compresses the chunk itself */
+                g_stats.nbInlineJobs++;
+                LZ4IO_compressAndFreeChunk(cjd);
+            }
+            if (!rjd->src->eof) {
+                /* probably more ? read another chunk.
+                 * Reading gets priority, so that it never waits behind queued compression jobs */
                 rjd->blockNb++;
-                TPOOL_submitJob(rjd->tpool, LZ4IO_readAndProcess, rjd);
+                TPOOL_submitJob_advanced(rjd->tpool, LZ4IO_readAndProcess, rjd, TPOOL_PRIORITY_HIGH);
     }   }   }
 }
 
 
+/* Multi-threaded compression :
+ * each job should be "sufficiently large" (4 MB) to amortize its cost.
+ * With --max-memory, chunks get smaller, so that all buffers in flight fit within the limit.
+ * Each chunk in flight costs an input and an output buffer : chunks in flight are
+ * those compressed or queued, those waiting for their turn to be written, or for the checksum thread.
+ * Smaller chunks are compensated by a deeper job queue, so that workers are kept busy. */
+#define LZ4IO_MT_CHUNK_SIZE_MAX (4 MB)
+#define LZ4IO_MT_CHUNK_SIZE_MIN (64 KB)
+#define LZ4IO_MT_WQUEUE_SIZE 4   /* writer thread */
+#define LZ4IO_MT_HQUEUE_SIZE 8   /* checksum thread */
+
+static int LZ4IO_MTqueueSize(const LZ4IO_prefs_t* prefs)
+{
+    return prefs->maxMemory ? MAX(prefs->nbWorkers, 4) : 4;
+}
+
+/* LZ4IO_MTnbChunks() :
+ * @return : max nb of chunks in flight */
+static size_t LZ4IO_MTnbChunks(const LZ4IO_prefs_t* prefs)
+{
+    size_t const nbWorkers = (size_t)prefs->nbWorkers;
+    return nbWorkers + (size_t)LZ4IO_MTqueueSize(prefs) + 1   /* compressed, queued, being read */
+         + nbWorkers                                          /* out of order */
+         + (LZ4IO_MT_WQUEUE_SIZE + 1) + (LZ4IO_MT_HQUEUE_SIZE + 1)
+         + 1;                                                 /* first chunk */
+}
+
+static size_t LZ4IO_MTchunkSize(const LZ4IO_prefs_t* prefs)
+{
+    size_t chunkSize;
+    if (prefs->maxMemory == 0) return LZ4IO_MT_CHUNK_SIZE_MAX;
+    chunkSize = (prefs->maxMemory / (2 * LZ4IO_MTnbChunks(prefs))) & ~(size_t)(LZ4IO_MT_CHUNK_SIZE_MIN - 1);
+    return MAX(MIN(chunkSize, LZ4IO_MT_CHUNK_SIZE_MAX), LZ4IO_MT_CHUNK_SIZE_MIN);
+}
+
+static void* LZ4IO_mallocDirectBuffer(size_t size) { return LZ4IO_mallocSrcBuffer(size, 1); }
+
+/* LZ4IO_createMTPools() :
+ * pools for input chunks of up to @chunkSize bytes, compressed into up to @cChunkSize bytes.
+ * Up to @nbChunks of each, the max nb of chunks in flight, are kept for reuse.
+ * With direct I/O, input buffers are aligned. */
+static LZ4IO_MTPools LZ4IO_createMTPools(size_t chunkSize, size_t cChunkSize, size_t nbChunks, int directIO)
+{
+    LZ4IO_MTPools pools;
+    size_t const jobSize = MAX(sizeof(CompressJobDesc), MAX(sizeof(WriteJobDesc), sizeof(ChecksumJobDesc)));
+    pools.in = TPOOL_bufPool_create(chunkSize, nbChunks, directIO ? LZ4IO_mallocDirectBuffer : NULL);
+    pools.out = TPOOL_bufPool_create(cChunkSize, nbChunks, NULL);
+    pools.jobs = TPOOL_bufPool_create(jobSize, 3 * nbChunks, NULL);
+    if (pools.in == NULL || pools.out == NULL || pools.jobs == NULL)
+        END_PROCESS(31, "Allocation error : can't create buffer pools");
+    return pools;
+}
+
+static void LZ4IO_freeMTPools(LZ4IO_MTPools* pools)
+{
+    if (pools->in) g_stats.nbAllocs += TPOOL_bufPool_nbAllocs(pools->in);
+    if (pools->out) g_stats.nbAllocs += TPOOL_bufPool_nbAllocs(pools->out);
+    TPOOL_bufPool_free(pools->in);
+    TPOOL_bufPool_free(pools->out);
+    TPOOL_bufPool_free(pools->jobs);
+    memset(pools, 0, sizeof(*pools));
+}
+
+
 /***************************************
 *   Legacy Compression
 ***************************************/
@@ -755,10 +1908,17 @@ static void LZ4IO_writeLE32 (void* p, unsigned value32)
     dstPtr[3] = (unsigned char)(value32 >> 24);
 }
 
+/* It's presumed that @p points to a memory space of size >= 4 */
+static unsigned LZ4IO_readLE32 (const void* p)
+{
+    const unsigned char* const srcPtr = (const unsigned char*)p;
+    unsigned value32 = srcPtr[0];
+    value32 += (unsigned)srcPtr[1] <<  8;
+    value32 += (unsigned)srcPtr[2] << 16;
+    value32 += (unsigned)srcPtr[3] << 24;
+    return value32;
+}
 
-typedef struct {
-    int cLevel;
-} CompressLegacyState;
 
 static size_t LZ4IO_compressBlockLegacy_fast(
     const void* params,
@@ -766,16 +1926,17 @@ static size_t LZ4IO_compressBlockLegacy_fast(
     size_t dstCapacity,
     const void* src,
     size_t srcSize,
-    size_t prefixSize
+    size_t prefixSize,
+    int cLevel
 )
 {
-    const CompressLegacyState* const clevel = (const CompressLegacyState*)params;
-    int const acceleration = (clevel->cLevel < 0) ? -clevel->cLevel : 0;
+    int const acceleration = (cLevel < 0) ? -cLevel : 0;
     int const cSize = LZ4_compress_fast((const char*)src, (char*)dst + LZ4IO_LEGACY_BLOCK_HEADER_SIZE, (int)srcSize, (int)dstCapacity, acceleration);
     if (cSize < 0)
         END_PROCESS(51, "fast compression failed");
     LZ4IO_writeLE32(dst, (unsigned)cSize);
     assert(prefixSize == 0); (void)prefixSize;
+    (void)params;
     return (size_t) cSize + LZ4IO_LEGACY_BLOCK_HEADER_SIZE;
 }
 
@@ -785,16 +1946,16 @@ static size_t LZ4IO_compressBlockLegacy_HC(
     size_t dstCapacity,
     const void* src,
     size_t srcSize,
-    size_t prefixSize
+    size_t prefixSize,
+    int cLevel
 )
 {
-    const CompressLegacyState* const cs = (const CompressLegacyState*)params;
-    int const clevel = cs->cLevel;
-    int const cSize = LZ4_compress_HC((const char*)src, (char*)dst + LZ4IO_LEGACY_BLOCK_HEADER_SIZE, (int)srcSize, (int)dstCapacity, clevel);
+    int const cSize = LZ4_compress_HC((const char*)src, (char*)dst + LZ4IO_LEGACY_BLOCK_HEADER_SIZE, (int)srcSize, (int)dstCapacity, cLevel);
     if (cSize < 0)
         END_PROCESS(52, "HC compression failed");
     LZ4IO_writeLE32(dst, (unsigned)cSize);
     assert(prefixSize == 0); (void)prefixSize;
+    (void)params;
     return (size_t) cSize + LZ4IO_LEGACY_BLOCK_HEADER_SIZE;
 }
 
@@ -812,9 +1973,11 @@ static int LZ4IO_compressLegacy_internal(unsigned long long* readSize,
     compress_f const compressionFunction = (compressionlevel < 3) ? LZ4IO_compressBlockLegacy_fast : LZ4IO_compressBlockLegacy_HC;
     FILE* const finput = LZ4IO_openSrcFile(input_filename);
     FILE* foutput = NULL;
-    TPOOL_ctx* const tPool = TPOOL_create(prefs->nbWorkers, 4);
+    TPOOL_ctx* const tPool = TPOOL_create_advanced(prefs->nbWorkers, 4, prefs->numaAware);
     TPOOL_ctx* const wPool = TPOOL_create(1, 4);
     WriteRegister wr = WR_init(LEGACY_BLOCKSIZE);
+    size_t const maxCBlockSize = (size_t)LZ4_compressBound(LEGACY_BLOCKSIZE) + LZ4IO_LEGACY_BLOCK_HEADER_SIZE;
+    LZ4IO_MTPools pools = LZ4IO_createMTPools(LEGACY_BLOCKSIZE, maxCBlockSize, LZ4IO_MTnbChunks(prefs), prefs->directIO);
 
     /* Init & checks */
     *readSize = 0;
@@ -842,28 +2005,34 @@ static int LZ4IO_compressLegacy_internal(unsigned long long* readSize,
             END_PROCESS(23, "Write error : cannot write header");
     }
     wr.totalCSize = MAGICNUMBER_SIZE;
+    wr.aio = AIO_create(foutput, prefs->directIO);
 
-    {   CompressLegacyState cls;
-        ReadTracker rjd;
-        cls.cLevel = compressionlevel;
+    {   ReadTracker rjd;
+        LZ4IO_SrcReader srcReader = LZ4IO_initSrcReader(finput, prefs->directIO);
         rjd.tpool = tPool;
         rjd.wpool = wPool;
-        rjd.fin = finput;
+        rjd.hpool = NULL;
+        rjd.src = &srcReader;
         rjd.chunkSize = LEGACY_BLOCKSIZE;
         rjd.totalReadSize = 0;
         rjd.blockNb = 0;
         rjd.xxh32 = NULL;
         rjd.compress = compressionFunction;
-        rjd.compressParameters = &cls;
+        rjd.compressParameters = NULL;
         rjd.prefix = NULL;
         rjd.fout = foutput;
         rjd.wr = &wr;
-        rjd.maxCBlockSize = (size_t)LZ4_compressBound(LEGACY_BLOCKSIZE) + LZ4IO_LEGACY_BLOCK_HEADER_SIZE;
+        rjd.maxCBlockSize = maxCBlockSize;
+        rjd.cLevel = compressionlevel;
+        rjd.adapt = NULL;   /* legacy format : compressor is selected once, level remains fixed */
+        rjd.pools = &pools;
         /* Ignite the job chain */
-        TPOOL_submitJob(tPool, LZ4IO_readAndProcess, &rjd);
+        TPOOL_submitJob_advanced(tPool, LZ4IO_readAndProcess, &rjd, TPOOL_PRIORITY_HIGH);
         /* Wait for all completion */
         TPOOL_completeJobs(tPool);
         TPOOL_completeJobs(wPool);
+        if (wr.aio) AIO_finish(wr.aio, foutput);
+        LZ4IO_freeSrcReader(&srcReader);
 
         /* Status */
         DISPLAYLEVEL(2, "\r%79s\r", "");    /* blank line */
@@ -875,8 +2044,9 @@ static int LZ4IO_compressLegacy_internal(unsigned long long* readSize,
     /* Close & Free */
 _cfl_clean:
     WR_destroy(&wr);
-    TPOOL_free(wPool);
-    TPOOL_free(tPool);
+    LZ4IO_freePool(wPool);
+    LZ4IO_freePool(tPool);
+    LZ4IO_freeMTPools(&pools);
     if (finput) fclose(finput);
     if (foutput && !LZ4IO_isStdout(output_filename)) fclose(foutput);  /* do not close stdout */
 
@@ -897,7 +2067,7 @@ int LZ4IO_compressFilename_Legacy(const char* input_filename,
     clock_t const cpuStart = clock();
     unsigned long long processed = 0;
     int r = LZ4IO_compressLegacy_internal(&processed, input_filename, output_filename, compressionlevel, prefs);
-    LZ4IO_finalTimeDisplay(timeStart, cpuStart, processed);
+    LZ4IO_finalTimeDisplay(timeStart, cpuStart, processed, prefs->stats);
     return r;
 }
 
@@ -950,7 +2120,7 @@ int LZ4IO_compressMultipleFilenames_Legacy(
     }
 
     /* Close & Free */
-    LZ4IO_finalTimeDisplay(timeStart, cpuStart, totalProcessed);
+    LZ4IO_finalTimeDisplay(timeStart, cpuStart, totalProcessed, prefs->stats);
     free(dstFileName);
 
     return missed_files;
@@ -969,12 +2139,16 @@ typedef struct {
     LZ4F_CDict* cdict;
     TPOOL_ctx* tpool;
     TPOOL_ctx* wpool; /* writer thread */
+    TPOOL_ctx* hpool; /* checksum thread */
+    LZ4IO_MTPools pools;
 } cRess_t;
 
 static void LZ4IO_freeCResources(cRess_t ress)
 {
-    TPOOL_free(ress.tpool);
-    TPOOL_free(ress.wpool);
+    LZ4IO_freePool(ress.tpool);
+    LZ4IO_freePool(ress.wpool);
+    LZ4IO_freePool(ress.hpool);
+    LZ4IO_freeMTPools(&ress.pools);
 
     free(ress.srcBuffer);
     free(ress.dstBuffer);
@@ -1058,9 +2232,104 @@ static LZ4F_CDict* LZ4IO_createCDict(const LZ4IO_prefs_t* io_prefs)
     return cdict;
 }
 
+/* Content-defined blocks (--rsyncable) :
+ * blocks also end where a rolling hash of the last bytes matches a pattern.
+ * Since these cut points only depend on local content,
+ * compressed output realigns on the first cut point following an insertion or a deletion,
+ * so that rsync and deduplication only see differences around modified areas.
+ * The hash is a "gear" hash : each byte adds a random value, and is shifted out after 64 bytes.
+ * Cut points are expected every ~blockSize bytes, and are at least blockSize/4 bytes apart. */
+#define LZ4IO_RSYNC_WINDOW 64      /* nb of bytes hash depends on */
+#define LZ4IO_RSYNC_MINSEG_LOG 2   /* min distance between cut points : blockSize >> 2 */
+#define LZ4IO_RSYNC_MAX_CUTS ((1 << LZ4IO_RSYNC_MINSEG_LOG) + 1)   /* within blockSize bytes */
+
+typedef struct {
+    U64 hash;
+    U64 hitMask;        /* cut point : all hitMask bits of hash are set */
+    size_t minSegment;
+    size_t segSize;     /* bytes since last cut point */
+    U64 gear[256];
+} LZ4IO_Rsync;
+
+static void LZ4IO_rsyncInit(LZ4IO_Rsync* rs, size_t blockSize)
+{
+    U64 rand64 = 0x9E3779B97F4A7C15ULL;
+    unsigned hitBits = 0;
+    unsigned n;
+    while (((size_t)1 << (hitBits+1)) <= blockSize) hitBits++;
+    rs->hash = 0;
+    rs->hitMask = (((U64)1 << hitBits) - 1) << (64 - hitBits);   /* top bits depend on all LZ4IO_RSYNC_WINDOW last bytes */
+    rs->minSegment = blockSize >> LZ4IO_RSYNC_MINSEG_LOG;
+    rs->segSize = 0;
+    for (n = 0; n < 256; n++) {   /* fixed sequence : cut points must not vary between runs */
+        rand64 = rand64 * 6364136223846793005ULL + 1442695040888963407ULL;
+        rs->gear[n] = rand64;
+    }
+}
+
+/* LZ4IO_rsyncNextCut() :
+ * @return : size of next segment of @src, ending either at a cut point (*cut = 1) or at @srcSize (*cut = 0) */
+static size_t LZ4IO_rsyncNextCut(LZ4IO_Rsync* rs, const BYTE* src, size_t srcSize, int* cut)
+{
+    U64 hash = rs->hash;
+    size_t pos = 0;
+    /* no cut point before minSegment : skip hash updates which can't influence it */
+    if (rs->segSize + LZ4IO_RSYNC_WINDOW < rs->minSegment) {
+        pos = MIN(srcSize, rs->minSegment - LZ4IO_RSYNC_WINDOW - rs->segSize);
+    }
+    for (; pos < srcSize; pos++) {
+        hash = (hash << 1) + rs->gear[src[pos]];
+        if (((hash & rs->hitMask) == rs->hitMask) && (rs->segSize + pos + 1 >= rs->minSegment)) {
+            rs->hash = hash;
+            rs->segSize = 0;
+            *cut = 1;
+            return pos + 1;
+    }   }
+    rs->hash = hash;
+    rs->segSize += srcSize;
+    *cut = 0;
+    return srcSize;
+}
+
+/* LZ4IO_compressRsyncable() :
+ * same as LZ4F_compressUpdate() without autoFlush,
+ * but current block is also flushed at each cut point within @src.
+ * @dstCapacity must be >= LZ4IO_rsyncBound(@srcSize)
+ * @return : nb of bytes written into @dst, or an LZ4F error code */
+static size_t LZ4IO_compressRsyncable(LZ4F_cctx* ctx, LZ4IO_Rsync* rs,
+                                      void* dst, size_t dstCapacity,
+                                      const void* src, size_t srcSize)
+{
+    const BYTE* const ip = (const BYTE*)src;
+    size_t pos = 0;
+    size_t dstSize = 0;
+    while (pos < srcSize) {
+        int cut;
+        size_t const segSize = LZ4IO_rsyncNextCut(rs, ip + pos, srcSize - pos, &cut);
+        size_t r = LZ4F_compressUpdate(ctx, (char*)dst + dstSize, dstCapacity - dstSize, ip + pos, segSize, NULL);
+        if (LZ4F_isError(r)) return r;
+        dstSize += r;
+        pos += segSize;
+        if (cut) {
+            r = LZ4F_flush(ctx, (char*)dst + dstSize, dstCapacity - dstSize, NULL);
+            if (LZ4F_isError(r)) return r;
+            dstSize += r;
+    }   }
+    return dstSize;
+}
+
+/* LZ4IO_rsyncBound() :
+ * output of LZ4IO_compressRsyncable() includes up to one block of previous input,
+ * and a block header (with optional checksum) for each cut point */
+static size_t LZ4IO_rsyncBound(size_t srcSize, const LZ4F_preferences_t* prefs)
+{
+    return LZ4F_compressFrameBound(2 * srcSize, prefs)
+         + LZ4IO_RSYNC_MAX_CUTS * (LZ4F_BLOCK_HEADER_SIZE + LZ4F_BLOCK_CHECKSUM_SIZE);
+}
+
 static cRess_t LZ4IO_createCResources(const LZ4IO_prefs_t* io_prefs)
 {
-    const size_t chunkSize = 4 MB;
+    const size_t chunkSize = MAX(io_prefs->blockSize, LZ4IO_MTchunkSize(io_prefs));
     cRess_t ress;
     memset(&ress, 0, sizeof(ress));
 
@@ -1071,6 +2340,7 @@ static cRess_t LZ4IO_createCResources(const LZ4IO_prefs_t* io_prefs)
     ress.preparedPrefs.frameInfo.blockChecksumFlag = (LZ4F_blockChecksum_t)io_prefs->blockChecksum;
     ress.preparedPrefs.frameInfo.contentChecksumFlag = (LZ4F_contentChecksum_t)io_prefs->streamChecksum;
     ress.preparedPrefs.favorDecSpeed = io_prefs->favorDecSpeed;
+    ress.preparedPrefs.skipIncompressible = io_prefs->skipIncompressible;
 
     /* Allocate compression state */
     {   LZ4F_errorCode_t const errorCode = LZ4F_createCompressionContext(&(ress.ctx), LZ4F_VERSION);
@@ -1080,9 +2350,10 @@ static cRess_t LZ4IO_createCResources(const LZ4IO_prefs_t* io_prefs)
     assert(ress.ctx != NULL);
 
     /* Allocate Buffers */
-    ress.srcBuffer = malloc(chunkSize);
+    ress.srcBuffer = LZ4IO_mallocSrcBuffer(chunkSize, io_prefs->directIO);
     ress.srcBufferSize = chunkSize;
-    ress.dstBufferSize = LZ4F_compressFrameBound(chunkSize, &ress.preparedPrefs);
+    ress.dstBufferSize = io_prefs->rsyncable ? LZ4IO_rsyncBound(chunkSize, &ress.preparedPrefs)
+                                             : LZ4F_compressFrameBound(chunkSize, &ress.preparedPrefs);
     ress.dstBuffer = malloc(ress.dstBufferSize);
     if (!ress.srcBuffer || !ress.dstBuffer)
         END_PROCESS(31, "Allocation error : can't allocate buffers");
@@ -1092,10 +2363,35 @@ static cRess_t LZ4IO_createCResources(const LZ4IO_prefs_t* io_prefs)
     /* will be created it needed */
     ress.tpool = NULL;
     ress.wpool = NULL;
+    ress.hpool = NULL;
 
     return ress;
 }
 
+/* LZ4IO_initMTResources() :
+ * threads and buffer pools of multi-threaded compression are created on first need,
+ * then stay alive, to be reused by all following files */
+static void LZ4IO_initMTResources(cRess_t* ress, const LZ4IO_prefs_t* io_prefs)
+{
+    if (ress->tpool == NULL) {
+        size_t const chunkSize = LZ4IO_MTchunkSize(io_prefs);
+        size_t const prefixSize = io_prefs->blockIndependence ? 0 : 64 KB;
+        ress->tpool = TPOOL_create_advanced(io_prefs->nbWorkers, LZ4IO_MTqueueSize(io_prefs), io_prefs->numaAware);
+        assert(ress->wpool == NULL);
+        ress->wpool = TPOOL_create(1, LZ4IO_MT_WQUEUE_SIZE);
+        if (ress->tpool == NULL || ress->wpool == NULL)
+            END_PROCESS(43, "can't create threadpools");
+        ress->pools = LZ4IO_createMTPools(chunkSize + prefixSize,
+                                          LZ4F_compressFrameBound(chunkSize, &ress->preparedPrefs),
+                                          LZ4IO_MTnbChunks(io_prefs), io_prefs->directIO);
+    }
+    if (io_prefs->streamChecksum && ress->hpool == NULL) {
+        ress->hpool = TPOOL_create(1, LZ4IO_MT_HQUEUE_SIZE);
+        if (ress->hpool == NULL)
+            END_PROCESS(43, "can't create checksum thread");
+    }
+}
+
 typedef struct {
     const LZ4F_preferences_t* prefs;
     const LZ4F_CDict* cdict;
@@ -1104,17 +2400,19 @@ typedef struct {
 static size_t LZ4IO_compressFrameChunk(const void* params,
                                     void* dst, size_t dstCapacity,
                                     const void* src, size_t srcSize,
-                                    size_t prefixSize)
+                                    size_t prefixSize, int cLevel)
 {
     const LZ4IO_CfcParameters* const cfcp = (const LZ4IO_CfcParameters*)params;
+    LZ4F_preferences_t prefs = *cfcp->prefs;
     LZ4F_cctx* cctx = NULL;
+    prefs.compressionLevel = cLevel;
     {   LZ4F_errorCode_t const ccr = LZ4F_createCompressionContext(&cctx, LZ4F_VERSION);
         if (cctx==NULL || LZ4F_isError(ccr))
             END_PROCESS(51, "unable to create a LZ4F compression context");
     }
     /* init state, and writes frame header, will be overwritten at next stage.
      * Also: no support for dictionary yet, meaning linked blocks are actually independent */
-    {   size_t const whr = LZ4F_compressBegin_usingCDict(cctx, dst, dstCapacity, cfcp->cdict, cfcp->prefs);
+    {   size_t const whr = LZ4F_compressBegin_usingCDict(cctx, dst, dstCapacity, cfcp->cdict, &prefs);
         if (LZ4F_isError(whr))
             END_PROCESS(52, "error initializing LZ4F compression context");
     }
@@ -1135,7 +2433,7 @@ static size_t LZ4IO_compressFrameChunk(const void* params,
  */
 int
 LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
-                               cRess_t ress,
+                               cRess_t* const ress,
                                const char* srcFileName, const char* dstFileName,
                                int compressionLevel,
                                const LZ4IO_prefs_t* const io_prefs)
@@ -1143,22 +2441,28 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
     unsigned long long filesize = 0;
     unsigned long long compressedfilesize = 0;
     FILE* dstFile;
-    void* const srcBuffer = ress.srcBuffer;
-    void* const dstBuffer = ress.dstBuffer;
-    const size_t dstBufferSize = ress.dstBufferSize;
-    const size_t chunkSize = 4 MB;  /* each job should be "sufficiently large" */
+    void* const srcBuffer = ress->srcBuffer;
+    void* const dstBuffer = ress->dstBuffer;
+    const size_t dstBufferSize = ress->dstBufferSize;
+    const size_t chunkSize = LZ4IO_MTchunkSize(io_prefs);
     size_t readSize;
-    LZ4F_compressionContext_t ctx = ress.ctx;   /* just a pointer */
+    const void* srcPtr;
+    LZ4F_compressionContext_t ctx = ress->ctx;   /* just a pointer */
     LZ4F_preferences_t prefs;
+    LZ4IO_SrcReader srcReader;
+    TIME_t readStart;
+    Duration_ns readTime;
 
     /* Init */
     FILE* const srcFile = LZ4IO_openSrcFile(srcFileName);
     if (srcFile == NULL) return 1;
     dstFile = LZ4IO_openDstFile(dstFileName, io_prefs);
     if (dstFile == NULL) { fclose(srcFile); return 1; }
+    srcReader = LZ4IO_initSrcReader(srcFile, io_prefs->directIO);
+    LZ4IO_setSrcLatency(&srcReader, io_prefs->flushInterval);
 
     /* Adjust compression parameters */
-    prefs = ress.preparedPrefs;
+    prefs = ress->preparedPrefs;
     prefs.compressionLevel = compressionLevel;
     if (io_prefs->contentSizeFlag) {
       U64 const fileSize = UTIL_getOpenFileSize(srcFile);
@@ -1168,18 +2472,23 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
     }
 
     /* read first chunk */
-    assert(chunkSize <= ress.srcBufferSize);
-    readSize  = fread(srcBuffer, (size_t)1, chunkSize, srcFile);
+    assert(chunkSize <= ress->srcBufferSize);
+    readStart = TIME_getTime();
+    srcPtr = LZ4IO_readSrc(&srcReader, srcBuffer, chunkSize, &readSize);
+    readTime = TIME_clockSpan_ns(readStart);
     if (ferror(srcFile))
         END_PROCESS(40, "Error reading first chunk (%u bytes) of '%s' ", (unsigned)chunkSize, srcFileName);
     filesize += readSize;
 
     /* single-block file */
-    if (readSize < chunkSize) {
+    if (srcReader.eof) {
         /* Compress in single pass */
-        size_t const cSize = LZ4F_compressFrame_usingCDict(ctx, dstBuffer, dstBufferSize, srcBuffer, readSize, ress.cdict, &prefs);
+        TIME_t const cStart = TIME_getTime();
+        size_t const cSize = LZ4F_compressFrame_usingCDict(ctx, dstBuffer, dstBufferSize, srcPtr, readSize, ress->cdict, &prefs);
         if (LZ4F_isError(cSize))
             END_PROCESS(41, "Compression failed : %s", LZ4F_getErrorName(cSize));
+        g_stats.codecTime += TIME_clockSpan_ns(cStart);
+        g_stats.readTime += readTime;   /* multiple-blocks files : accounted by write thread */
         compressedfilesize = cSize;
         DISPLAYUPDATE(2, "\rRead : %u MiB   ==> %.2f%%   ",
                       (unsigned)(filesize>>20), (double)compressedfilesize/(double)(filesize+!filesize)*100);   /* avoid division by zero */
@@ -1200,19 +2509,15 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
 
         LZ4IO_CfcParameters cfcp;
         ReadTracker rjd;
+        AdaptState adapt;
 
-        if (ress.tpool == NULL) {
-            ress.tpool = TPOOL_create(io_prefs->nbWorkers, 4);
-            assert(ress.wpool == NULL);
-            ress.wpool = TPOOL_create(1, 4);
-            if (ress.tpool == NULL || ress.wpool == NULL)
-                END_PROCESS(43, "can't create threadpools");
-        }
+        LZ4IO_initMTResources(ress, io_prefs);
         cfcp.prefs = &prefs;
-        cfcp.cdict = ress.cdict;
-        rjd.tpool = ress.tpool;
-        rjd.wpool = ress.wpool;
-        rjd.fin = srcFile;
+        cfcp.cdict = ress->cdict;
+        rjd.tpool = ress->tpool;
+        rjd.wpool = ress->wpool;
+        rjd.hpool = ress->hpool;
+        rjd.src = &srcReader;
         rjd.chunkSize = chunkSize;
         rjd.totalReadSize = 0;
         rjd.blockNb = 0;
@@ -1223,6 +2528,16 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
         rjd.fout = dstFile;
         rjd.wr = &wr;
         rjd.maxCBlockSize = LZ4F_compressFrameBound(chunkSize, &prefs);
+        rjd.cLevel = compressionLevel;
+        rjd.adapt = NULL;
+        rjd.pools = &ress->pools;
+        if (io_prefs->adapt) {
+            /* workers beyond nb of cores don't add compression capacity */
+            LZ4IO_adaptInit(&adapt, io_prefs, compressionLevel, MIN(io_prefs->nbWorkers, UTIL_countCores()));
+            rjd.cLevel = adapt.cLevel;
+            rjd.adapt = &adapt;
+            wr.adapt = &adapt;
+        }
 
         /* process frame checksum externally */
         if (checksum) {
@@ -1230,8 +2545,9 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
             if (xxh32==NULL)
                 END_PROCESS(42, "could not init checksum");
             XXH32_reset(xxh32, 0);
-            XXH32_update(xxh32, srcBuffer, readSize);
             rjd.xxh32 = xxh32;
+            /* srcBuffer remains valid until end of frame */
+            LZ4IO_submitChecksum(ress->hpool, &ress->pools, xxh32, srcPtr, readSize);
         }
 
         /* block dependency */
@@ -1252,13 +2568,17 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
                 END_PROCESS(45, "Write error : cannot write header");
             compressedfilesize = headerSize;
         }
+        wr.aio = AIO_create(dstFile, io_prefs->directIO);
+        wr.flush = (io_prefs->flushInterval != 0);
         /* avoid duplicating effort to process content checksum (done externally) */
         prefs.frameInfo.contentChecksumFlag = LZ4F_noContentChecksum;
 
         /* process first block */
         {   CompressJobDesc cjd;
-            cjd.wpool = ress.wpool;
-            cjd.buffer = srcBuffer;
+            cjd.wpool = ress->wpool;
+            cjd.hpool = NULL;   /* buffer not owned */
+            cjd.buffer = srcPtr;
+            cjd.ownedBuffer = NULL;
             cjd.prefixSize = 0;
             cjd.inSize = readSize;
             cjd.blockNb = 0;
@@ -1268,20 +2588,26 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
             cjd.wr = &wr;
             cjd.maxCBlockSize = rjd.maxCBlockSize;
             cjd.lastBlock = 0;
-            TPOOL_submitJob(ress.tpool, LZ4IO_compressChunk, &cjd);
+            cjd.cLevel = rjd.cLevel;
+            cjd.readTime = readTime;
+            cjd.pools = &ress->pools;
+            TPOOL_submitJob(ress->tpool, LZ4IO_compressChunk, &cjd);
             rjd.totalReadSize = readSize;
             rjd.blockNb = 1;
             if (prefixBuffer) {
-                assert(readSize >= 64 KB);
-                memcpy(prefixBuffer, (char*)srcBuffer + readSize - 64 KB, 64 KB);
+                /* a short first chunk (latency mode) only fills the end of prefix */
+                size_t const pSize = MIN(readSize, 64 KB);
+                memcpy((char*)prefixBuffer + 64 KB - pSize, (const char*)srcPtr + readSize - pSize, pSize);
             }
 
             /* Start the job chain */
-            TPOOL_submitJob(ress.tpool, LZ4IO_readAndProcess, &rjd);
+            TPOOL_submitJob_advanced(ress->tpool, LZ4IO_readAndProcess, &rjd, TPOOL_PRIORITY_HIGH);
 
             /* Wait for all completion */
-            TPOOL_completeJobs(ress.tpool);
-            TPOOL_completeJobs(ress.wpool);
+            TPOOL_completeJobs(ress->tpool);
+            if (checksum) TPOOL_completeJobs(ress->hpool);
+            TPOOL_completeJobs(ress->wpool);
+            if (wr.aio) AIO_finish(wr.aio, dstFile);
             compressedfilesize += wr.totalCSize;
         }
 
@@ -1309,6 +2635,7 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
     }
 
     /* Release file handlers */
+    LZ4IO_freeSrcReader(&srcReader);
     fclose (srcFile);
     if (!LZ4IO_isStdout(dstFileName)) fclose(dstFile);  /* do not close stdout */
 
@@ -1336,6 +2663,188 @@ LZ4IO_compressFilename_extRess_MT(unsigned long long* inStreamSize,
     return 0;
 }
 
+/* LZ4IO_writeSeekTable() :
+ * appends the seek table of the frame just completed by @ctx.
+ * @return : nb of bytes written (success or die) */
+static size_t LZ4IO_writeSeekTable(LZ4F_cctx* ctx, FILE* dstFile)
+{
+    size_t const tableCapacity = LZ4F_seekTableSize(ctx);
+    void* const table = malloc(tableCapacity);
+    size_t tableSize;
+    if (table == NULL) END_PROCESS(54, "Allocation error : not enough memory for seek table");
+    tableSize = LZ4F_writeSeekTable(ctx, table, tableCapacity);
+    if (LZ4F_isError(tableSize))
+        END_PROCESS(54, "Seek table generation failed : %s", LZ4F_getErrorName(tableSize));
+    if (fwrite(table, 1, tableSize, dstFile) != tableSize)
+        END_PROCESS(55, "Write error : cannot write seek table");
+    free(table);
+    return tableSize;
+}
+
+/* --append : the last frame of destination file is continued, instead of starting a new file */
+typedef struct {
+    LZ4F_frameInfo_t frameInfo;
+    unsigned long long blocksStart;   /* position of first block, 0 when there is no frame to continue */
+    unsigned long long endMark;       /* position of EndMark, where new blocks are written */
+} LZ4IO_appendPoint;
+
+/* LZ4IO_findAppendPoint() :
+ * walks the frames of @f from its beginning, reading frame and block headers only.
+ * The last frame must be an LZ4 frame, using independent blocks, without content size nor dictionary ID,
+ * and end the file. Exits on failure. */
+static LZ4IO_appendPoint LZ4IO_findAppendPoint(FILE* f, const char* fileName)
+{
+    LZ4IO_appendPoint ap;
+    unsigned long long pos = 0;
+    unsigned char header[LZ4F_HEADER_SIZE_MAX];
+    int lastIsFrame = 0;
+    LZ4F_dctx* dctx;
+
+    memset(&ap, 0, sizeof(ap));
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+        END_PROCESS(76, "Allocation error : can't create LZ4F context");
+    for (;;) {
+        size_t hSize = fread(header, 1, MAGICNUMBER_SIZE, f);
+        unsigned magicNumber;
+        if (hSize == 0 && feof(f)) break;
+        if (hSize != MAGICNUMBER_SIZE) END_PROCESS(77, "Error reading %s", fileName);
+        magicNumber = LZ4IO_readLE32(header);
+        if (LZ4IO_isSkippableMagicNumber(magicNumber)) {
+            if (fread(header, 1, 4, f) != 4) END_PROCESS(77, "Error reading %s", fileName);
+            pos += 8 + (unsigned long long)LZ4IO_readLE32(header);
+            if (UTIL_fseek(f, (S64)pos, SEEK_SET) != 0) END_PROCESS(77, "Error reading %s", fileName);
+            lastIsFrame = 0;
+            continue;
+        }
+        if (magicNumber != LZ4IO_MAGICNUMBER)
+            END_PROCESS(78, "%s: cannot append : not an LZ4 frame", fileName);
+
+        /* frame header */
+        if (fread(header + MAGICNUMBER_SIZE, 1, LZ4F_HEADER_SIZE_MIN - MAGICNUMBER_SIZE, f) != LZ4F_HEADER_SIZE_MIN - MAGICNUMBER_SIZE)
+            END_PROCESS(77, "Error reading %s", fileName);
+        hSize = LZ4F_headerSize(header, LZ4F_HEADER_SIZE_MIN);
+        if (LZ4F_isError(hSize)) END_PROCESS(78, "%s: cannot append : %s", fileName, LZ4F_getErrorName(hSize));
+        if (fread(header + LZ4F_HEADER_SIZE_MIN, 1, hSize - LZ4F_HEADER_SIZE_MIN, f) != hSize - LZ4F_HEADER_SIZE_MIN)
+            END_PROCESS(77, "Error reading %s", fileName);
+        LZ4F_resetDecompressionContext(dctx);
+        {   size_t const fiResult = LZ4F_getFrameInfo(dctx, &ap.frameInfo, header, &hSize);
+            if (LZ4F_isError(fiResult)) END_PROCESS(78, "%s: cannot append : %s", fileName, LZ4F_getErrorName(fiResult));
+        }
+        pos += hSize;
+        ap.blocksStart = pos;
+
+        /* block headers, up to EndMark */
+        {   size_t const maxBlockSize = LZ4F_getBlockSize(ap.frameInfo.blockSizeID);
+            unsigned long long const crcSize = ap.frameInfo.blockChecksumFlag ? LZ4F_BLOCK_CHECKSUM_SIZE : 0;
+            for (;;) {
+                size_t cSize;
+                if (fread(header, 1, LZ4F_BLOCK_HEADER_SIZE, f) != LZ4F_BLOCK_HEADER_SIZE)
+                    END_PROCESS(77, "Error reading %s : truncated frame", fileName);
+                cSize = LZ4IO_readLE32(header) & 0x7FFFFFFFU;
+                if (cSize == 0) break;   /* EndMark */
+                if (cSize > maxBlockSize) END_PROCESS(78, "%s: cannot append : corrupted block header", fileName);
+                pos += LZ4F_BLOCK_HEADER_SIZE + cSize + crcSize;
+                if (UTIL_fseek(f, (S64)pos, SEEK_SET) != 0) END_PROCESS(77, "Error reading %s", fileName);
+        }   }
+        ap.endMark = pos;
+        pos += LZ4F_BLOCK_HEADER_SIZE + (ap.frameInfo.contentChecksumFlag ? LZ4F_CONTENT_CHECKSUM_SIZE : 0);
+        if (UTIL_fseek(f, (S64)pos, SEEK_SET) != 0) END_PROCESS(77, "Error reading %s", fileName);
+        lastIsFrame = 1;
+    }
+    LZ4F_freeDecompressionContext(dctx);
+
+    /* seeking beyond end of file succeeds : check that last frame is complete */
+    if (UTIL_getOpenFileSize(f) != pos)
+        END_PROCESS(77, "Error reading %s : truncated frame", fileName);
+    if (pos > 0 && !lastIsFrame)
+        END_PROCESS(78, "%s: cannot append : last frame is followed by skippable frames (seek table ?)", fileName);
+    if (ap.blocksStart) {
+        if (ap.frameInfo.blockMode != LZ4F_blockIndependent)
+            END_PROCESS(78, "%s: cannot append : last frame uses linked blocks", fileName);
+        if (ap.frameInfo.contentSize || ap.frameInfo.dictID)
+            END_PROCESS(78, "%s: cannot append : last frame has a content size or a dictionary ID", fileName);
+    }
+    return ap;
+}
+
+/* LZ4IO_appendPriorFrame() :
+ * verifies block checksums of the frame continued by @ctx, if any.
+ * When the frame has a content checksum, blocks are also decoded, so that the new checksum covers them,
+ * and the prior checksum, stored after EndMark, is verified.
+ * Leaves @f positioned on EndMark. Exits on failure. */
+static void LZ4IO_appendPriorFrame(LZ4F_cctx* ctx, FILE* f, const char* fileName, const LZ4IO_appendPoint* ap)
+{
+    size_t const maxBlockSize = LZ4F_getBlockSize(ap->frameInfo.blockSizeID);
+    size_t const crcSize = ap->frameInfo.blockChecksumFlag ? LZ4F_BLOCK_CHECKSUM_SIZE : 0;
+    int const contentChecksum = (ap->frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled);
+    char* const cBuf = (char*)malloc(2 * maxBlockSize);
+    char* const dBuf = cBuf + maxBlockSize;
+    unsigned long long pos = ap->blocksStart;
+    XXH32_state_t xxh;
+
+    if (cBuf == NULL) END_PROCESS(76, "Allocation error : not enough memory");
+    XXH32_reset(&xxh, 0);
+    if (UTIL_fseek(f, (S64)pos, SEEK_SET) != 0) END_PROCESS(77, "Error reading %s", fileName);
+    while (pos < ap->endMark) {
+        unsigned char bh[LZ4F_BLOCK_HEADER_SIZE];
+        const char* decoded = cBuf;
+        size_t cSize;
+        int dSize;
+        if (fread(bh, 1, LZ4F_BLOCK_HEADER_SIZE, f) != LZ4F_BLOCK_HEADER_SIZE)
+            END_PROCESS(77, "Error reading %s", fileName);
+        cSize = LZ4IO_readLE32(bh) & 0x7FFFFFFFU;
+        assert(cSize <= maxBlockSize);   /* checked by LZ4IO_findAppendPoint() */
+        if (fread(cBuf, 1, cSize + crcSize, f) != cSize + crcSize)
+            END_PROCESS(77, "Error reading %s", fileName);
+        if (crcSize && LZ4IO_readLE32(cBuf + cSize) != XXH32(cBuf, cSize, 0))
+            END_PROCESS(79, "%s: cannot append : block checksum error", fileName);
+        pos += LZ4F_BLOCK_HEADER_SIZE + cSize + crcSize;
+        if (!contentChecksum) continue;
+        dSize = (int)cSize;
+        if (!(LZ4IO_readLE32(bh) & 0x80000000U)) {
+            dSize = LZ4_decompress_safe(cBuf, dBuf, (int)cSize, (int)maxBlockSize);
+            if (dSize < 0) END_PROCESS(79, "%s: cannot append : corrupted block", fileName);
+            decoded = dBuf;
+        }
+        XXH32_update(&xxh, decoded, (size_t)dSize);
+        {   size_t const r = LZ4F_appendPriorContent(ctx, decoded, (size_t)dSize);
+            if (LZ4F_isError(r)) END_PROCESS(79, "Append error : %s", LZ4F_getErrorName(r));
+    }   }
+    if (contentChecksum) {
+        /* EndMark, then content checksum */
+        if (fread(cBuf, 1, LZ4F_BLOCK_HEADER_SIZE + LZ4F_CONTENT_CHECKSUM_SIZE, f) != LZ4F_BLOCK_HEADER_SIZE + LZ4F_CONTENT_CHECKSUM_SIZE)
+            END_PROCESS(77, "Error reading %s", fileName);
+        if (LZ4IO_readLE32(cBuf + LZ4F_BLOCK_HEADER_SIZE) != XXH32_digest(&xxh))
+            END_PROCESS(79, "%s: cannot append : content checksum error", fileName);
+    }
+    if (UTIL_fseek(f, (S64)ap->endMark, SEEK_SET) != 0) END_PROCESS(77, "Error seeking %s", fileName);
+    free(cBuf);
+}
+
+/* LZ4IO_openAppendFile() :
+ * opens @dstFileName for --append, creating it when it doesn't exist.
+ * @ap receives the frame to continue, if any, in which case returned file is positioned on its EndMark.
+ * @result : FILE* to `dstFileName`, or NULL if it fails */
+static FILE*
+LZ4IO_openAppendFile(const char* dstFileName, const LZ4IO_prefs_t* const prefs, LZ4IO_appendPoint* ap)
+{
+    FILE* f;
+    memset(ap, 0, sizeof(*ap));
+    if (LZ4IO_isStdout(dstFileName) || LZ4IO_isDevNull(dstFileName) || !UTIL_isRegFile(dstFileName))
+        return LZ4IO_openDstFile(dstFileName, prefs);   /* nothing to continue */
+    f = fopen(dstFileName, "r+b");
+    if (f == NULL) {
+        DISPLAYLEVEL(1, "%s: %s\n", dstFileName, strerror(errno));
+        return NULL;
+    }
+    *ap = LZ4IO_findAppendPoint(f, dstFileName);
+    if (UTIL_fseek(f, (S64)(ap->blocksStart ? ap->endMark : 0), SEEK_SET) != 0)
+        END_PROCESS(77, "Error seeking %s", dstFileName);
+    if (ap->blocksStart)
+        DISPLAYLEVEL(3, "Appending to last frame of %s, from position %llu \n", dstFileName, ap->endMark);
+    return f;
+}
+
 /*
  * LZ4IO_compressFilename_extRess()
  * result : 0 : compression completed correctly
@@ -1354,39 +2863,79 @@ LZ4IO_compressFilename_extRess_ST(unsigned long long* inStreamSize,
     void* const srcBuffer = ress.srcBuffer;
     void* const dstBuffer = ress.dstBuffer;
     const size_t dstBufferSize = ress.dstBufferSize;
-    const size_t blockSize = io_prefs->blockSize;
+    size_t blockSize = io_prefs->blockSize;
     size_t readSize;
+    const void* srcPtr;
     LZ4F_compressionContext_t ctx = ress.ctx;   /* just a pointer */
     LZ4F_preferences_t prefs;
+    LZ4IO_SrcReader srcReader;
+    LZ4IO_Rsync rsync;
+    TIME_t readStart;
+    Duration_ns readTime;
+    LZ4IO_appendPoint ap;
 
     /* Init */
     FILE* const srcFile = LZ4IO_openSrcFile(srcFileName);
     if (srcFile == NULL) return 1;
-    dstFile = LZ4IO_openDstFile(dstFileName, io_prefs);
+    if (io_prefs->append) {
+        if (io_prefs->seekable || io_prefs->rsyncable || ress.cdict)
+            END_PROCESS(80, "--append is not compatible with --seekable, --rsyncable nor dictionaries");
+        dstFile = LZ4IO_openAppendFile(dstFileName, io_prefs, &ap);
+    } else {
+        memset(&ap, 0, sizeof(ap));
+        dstFile = LZ4IO_openDstFile(dstFileName, io_prefs);
+    }
     if (dstFile == NULL) { fclose(srcFile); return 1; }
+    srcReader = LZ4IO_initSrcReader(srcFile, io_prefs->directIO);
+    LZ4IO_setSrcLatency(&srcReader, io_prefs->flushInterval);
     memset(&prefs, 0, sizeof(prefs));
 
     /* Adjust compression parameters */
     prefs = ress.preparedPrefs;
     prefs.compressionLevel = compressionLevel;
-    if (io_prefs->contentSizeFlag) {
+    LZ4IO_rsyncInit(&rsync, blockSize);
+    if (io_prefs->rsyncable) {
+        /* blocks end at cut points, independently of read boundaries */
+        prefs.autoFlush = 0;
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    }
+    if (io_prefs->contentSizeFlag && !io_prefs->append) {
       U64 const fileSize = UTIL_getOpenFileSize(srcFile);
       prefs.frameInfo.contentSize = fileSize;   /* == 0 if input == stdin */
       if (fileSize==0)
           DISPLAYLEVEL(3, "Warning : cannot determine input content size \n");
     }
+    if (io_prefs->append) {
+        /* new frame must remain appendable */
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        if (ap.blocksStart) {
+            /* existing frame parameters prevail ; input is read by blocks of at most its block size,
+             * so that output of each update stays within dstBufferSize */
+            size_t const frameBlockSize = LZ4F_getBlockSize(ap.frameInfo.blockSizeID);
+            prefs.frameInfo = ap.frameInfo;
+            blockSize = MIN(blockSize, frameBlockSize);
+    }   }
+    {   size_t const sr = LZ4F_enableSeekTable(ctx, (unsigned)io_prefs->seekable);
+        if (LZ4F_isError(sr))
+            END_PROCESS(54, "Seek table setup failed : %s", LZ4F_getErrorName(sr));
+    }
 
     /* read first block */
-    readSize  = fread(srcBuffer, (size_t)1, blockSize, srcFile);
+    readStart = TIME_getTime();
+    srcPtr = LZ4IO_readSrc(&srcReader, srcBuffer, blockSize, &readSize);
+    readTime = TIME_clockSpan_ns(readStart);
+    g_stats.readTime += readTime;
     if (ferror(srcFile)) END_PROCESS(40, "Error reading %s ", srcFileName);
     filesize += readSize;
 
     /* single-block file */
-    if (readSize < blockSize) {
+    if (srcReader.eof && !io_prefs->rsyncable && !ap.blocksStart) {
         /* Compress in single pass */
-        size_t const cSize = LZ4F_compressFrame_usingCDict(ctx, dstBuffer, dstBufferSize, srcBuffer, readSize, ress.cdict, &prefs);
+        TIME_t const cStart = TIME_getTime();
+        size_t const cSize = LZ4F_compressFrame_usingCDict(ctx, dstBuffer, dstBufferSize, srcPtr, readSize, ress.cdict, &prefs);
         if (LZ4F_isError(cSize))
             END_PROCESS(41, "Compression failed : %s", LZ4F_getErrorName(cSize));
+        g_stats.codecTime += TIME_clockSpan_ns(cStart);
         compressedfilesize = cSize;
         DISPLAYUPDATE(2, "\rRead : %u MiB   ==> %.2f%%   ",
                       (unsigned)(filesize>>20), (double)compressedfilesize/(double)(filesize+!filesize)*100);   /* avoid division by zero */
@@ -1399,31 +2948,66 @@ LZ4IO_compressFilename_extRess_ST(unsigned long long* inStreamSize,
     else
 
     /* multiple-blocks file */
-    {
-        /* Write Frame Header */
-        size_t const headerSize = LZ4F_compressBegin_usingCDict(ctx, dstBuffer, dstBufferSize, ress.cdict, &prefs);
-        if (LZ4F_isError(headerSize))
-            END_PROCESS(43, "File header generation failed : %s", LZ4F_getErrorName(headerSize));
-        if (fwrite(dstBuffer, 1, headerSize, dstFile) != headerSize)
-            END_PROCESS(44, "Write error : cannot write header");
-        compressedfilesize += headerSize;
+    {   AdaptState adapt;
+        if (ap.blocksStart) {
+            /* continue existing frame : its header is already written */
+            size_t const r = LZ4F_compressBegin_append(ctx, &prefs);
+            if (LZ4F_isError(r))
+                END_PROCESS(43, "Append failed : %s", LZ4F_getErrorName(r));
+            if (prefs.frameInfo.contentChecksumFlag || prefs.frameInfo.blockChecksumFlag)
+                LZ4IO_appendPriorFrame(ctx, dstFile, dstFileName, &ap);
+        } else {
+            /* Write Frame Header */
+            size_t const headerSize = LZ4F_compressBegin_usingCDict(ctx, dstBuffer, dstBufferSize, ress.cdict, &prefs);
+            if (LZ4F_isError(headerSize))
+                END_PROCESS(43, "File header generation failed : %s", LZ4F_getErrorName(headerSize));
+            if (fwrite(dstBuffer, 1, headerSize, dstFile) != headerSize)
+                END_PROCESS(44, "Write error : cannot write header");
+            compressedfilesize += headerSize;
+        }
+        if (io_prefs->adapt)
+            LZ4IO_adaptInit(&adapt, io_prefs, compressionLevel, 0);
 
         /* Main Loop - one block at a time */
         while (readSize>0) {
-            size_t const outSize = LZ4F_compressUpdate(ctx, dstBuffer, dstBufferSize, srcBuffer, readSize, NULL);
+            TIME_t const cStart = TIME_getTime();
+            size_t const outSize = io_prefs->rsyncable ?
+                    LZ4IO_compressRsyncable(ctx, &rsync, dstBuffer, dstBufferSize, srcPtr, readSize) :
+                    LZ4F_compressUpdate(ctx, dstBuffer, dstBufferSize, srcPtr, readSize, NULL);
+            Duration_ns const cTime = TIME_clockSpan_ns(cStart);
+            TIME_t writeStart;
+            Duration_ns writeTime;
             if (LZ4F_isError(outSize))
                 END_PROCESS(45, "Compression failed : %s", LZ4F_getErrorName(outSize));
+            g_stats.codecTime += cTime;
             compressedfilesize += outSize;
             DISPLAYUPDATE(2, "\rRead : %u MiB   ==> %.2f%%   ",
                         (unsigned)(filesize>>20),
                         (double)compressedfilesize / (double)filesize * 100.);
 
             /* Write Block */
+            writeStart = TIME_getTime();
             if (fwrite(dstBuffer, 1, outSize, dstFile) != outSize)
                 END_PROCESS(46, "Write error : cannot write compressed block");
+            if (io_prefs->flushInterval && fflush(dstFile))
+                END_PROCESS(46, "Write error : cannot flush output");
+            writeTime = TIME_clockSpan_ns(writeStart);
+            g_stats.writerTime += writeTime;
+
+            if (io_prefs->adapt) {
+                int const prevLevel = adapt.cLevel;
+                int const newLevel = LZ4IO_adaptLevel(&adapt, readSize, cTime, readTime, writeTime);
+                if (newLevel != prevLevel) {
+                    size_t const lr = LZ4F_setCompressionLevel(ctx, newLevel);
+                    if (LZ4F_isError(lr))
+                        END_PROCESS(45, "Compression level change failed : %s", LZ4F_getErrorName(lr));
+            }   }
 
             /* Read next block */
-            readSize  = fread(srcBuffer, (size_t)1, (size_t)blockSize, srcFile);
+            readStart = TIME_getTime();
+            srcPtr = LZ4IO_readSrc(&srcReader, srcBuffer, blockSize, &readSize);
+            readTime = TIME_clockSpan_ns(readStart);
+            g_stats.readTime += readTime;
             filesize += readSize;
         }
         if (ferror(srcFile)) END_PROCESS(47, "Error reading %s ", srcFileName);
@@ -1438,13 +3022,18 @@ LZ4IO_compressFilename_extRess_ST(unsigned long long* inStreamSize,
         }
     }
 
+    if (io_prefs->seekable)
+        compressedfilesize += LZ4IO_writeSeekTable(ctx, dstFile);
+
     /* Release file handlers */
+    LZ4IO_freeSrcReader(&srcReader);
     fclose (srcFile);
     if (!LZ4IO_isStdout(dstFileName)) fclose(dstFile);  /* do not close stdout */
 
-    /* Copy owner, file permissions and modification time */
+    /* Copy owner, file permissions and modification time, unless destination holds other content (--append) */
     {   stat_t statbuf;
         if (!LZ4IO_isStdin(srcFileName)
+         && !io_prefs->append
          && !LZ4IO_isStdout(dstFileName)
          && !LZ4IO_isDevNull(dstFileName)
          && UTIL_getFileStat(srcFileName, &statbuf)) {
@@ -1468,20 +3057,25 @@ LZ4IO_compressFilename_extRess_ST(unsigned long long* inStreamSize,
 
 static int
 LZ4IO_compressFilename_extRess(unsigned long long* inStreamSize,
-                               cRess_t ress,
+                               cRess_t* const ress,
                                const char* srcFileName, const char* dstFileName,
                                int compressionLevel,
                                const LZ4IO_prefs_t* const io_prefs)
 {
+    if (io_prefs->adapt)
+        compressionLevel = MAX(MIN(compressionLevel, io_prefs->adaptMaxLevel), io_prefs->adaptMinLevel);
 #if LZ4IO_MULTITHREAD
     /* only employ multi-threading in the following scenarios: */
     if ( (io_prefs->nbWorkers != 1)
       && (io_prefs->blockIndependence == LZ4F_blockIndependent)  /* blocks must be independent */
+      && (!io_prefs->seekable)  /* seek table requires a single compression context */
+      && (!io_prefs->rsyncable)  /* cut points are found by a sequential scan */
+      && (!io_prefs->append)  /* continued frame is processed by a single compression context */
       )
         return LZ4IO_compressFilename_extRess_MT(inStreamSize, ress, srcFileName, dstFileName, compressionLevel, io_prefs);
 #endif
     /* Only single-thread available */
-    return LZ4IO_compressFilename_extRess_ST(inStreamSize, ress, srcFileName, dstFileName, compressionLevel, io_prefs);
+    return LZ4IO_compressFilename_extRess_ST(inStreamSize, *ress, srcFileName, dstFileName, compressionLevel, io_prefs);
 
 }
 
@@ -1489,32 +3083,287 @@ int LZ4IO_compressFilename(const char* srcFileName, const char* dstFileName, int
 {
     TIME_t const timeStart = TIME_getTime();
     clock_t const cpuStart = clock();
-    cRess_t const ress = LZ4IO_createCResources(prefs);
+    cRess_t ress = LZ4IO_createCResources(prefs);
     unsigned long long processed;
 
-    int const result = LZ4IO_compressFilename_extRess(&processed, ress, srcFileName, dstFileName, compressionLevel, prefs);
+    int const result = LZ4IO_compressFilename_extRess(&processed, &ress, srcFileName, dstFileName, compressionLevel, prefs);
 
     /* Free resources */
     LZ4IO_freeCResources(ress);
 
     /* Final Status */
-    LZ4IO_finalTimeDisplay(timeStart, cpuStart, processed);
+    LZ4IO_finalTimeDisplay(timeStart, cpuStart, processed, prefs->stats);
 
     return result;
 }
 
+/* File-level parallelism (-m) :
+ * small files are shared among workers, which process them whole, one after another,
+ * each worker reusing its own resources (cRess_t or dRess_t) from one file to the next.
+ * Meanwhile, the calling thread processes large files, using chunk-level parallelism.
+ * Workers don't update g_stats nor progress display, which belong to the calling thread :
+ * they keep their own statistics, merged once all workers are completed.
+ * A file a worker can't process exactly like the calling thread would (unusual content, or changed size)
+ * is handed back, to be processed again by the calling thread, once all workers are completed.
+ * Files are distributed statically, in round-robin order, which is balanced enough for large lists of files,
+ * and doesn't require any synchronization between workers. */
+#define LZ4IO_SMALL_FILE_SIZE (4 MB)   /* == chunkSize : smaller files are compressed in a single pass */
+#define LZ4IO_HANDBACK 2
+
+typedef enum { fs_worker = 0, fs_caller } LZ4IO_fileStatus_e;
+
+typedef struct LZ4IO_FileSet_s LZ4IO_FileSet;
+
+typedef struct {
+    const LZ4IO_FileSet* set;
+    int workerNb;            /* processes smallFiles[workerNb + n*nbWorkers] */
+    void* ress;              /* cRess_t or dRess_t, reused from one file to the next */
+    char* dstFileName;
+    size_t dstFileNameSize;
+    /* results */
+    int missed;
+    unsigned long long processed;
+    Duration_ns readTime;
+    Duration_ns codecTime;
+    Duration_ns outputTime;
+} LZ4IO_FileWorker;
+
+/* @return : 0 on success, 1 if file is missed, LZ4IO_HANDBACK */
+typedef int (*LZ4IO_fileJob_f)(LZ4IO_FileWorker* w, const char* srcFileName);
+
+struct LZ4IO_FileSet_s {
+    const char** fileNames;
+    unsigned char* status;   /* one LZ4IO_fileStatus_e per file, read-only while workers run */
+    unsigned char* handedBack;   /* 1 per file handed back; written by workers, read by caller once they are completed */
+    int* smallFiles;         /* indexes into fileNames */
+    int nbSmallFiles;
+    LZ4IO_FileWorker* workers;
+    int nbWorkers;
+    TPOOL_ctx* pool;
+    LZ4IO_fileJob_f processFile;
+    const char* suffix;
+    int cLevel;
+    const LZ4IO_prefs_t* prefs;
+};
+
+/* LZ4IO_FS_isCallerFile() :
+ * @return 1 if file @fileNb must be processed by the calling thread during @pass :
+ * pass 0 : files not distributed to workers (all files when @fs == NULL),
+ * pass 1 : files handed back by workers, only read after LZ4IO_FS_complete(). */
+static int LZ4IO_FS_isCallerFile(const LZ4IO_FileSet* fs, int fileNb, int pass)
+{
+    if (fs == NULL) return (pass == 0);
+    if (pass == 0) return fs->status[fileNb] == fs_caller;
+    return fs->handedBack[fileNb];
+}
+
+#if LZ4IO_MULTITHREAD
+
+/* LZ4IO_FS_create() :
+ * selects small regular files, as candidates for workers.
+ * When @srcSuffix != NULL, only files ending with @srcSuffix are selected.
+ * @return : NULL if there are not enough small files to employ multiple workers */
+static LZ4IO_FileSet*
+LZ4IO_FS_create(const char** fileNames, int nbFiles,
+                const char* srcSuffix, const char* suffix,
+                LZ4IO_fileJob_f processFile, const LZ4IO_prefs_t* prefs)
+{
+    LZ4IO_FileSet* const fs = (LZ4IO_FileSet*)calloc(1, sizeof(*fs));
+    int n;
+    if (fs == NULL) return NULL;
+    fs->status = (unsigned char*)malloc((size_t)nbFiles);
+    fs->handedBack = (unsigned char*)calloc((size_t)nbFiles, 1);
+    fs->smallFiles = (int*)malloc((size_t)nbFiles * sizeof(int));
+    if (!fs->status || !fs->handedBack || !fs->smallFiles) END_PROCESS(70, "Memory allocation error");
+    for (n = 0; n < nbFiles; n++) {
+        const char* const fileName = fileNames[n];
+        size_t const fnSize = strlen(fileName);
+        size_t const sfxSize = srcSuffix ? strlen(srcSuffix) : 0;
+        if ( (srcSuffix == NULL || (fnSize > sfxSize && UTIL_sameString(fileName + fnSize - sfxSize, srcSuffix)))
+          && !LZ4IO_isStdin(fileName)
+          && UTIL_isRegFile(fileName)
+          && (UTIL_getFileSize(fileName) < LZ4IO_SMALL_FILE_SIZE) ) {
+            fs->status[n] = fs_worker;
+            fs->smallFiles[fs->nbSmallFiles++] = n;
+        } else {
+            fs->status[n] = fs_caller;
+    }   }
+    if (fs->nbSmallFiles < 2) {
+        free(fs->status);
+        free(fs->handedBack);
+        free(fs->smallFiles);
+        free(fs);
+        return NULL;
+    }
+    fs->nbWorkers = MIN(prefs->nbWorkers, fs->nbSmallFiles);
+    fs->workers = (LZ4IO_FileWorker*)calloc((size_t)fs->nbWorkers, sizeof(LZ4IO_FileWorker));
+    fs->pool = TPOOL_create(fs->nbWorkers, fs->nbWorkers);
+    if (!fs->workers || !fs->pool) END_PROCESS(70, "can't create file workers");
+    for (n = 0; n < fs->nbWorkers; n++) {
+        fs->workers[n].set = fs;
+        fs->workers[n].workerNb = n;
+    }
+    fs->fileNames = fileNames;
+    fs->processFile = processFile;
+    fs->suffix = suffix;
+    fs->prefs = prefs;
+    return fs;
+}
+
+static void LZ4IO_FS_workerJob(void* arg)
+{
+    LZ4IO_FileWorker* const w = (LZ4IO_FileWorker*)arg;
+    const LZ4IO_FileSet* const fs = w->set;
+    int n;
+    for (n = w->workerNb; n < fs->nbSmallFiles; n += fs->nbWorkers) {
+        int const fileNb = fs->smallFiles[n];
+        int const r = fs->processFile(w, fs->fileNames[fileNb]);
+        if (r == LZ4IO_HANDBACK) {
+            fs->handedBack[fileNb] = 1;   /* only this worker writes this entry, and the caller doesn't read it until completion */
+        } else {
+            w->missed += r;
+    }   }
+}
+
+/* LZ4IO_FS_start() :
+ * all workers' resources must be set */
+static void LZ4IO_FS_start(LZ4IO_FileSet* fs)
+{
+    int n;
+    for (n = 0; n < fs->nbWorkers; n++) {
+        assert(fs->workers[n].ress != NULL);
+        TPOOL_submitJob(fs->pool, LZ4IO_FS_workerJob, &fs->workers[n]);
+    }
+}
+
+/* LZ4IO_FS_complete() :
+ * waits for all workers, and collects their results */
+static void LZ4IO_FS_complete(LZ4IO_FileSet* fs, int* missed, unsigned long long* processed)
+{
+    int n;
+    TPOOL_completeJobs(fs->pool);
+    for (n = 0; n < fs->nbWorkers; n++) {
+        LZ4IO_FileWorker* const w = &fs->workers[n];
+        *missed += w->missed;
+        *processed += w->processed;
+        g_stats.readTime += w->readTime;
+        g_stats.codecTime += w->codecTime;
+        g_stats.outputTime += w->outputTime;
+    }
+}
+
+static void LZ4IO_FS_free(LZ4IO_FileSet* fs)
+{
+    int n;
+    if (fs == NULL) return;
+    LZ4IO_freePool(fs->pool);
+    for (n = 0; n < fs->nbWorkers; n++)
+        free(fs->workers[n].dstFileName);
+    free(fs->workers);
+    free(fs->smallFiles);
+    free(fs->status);
+    free(fs->handedBack);
+    free(fs);
+}
+
+/* LZ4IO_FW_dstFileName() :
+ * @return : first @srcLen bytes of @srcFileName, followed by @appendix,
+ *           stored into worker's own buffer */
+static const char*
+LZ4IO_FW_dstFileName(LZ4IO_FileWorker* w, const char* srcFileName, size_t srcLen, const char* appendix)
+{
+    size_t const appLen = strlen(appendix);
+    if (w->dstFileNameSize <= srcLen + appLen) {
+        free(w->dstFileName);
+        w->dstFileNameSize = srcLen + appLen + 20;
+        w->dstFileName = (char*)malloc(w->dstFileNameSize);
+        if (w->dstFileName == NULL) END_PROCESS(71, "Memory allocation error");
+    }
+    memcpy(w->dstFileName, srcFileName, srcLen);
+    memcpy(w->dstFileName + srcLen, appendix, appLen + 1);
+    return w->dstFileName;
+}
+
+/* LZ4IO_FW_finishFile() :
+ * copies owner, file permissions and modification time to @dstFileName (when != NULL),
+ * then removes source file if requested (--rm) */
+static void
+LZ4IO_FW_finishFile(const char* srcFileName, const char* dstFileName, const LZ4IO_prefs_t* prefs)
+{
+    stat_t statbuf;
+    if (dstFileName != NULL && UTIL_getFileStat(srcFileName, &statbuf))
+        UTIL_setFileStat(dstFileName, &statbuf);
+    if (prefs->removeSrcFile) {  /* --rm */
+        if (remove(srcFileName))
+            END_PROCESS(50, "Remove error : %s: %s", srcFileName, strerror(errno));
+    }
+}
+
+/* LZ4IO_compressSmallFile() :
+ * compresses @srcFileName in a single pass, exactly like LZ4IO_compressFilename_extRess_MT() */
+static int LZ4IO_compressSmallFile(LZ4IO_FileWorker* w, const char* srcFileName)
+{
+    const cRess_t* const ress = (const cRess_t*)w->ress;
+    const LZ4IO_prefs_t* const io_prefs = w->set->prefs;
+    LZ4F_preferences_t prefs = ress->preparedPrefs;
+    const char* dstFileName;
+    FILE* dstFile;
+    size_t readSize;
+    size_t cSize;
+
+    /* read whole file */
+    {   TIME_t const readStart = TIME_getTime();
+        FILE* const srcFile = LZ4IO_openSrcFile(srcFileName);
+        if (srcFile == NULL) return 1;
+        readSize = fread(ress->srcBuffer, 1, ress->srcBufferSize, srcFile);
+        if (ferror(srcFile)) END_PROCESS(40, "Error reading %s ", srcFileName);
+        fclose(srcFile);
+        w->readTime += TIME_clockSpan_ns(readStart);
+        if (readSize >= ress->srcBufferSize) return LZ4IO_HANDBACK;   /* file grew since selection */
+    }
+
+    /* compress */
+    {   TIME_t const cStart = TIME_getTime();
+        prefs.compressionLevel = w->set->cLevel;
+        if (io_prefs->contentSizeFlag)
+            prefs.frameInfo.contentSize = readSize;
+        cSize = LZ4F_compressFrame_usingCDict(ress->ctx, ress->dstBuffer, ress->dstBufferSize, ress->srcBuffer, readSize, ress->cdict, &prefs);
+        if (LZ4F_isError(cSize))
+            END_PROCESS(41, "Compression failed : %s", LZ4F_getErrorName(cSize));
+        w->codecTime += TIME_clockSpan_ns(cStart);
+    }
+
+    /* write */
+    dstFileName = LZ4IO_FW_dstFileName(w, srcFileName, strlen(srcFileName), w->set->suffix);
+    dstFile = LZ4IO_openDstFile(dstFileName, io_prefs);
+    if (dstFile == NULL) return 1;
+    if (fwrite(ress->dstBuffer, 1, cSize, dstFile) != cSize)
+        END_PROCESS(42, "Write error : failed writing single-block compressed frame");
+    fclose(dstFile);
+    LZ4IO_FW_finishFile(srcFileName, dstFileName, io_prefs);
+
+    DISPLAYLEVEL(2, "%-30.30s : compressed %llu bytes into %llu bytes ==> %.2f%%\n",
+                    srcFileName, (unsigned long long)readSize, (unsigned long long)cSize,
+                    (double)cSize / (double)(readSize + !readSize /* avoid division by zero */ ) * 100.);
+    w->processed += readSize;
+    return 0;
+}
+
+#endif /* LZ4IO_MULTITHREAD */
+
 int LZ4IO_compressMultipleFilenames(
                               const char** inFileNamesTable, int ifntSize,
                               const char* suffix,
                               int compressionLevel,
                               const LZ4IO_prefs_t* prefs)
 {
-    int i;
+    int i, pass;
     int missed_files = 0;
     char* dstFileName = (char*)malloc(FNSPACE);
     size_t ofnSize = FNSPACE;
     const size_t suffixSize = strlen(suffix);
     cRess_t ress;
+    LZ4IO_FileSet* fs = NULL;
     unsigned long long totalProcessed = 0;
     TIME_t timeStart = TIME_getTime();
     clock_t cpuStart = clock();
@@ -1522,12 +3371,41 @@ int LZ4IO_compressMultipleFilenames(
     if (dstFileName == NULL) return ifntSize;   /* not enough memory */
     ress = LZ4IO_createCResources(prefs);
 
-    /* loop on each file */
+#if LZ4IO_MULTITHREAD
+    /* compress small files concurrently, with the same result as the MT path */
+    if ( (prefs->nbWorkers > 1)
+      && (prefs->blockIndependence == LZ4F_blockIndependent)
+      && (!prefs->seekable)
+      && (!prefs->rsyncable)
+      && (!LZ4IO_isStdout(suffix))
+      && (prefs->overwrite || g_displayLevel <= 1) )  /* no interaction from workers */
+        fs = LZ4IO_FS_create(inFileNamesTable, ifntSize, NULL, suffix, LZ4IO_compressSmallFile, prefs);
+    if (fs) {
+        LZ4IO_prefs_t workerPrefs = *prefs;
+        int w;
+        workerPrefs.useDictionary = 0;   /* dictionary is shared */
+        for (w = 0; w < fs->nbWorkers; w++) {
+            cRess_t* const wRess = (cRess_t*)malloc(sizeof(cRess_t));
+            if (wRess == NULL) END_PROCESS(70, "Memory allocation error");
+            *wRess = LZ4IO_createCResources(&workerPrefs);
+            wRess->cdict = ress.cdict;
+            fs->workers[w].ress = wRess;
+        }
+        fs->cLevel = compressionLevel;
+        if (prefs->adapt)
+            fs->cLevel = MAX(MIN(compressionLevel, prefs->adaptMaxLevel), prefs->adaptMinLevel);
+        LZ4IO_FS_start(fs);
+    }
+#endif
+
+    /* loop on each file : pass 1 processes files handed back by workers */
+    for (pass=0; pass<2; pass++) {
     for (i=0; i<ifntSize; i++) {
         unsigned long long processed;
         size_t const ifnSize = strlen(inFileNamesTable[i]);
+        if (!LZ4IO_FS_isCallerFile(fs, i, pass)) continue;
         if (LZ4IO_isStdout(suffix)) {
-            missed_files += LZ4IO_compressFilename_extRess(&processed, ress,
+            missed_files += LZ4IO_compressFilename_extRess(&processed, &ress,
                                     inFileNamesTable[i], stdoutmark,
                                     compressionLevel, prefs);
             totalProcessed += processed;
@@ -1545,16 +3423,31 @@ int LZ4IO_compressMultipleFilenames(
         strcpy(dstFileName, inFileNamesTable[i]);
         strcat(dstFileName, suffix);
 
-        missed_files += LZ4IO_compressFilename_extRess(&processed, ress,
+        missed_files += LZ4IO_compressFilename_extRess(&processed, &ress,
                                 inFileNamesTable[i], dstFileName,
                                 compressionLevel, prefs);
         totalProcessed += processed;
     }
+#if LZ4IO_MULTITHREAD
+    if (fs && pass==0) {
+        int w;
+        LZ4IO_FS_complete(fs, &missed_files, &totalProcessed);
+        for (w = 0; w < fs->nbWorkers; w++) {
+            cRess_t* const wRess = (cRess_t*)fs->workers[w].ress;
+            wRess->cdict = NULL;   /* owned by ress */
+            LZ4IO_freeCResources(*wRess);
+            free(wRess);
+    }   }
+#endif
+    }
 
     /* Close & Free */
+#if LZ4IO_MULTITHREAD
+    LZ4IO_FS_free(fs);
+#endif
     LZ4IO_freeCResources(ress);
     free(dstFileName);
-    LZ4IO_finalTimeDisplay(timeStart, cpuStart, totalProcessed);
+    LZ4IO_finalTimeDisplay(timeStart, cpuStart, totalProcessed, prefs->stats);
 
     return missed_files;
 }
@@ -1564,23 +3457,38 @@ int LZ4IO_compressMultipleFilenames(
 /* ********************** LZ4 file-stream Decompression **************** */
 /* ********************************************************************* */
 
-/* It's presumed that @p points to a memory space of size >= 4 */
-static unsigned LZ4IO_readLE32 (const void* p)
+
+/* LZ4IO_nbLeadingZeroWords() :
+ * @return : nb of leading zero words of @ptrT, up to @nbWords.
+ * Stripes of LZ4IO_ZERO_STRIPE bytes are tested at once, with an OR reduction
+ * which compilers vectorize (SSE2, NEON),
+ * since decoded output of disk images can be mostly zeros.
+ * Builds with LZ4_CPU_DISPATCH (see lib/lz4.h) also get variants for LZ4_CPU_DISPATCH_TARGETS. */
+#define LZ4IO_ZERO_STRIPE 128
+LZ4_MULTIVERSION
+static size_t LZ4IO_nbLeadingZeroWords(const size_t* ptrT, size_t nbWords)
 {
-    const unsigned char* const srcPtr = (const unsigned char*)p;
-    unsigned value32 = srcPtr[0];
-    value32 += (unsigned)srcPtr[1] <<  8;
-    value32 += (unsigned)srcPtr[2] << 16;
-    value32 += (unsigned)srcPtr[3] << 24;
-    return value32;
+    size_t const stripeT = LZ4IO_ZERO_STRIPE / sizeof(size_t);
+    size_t n = 0;
+    while (n + stripeT <= nbWords) {
+        size_t acc = 0;
+        size_t i;
+        for (i = 0; i < stripeT; i++) acc |= ptrT[n+i];
+        if (acc) break;
+        n += stripeT;
+    }
+    while ((n < nbWords) && (ptrT[n] == 0)) n++;
+    return n;
 }
 
-
+/* LZ4IO_writeSparse() :
+ * same as LZ4IO_fwriteSparse(), without statistics,
+ * so that it can be invoked from multiple threads */
 static unsigned
-LZ4IO_fwriteSparse(FILE* file,
-                   const void* buffer, size_t bufferSize,
-                   int sparseFileSupport,
-                   unsigned storedSkips)
+LZ4IO_writeSparse(FILE* file,
+                  const void* buffer, size_t bufferSize,
+                  int sparseFileSupport,
+                  unsigned storedSkips)
 {
     const size_t sizeT = sizeof(size_t);
     const size_t maskT = sizeT -1 ;
@@ -1611,7 +3519,7 @@ LZ4IO_fwriteSparse(FILE* file,
         /* count leading zeros */
         if (seg0SizeT > bufferSizeT) seg0SizeT = bufferSizeT;
         bufferSizeT -= seg0SizeT;
-        for (nb0T=0; (nb0T < seg0SizeT) && (ptrT[nb0T] == 0); nb0T++) ;
+        nb0T = LZ4IO_nbLeadingZeroWords(ptrT, seg0SizeT);
         storedSkips += (unsigned)(nb0T * sizeT);
 
         if (nb0T != seg0SizeT) {   /* not all 0s */
@@ -1647,6 +3555,18 @@ LZ4IO_fwriteSparse(FILE* file,
     return storedSkips;
 }
 
+static unsigned
+LZ4IO_fwriteSparse(FILE* file,
+                   const void* buffer, size_t bufferSize,
+                   int sparseFileSupport,
+                   unsigned storedSkips)
+{
+    TIME_t const writeStart = TIME_getTime();
+    storedSkips = LZ4IO_writeSparse(file, buffer, bufferSize, sparseFileSupport, storedSkips);
+    g_stats.outputTime += TIME_clockSpan_ns(writeStart);
+    return storedSkips;
+}
+
 static void LZ4IO_fwriteSparseEnd(FILE* file, unsigned storedSkips)
 {
     if (storedSkips>0) {   /* implies sparseFileSupport>0 */
@@ -1661,91 +3581,334 @@ static void LZ4IO_fwriteSparseEnd(FILE* file, unsigned storedSkips)
 
 static unsigned g_magicRead = 0;   /* out-parameter of LZ4IO_decodeLegacyStream() */
 
+#if !LZ4IO_MULTITHREAD
+
+static unsigned long long
+LZ4IO_decodeLegacyStream(FILE* finput, FILE* foutput, const LZ4IO_prefs_t* prefs)
+{
+    unsigned long long streamSize = 0;
+    unsigned storedSkips = 0;
+
+    /* Allocate Memory */
+    char* const in_buff  = (char*)malloc((size_t)LZ4_compressBound(LEGACY_BLOCKSIZE));
+    char* const out_buff = (char*)malloc(LEGACY_BLOCKSIZE);
+    if (!in_buff || !out_buff) END_PROCESS(61, "Allocation error : not enough memory");
+
+    /* Main Loop */
+    while (1) {
+        unsigned int blockSize;
+
+        /* Block Size */
+        {   size_t const sizeCheck = fread(in_buff, 1, LZ4IO_LEGACY_BLOCK_HEADER_SIZE, finput);
+            if (sizeCheck == 0) break;                   /* Nothing to read : file read is completed */
+            if (sizeCheck != LZ4IO_LEGACY_BLOCK_HEADER_SIZE)
+                END_PROCESS(62, "Error: cannot read block size in Legacy format");
+        }
+        blockSize = LZ4IO_readLE32(in_buff);       /* Convert to Little Endian */
+        if (blockSize > LZ4_COMPRESSBOUND(LEGACY_BLOCKSIZE)) {
+            /* Cannot read next block : maybe new stream ? */
+            g_magicRead = blockSize;
+            break;
+        }
+
+        /* Read Block */
+        { size_t const sizeCheck = fread(in_buff, 1, blockSize, finput);
+          if (sizeCheck != blockSize) END_PROCESS(63, "Read error : cannot access compressed block !"); }
+
+        /* Decode Block */
+        {   int const decodeSize = LZ4_decompress_safe(in_buff, out_buff, (int)blockSize, LEGACY_BLOCKSIZE);
+            if (decodeSize < 0) END_PROCESS(64, "Decoding Failed ! Corrupted input detected !");
+            streamSize += (unsigned long long)decodeSize;
+            /* Write Block */
+            storedSkips = LZ4IO_fwriteSparse(foutput, out_buff, (size_t)decodeSize, prefs->sparseFileSupport, storedSkips); /* success or die */
+    }   }
+    if (ferror(finput)) END_PROCESS(65, "Read error : ferror");
+
+    LZ4IO_fwriteSparseEnd(foutput, storedSkips);
+
+    /* Free */
+    free(in_buff);
+    free(out_buff);
+
+    return streamSize;
+}
+#endif
+
+
+typedef struct {
+    void*  srcBuffer;
+    size_t srcBufferSize;
+    void*  dstBuffer;
+    size_t dstBufferSize;
+    FILE*  dstFile;
+    LZ4F_decompressionContext_t dCtx;
+    void*  dictBuffer;
+    size_t dictBufferSize;
+    LZ4F_DDict* ddict;    /* prepared once, for all frames */
+    const char* srcMap;   /* mapped input, or NULL */
+    size_t srcMapSize;
+} dRess_t;
+
+static void LZ4IO_loadDDict(dRess_t* ress, const LZ4IO_prefs_t* const prefs)
+{
+    if (!prefs->useDictionary) {
+        ress->dictBuffer = NULL;
+        ress->dictBufferSize = 0;
+        ress->ddict = NULL;
+        return;
+    }
+
+    ress->dictBuffer = LZ4IO_createDict(&ress->dictBufferSize, prefs->dictionaryFilename);
+    if (!ress->dictBuffer) END_PROCESS(25, "Dictionary error : could not create dictionary");
+    ress->ddict = LZ4F_createDDict(ress->dictBuffer, ress->dictBufferSize);
+    if (!ress->ddict) END_PROCESS(25, "Dictionary error : could not create dictionary");
+}
+
+static const size_t LZ4IO_dBufferSize = 64 KB;
+static dRess_t LZ4IO_createDResources(const LZ4IO_prefs_t* const prefs)
+{
+    dRess_t ress;
+
+    /* init */
+    LZ4F_errorCode_t const errorCode = LZ4F_createDecompressionContext(&ress.dCtx, LZ4F_VERSION);
+    if (LZ4F_isError(errorCode)) END_PROCESS(60, "Can't create LZ4F context : %s", LZ4F_getErrorName(errorCode));
+
+    /* Allocate Memory */
+    ress.srcBufferSize = LZ4IO_dBufferSize;
+    ress.srcBuffer = malloc(ress.srcBufferSize);
+    ress.dstBufferSize = LZ4IO_dBufferSize;
+    ress.dstBuffer = malloc(ress.dstBufferSize);
+    if (!ress.srcBuffer || !ress.dstBuffer) END_PROCESS(61, "Allocation error : not enough memory");
+
+    LZ4IO_loadDDict(&ress, prefs);
+
+    ress.dstFile = NULL;
+    ress.srcMap = NULL;
+    ress.srcMapSize = 0;
+    return ress;
+}
+
+static void LZ4IO_freeDResources(dRess_t ress)
+{
+    LZ4F_errorCode_t errorCode = LZ4F_freeDecompressionContext(ress.dCtx);
+    if (LZ4F_isError(errorCode)) END_PROCESS(69, "Error : can't free LZ4F context resource : %s", LZ4F_getErrorName(errorCode));
+    free(ress.srcBuffer);
+    free(ress.dstBuffer);
+    free(ress.dictBuffer);
+    LZ4F_freeDDict(ress.ddict);
+}
+
+
 #if LZ4IO_MULTITHREAD
 
+/* Ordered sink for decoded blocks.
+ * Only accessed from the single write thread.
+ * In test mode, it only verifies content checksum, in order :
+ * nothing is written, and without content checksum, blocks are not even transmitted,
+ * only their decoded size. */
 typedef struct {
-    void* buffer;
+    WriteRegister wr;
+    FILE* out;
+    int testMode;
+    int sparseFileSupport;
+    unsigned storedSkips;
+    XXH32_state_t* xxh32;   /* NULL when content checksum is not verified */
+    unsigned long long decodedSize;
+} DecodedSink;
+
+typedef struct {
+    DecodedSink* sink;
+    void* buf;
     size_t size;
-    FILE* f;
-    int sparseEnable;
-    unsigned* storedSkips;
-} ChunkToWrite;
+    unsigned long long blockNb;
+    Duration_ns dTime;
+} DecodedBlockDesc;
 
-static void LZ4IO_writeDecodedChunk(void* arg)
+static void LZ4IO_writeDecodedBlock(DecodedSink* sink, const void* buf, size_t size)
 {
-    ChunkToWrite* const ctw = (ChunkToWrite*)arg;
-    assert(ctw != NULL);
+    assert(buf != NULL || (sink->testMode && sink->xxh32 == NULL));
+    if (sink->xxh32) {
+        TIME_t const hStart = TIME_getTime();
+        XXH32_update(sink->xxh32, buf, size);
+        g_stats.checksumTime += TIME_clockSpan_ns(hStart);
+    }
+    if (!sink->testMode)
+        sink->storedSkips = LZ4IO_fwriteSparse(sink->out, buf, size, sink->sparseFileSupport, sink->storedSkips); /* success or die */
+    sink->decodedSize += size;
+    DISPLAYUPDATE(2, "\rDecompressed : %u MiB  ", (unsigned)(sink->decodedSize>>20));
+}
 
-    /* note: works because only 1 thread */
-    *ctw->storedSkips = LZ4IO_fwriteSparse(ctw->f, ctw->buffer, ctw->size, ctw->sparseEnable, *ctw->storedSkips); /* success or die */
+static void LZ4IO_checkDecodedWriteOrder(void* arg)
+{
+    DecodedBlockDesc* const dbd = (DecodedBlockDesc*)arg;
+    DecodedSink* const sink = dbd->sink;
+    WriteRegister* const wr = &sink->wr;
+    TIME_t const writeStart = TIME_getTime();
+
+    g_stats.codecTime += dbd->dTime;
+    if (dbd->buf == NULL) {
+        /* test mode without content checksum : order doesn't matter */
+        LZ4IO_writeDecodedBlock(sink, NULL, dbd->size);
+        wr->expectedRank++;   /* counts blocks */
+        free(dbd);
+        g_stats.writerTime += TIME_clockSpan_ns(writeStart);
+        return;
+    }
+    if (dbd->blockNb != wr->expectedRank) {
+        /* incorrect order : let's store this buffer for later write */
+        BufferDesc bd;
+        bd.buf = dbd->buf;
+        bd.size = dbd->size;
+        bd.rank = dbd->blockNb;
+        WR_addBufDesc(wr, &bd);
+        free(dbd);  /* because dbd is pod */
+        g_stats.writerTime += TIME_clockSpan_ns(writeStart);
+        return;
+    }
+
+    /* expected block ID : let's write this block */
+    LZ4IO_writeDecodedBlock(sink, dbd->buf, dbd->size);
+    free(dbd->buf);
+    wr->expectedRank++;
+    /* and check for more blocks, previously saved */
+    while (WR_isPresent(wr, wr->expectedRank)) {
+        BufferDesc const bd = WR_getBufID(wr, wr->expectedRank);
+        LZ4IO_writeDecodedBlock(sink, bd.buf, bd.size);
+        WR_removeBuffID(wr, wr->expectedRank);
+        free(bd.buf);
+        wr->expectedRank++;
+    }
+    free(dbd);  /* because dbd is pod */
+    g_stats.writerTime += TIME_clockSpan_ns(writeStart);
+}
+
+/* LZ4IO_pushDecodedBlock() :
+ * hands decoded block over to the write thread, which takes ownership of @buf */
+static void LZ4IO_pushDecodedBlock(TPOOL_ctx* wPool, DecodedSink* sink,
+                                   void* buf, size_t size,
+                                   unsigned long long blockNb, Duration_ns dTime)
+{
+    DecodedBlockDesc* const dbd = (DecodedBlockDesc*)malloc(sizeof(*dbd));
+    if (dbd == NULL)
+        END_PROCESS(35, "Allocation error : can't describe new write job");
+    dbd->sink = sink;
+    dbd->buf = buf;
+    dbd->size = size;
+    dbd->blockNb = blockNb;
+    dbd->dTime = dTime;
+    TPOOL_submitJob(wPool, LZ4IO_checkDecodedWriteOrder, dbd);
+}
+
+typedef struct {
+    void* cBuf;             /* compressed block, followed by its checksum when present */
+    size_t cSize;
+    int isUncompressed;
+    int checkBlockCrc;
+    size_t maxBlockSize;
+    const char* dict;
+    size_t dictSize;
+    unsigned long long blockNb;
+    DecodedSink* sink;
+    TPOOL_ctx* wPool;
+} FrameBlockInput;
+
+static void LZ4IO_decompressFrameBlock(void* arg)
+{
+    FrameBlockInput* const fbi = (FrameBlockInput*)arg;
+    void* dBuf = fbi->cBuf;
+    size_t dSize = fbi->cSize;
+    TIME_t const dStart = TIME_getTime();
+
+    if (fbi->checkBlockCrc) {
+        unsigned const readCRC = LZ4IO_readLE32((const char*)fbi->cBuf + fbi->cSize);
+        unsigned const calcCRC = XXH32(fbi->cBuf, fbi->cSize, 0);
+        if (readCRC != calcCRC)
+            END_PROCESS(66, "Decompression error : block #%llu checksum mismatch", fbi->blockNb);
+    }
+
+    if (!fbi->isUncompressed) {
+        int decodedSize;
+        dBuf = malloc(fbi->maxBlockSize);
+        if (dBuf == NULL)
+            END_PROCESS(33, "Allocation error : can't allocate buffer to decode new block");
+        decodedSize = LZ4_decompress_safe_usingDict((const char*)fbi->cBuf, (char*)dBuf,
+                                (int)fbi->cSize, (int)fbi->maxBlockSize,
+                                fbi->dict, (int)fbi->dictSize);
+        if (decodedSize < 0)
+            END_PROCESS(66, "Decompression error : block #%llu is corrupted", fbi->blockNb);
+        dSize = (size_t)decodedSize;
+        free(fbi->cBuf);
+    }   /* uncompressed blocks are written directly from their read buffer */
+
+    if (fbi->sink->testMode && fbi->sink->xxh32 == NULL) {
+        /* block is verified : nothing left to do with its content */
+        free(dBuf);
+        dBuf = NULL;
+    }
+
+    LZ4IO_pushDecodedBlock(fbi->wPool, fbi->sink, dBuf, dSize, fbi->blockNb, TIME_clockSpan_ns(dStart));
 
     /* clean up */
-    free(ctw);
+    free(fbi);
 }
 
 typedef struct {
-    void* inBuffer;
-    size_t inSize;
-    void* outBuffer;
-    unsigned long long* totalSize;
+    void* cBuf;
+    size_t cSize;
+    unsigned long long blockNb;
+    DecodedSink* sink;
     TPOOL_ctx* wPool;
-    FILE* foutput;
-    int sparseEnable;
-    unsigned* storedSkips;
 } LegacyBlockInput;
 
 static void LZ4IO_decompressBlockLegacy(void* arg)
 {
-    int decodedSize;
     LegacyBlockInput* const lbi = (LegacyBlockInput*)arg;
+    TIME_t const dStart = TIME_getTime();
+    void* dBuf = malloc(LEGACY_BLOCKSIZE);
+    int decodedSize;
+    if (dBuf == NULL)
+        END_PROCESS(33, "Allocation error : can't allocate buffer to decode new block");
 
-    decodedSize = LZ4_decompress_safe((const char*)lbi->inBuffer, (char*)lbi->outBuffer, (int)lbi->inSize, LEGACY_BLOCKSIZE);
+    decodedSize = LZ4_decompress_safe((const char*)lbi->cBuf, (char*)dBuf, (int)lbi->cSize, LEGACY_BLOCKSIZE);
     if (decodedSize < 0) END_PROCESS(64, "Decoding Failed ! Corrupted input detected !");
-    *lbi->totalSize += (unsigned long long)decodedSize; /* note: works because only 1 thread */
-
-    /* push to write thread */
-    {   ChunkToWrite* const ctw = (ChunkToWrite*)malloc(sizeof(*ctw));
-        if (ctw==NULL) {
-            END_PROCESS(33, "Allocation error : can't describe new write job");
-        }
-        ctw->buffer = lbi->outBuffer;
-        ctw->size = (size_t)decodedSize;
-        ctw->f = lbi->foutput;
-        ctw->sparseEnable = lbi->sparseEnable;
-        ctw->storedSkips = lbi->storedSkips;
-        TPOOL_submitJob(lbi->wPool, LZ4IO_writeDecodedChunk, ctw);
+    free(lbi->cBuf);
+    if (lbi->sink->testMode) {
+        free(dBuf);
+        dBuf = NULL;
     }
 
+    LZ4IO_pushDecodedBlock(lbi->wPool, lbi->sink, dBuf, (size_t)decodedSize, lbi->blockNb, TIME_clockSpan_ns(dStart));
+
     /* clean up */
     free(lbi);
 }
 
+/* LZ4IO_decodeLegacyStream() :
+ * Legacy blocks are all independent :
+ * they are decoded by up to nbWorkers threads, then written in order by a single write thread. */
 static unsigned long long
 LZ4IO_decodeLegacyStream(FILE* finput, FILE* foutput, const LZ4IO_prefs_t* prefs)
 {
-    unsigned long long streamSize = 0;
-    unsigned storedSkips = 0;
-
-    TPOOL_ctx* const tPool = TPOOL_create(1, 1);
-    TPOOL_ctx* const wPool = TPOOL_create(1, 1);
-#define NB_BUFFSETS 4 /* 1 being read, 1 being processed, 1 being written, 1 being queued */
-    void* inBuffs[NB_BUFFSETS];
-    void* outBuffs[NB_BUFFSETS];
-    int bSetNb;
+    unsigned long long blockNb = 0;
+    DecodedSink sink;
 
+    TPOOL_ctx* const tPool = TPOOL_create_advanced(prefs->nbWorkers, 4, prefs->numaAware);
+    TPOOL_ctx* const wPool = TPOOL_create(1, 4);
     if (tPool == NULL || wPool == NULL)
         END_PROCESS(21, "threadpool creation error ");
-    /* allocate buffers up front */
 
-    for (bSetNb=0; bSetNb<NB_BUFFSETS; bSetNb++) {
-        inBuffs[bSetNb] = malloc((size_t)LZ4_compressBound(LEGACY_BLOCKSIZE));
-        outBuffs[bSetNb] = malloc(LEGACY_BLOCKSIZE);
-        if (!inBuffs[bSetNb] || !outBuffs[bSetNb])
-            END_PROCESS(31, "Allocation error : can't allocate buffer for legacy decoding");
-    }
+    sink.wr = WR_init(LEGACY_BLOCKSIZE);
+    if (sink.wr.buffers == NULL)
+        END_PROCESS(61, "Allocation error : not enough memory");
+    sink.out = foutput;
+    sink.testMode = prefs->testMode;
+    sink.sparseFileSupport = prefs->sparseFileSupport;
+    sink.storedSkips = 0;
+    sink.xxh32 = NULL;   /* legacy format has no checksum */
+    sink.decodedSize = 0;
 
     /* Main Loop */
-    for (bSetNb = 0;;bSetNb = (bSetNb+1) % NB_BUFFSETS) {
+    for (;;blockNb++) {
         char header[LZ4IO_LEGACY_BLOCK_HEADER_SIZE];
         unsigned int blockSize;
 
@@ -1762,154 +3925,521 @@ LZ4IO_decodeLegacyStream(FILE* finput, FILE* foutput, const LZ4IO_prefs_t* prefs
             break;
         }
 
-        /* Read Block */
-        {   size_t const sizeCheck = fread(inBuffs[bSetNb], 1, blockSize, finput);
-            if (sizeCheck != blockSize)
+        /* Read Block, and push it to decoding threads */
+        {   LegacyBlockInput* const lbi = (LegacyBlockInput*)malloc(sizeof(*lbi));
+            void* const cBuf = malloc(blockSize + !blockSize);
+            TIME_t const readStart = TIME_getTime();
+            if (lbi == NULL || cBuf == NULL)
+                END_PROCESS(64, "Allocation error : not enough memory to allocate job descriptor");
+            if (fread(cBuf, 1, blockSize, finput) != blockSize)
                 END_PROCESS(63, "Read error : cannot access compressed block !");
-            /* push to decoding thread */
-            {   LegacyBlockInput* const lbi = (LegacyBlockInput*)malloc(sizeof(*lbi));
-                if (lbi==NULL)
-                    END_PROCESS(64, "Allocation error : not enough memory to allocate job descriptor");
-                lbi->inBuffer = inBuffs[bSetNb];
-                lbi->inSize = blockSize;
-                lbi->outBuffer = outBuffs[bSetNb];
-                lbi->wPool = wPool;
-                lbi->totalSize = &streamSize;
-                lbi->foutput = foutput;
-                lbi->sparseEnable = prefs->sparseFileSupport;
-                lbi->storedSkips = &storedSkips;
-                TPOOL_submitJob(tPool, LZ4IO_decompressBlockLegacy, lbi);
-            }
-        }
-    }
+            g_stats.readTime += TIME_clockSpan_ns(readStart);
+            lbi->cBuf = cBuf;
+            lbi->cSize = blockSize;
+            lbi->blockNb = blockNb;
+            lbi->sink = &sink;
+            lbi->wPool = wPool;
+            TPOOL_submitJob(tPool, LZ4IO_decompressBlockLegacy, lbi);
+    }   }
     if (ferror(finput)) END_PROCESS(65, "Read error : ferror");
 
     /* Wait for all completion */
     TPOOL_completeJobs(tPool);
     TPOOL_completeJobs(wPool);
+    assert(sink.wr.expectedRank == blockNb);
 
     /* flush last zeroes */
-    LZ4IO_fwriteSparseEnd(foutput, storedSkips);
+    if (!prefs->testMode) LZ4IO_fwriteSparseEnd(foutput, sink.storedSkips);
 
     /* Free */
-    TPOOL_free(wPool);
-    TPOOL_free(tPool);
-    for (bSetNb=0; bSetNb<NB_BUFFSETS; bSetNb++) {
-        free(inBuffs[bSetNb]);
-        free(outBuffs[bSetNb]);
-    }
+    LZ4IO_freePool(wPool);
+    LZ4IO_freePool(tPool);
+    WR_destroy(&sink.wr);
 
-    return streamSize;
+    return sink.decodedSize;
 }
 
-#else
+/* only the last 64 KB of dictionary are reachable by matches of independent blocks */
+static void LZ4IO_trimDict(const char** dict, size_t* dictSize, const dRess_t* ress)
+{
+    *dict = (const char*)ress->dictBuffer;
+    *dictSize = ress->dictBufferSize;
+    if (*dictSize > 64 KB) {
+        *dict += *dictSize - 64 KB;
+        *dictSize = 64 KB;
+    }
+}
 
+/* LZ4IO_decompressLZ4F_MT() :
+ * Decodes a frame of independent blocks, whose header was already parsed into @frameInfo.
+ * Block headers are read serially, then each block is decoded and verified by a worker,
+ * while a single write thread emits results in their original order. */
 static unsigned long long
-LZ4IO_decodeLegacyStream(FILE* finput, FILE* foutput, const LZ4IO_prefs_t* prefs)
+LZ4IO_decompressLZ4F_MT(dRess_t ress,
+                        FILE* const srcFile, FILE* const dstFile,
+                        const LZ4F_frameInfo_t* frameInfo,
+                        const LZ4IO_prefs_t* const prefs)
 {
-    unsigned long long streamSize = 0;
-    unsigned storedSkips = 0;
-
-    /* Allocate Memory */
-    char* const in_buff  = (char*)malloc((size_t)LZ4_compressBound(LEGACY_BLOCKSIZE));
-    char* const out_buff = (char*)malloc(LEGACY_BLOCKSIZE);
-    if (!in_buff || !out_buff) END_PROCESS(61, "Allocation error : not enough memory");
+    size_t const maxBlockSize = LZ4F_getBlockSize(frameInfo->blockSizeID);
+    int const skipCrc = (prefs->blockChecksum==0) && (prefs->streamChecksum==0);
+    int const checkBlockCrc = frameInfo->blockChecksumFlag && !skipCrc;
+    size_t const crcSize = frameInfo->blockChecksumFlag ? LZ4F_BLOCK_CHECKSUM_SIZE : 0;
+    const char* dict;
+    size_t dictSize;
+    unsigned long long blockNb = 0;
+    XXH32_state_t* xxh32 = NULL;
+    DecodedSink sink;
+
+    TPOOL_ctx* const tPool = TPOOL_create_advanced(prefs->nbWorkers, 4, prefs->numaAware);
+    TPOOL_ctx* const wPool = TPOOL_create(1, 4);
+    if (tPool == NULL || wPool == NULL)
+        END_PROCESS(21, "threadpool creation error ");
+    if (LZ4F_isError(maxBlockSize))
+        END_PROCESS(62, "Header error : %s", LZ4F_getErrorName(maxBlockSize));
+    DISPLAYLEVEL(4, "Decoding independent blocks using %i threads \n", prefs->nbWorkers);
+    LZ4IO_trimDict(&dict, &dictSize, &ress);
 
-    /* Main Loop */
-    while (1) {
-        unsigned int blockSize;
 
-        /* Block Size */
-        {   size_t const sizeCheck = fread(in_buff, 1, LZ4IO_LEGACY_BLOCK_HEADER_SIZE, finput);
-            if (sizeCheck == 0) break;                   /* Nothing to read : file read is completed */
-            if (sizeCheck != LZ4IO_LEGACY_BLOCK_HEADER_SIZE)
-                END_PROCESS(62, "Error: cannot read block size in Legacy format");
-        }
-        blockSize = LZ4IO_readLE32(in_buff);       /* Convert to Little Endian */
-        if (blockSize > LZ4_COMPRESSBOUND(LEGACY_BLOCKSIZE)) {
-            /* Cannot read next block : maybe new stream ? */
-            g_magicRead = blockSize;
-            break;
-        }
+    if (frameInfo->contentChecksumFlag && !skipCrc) {
+        xxh32 = XXH32_createState();
+        if (xxh32 == NULL)
+            END_PROCESS(61, "Allocation error : could not init checksum");
+        XXH32_reset(xxh32, 0);
+    }
 
-        /* Read Block */
-        { size_t const sizeCheck = fread(in_buff, 1, blockSize, finput);
-          if (sizeCheck != blockSize) END_PROCESS(63, "Read error : cannot access compressed block !"); }
+    sink.wr = WR_init(maxBlockSize);
+    if (sink.wr.buffers == NULL)
+        END_PROCESS(61, "Allocation error : not enough memory");
+    sink.out = dstFile;
+    sink.testMode = prefs->testMode;
+    sink.sparseFileSupport = prefs->sparseFileSupport;
+    sink.storedSkips = 0;
+    sink.xxh32 = xxh32;
+    sink.decodedSize = 0;
 
-        /* Decode Block */
-        {   int const decodeSize = LZ4_decompress_safe(in_buff, out_buff, (int)blockSize, LEGACY_BLOCKSIZE);
-            if (decodeSize < 0) END_PROCESS(64, "Decoding Failed ! Corrupted input detected !");
-            streamSize += (unsigned long long)decodeSize;
-            /* Write Block */
-            storedSkips = LZ4IO_fwriteSparse(foutput, out_buff, (size_t)decodeSize, prefs->sparseFileSupport, storedSkips); /* success or die */
+    /* Main Loop */
+    for (;;blockNb++) {
+        unsigned char header[LZ4F_BLOCK_HEADER_SIZE];
+        unsigned blockHeader;
+        size_t cSize;
+
+        if (fread(header, 1, LZ4F_BLOCK_HEADER_SIZE, srcFile) != LZ4F_BLOCK_HEADER_SIZE)
+            END_PROCESS(68, "Unfinished stream : cannot read block header");
+        blockHeader = LZ4IO_readLE32(header);
+        if (blockHeader == 0) break;   /* endMark */
+        cSize = blockHeader & 0x7FFFFFFFU;
+        if (cSize > maxBlockSize)
+            END_PROCESS(66, "Decompression error : block #%llu has invalid size", blockNb);
+
+        {   FrameBlockInput* const fbi = (FrameBlockInput*)malloc(sizeof(*fbi));
+            void* const cBuf = malloc(cSize + crcSize);
+            TIME_t const readStart = TIME_getTime();
+            if (fbi == NULL || cBuf == NULL)
+                END_PROCESS(64, "Allocation error : not enough memory to allocate decoding job");
+            if (fread(cBuf, 1, cSize + crcSize, srcFile) != cSize + crcSize)
+                END_PROCESS(63, "Read error : cannot access compressed block !");
+            g_stats.readTime += TIME_clockSpan_ns(readStart);
+            fbi->cBuf = cBuf;
+            fbi->cSize = cSize;
+            fbi->isUncompressed = (blockHeader >> 31) != 0;
+            fbi->checkBlockCrc = checkBlockCrc;
+            fbi->maxBlockSize = maxBlockSize;
+            fbi->dict = dict;
+            fbi->dictSize = dictSize;
+            fbi->blockNb = blockNb;
+            fbi->sink = &sink;
+            fbi->wPool = wPool;
+            TPOOL_submitJob(tPool, LZ4IO_decompressFrameBlock, fbi);
     }   }
-    if (ferror(finput)) END_PROCESS(65, "Read error : ferror");
 
-    LZ4IO_fwriteSparseEnd(foutput, storedSkips);
+    /* Wait for all completion */
+    TPOOL_completeJobs(tPool);
+    TPOOL_completeJobs(wPool);
+    assert(sink.wr.expectedRank == blockNb);
+
+    /* Content checksum */
+    if (frameInfo->contentChecksumFlag) {
+        unsigned char crcBuf[LZ4F_CONTENT_CHECKSUM_SIZE];
+        if (fread(crcBuf, 1, LZ4F_CONTENT_CHECKSUM_SIZE, srcFile) != LZ4F_CONTENT_CHECKSUM_SIZE)
+            END_PROCESS(68, "Unfinished stream : cannot read content checksum");
+        if (xxh32 && (LZ4IO_readLE32(crcBuf) != XXH32_digest(xxh32)))
+            END_PROCESS(66, "Decompression error : %s", LZ4F_getErrorName((size_t)-LZ4F_ERROR_contentChecksum_invalid));
+    }
+    if (frameInfo->contentSize && (frameInfo->contentSize != sink.decodedSize))
+        END_PROCESS(66, "Decompression error : %s", LZ4F_getErrorName((size_t)-LZ4F_ERROR_frameSize_wrong));
+
+    if (!prefs->testMode) LZ4IO_fwriteSparseEnd(dstFile, sink.storedSkips);
+
+    /* dctx only parsed the header : make it ready for next frame */
+    LZ4F_resetDecompressionContext(ress.dCtx);
 
     /* Free */
-    free(in_buff);
-    free(out_buff);
+    LZ4IO_freePool(wPool);
+    LZ4IO_freePool(tPool);
+    WR_destroy(&sink.wr);
+    XXH32_freeState(xxh32);
+
+    return sink.decodedSize;
+}
+
+/* Seekable frames :
+ * when a seek table follows the frame, block positions are known up front.
+ * Output is then cut into ranges of blocks, each decoded by a worker,
+ * which writes its result directly at its final position in the destination file.
+ * Requires positional I/O (pread / pwrite). */
+#if (PLATFORM_POSIX_VERSION >= 200112L)
+#  define LZ4IO_SEEKABLE_MT 1
+#else
+#  define LZ4IO_SEEKABLE_MT 0
+#endif
+
+#if LZ4IO_SEEKABLE_MT
+
+#define LZ4IO_SEEKABLE_RANGE_SIZE (4 MB)   /* each job should be "sufficiently large" */
+#define LZ4IO_SPARSE_SEGMENT_SIZE (32 KB)
+
+typedef struct {
+    int srcFd;
+    int dstFd;              /* < 0 in test mode */
+    int sparseMode;
+    int checkBlockCrc;
+    size_t crcSize;
+    size_t maxBlockSize;
+    const char* dict;
+    size_t dictSize;
+    const unsigned char* entries;   /* seek table entries */
+    DecodedSink* sink;      /* NULL when content checksum is not verified */
+    TPOOL_ctx* wPool;
+} SeekableFrame;
+
+typedef struct {
+    const SeekableFrame* frame;
+    size_t firstBlock;
+    size_t nbBlocks;
+    unsigned long long srcPos;
+    unsigned long long dstPos;
+    size_t cSize;
+    size_t dSize;
+    unsigned long long rangeNb;
+} SeekableRangeInput;
+
+static void LZ4IO_preadAll(int fd, void* buf, size_t size, unsigned long long pos)
+{
+    char* p = (char*)buf;
+    while (size) {
+        ssize_t const r = pread(fd, p, size, (off_t)pos);
+        if (r <= 0) END_PROCESS(63, "Read error : cannot access compressed block : %s", strerror(errno));
+        p += r; size -= (size_t)r; pos += (size_t)r;
+    }
+}
+
+static void LZ4IO_pwriteAll(int fd, const void* buf, size_t size, unsigned long long pos)
+{
+    const char* p = (const char*)buf;
+    while (size) {
+        ssize_t const r = pwrite(fd, p, size, (off_t)pos);
+        if (r <= 0) END_PROCESS(70, "Write error : cannot write decoded block : %s", strerror(errno));
+        p += r; size -= (size_t)r; pos += (size_t)r;
+    }
+}
+
+static int LZ4IO_isZeroSegment(const char* p, size_t size)
+{
+    size_t n;
+    for (n=0; n<size; n++) if (p[n]) return 0;
+    return 1;
+}
 
-    return streamSize;
+/* LZ4IO_pwriteSparse() :
+ * in sparse mode, segments of zeroes are not written, leaving holes.
+ * File size must be set later on, since trailing holes don't extend the file. */
+static void LZ4IO_pwriteSparse(int fd, const void* buf, size_t size, unsigned long long pos, int sparseMode)
+{
+    const char* const start = (const char*)buf;
+    size_t runStart = 0;
+    size_t segStart;
+    if (!sparseMode) { LZ4IO_pwriteAll(fd, buf, size, pos); return; }
+    for (segStart = 0; segStart < size; segStart += LZ4IO_SPARSE_SEGMENT_SIZE) {
+        size_t const segSize = MIN(LZ4IO_SPARSE_SEGMENT_SIZE, size - segStart);
+        if (LZ4IO_isZeroSegment(start + segStart, segSize)) {
+            if (segStart > runStart)
+                LZ4IO_pwriteAll(fd, start + runStart, segStart - runStart, pos + runStart);
+            runStart = segStart + segSize;
+    }   }
+    if (size > runStart)
+        LZ4IO_pwriteAll(fd, start + runStart, size - runStart, pos + runStart);
 }
-#endif
 
+#define LZ4IO_CHECKSUM_BATCH 8   /* block checksums verified together, one per XXH32_multi() lane */
 
-typedef struct {
-    void*  srcBuffer;
-    size_t srcBufferSize;
-    void*  dstBuffer;
-    size_t dstBufferSize;
-    FILE*  dstFile;
-    LZ4F_decompressionContext_t dCtx;
-    void*  dictBuffer;
-    size_t dictBufferSize;
-} dRess_t;
+/* LZ4IO_verifyBlockChecksums() :
+ * verifies checksums of blocks [@firstBlock, @firstBlock+@nbBlocks[, stored consecutively at @cBuf,
+ * which must hold them entirely. */
+static void LZ4IO_verifyBlockChecksums(const SeekableFrame* frame, const char* cBuf, size_t cBufSize,
+                                       size_t firstBlock, size_t nbBlocks)
+{
+    const void* blocks[LZ4IO_CHECKSUM_BATCH] = { NULL };
+    size_t cSizes[LZ4IO_CHECKSUM_BATCH] = { 0 };
+    XXH32_hash_t crcs[LZ4IO_CHECKSUM_BATCH];
+    size_t cPos = 0, n;
+    assert(nbBlocks <= LZ4IO_CHECKSUM_BATCH);
+
+    for (n = 0; n < nbBlocks; n++) {
+        size_t const cBlockSize = LZ4IO_readLE32(frame->entries + (firstBlock + n) * LZ4F_SEEKTABLE_ENTRY_SIZE);
+        size_t const cSize = (cBufSize - cPos >= LZ4F_BLOCK_HEADER_SIZE) ? LZ4IO_readLE32(cBuf + cPos) & 0x7FFFFFFFU : 0;
+        if ((cBlockSize > cBufSize - cPos) || (cBlockSize != LZ4F_BLOCK_HEADER_SIZE + cSize + frame->crcSize))
+            END_PROCESS(66, "Decompression error : block #%u doesn't match seek table", (unsigned)(firstBlock + n));
+        blocks[n] = cBuf + cPos + LZ4F_BLOCK_HEADER_SIZE;
+        cSizes[n] = cSize;
+        cPos += cBlockSize;
+    }
+    XXH32_multi(blocks, cSizes, nbBlocks, 0, crcs);
+    for (n = 0; n < nbBlocks; n++) {
+        if (LZ4IO_readLE32((const char*)blocks[n] + cSizes[n]) != crcs[n])
+            END_PROCESS(66, "Decompression error : block #%u checksum mismatch", (unsigned)(firstBlock + n));
+    }
+}
 
-static void LZ4IO_loadDDict(dRess_t* ress, const LZ4IO_prefs_t* const prefs)
+static void LZ4IO_decompressSeekableRange(void* arg)
 {
-    if (!prefs->useDictionary) {
-        ress->dictBuffer = NULL;
-        ress->dictBufferSize = 0;
-        return;
+    SeekableRangeInput* const sri = (SeekableRangeInput*)arg;
+    const SeekableFrame* const frame = sri->frame;
+    char* const cBuf = (char*)malloc(sri->cSize);
+    char* const dBuf = (char*)malloc(sri->dSize + !sri->dSize);
+    size_t cPos = 0, dPos = 0, n;
+    TIME_t dStart;
+    Duration_ns dTime;
+
+    if (cBuf == NULL || dBuf == NULL)
+        END_PROCESS(64, "Allocation error : not enough memory to allocate decoding job");
+    LZ4IO_preadAll(frame->srcFd, cBuf, sri->cSize, sri->srcPos);
+    dStart = TIME_getTime();
+
+    for (n = sri->firstBlock; n < sri->firstBlock + sri->nbBlocks; n++) {
+        const unsigned char* const entry = frame->entries + n * LZ4F_SEEKTABLE_ENTRY_SIZE;
+        size_t const cBlockSize = LZ4IO_readLE32(entry);
+        size_t const dBlockSize = LZ4IO_readLE32(entry + 4);
+        unsigned const blockHeader = LZ4IO_readLE32(cBuf + cPos);
+        size_t const cSize = blockHeader & 0x7FFFFFFFU;
+        const char* const cData = cBuf + cPos + LZ4F_BLOCK_HEADER_SIZE;
+        if (cBlockSize != LZ4F_BLOCK_HEADER_SIZE + cSize + frame->crcSize)
+            END_PROCESS(66, "Decompression error : block #%u doesn't match seek table", (unsigned)n);
+
+        if (frame->checkBlockCrc && ((n - sri->firstBlock) % LZ4IO_CHECKSUM_BATCH == 0)) {
+            size_t const batch = MIN(LZ4IO_CHECKSUM_BATCH, sri->firstBlock + sri->nbBlocks - n);
+            LZ4IO_verifyBlockChecksums(frame, cBuf + cPos, sri->cSize - cPos, n, batch);
+        }
+
+        if (blockHeader >> 31) {   /* uncompressed block */
+            if (cSize != dBlockSize)
+                END_PROCESS(66, "Decompression error : block #%u doesn't match seek table", (unsigned)n);
+            memcpy(dBuf + dPos, cData, cSize);
+        } else {
+            int const decodedSize = LZ4_decompress_safe_usingDict(cData, dBuf + dPos,
+                                    (int)cSize, (int)dBlockSize,
+                                    frame->dict, (int)frame->dictSize);
+            if ((decodedSize < 0) || ((size_t)decodedSize != dBlockSize))
+                END_PROCESS(66, "Decompression error : block #%u is corrupted", (unsigned)n);
+        }
+        cPos += cBlockSize;
+        dPos += dBlockSize;
+    }
+    assert(cPos == sri->cSize);
+    assert(dPos == sri->dSize);
+    free(cBuf);
+    dTime = TIME_clockSpan_ns(dStart);
+
+    if (frame->dstFd >= 0)
+        LZ4IO_pwriteSparse(frame->dstFd, dBuf, sri->dSize, sri->dstPos, frame->sparseMode);
+
+    if (frame->sink) {
+        /* content checksum must be calculated in order.
+         * note : ranges decoded without content checksum are not accounted */
+        LZ4IO_pushDecodedBlock(frame->wPool, frame->sink, dBuf, sri->dSize, sri->rangeNb, dTime);
+    } else {
+        free(dBuf);
     }
 
-    ress->dictBuffer = LZ4IO_createDict(&ress->dictBufferSize, prefs->dictionaryFilename);
-    if (!ress->dictBuffer) END_PROCESS(25, "Dictionary error : could not create dictionary");
+    free(sri);
 }
 
-static const size_t LZ4IO_dBufferSize = 64 KB;
-static dRess_t LZ4IO_createDResources(const LZ4IO_prefs_t* const prefs)
+/* LZ4IO_decompressSeekableLZ4F() :
+ * Decodes a frame of independent blocks followed by its seek table,
+ * whose header was already parsed into @frameInfo.
+ * @return : 1 if frame was decoded, and its decoded size is written into *decodedSize,
+ *           0 if a matching seek table is not present, or if files do not allow positional I/O.
+ *             In which case, srcFile position is unmodified. */
+static int
+LZ4IO_decompressSeekableLZ4F(unsigned long long* decodedSize,
+                             dRess_t ress,
+                             FILE* const srcFile, FILE* const dstFile,
+                             const LZ4F_frameInfo_t* frameInfo,
+                             const LZ4IO_prefs_t* const prefs)
 {
-    dRess_t ress;
+    size_t const maxBlockSize = LZ4F_getBlockSize(frameInfo->blockSizeID);
+    int const skipCrc = (prefs->blockChecksum==0) && (prefs->streamChecksum==0);
+    size_t const contentCrcSize = frameInfo->contentChecksumFlag ? LZ4F_CONTENT_CHECKSUM_SIZE : 0;
+    int const srcFd = UTIL_fileno(srcFile);
+    int const dstFd = prefs->testMode ? -1 : UTIL_fileno(dstFile);
+    unsigned long long const fileSize = UTIL_getOpenFileSize(srcFile);
+    unsigned long long const blocksStart = (unsigned long long)ftello(srcFile);
+    unsigned long long dstStart = 0;
+    unsigned long long cTotal = 0, dTotal = 0;
+    unsigned char footer[LZ4F_SEEKTABLE_FOOTER_SIZE];
+    unsigned char* table;
+    size_t tableSize, nbBlocks, n;
+    XXH32_state_t* xxh32 = NULL;
+    DecodedSink sink;
+    SeekableFrame frame;
+
+    /* positional I/O requires regular files */
+    if (LZ4F_isError(maxBlockSize)) return 0;
+    if (!UTIL_isRegFD(srcFd)) return 0;
+    if ((dstFd >= 0) && !UTIL_isRegFD(dstFd)) return 0;
+
+    /* locate seek table, at the end of srcFile */
+    if (fileSize < blocksStart + LZ4F_BLOCK_HEADER_SIZE + 8 + LZ4F_SEEKTABLE_FOOTER_SIZE) return 0;
+    LZ4IO_preadAll(srcFd, footer, LZ4F_SEEKTABLE_FOOTER_SIZE, fileSize - LZ4F_SEEKTABLE_FOOTER_SIZE);
+    tableSize = LZ4F_seekTableFrameSize(footer, LZ4F_SEEKTABLE_FOOTER_SIZE);
+    if (LZ4F_isError(tableSize)) return 0;
+    if (tableSize > fileSize - blocksStart - LZ4F_BLOCK_HEADER_SIZE) return 0;
+    table = (unsigned char*)malloc(tableSize);
+    if (table == NULL) END_PROCESS(61, "Allocation error : not enough memory for seek table");
+    LZ4IO_preadAll(srcFd, table, tableSize, fileSize - tableSize);
+    nbBlocks = (tableSize - 8 - LZ4F_SEEKTABLE_FOOTER_SIZE) / LZ4F_SEEKTABLE_ENTRY_SIZE;
+
+    /* check seek table matches this frame */
+    {   int valid = (LZ4IO_readLE32(table) == LZ4F_SEEKTABLE_MAGICNUMBER)
+                 && (LZ4IO_readLE32(table + 4) == tableSize - 8);
+        for (n = 0; valid && n < nbBlocks; n++) {
+            size_t const cBlockSize = LZ4IO_readLE32(table + 8 + n * LZ4F_SEEKTABLE_ENTRY_SIZE);
+            size_t const dBlockSize = LZ4IO_readLE32(table + 8 + n * LZ4F_SEEKTABLE_ENTRY_SIZE + 4);
+            valid = (cBlockSize >= LZ4F_BLOCK_HEADER_SIZE) && (dBlockSize <= maxBlockSize);
+            cTotal += cBlockSize;
+            dTotal += dBlockSize;
+        }
+        if (valid) valid = (blocksStart + cTotal + LZ4F_BLOCK_HEADER_SIZE + contentCrcSize + tableSize == fileSize);
+        if (valid) {
+            unsigned char endMark[LZ4F_BLOCK_HEADER_SIZE];
+            LZ4IO_preadAll(srcFd, endMark, LZ4F_BLOCK_HEADER_SIZE, blocksStart + cTotal);
+            valid = (LZ4IO_readLE32(endMark) == 0);
+        }
+        if (!valid) {
+            DISPLAYLEVEL(4, "Seek table doesn't match frame : ignored \n");
+            free(table);
+            return 0;
+    }   }
+    if (frameInfo->contentSize && (frameInfo->contentSize != dTotal))
+        END_PROCESS(66, "Decompression error : %s", LZ4F_getErrorName((size_t)-LZ4F_ERROR_frameSize_wrong));
+    DISPLAYLEVEL(4, "Decoding %u indexed blocks using %i threads \n", (unsigned)nbBlocks, prefs->nbWorkers);
+
+    /* destination : write after data already generated */
+    if (dstFd >= 0) {
+        if (fflush(dstFile)) END_PROCESS(70, "Write error : cannot flush output : %s", strerror(errno));
+        dstStart = (unsigned long long)ftello(dstFile);
+    }
 
-    /* init */
-    LZ4F_errorCode_t const errorCode = LZ4F_createDecompressionContext(&ress.dCtx, LZ4F_VERSION);
-    if (LZ4F_isError(errorCode)) END_PROCESS(60, "Can't create LZ4F context : %s", LZ4F_getErrorName(errorCode));
+    frame.srcFd = srcFd;
+    frame.dstFd = dstFd;
+    frame.sparseMode = prefs->sparseFileSupport > 0;
+    frame.checkBlockCrc = frameInfo->blockChecksumFlag && !skipCrc;
+    frame.crcSize = frameInfo->blockChecksumFlag ? LZ4F_BLOCK_CHECKSUM_SIZE : 0;
+    frame.maxBlockSize = maxBlockSize;
+    LZ4IO_trimDict(&frame.dict, &frame.dictSize, &ress);
+    frame.entries = table + 8;
+    frame.sink = NULL;
+    frame.wPool = NULL;
+
+    if (frameInfo->contentChecksumFlag && !skipCrc) {
+        xxh32 = XXH32_createState();
+        if (xxh32 == NULL)
+            END_PROCESS(61, "Allocation error : could not init checksum");
+        XXH32_reset(xxh32, 0);
+        sink.wr = WR_init(LZ4IO_SEEKABLE_RANGE_SIZE);
+        if (sink.wr.buffers == NULL)
+            END_PROCESS(61, "Allocation error : not enough memory");
+        sink.out = NULL;
+        sink.testMode = 1;   /* only checksum and progress : ranges are already written */
+        sink.sparseFileSupport = 0;
+        sink.storedSkips = 0;
+        sink.xxh32 = xxh32;
+        sink.decodedSize = 0;
+        frame.sink = &sink;
+        frame.wPool = TPOOL_create(1, 4);
+        if (frame.wPool == NULL)
+            END_PROCESS(21, "threadpool creation error ");
+    }
 
-    /* Allocate Memory */
-    ress.srcBufferSize = LZ4IO_dBufferSize;
-    ress.srcBuffer = malloc(ress.srcBufferSize);
-    ress.dstBufferSize = LZ4IO_dBufferSize;
-    ress.dstBuffer = malloc(ress.dstBufferSize);
-    if (!ress.srcBuffer || !ress.dstBuffer) END_PROCESS(61, "Allocation error : not enough memory");
+    /* cut frame into ranges of blocks, and decode them */
+    {   TPOOL_ctx* const tPool = TPOOL_create_advanced(prefs->nbWorkers, 4, prefs->numaAware);
+        unsigned long long srcPos = blocksStart;
+        unsigned long long dstPos = dstStart;
+        unsigned long long rangeNb = 0;
+        size_t firstBlock = 0;
+        size_t cSize = 0, dSize = 0;
+        if (tPool == NULL)
+            END_PROCESS(21, "threadpool creation error ");
+        for (n = 0; n < nbBlocks; n++) {
+            cSize += LZ4IO_readLE32(frame.entries + n * LZ4F_SEEKTABLE_ENTRY_SIZE);
+            dSize += LZ4IO_readLE32(frame.entries + n * LZ4F_SEEKTABLE_ENTRY_SIZE + 4);
+            if ((dSize >= LZ4IO_SEEKABLE_RANGE_SIZE) || (n == nbBlocks-1)) {
+                SeekableRangeInput* const sri = (SeekableRangeInput*)malloc(sizeof(*sri));
+                if (sri == NULL)
+                    END_PROCESS(64, "Allocation error : not enough memory to allocate decoding job");
+                sri->frame = &frame;
+                sri->firstBlock = firstBlock;
+                sri->nbBlocks = n + 1 - firstBlock;
+                sri->srcPos = srcPos;
+                sri->dstPos = dstPos;
+                sri->cSize = cSize;
+                sri->dSize = dSize;
+                sri->rangeNb = rangeNb++;
+                TPOOL_submitJob(tPool, LZ4IO_decompressSeekableRange, sri);
+                srcPos += cSize;
+                dstPos += dSize;
+                firstBlock = n + 1;
+                cSize = dSize = 0;
+        }   }
+        TPOOL_completeJobs(tPool);
+        LZ4IO_freePool(tPool);
+    }
 
-    LZ4IO_loadDDict(&ress, prefs);
+    /* Content checksum */
+    if (frame.sink) {
+        TPOOL_completeJobs(frame.wPool);
+        LZ4IO_freePool(frame.wPool);
+        assert(sink.decodedSize == dTotal);
+        {   unsigned char crcBuf[LZ4F_CONTENT_CHECKSUM_SIZE];
+            LZ4IO_preadAll(srcFd, crcBuf, LZ4F_CONTENT_CHECKSUM_SIZE, blocksStart + cTotal + LZ4F_BLOCK_HEADER_SIZE);
+            if (LZ4IO_readLE32(crcBuf) != XXH32_digest(xxh32))
+                END_PROCESS(66, "Decompression error : %s", LZ4F_getErrorName((size_t)-LZ4F_ERROR_contentChecksum_invalid));
+        }
+        WR_destroy(&sink.wr);
+        XXH32_freeState(xxh32);
+    }
 
-    ress.dstFile = NULL;
-    return ress;
-}
+    /* sparse holes at end of frame don't extend file : set its size explicitly */
+    if (dstFd >= 0) {
+        if (frame.sparseMode && ftruncate(dstFd, (off_t)(dstStart + dTotal)))
+            END_PROCESS(70, "Write error : cannot set output size : %s", strerror(errno));
+        if (UTIL_fseek(dstFile, (long long)(dstStart + dTotal), SEEK_SET))
+            END_PROCESS(70, "Write error : cannot seek to end of output");
+    }
+    /* both frame and its seek table are consumed */
+    if (UTIL_fseek(srcFile, (long long)fileSize, SEEK_SET))
+        END_PROCESS(67, "Read error : cannot seek to end of input");
 
-static void LZ4IO_freeDResources(dRess_t ress)
-{
-    LZ4F_errorCode_t errorCode = LZ4F_freeDecompressionContext(ress.dCtx);
-    if (LZ4F_isError(errorCode)) END_PROCESS(69, "Error : can't free LZ4F context resource : %s", LZ4F_getErrorName(errorCode));
-    free(ress.srcBuffer);
-    free(ress.dstBuffer);
-    free(ress.dictBuffer);
+    /* dctx only parsed the header : make it ready for next frame */
+    LZ4F_resetDecompressionContext(ress.dCtx);
+    free(table);
+
+    *decodedSize = dTotal;
+    return 1;
 }
 
+#endif /* LZ4IO_SEEKABLE_MT */
+
+#endif /* LZ4IO_MULTITHREAD */
 
 static unsigned long long
 LZ4IO_decompressLZ4F(dRess_t ress,
@@ -1924,39 +4454,109 @@ LZ4IO_decompressLZ4F(dRess_t ress,
         ((prefs->blockChecksum==0) && (prefs->streamChecksum==0)) ?
         &dOpt_skipCrc : NULL;
 
+#if LZ4IO_MULTITHREAD
+    if (prefs->nbWorkers > 1) {
+        /* decode frame header up front, to select the decoding strategy */
+        LZ4F_frameInfo_t frameInfo;
+        char* const hBuffer = (char*)ress.srcBuffer;
+        size_t hSize = LZ4F_MIN_SIZE_TO_KNOW_HEADER_LENGTH;
+        LZ4IO_writeLE32(hBuffer, LZ4IO_MAGICNUMBER);   /* already consumed from FILE* sFile */
+        if (fread(hBuffer + MAGICNUMBER_SIZE, 1, hSize - MAGICNUMBER_SIZE, srcFile) != hSize - MAGICNUMBER_SIZE)
+            END_PROCESS(62, "Header error : cannot read frame header");
+        {   size_t const fullHSize = LZ4F_headerSize(hBuffer, hSize);
+            if (LZ4F_isError(fullHSize))
+                END_PROCESS(62, "Header error : %s", LZ4F_getErrorName(fullHSize));
+            if (fread(hBuffer + hSize, 1, fullHSize - hSize, srcFile) != fullHSize - hSize)
+                END_PROCESS(62, "Header error : cannot read frame header");
+            hSize = fullHSize;
+        }
+        nextToLoad = LZ4F_getFrameInfo(ress.dCtx, &frameInfo, hBuffer, &hSize);
+        if (LZ4F_isError(nextToLoad))
+            END_PROCESS(62, "Header error : %s", LZ4F_getErrorName(nextToLoad));
+        if (frameInfo.blockMode == LZ4F_blockIndependent) {
+#if LZ4IO_SEEKABLE_MT
+            unsigned long long decodedSize;
+            if (LZ4IO_decompressSeekableLZ4F(&decodedSize, ress, srcFile, dstFile, &frameInfo, prefs))
+                return decodedSize;
+#endif
+            return LZ4IO_decompressLZ4F_MT(ress, srcFile, dstFile, &frameInfo, prefs);
+        }
+        /* linked blocks : continue with serial decoding */
+    } else
+#endif
     /* Init feed with magic number (already consumed from FILE* sFile) */
     {   size_t inSize = MAGICNUMBER_SIZE;
         size_t outSize= 0;
         LZ4IO_writeLE32(ress.srcBuffer, LZ4IO_MAGICNUMBER);
-        nextToLoad = LZ4F_decompress_usingDict(ress.dCtx,
+        nextToLoad = LZ4F_decompress_usingDDict(ress.dCtx,
                             ress.dstBuffer, &outSize,
                             ress.srcBuffer, &inSize,
-                            ress.dictBuffer, ress.dictBufferSize,
-                            dOptPtr);  /* set it once, it's enough */
+                            ress.ddict,
+                            dOptPtr);
         if (LZ4F_isError(nextToLoad))
             END_PROCESS(62, "Header error : %s", LZ4F_getErrorName(nextToLoad));
     }
 
+#if LZ4IO_USE_MMAP
+    if (ress.srcMap != NULL) {
+        /* mapped input : feed the decoder directly from the mapping.
+         * dst is large enough for any block, so that blocks are also decoded directly into it */
+        size_t const dstCapacity = 4 MB;
+        char* const dstBuffer = (char*)malloc(dstCapacity);
+        size_t pos = (size_t)ftello(srcFile);
+        size_t decodedBytes = dstCapacity;
+        if (dstBuffer == NULL) END_PROCESS(61, "Allocation error : not enough memory");
+        while (nextToLoad && ((pos < ress.srcMapSize) || (decodedBytes == dstCapacity))) {
+            size_t remaining = ress.srcMapSize - pos;
+            TIME_t const dStart = TIME_getTime();
+            decodedBytes = dstCapacity;
+            nextToLoad = LZ4F_decompress_usingDDict(ress.dCtx,
+                                    dstBuffer, &decodedBytes,
+                                    ress.srcMap + pos, &remaining,
+                                    ress.ddict,
+                                    dOptPtr);
+            g_stats.codecTime += TIME_clockSpan_ns(dStart);
+            if (LZ4F_isError(nextToLoad))
+                END_PROCESS(66, "Decompression error : %s", LZ4F_getErrorName(nextToLoad));
+            pos += remaining;
+
+            /* Write Block */
+            if (decodedBytes) {
+                if (!prefs->testMode)
+                    storedSkips = LZ4IO_fwriteSparse(dstFile, dstBuffer, decodedBytes, prefs->sparseFileSupport, storedSkips);
+                filesize += decodedBytes;
+                DISPLAYUPDATE(2, "\rDecompressed : %u MiB  ", (unsigned)(filesize>>20));
+            }
+        }
+        free(dstBuffer);
+        /* resume stream reading after this frame */
+        if (UTIL_fseek(srcFile, (long long)pos, SEEK_SET)) END_PROCESS(67, "Read error");
+    } else
+#endif
     /* Main Loop */
     for (;nextToLoad;) {
         size_t readSize;
         size_t pos = 0;
         size_t decodedBytes = ress.dstBufferSize;
+        TIME_t const readStart = TIME_getTime();
 
         /* Read input */
         if (nextToLoad > ress.srcBufferSize) nextToLoad = ress.srcBufferSize;
         readSize = fread(ress.srcBuffer, 1, nextToLoad, srcFile);
+        g_stats.readTime += TIME_clockSpan_ns(readStart);
         if (!readSize) break;   /* reached end of file or stream */
 
         while ((pos < readSize) || (decodedBytes == ress.dstBufferSize)) {  /* still to read, or still to flush */
             /* Decode Input (at least partially) */
             size_t remaining = readSize - pos;
+            TIME_t const dStart = TIME_getTime();
             decodedBytes = ress.dstBufferSize;
-            nextToLoad = LZ4F_decompress_usingDict(ress.dCtx,
+            nextToLoad = LZ4F_decompress_usingDDict(ress.dCtx,
                                     ress.dstBuffer, &decodedBytes,
                                     (char*)(ress.srcBuffer)+pos, &remaining,
-                                    ress.dictBuffer, ress.dictBufferSize,
-                                    NULL);
+                                    ress.ddict,
+                                    dOptPtr);
+            g_stats.codecTime += TIME_clockSpan_ns(dStart);
             if (LZ4F_isError(nextToLoad))
                 END_PROCESS(66, "Decompression error : %s", LZ4F_getErrorName(nextToLoad));
             pos += remaining;
@@ -2129,8 +4729,12 @@ LZ4IO_decompressSrcFile(unsigned long long* outGenSize,
 
     /* Init */
     FILE* const finput = LZ4IO_openSrcFile(input_filename);
+    LZ4IO_SrcReader srcReader;
     if (finput==NULL) return 1;
     assert(foutput != NULL);
+    srcReader = LZ4IO_initSrcReader(finput, 0);   /* direct I/O : compression only */
+    ress.srcMap = srcReader.map;
+    ress.srcMapSize = srcReader.mapSize;
 
     /* Loop over multiple streams */
     for ( ; ; ) {  /* endless loop, see break condition */
@@ -2142,6 +4746,7 @@ LZ4IO_decompressSrcFile(unsigned long long* outGenSize,
     }
 
     /* Close input */
+    LZ4IO_freeSrcReader(&srcReader);
     fclose(finput);
     if (prefs->removeSrcFile) {  /* --rm */
         if (remove(input_filename))
@@ -2204,22 +4809,134 @@ int LZ4IO_decompressFilename(const char* input_filename, const char* output_file
     unsigned long long processed = 0;
 
     int const errStat = LZ4IO_decompressDstFile(&processed, ress, input_filename, output_filename, prefs);
-    if (errStat)
-        LZ4IO_finalTimeDisplay(timeStart, cpuStart, processed);
+    if (!errStat)
+        LZ4IO_finalTimeDisplay(timeStart, cpuStart, processed, prefs->stats);
     LZ4IO_freeDResources(ress);
     return errStat;
 }
 
 
+#if LZ4IO_MULTITHREAD
+/* LZ4IO_decompressSmallFile() :
+ * decodes @srcFileName, made of LZ4 frames only.
+ * Any other content (legacy or skippable frames, pass-through), and any decoding error,
+ * is handed back to the calling thread, which processes and reports them as usual. */
+static int LZ4IO_decompressSmallFile(LZ4IO_FileWorker* w, const char* srcFileName)
+{
+    const dRess_t* const ress = (const dRess_t*)w->ress;
+    const LZ4IO_prefs_t* const prefs = w->set->prefs;
+    LZ4F_decompressOptions_t const dOpt_skipCrc = { 0, 1, 0, 0 };
+    const LZ4F_decompressOptions_t* const dOptPtr =
+        ((prefs->blockChecksum==0) && (prefs->streamChecksum==0)) ?
+        &dOpt_skipCrc : NULL;
+    const char* dstFileName = NULL;
+    FILE* dstFile = NULL;
+    unsigned long long filesize = 0;
+    unsigned storedSkips = 0;
+    int handBack = 0;
+    unsigned char MNstore[MAGICNUMBER_SIZE];
+    FILE* const srcFile = LZ4IO_openSrcFile(srcFileName);
+    if (srcFile == NULL) return 1;
+
+    if ( (fread(MNstore, 1, MAGICNUMBER_SIZE, srcFile) != MAGICNUMBER_SIZE)
+      || (LZ4IO_readLE32(MNstore) != LZ4IO_MAGICNUMBER) ) {
+        fclose(srcFile);
+        return LZ4IO_HANDBACK;
+    }
+    if (!LZ4IO_isDevNull(w->set->suffix)) {   /* test mode : decoded data is discarded */
+        size_t const srcLen = strlen(srcFileName) - strlen(w->set->suffix);
+        dstFileName = LZ4IO_FW_dstFileName(w, srcFileName, srcLen, "");
+        dstFile = LZ4IO_openDstFile(dstFileName, prefs);
+        if (dstFile == NULL) { fclose(srcFile); return 1; }
+    }
+
+    /* Loop over frames */
+    for ( ; ; ) {
+        size_t nextToLoad;
+        {   size_t inSize = MAGICNUMBER_SIZE;
+            size_t outSize = 0;
+            nextToLoad = LZ4F_decompress_usingDDict(ress->dCtx,
+                                ress->dstBuffer, &outSize,
+                                MNstore, &inSize,
+                                ress->ddict, dOptPtr);
+        }
+        while (nextToLoad && !LZ4F_isError(nextToLoad)) {
+            size_t readSize;
+            size_t pos = 0;
+            size_t decodedBytes = ress->dstBufferSize;
+            TIME_t const readStart = TIME_getTime();
+
+            if (nextToLoad > ress->srcBufferSize) nextToLoad = ress->srcBufferSize;
+            readSize = fread(ress->srcBuffer, 1, nextToLoad, srcFile);
+            w->readTime += TIME_clockSpan_ns(readStart);
+            if (!readSize) break;   /* truncated frame */
+
+            while ((pos < readSize) || (decodedBytes == ress->dstBufferSize)) {  /* still to read, or still to flush */
+                size_t remaining = readSize - pos;
+                TIME_t const dStart = TIME_getTime();
+                decodedBytes = ress->dstBufferSize;
+                nextToLoad = LZ4F_decompress_usingDDict(ress->dCtx,
+                                        ress->dstBuffer, &decodedBytes,
+                                        (char*)(ress->srcBuffer)+pos, &remaining,
+                                        ress->ddict, dOptPtr);
+                w->codecTime += TIME_clockSpan_ns(dStart);
+                if (LZ4F_isError(nextToLoad)) break;
+                pos += remaining;
+
+                if (decodedBytes) {
+                    if (dstFile) {
+                        TIME_t const writeStart = TIME_getTime();
+                        storedSkips = LZ4IO_writeSparse(dstFile, ress->dstBuffer, decodedBytes, prefs->sparseFileSupport, storedSkips);
+                        w->outputTime += TIME_clockSpan_ns(writeStart);
+                    }
+                    filesize += decodedBytes;
+                }
+                if (!nextToLoad) break;
+        }   }
+        if (nextToLoad) { handBack = 1; break; }   /* decoding error, or truncated frame */
+
+        /* next frame, or end of file */
+        {   size_t const nbReadBytes = fread(MNstore, 1, MAGICNUMBER_SIZE, srcFile);
+            if (nbReadBytes == 0) break;
+            if ( (nbReadBytes != MAGICNUMBER_SIZE)
+              || (LZ4IO_readLE32(MNstore) != LZ4IO_MAGICNUMBER) ) {
+                handBack = 1;
+                break;
+    }   }   }
+    if (ferror(srcFile)) handBack = 1;
+    fclose(srcFile);
+
+    if (handBack) {
+        LZ4F_resetDecompressionContext(ress->dCtx);
+        if (dstFile) {
+            fclose(dstFile);
+            remove(dstFileName);   /* will be regenerated by the calling thread */
+        }
+        return LZ4IO_HANDBACK;
+    }
+    if (dstFile) {
+        LZ4IO_fwriteSparseEnd(dstFile, storedSkips);
+        fclose(dstFile);
+    }
+    LZ4IO_FW_finishFile(srcFileName, dstFileName, prefs);
+
+    DISPLAYLEVEL(2, "%-30.30s : decoded %llu bytes \n", srcFileName, filesize);
+    w->processed += filesize;
+    return 0;
+}
+#endif /* LZ4IO_MULTITHREAD */
+
+
 int LZ4IO_decompressMultipleFilenames(
                             const char** inFileNamesTable, int ifntSize,
                             const char* suffix,
                             const LZ4IO_prefs_t* prefs)
 {
-    int i;
+    int i, pass;
     unsigned long long totalProcessed = 0;
     int skippedFiles = 0;
     int missingFiles = 0;
+    LZ4IO_FileSet* fs = NULL;
     char* outFileName = (char*)malloc(FNSPACE);
     size_t ofnSize = FNSPACE;
     size_t const suffixSize = strlen(suffix);
@@ -2233,10 +4950,36 @@ int LZ4IO_decompressMultipleFilenames(
     }
     ress.dstFile = LZ4IO_openDstFile(stdoutmark, prefs);
 
+#if LZ4IO_MULTITHREAD
+    /* decompress small files concurrently, into their own output file, or for test only */
+    if ( (prefs->nbWorkers > 1)
+      && (!LZ4IO_isStdout(suffix))
+      && (!LZ4IO_isDevNull(suffix) || prefs->testMode)
+      && (prefs->overwrite || g_displayLevel <= 1) )  /* no interaction from workers */
+        fs = LZ4IO_FS_create(inFileNamesTable, ifntSize,
+                             LZ4IO_isDevNull(suffix) ? NULL : suffix, suffix,
+                             LZ4IO_decompressSmallFile, prefs);
+    if (fs) {
+        LZ4IO_prefs_t workerPrefs = *prefs;
+        workerPrefs.useDictionary = 0;   /* dictionary is shared */
+        for (i = 0; i < fs->nbWorkers; i++) {
+            dRess_t* const wRess = (dRess_t*)malloc(sizeof(dRess_t));
+            if (wRess == NULL) END_PROCESS(70, "Memory allocation error");
+            *wRess = LZ4IO_createDResources(&workerPrefs);
+            wRess->ddict = ress.ddict;
+            fs->workers[i].ress = wRess;
+        }
+        LZ4IO_FS_start(fs);
+    }
+#endif
+
+    /* loop on each file : pass 1 processes files handed back by workers */
+    for (pass=0; pass<2; pass++) {
     for (i=0; i<ifntSize; i++) {
         unsigned long long processed = 0;
         size_t const ifnSize = strlen(inFileNamesTable[i]);
         const char* const suffixPtr = inFileNamesTable[i] + ifnSize - suffixSize;
+        if (!LZ4IO_FS_isCallerFile(fs, i, pass)) continue;
         if (LZ4IO_isStdout(suffix) || LZ4IO_isDevNull(suffix)) {
             missingFiles += LZ4IO_decompressSrcFile(&processed, ress, inFileNamesTable[i], suffix, prefs);
             totalProcessed += processed;
@@ -2258,10 +5001,24 @@ int LZ4IO_decompressMultipleFilenames(
         missingFiles += LZ4IO_decompressDstFile(&processed, ress, inFileNamesTable[i], outFileName, prefs);
         totalProcessed += processed;
     }
+#if LZ4IO_MULTITHREAD
+    if (fs && pass==0) {
+        LZ4IO_FS_complete(fs, &missingFiles, &totalProcessed);
+        for (i = 0; i < fs->nbWorkers; i++) {
+            dRess_t* const wRess = (dRess_t*)fs->workers[i].ress;
+            wRess->ddict = NULL;   /* owned by ress */
+            LZ4IO_freeDResources(*wRess);
+            free(wRess);
+    }   }
+#endif
+    }
 
+#if LZ4IO_MULTITHREAD
+    LZ4IO_FS_free(fs);
+#endif
     LZ4IO_freeDResources(ress);
     free(outFileName);
-    LZ4IO_finalTimeDisplay(timeStart, cpuStart, totalProcessed);
+    LZ4IO_finalTimeDisplay(timeStart, cpuStart, totalProcessed, prefs->stats);
     return missingFiles + skippedFiles;
 }
 
@@ -2340,6 +5097,74 @@ LZ4IO_skipBlocksData(FILE* finput,
     return totalBlocksSize;
 }
 
+/* LZ4IO_skipSeekableBlocksData() :
+ * Same as LZ4IO_skipBlocksData(), for a frame followed by its seek table at the end of finput :
+ * blocks size is read from the seek table, instead of seeking through each block header.
+ * @blocksStart : position of first block, right after frame header.
+ * *dSizePtr receives the decoded size of the frame.
+ * @return : total blocks size, or 0 if no seek table matches this frame,
+ *           in which case finput position is unmodified (at blocksStart). */
+static unsigned long long
+LZ4IO_skipSeekableBlocksData(FILE* finput, unsigned long long blocksStart, unsigned long long fileSize,
+                             const LZ4F_frameInfo_t* frameInfo, unsigned long long* dSizePtr)
+{
+    size_t const maxBlockSize = LZ4F_getBlockSize(frameInfo->blockSizeID);
+    unsigned long long const contentCrcSize = frameInfo->contentChecksumFlag ? LZ4F_CONTENT_CHECKSUM_SIZE : 0;
+    unsigned long long cTotal = 0, dTotal = 0;
+    unsigned char buffer[64 * LZ4F_SEEKTABLE_ENTRY_SIZE];
+    size_t tableSize, nbEntries, n;
+    int valid = 0;
+
+    if (LZ4F_isError(maxBlockSize)) return 0;
+    if (fileSize < blocksStart + LZ4F_BLOCK_HEADER_SIZE + 8 + LZ4F_SEEKTABLE_FOOTER_SIZE) return 0;
+    if ( (UTIL_fseek(finput, -(S64)LZ4F_SEEKTABLE_FOOTER_SIZE, SEEK_END) != 0)
+      || (fread(buffer, 1, LZ4F_SEEKTABLE_FOOTER_SIZE, finput) != LZ4F_SEEKTABLE_FOOTER_SIZE) )
+        goto _restore;
+    tableSize = LZ4F_seekTableFrameSize(buffer, LZ4F_SEEKTABLE_FOOTER_SIZE);
+    if (LZ4F_isError(tableSize)) goto _restore;
+    if (tableSize > fileSize - blocksStart - LZ4F_BLOCK_HEADER_SIZE) goto _restore;
+    if ( (UTIL_fseek(finput, -(S64)tableSize, SEEK_END) != 0)
+      || (fread(buffer, 1, 8, finput) != 8)
+      || (LZ4IO_readLE32(buffer) != LZ4F_SEEKTABLE_MAGICNUMBER)
+      || (LZ4IO_readLE32(buffer + 4) != tableSize - 8) )
+        goto _restore;
+
+    /* sum entries, read by batches */
+    nbEntries = (tableSize - 8 - LZ4F_SEEKTABLE_FOOTER_SIZE) / LZ4F_SEEKTABLE_ENTRY_SIZE;
+    for (n = 0; n < nbEntries; ) {
+        size_t const batch = MIN(nbEntries - n, sizeof(buffer) / LZ4F_SEEKTABLE_ENTRY_SIZE);
+        size_t e;
+        if (fread(buffer, LZ4F_SEEKTABLE_ENTRY_SIZE, batch, finput) != batch) goto _restore;
+        for (e = 0; e < batch; e++) {
+            size_t const cBlockSize = LZ4IO_readLE32(buffer + e * LZ4F_SEEKTABLE_ENTRY_SIZE);
+            size_t const dBlockSize = LZ4IO_readLE32(buffer + e * LZ4F_SEEKTABLE_ENTRY_SIZE + 4);
+            if ((cBlockSize < LZ4F_BLOCK_HEADER_SIZE) || (dBlockSize > maxBlockSize)) goto _restore;
+            cTotal += cBlockSize;
+            dTotal += dBlockSize;
+        }
+        n += batch;
+    }
+
+    /* table must describe exactly this frame */
+    if (blocksStart + cTotal + LZ4F_BLOCK_HEADER_SIZE + contentCrcSize + tableSize != fileSize) goto _restore;
+    if ( (UTIL_fseek(finput, (S64)(blocksStart + cTotal), SEEK_SET) != 0)
+      || (fread(buffer, 1, LZ4F_BLOCK_HEADER_SIZE, finput) != LZ4F_BLOCK_HEADER_SIZE)
+      || (LZ4IO_readLE32(buffer) != 0) )
+        goto _restore;
+    /* position on seek table, parsed next as a skippable frame */
+    if (UTIL_fseek(finput, (S64)contentCrcSize, SEEK_CUR) != 0) goto _restore;
+    valid = 1;
+    *dSizePtr = dTotal;
+
+_restore:
+    if (!valid) {
+        if (UTIL_fseek(finput, (S64)blocksStart, SEEK_SET) != 0)
+            END_PROCESS(73, "Error : cannot seek back to first block");
+        return 0;
+    }
+    return cTotal + LZ4F_BLOCK_HEADER_SIZE + contentCrcSize;
+}
+
 static const unsigned long long legacyFrameUndecodable = (0ULL-1);
 /* For legacy frames only.
    Read block headers and skip block data.
@@ -2428,12 +5253,14 @@ LZ4IO_getCompressedFileInfo(LZ4IO_cFileInfo_t* cfinfo, const char* input_filenam
     LZ4IO_infoResult result = LZ4IO_format_not_known;  /* default result (error) */
     unsigned char buffer[LZ4F_HEADER_SIZE_MAX];
     FILE* const finput = LZ4IO_openSrcFile(input_filename);
+    unsigned long long framePos = 0;
 
     if (finput == NULL) return LZ4IO_not_a_file;
     cfinfo->fileSize = UTIL_getOpenFileSize(finput);
 
     while (!feof(finput)) {
         LZ4IO_frameInfo_t frameInfo = LZ4IO_INIT_FRAMEINFO;
+        unsigned long long frameSize = 0;
         unsigned magicNumber;
         /* Get MagicNumber */
         {   size_t const nbReadBytes = fread(buffer, 1, MAGICNUMBER_SIZE, finput);
@@ -2470,9 +5297,19 @@ LZ4IO_getCompressedFileInfo(LZ4IO_cFileInfo_t* cfinfo, const char* input_filenam
                                 cfinfo->frameSummary.lz4FrameInfo.blockMode != frameInfo.lz4FrameInfo.blockMode)
                                 && cfinfo->frameCount != 0)
                             cfinfo->eqBlockTypes = 0;
-                        {   const unsigned long long totalBlocksSize = LZ4IO_skipBlocksData(finput,
+                        {   unsigned long long tableDSize = 0;
+                            unsigned long long totalBlocksSize = 0;
+                            if (frameInfo.lz4FrameInfo.blockMode == LZ4F_blockIndependent)
+                                totalBlocksSize = LZ4IO_skipSeekableBlocksData(finput, framePos + hSize, cfinfo->fileSize,
+                                                                               &frameInfo.lz4FrameInfo, &tableDSize);
+                            if (totalBlocksSize) {
+                                DISPLAYLEVEL(4, "Frame size read from seek table \n");
+                                if (!frameInfo.lz4FrameInfo.contentSize) frameInfo.lz4FrameInfo.contentSize = tableDSize;
+                            } else {
+                                totalBlocksSize = LZ4IO_skipBlocksData(finput,
                                     frameInfo.lz4FrameInfo.blockChecksumFlag,
                                     frameInfo.lz4FrameInfo.contentChecksumFlag);
+                            }
                             if (totalBlocksSize) {
                                 char bTypeBuffer[5];
                                 LZ4IO_blockTypeID(frameInfo.lz4FrameInfo.blockSizeID, frameInfo.lz4FrameInfo.blockMode, bTypeBuffer);
@@ -2495,6 +5332,7 @@ LZ4IO_getCompressedFileInfo(LZ4IO_cFileInfo_t* cfinfo, const char* input_filenam
                                     DISPLAYLEVEL(3, " %20llu %20s %9s \n", totalBlocksSize + hSize, "-", "-");
                                     cfinfo->allContentSize = 0;
                                 }
+                                frameSize = hSize + totalBlocksSize;
                                 result = LZ4IO_LZ4F_OK;
             }   }   }   }   }
             break;
@@ -2516,6 +5354,7 @@ LZ4IO_getCompressedFileInfo(LZ4IO_cFileInfo_t* cfinfo, const char* input_filenam
                                  "-", "-",
                                  totalBlocksSize + 4,
                                  "-", "-");
+                    frameSize = totalBlocksSize + 4;
                     result = LZ4IO_LZ4F_OK;
             }   }
             break;
@@ -2523,7 +5362,8 @@ LZ4IO_getCompressedFileInfo(LZ4IO_cFileInfo_t* cfinfo, const char* input_filenam
             frameInfo.frameType = skippableFrame;
             if (cfinfo->frameSummary.frameType != skippableFrame && cfinfo->frameCount != 0) cfinfo->eqFrameTypes = 0;
             cfinfo->eqBlockTypes = 0;
-            cfinfo->allContentSize = 0;
+            /* skippable frames add no content */
+            frameInfo.lz4FrameInfo.contentSize = cfinfo->frameSummary.lz4FrameInfo.contentSize;
             {   size_t const nbReadBytes = fread(buffer, 1, 4, finput);
                 if (nbReadBytes != 4)
                     END_PROCESS(42, "Stream error : skippable size unreadable");
@@ -2536,6 +5376,7 @@ LZ4IO_getCompressedFileInfo(LZ4IO_cFileInfo_t* cfinfo, const char* input_filenam
                              cfinfo->frameCount + 1,
                              "SkippableFrame",
                              "-", "-", size + 8, "-", "-");
+                frameSize = (unsigned long long)size + 8;
 
                 result = LZ4IO_LZ4F_OK;
             }
@@ -2553,57 +5394,487 @@ LZ4IO_getCompressedFileInfo(LZ4IO_cFileInfo_t* cfinfo, const char* input_filenam
         if (result != LZ4IO_LZ4F_OK) break;
         cfinfo->frameSummary = frameInfo;
         cfinfo->frameCount++;
+        framePos += frameSize;
     }  /* while (!feof(finput)) */
     fclose(finput);
     return result;
 }
 
 
-int LZ4IO_displayCompressedFilesInfo(const char** inFileNames, size_t ifnIdx)
+typedef struct {
+    const char* srcFileName;
+    LZ4IO_cFileInfo_t cfinfo;
+    LZ4IO_infoResult result;
+    int done;
+} LZ4IO_listJob_t;
+
+static void LZ4IO_listFile(void* arg)
+{
+    LZ4IO_listJob_t* const job = (LZ4IO_listJob_t*)arg;
+    job->result = LZ4IO_getCompressedFileInfo(&job->cfinfo, job->srcFileName);
+    job->done = 1;
+}
+
+/* write @str as a JSON string, with its quotes */
+static void LZ4IO_displayJSONString(const char* str)
+{
+    const unsigned char* p = (const unsigned char*)str;
+    DISPLAYOUT("\"");
+    for (; *p; p++) {
+        if (*p == '"' || *p == '\\') DISPLAYOUT("\\%c", *p);
+        else if (*p < 0x20) DISPLAYOUT("\\u%04x", *p);
+        else DISPLAYOUT("%c", *p);
+    }
+    DISPLAYOUT("\"");
+}
+
+static void LZ4IO_displayFileInfoJSON(const LZ4IO_listJob_t* job, int first)
+{
+    const LZ4IO_cFileInfo_t* const cfinfo = &job->cfinfo;
+    char bTypeBuffer[5];
+    DISPLAYOUT("%s{\"file\":", first ? "" : ",\n");
+    LZ4IO_displayJSONString(job->srcFileName);
+    DISPLAYOUT(",\"frames\":%llu,\"type\":", cfinfo->frameCount);
+    if (cfinfo->eqFrameTypes) DISPLAYOUT("\"%s\"", LZ4IO_frameTypeNames[cfinfo->frameSummary.frameType]);
+    else DISPLAYOUT("null");
+    DISPLAYOUT(",\"block\":");
+    if (cfinfo->eqBlockTypes)
+        DISPLAYOUT("\"%s\"", LZ4IO_blockTypeID(cfinfo->frameSummary.lz4FrameInfo.blockSizeID,
+                                              cfinfo->frameSummary.lz4FrameInfo.blockMode, bTypeBuffer));
+    else DISPLAYOUT("null");
+    DISPLAYOUT(",\"compressed\":%llu,\"uncompressed\":", cfinfo->fileSize);
+    if (cfinfo->allContentSize) DISPLAYOUT("%llu}", cfinfo->frameSummary.lz4FrameInfo.contentSize);
+    else DISPLAYOUT("null}");
+}
+
+int LZ4IO_displayCompressedFilesInfo(const char** inFileNames, size_t ifnIdx, const LZ4IO_prefs_t* prefs)
 {
     int result = 0;
     size_t idx = 0;
-    if (g_displayLevel < 3) {
+    LZ4IO_listJob_t* const jobs = (LZ4IO_listJob_t*)calloc(ifnIdx + !ifnIdx, sizeof(*jobs));
+    if (jobs == NULL) END_PROCESS(74, "Allocation error : not enough memory");
+
+    for (idx = 0; idx < ifnIdx; idx++) {
+        LZ4IO_cFileInfo_t const initInfo = LZ4IO_INIT_CFILEINFO;
+        jobs[idx].srcFileName = inFileNames[idx];
+        jobs[idx].cfinfo = initInfo;
+        jobs[idx].cfinfo.fileName = LZ4IO_baseName(inFileNames[idx]);
+        jobs[idx].result = LZ4IO_format_not_known;
+    }
+
+#if LZ4IO_MULTITHREAD
+    /* analyze files concurrently; verbose mode displays frames while walking them, hence stays sequential */
+    if ((prefs->nbWorkers > 1) && (ifnIdx > 1) && (g_displayLevel < 3)) {
+        TPOOL_ctx* const tPool = TPOOL_create(prefs->nbWorkers, prefs->nbWorkers);
+        if (tPool == NULL) END_PROCESS(21, "threadpool creation error ");
+        for (idx = 0; idx < ifnIdx; idx++) {
+            if (LZ4IO_isStdin(inFileNames[idx]) || !UTIL_isRegFile(inFileNames[idx])) continue;
+            TPOOL_submitJob(tPool, LZ4IO_listFile, &jobs[idx]);
+        }
+        TPOOL_completeJobs(tPool);
+        TPOOL_free(tPool);
+    }
+#else
+    (void)prefs;
+#endif
+
+    if (prefs->listJSON) {
+        DISPLAYOUT("[\n");
+    } else if (g_displayLevel < 3) {
         DISPLAYOUT("%10s %14s %5s %11s %13s %9s   %s\n",
                 "Frames", "Type", "Block", "Compressed", "Uncompressed", "Ratio", "Filename");
     }
-    for (; idx < ifnIdx; idx++) {
-        /* Get file info */
-        LZ4IO_cFileInfo_t cfinfo = LZ4IO_INIT_CFILEINFO;
-        cfinfo.fileName = LZ4IO_baseName(inFileNames[idx]);
+    for (idx = 0; idx < ifnIdx; idx++) {
+        LZ4IO_listJob_t* const job = &jobs[idx];
+        LZ4IO_cFileInfo_t* const cfinfo = &job->cfinfo;
         if (LZ4IO_isStdin(inFileNames[idx]) ? !UTIL_isRegFD(0) : !UTIL_isRegFile(inFileNames[idx])) {
             DISPLAYLEVEL(1, "lz4: %s is not a regular file \n", inFileNames[idx]);
-            return 1;
+            result = 1;
+            break;
         }
-        DISPLAYLEVEL(3, "%s(%llu/%llu)\n", cfinfo.fileName, (unsigned long long)idx + 1, (unsigned  long long)ifnIdx);
+        DISPLAYLEVEL(3, "%s(%llu/%llu)\n", cfinfo->fileName, (unsigned long long)idx + 1, (unsigned  long long)ifnIdx);
         DISPLAYLEVEL(3, "    %6s %14s %5s %8s %20s %20s %9s\n",
                      "Frame", "Type", "Block", "Checksum", "Compressed", "Uncompressed", "Ratio")
-        {   LZ4IO_infoResult const op_result = LZ4IO_getCompressedFileInfo(&cfinfo, inFileNames[idx]);
-            if (op_result != LZ4IO_LZ4F_OK) {
-                assert(op_result == LZ4IO_format_not_known);
-                DISPLAYLEVEL(1, "lz4: %s: File format not recognized \n", inFileNames[idx]);
-                return 1;
-        }   }
+        if (!job->done) LZ4IO_listFile(job);
+        if (job->result != LZ4IO_LZ4F_OK) {
+            assert(job->result == LZ4IO_format_not_known);
+            DISPLAYLEVEL(1, "lz4: %s: File format not recognized \n", inFileNames[idx]);
+            result = 1;
+            break;
+        }
         DISPLAYLEVEL(3, "\n");
-        if (g_displayLevel < 3) {
+        if (prefs->listJSON) {
+            LZ4IO_displayFileInfoJSON(job, idx == 0);
+        } else if (g_displayLevel < 3) {
             /* Display Summary */
             {   char buffers[3][10];
                 DISPLAYOUT("%10llu %14s %5s %11s %13s ",
-                        cfinfo.frameCount,
-                        cfinfo.eqFrameTypes ? LZ4IO_frameTypeNames[cfinfo.frameSummary.frameType] : "-" ,
-                        cfinfo.eqBlockTypes ? LZ4IO_blockTypeID(cfinfo.frameSummary.lz4FrameInfo.blockSizeID,
-                                                                cfinfo.frameSummary.lz4FrameInfo.blockMode, buffers[0]) : "-",
-                        LZ4IO_toHuman((long double)cfinfo.fileSize, buffers[1]),
-                        cfinfo.allContentSize ? LZ4IO_toHuman((long double)cfinfo.frameSummary.lz4FrameInfo.contentSize, buffers[2]) : "-");
-                if (cfinfo.allContentSize) {
-                    double const ratio = (double)cfinfo.fileSize / (double)cfinfo.frameSummary.lz4FrameInfo.contentSize * 100;
-                    DISPLAYOUT("%9.2f%%  %s \n", ratio, cfinfo.fileName);
+                        cfinfo->frameCount,
+                        cfinfo->eqFrameTypes ? LZ4IO_frameTypeNames[cfinfo->frameSummary.frameType] : "-" ,
+                        cfinfo->eqBlockTypes ? LZ4IO_blockTypeID(cfinfo->frameSummary.lz4FrameInfo.blockSizeID,
+                                                                 cfinfo->frameSummary.lz4FrameInfo.blockMode, buffers[0]) : "-",
+                        LZ4IO_toHuman((long double)cfinfo->fileSize, buffers[1]),
+                        cfinfo->allContentSize ? LZ4IO_toHuman((long double)cfinfo->frameSummary.lz4FrameInfo.contentSize, buffers[2]) : "-");
+                if (cfinfo->allContentSize && cfinfo->frameSummary.lz4FrameInfo.contentSize) {
+                    double const ratio = (double)cfinfo->fileSize / (double)cfinfo->frameSummary.lz4FrameInfo.contentSize * 100;
+                    DISPLAYOUT("%9.2f%%  %s \n", ratio, cfinfo->fileName);
                 } else {
                     DISPLAYOUT("%9s   %s\n",
                             "-",
-                            cfinfo.fileName);
+                            cfinfo->fileName);
         }   }   }  /* if (g_displayLevel < 3) */
-    }  /* for (; idx < ifnIdx; idx++) */
+    }  /* for (idx = 0; idx < ifnIdx; idx++) */
+    if (prefs->listJSON) DISPLAYOUT("%s]\n", idx ? "\n" : "");
+
+    free(jobs);
+    return result;
+}
+
+
+/* ********************************************************************* */
+/* **********************   LZ4 --train command   ********************** */
+/* ********************************************************************* */
+
+#define LZ4IO_TRAIN_SAMPLE_MAX (LZ4_MAX_DICT_SIZE)   /* larger files are cut into several samples */
+
+int LZ4IO_trainDictionary(const char* dictFileName,
+                          const char** inFileNames, int nbFiles,
+                          int maxDictSize, const LZ4IO_prefs_t* prefs)
+{
+    U64 totalSize = 0;
+    size_t nbSamplesMax = 0, nbSamples = 0, pos = 0;
+    char* samples;
+    int* sampleSizes;
+    void* dict;
+    int dictSize;
+    int i;
+
+    assert(dictFileName != NULL);
+    for (i = 0; i < nbFiles; i++) {
+        U64 const fileSize = UTIL_getFileSize(inFileNames[i]);   /* 0 for directories and special files */
+        totalSize += fileSize;
+        nbSamplesMax += (size_t)((fileSize + LZ4IO_TRAIN_SAMPLE_MAX - 1) / LZ4IO_TRAIN_SAMPLE_MAX);
+    }
+    if (totalSize != (U64)(size_t)totalSize)
+        END_PROCESS(90, "Training error : not enough memory to load %u MB of samples", (unsigned)(totalSize >> 20));
+    samples = (char*)malloc((size_t)totalSize + 1);
+    sampleSizes = (int*)malloc((nbSamplesMax + 1) * sizeof(int));
+    dict = malloc((size_t)maxDictSize + 1);
+    if (!samples || !sampleSizes || !dict)
+        END_PROCESS(91, "Allocation error : not enough memory to load %u MB of samples", (unsigned)(totalSize >> 20));
+
+    /* load samples */
+    for (i = 0; i < nbFiles; i++) {
+        U64 const fileSize = UTIL_getFileSize(inFileNames[i]);
+        size_t remaining = (size_t)MIN(fileSize, totalSize - pos);
+        FILE* f;
+        if (remaining == 0) continue;
+        f = LZ4IO_openSrcFile(inFileNames[i]);
+        if (f == NULL) continue;
+        while (remaining > 0 && nbSamples < nbSamplesMax) {
+            size_t const readSize = fread(samples + pos, 1, MIN(remaining, LZ4IO_TRAIN_SAMPLE_MAX), f);
+            if (readSize == 0) break;
+            sampleSizes[nbSamples++] = (int)readSize;
+            pos += readSize;
+            remaining -= readSize;
+        }
+        fclose(f);
+    }
+    DISPLAYLEVEL(3, "Training on %u samples (%u KB) \n", (unsigned)nbSamples, (unsigned)(pos >> 10));
+
+    dictSize = LZ4_trainDictionary(dict, maxDictSize, samples, sampleSizes, (int)nbSamples);
+    free(samples);
+    free(sampleSizes);
+    if (dictSize == 0) {
+        DISPLAYLEVEL(1, "Training error : samples have no content in common \n");
+        free(dict);
+        return 1;
+    }
+
+    {   FILE* const dstFile = LZ4IO_openDstFile(dictFileName, prefs);
+        if (dstFile == NULL) { free(dict); return 1; }
+        if (fwrite(dict, 1, (size_t)dictSize, dstFile) != (size_t)dictSize)
+            END_PROCESS(92, "Write error : cannot write dictionary into %s", dictFileName);
+        if (!LZ4IO_isStdout(dictFileName)) fclose(dstFile);
+    }
+    DISPLAYLEVEL(2, "Dictionary of %i bytes saved into %s, trained on %u samples \n",
+                    dictSize, dictFileName, (unsigned)nbSamples);
+    free(dict);
+    return 0;
+}
+
+
+/* ********************************************************************* */
+/* **********************   Merging frames (--merge)   ****************** */
+/* ********************************************************************* */
+
+/* Blocks are copied from input frames into a single output frame, without recompression.
+ * They are still decoded, to verify them, and to generate block sizes and content checksum of output frame.
+ * Input frames must use independent blocks, and the same dictionary ID.
+ * Output frame uses the largest block size of input frames.
+ * Skippable frames, including seek tables, are dropped. */
+
+typedef struct {
+    LZ4F_dctx* dctx;
+    LZ4F_cctx* cctx;
+    FILE* dstFile;
+    /* set by scanning pass */
+    unsigned nbFrames;
+    LZ4F_blockSizeID_t blockSizeID;
+    unsigned dictID;
+    int allContentSize;
+    unsigned long long contentSize;
+    /* copying pass */
+    size_t blockSize;
+    char* cBuffer;          /* block header + block + block checksum */
+    char* dBuffer;          /* decoded block */
+    void* dstBuffer;
+    size_t dstCapacity;
+    const char* dict;
+    int dictSize;
+    unsigned long long dstSize;
+} LZ4IO_merge_t;
+
+/* LZ4IO_readFrameHeader() :
+ * reads the rest of a LZ4 frame header, after its magic number.
+ * @return : 0 on success, 1 if header is invalid or truncated */
+static int LZ4IO_readFrameHeader(LZ4F_dctx* dctx, FILE* srcFile, LZ4F_frameInfo_t* info)
+{
+    unsigned char header[LZ4F_HEADER_SIZE_MAX];
+    size_t hSize;
+    LZ4IO_writeLE32(header, LZ4IO_MAGICNUMBER);
+    if (fread(header + MAGICNUMBER_SIZE, 1, LZ4F_HEADER_SIZE_MIN - MAGICNUMBER_SIZE, srcFile) != LZ4F_HEADER_SIZE_MIN - MAGICNUMBER_SIZE)
+        return 1;
+    hSize = LZ4F_headerSize(header, LZ4F_HEADER_SIZE_MIN);
+    if (LZ4F_isError(hSize)) return 1;
+    if (fread(header + LZ4F_HEADER_SIZE_MIN, 1, hSize - LZ4F_HEADER_SIZE_MIN, srcFile) != hSize - LZ4F_HEADER_SIZE_MIN)
+        return 1;
+    LZ4F_resetDecompressionContext(dctx);
+    return LZ4F_isError(LZ4F_getFrameInfo(dctx, info, header, &hSize));
+}
+
+/* LZ4IO_mergeFrameBlocks() :
+ * copies blocks of current frame into output frame, verifying them.
+ * srcFile is positioned after frame header. Errors are fatal. */
+static void LZ4IO_mergeFrameBlocks(LZ4IO_merge_t* m, FILE* srcFile, const char* srcFileName,
+                                   const LZ4F_frameInfo_t* info)
+{
+    size_t const crcSize = info->blockChecksumFlag ? LZ4F_BLOCK_CHECKSUM_SIZE : 0;
+    unsigned long long frameSize = 0;
+    XXH32_state_t* const xxh32 = XXH32_createState();
+    if (xxh32 == NULL) END_PROCESS(93, "Allocation error : not enough memory");
+    XXH32_reset(xxh32, 0);
+
+    for (;;) {
+        char* const cData = m->cBuffer + LZ4F_BLOCK_HEADER_SIZE;
+        const char* decoded = cData;
+        size_t decodedSize;
+        unsigned blockHeader;
+        size_t cSize;
+        if (fread(m->cBuffer, 1, LZ4F_BLOCK_HEADER_SIZE, srcFile) != LZ4F_BLOCK_HEADER_SIZE)
+            END_PROCESS(94, "Read error : %s is truncated", srcFileName);
+        blockHeader = LZ4IO_readLE32(m->cBuffer);
+        if (blockHeader == 0) break;   /* EndMark */
+        cSize = blockHeader & 0x7FFFFFFFU;
+        if (cSize > m->blockSize) END_PROCESS(95, "%s : corrupted block", srcFileName);
+        if (fread(cData, 1, cSize + crcSize, srcFile) != cSize + crcSize)
+            END_PROCESS(94, "Read error : %s is truncated", srcFileName);
+        if (crcSize && (XXH32(cData, cSize, 0) != LZ4IO_readLE32(cData + cSize)))
+            END_PROCESS(95, "%s : block checksum error", srcFileName);
+        decodedSize = cSize;
+        if ((blockHeader >> 31) == 0) {   /* compressed block */
+            int const r = LZ4_decompress_safe_usingDict(cData, m->dBuffer, (int)cSize, (int)m->blockSize, m->dict, m->dictSize);
+            if (r < 0) END_PROCESS(95, "%s : corrupted block", srcFileName);
+            decoded = m->dBuffer;
+            decodedSize = (size_t)r;
+        }
+        XXH32_update(xxh32, decoded, decodedSize);
+        frameSize += decodedSize;
+        {   size_t const outSize = LZ4F_appendBlock(m->cctx, m->dstBuffer, m->dstCapacity,
+                                                    m->cBuffer, LZ4F_BLOCK_HEADER_SIZE + cSize,
+                                                    decoded, decodedSize);
+            if (LZ4F_isError(outSize))
+                END_PROCESS(96, "Merge error : %s", LZ4F_getErrorName(outSize));
+            if (fwrite(m->dstBuffer, 1, outSize, m->dstFile) != outSize)
+                END_PROCESS(97, "Write error : cannot write merged frame");
+            m->dstSize += outSize;
+    }   }
+
+    if (info->contentChecksumFlag) {
+        unsigned char crc[LZ4F_CONTENT_CHECKSUM_SIZE];
+        if (fread(crc, 1, LZ4F_CONTENT_CHECKSUM_SIZE, srcFile) != LZ4F_CONTENT_CHECKSUM_SIZE)
+            END_PROCESS(94, "Read error : %s is truncated", srcFileName);
+        if (LZ4IO_readLE32(crc) != XXH32_digest(xxh32))
+            END_PROCESS(95, "%s : content checksum error", srcFileName);
+    }
+    if (info->contentSize && (info->contentSize != frameSize))
+        END_PROCESS(95, "%s : content size error", srcFileName);
+    XXH32_freeState(xxh32);
+}
+
+/* LZ4IO_mergeFile() :
+ * walks frames of srcFileName.
+ * copy == 0 : checks that frames are compatible, and collects max block size, dictID and content size.
+ * copy == 1 : copies blocks into output frame.
+ * @return : 0 on success, 1 if frames can't be merged */
+static int LZ4IO_mergeFile(LZ4IO_merge_t* m, const char* srcFileName, int copy)
+{
+    FILE* srcFile;
+    int result = 1;
+    if (LZ4IO_isStdin(srcFileName)) {
+        DISPLAYLEVEL(1, "Error : --merge can't read from stdin \n");
+        return 1;
+    }
+    srcFile = LZ4IO_openSrcFile(srcFileName);
+    if (srcFile == NULL) return 1;
+
+    for (;;) {
+        unsigned char mnStore[MAGICNUMBER_SIZE];
+        LZ4F_frameInfo_t info;
+        unsigned magic;
+        size_t const nbRead = fread(mnStore, 1, MAGICNUMBER_SIZE, srcFile);
+        if (nbRead == 0 && feof(srcFile)) { result = 0; break; }
+        if (nbRead != MAGICNUMBER_SIZE) {
+            DISPLAYLEVEL(1, "Error : %s : truncated frame \n", srcFileName);
+            break;
+        }
+        magic = LZ4IO_readLE32(mnStore);
+        if (LZ4IO_isSkippableMagicNumber(magic)) {
+            if ( (fread(mnStore, 1, 4, srcFile) != 4)
+              || (fseek_u32(srcFile, LZ4IO_readLE32(mnStore), SEEK_CUR) != 0) ) {
+                DISPLAYLEVEL(1, "Error : %s : truncated skippable frame \n", srcFileName);
+                break;
+            }
+            if (!copy) DISPLAYLEVEL(3, "%s : skippable frame dropped \n", srcFileName);
+            continue;
+        }
+        if (magic != LZ4IO_MAGICNUMBER) {
+            DISPLAYLEVEL(1, "Error : %s : not a LZ4 frame (legacy frames can't be merged) \n", srcFileName);
+            break;
+        }
+        if (LZ4IO_readFrameHeader(m->dctx, srcFile, &info)) {
+            DISPLAYLEVEL(1, "Error : %s : invalid frame header \n", srcFileName);
+            break;
+        }
+        if (copy) {
+            LZ4IO_mergeFrameBlocks(m, srcFile, srcFileName, &info);
+            continue;
+        }
+
+        if (info.blockMode != LZ4F_blockIndependent) {
+            DISPLAYLEVEL(1, "Error : %s : linked blocks can't be merged \n", srcFileName);
+            break;
+        }
+        if (m->nbFrames == 0) m->dictID = info.dictID;
+        if (info.blockSizeID > m->blockSizeID) m->blockSizeID = info.blockSizeID;   /* smaller blocks fit into larger ones */
+        if (info.dictID != m->dictID) {
+            DISPLAYLEVEL(1, "Error : %s : dictionary ID differs from first frame \n", srcFileName);
+            break;
+        }
+        if (info.contentSize) m->contentSize += info.contentSize; else m->allContentSize = 0;
+        if (LZ4IO_skipBlocksData(srcFile, info.blockChecksumFlag, info.contentChecksumFlag) == 0) {
+            DISPLAYLEVEL(1, "Error : %s : truncated frame \n", srcFileName);
+            break;
+        }
+        m->nbFrames++;
+    }
 
+    fclose(srcFile);
     return result;
 }
+
+int LZ4IO_mergeFrames(const char* dstFileName,
+                      const char** inFileNames, int nbFiles,
+                      const LZ4IO_prefs_t* prefs)
+{
+    LZ4IO_merge_t m;
+    LZ4F_preferences_t fPrefs = LZ4F_INIT_PREFERENCES;
+    void* dictBuffer = NULL;
+    size_t dictBufferSize = 0;
+    int i;
+
+    memset(&m, 0, sizeof(m));
+    m.allContentSize = 1;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&m.dctx, LZ4F_VERSION)))
+        END_PROCESS(93, "Allocation error : can't create LZ4F context");
+
+    /* 1st pass : check that all frames can be merged */
+    for (i = 0; i < nbFiles; i++) {
+        if (LZ4IO_mergeFile(&m, inFileNames[i], 0)) {
+            LZ4F_freeDecompressionContext(m.dctx);
+            return 1;
+    }   }
+    if (m.nbFrames == 0) {
+        DISPLAYLEVEL(1, "Error : no LZ4 frame to merge \n");
+        LZ4F_freeDecompressionContext(m.dctx);
+        return 1;
+    }
+
+    /* prepare output frame */
+    fPrefs.frameInfo.blockSizeID = m.blockSizeID;
+    fPrefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    fPrefs.frameInfo.blockChecksumFlag = (LZ4F_blockChecksum_t)prefs->blockChecksum;
+    fPrefs.frameInfo.contentChecksumFlag = (LZ4F_contentChecksum_t)prefs->streamChecksum;
+    fPrefs.frameInfo.dictID = m.dictID;
+    if (m.allContentSize)
+        fPrefs.frameInfo.contentSize = m.contentSize;
+    else if (prefs->contentSizeFlag)
+        DISPLAYLEVEL(2, "Warning : content size not stored : some input frames don't provide it \n");
+    m.blockSize = LZ4F_getBlockSize(m.blockSizeID);
+    m.cBuffer = (char*)malloc(LZ4F_BLOCK_HEADER_SIZE + m.blockSize + LZ4F_BLOCK_CHECKSUM_SIZE);
+    m.dBuffer = (char*)malloc(m.blockSize);
+    m.dstCapacity = LZ4F_HEADER_SIZE_MAX + LZ4F_BLOCK_HEADER_SIZE + m.blockSize + LZ4F_BLOCK_CHECKSUM_SIZE;
+    m.dstBuffer = malloc(m.dstCapacity);
+    if (!m.cBuffer || !m.dBuffer || !m.dstBuffer)
+        END_PROCESS(93, "Allocation error : not enough memory");
+    if (prefs->useDictionary) {
+        dictBuffer = LZ4IO_createDict(&dictBufferSize, prefs->dictionaryFilename);
+        m.dict = (const char*)dictBuffer;
+        m.dictSize = (int)dictBufferSize;
+    }
+    if (LZ4F_isError(LZ4F_createCompressionContext(&m.cctx, LZ4F_VERSION)))
+        END_PROCESS(93, "Allocation error : can't create LZ4F context");
+    if (prefs->seekable && LZ4F_isError(LZ4F_enableSeekTable(m.cctx, 1)))
+        END_PROCESS(93, "Allocation error : can't create seek table");
+
+    m.dstFile = LZ4IO_openDstFile(dstFileName, prefs);
+    if (m.dstFile == NULL) {
+        free(m.cBuffer); free(m.dBuffer); free(m.dstBuffer); free(dictBuffer);
+        LZ4F_freeCompressionContext(m.cctx);
+        LZ4F_freeDecompressionContext(m.dctx);
+        return 1;
+    }
+
+    /* 2nd pass : copy blocks */
+    {   size_t const headerSize = LZ4F_compressBegin(m.cctx, m.dstBuffer, m.dstCapacity, &fPrefs);
+        if (LZ4F_isError(headerSize))
+            END_PROCESS(96, "Merge error : %s", LZ4F_getErrorName(headerSize));
+        if (fwrite(m.dstBuffer, 1, headerSize, m.dstFile) != headerSize)
+            END_PROCESS(97, "Write error : cannot write header");
+        m.dstSize += headerSize;
+    }
+    for (i = 0; i < nbFiles; i++) {
+        if (LZ4IO_mergeFile(&m, inFileNames[i], 1))
+            END_PROCESS(98, "%s changed while merging", inFileNames[i]);
+    }
+    {   size_t const endSize = LZ4F_compressEnd(m.cctx, m.dstBuffer, m.dstCapacity, NULL);
+        if (LZ4F_isError(endSize))
+            END_PROCESS(96, "Merge error : %s", LZ4F_getErrorName(endSize));
+        if (fwrite(m.dstBuffer, 1, endSize, m.dstFile) != endSize)
+            END_PROCESS(97, "Write error : cannot write end of frame");
+        m.dstSize += endSize;
+    }
+    if (prefs->seekable)
+        m.dstSize += LZ4IO_writeSeekTable(m.cctx, m.dstFile);
+    if (!LZ4IO_isStdout(dstFileName)) fclose(m.dstFile);
+
+    DISPLAYLEVEL(2, "Merged %u frames from %i files into %s : %llu bytes \n",
+                    m.nbFrames, nbFiles, dstFileName, m.dstSize);
+    free(m.cBuffer);
+    free(m.dBuffer);
+    free(m.dstBuffer);
+    free(dictBuffer);
+    LZ4F_freeCompressionContext(m.cctx);
+    LZ4F_freeDecompressionContext(m.dctx);
+    return 0;
+}
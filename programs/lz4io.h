@@ -78,6 +78,11 @@ int LZ4IO_decompressMultipleFilenames(const char** inFileNamesTable, int ifntSiz
 int LZ4IO_setNbWorkers(LZ4IO_prefs_t* const prefs, int nbWorkers);
 int LZ4IO_defaultNbWorkers(void);
 
+/* Default setting : 0 (disabled)
+ * 1 distributes worker threads across NUMA nodes, binding each one to its node,
+ * so that buffers allocated by jobs are local to the worker processing them */
+int LZ4IO_setNumaAware(LZ4IO_prefs_t* const prefs, int enable);
+
 int LZ4IO_setDictionaryFilename(LZ4IO_prefs_t* const prefs, const char* dictionaryFilename);
 
 /* Default setting : passThrough = 0;
@@ -122,14 +127,86 @@ int LZ4IO_setContentSize(LZ4IO_prefs_t* const prefs, int enable);
 /* Default setting : 0 == src file preserved */
 void LZ4IO_setRemoveSrcFile(LZ4IO_prefs_t* const prefs, unsigned flag);
 
+/* Default setting : 0 == no seek table
+ * 1 appends a block index after each frame, enabling parallel decoding (-T#) */
+int LZ4IO_setSeekable(LZ4IO_prefs_t* const prefs, int enable);
+
+/* Default setting : 0 (disabled)
+ * 1 reports busy time of each processing stage (read, codec, checksum, write),
+ * queue stalls and write reordering depth, at the end of operation */
+int LZ4IO_setStats(LZ4IO_prefs_t* const prefs, int enable);
+
+/* Default setting : 0 (disabled)
+ * 1 reads input and writes output with O_DIRECT, bypassing the page cache.
+ * Applies to compression of regular files; output only in multi-threaded mode (-T#).
+ * Falls back to buffered I/O where unsupported. Linux only. */
+int LZ4IO_setDirectIO(LZ4IO_prefs_t* const prefs, int enable);
+
+/* Default setting : 0 (disabled)
+ * 1 also ends blocks at content-defined cut points, found by a rolling hash,
+ * so that compressed output of similar files shares identical blocks (rsync, deduplication).
+ * Implies independent blocks, and single-threaded compression. */
+int LZ4IO_setRsyncable(LZ4IO_prefs_t* const prefs, int enable);
+
+/* Default setting : 0 (disabled)
+ * 1 continues the last frame of an existing destination file, instead of overwriting it.
+ * This frame must use independent blocks, without content size nor dictionary ID, and end the file.
+ * A missing or empty destination receives a new frame, with independent blocks, which can be continued later.
+ * Implies single-threaded compression. Not compatible with seek tables, rsyncable mode nor dictionaries. */
+int LZ4IO_setAppend(LZ4IO_prefs_t* const prefs, int enable);
+
+/* Default setting : 0 (disabled)
+ * 1 makes --list output a JSON array, with one object per file */
+int LZ4IO_setListJSON(LZ4IO_prefs_t* const prefs, int enable);
+
+/* Default setting : 0 (no limit)
+ * Limits memory used by buffers of multi-threaded compression (-T#), in bytes,
+ * by reducing the size of jobs, down to 64 KB, and deepening the job queue instead.
+ * @return : maxMemory setting */
+size_t LZ4IO_setMaxMemory(LZ4IO_prefs_t* const prefs, size_t maxMemory);
+
+/* Default setting : 0 (disabled)
+ * When compressing from a pipe or terminal, hands input over to compression
+ * no later than @milliseconds after it arrives, instead of waiting for full blocks,
+ * and flushes output after each write, so that data flows through with bounded latency.
+ * @return : flush interval, in milliseconds */
+unsigned LZ4IO_setFlushInterval(LZ4IO_prefs_t* const prefs, unsigned milliseconds);
+
 /* Default setting : 0 == favor compression ratio
  * Note : 1 only works for high compression levels (10+) */
 void LZ4IO_favorDecSpeed(LZ4IO_prefs_t* const prefs, int favor);
 
+/* Default setting : 0 == always attempt compression
+ * Note : 1 only works for high compression levels (2+) with independent blocks */
+void LZ4IO_skipIncompressible(LZ4IO_prefs_t* const prefs, int skip);
+
+/* Default setting : 0 == fixed compression level
+ * 1 : level changes while compressing, within [minLevel, maxLevel],
+ *     so that compression keeps pace with read and write speeds.
+ * @return : 1 if enabled, 0 if disabled or if range is invalid */
+int LZ4IO_setAdaptiveLevel(LZ4IO_prefs_t* const prefs, int enable, int minLevel, int maxLevel);
+
 
 /* implement --list
+ * files are analyzed concurrently when prefs allow several workers.
+ * @return 0 on success, 1 on error */
+int LZ4IO_displayCompressedFilesInfo(const char** inFileNames, size_t ifnIdx, const LZ4IO_prefs_t* prefs);
+
+/* implement --train
+ * builds a dictionary of up to maxDictSize bytes from inFileNames, saved into dictFileName.
+ * files larger than 64 KB are cut into several samples.
+ * @return 0 on success, 1 on error */
+int LZ4IO_trainDictionary(const char* dictFileName,
+                          const char** inFileNames, int nbFiles,
+                          int maxDictSize, const LZ4IO_prefs_t* prefs);
+
+/* implement --merge
+ * copies blocks of all LZ4 frames from inFileNames into a single frame, saved into dstFileName,
+ * without recompressing them. Frames must use independent blocks.
  * @return 0 on success, 1 on error */
-int LZ4IO_displayCompressedFilesInfo(const char** inFileNames, size_t ifnIdx);
+int LZ4IO_mergeFrames(const char* dstFileName,
+                      const char** inFileNames, int nbFiles,
+                      const LZ4IO_prefs_t* prefs);
 
 
 #endif  /* LZ4IO_H_237902873 */
@@ -24,6 +24,9 @@
 
 
 /* ======   Dependencies   ======= */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* pthread_setaffinity_np, CPU_SET */
+#endif
 #include <assert.h>
 #include "lz4conf.h"  /* LZ4IO_MULTITHREAD */
 #include "threadpool.h"
@@ -53,6 +56,11 @@ TPOOL_ctx* TPOOL_create(int numThreads, int queueSize) {
     return &g_poolCtx;
 }
 
+TPOOL_ctx* TPOOL_create_advanced(int numThreads, int queueSize, int numaAware) {
+    (void)numaAware;
+    return TPOOL_create(numThreads, queueSize);
+}
+
 void TPOOL_free(TPOOL_ctx* ctx) {
     assert(!ctx || ctx == &g_poolCtx);
     (void)ctx;
@@ -63,11 +71,28 @@ void TPOOL_submitJob(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg) {
     job_function(arg);
 }
 
+void TPOOL_submitJob_advanced(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg, TPOOL_priority priority) {
+    (void)ctx; (void)priority;
+    job_function(arg);
+}
+
+int TPOOL_trySubmitJob(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg, TPOOL_priority priority) {
+    (void)ctx; (void)priority;
+    job_function(arg);
+    return 1;
+}
+
 void TPOOL_completeJobs(TPOOL_ctx* ctx) {
     assert(!ctx || ctx == &g_poolCtx);
     (void)ctx;
 }
 
+unsigned long long TPOOL_nbStalls(TPOOL_ctx* ctx) {
+    assert(!ctx || ctx == &g_poolCtx);
+    (void)ctx;
+    return 0;
+}
+
 #else
 
 /* pthread only */
@@ -80,20 +105,26 @@ typedef struct TPOOL_job_s {
     void *arg;
 } TPOOL_job;
 
+/* Each priority level has its own queue, which is a circular buffer */
+#define TPOOL_NB_PRIORITIES 2
+typedef struct {
+    TPOOL_job* jobs;
+    size_t head;
+    size_t tail;
+} TPOOL_queue;
+
 struct TPOOL_ctx_s {
     pthread_t* threads;
     size_t threadCapacity;
     size_t threadLimit;
 
-    /* The queue is a circular buffer */
-    TPOOL_job* queue;
-    size_t queueHead;
-    size_t queueTail;
+    /* Queues, indexed by TPOOL_priority */
+    TPOOL_queue queues[TPOOL_NB_PRIORITIES];
     size_t queueSize;
 
     /* The number of threads working on jobs */
     size_t numThreadsBusy;
-    /* Indicates if the queue is empty */
+    /* Indicates if all queues are empty */
     int queueEmpty;
 
     /* The mutex protects the queue */
@@ -104,6 +135,8 @@ struct TPOOL_ctx_s {
     pthread_cond_t queuePopCond;
     /* Indicates if the queue is shutting down */
     int shutdown;
+    /* Number of submissions which had to wait for a full queue */
+    unsigned long long nbStalls;
 };
 
 static void TPOOL_shutdown(TPOOL_ctx* ctx);
@@ -114,14 +147,89 @@ void TPOOL_free(TPOOL_ctx* ctx) {
     pthread_mutex_destroy(&ctx->queueMutex);
     pthread_cond_destroy(&ctx->queuePushCond);
     pthread_cond_destroy(&ctx->queuePopCond);
-    free(ctx->queue);
+    {   int p;
+        for (p = 0; p < TPOOL_NB_PRIORITIES; p++) free(ctx->queues[p].jobs);
+    }
     free(ctx->threads);
     free(ctx);
 }
 
 static void* TPOOL_thread(void* opaque);
 
+#if defined(__linux__)
+#  include <sched.h>   /* cpu_set_t */
+#endif
+#if defined(__linux__) && defined(CPU_SET)
+#  define TPOOL_NUMA_SUPPORT 1
+#  include <stdio.h>   /* fopen, fscanf, sprintf */
+
+#define TPOOL_NODES_MAX 64
+
+/* TPOOL_readNodeCpus() :
+ * parses /sys/devices/system/node/node#/cpulist, formatted like "0-3,8-11"
+ * @return : 1 if node exists and has cpus, 0 otherwise */
+static int TPOOL_readNodeCpus(int node, cpu_set_t* cpus)
+{
+    char path[64];
+    FILE* f;
+    int nbCpus = 0;
+    unsigned first, last;
+    assert(node < TPOOL_NODES_MAX);
+    sprintf(path, "/sys/devices/system/node/node%i/cpulist", node);
+    f = fopen(path, "r");
+    if (f == NULL) return 0;
+    CPU_ZERO(cpus);
+    while (fscanf(f, "%u", &first) == 1) {
+        int c = fgetc(f);
+        last = first;
+        if (c == '-') {
+            if (fscanf(f, "%u", &last) != 1) break;
+            c = fgetc(f);
+        }
+        for ( ; (first <= last) && (first < CPU_SETSIZE); first++) {
+            CPU_SET(first, cpus);
+            nbCpus++;
+        }
+        if (c != ',') break;
+    }
+    fclose(f);
+    return nbCpus > 0;
+}
+
+/* TPOOL_bindThreads() :
+ * binds threads round-robin to NUMA nodes.
+ * Does nothing on single-node systems. Failures are silently ignored. */
+static void TPOOL_bindThreads(TPOOL_ctx* ctx)
+{
+    cpu_set_t* const nodes = (cpu_set_t*)malloc(TPOOL_NODES_MAX * sizeof(cpu_set_t));
+    int nbNodes = 0;
+    if (nodes == NULL) return;
+    while ((nbNodes < TPOOL_NODES_MAX) && TPOOL_readNodeCpus(nbNodes, &nodes[nbNodes])) nbNodes++;
+    if (nbNodes > 1) {
+        size_t i;
+        for (i = 0; i < ctx->threadCapacity; i++)
+            (void)pthread_setaffinity_np(ctx->threads[i], sizeof(cpu_set_t), &nodes[i % (size_t)nbNodes]);
+    }
+    free(nodes);
+}
+#else
+#  define TPOOL_NUMA_SUPPORT 0
+#endif
+
+static int TPOOL_allQueuesEmpty(TPOOL_ctx const* ctx)
+{
+    int p;
+    for (p = 0; p < TPOOL_NB_PRIORITIES; p++)
+        if (ctx->queues[p].head != ctx->queues[p].tail) return 0;
+    return 1;
+}
+
 TPOOL_ctx* TPOOL_create(int nbThreads, int queueSize)
+{
+    return TPOOL_create_advanced(nbThreads, queueSize, 0);
+}
+
+TPOOL_ctx* TPOOL_create_advanced(int nbThreads, int queueSize, int numaAware)
 {
     TPOOL_ctx* ctx;
     /* Check parameters */
@@ -141,13 +249,16 @@ TPOOL_ctx* TPOOL_create(int nbThreads, int queueSize)
      * empty and full queues.
      */
     ctx->queueSize = (size_t)queueSize + 1;
-    ctx->queue = (TPOOL_job*)calloc(1, ctx->queueSize * sizeof(TPOOL_job));
-    if (ctx->queue == NULL) {
-        TPOOL_free(ctx);
-        return NULL;
-    }
-    ctx->queueHead = 0;
-    ctx->queueTail = 0;
+    {   int p;
+        for (p = 0; p < TPOOL_NB_PRIORITIES; p++) {
+            ctx->queues[p].jobs = (TPOOL_job*)calloc(1, ctx->queueSize * sizeof(TPOOL_job));
+            if (ctx->queues[p].jobs == NULL) {
+                TPOOL_free(ctx);
+                return NULL;
+            }
+            ctx->queues[p].head = 0;
+            ctx->queues[p].tail = 0;
+    }   }
     ctx->numThreadsBusy = 0;
     ctx->queueEmpty = 1;
     ctx->shutdown = 0;
@@ -169,6 +280,11 @@ TPOOL_ctx* TPOOL_create(int nbThreads, int queueSize)
         ctx->threadCapacity = (size_t)nbThreads;
         ctx->threadLimit = (size_t)nbThreads;
     }
+#if TPOOL_NUMA_SUPPORT
+    if (numaAware) TPOOL_bindThreads(ctx);
+#else
+    (void)numaAware;
+#endif
     return ctx;
 }
 
@@ -195,11 +311,16 @@ static void* TPOOL_thread(void* opaque) {
             }
             pthread_cond_wait(&ctx->queuePopCond, &ctx->queueMutex);
         }
-        /* Pop a job off the queue */
-        {   TPOOL_job const job = ctx->queue[ctx->queueHead];
-            ctx->queueHead = (ctx->queueHead + 1) % ctx->queueSize;
+        /* Pop a job off the highest priority non-empty queue */
+        {   int p = TPOOL_NB_PRIORITIES-1;
+            TPOOL_queue* q;
+            TPOOL_job job;
+            while (ctx->queues[p].head == ctx->queues[p].tail) { assert(p > 0); p--; }
+            q = &ctx->queues[p];
+            job = q->jobs[q->head];
+            q->head = (q->head + 1) % ctx->queueSize;
             ctx->numThreadsBusy++;
-            ctx->queueEmpty = (ctx->queueHead == ctx->queueTail);
+            ctx->queueEmpty = TPOOL_allQueuesEmpty(ctx);
             /* Unlock the mutex, signal a pusher, and run the job */
             pthread_cond_signal(&ctx->queuePushCond);
             pthread_mutex_unlock(&ctx->queueMutex);
@@ -247,14 +368,15 @@ void TPOOL_completeJobs(TPOOL_ctx* ctx){
 }
 
 /**
- * Returns 1 if the queue is full and 0 otherwise.
+ * Returns 1 if the queue of selected @priority is full and 0 otherwise.
  *
  * When queueSize is 1 (pool was created with an intended queueSize of 0),
  * then a queue is empty if there is a thread free _and_ no job is waiting.
  */
-static int isQueueFull(TPOOL_ctx const* ctx) {
+static int isQueueFull(TPOOL_ctx const* ctx, TPOOL_priority priority) {
+    TPOOL_queue const* const q = &ctx->queues[priority];
     if (ctx->queueSize > 1) {
-        return ctx->queueHead == ((ctx->queueTail + 1) % ctx->queueSize);
+        return q->head == ((q->tail + 1) % ctx->queueSize);
     } else {
         return (ctx->numThreadsBusy == ctx->threadLimit) ||
                !ctx->queueEmpty;
@@ -262,8 +384,9 @@ static int isQueueFull(TPOOL_ctx const* ctx) {
 }
 
 static void
-TPOOL_submitJob_internal(TPOOL_ctx* ctx, void (*job_function)(void*), void *arg)
+TPOOL_submitJob_internal(TPOOL_ctx* ctx, void (*job_function)(void*), void *arg, TPOOL_priority priority)
 {
+    TPOOL_queue* const q = &ctx->queues[priority];
     TPOOL_job job;
     job.job_function = job_function;
     job.arg = arg;
@@ -271,21 +394,152 @@ TPOOL_submitJob_internal(TPOOL_ctx* ctx, void (*job_function)(void*), void *arg)
     if (ctx->shutdown) return;
 
     ctx->queueEmpty = 0;
-    ctx->queue[ctx->queueTail] = job;
-    ctx->queueTail = (ctx->queueTail + 1) % ctx->queueSize;
+    q->jobs[q->tail] = job;
+    q->tail = (q->tail + 1) % ctx->queueSize;
     pthread_cond_signal(&ctx->queuePopCond);
 }
 
-void TPOOL_submitJob(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg)
+void TPOOL_submitJob_advanced(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg, TPOOL_priority priority)
 {
     assert(ctx != NULL);
+    assert((unsigned)priority < TPOOL_NB_PRIORITIES);
     pthread_mutex_lock(&ctx->queueMutex);
+    ctx->nbStalls += (unsigned long long)isQueueFull(ctx, priority);
     /* Wait until there is space in the queue for the new job */
-    while (isQueueFull(ctx) && (!ctx->shutdown)) {
+    while (isQueueFull(ctx, priority) && (!ctx->shutdown)) {
         pthread_cond_wait(&ctx->queuePushCond, &ctx->queueMutex);
     }
-    TPOOL_submitJob_internal(ctx, job_function, arg);
+    TPOOL_submitJob_internal(ctx, job_function, arg, priority);
     pthread_mutex_unlock(&ctx->queueMutex);
 }
 
+void TPOOL_submitJob(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg)
+{
+    TPOOL_submitJob_advanced(ctx, job_function, arg, TPOOL_PRIORITY_NORMAL);
+}
+
+int TPOOL_trySubmitJob(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg, TPOOL_priority priority)
+{
+    int queued = 0;
+    assert(ctx != NULL);
+    assert((unsigned)priority < TPOOL_NB_PRIORITIES);
+    pthread_mutex_lock(&ctx->queueMutex);
+    if (!isQueueFull(ctx, priority) && !ctx->shutdown) {
+        TPOOL_submitJob_internal(ctx, job_function, arg, priority);
+        queued = 1;
+    }
+    pthread_mutex_unlock(&ctx->queueMutex);
+    return queued;
+}
+
+unsigned long long TPOOL_nbStalls(TPOOL_ctx* ctx)
+{
+    unsigned long long nbStalls;
+    assert(ctx != NULL);
+    pthread_mutex_lock(&ctx->queueMutex);
+    nbStalls = ctx->nbStalls;
+    pthread_mutex_unlock(&ctx->queueMutex);
+    return nbStalls;
+}
+
 #endif  /* LZ4IO_NO_MT */
+
+
+/* ======   Buffer pool   ====== */
+
+#include <stdlib.h>  /* malloc, free */
+
+struct TPOOL_bufPool_s {
+    size_t bufSize;
+    void* (*allocFn)(size_t);
+    void** cached;     /* released buffers, available for reuse */
+    size_t nbCached;
+    size_t maxCached;
+    unsigned long long nbAllocs;
+#if LZ4IO_MULTITHREAD
+    pthread_mutex_t mutex;
+#endif
+};
+
+#if LZ4IO_MULTITHREAD
+#  define TPOOL_BP_LOCK(bp)   pthread_mutex_lock(&(bp)->mutex)
+#  define TPOOL_BP_UNLOCK(bp) pthread_mutex_unlock(&(bp)->mutex)
+#else
+#  define TPOOL_BP_LOCK(bp)   (void)(bp)
+#  define TPOOL_BP_UNLOCK(bp) (void)(bp)
+#endif
+
+TPOOL_bufPool* TPOOL_bufPool_create(size_t bufSize, size_t maxCached, void* (*allocFn)(size_t))
+{
+    TPOOL_bufPool* const bp = (TPOOL_bufPool*)calloc(1, sizeof(TPOOL_bufPool));
+    if (!bp) { return NULL; }
+    bp->cached = (void**)calloc(maxCached + !maxCached, sizeof(void*));
+    if (!bp->cached) { free(bp); return NULL; }
+#if LZ4IO_MULTITHREAD
+    if (pthread_mutex_init(&bp->mutex, NULL)) {
+        free(bp->cached);
+        free(bp);
+        return NULL;
+    }
+#endif
+    bp->bufSize = bufSize;
+    bp->allocFn = allocFn ? allocFn : malloc;
+    bp->maxCached = maxCached;
+    return bp;
+}
+
+void TPOOL_bufPool_free(TPOOL_bufPool* bp)
+{
+    if (!bp) { return; }
+    while (bp->nbCached) free(bp->cached[--bp->nbCached]);
+#if LZ4IO_MULTITHREAD
+    pthread_mutex_destroy(&bp->mutex);
+#endif
+    free(bp->cached);
+    free(bp);
+}
+
+void* TPOOL_bufPool_acquire(TPOOL_bufPool* bp)
+{
+    void* buf = NULL;
+    assert(bp != NULL);
+    TPOOL_BP_LOCK(bp);
+    if (bp->nbCached) {
+        buf = bp->cached[--bp->nbCached];
+    } else {
+        bp->nbAllocs++;
+    }
+    TPOOL_BP_UNLOCK(bp);
+    /* allocation happens outside of the lock */
+    if (!buf) buf = bp->allocFn(bp->bufSize);
+    return buf;
+}
+
+void TPOOL_bufPool_release(TPOOL_bufPool* bp, void* buf)
+{
+    assert(bp != NULL);
+    if (!buf) { return; }
+    TPOOL_BP_LOCK(bp);
+    if (bp->nbCached < bp->maxCached) {
+        bp->cached[bp->nbCached++] = buf;
+        buf = NULL;
+    }
+    TPOOL_BP_UNLOCK(bp);
+    free(buf);
+}
+
+size_t TPOOL_bufPool_bufSize(const TPOOL_bufPool* bp)
+{
+    assert(bp != NULL);
+    return bp->bufSize;
+}
+
+unsigned long long TPOOL_bufPool_nbAllocs(TPOOL_bufPool* bp)
+{
+    unsigned long long nbAllocs;
+    assert(bp != NULL);
+    TPOOL_BP_LOCK(bp);
+    nbAllocs = bp->nbAllocs;
+    TPOOL_BP_UNLOCK(bp);
+    return nbAllocs;
+}
@@ -29,6 +29,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h>   /* size_t */
+
 typedef struct TPOOL_ctx_s TPOOL_ctx;
 
 /*! TPOOL_create() :
@@ -39,6 +41,15 @@ typedef struct TPOOL_ctx_s TPOOL_ctx;
 */
 TPOOL_ctx* TPOOL_create(int nbThreads, int queueSize);
 
+/*! TPOOL_create_advanced() :
+ *  Same as TPOOL_create(), but when @numaAware is non-zero,
+ *  threads are distributed round-robin across NUMA nodes,
+ *  each one bound to the CPUs of its node.
+ *  Memory first touched by a job is then allocated on the node running it.
+ *  Only effective on Linux systems with multiple NUMA nodes.
+*/
+TPOOL_ctx* TPOOL_create_advanced(int nbThreads, int queueSize, int numaAware);
+
 /*! TPOOL_free() :
  *  Free a thread pool returned by TPOOL_create().
  *  Note: if jobs are already running, @free first waits for their completion
@@ -53,11 +64,77 @@ void TPOOL_free(TPOOL_ctx* ctx);
  */
 void TPOOL_submitJob(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg);
 
+/*! TPOOL_priority :
+ *  High priority jobs are started before any pending normal priority job.
+ *  Typically used for I/O jobs, so that they don't wait behind CPU-bound jobs.
+ *  Each priority level has its own queue, of size @queueSize.
+ */
+typedef enum { TPOOL_PRIORITY_NORMAL = 0, TPOOL_PRIORITY_HIGH = 1 } TPOOL_priority;
+
+/*! TPOOL_submitJob_advanced() :
+ *  Same as TPOOL_submitJob(), with selectable @priority.
+ *  TPOOL_submitJob() uses TPOOL_PRIORITY_NORMAL.
+ */
+void TPOOL_submitJob_advanced(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg, TPOOL_priority priority);
+
+/*! TPOOL_trySubmitJob() :
+ *  Add @job_function(arg) to the thread pool, but only if it can be done without blocking.
+ * @return : 1 if job was queued, in which case @arg is now owned by @job_function,
+ *           0 if queue is full, in which case job was not queued.
+ */
+int TPOOL_trySubmitJob(TPOOL_ctx* ctx, void (*job_function)(void*), void* arg, TPOOL_priority priority);
+
 /*! TPOOL_completeJobs() :
  *  Blocks, waiting for all queued jobs to be completed
  */
 void TPOOL_completeJobs(TPOOL_ctx* ctx);
 
+/*! TPOOL_nbStalls() :
+ *  @return : nb of TPOOL_submitJob() invocations which found their queue full,
+ *            and therefore had to wait, since pool creation.
+ *            Refused TPOOL_trySubmitJob() are not counted.
+ */
+unsigned long long TPOOL_nbStalls(TPOOL_ctx* ctx);
+
+
+/* Buffer pool :
+ * recycles fixed-size buffers, released by one thread and acquired by another,
+ * so that steady state pipelines don't allocate.
+ * All functions are thread-safe. */
+typedef struct TPOOL_bufPool_s TPOOL_bufPool;
+
+/*! TPOOL_bufPool_create() :
+ *  Create a pool of buffers of @bufSize bytes.
+ *  At most @maxCached released buffers are kept for reuse, others are freed.
+ *  Buffers are allocated with @allocFn (malloc() if NULL), and released with free().
+ * @return : TPOOL_bufPool pointer on success, else NULL.
+ */
+TPOOL_bufPool* TPOOL_bufPool_create(size_t bufSize, size_t maxCached, void* (*allocFn)(size_t));
+
+/*! TPOOL_bufPool_free() :
+ *  Release all cached buffers, and the pool.
+ *  Buffers still acquired at this point must not be released afterwards.
+ */
+void TPOOL_bufPool_free(TPOOL_bufPool* bp);
+
+/*! TPOOL_bufPool_acquire() :
+ * @return : a buffer of TPOOL_bufPool_bufSize() bytes, cached if possible, newly allocated otherwise,
+ *           or NULL if allocation failed.
+ */
+void* TPOOL_bufPool_acquire(TPOOL_bufPool* bp);
+
+/*! TPOOL_bufPool_release() :
+ *  Give @buf, acquired from @bp, back to @bp. @buf can be NULL.
+ */
+void TPOOL_bufPool_release(TPOOL_bufPool* bp, void* buf);
+
+size_t TPOOL_bufPool_bufSize(const TPOOL_bufPool* bp);
+
+/*! TPOOL_bufPool_nbAllocs() :
+ * @return : nb of buffers allocated since pool creation, i.e. acquisitions which couldn't reuse a cached buffer.
+ */
+unsigned long long TPOOL_bufPool_nbAllocs(TPOOL_bufPool* bp);
+
 
 
 #if defined (__cplusplus)
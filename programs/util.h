@@ -52,6 +52,9 @@ extern "C" {
 #include <time.h>         /* time */
 #include <limits.h>       /* INT_MAX */
 #include <errno.h>
+#if defined(__APPLE__)
+#  include <sys/sysctl.h> /* sysctlbyname */
+#endif
 
 
 
@@ -560,6 +563,50 @@ UTIL_freeFileList(const char** filenameTable, char* allocatedBuffer)
 }
 
 
+/*-****************************************
+*  Host information
+******************************************/
+/*! UTIL_getCpuModel() :
+ *  Writes a description of local CPU into @buffer (always 0-terminated),
+ *  or "unknown" when not available on this platform.
+ *  @return : @buffer */
+UTIL_STATIC const char* UTIL_getCpuModel(char* buffer, size_t bufferSize)
+{
+    assert(buffer != NULL && bufferSize > 0);
+    buffer[0] = 0;
+#if defined(__APPLE__)
+    {   size_t size = bufferSize;
+        if (sysctlbyname("machdep.cpu.brand_string", buffer, &size, NULL, 0) != 0) buffer[0] = 0;
+        buffer[bufferSize-1] = 0;
+    }
+#elif defined(__linux__)
+    {   FILE* const cpuinfo = fopen("/proc/cpuinfo", "r");
+        char line[256];
+        if (cpuinfo != NULL) {
+            while (fgets(line, sizeof(line), cpuinfo) != NULL) {
+                if (!strncmp(line, "model name", 10) || !strncmp(line, "Processor", 9)) {
+                    const char* const sep = strchr(line, ':');
+                    if (sep != NULL) {
+                        const char* start = sep + 1;
+                        size_t len;
+                        while (*start == ' ' || *start == '\t') start++;
+                        len = strcspn(start, "\r\n");
+                        if (len >= bufferSize) len = bufferSize-1;
+                        memcpy(buffer, start, len);
+                        buffer[len] = 0;
+                        break;
+            }   }   }
+            fclose(cpuinfo);
+    }   }
+#endif
+    if (buffer[0] == 0) {
+        strncpy(buffer, "unknown", bufferSize-1);
+        buffer[bufferSize-1] = 0;
+    }
+    return buffer;
+}
+
+
 #if defined (__cplusplus)
 }
 #endif
@@ -46,6 +46,7 @@
 #define LZ4F_STATIC_LINKING_ONLY
 #include "lz4frame.h"
 #include "lz4frame.h"
+#include "lz4file.h"
 #define LZ4_STATIC_LINKING_ONLY  /* LZ4_DISTANCE_MAX */
 #include "lz4.h"        /* LZ4_VERSION_STRING */
 #define XXH_STATIC_LINKING_ONLY
@@ -62,6 +63,12 @@ static void FUZ_writeLE32 (void* dstVoidPtr, U32 value32)
     dstPtr[3] = (BYTE)(value32 >> 24);
 }
 
+static U32 FUZ_readLE32 (const void* srcVoidPtr)
+{
+    const BYTE* const srcPtr = (const BYTE*)srcVoidPtr;
+    return (U32)srcPtr[0] + ((U32)srcPtr[1] << 8) + ((U32)srcPtr[2] << 16) + ((U32)srcPtr[3] << 24);
+}
+
 
 /*-************************************
 *  Constants
@@ -276,6 +283,73 @@ static int bug1227(void)
 #define CHECK_V(v,f) v = f; if (LZ4F_isError(v)) { fprintf(stderr, "%s \n", LZ4F_getErrorName(v)); goto _output_error; }
 #define CHECK(f)   { LZ4F_errorCode_t const CHECK_V(err_ , f); }
 
+/* deferred executor : jobs are run in reverse order, on completion request */
+#define DEFERRED_JOBS_MAX 64
+typedef struct {
+    LZ4F_JobFunction jobs[DEFERRED_JOBS_MAX];
+    void* args[DEFERRED_JOBS_MAX];
+    int nbJobs;
+} DeferredJobs;
+
+static void deferred_submitJob(void* state, LZ4F_JobFunction job, void* jobArg)
+{
+    DeferredJobs* const dj = (DeferredJobs*)state;
+    if (dj->nbJobs == DEFERRED_JOBS_MAX) { job(jobArg); return; }
+    dj->jobs[dj->nbJobs] = job;
+    dj->args[dj->nbJobs] = jobArg;
+    dj->nbJobs++;
+}
+
+static void deferred_completeJobs(void* state)
+{
+    DeferredJobs* const dj = (DeferredJobs*)state;
+    while (dj->nbJobs > 0) {
+        dj->nbJobs--;
+        dj->jobs[dj->nbJobs](dj->args[dj->nbJobs]);
+    }
+}
+
+/* FUZ_lz4fileCreate() :
+ * writes @src as a single frame into a new temporary file, using lz4file.
+ * @return : the file, rewound, or NULL on failure */
+static FILE* FUZ_lz4fileCreate(const LZ4F_preferences_t* prefs, const void* src, size_t srcSize)
+{
+    FILE* const f = tmpfile();
+    LZ4_writeFile_t* lz4fWrite;
+    if (f == NULL) return NULL;
+    if ( LZ4F_isError(LZ4F_writeOpen(&lz4fWrite, f, prefs))
+      || LZ4F_isError(LZ4F_write(lz4fWrite, src, srcSize))
+      || LZ4F_isError(LZ4F_writeClose(lz4fWrite)) ) {
+        fclose(f);
+        return NULL;
+    }
+    rewind(f);
+    return f;
+}
+
+/* test codec : software LZ4, declining one call out of 3, like a busy device */
+typedef struct {
+    int nbCalls;
+    int nbProcessed;
+} TestCodec;
+
+static int testCodec_compressBlock(void* state, const char* src, char* dst, int srcSize, int dstCapacity, int level)
+{
+    TestCodec* const tc = (TestCodec*)state;
+    (void)level;
+    if ((++tc->nbCalls % 3) == 0) return -1;
+    tc->nbProcessed++;
+    return LZ4_compress_default(src, dst, srcSize, dstCapacity);
+}
+
+static int testCodec_decompressBlock(void* state, const char* src, char* dst, int srcSize, int dstCapacity)
+{
+    TestCodec* const tc = (TestCodec*)state;
+    if ((++tc->nbCalls % 3) == 0) return -1;
+    tc->nbProcessed++;
+    return LZ4_decompress_safe(src, dst, srcSize, dstCapacity);
+}
+
 static int unitTests(U32 seed, double compressibility)
 {
 #define COMPRESSIBLE_NOISE_LENGTH (2 MB)
@@ -580,6 +654,1007 @@ static int unitTests(U32 seed, double compressibility)
         CHECK( LZ4F_freeDecompressionContext(dctx) );
     }
 
+    DISPLAYLEVEL(3, "LZ4F_decompressFrame : \n");
+    {   size_t const blockSize = 64 KB;
+        size_t const srcSize = 8 * blockSize;
+        char* const mixed = (char*)malloc(srcSize);
+        int blockMode;
+        if (mixed == NULL) goto _output_error;
+        /* some incompressible blocks, stored uncompressed, are mixed with compressible ones */
+        memcpy(mixed, CNBuffer, srcSize);
+        {   size_t i;
+            for (i = 3 * blockSize; i < 5 * blockSize; i++) mixed[i] = (char)(FUZ_rand(randState) >> 5);
+        }
+        for (blockMode = 0; blockMode < 2; blockMode++) {
+            DISPLAYLEVEL(3, "%s blocks : ", blockMode ? "independent" : "linked");
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.blockMode = (LZ4F_blockMode_t)blockMode;
+            prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            prefs.frameInfo.contentSize = srcSize;
+            CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, LZ4F_compressFrameBound(srcSize, &prefs), mixed, srcSize, &prefs));
+            {   size_t const dSize = LZ4F_decompressFrame(decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, compressedBuffer, cSize, NULL, 0);
+                CHECK(dSize);
+                if (dSize != srcSize) goto _output_error;
+                if (memcmp(mixed, decodedBuffer, srcSize)) goto _output_error;
+            }
+            /* errors */
+            if (!LZ4F_isError(LZ4F_decompressFrame(decodedBuffer, srcSize-1, compressedBuffer, cSize, NULL, 0))) goto _output_error;
+            if (!LZ4F_isError(LZ4F_decompressFrame(decodedBuffer, srcSize, compressedBuffer, cSize-1, NULL, 0))) goto _output_error;
+            ((char*)compressedBuffer)[cSize/2] ^= 1;
+            if (!LZ4F_isError(LZ4F_decompressFrame(decodedBuffer, srcSize, compressedBuffer, cSize, NULL, 0))) goto _output_error;
+            ((char*)compressedBuffer)[cSize/2] ^= 1;
+            ((char*)compressedBuffer)[cSize-9] ^= 1;   /* last block checksum */
+            {   size_t const err = LZ4F_decompressFrame(decodedBuffer, srcSize, compressedBuffer, cSize, NULL, 0);
+                if (LZ4F_getErrorCode(err) != LZ4F_ERROR_blockChecksum_invalid) goto _output_error;
+            }
+            DISPLAYLEVEL(3, "OK \n");
+        }
+        free(mixed);
+    }
+    DISPLAYLEVEL(3, "LZ4F_decompressFrame with dictionary : ");
+    {   size_t const dictSize = 64 KB;
+        size_t const srcSize = 256 KB;
+        const char* const dict = (const char*)CNBuffer;
+        const char* const src = dict + dictSize;
+        LZ4F_CDict* const cdict = LZ4F_createCDict(dict, dictSize);
+        if (cdict == NULL) goto _output_error;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+        prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+        CHECK_V(cSize, LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, LZ4F_compressFrameBound(srcSize, &prefs), src, srcSize, cdict, &prefs));
+        {   size_t const dSize = LZ4F_decompressFrame(decodedBuffer, srcSize, compressedBuffer, cSize, dict, dictSize);
+            CHECK(dSize);
+            if (dSize != srcSize) goto _output_error;
+            if (memcmp(src, decodedBuffer, srcSize)) goto _output_error;
+        }
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        LZ4F_freeCDict(cdict);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_decompress_inplace : ");
+    {   size_t const srcSize = 600 KB;
+        char* const mixed = (char*)malloc(srcSize);
+        int n;
+        if (mixed == NULL) goto _output_error;
+        /* compressible data, with an incompressible segment, stored uncompressed */
+        memcpy(mixed, CNBuffer, srcSize);
+        {   size_t i;
+            for (i = 200 KB; i < 330 KB; i++) mixed[i] = (char)(FUZ_rand(randState) >> 5);
+        }
+        for (n = 0; n < 16; n++) {
+            size_t bufferSize;
+            char* buffer;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockMode = (LZ4F_blockMode_t)(n & 1);
+            prefs.frameInfo.blockChecksumFlag = (LZ4F_blockChecksum_t)((n >> 1) & 1);
+            prefs.frameInfo.contentChecksumFlag = (LZ4F_contentChecksum_t)((n >> 2) & 1);
+            prefs.frameInfo.blockSizeID = (n & 8) ? LZ4F_max256KB : LZ4F_max64KB;
+            prefs.compressionLevel = (n & 4) ? 9 : 1;
+            CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, LZ4F_compressFrameBound(srcSize, &prefs), mixed, srcSize, &prefs));
+            bufferSize = LZ4F_decompressInplaceBound(srcSize, &prefs.frameInfo);
+            if (bufferSize > LZ4F_decompressInplaceBound(srcSize, NULL)) goto _output_error;
+            buffer = (char*)malloc(bufferSize);
+            if (buffer == NULL) goto _output_error;
+            memcpy(buffer + bufferSize - cSize, compressedBuffer, cSize);
+            {   size_t const dSize = LZ4F_decompress_inplace(buffer, bufferSize, cSize);
+                CHECK(dSize);
+                if (dSize != srcSize) goto _output_error;
+                if (memcmp(mixed, buffer, srcSize)) goto _output_error;
+            }
+            /* margin too small : must fail, without reading beyond buffer */
+            memcpy(buffer + 64, compressedBuffer, cSize);
+            if (!LZ4F_isError(LZ4F_decompress_inplace(buffer, 64 + cSize, cSize))) goto _output_error;
+            free(buffer);
+        }
+        free(mixed);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_decompress into a ring buffer : ");
+    {   size_t const srcSize = 1 MB;
+        size_t const maxBlockSize = 64 KB;
+        size_t const ringSize = LZ4F_DECODER_RING_BUFFER_SIZE(maxBlockSize);
+        char* const ring = (char*)malloc(ringSize);
+        const char* const dict = (const char*)CNBuffer + srcSize;
+        size_t const dictSize = 64 KB;
+        int withDict;
+        if (ring == NULL) goto _output_error;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        LZ4F_setDecoderRingBuffer(dCtx, ring, ringSize);
+        for (withDict = 0; withDict < 2; withDict++) {
+            /* small blocks, from autoFlush, and full blocks */
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            prefs.autoFlush = 1;
+            {   size_t pos = 0;
+                CHECK_V(cSize, LZ4F_compressBegin_usingDict(cctx, compressedBuffer, cBuffSize,
+                                                            withDict ? dict : NULL, withDict ? dictSize : 0, &prefs));
+                while (pos < srcSize) {
+                    size_t const chunkMax = (FUZ_rand(randState) & 1) ? 7 KB : 100 KB;
+                    size_t const chunk = MIN(srcSize - pos, chunkMax);
+                    size_t const r = LZ4F_compressUpdate(cctx, (char*)compressedBuffer + cSize, cBuffSize - cSize,
+                                                         (const char*)CNBuffer + pos, chunk, NULL);
+                    CHECK(r);
+                    cSize += r;
+                    pos += chunk;
+                }
+                {   size_t const r = LZ4F_compressEnd(cctx, (char*)compressedBuffer + cSize, cBuffSize - cSize, NULL);
+                    CHECK(r);
+                    cSize += r;
+            }   }
+            {   size_t ringPos = 0, cPos = 0, decodedSize = 0, result = 1;
+                while (result != 0) {
+                    size_t const iSizeMax = 1 + (FUZ_rand(randState) % (96 KB));
+                    size_t iSize = MIN(cSize - cPos, iSizeMax);
+                    size_t oSize;
+                    if (ringSize - ringPos < maxBlockSize) ringPos = 0;   /* wrap around */
+                    oSize = ringSize - ringPos;
+                    result = LZ4F_decompress_usingDict(dCtx, ring + ringPos, &oSize, (const char*)compressedBuffer + cPos, &iSize,
+                                                       withDict ? dict : NULL, withDict ? dictSize : 0, NULL);
+                    CHECK(result);
+                    if (decodedSize + oSize > srcSize) goto _output_error;
+                    memcpy((char*)decodedBuffer + decodedSize, ring + ringPos, oSize);
+                    decodedSize += oSize;
+                    ringPos += oSize;
+                    cPos += iSize;
+                }
+                if (decodedSize != srcSize) goto _output_error;
+                if (memcmp(CNBuffer, decodedBuffer, srcSize)) goto _output_error;
+        }   }
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        free(ring);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_ctxPool : ");
+    {   int const nbAllocsStart = g_testAllocState.nbAllocs;
+        LZ4F_ctxPool* const pool = LZ4F_createCtxPool(lz4f_cmem_test, 1);
+        size_t const srcSize = 300 KB;
+        LZ4F_preferences_t pPrefs;
+        LZ4F_cctx* cctx1 = NULL;
+        LZ4F_dctx* dctx1 = NULL;
+        LZ4F_cctx* leftOut;
+        int n;
+        if (pool == NULL) goto _output_error;
+        memset(&pPrefs, 0, sizeof(pPrefs));
+        pPrefs.frameInfo.blockSizeID = LZ4F_max256KB;
+        pPrefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+        for (n = 0; n < 3; n++) {
+            LZ4F_cctx* const pcctx = LZ4F_ctxPool_getCCtx(pool, &pPrefs);
+            LZ4F_dctx* const pdctx = LZ4F_ctxPool_getDCtx(pool, LZ4F_max256KB);
+            size_t cSizePool = 0, decodedSize = COMPRESSIBLE_NOISE_LENGTH, iSize;
+            if (pcctx == NULL || pdctx == NULL) goto _output_error;
+            if (n == 0) { cctx1 = pcctx; dctx1 = pdctx; }
+            else if (pcctx != cctx1 || pdctx != dctx1) goto _output_error;   /* released contexts must be reused */
+            pPrefs.frameInfo.blockMode = (n & 1) ? LZ4F_blockIndependent : LZ4F_blockLinked;
+            {   size_t const r = LZ4F_compressBegin(pcctx, compressedBuffer, cBuffSize, &pPrefs);
+                CHECK(r); cSizePool += r; }
+            {   size_t const r = LZ4F_compressUpdate(pcctx, (char*)compressedBuffer + cSizePool, cBuffSize - cSizePool, CNBuffer, srcSize, NULL);
+                CHECK(r); cSizePool += r; }
+            {   size_t const r = LZ4F_compressEnd(pcctx, (char*)compressedBuffer + cSizePool, cBuffSize - cSizePool, NULL);
+                CHECK(r); cSizePool += r; }
+            iSize = cSizePool;
+            CHECK( LZ4F_decompress(pdctx, decodedBuffer, &decodedSize, compressedBuffer, &iSize, NULL) );
+            if (iSize != cSizePool || decodedSize != srcSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, srcSize)) goto _output_error;
+            if (n == 1) {   /* release in the middle of a frame : next user must start afresh */
+                size_t partial = cSizePool / 2;
+                decodedSize = COMPRESSIBLE_NOISE_LENGTH;
+                CHECK( LZ4F_decompress(pdctx, decodedBuffer, &decodedSize, compressedBuffer, &partial, NULL) );
+            }
+            LZ4F_ctxPool_releaseCCtx(pool, pcctx);
+            LZ4F_ctxPool_releaseDCtx(pool, pdctx);
+        }
+        /* HC family is served separately; pool is limited to 1 context per key */
+        pPrefs.compressionLevel = LZ4F_compressionLevel_max();
+        {   LZ4F_cctx* const hc1 = LZ4F_ctxPool_getCCtx(pool, &pPrefs);
+            LZ4F_cctx* const hc2 = LZ4F_ctxPool_getCCtx(pool, &pPrefs);
+            if (hc1 == NULL || hc2 == NULL || hc1 == cctx1 || hc1 == hc2) goto _output_error;
+            LZ4F_ctxPool_releaseCCtx(pool, hc1);
+            LZ4F_ctxPool_releaseCCtx(pool, hc2);
+        }
+        leftOut = LZ4F_ctxPool_getCCtx(pool, &pPrefs);   /* still in use when pool is freed */
+        if (leftOut == NULL) goto _output_error;
+        pPrefs.frameInfo.blockSizeID = (LZ4F_blockSizeID_t)3;
+        if (LZ4F_ctxPool_getCCtx(pool, &pPrefs) != NULL) goto _output_error;   /* invalid block size */
+        LZ4F_freeCtxPool(pool);
+        CHECK( LZ4F_freeCompressionContext(leftOut) );
+        if (g_testAllocState.nbAllocs != nbAllocsStart) goto _output_error;
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_Arena : ");
+    {   LZ4F_preferences_t aPrefs;
+        size_t const srcSize = 200 KB;
+        size_t arenaSize;
+        void* arenaBuffer;
+        LZ4F_Arena arena;
+        int n;
+        memset(&aPrefs, 0, sizeof(aPrefs));
+        aPrefs.frameInfo.blockSizeID = LZ4F_max256KB;
+        aPrefs.frameInfo.blockMode = LZ4F_blockLinked;
+        arenaSize = LZ4F_cctxArenaSize(&aPrefs) + LZ4F_dctxArenaSize(LZ4F_max256KB);
+        arenaBuffer = malloc(arenaSize);
+        if (arenaBuffer == NULL) goto _output_error;
+        LZ4F_initArena(&arena, arenaBuffer, arenaSize);
+        for (n = 0; n < 3; n++) {   /* per-request usage : everything allocated from the arena, then reset */
+            LZ4F_cctx* const acctx = LZ4F_createCompressionContext_advanced(LZ4F_arenaCustomMem(&arena), LZ4F_VERSION);
+            LZ4F_dctx* const adctx = LZ4F_createDecompressionContext_advanced(LZ4F_arenaCustomMem(&arena), LZ4F_VERSION);
+            size_t cSizeArena = 0, decodedSize = COMPRESSIBLE_NOISE_LENGTH, iSize;
+            if (acctx == NULL || adctx == NULL) goto _output_error;
+            {   size_t const r = LZ4F_compressBegin(acctx, compressedBuffer, cBuffSize, &aPrefs);
+                CHECK(r); cSizeArena += r; }
+            {   size_t const r = LZ4F_compressUpdate(acctx, (char*)compressedBuffer + cSizeArena, cBuffSize - cSizeArena, CNBuffer, srcSize, NULL);
+                CHECK(r); cSizeArena += r; }
+            {   size_t const r = LZ4F_compressEnd(acctx, (char*)compressedBuffer + cSizeArena, cBuffSize - cSizeArena, NULL);
+                CHECK(r); cSizeArena += r; }
+            iSize = cSizeArena;
+            CHECK( LZ4F_decompress(adctx, decodedBuffer, &decodedSize, compressedBuffer, &iSize, NULL) );
+            if (iSize != cSizeArena || decodedSize != srcSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, srcSize)) goto _output_error;
+            if (arena.used > arenaSize) goto _output_error;
+            CHECK( LZ4F_freeCompressionContext(acctx) );     /* no-op */
+            CHECK( LZ4F_freeDecompressionContext(adctx) );   /* no-op */
+            LZ4F_resetArena(&arena);
+        }
+        /* exhausted arena : allocation failure is reported as an error */
+        LZ4F_initArena(&arena, arenaBuffer, LZ4F_cctxArenaSize(&aPrefs) / 2);
+        {   LZ4F_cctx* const acctx = LZ4F_createCompressionContext_advanced(LZ4F_arenaCustomMem(&arena), LZ4F_VERSION);
+            size_t r;
+            if (acctx == NULL) goto _output_error;
+            r = LZ4F_compressBegin(acctx, compressedBuffer, cBuffSize, &aPrefs);
+            if (LZ4F_getErrorCode(r) != LZ4F_ERROR_allocation_failed) goto _output_error;
+        }
+        free(arenaBuffer);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_compressBegin_continue / LZ4F_decompress_continue : ");
+    {   size_t const nbMessages = 400;
+        size_t pos = 0, totalContinue = 0, totalCold = 0, m;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockMode = LZ4F_blockLinked;
+        prefs.frameInfo.dictID = 1;   /* by agreement : "previous frames" */
+        for (m = 0; m < nbMessages; m++) {
+            size_t const msgSize = 200 + (FUZ_rand(randState) % 800);
+            size_t fSize, r, iSize, oSize, dSize = 0;
+            /* level family changes : history is then dropped by compressor, but kept by decoder */
+            prefs.compressionLevel = (m >= 150 && m < 250) ? 9 : 1;
+            prefs.autoFlush = (m & 1);
+            prefs.frameInfo.contentChecksumFlag = (m % 3) ? LZ4F_contentChecksumEnabled : LZ4F_noContentChecksum;
+            CHECK_V(fSize, LZ4F_compressBegin_continue(cctx, compressedBuffer, cBuffSize, &prefs));
+            CHECK_V(r, LZ4F_compressUpdate(cctx, (char*)compressedBuffer + fSize, cBuffSize - fSize, (const char*)CNBuffer + pos, msgSize, NULL));
+            fSize += r;
+            CHECK_V(r, LZ4F_compressEnd(cctx, (char*)compressedBuffer + fSize, cBuffSize - fSize, NULL));
+            fSize += r;
+            totalContinue += fSize;
+            CHECK_V(r, LZ4F_compressFrame(decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, (const char*)CNBuffer + pos, msgSize, &prefs));
+            totalCold += r;
+
+            /* decode into a reused output buffer, in 2 steps : history is kept within dctx */
+            iSize = 5; oSize = 100;
+            CHECK( LZ4F_decompress_continue(dCtx, decodedBuffer, &oSize, compressedBuffer, &iSize, NULL) );
+            dSize += oSize;
+            {   size_t iSize2 = fSize - iSize, oSize2 = COMPRESSIBLE_NOISE_LENGTH - dSize;
+                CHECK_V(r, LZ4F_decompress_continue(dCtx, (char*)decodedBuffer + dSize, &oSize2, (const char*)compressedBuffer + iSize, &iSize2, NULL));
+                if (r != 0 || iSize + iSize2 != fSize) goto _output_error;
+                dSize += oSize2;
+            }
+            if (dSize != msgSize || memcmp(decodedBuffer, (const char*)CNBuffer + pos, msgSize)) goto _output_error;
+            pos += msgSize;
+        }
+        DISPLAYLEVEL(3, "%u bytes instead of %u : ", (unsigned)totalContinue, (unsigned)totalCold);
+        if (totalContinue >= totalCold) goto _output_error;
+        /* frames with independent blocks can't continue */
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        if (LZ4F_getErrorCode(LZ4F_compressBegin_continue(cctx, compressedBuffer, cBuffSize, &prefs)) != LZ4F_ERROR_blockMode_invalid) goto _output_error;
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_compressUpdatev / LZ4F_decompressv : ");
+    {   size_t const srcSize = 1 MB;
+        size_t const scratchSize = 2 * srcSize + 64 * 64;   /* fragments are separated by gaps */
+        char* const scratch = (char*)malloc(scratchSize);
+        char* const refBuffer = (char*)malloc(cBuffSize);
+        LZ4F_iovec iov[64];
+        int config;
+        if (scratch == NULL || refBuffer == NULL) goto _output_error;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        for (config = 0; config < 16; config++) {
+            LZ4F_compressOptions_t cOpt;
+            size_t pos = 0, vSize, refSize = 0, dPos = 0, cPos = 0;
+            memset(&prefs, 0, sizeof(prefs));
+            memset(&cOpt, 0, sizeof(cOpt));
+            prefs.frameInfo.blockMode = (config & 1) ? LZ4F_blockLinked : LZ4F_blockIndependent;
+            prefs.autoFlush = (config >> 1) & 1;
+            prefs.compressionLevel = (config & 4) ? 9 : 0;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            cOpt.stableSrc = (config >> 3) & 1;
+            vSize = LZ4F_compressBegin(cctx, compressedBuffer, cBuffSize, &prefs);
+            CHECK(vSize);
+            while (pos < srcSize) {
+                /* one call : a few fragments, mostly 4 KB pages, sometimes larger than a block */
+                int const nbFrags = (int)(FUZ_rand(randState) % 64) + 1;
+                char* fragPtr = scratch;
+                int n;
+                for (n = 0; n < nbFrags && pos < srcSize; n++) {
+                    size_t fragSize = (FUZ_rand(randState) & 7) ? 4 KB : (FUZ_rand(randState) % (200 KB));
+                    if (fragSize > srcSize - pos) fragSize = srcSize - pos;
+                    if (cOpt.stableSrc) fragPtr = scratch + 2 * pos;   /* history must remain valid across calls */
+                    if ((size_t)(fragPtr - scratch) + fragSize + 64 > scratchSize) break;
+                    memcpy(fragPtr, (const char*)CNBuffer + pos, fragSize);
+                    iov[n].iov_base = fragPtr;
+                    iov[n].iov_len = fragSize;
+                    fragPtr += fragSize + 64;
+                    pos += fragSize;
+                }
+                {   size_t const r = LZ4F_compressUpdatev(cctx, (char*)compressedBuffer + vSize, cBuffSize - vSize, iov, n, &cOpt);
+                    CHECK(r); vSize += r; }
+                if (!cOpt.stableSrc) memset(scratch, 0x5A, scratchSize);   /* fragments are not preserved */
+            }
+            {   size_t const r = LZ4F_compressEnd(cctx, (char*)compressedBuffer + vSize, cBuffSize - vSize, NULL);
+                CHECK(r); vSize += r; }
+
+            if (prefs.frameInfo.blockMode == LZ4F_blockIndependent && !prefs.autoFlush) {
+                /* same blocks as a single LZ4F_compressUpdate() */
+                size_t r = LZ4F_compressBegin(cctx, refBuffer, cBuffSize, &prefs);
+                CHECK(r); refSize = r;
+                r = LZ4F_compressUpdate(cctx, refBuffer + refSize, cBuffSize - refSize, CNBuffer, srcSize, NULL);
+                CHECK(r); refSize += r;
+                r = LZ4F_compressEnd(cctx, refBuffer + refSize, cBuffSize - refSize, NULL);
+                CHECK(r); refSize += r;
+                if (refSize != vSize || memcmp(refBuffer, compressedBuffer, vSize)) goto _output_error;
+            }
+
+            /* scatter decoded data across small, uneven fragments */
+            memset(decodedBuffer, 0, srcSize);
+            while (cPos < vSize) {
+                size_t iSize = vSize - cPos, oSize;
+                int n;
+                size_t fPos = dPos;
+                for (n = 0; n < 16; n++) {
+                    size_t fragSize = FUZ_rand(randState) % (10 KB);
+                    if (fragSize > srcSize - fPos) fragSize = srcSize - fPos;
+                    iov[n].iov_base = (char*)decodedBuffer + fPos;
+                    iov[n].iov_len = fragSize;
+                    fPos += fragSize;
+                }
+                if (iSize > 7 KB) iSize = 7 KB;
+                {   size_t const r = LZ4F_decompressv(dCtx, iov, 16, &oSize, (const char*)compressedBuffer + cPos, &iSize, NULL);
+                    CHECK(r);
+                    cPos += iSize;
+                    dPos += oSize;
+                    if (r == 0) break;
+            }   }
+            if (cPos != vSize || dPos != srcSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, srcSize)) goto _output_error;
+        }
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        free(scratch);
+        free(refBuffer);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_compressUpdate_destSize : ");
+    {   size_t const srcSize = 600 KB;
+        int config;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        for (config = 0; config < 16; config++) {
+            size_t const crcSize = (config & 4) ? 4 : 0;
+            size_t pos = 0, cPos;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockMode = (config & 1) ? LZ4F_blockLinked : LZ4F_blockIndependent;
+            prefs.compressionLevel = (config & 2) ? 9 : -1;
+            prefs.frameInfo.blockChecksumFlag = (config & 4) ? LZ4F_blockChecksumEnabled : LZ4F_noBlockChecksum;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            prefs.frameInfo.blockSizeID = (config & 8) ? LZ4F_max256KB : LZ4F_max64KB;
+
+            /* a single frame fits into a 4 KB page */
+            {   size_t const hSize = LZ4F_compressBegin(cctx, compressedBuffer, cBuffSize, &prefs);
+                size_t consumed = srcSize;
+                size_t r;
+                CHECK(hSize);
+                r = LZ4F_compressUpdate_destSize(cctx, (char*)compressedBuffer + hSize, 4 KB - hSize - 8, CNBuffer, &consumed, NULL);
+                CHECK(r);
+                if (r > 4 KB - hSize - 8 || r < 4 KB - hSize - 8 - 4 - crcSize) goto _output_error;
+                cSize = hSize + r;
+                r = LZ4F_compressEnd(cctx, (char*)compressedBuffer + cSize, cBuffSize - cSize, NULL);
+                CHECK(r); cSize += r;
+                if (cSize > 4 KB) goto _output_error;
+                {   size_t dSize = srcSize, iSize = cSize;
+                    CHECK( LZ4F_decompress(dCtx, decodedBuffer, &dSize, compressedBuffer, &iSize, NULL) );
+                    if (iSize != cSize || dSize != consumed) goto _output_error;
+                    if (memcmp(decodedBuffer, CNBuffer, consumed)) goto _output_error;
+            }   }
+
+            /* successive budgets within a single frame : history is preserved across cut blocks */
+            cPos = LZ4F_compressBegin(cctx, compressedBuffer, cBuffSize, &prefs);
+            CHECK(cPos);
+            while (pos < srcSize) {
+                U32 const sel = FUZ_rand(randState) % 3;
+                size_t const budget = (sel == 0) ? 4 KB : (sel == 1) ? 9000 : 150 KB;
+                size_t consumed = srcSize - pos;
+                size_t const r = LZ4F_compressUpdate_destSize(cctx, (char*)compressedBuffer + cPos, budget, (const char*)CNBuffer + pos, &consumed, NULL);
+                CHECK(r);
+                if (r > budget) goto _output_error;
+                if (pos + consumed < srcSize && r < budget - 4 - crcSize) goto _output_error;
+                cPos += r;
+                pos += consumed;
+            }
+            {   size_t const r = LZ4F_compressEnd(cctx, (char*)compressedBuffer + cPos, cBuffSize - cPos, NULL);
+                CHECK(r); cPos += r; }
+            {   size_t dSize = srcSize, iSize = cPos;
+                memset(decodedBuffer, 0, srcSize);
+                CHECK( LZ4F_decompress(dCtx, decodedBuffer, &dSize, compressedBuffer, &iSize, NULL) );
+                if (iSize != cPos || dSize != srcSize) goto _output_error;
+                if (memcmp(decodedBuffer, CNBuffer, srcSize)) goto _output_error;
+        }   }
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "Compression statistics : ");
+    {   size_t const frameSrcSize = 512 KB;
+        size_t const noiseSize = 64 KB;
+        LZ4F_compressionStats stats;
+        size_t totalSize = 0, n;
+        int level;
+        unsigned long long litSum = 0, mlSum = 0, offSum = 0;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        if (!LZ4F_isError(LZ4F_getCompressionStats(cctx, &stats))) goto _output_error;   /* not enabled */
+        CHECK( LZ4F_enableCompressionStats(cctx, 1) );
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        for (level = 0; level <= 9; level += 9) {   /* fast and HC */
+            prefs.compressionLevel = level;
+            {   size_t const r = LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, cBuffSize, CNBuffer, frameSrcSize, NULL, &prefs);
+                CHECK(r); totalSize += r - (7 + 4);   /* frame header and end mark */
+        }   }
+        /* incompressible data is stored in uncompressed blocks */
+        for (n = 0; n < noiseSize; n++) ((BYTE*)decodedBuffer)[n] = (BYTE)FUZ_rand(randState);
+        {   size_t const r = LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, cBuffSize, decodedBuffer, noiseSize, NULL, &prefs);
+            CHECK(r); totalSize += r - (7 + 4); }
+        CHECK( LZ4F_getCompressionStats(cctx, &stats) );
+        if (stats.nbBlocks != 2 * (frameSrcSize / (64 KB)) + 1) goto _output_error;
+        if (stats.nbUncompressedBlocks != 1) goto _output_error;
+        if (stats.srcSize != 2 * frameSrcSize + noiseSize) goto _output_error;
+        if (stats.blocksSize != totalSize) goto _output_error;
+        if (stats.literalsSize + stats.matchesSize != 2 * frameSrcSize) goto _output_error;
+        for (n = 0; n < LZ4F_STATS_NBBUCKETS; n++) {
+            litSum += stats.litLengths[n];
+            mlSum += stats.matchLengths[n];
+            offSum += stats.offsets[n];
+        }
+        /* each compressed block ends with literals */
+        if (litSum != stats.nbSequences + stats.nbBlocks - stats.nbUncompressedBlocks) goto _output_error;
+        if (mlSum != stats.nbSequences || offSum != stats.nbSequences) goto _output_error;
+        if (stats.offsets[0] != 0 || stats.matchLengths[0] || stats.matchLengths[1] || stats.matchLengths[2]) goto _output_error;   /* offset >= 1, match >= 4 */
+        CHECK( LZ4F_enableCompressionStats(cctx, 0) );
+        if (!LZ4F_isError(LZ4F_getCompressionStats(cctx, &stats))) goto _output_error;
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_appendBlock : ");
+    {   size_t const srcSize = 4 * (64 KB) + 1000;
+        size_t const mergedCapacity = 2 * LZ4F_compressFrameBound(srcSize, NULL);
+        char* const merged = (char*)malloc(mergedCapacity);
+        size_t mergedSize, n;
+        if (merged == NULL) goto _output_error;
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, cBuffSize, CNBuffer, srcSize, &prefs));
+        /* copy blocks of this frame twice, into a frame with checksums */
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+        prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+        prefs.frameInfo.contentSize = 2 * srcSize;
+        CHECK_V(mergedSize, LZ4F_compressBegin(cctx, merged, mergedCapacity, &prefs));
+        for (n = 0; n < 2; n++) {
+            size_t cPos = 7;   /* frame header */
+            const BYTE* decoded = (const BYTE*)CNBuffer;
+            for (;;) {
+                U32 const blockHeader = FUZ_readLE32((const BYTE*)compressedBuffer + cPos);
+                size_t const blockSize = 4 + (blockHeader & 0x7FFFFFFF);
+                size_t const decodedSize = MIN(64 KB, srcSize - (size_t)(decoded - (const BYTE*)CNBuffer));
+                if (blockHeader == 0) break;
+                {   size_t const r = LZ4F_appendBlock(cctx, merged + mergedSize, mergedCapacity - mergedSize,
+                                                      (const BYTE*)compressedBuffer + cPos, blockSize, decoded, decodedSize);
+                    CHECK(r);
+                    if (r != blockSize + 4) goto _output_error;   /* block checksum added */
+                    mergedSize += r;
+                }
+                cPos += blockSize;
+                decoded += decodedSize;
+        }   }
+        CHECK_V(n, LZ4F_compressEnd(cctx, merged + mergedSize, mergedCapacity - mergedSize, NULL));
+        mergedSize += n;
+        {   size_t const dSize = LZ4F_decompressFrame(decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, merged, mergedSize, NULL, 0);
+            CHECK(dSize);
+            if (dSize != 2 * srcSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, srcSize)) goto _output_error;
+            if (memcmp((char*)decodedBuffer + srcSize, CNBuffer, srcSize)) goto _output_error;
+        }
+        /* linked blocks can't accept external blocks */
+        prefs.frameInfo.blockMode = LZ4F_blockLinked;
+        prefs.frameInfo.contentSize = 0;
+        CHECK_V(mergedSize, LZ4F_compressBegin(cctx, merged, mergedCapacity, &prefs));
+        if (!LZ4F_isError(LZ4F_appendBlock(cctx, merged + mergedSize, mergedCapacity - mergedSize,
+                                           (const BYTE*)compressedBuffer + 7, 4 + (FUZ_readLE32((const BYTE*)compressedBuffer + 7) & 0x7FFFFFFF),
+                                           CNBuffer, 64 KB)))
+            goto _output_error;
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        free(merged);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_compressBegin_append : ");
+    {   size_t const size1 = 3 * (64 KB) + 777;
+        size_t const size2 = 2 * (64 KB) + 12345;
+        size_t const size3 = 1000;
+        size_t endMark, r;
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+        prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+        CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, cBuffSize, CNBuffer, size1, &prefs));
+        /* continue this frame twice : new blocks overwrite EndMark and content checksum */
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        for (r = 0; r < 2; r++) {
+            size_t const priorSize = r ? size1 + size2 : size1;
+            size_t const newSize = r ? size3 : size2;
+            size_t n;
+            endMark = cSize - 8;
+            prefs.compressionLevel = r ? 9 : 1;
+            CHECK( LZ4F_compressBegin_append(cctx, &prefs) );
+            CHECK( LZ4F_appendPriorContent(cctx, CNBuffer, 1000) );   /* in pieces */
+            CHECK( LZ4F_appendPriorContent(cctx, (const char*)CNBuffer + 1000, priorSize - 1000) );
+            CHECK_V(n, LZ4F_compressUpdate(cctx, (char*)compressedBuffer + endMark, cBuffSize - endMark,
+                                           (const char*)CNBuffer + priorSize, newSize, NULL));
+            cSize = endMark + n;
+            CHECK_V(n, LZ4F_compressEnd(cctx, (char*)compressedBuffer + cSize, cBuffSize - cSize, NULL));
+            cSize += n;
+        }
+        {   size_t const dSize = LZ4F_decompressFrame(decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, compressedBuffer, cSize, NULL, 0);
+            CHECK(dSize);
+            if (dSize != size1 + size2 + size3) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, dSize)) goto _output_error;
+        }
+        /* prior content must come first */
+        CHECK( LZ4F_compressBegin_append(cctx, &prefs) );
+        CHECK_V(r, LZ4F_compressUpdate(cctx, compressedBuffer, cBuffSize, CNBuffer, 100, NULL));
+        if (!LZ4F_isError(LZ4F_appendPriorContent(cctx, CNBuffer, 100))) goto _output_error;
+        /* including when new input was compressed whole from source, leaving nothing buffered */
+        CHECK( LZ4F_compressBegin_append(cctx, &prefs) );
+        CHECK_V(r, LZ4F_compressUpdate(cctx, compressedBuffer, cBuffSize, CNBuffer, 64 KB, NULL));
+        if (r == 0) goto _output_error;   /* block must have been compressed, not buffered */
+        if (!LZ4F_isError(LZ4F_appendPriorContent(cctx, CNBuffer, 100))) goto _output_error;
+        /* only frames with independent blocks, without content size nor dictID, can be continued */
+        prefs.frameInfo.blockMode = LZ4F_blockLinked;
+        if (!LZ4F_isError(LZ4F_compressBegin_append(cctx, &prefs))) goto _output_error;
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        prefs.frameInfo.contentSize = size1;
+        if (!LZ4F_isError(LZ4F_compressBegin_append(cctx, &prefs))) goto _output_error;
+        prefs.frameInfo.contentSize = 0;
+        prefs.frameInfo.dictID = 1;
+        if (!LZ4F_isError(LZ4F_compressBegin_append(cctx, &prefs))) goto _output_error;
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_compressFrame_MT : \n");
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+    prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    prefs.frameInfo.contentSize = 1;   /* auto-corrected */
+    {   size_t const mtBufferSize = 9 MB;
+        size_t const mtCapacity = LZ4F_compressFrameBound(mtBufferSize, &prefs);
+        void* const mtSrc = malloc(mtBufferSize);
+        void* const mtDst = malloc(mtCapacity);
+        void* const mtDecoded = malloc(mtBufferSize);
+        DeferredJobs dj;
+        LZ4F_Executor executor;
+        size_t mtCSize;
+        int level;
+        if (!mtSrc || !mtDst || !mtDecoded) goto _output_error;
+        FUZ_fillCompressibleNoiseBuffer(mtSrc, mtBufferSize, compressibility, randState);
+        executor.submitJob = deferred_submitJob;
+        executor.completeJobs = deferred_completeJobs;
+        executor.opaqueState = &dj;
+        dj.nbJobs = 0;
+        for (level = -1; level <= 3; level += 4) {
+            int useExecutor;
+            prefs.compressionLevel = level;
+            for (useExecutor = 0; useExecutor < 2; useExecutor++) {
+                DISPLAYLEVEL(3, "level %i, %s executor : ", level, useExecutor ? "deferred" : "no");
+                CHECK_V(mtCSize, LZ4F_compressFrame_MT(mtDst, mtCapacity, mtSrc, mtBufferSize, &prefs, useExecutor ? &executor : NULL));
+                {   size_t iSize = mtCSize;
+                    size_t oSize = mtBufferSize;
+                    LZ4F_dctx* dctx;
+                    CHECK( LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION) );
+                    CHECK( LZ4F_decompress(dctx, mtDecoded, &oSize, mtDst, &iSize, NULL) );
+                    CHECK( LZ4F_freeDecompressionContext(dctx) );
+                    if (oSize != mtBufferSize || iSize != mtCSize) goto _output_error;
+                    if (memcmp(mtSrc, mtDecoded, mtBufferSize)) goto _output_error;
+                }
+                DISPLAYLEVEL(3, "Compressed %u bytes into a %u bytes frame \n", (U32)mtBufferSize, (U32)mtCSize);
+        }   }
+        DISPLAYLEVEL(3, "LZ4F_compressFrame_MT, dst too small : ");
+        {   size_t const err = LZ4F_compressFrame_MT(mtDst, mtCapacity-1, mtSrc, mtBufferSize, &prefs, &executor);
+            if (!LZ4F_isError(err)) goto _output_error;
+            DISPLAYLEVEL(3, "correctly failed : %s \n", LZ4F_getErrorName(err));
+        }
+        DISPLAYLEVEL(3, "LZ4F_compressFrame_MT_advanced, arena : ");
+        {   size_t const arenaSize = 2 MB;
+            void* const arenaBuffer = malloc(arenaSize);
+            LZ4F_Arena arena;
+            size_t refCSize;
+            if (arenaBuffer == NULL) goto _output_error;
+            prefs.compressionLevel = 9;
+            CHECK_V(refCSize, LZ4F_compressFrame_MT(mtDst, mtCapacity, mtSrc, mtBufferSize, &prefs, &executor));
+            memcpy(mtDecoded, mtDst, refCSize);
+            LZ4F_initArena(&arena, arenaBuffer, arenaSize);
+            CHECK_V(mtCSize, LZ4F_compressFrame_MT_advanced(LZ4F_arenaCustomMem(&arena), mtDst, mtCapacity, mtSrc, mtBufferSize, &prefs, &executor));
+            if (mtCSize != refCSize || memcmp(mtDst, mtDecoded, refCSize)) goto _output_error;
+            if (arena.used == 0 || arena.used > arenaSize) goto _output_error;
+            DISPLAYLEVEL(3, "%u bytes allocated from arena; ", (unsigned)arena.used);
+            LZ4F_initArena(&arena, arenaBuffer, arena.used - 1);
+            {   size_t const err = LZ4F_compressFrame_MT_advanced(LZ4F_arenaCustomMem(&arena), mtDst, mtCapacity, mtSrc, mtBufferSize, &prefs, &executor);
+                if (!LZ4F_isError(err)) goto _output_error;
+                DISPLAYLEVEL(3, "smaller arena correctly failed : %s \n", LZ4F_getErrorName(err));
+            }
+            free(arenaBuffer);
+        }
+        free(mtSrc);
+        free(mtDst);
+        free(mtDecoded);
+    }
+
+    DISPLAYLEVEL(3, "fast mode with runtime table size : ");
+    {   static const unsigned memUsages[] = { 10, 20, 12, 0, 16, 16, 0 };
+        static const int levels[] = { 1, 1, -3, 1, 9, 1, 1 };
+        size_t const srcSize = COMPRESSIBLE_NOISE_LENGTH;
+        size_t n;
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.memoryUsage = 9;
+        if (!LZ4F_isError(LZ4F_compressFrame(compressedBuffer, LZ4F_compressFrameBound(srcSize, &prefs), CNBuffer, srcSize, &prefs)))
+            goto _output_error;   /* invalid memoryUsage must be rejected */
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        for (n = 0; n < sizeof(memUsages)/sizeof(memUsages[0]); n++) {
+            size_t const dstCapacity = LZ4F_compressFrameBound(srcSize, &prefs);
+            size_t iSize, oSize = srcSize;
+            prefs.memoryUsage = memUsages[n];
+            prefs.compressionLevel = levels[n];
+            prefs.frameInfo.blockMode = (n & 1) ? LZ4F_blockIndependent : LZ4F_blockLinked;
+            if (n & 2) {
+                CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, dstCapacity, CNBuffer, srcSize, &prefs));
+            } else {
+                /* reused context, switching table size */
+                CHECK_V(cSize, LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, dstCapacity, CNBuffer, srcSize, NULL, &prefs));
+            }
+            iSize = cSize;
+            CHECK( LZ4F_decompress(dCtx, decodedBuffer, &oSize, compressedBuffer, &iSize, NULL) );
+            if (oSize != srcSize || iSize != cSize) goto _output_error;
+            if (memcmp(CNBuffer, decodedBuffer, srcSize)) goto _output_error;
+        }
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "change compression level within a frame : ");
+    {   static const int levels[] = { 1, 9, -2, 3, 12, 2, 1 };
+        size_t const srcSize = COMPRESSIBLE_NOISE_LENGTH;
+        unsigned variant;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        for (variant = 0; variant < 16; variant++) {
+            /* unaligned updates leave input buffered when level changes */
+            size_t const updateSize = (variant & 4) ? 64 KB : 64 KB - 77;
+            const char* ip = (const char*)CNBuffer;
+            const char* const iend = ip + srcSize;
+            BYTE* op = (BYTE*)compressedBuffer;
+            BYTE* const oend = op + cBuffSize;
+            LZ4F_compressOptions_t cOpt;
+            size_t n = 0;
+            memset(&prefs, 0, sizeof(prefs));
+            memset(&cOpt, 0, sizeof(cOpt));
+            prefs.frameInfo.blockMode = (variant & 1) ? LZ4F_blockIndependent : LZ4F_blockLinked;
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            prefs.autoFlush = (variant >> 3) & 1;
+            prefs.memoryUsage = (variant & 2) ? 12 : 0;
+            prefs.compressionLevel = (variant & 2) ? 9 : 1;
+            cOpt.stableSrc = (variant >> 1) & 1;
+            CHECK_V(cSize, LZ4F_compressBegin(cctx, op, (size_t)(oend-op), &prefs));
+            op += cSize;
+            while (ip < iend) {
+                size_t const iSize = MIN(updateSize, (size_t)(iend-ip));
+                CHECK( LZ4F_setCompressionLevel(cctx, levels[n++ % (sizeof(levels)/sizeof(levels[0]))]) );
+                CHECK_V(cSize, LZ4F_compressUpdate(cctx, op, (size_t)(oend-op), ip, iSize, &cOpt));
+                op += cSize;
+                ip += iSize;
+            }
+            CHECK_V(cSize, LZ4F_compressEnd(cctx, op, (size_t)(oend-op), &cOpt));
+            op += cSize;
+            {   size_t iSize = (size_t)(op - (BYTE*)compressedBuffer), oSize = srcSize;
+                CHECK( LZ4F_decompress(dCtx, decodedBuffer, &oSize, compressedBuffer, &iSize, NULL) );
+                if (oSize != srcSize) goto _output_error;
+                if (memcmp(CNBuffer, decodedBuffer, srcSize)) goto _output_error;
+        }   }
+        if (!LZ4F_isError(LZ4F_setCompressionLevel(cctx, 9)))
+            goto _output_error;   /* no ongoing frame */
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "skip incompressible blocks : ");
+    {   size_t const blockSize = 64 KB;
+        size_t const srcSize = 8 * blockSize;
+        char* const mixed = (char*)malloc(srcSize);
+        size_t const dstCapacity = LZ4F_compressFrameBound(srcSize, NULL);
+        size_t refSize, n;
+        if (mixed == NULL) goto _output_error;
+        /* alternate compressible and random blocks */
+        for (n = 0; n < srcSize; n += blockSize) {
+            if ((n / blockSize) & 1) {
+                size_t i;
+                for (i = 0; i < blockSize; i++) mixed[n+i] = (char)(FUZ_rand(randState) >> 5);
+            } else {
+                memcpy(mixed + n, (const char*)CNBuffer + n, blockSize);
+        }   }
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        prefs.compressionLevel = 9;
+        CHECK_V(refSize, LZ4F_compressFrame(compressedBuffer, dstCapacity, mixed, srcSize, &prefs));
+        prefs.skipIncompressible = 1;
+        CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, dstCapacity, mixed, srcSize, &prefs));
+        /* compressible blocks must still be compressed */
+        if (cSize > refSize + refSize / 100) goto _output_error;
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        {   size_t iSize = cSize, oSize = srcSize;
+            CHECK( LZ4F_decompress(dCtx, decodedBuffer, &oSize, compressedBuffer, &iSize, NULL) );
+            if (oSize != srcSize || iSize != cSize) goto _output_error;
+            if (memcmp(mixed, decodedBuffer, srcSize)) goto _output_error;
+        }
+        /* ignored for linked blocks : output is identical */
+        prefs.frameInfo.blockMode = LZ4F_blockLinked;
+        prefs.skipIncompressible = 0;
+        CHECK_V(refSize, LZ4F_compressFrame(compressedBuffer, dstCapacity, mixed, srcSize, &prefs));
+        prefs.skipIncompressible = 1;
+        CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, dstCapacity, mixed, srcSize, &prefs));
+        if (cSize != refSize) goto _output_error;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        free(mixed);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "block codec offload : ");
+    {   TestCodec tc;
+        LZ4F_BlockCodec codec;
+        size_t const srcSize = 1 MB + 77;
+        int blockMode;
+        codec.compressBlock = testCodec_compressBlock;
+        codec.decompressBlock = testCodec_decompressBlock;
+        codec.opaqueState = &tc;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        LZ4F_setCompressionCodec(cctx, &codec);
+        LZ4F_setDecompressionCodec(dCtx, &codec);
+        for (blockMode = 0; blockMode < 2; blockMode++) {
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.blockMode = blockMode ? LZ4F_blockIndependent : LZ4F_blockLinked;
+            prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            tc.nbCalls = tc.nbProcessed = 0;
+            CHECK_V(cSize, LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, cBuffSize, CNBuffer, srcSize, NULL, &prefs));
+            /* codec only used for independent blocks */
+            if ((tc.nbProcessed > 0) != (blockMode == 1)) goto _output_error;
+            tc.nbCalls = tc.nbProcessed = 0;
+            {   size_t iSize = cSize, oSize = srcSize;
+                CHECK( LZ4F_decompress(dCtx, decodedBuffer, &oSize, compressedBuffer, &iSize, NULL) );
+                if (oSize != srcSize || iSize != cSize) goto _output_error;
+                if (memcmp(CNBuffer, decodedBuffer, srcSize)) goto _output_error;
+            }
+            /* only the first linked block has no history */
+            if (blockMode ? (tc.nbProcessed == 0) : (tc.nbProcessed > 1)) goto _output_error;
+        }
+        /* corrupted block : still detected by checksum */
+        ((BYTE*)compressedBuffer)[cSize / 2] ^= 0x40;
+        {   size_t iSize = cSize, oSize = srcSize;
+            size_t const err = LZ4F_decompress(dCtx, decodedBuffer, &oSize, compressedBuffer, &iSize, NULL);
+            if (!LZ4F_isError(err)) goto _output_error;
+            LZ4F_resetDecompressionContext(dCtx);
+        }
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_compressUpdate_budget : ");
+    {   size_t const srcSize = 1 MB + 77;
+        size_t const bCapacity = LZ4F_compressFrameBound(srcSize, NULL) + (64 KB);
+        BYTE* const bBuffer = (BYTE*)malloc(bCapacity);
+        static const int levels[] = { 1, 3, 9, 10, 12 };
+        int n;
+        if (bBuffer == NULL) goto _output_error;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+        for (n = 0; n < (int)(sizeof(levels)/sizeof(levels[0])) * 4; n++) {
+            BYTE* op = bBuffer;
+            BYTE* const oend = bBuffer + bCapacity;
+            size_t pos = 0, r;
+            int suspended = 0;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.compressionLevel = levels[n / 4];
+            prefs.frameInfo.blockSizeID = LZ4F_max256KB;
+            prefs.frameInfo.blockMode = (n & 1) ? LZ4F_blockIndependent : LZ4F_blockLinked;
+            prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            prefs.autoFlush = (n >> 1) & 1;
+            CHECK_V(cSize, LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, cBuffSize, CNBuffer, srcSize, NULL, &prefs));
+            CHECK_V(r, LZ4F_compressBegin(cctx, op, (size_t)(oend-op), &prefs)); op += r;
+            while (pos < srcSize) {
+                size_t const randChunk = (FUZ_rand(randState) % (100 KB)) + 1;
+                size_t consumed = MIN(randChunk, srcSize - pos);
+                size_t const budget = (FUZ_rand(randState) % (20 KB)) + 1;
+                CHECK_V(r, LZ4F_compressUpdate_budget(cctx, op, (size_t)(oend-op), (const BYTE*)CNBuffer + pos, &consumed, budget, NULL)); op += r;
+                suspended |= LZ4F_compressPending(cctx);
+                pos += consumed;
+            }
+            CHECK_V(r, LZ4F_compressEnd(cctx, op, (size_t)(oend-op), NULL)); op += r;
+            if (LZ4F_compressPending(cctx)) goto _output_error;
+            if (!suspended && prefs.compressionLevel >= 3) goto _output_error;
+            /* same block boundaries : levels up to 9 produce the same frame */
+            if (!prefs.autoFlush && prefs.compressionLevel >= 3 && prefs.compressionLevel <= 9) {
+                if ((size_t)(op - bBuffer) != cSize) goto _output_error;
+                if (memcmp(bBuffer, compressedBuffer, cSize)) goto _output_error;
+            }
+            {   size_t iSize = (size_t)(op - bBuffer), oSize = srcSize;
+                CHECK( LZ4F_decompress(dCtx, decodedBuffer, &oSize, bBuffer, &iSize, NULL) );
+                if (oSize != srcSize || iSize != (size_t)(op - bBuffer)) goto _output_error;
+                if (memcmp(CNBuffer, decodedBuffer, srcSize)) goto _output_error;
+            }
+        }
+        /* block in progress is completed by LZ4F_compressUpdate() */
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.compressionLevel = 9;
+        prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+        prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+        {   BYTE* op = bBuffer;
+            BYTE* const oend = bBuffer + bCapacity;
+            size_t consumed = 200 KB, r;
+            CHECK_V(r, LZ4F_compressBegin(cctx, op, (size_t)(oend-op), &prefs)); op += r;
+            CHECK_V(r, LZ4F_compressUpdate_budget(cctx, op, (size_t)(oend-op), CNBuffer, &consumed, 70 KB, NULL)); op += r;
+            if (consumed != 128 KB) goto _output_error;   /* 2nd block in progress */
+            if (!LZ4F_compressPending(cctx)) goto _output_error;
+            if (!LZ4F_isError(LZ4F_setCompressionLevel(cctx, 3))) goto _output_error;
+            CHECK_V(r, LZ4F_compressUpdate(cctx, op, (size_t)(oend-op), (const BYTE*)CNBuffer + consumed, srcSize - consumed, NULL)); op += r;
+            CHECK_V(r, LZ4F_compressEnd(cctx, op, (size_t)(oend-op), NULL)); op += r;
+            CHECK_V(cSize, LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, cBuffSize, CNBuffer, srcSize, NULL, &prefs));
+            if ((size_t)(op - bBuffer) != cSize) goto _output_error;
+            if (memcmp(bBuffer, compressedBuffer, cSize)) goto _output_error;
+        }
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        free(bBuffer);
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "Seekable frame : ");
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+    prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+    prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    {   size_t const seekCapacity = LZ4F_compressBound(COMPRESSIBLE_NOISE_LENGTH, &prefs) + (64 KB);
+        BYTE* const seekBuffer = (BYTE*)malloc(seekCapacity);
+        BYTE* op = seekBuffer;
+        BYTE* const oend = seekBuffer + seekCapacity;
+        size_t pos = 0, seekSize, r;
+        int n;
+        if (seekBuffer == NULL) goto _output_error;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_enableSeekTable(cctx, 1) );
+        CHECK_V(r, LZ4F_compressBegin(cctx, op, (size_t)(oend-op), &prefs)); op += r;
+        while (pos < COMPRESSIBLE_NOISE_LENGTH) {
+            /* irregular chunks and flushes, to produce blocks of various sizes */
+            size_t const randChunk = (FUZ_rand(randState) % (200 KB)) + 1;
+            size_t const chunk = MIN(randChunk, COMPRESSIBLE_NOISE_LENGTH - pos);
+            CHECK_V(r, LZ4F_compressUpdate(cctx, op, (size_t)(oend-op), (const BYTE*)CNBuffer + pos, chunk, NULL)); op += r;
+            if (FUZ_rand(randState) & 1) { CHECK_V(r, LZ4F_flush(cctx, op, (size_t)(oend-op), NULL)); op += r; }
+            pos += chunk;
+        }
+        CHECK_V(r, LZ4F_compressEnd(cctx, op, (size_t)(oend-op), NULL)); op += r;
+        if (LZ4F_seekTableSize(cctx) < 8 + LZ4F_SEEKTABLE_FOOTER_SIZE + 32 * LZ4F_SEEKTABLE_ENTRY_SIZE) goto _output_error;
+        CHECK_V(r, LZ4F_writeSeekTable(cctx, op, (size_t)(oend-op))); op += r;
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        seekSize = (size_t)(op - seekBuffer);
+        DISPLAYLEVEL(3, "%u bytes, with a %u bytes seek table \n", (U32)seekSize, (U32)r);
+
+        DISPLAYLEVEL(3, "regular decoder skips seek table : ");
+        {   size_t iSize = seekSize;
+            size_t oSize = COMPRESSIBLE_NOISE_LENGTH;
+            CHECK( LZ4F_createDecompressionContext(&dCtx, LZ4F_VERSION) );
+            CHECK( LZ4F_decompress(dCtx, decodedBuffer, &oSize, seekBuffer, &iSize, NULL) );
+            if (oSize != COMPRESSIBLE_NOISE_LENGTH) goto _output_error;
+            if (memcmp(CNBuffer, decodedBuffer, oSize)) goto _output_error;
+            if (iSize < seekSize) {   /* frame end or seek table not consumed yet */
+                size_t iSize2 = seekSize - iSize;
+                size_t oSize2 = COMPRESSIBLE_NOISE_LENGTH;
+                CHECK( LZ4F_decompress(dCtx, decodedBuffer, &oSize2, seekBuffer + iSize, &iSize2, NULL) );
+                if (oSize2 != 0 || iSize + iSize2 != seekSize) goto _output_error;
+            }
+            DISPLAYLEVEL(3, "OK \n");
+        }
+
+        DISPLAYLEVEL(3, "random access : ");
+        for (n = 0; n < 200; n++) {
+            size_t const offset = FUZ_rand(randState) % COMPRESSIBLE_NOISE_LENGTH;
+            size_t const len = FUZ_rand(randState) % (300 KB);
+            size_t const expected = MIN(len, COMPRESSIBLE_NOISE_LENGTH - offset);
+            size_t dSize;
+            CHECK_V(dSize, LZ4F_seekableDecompress(dCtx, decodedBuffer, len, seekBuffer, seekSize, offset));
+            if (dSize != expected) goto _output_error;
+            if (memcmp((const BYTE*)CNBuffer + offset, decodedBuffer, dSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(3, "OK \n");
+
+        DISPLAYLEVEL(3, "corrupted block checksum : ");
+        seekBuffer[seekSize - r - 9] ^= 1;   /* last byte of last block checksum, before end mark and content checksum */
+        {   size_t const err = LZ4F_seekableDecompress(dCtx, decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, seekBuffer, seekSize, 0);
+            if (LZ4F_getErrorCode(err) != LZ4F_ERROR_blockChecksum_invalid) goto _output_error;
+            DISPLAYLEVEL(3, "correctly failed : %s \n", LZ4F_getErrorName(err));
+        }
+        seekBuffer[seekSize - r - 9] ^= 1;
+
+        DISPLAYLEVEL(3, "corrupted seek table : ");
+        seekBuffer[seekSize - LZ4F_SEEKTABLE_FOOTER_SIZE - 8] ^= 1;   /* last entry, compressed size */
+        {   size_t const err = LZ4F_seekableDecompress(dCtx, decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, seekBuffer, seekSize, 0);
+            if (!LZ4F_isError(err)) goto _output_error;
+            DISPLAYLEVEL(3, "correctly failed : %s \n", LZ4F_getErrorName(err));
+        }
+
+        DISPLAYLEVEL(3, "seekable frame with dictID : ");
+        prefs.frameInfo.dictID = 1;
+        op = seekBuffer;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_enableSeekTable(cctx, 1) );
+        CHECK_V(r, LZ4F_compressBegin(cctx, op, (size_t)(oend-op), &prefs)); op += r;
+        CHECK_V(r, LZ4F_compressUpdate(cctx, op, (size_t)(oend-op), CNBuffer, 100 KB, NULL)); op += r;
+        CHECK_V(r, LZ4F_compressEnd(cctx, op, (size_t)(oend-op), NULL)); op += r;
+        CHECK_V(r, LZ4F_writeSeekTable(cctx, op, (size_t)(oend-op))); op += r;
+        CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+        {   size_t const err = LZ4F_seekableDecompress(dCtx, decodedBuffer, 100 KB, seekBuffer, (size_t)(op - seekBuffer), 0);
+            if (LZ4F_getErrorCode(err) != LZ4F_ERROR_parameter_invalid) goto _output_error;
+            DISPLAYLEVEL(3, "correctly failed : %s \n", LZ4F_getErrorName(err));
+        }
+        CHECK( LZ4F_freeDecompressionContext(dCtx) ); dCtx = NULL;
+        free(seekBuffer);
+    }
+
     /* frame content size tests */
     {   size_t cErr;
         BYTE* const ostart = (BYTE*)compressedBuffer;
@@ -859,6 +1934,96 @@ static int unitTests(U32 seed, double compressibility)
             }
         }
 
+        DISPLAYLEVEL(3, "LZ4F_decompress_usingDDict, shared across frames : ");
+        {   LZ4F_DDict* const ddict = LZ4F_createDDict(CNBuffer, dictSize);
+            LZ4F_dctx* dctx;
+            LZ4F_preferences_t cParams;
+            size_t const chunkSize = 1 KB;  /* small blocks : decoded through the ddict scratch */
+            size_t const nbChunks = 8;
+            size_t n;
+            if (ddict == NULL) goto _output_error;
+            CHECK( LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION) );
+            memset(&cParams, 0, sizeof(cParams));
+            cParams.frameInfo.blockMode = LZ4F_blockIndependent;
+            cParams.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            for (n = 0; n < nbChunks; n++) {
+                const BYTE* const chunk = (const BYTE*)CNBuffer + dictSize + n * chunkSize;
+                size_t decodedSize = COMPRESSIBLE_NOISE_LENGTH;
+                size_t compressedSize;
+                CHECK_V(compressedSize,
+                    LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, LZ4F_compressFrameBound(chunkSize, &cParams),
+                                                  chunk, chunkSize,
+                                                  cdict, &cParams) );
+                {   size_t const cSizeChunk = compressedSize;
+                    CHECK( LZ4F_decompress_usingDDict(dctx,
+                                                decodedBuffer, &decodedSize,
+                                                compressedBuffer, &compressedSize,
+                                                ddict, NULL) );
+                    if (compressedSize != cSizeChunk) goto _output_error;
+                }
+                if (decodedSize != chunkSize) goto _output_error;
+                if (memcmp(decodedBuffer, chunk, chunkSize)) goto _output_error;
+            }
+            /* same ddict, linked blocks, into a destination which is too small */
+            {   size_t const inSize = dictSize * 3;
+                size_t cSizeLinked, pos = 0, dPos = 0;
+                cParams.frameInfo.blockMode = LZ4F_blockLinked;
+                CHECK_V(cSizeLinked,
+                    LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, LZ4F_compressFrameBound(inSize, &cParams),
+                                                  CNBuffer, inSize,
+                                                  cdict, &cParams) );
+                while (pos < cSizeLinked) {
+                    size_t iSize = MIN(cSizeLinked - pos, 700);
+                    size_t oSize = MIN(COMPRESSIBLE_NOISE_LENGTH - dPos, 900);
+                    CHECK( LZ4F_decompress_usingDDict(dctx,
+                                                (BYTE*)decodedBuffer + dPos, &oSize,
+                                                (const BYTE*)compressedBuffer + pos, &iSize,
+                                                ddict, NULL) );
+                    pos += iSize;
+                    dPos += oSize;
+                }
+                if (dPos != inSize) goto _output_error;
+                if (memcmp(decodedBuffer, CNBuffer, inSize)) goto _output_error;
+            }
+            DISPLAYLEVEL(3, "OK \n");
+            CHECK( LZ4F_freeDecompressionContext(dctx) );
+            LZ4F_freeDDict(ddict);
+        }
+
+        DISPLAYLEVEL(3, "LZ4F_serializeCDict, LZ4F_mapCDict : ");
+        {   size_t const imageSize = LZ4F_serializedCDictSize(cdict);
+            void* const image = malloc(imageSize);
+            void* const refBuffer = malloc(dstCapacity);
+            static const int levels[] = { 1, 9 };
+            size_t n;
+            if (image == NULL || refBuffer == NULL) goto _output_error;
+            if (!LZ4F_isError(LZ4F_serializeCDict(cdict, image, imageSize - 1))) goto _output_error;
+            {   size_t const r = LZ4F_serializeCDict(cdict, image, imageSize);
+                CHECK(r); if (r != imageSize) goto _output_error; }
+            for (n = 0; n < 2; n++) {   /* an image can be mapped again once previous CDict is released */
+                LZ4F_CDict* const mapped = LZ4F_mapCDict(image, imageSize);
+                size_t l;
+                if (mapped == NULL) goto _output_error;
+                for (l = 0; l < sizeof(levels)/sizeof(levels[0]); l++) {
+                    LZ4F_preferences_t cParams;
+                    size_t refSize, mapSize;
+                    memset(&cParams, 0, sizeof(cParams));
+                    cParams.compressionLevel = levels[l];
+                    CHECK_V(refSize, LZ4F_compressFrame_usingCDict(cctx, refBuffer, dstCapacity, CNBuffer, srcSize, cdict, &cParams));
+                    CHECK_V(mapSize, LZ4F_compressFrame_usingCDict(cctx, compressedBuffer, dstCapacity, CNBuffer, srcSize, mapped, &cParams));
+                    if (mapSize != refSize || memcmp(compressedBuffer, refBuffer, mapSize)) goto _output_error;
+                }
+                LZ4F_freeCDict(mapped);
+            }
+            /* damaged images are rejected */
+            if (LZ4F_mapCDict(image, imageSize - 1) != NULL) goto _output_error;
+            ((BYTE*)image)[imageSize - 100] ^= 1;
+            if (LZ4F_mapCDict(image, imageSize) != NULL) goto _output_error;
+            free(refBuffer);
+            free(image);
+        }
+        DISPLAYLEVEL(3, "OK \n");
+
         LZ4F_freeCDict(cdict);
         CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
     }
@@ -952,6 +2117,304 @@ static int unitTests(U32 seed, double compressibility)
         DISPLAYLEVEL(3, "Skipped %i bytes \n", (int)(ip - (BYTE*)compressedBuffer - 8));
     }
 
+    DISPLAYLEVEL(3, "LZ4F_readPeek / LZ4F_readConsume, mixed with LZ4F_read : ");
+    {   size_t const srcSize = COMPRESSIBLE_NOISE_LENGTH;
+        int blockMode;
+        for (blockMode = LZ4F_blockLinked; blockMode <= LZ4F_blockIndependent; blockMode++) {
+            LZ4_readFile_t* lz4fRead;
+            FILE* f;
+            size_t pos = 0;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockMode = (LZ4F_blockMode_t)blockMode;
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            f = FUZ_lz4fileCreate(&prefs, CNBuffer, srcSize);
+            if (f == NULL) goto _output_error;
+            CHECK( LZ4F_readOpen(&lz4fRead, f) );
+            for (;;) {
+                U32 const action = FUZ_rand(randState) % 3;
+                if (action == 0) {
+                    size_t const wanted = (FUZ_rand(randState) % (100 KB)) + 1;
+                    size_t r;
+                    CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, wanted));
+                    if (r > srcSize - pos) goto _output_error;
+                    if (memcmp((const BYTE*)CNBuffer + pos, decodedBuffer, r)) goto _output_error;
+                    pos += r;
+                    if (r < wanted) break;   /* end of file */
+                } else {
+                    const void* ptr;
+                    size_t len, consumed;
+                    CHECK( LZ4F_readPeek(lz4fRead, &ptr, &len) );
+                    if (len == 0) break;   /* end of file */
+                    if (len > srcSize - pos) goto _output_error;
+                    if (memcmp((const BYTE*)CNBuffer + pos, ptr, len)) goto _output_error;
+                    /* consume all, or only part of, peeked data */
+                    consumed = (action == 1) ? len : FUZ_rand(randState) % len;
+                    CHECK( LZ4F_readConsume(lz4fRead, consumed) );
+                    pos += consumed;
+                    if (consumed < len) {   /* remaining bytes are provided again */
+                        const void* ptr2;
+                        size_t len2;
+                        CHECK( LZ4F_readPeek(lz4fRead, &ptr2, &len2) );
+                        if (ptr2 != (const BYTE*)ptr + consumed || len2 != len - consumed) goto _output_error;
+                }   }
+            }
+            if (pos != srcSize) goto _output_error;
+            {   const void* ptr;
+                size_t len;
+                CHECK( LZ4F_readPeek(lz4fRead, &ptr, &len) );
+                if (len != 0) goto _output_error;
+                if (!LZ4F_isError(LZ4F_readConsume(lz4fRead, 1))) goto _output_error;   /* nothing left to consume */
+            }
+            CHECK( LZ4F_readClose(lz4fRead) );
+            fclose(f);
+        }
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_writeOpen_MT, read back with LZ4F_readOpen : ");
+    {   size_t const srcSize = COMPRESSIBLE_NOISE_LENGTH;
+        static const unsigned nbBuffersList[] = { 1, 3, 8 };
+        DeferredJobs dj;
+        LZ4F_Executor executor;
+        size_t n;
+        executor.submitJob = deferred_submitJob;
+        executor.completeJobs = deferred_completeJobs;
+        executor.opaqueState = &dj;
+        dj.nbJobs = 0;
+        for (n = 0; n < 2 * sizeof(nbBuffersList) / sizeof(nbBuffersList[0]); n++) {
+            unsigned const nbBuffers = nbBuffersList[n / 2];
+            int const useExecutor = (int)(n & 1);
+            FILE* const f = tmpfile();
+            LZ4_writeFile_t* lz4fWrite;
+            LZ4_readFile_t* lz4fRead;
+            size_t pos = 0, r;
+            BYTE flg;
+            if (f == NULL) goto _output_error;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockMode = LZ4F_blockLinked;   /* ignored : blocks are necessarily independent */
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            prefs.frameInfo.blockChecksumFlag = (LZ4F_blockChecksum_t)(FUZ_rand(randState) & 1);
+            prefs.frameInfo.contentSize = (FUZ_rand(randState) & 1) ? srcSize : 0;
+            prefs.compressionLevel = (int)(FUZ_rand(randState) % 4);
+            CHECK( LZ4F_writeOpen_MT(&lz4fWrite, f, &prefs, useExecutor ? &executor : NULL, nbBuffers) );
+            while (pos < srcSize) {
+                /* alternate small writes, within a block, and large ones, spanning several blocks */
+                size_t const wanted = (FUZ_rand(randState) & 1) ? (FUZ_rand(randState) % 100) + 1
+                                                               : (FUZ_rand(randState) % (300 KB)) + 1;
+                size_t const chunk = MIN(wanted, srcSize - pos);
+                CHECK_V(r, LZ4F_write(lz4fWrite, (const BYTE*)CNBuffer + pos, chunk));
+                if (r != chunk) goto _output_error;
+                pos += chunk;
+            }
+            CHECK( LZ4F_writeClose(lz4fWrite) );
+            if (dj.nbJobs != 0) goto _output_error;   /* all jobs completed */
+
+            if (fseek(f, 4, SEEK_SET) != 0 || fread(&flg, 1, 1, f) != 1) goto _output_error;
+            if (!(flg & 0x20)) goto _output_error;   /* FLG.B.Indep */
+            rewind(f);
+            CHECK( LZ4F_readOpen(&lz4fRead, f) );
+            CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, srcSize));
+            if (r != srcSize) goto _output_error;
+            if (memcmp(CNBuffer, decodedBuffer, srcSize)) goto _output_error;
+            CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, 1));
+            if (r != 0) goto _output_error;   /* end of file */
+            CHECK( LZ4F_readClose(lz4fRead) );
+            fclose(f);
+        }
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_seek : ");
+    {   size_t const srcSize = COMPRESSIBLE_NOISE_LENGTH;
+        /* forward and backward, within a block, across blocks, at block boundaries, at end */
+        static const size_t fixedOffsets[] = { 100, 5 * (64 KB) + 7, 10 * (64 KB), 3 * (64 KB) + 1000,
+                                               3 * (64 KB) + 999, 0, 31 * (64 KB) + 1, COMPRESSIBLE_NOISE_LENGTH, 1 };
+        int withSeekTable;
+        for (withSeekTable = 0; withSeekTable < 2; withSeekTable++) {
+            LZ4_readFile_t* lz4fRead;
+            FILE* f;
+            size_t n, r;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+            prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+            prefs.frameInfo.contentSize = srcSize;
+            if (withSeekTable) {
+                /* seek table lets LZ4F_seek() skip block scanning */
+                BYTE* op = (BYTE*)compressedBuffer;
+                BYTE* const oend = op + cBuffSize;
+                f = tmpfile();
+                if (f == NULL) goto _output_error;
+                CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+                CHECK( LZ4F_enableSeekTable(cctx, 1) );
+                CHECK_V(r, LZ4F_compressBegin(cctx, op, (size_t)(oend-op), &prefs)); op += r;
+                for (n = 0; n < srcSize; n += 64 KB) {
+                    CHECK_V(r, LZ4F_compressUpdate(cctx, op, (size_t)(oend-op), (const BYTE*)CNBuffer + n, MIN(64 KB, srcSize - n), NULL));
+                    op += r;
+                }
+                CHECK_V(r, LZ4F_compressEnd(cctx, op, (size_t)(oend-op), NULL)); op += r;
+                CHECK_V(r, LZ4F_writeSeekTable(cctx, op, (size_t)(oend-op))); op += r;
+                CHECK( LZ4F_freeCompressionContext(cctx) ); cctx = NULL;
+                r = (size_t)(op - (BYTE*)compressedBuffer);
+                if (fwrite(compressedBuffer, 1, r, f) != r) goto _output_error;
+                rewind(f);
+            } else {
+                f = FUZ_lz4fileCreate(&prefs, CNBuffer, srcSize);
+                if (f == NULL) goto _output_error;
+            }
+            CHECK( LZ4F_readOpen(&lz4fRead, f) );
+            CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, 1000));   /* start from a non-zero position */
+            for (n = 0; n < sizeof(fixedOffsets) / sizeof(fixedOffsets[0]) + 100; n++) {
+                size_t const offset = (n < sizeof(fixedOffsets) / sizeof(fixedOffsets[0])) ?
+                                      fixedOffsets[n] : FUZ_rand(randState) % (srcSize + 1);
+                size_t const wanted = (FUZ_rand(randState) % (150 KB)) + 1;
+                size_t const expected = MIN(wanted, srcSize - offset);
+                CHECK( LZ4F_seek(lz4fRead, offset) );
+                if (FUZ_rand(randState) & 1) {
+                    CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, wanted));
+                    if (r != expected) goto _output_error;
+                    if (memcmp((const BYTE*)CNBuffer + offset, decodedBuffer, r)) goto _output_error;
+                } else {
+                    const void* ptr;
+                    size_t len;
+                    CHECK( LZ4F_readPeek(lz4fRead, &ptr, &len) );
+                    if ((offset == srcSize) != (len == 0)) goto _output_error;
+                    if (len > srcSize - offset) goto _output_error;
+                    if (memcmp((const BYTE*)CNBuffer + offset, ptr, len)) goto _output_error;
+                }
+            }
+            /* beyond end of frame : refused, and position stays usable */
+            {   LZ4F_errorCode_t const err = LZ4F_seek(lz4fRead, srcSize + 1);
+                if (LZ4F_getErrorCode(err) != LZ4F_ERROR_parameter_invalid) goto _output_error;
+            }
+            CHECK( LZ4F_seek(lz4fRead, 7 * (64 KB) - 3) );
+            CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, 100));
+            if (r != 100 || memcmp((const BYTE*)CNBuffer + 7 * (64 KB) - 3, decodedBuffer, 100)) goto _output_error;
+            CHECK( LZ4F_readClose(lz4fRead) );
+            fclose(f);
+        }
+
+        /* linked blocks : no random access */
+        {   LZ4_readFile_t* lz4fRead;
+            FILE* f;
+            size_t r;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockMode = LZ4F_blockLinked;
+            prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+            f = FUZ_lz4fileCreate(&prefs, CNBuffer, srcSize);
+            if (f == NULL) goto _output_error;
+            CHECK( LZ4F_readOpen(&lz4fRead, f) );
+            if (LZ4F_getErrorCode(LZ4F_seek(lz4fRead, 200 KB)) != LZ4F_ERROR_blockMode_invalid) goto _output_error;
+            CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, 100 KB));
+            if (LZ4F_getErrorCode(LZ4F_seek(lz4fRead, 10)) != LZ4F_ERROR_blockMode_invalid) goto _output_error;
+            /* sequential reading is unaffected */
+            CHECK_V(r, LZ4F_read(lz4fRead, (BYTE*)decodedBuffer + 100 KB, srcSize - 100 KB));
+            if (r != srcSize - 100 KB || memcmp(CNBuffer, decodedBuffer, srcSize)) goto _output_error;
+            CHECK( LZ4F_readClose(lz4fRead) );
+            fclose(f);
+        }
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
+    DISPLAYLEVEL(3, "LZ4F_writeOpenAppend : ");
+    {   size_t const srcSize = COMPRESSIBLE_NOISE_LENGTH;
+        int checksums;
+        for (checksums = 0; checksums < 4; checksums++) {
+            FILE* const f = tmpfile();
+            size_t const cut1 = FUZ_rand(randState) % (srcSize / 2);
+            size_t const cut2 = cut1 + FUZ_rand(randState) % (srcSize - cut1);
+            size_t const ends[] = { cut1, cut2, srcSize };
+            size_t start = 0, part;
+            if (f == NULL) goto _output_error;
+            for (part = 0; part < sizeof(ends) / sizeof(ends[0]); part++) {
+                LZ4_writeFile_t* lz4fWrite;
+                LZ4_readFile_t* lz4fRead;
+                size_t pos = start, r;
+                BYTE flg;
+                memset(&prefs, 0, sizeof(prefs));
+                /* only used for the first frame : later parts continue it */
+                prefs.frameInfo.blockMode = LZ4F_blockLinked;   /* empty file : forced to independent blocks */
+                prefs.frameInfo.contentSize = srcSize;          /* empty file : dropped, so frame can grow */
+                prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+                prefs.frameInfo.contentChecksumFlag = (LZ4F_contentChecksum_t)(checksums & 1);
+                prefs.frameInfo.blockChecksumFlag = (LZ4F_blockChecksum_t)(checksums >> 1);
+                prefs.compressionLevel = (int)(FUZ_rand(randState) % 4);
+                prefs.autoFlush = (unsigned)(FUZ_rand(randState) & 1);
+                CHECK( LZ4F_writeOpenAppend(&lz4fWrite, f, &prefs) );
+                while (pos < ends[part]) {
+                    size_t const wanted = (FUZ_rand(randState) % (100 KB)) + 1;
+                    size_t const chunk = MIN(wanted, ends[part] - pos);
+                    CHECK_V(r, LZ4F_write(lz4fWrite, (const BYTE*)CNBuffer + pos, chunk));
+                    if (r != chunk) goto _output_error;
+                    pos += chunk;
+                }
+                CHECK( LZ4F_writeClose(lz4fWrite) );
+                start = ends[part];
+
+                if (fseek(f, 4, SEEK_SET) != 0 || fread(&flg, 1, 1, f) != 1) goto _output_error;
+                if ((flg & 0x20) == 0) goto _output_error;                    /* FLG.B.Indep */
+                if ((flg & 0x08) != 0) goto _output_error;                    /* FLG.ContentSize */
+                if (((flg >> 2) & 1) != (BYTE)(checksums & 1)) goto _output_error;   /* FLG.C.Checksum : from first frame */
+                rewind(f);
+                CHECK( LZ4F_readOpen(&lz4fRead, f) );
+                CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, srcSize));
+                if (r != start || memcmp(CNBuffer, decodedBuffer, start)) goto _output_error;
+                CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, 1));
+                if (r != 0) goto _output_error;   /* end of file */
+                /* single frame : LZ4F_seek() reaches content of last part */
+                if (start > 10) {
+                    CHECK( LZ4F_seek(lz4fRead, start - 10) );
+                    CHECK_V(r, LZ4F_read(lz4fRead, decodedBuffer, 10));
+                    if (r != 10 || memcmp((const BYTE*)CNBuffer + start - 10, decodedBuffer, 10)) goto _output_error;
+                }
+                CHECK( LZ4F_readClose(lz4fRead) );
+            }
+            if (checksums & 2) {
+                /* corrupted block checksum of first block : detected, even though block content is intact */
+                LZ4_writeFile_t* lz4fWrite;
+                BYTE bh[4], b;
+                long crcPos;
+                if (fseek(f, 7, SEEK_SET) != 0 || fread(bh, 1, 4, f) != 4) goto _output_error;
+                crcPos = 7 + 4 + (long)(FUZ_readLE32(bh) & 0x7FFFFFFF);
+                if (fseek(f, crcPos, SEEK_SET) != 0 || fread(&b, 1, 1, f) != 1) goto _output_error;
+                b ^= 1;
+                if (fseek(f, crcPos, SEEK_SET) != 0 || fwrite(&b, 1, 1, f) != 1) goto _output_error;
+                if (LZ4F_getErrorCode(LZ4F_writeOpenAppend(&lz4fWrite, f, NULL)) != LZ4F_ERROR_blockChecksum_invalid) goto _output_error;
+                b ^= 1;
+                if (fseek(f, crcPos, SEEK_SET) != 0 || fwrite(&b, 1, 1, f) != 1) goto _output_error;
+            }
+            if (checksums & 1) {
+                /* corrupted content checksum : detected, since prior content is decoded to rebuild it */
+                LZ4_writeFile_t* lz4fWrite;
+                BYTE b;
+                if (fseek(f, -1, SEEK_END) != 0 || fread(&b, 1, 1, f) != 1) goto _output_error;
+                b ^= 1;
+                if (fseek(f, -1, SEEK_END) != 0 || fwrite(&b, 1, 1, f) != 1) goto _output_error;
+                if (LZ4F_getErrorCode(LZ4F_writeOpenAppend(&lz4fWrite, f, NULL)) != LZ4F_ERROR_contentChecksum_invalid) goto _output_error;
+            }
+            fclose(f);
+        }
+
+        /* frames which can't be continued */
+        {   int n;
+            for (n = 0; n < 2; n++) {
+                LZ4_writeFile_t* lz4fWrite;
+                LZ4F_errorCodes const expected = n ? LZ4F_ERROR_parameter_invalid : LZ4F_ERROR_blockMode_invalid;
+                FILE* f;
+                memset(&prefs, 0, sizeof(prefs));
+                prefs.frameInfo.blockMode = n ? LZ4F_blockIndependent : LZ4F_blockLinked;
+                prefs.frameInfo.contentSize = n ? 100 KB : 0;
+                f = FUZ_lz4fileCreate(&prefs, CNBuffer, 100 KB);
+                if (f == NULL) goto _output_error;
+                if (LZ4F_getErrorCode(LZ4F_writeOpenAppend(&lz4fWrite, f, &prefs)) != expected) goto _output_error;
+                fclose(f);
+        }   }
+        DISPLAYLEVEL(3, "OK \n");
+    }
+
     DISPLAY("Basic tests completed \n");
 _end:
     free(CNBuffer);
@@ -1166,6 +2629,7 @@ int fuzzerTests(U32 seed, unsigned nbTests, unsigned startTest, double compressi
         prefs.frameInfo.contentSize = ((FUZ_rand(&randState) & 0xF) == 1) ? srcSize : 0;
         prefs.autoFlush = neverFlush ? 0 : (FUZ_rand(&randState) & 7) == 2;
         prefs.compressionLevel = -5 + (int)(FUZ_rand(&randState) % 11);
+        prefs.skipIncompressible = (FUZ_rand(&randState) & 3) == 1;
         if ((FUZ_rand(&randState) & 0xF) == 1) prefsPtr = NULL;
 
         DISPLAYUPDATE(2, "\r%5u   ", testNb);
@@ -29,6 +29,18 @@
 #  define BMK_LEGACY_TIMER 1
 #endif
 
+/* hardware performance counters (--perf) require Linux perf_event_open() */
+#ifndef FULLBENCH_PERF
+#  if defined(__linux__)
+#    define FULLBENCH_PERF 1
+#  else
+#    define FULLBENCH_PERF 0
+#  endif
+#endif
+#if FULLBENCH_PERF && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* syscall() */
+#endif
+
 
 /**************************************
 *  Includes
@@ -41,6 +53,13 @@
 #include <sys/stat.h>    /* stat64 */
 #include <string.h>      /* strcmp */
 #include <time.h>        /* clock_t, clock(), CLOCKS_PER_SEC */
+#if FULLBENCH_PERF
+#  include <linux/perf_event.h>  /* perf_event_attr */
+#  include <sys/ioctl.h>   /* ioctl */
+#  include <sys/syscall.h> /* SYS_perf_event_open */
+#  include <unistd.h>      /* syscall, read, close */
+#  include <errno.h>       /* errno */
+#endif
 
 #define LZ4_DISABLE_DEPRECATE_WARNINGS   /* LZ4_decompress_fast */
 #include "lz4.h"
@@ -103,6 +122,8 @@ static int g_compressionAlgo = ALL_COMPRESSORS;
 static int g_decompressionTest = 1;
 static int g_decompressionAlgo = ALL_DECOMPRESSORS;
 static int g_noPrompt = 0;
+typedef enum { format_text, format_json, format_csv } outputFormat_e;
+static outputFormat_e g_outputFormat = format_text;
 
 static void BMK_setBlocksize(int bsize)
 {
@@ -122,6 +143,183 @@ static void BMK_setPause(void)
 }
 
 
+/*********************************************************
+*  Structured output (json, csv)
+*********************************************************/
+#ifdef LZ4_FAST_DEC_LOOP
+#  define FAST_DEC_LOOP_STRING LZ4_EXPAND_AND_QUOTE(LZ4_FAST_DEC_LOOP)
+#else
+#  define FAST_DEC_LOOP_STRING "default"
+#endif
+#if defined(__clang__)
+#  define COMPILER_STRING __VERSION__
+#elif defined(__GNUC__)
+#  define COMPILER_STRING "gcc " __VERSION__
+#elif defined(_MSC_VER)
+#  define COMPILER_STRING "msvc " LZ4_EXPAND_AND_QUOTE(_MSC_FULL_VER)
+#else
+#  define COMPILER_STRING "unknown"
+#endif
+
+static void BMK_outputString(const char* s)
+{
+    printf("\"");
+    for ( ; *s; s++) {
+        if (g_outputFormat == format_json) {
+            if (*s == '"' || *s == '\\') printf("\\%c", *s);
+            else if ((unsigned char)*s < 0x20) printf("\\u%04x", (unsigned)*s);
+            else printf("%c", *s);
+        } else {
+            if (*s == '"') printf("\"\"");
+            else printf("%c", *s);
+        }
+    }
+    printf("\"");
+}
+
+static void BMK_outputSpeed(double speed)
+{
+    if (speed >= 0) printf("%.2f", speed);
+    else if (g_outputFormat == format_json) printf("null");
+}
+
+/* BMK_outputRecord() :
+ * writes one result on stdout, using same fields as `lz4 -b --bench-format=`.
+ * Functions have no level parameter : it's left empty.
+ * @cSpeed, @dSpeed : MB/s, < 0 when not measured */
+static void BMK_outputRecord(const char* fileName, int blockSize, const char* api,
+                             size_t srcSize, size_t cSize, double cSpeed, double dSpeed)
+{
+    static char cpuModel[128] = { 0 };
+    static int headerDone = 0;
+    int const json = (g_outputFormat == format_json);
+    if (g_outputFormat == format_text) return;
+    if (cpuModel[0] == 0) UTIL_getCpuModel(cpuModel, sizeof(cpuModel));
+    if (!json && !headerDone) {
+        printf("file,level,blockSize,api,threads,srcSize,cSize,ratio,cSpeedMBs,dSpeedMBs,iterations,"
+               "cpu,version,compiler,LZ4_MEMORY_USAGE,LZ4_FAST_DEC_LOOP\n");
+        headerDone = 1;
+    }
+    if (json) printf("{\"file\":");
+    BMK_outputString(fileName);
+    printf(json ? ",\"level\":null,\"blockSize\":%i,\"api\":" : ",,%i,", blockSize);
+    BMK_outputString(api);
+    printf(json ? ",\"threads\":1,\"srcSize\":%u,\"cSize\":%u,\"ratio\":%.4f,\"cSpeedMBs\":" : ",1,%u,%u,%.4f,",
+           (unsigned)srcSize, (unsigned)cSize, (double)srcSize / (double)(cSize + !cSize));
+    BMK_outputSpeed(cSpeed);
+    printf(json ? ",\"dSpeedMBs\":" : ",");
+    BMK_outputSpeed(dSpeed);
+    printf(json ? ",\"iterations\":%i,\"cpu\":" : ",%i,", g_nbIterations);
+    BMK_outputString(cpuModel);
+    printf(json ? ",\"version\":" : ",");
+    BMK_outputString(LZ4_VERSION_STRING);
+    printf(json ? ",\"compiler\":" : ",");
+    BMK_outputString(COMPILER_STRING);
+    printf(json ? ",\"LZ4_MEMORY_USAGE\":%i,\"LZ4_FAST_DEC_LOOP\":" : ",%i,", LZ4_MEMORY_USAGE);
+    BMK_outputString(FAST_DEC_LOOP_STRING);
+    printf(json ? "}\n" : "\n");
+    fflush(stdout);
+}
+
+
+/*********************************************************
+*  Hardware performance counters (--perf)
+*********************************************************/
+/* Counters are enabled only while benchmarked functions run,
+ * and reported per byte of original (uncompressed) data. */
+#define PERF_NB_COUNTERS 5
+static int g_perf = 0;
+static const char* const g_perfNames[PERF_NB_COUNTERS] =
+    { "cycles/B", "instr/B", "br-miss/KB", "L1D-miss/KB", "LLC-miss/KB" };
+static const double g_perfUnit[PERF_NB_COUNTERS] = { 1, 1, 1 KB, 1 KB, 1 KB };
+
+#if FULLBENCH_PERF
+static int g_perfFd[PERF_NB_COUNTERS] = { -1, -1, -1, -1, -1 };
+
+static void PERF_open(void)
+{
+    static const struct { U32 type; U64 config; } events[PERF_NB_COUNTERS] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                              | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                              | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },   /* last level cache */
+    };
+    int n, nbOpened = 0;
+    for (n=0; n<PERF_NB_COUNTERS; n++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[n].type;
+        attr.config = events[n].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        g_perfFd[n] = (int)syscall(SYS_perf_event_open, &attr, 0 /* this process */, -1 /* any cpu */, -1, 0);
+        if (g_perfFd[n] < 0) {
+            DISPLAY("warning : %s counter not available (%s) \n", g_perfNames[n], strerror(errno));
+        } else {
+            nbOpened++;
+    }   }
+    if (nbOpened == 0) {
+        DISPLAY("warning : no hardware counter available (see /proc/sys/kernel/perf_event_paranoid) \n");
+        g_perf = 0;
+    }
+}
+
+static void PERF_close(void)
+{
+    int n;
+    for (n=0; n<PERF_NB_COUNTERS; n++) {
+        if (g_perfFd[n] >= 0) close(g_perfFd[n]);
+        g_perfFd[n] = -1;
+    }
+}
+
+static void PERF_control(unsigned long request)
+{
+    int n;
+    if (!g_perf) return;
+    for (n=0; n<PERF_NB_COUNTERS; n++)
+        if (g_perfFd[n] >= 0) (void)ioctl(g_perfFd[n], request, 0);
+}
+#define PERF_reset()   PERF_control(PERF_EVENT_IOC_RESET)
+#define PERF_enable()  PERF_control(PERF_EVENT_IOC_ENABLE)
+#define PERF_disable() PERF_control(PERF_EVENT_IOC_DISABLE)
+
+/* displays counters accumulated since PERF_reset(), divided by @nbBytes */
+static void PERF_display(U64 nbBytes)
+{
+    int n;
+    if (!g_perf) return;
+    DISPLAY("%37s", "");
+    for (n=0; n<PERF_NB_COUNTERS; n++) {
+        U64 values[3];   /* value, time enabled, time running */
+        if ( (g_perfFd[n] < 0)
+          || (read(g_perfFd[n], values, sizeof(values)) != (ssize_t)sizeof(values))
+          || (values[2] == 0) || (nbBytes == 0) ) {
+            DISPLAY(" %s %7s", g_perfNames[n], "n/a");
+            continue;
+        }
+        {   /* scale when counters were multiplexed */
+            double const count = (double)values[0] * ((double)values[1] / (double)values[2]);
+            DISPLAY(" %s %7.3f", g_perfNames[n], count * g_perfUnit[n] / (double)nbBytes);
+    }   }
+    DISPLAY("\n");
+}
+#else
+static void PERF_open(void) { DISPLAY("warning : hardware counters are not supported on this platform \n"); g_perf = 0; }
+static void PERF_close(void) {}
+#define PERF_reset()   do {} while (0)
+#define PERF_enable()  do {} while (0)
+#define PERF_disable() do {} while (0)
+static void PERF_display(U64 nbBytes) { (void)nbBytes; (void)g_perfNames; (void)g_perfUnit; }
+#endif
+
+
 /*********************************************************
 *  Private functions
 *********************************************************/
@@ -242,8 +440,9 @@ static int local_LZ4_compress_fast_continue0(const char* in, char* out, int inSi
 extern "C" {
 #endif
 
-/* declare hidden function */
+/* declare hidden functions */
 extern int LZ4_compress_forceExtDict (LZ4_stream_t* LZ4_stream, const char* source, char* dest, int inputSize);
+extern int LZ4_compress_lazy_extState(void* state, const char* src, char* dst, int srcSize, int dstCapacity);
 
 #if defined (__cplusplus)
 }
@@ -253,6 +452,11 @@ static int local_LZ4_compress_forceDict(const char* in, char* out, int inSize)
 {
     return LZ4_compress_forceExtDict(&LZ4_stream, in, out, inSize);
 }
+
+static int local_LZ4_compress_lazy(const char* in, char* out, int inSize)
+{
+    return LZ4_compress_lazy_extState(&LZ4_stream, in, out, inSize, LZ4_compressBound(inSize));
+}
 #endif
 
 
@@ -515,6 +719,9 @@ static const CompressionDesc compDescArray[] = {
     { "LZ4_compress_fast(2)", local_LZ4_compress_fast2, NULL, 0 },
     { "LZ4_compress_fast(17)", local_LZ4_compress_fast17, NULL, 0 },
     { "LZ4_compress_fast_extState(0)", local_LZ4_compress_fast_extState0, NULL, 0 },
+#ifndef LZ4_DLL_IMPORT
+    { "LZ4_compress_lazy_extState", local_LZ4_compress_lazy, NULL, 0 },
+#endif
     { "LZ4_compress_fast_continue(0)", local_LZ4_compress_fast_continue0, local_LZ4_createStream, 0 },
     { "LZ4_compress_HC", local_LZ4_compress_HC, NULL, 0 },
     { "LZ4_compress_HC_extStateHC", local_LZ4_compress_HC_extStateHC, NULL, 0 },
@@ -551,7 +758,7 @@ static const DecompressionDesc decDescArray[] = {
     { "LZ4_decompress_safe_forceExtDict", local_LZ4_decompress_safe_forceExtDict, 1, 0 },
 #endif
     { "LZ4F_decompress", local_LZ4F_decompress, 1, 1 },
-    { "LZ4F_decompLZ4F_decompress_followHintress", local_LZ4F_decompress_followHint, 1, 1 },
+    { "LZ4F_decompress_followHint", local_LZ4F_decompress_followHint, 1, 1 },
     { "LZ4F_decompress_noHint", local_LZ4F_decompress_noHint, 1, 1 },
 };
 
@@ -571,6 +778,7 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
     }
 
     /* Init */
+    if (g_perf) PERF_open();
     { size_t const errorCode = LZ4F_createDecompressionContext(&g_dCtx, LZ4F_VERSION);
       if (LZ4F_isError(errorCode)) { DISPLAY("dctx allocation issue \n"); return 10; } }
 
@@ -640,6 +848,7 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
       /* Bench */
       { int loopNb, nb_loops, chunkNb, cAlgNb, dAlgNb;
         size_t cSize=0;
+        U64 perfBytes = 0;
         double ratio=0.;
 
         DISPLAY("\r%79s\r", "");
@@ -697,6 +906,8 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
                 continue;
             }
 
+            PERF_reset();
+            perfBytes = 0;
             for (loopNb = 1; loopNb <= g_nbIterations; loopNb++) {
                 double averageTime;
                 clock_t clockTime;
@@ -708,6 +919,7 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
                 clockTime = clock();
                 while(clock() == clockTime);
                 clockTime = clock();
+                PERF_enable();
                 while(BMK_GetClockSpan(clockTime) < loopDuration) {
                     if (initFunction!=NULL) initFunction();
                     for (chunkNb=0; chunkNb<nbChunks; chunkNb++) {
@@ -719,6 +931,8 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
                     nb_loops++;
                 }
                 clockTime = BMK_GetClockSpan(clockTime);
+                PERF_disable();
+                perfBytes += (U64)benchedSize * (U64)nb_loops;
 
                 nb_loops += !nb_loops;   /* avoid division by zero */
                 averageTime = ((double)clockTime) / nb_loops / CLOCKS_PER_SEC;
@@ -732,6 +946,9 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
                 DISPLAY("%2i-%-34.34s :%10i ->%9i (%5.2f%%),%7.1f MB/s\n", cAlgNb, compressorName, (int)benchedSize, (int)cSize, ratio, (double)benchedSize / bestTime / 1000000);
             else
                 DISPLAY("%2i-%-34.34s :%10i ->%9i (%5.1f%%),%7.1f MB/s\n", cAlgNb, compressorName, (int)benchedSize, (int)cSize, ratio, (double)benchedSize / bestTime / 100000);
+            PERF_display(perfBytes);
+            BMK_outputRecord(inFileName, compDescArray[cAlgNb].singleChunk ? (int)benchedSize : g_chunkSize, compressorName,
+                             benchedSize, cSize, (double)benchedSize / bestTime / 1000000, -1.);
         }
 
         /* Prepare layout for decompression */
@@ -794,6 +1011,8 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
 
             { size_t i; for (i=0; i<benchedSize; i++) orig_buff[i]=0; }     /* zeroing source area, for CRC checking */
 
+            PERF_reset();
+            perfBytes = 0;
             for (loopNb = 1; loopNb <= g_nbIterations; loopNb++) {
                 double averageTime;
                 clock_t clockTime;
@@ -805,6 +1024,7 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
                 clockTime = clock();
                 while(clock() == clockTime);
                 clockTime = clock();
+                PERF_enable();
                 while(BMK_GetClockSpan(clockTime) < loopDuration) {
                     for (chunkNb=0; chunkNb<nbChunks; chunkNb++) {
                         int const decodedSize = decompressionFunction(chunkP[chunkNb].compressedBuffer, chunkP[chunkNb].origBuffer,
@@ -817,6 +1037,8 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
                     nb_loops++;
                 }
                 clockTime = BMK_GetClockSpan(clockTime);
+                PERF_disable();
+                perfBytes += (U64)benchedSize * (U64)nb_loops;
 
                 nb_loops += !nb_loops;   /* Avoid division by zero */
                 averageTime = (double)clockTime / nb_loops / CLOCKS_PER_SEC;
@@ -833,6 +1055,12 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
             }   }
 
             DISPLAY("%2i-%-34.34s :%10i -> %7.1f MB/s\n", dAlgNb, dName, (int)benchedSize, (double)benchedSize / bestTime / 1000000);
+            PERF_display(perfBytes);
+            {   size_t dcSize = 0;
+                for (chunkNb=0; chunkNb<nbChunks; chunkNb++) dcSize += (size_t)chunkP[chunkNb].compressedSize;
+                BMK_outputRecord(inFileName, (nbChunks == 1) ? (int)benchedSize : g_chunkSize, dName,
+                                 benchedSize, dcSize, -1., (double)benchedSize / bestTime / 1000000);
+            }
         }
       }
       free(orig_buff);
@@ -841,6 +1069,7 @@ int fullSpeedBench(const char** fileNamesTable, int nbFiles)
     }
 
     LZ4F_freeDecompressionContext(g_dCtx);
+    PERF_close();
     if (g_pause) { printf("press enter...\n"); (void)getchar(); }
 
     return 0;
@@ -882,6 +1111,9 @@ static int usage_advanced(void)
     DISPLAY( " -d#    : test only decompression function # [1-%i]\n", (int)NB_DECOMPRESSION_ALGORITHMS);
     DISPLAY( " -i#    : iteration loops [1-9](default : %i)\n", NBLOOPS);
     DISPLAY( " -B#    : Block size [4-7](default : 7)\n");
+    DISPLAY( " --json : also write one json record per result on stdout\n");
+    DISPLAY( " --csv  : also write one csv row per result on stdout\n");
+    DISPLAY( " --perf : also report hardware counters per byte (Linux only)\n");
     return list();
 }
 
@@ -912,6 +1144,9 @@ int main(int argc, const char** argv)
             g_noPrompt = 1;
             continue;
         }
+        if (!strcmp(argument, "--json")) { g_outputFormat = format_json; continue; }
+        if (!strcmp(argument, "--csv")) { g_outputFormat = format_csv; continue; }
+        if (!strcmp(argument, "--perf")) { g_perf = 1; continue; }
 
         // Decode command (note : aggregated commands are allowed)
         if (argument[0]=='-') {
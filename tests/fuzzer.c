@@ -60,6 +60,8 @@
 #include "lz4.h"
 #define LZ4_HC_STATIC_LINKING_ONLY
 #include "lz4hc.h"
+#include "lz4dict.h"
+#include "lz4page.h"
 #define XXH_STATIC_LINKING_ONLY
 #include "xxhash.h"
 
@@ -314,6 +316,35 @@ static void FUZ_findDiff(const void* buff1, const void* buff2)
 }
 
 
+/* tiles reported by LZ4_decompress_safe_usingDict_tiles() : must be contiguous */
+typedef struct {
+    XXH32_state_t srcHash;
+    XXH32_state_t dstHash;
+    const char* srcNext;
+    const char* dstNext;
+    int contiguous;
+} FUZ_tiles_t;
+
+static void FUZ_hashTile(void* opaque, const char* src, size_t srcSize, const char* dst, size_t dstSize)
+{
+    FUZ_tiles_t* const tiles = (FUZ_tiles_t*)opaque;
+    if ((src != tiles->srcNext) || (dst != tiles->dstNext)) tiles->contiguous = 0;
+    tiles->srcNext = src + srcSize;
+    tiles->dstNext = dst + dstSize;
+    XXH32_update(&tiles->srcHash, src, srcSize);
+    XXH32_update(&tiles->dstHash, dst, dstSize);
+}
+
+static void FUZ_initTiles(FUZ_tiles_t* tiles, const char* src, const char* dst)
+{
+    XXH32_reset(&tiles->srcHash, 0);
+    XXH32_reset(&tiles->dstHash, 0);
+    tiles->srcNext = src;
+    tiles->dstNext = dst;
+    tiles->contiguous = 1;
+}
+
+
 static int FUZ_test(U32 seed, U32 nbCycles, const U32 startCycle, const double compressibility, U32 duration_s)
 {
     unsigned long long bytes = 0;
@@ -491,6 +522,38 @@ static int FUZ_test(U32 seed, U32 nbCycles, const U32 startCycle, const double c
                 FUZ_CHECKTEST(r3==0, "LZ4_compress_destSize_extState() failed");
                 FUZ_CHECKTEST(inputSize>=blockSize, "LZ4_compress_destSize_extState() should consume less than full input");
             }
+
+            FUZ_DISPLAYTEST("test LZ4_estimateCompressedSize()");
+            {   int const e = LZ4_estimateCompressedSize(block, blockSize, 8);
+                FUZ_CHECKTEST(e!=r, "LZ4_estimateCompressedSize() : estimation (%i) differs from compressed size (%i)", e, r);
+            }
+
+            FUZ_DISPLAYTEST("test LZ4_estimateCompressedSize_sampled()");
+            {   int errorBound = -1;
+                int const e = LZ4_estimateCompressedSize_sampled(block, blockSize, 8, FUZ_rand(&randState) & 3, &errorBound);
+                FUZ_CHECKTEST(errorBound<0 || errorBound>blockSize, "LZ4_estimateCompressedSize_sampled() : invalid error bound (%i)", errorBound);
+                FUZ_CHECKTEST(errorBound==0 && e!=r, "LZ4_estimateCompressedSize_sampled() : exact estimation (%i) differs from compressed size (%i)", e, r);
+            }
+        }
+
+        /* Test lazy compression */
+        FUZ_DISPLAYTEST("test LZ4_compress_lazy_extState()");
+        {   int const r = LZ4_compress_lazy_extState(stateLZ4, block, compressedBuffer, blockSize, (int)compressedBufferSize);
+            FUZ_CHECKTEST(r==0, "LZ4_compress_lazy_extState() failed");
+            {   int const dSize = LZ4_decompress_safe(compressedBuffer, decodedBuffer, r, blockSize);
+                FUZ_CHECKTEST(dSize!=blockSize, "LZ4_compress_lazy_extState() : decompression failed");
+                FUZ_CHECKTEST(XXH32(decodedBuffer, (size_t)blockSize, 0)!=crcOrig, "LZ4_compress_lazy_extState() : corrupted decoded data");
+            }
+
+            FUZ_DISPLAYTEST("test LZ4_compress_lazy() with output buffer just the right size");
+            {   int const r2 = LZ4_compress_lazy(block, compressedBuffer, blockSize, r);
+                FUZ_CHECKTEST(r2!=r, "LZ4_compress_lazy() should produce the same result as LZ4_compress_lazy_extState()");
+            }
+
+            FUZ_DISPLAYTEST("test LZ4_compress_lazy_extState() with a too small destination buffer (must fail)");
+            {   int const r3 = LZ4_compress_lazy_extState(stateLZ4, block, compressedBuffer, blockSize, r-1);
+                FUZ_CHECKTEST(r3!=0, "LZ4_compress_lazy_extState() should have failed");
+            }
         }
 
         /* Test compression using fast reset external state*/
@@ -619,6 +682,14 @@ static int FUZ_test(U32 seed, U32 nbCycles, const U32 startCycle, const double c
                 }
                 {   U32 endCheck; memcpy(&endCheck, decodedBuffer+blockSize, sizeof(endCheck));
                     FUZ_CHECKTEST(endMark!=endCheck, "LZ4_decompress_safe on noisy src : dst buffer overflow");
+                }
+                {   LZ4_partialDecode_t pState;
+                    U32 endCheck;
+                    LZ4_initPartialDecode(&pState);
+                    if (LZ4_decompress_safe_partial_resume(&pState, cBuffer_exact, decodedBuffer, compressedSize, blockSize/2, blockSize) >= 0)
+                        (void)LZ4_decompress_safe_partial_resume(&pState, cBuffer_exact, decodedBuffer, compressedSize, blockSize, blockSize);
+                    memcpy(&endCheck, decodedBuffer+blockSize, sizeof(endCheck));
+                    FUZ_CHECKTEST(endMark!=endCheck, "LZ4_decompress_safe_partial_resume on noisy src : dst buffer overflow");
             }   }   /* noisy src decompression test */
 
             free(cBuffer_exact);
@@ -652,6 +723,25 @@ static int FUZ_test(U32 seed, U32 nbCycles, const U32 startCycle, const double c
             FUZ_CHECKTEST(memcmp(block, decodedBuffer, (size_t)targetSize), "LZ4_decompress_safe_partial: corruption detected in regenerated data");
         }
 
+        /* Resumable partial decompression => must work */
+        FUZ_DISPLAYTEST("test LZ4_decompress_safe_partial_resume");
+        {   LZ4_partialDecode_t pState;
+            int decoded = 0;
+            LZ4_initPartialDecode(&pState);
+            while (decoded < blockSize) {
+                int const targetSize = decoded + (int)(FUZ_rand(&randState) % (unsigned)(blockSize - decoded)) + 1;
+                char const sentinel = decodedBuffer[targetSize] = block[targetSize] ^ 0x5A;
+                int const decResult = LZ4_decompress_safe_partial_resume(&pState, compressedBuffer, decodedBuffer, compressedSize, targetSize, blockSize);
+                FUZ_CHECKTEST(decResult != targetSize, "LZ4_decompress_safe_partial_resume did not regenerate required amount of data (%i != %i)", decResult, targetSize);
+                FUZ_CHECKTEST(decodedBuffer[targetSize] != sentinel, "LZ4_decompress_safe_partial_resume overwrite beyond requested size");
+                FUZ_CHECKTEST(LZ4_partialDecode_done(&pState) != (decResult == blockSize), "LZ4_partialDecode_done() wrong at %i / %i", decResult, blockSize);
+                decoded = decResult;
+            }
+            FUZ_CHECKTEST(memcmp(block, decodedBuffer, (size_t)blockSize), "LZ4_decompress_safe_partial_resume: corruption detected in regenerated data");
+            {   int const r = LZ4_decompress_safe_partial_resume(&pState, compressedBuffer, decodedBuffer, compressedSize, blockSize+1, blockSize+1);
+                FUZ_CHECKTEST(r != blockSize, "LZ4_decompress_safe_partial_resume should stop at end of block (%i != %i)", r, blockSize);
+        }   }
+
         /* Partial decompression using dictionary. */
         FUZ_DISPLAYTEST("test LZ4_decompress_safe_partial_usingDict using no dict");
         {   size_t const missingOutBytes = FUZ_rand(&randState) % (unsigned)blockSize;
@@ -835,6 +925,45 @@ static int FUZ_test(U32 seed, U32 nbCycles, const U32 startCycle, const double c
                 FUZ_CHECKTEST(decodedBuffer[blockSize-missingBytes], "LZ4_decompress_safe_usingDict overrun specified output buffer size (-%i byte) (blockSize=%i)", missingBytes, blockSize);
         }   }
 
+        FUZ_DISPLAYTEST("test LZ4_decompress_safe_usingDict_fast() with dictionary as extDict");
+        decodedBuffer[blockSize] = 0;
+        ret = LZ4_decompress_safe_usingDict_fast(compressedBuffer, decodedBuffer, blockContinueCompressedSize, blockSize, dict, dictSize);
+        FUZ_CHECKTEST(ret!=blockSize, "LZ4_decompress_safe_usingDict_fast did not regenerate original data");
+        FUZ_CHECKTEST(decodedBuffer[blockSize], "LZ4_decompress_safe_usingDict_fast overrun specified output buffer size");
+        {   U32 const crcCheck = XXH32(decodedBuffer, (size_t)blockSize, 0);
+            FUZ_CHECKTEST(crcCheck!=crcOrig, "LZ4_decompress_safe_usingDict_fast corrupted decoded data");
+        }
+
+        FUZ_DISPLAYTEST();
+        {   int const missingBytes = (FUZ_rand(&randState) & 0xF) + 1;
+            if (blockSize > missingBytes) {
+                decodedBuffer[blockSize-missingBytes] = 0;
+                ret = LZ4_decompress_safe_usingDict_fast(compressedBuffer, decodedBuffer, blockContinueCompressedSize, blockSize-missingBytes, dict, dictSize);
+                FUZ_CHECKTEST(ret>=0, "LZ4_decompress_safe_usingDict_fast should have failed : output buffer too small (-%i byte)", missingBytes);
+                FUZ_CHECKTEST(decodedBuffer[blockSize-missingBytes], "LZ4_decompress_safe_usingDict_fast overrun specified output buffer size (-%i byte) (blockSize=%i)", missingBytes, blockSize);
+        }   }
+
+        FUZ_DISPLAYTEST("test LZ4_decompress_safe_usingDict_tiles() with dictionary as extDict");
+        {   size_t const tileSize = FUZ_rand(&randState) % (unsigned)(blockSize+1);
+            FUZ_tiles_t tiles;
+            FUZ_initTiles(&tiles, compressedBuffer, decodedBuffer);
+            decodedBuffer[blockSize] = 0;
+            ret = LZ4_decompress_safe_usingDict_tiles(compressedBuffer, decodedBuffer, blockContinueCompressedSize, blockSize,
+                                                      dict, dictSize, tileSize, FUZ_hashTile, &tiles);
+            FUZ_CHECKTEST(ret!=blockSize, "LZ4_decompress_safe_usingDict_tiles did not regenerate original data");
+            FUZ_CHECKTEST(decodedBuffer[blockSize], "LZ4_decompress_safe_usingDict_tiles overrun specified output buffer size");
+            FUZ_CHECKTEST(!tiles.contiguous, "LZ4_decompress_safe_usingDict_tiles : tiles are not contiguous");
+            FUZ_CHECKTEST(tiles.srcNext != compressedBuffer + blockContinueCompressedSize, "LZ4_decompress_safe_usingDict_tiles : input not entirely reported");
+            FUZ_CHECKTEST(tiles.dstNext != decodedBuffer + blockSize, "LZ4_decompress_safe_usingDict_tiles : output not entirely reported");
+            FUZ_CHECKTEST(XXH32_digest(&tiles.dstHash) != crcOrig, "LZ4_decompress_safe_usingDict_tiles corrupted decoded data");
+            FUZ_CHECKTEST(XXH32_digest(&tiles.srcHash) != XXH32(compressedBuffer, (size_t)blockContinueCompressedSize, 0),
+                          "LZ4_decompress_safe_usingDict_tiles : reported input differs");
+        }
+
+        FUZ_DISPLAYTEST();
+        ret = LZ4_decompress_safe_usingDict_fast(compressedBuffer, decodedBuffer, blockContinueCompressedSize-1, blockSize, dict, dictSize);
+        FUZ_CHECKTEST(ret>=0, "LZ4_decompress_safe_usingDict_fast should have failed : input size one byte too short");
+
         /* Compress using external dictionary stream */
         {   LZ4_stream_t LZ4_stream;
             int expectedSize;
@@ -1075,6 +1204,32 @@ static int FUZ_test(U32 seed, U32 nbCycles, const U32 startCycle, const double c
 #define testCompressedSize (130 KB)
 #define ringBufferSize (8 KB)
 
+/* executor which runs submitted jobs later, in reverse order */
+#define FUZ_DEFERRED_MAX 16
+typedef struct {
+    LZ4HC_JobFunction jobs[FUZ_DEFERRED_MAX];
+    void* args[FUZ_DEFERRED_MAX];
+    int nbJobs;
+} FUZ_deferredJobs_t;
+
+static void FUZ_deferJob(void* opaque, LZ4HC_JobFunction job, void* arg)
+{
+    FUZ_deferredJobs_t* const d = (FUZ_deferredJobs_t*)opaque;
+    assert(d->nbJobs < FUZ_DEFERRED_MAX);
+    d->jobs[d->nbJobs] = job;
+    d->args[d->nbJobs] = arg;
+    d->nbJobs++;
+}
+
+static void FUZ_runDeferredJobs(void* opaque)
+{
+    FUZ_deferredJobs_t* const d = (FUZ_deferredJobs_t*)opaque;
+    while (d->nbJobs > 0) {
+        d->nbJobs--;
+        d->jobs[d->nbJobs](d->args[d->nbJobs]);
+    }
+}
+
 static void FUZ_unitTests(int compressionLevel)
 {
     const unsigned testNb = 0;
@@ -1273,8 +1428,20 @@ static void FUZ_unitTests(int compressionLevel)
                 compressedSize = LZ4_compress_fast_continue(&streamingState, ringBuffer + rNext, testCompressed, (int)messageSize, testCompressedSize-ringBufferSize, 1);
                 FUZ_CHECKTEST(compressedSize==0, "LZ4_compress_fast_continue() compression failed");
 
-                { int const r = LZ4_decompress_safe_continue(&decodeStateSafe, testCompressed, testVerify + dNext, compressedSize, (int)messageSize);
-                  FUZ_CHECKTEST(r!=(int)messageSize, "ringBuffer : LZ4_decompress_safe_continue() test failed"); }
+                if (iNext & 1) {
+                    /* same decoder, reporting tiles */
+                    FUZ_tiles_t tiles;
+                    int r;
+                    FUZ_initTiles(&tiles, testCompressed, testVerify + dNext);
+                    r = LZ4_decompress_safe_continue_tiles(&decodeStateSafe, testCompressed, testVerify + dNext, compressedSize, (int)messageSize,
+                                                           FUZ_rand(&randState) & 511, FUZ_hashTile, &tiles);
+                    FUZ_CHECKTEST(r!=(int)messageSize, "ringBuffer : LZ4_decompress_safe_continue_tiles() test failed");
+                    FUZ_CHECKTEST(!tiles.contiguous || (tiles.dstNext != testVerify + dNext + messageSize) || (tiles.srcNext != testCompressed + compressedSize),
+                                  "ringBuffer : LZ4_decompress_safe_continue_tiles() did not report whole block");
+                } else {
+                    int const r = LZ4_decompress_safe_continue(&decodeStateSafe, testCompressed, testVerify + dNext, compressedSize, (int)messageSize);
+                    FUZ_CHECKTEST(r!=(int)messageSize, "ringBuffer : LZ4_decompress_safe_continue() test failed");
+                }
 
                 XXH64_update(&xxhNewSafe, testVerify + dNext, messageSize);
                 { U64 const crcNew = XXH64_digest(&xxhNewSafe);
@@ -1295,6 +1462,84 @@ static void FUZ_unitTests(int compressionLevel)
                 if (rNext + messageSize > ringBufferSize) rNext = 0;
                 if (dNext + messageSize > dBufferSize) dNext = 0;
         }   }
+
+        DISPLAYLEVEL(3, "streaming with runtime selected table size : ");
+        {   static const int memUsages[] = { LZ4_MEMORY_USAGE_MIN, 12, 18, LZ4_MEMORY_USAGE_MAX };
+            size_t const segSize = 8 KB;
+            size_t m;
+            int result;
+            assert(4*segSize <= testInputSize);
+            assert(64 KB < testCompressedSize);
+            FUZ_CHECKTEST(LZ4_sizeofStream_advanced(LZ4_MEMORY_USAGE_MIN-1) != 0, "memoryUsage too small should be rejected");
+            FUZ_CHECKTEST(LZ4_sizeofStream_advanced(LZ4_MEMORY_USAGE_MAX+1) != 0, "memoryUsage too large should be rejected");
+            FUZ_CHECKTEST(LZ4_sizeofStream_advanced(LZ4_MEMORY_USAGE) > (int)sizeof(LZ4_stream_t),
+                        "default size table should fit into LZ4_stream_t");
+            for (m = 0; m < sizeof(memUsages)/sizeof(memUsages[0]); m++) {
+                int const stateSize = LZ4_sizeofStream_advanced(memUsages[m]);
+                void* const dictState = malloc((size_t)stateSize);
+                void* const workState = malloc((size_t)stateSize);
+                LZ4_stream_t* dictCtx;
+                LZ4_stream_t* workCtx;
+                assert(dictState != NULL); assert(workState != NULL);
+                FUZ_CHECKTEST(LZ4_initStream_advanced(workState, (size_t)stateSize-1, memUsages[m]) != NULL,
+                            "insufficient state size should be rejected");
+                dictCtx = LZ4_initStream_advanced(dictState, (size_t)stateSize, memUsages[m]);
+                workCtx = LZ4_initStream_advanced(workState, (size_t)stateSize, memUsages[m]);
+                FUZ_CHECKTEST(dictCtx==NULL || workCtx==NULL, "LZ4_initStream_advanced() failed");
+                /* dictionary, then 2 consecutive blocks */
+                {   LZ4_streamDecode_t sd;
+                    size_t n;
+                    LZ4_resetStream_fast(workCtx);
+                    LZ4_loadDict(workCtx, testInput, (int)segSize);
+                    LZ4_setStreamDecode(&sd, testInput, (int)segSize);
+                    for (n = 1; n < 3; n++) {
+                        int const cSize = LZ4_compress_fast_continue(workCtx, testInput + n*segSize, testCompressed, (int)segSize, testCompressedSize, 1);
+                        FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_continue() failed (memoryUsage=%i)", memUsages[m]);
+                        result = LZ4_decompress_safe_continue(&sd, testCompressed, testVerify + n*segSize, cSize, (int)segSize);
+                        FUZ_CHECKTEST(result != (int)segSize, "LZ4_decompress_safe_continue() failed with runtime table size");
+                    }
+                    FUZ_CHECKTEST(memcmp(testInput + segSize, testVerify + segSize, 2*segSize),
+                                "corruption with runtime table size (memoryUsage=%i)", memUsages[m]);
+                }
+                /* attached dictionary, of same and of default table size */
+                {   int d, cSize;
+                    for (d = 0; d < 2; d++) {
+                        LZ4_stream_t* const attached = d ? &streamingState : dictCtx;
+                        if (d) LZ4_initStream(&streamingState, sizeof(streamingState));
+                        else LZ4_resetStream_fast(dictCtx);
+                        LZ4_loadDict(attached, testInput, (int)segSize);
+                        LZ4_resetStream_fast(workCtx);
+                        LZ4_attach_dictionary(workCtx, attached);
+                        cSize = LZ4_compress_fast_continue(workCtx, testInput + 3*segSize, testCompressed, (int)segSize, testCompressedSize, 1);
+                        FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_continue() with attached dictionary failed");
+                        result = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, (int)segSize, testInput, (int)segSize);
+                        FUZ_CHECKTEST(result != (int)segSize || memcmp(testInput + 3*segSize, testVerify, segSize),
+                                    "corruption with attached dictionary (memoryUsage=%i, default dict=%i)", memUsages[m], d);
+                    }
+                    /* runtime table size dictionary attached to a default state */
+                    LZ4_resetStream_fast(dictCtx);
+                    LZ4_loadDict(dictCtx, testInput, (int)segSize);
+                    LZ4_initStream(&streamingState, sizeof(streamingState));
+                    LZ4_attach_dictionary(&streamingState, dictCtx);
+                    cSize = LZ4_compress_fast_continue(&streamingState, testInput + 3*segSize, testCompressed, (int)segSize, testCompressedSize, 1);
+                    result = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, (int)segSize, testInput, (int)segSize);
+                    FUZ_CHECKTEST(cSize==0 || result != (int)segSize || memcmp(testInput + 3*segSize, testVerify, segSize),
+                                "corruption with attached runtime table size dictionary (memoryUsage=%i)", memUsages[m]);
+                }
+                /* one-shot compression, small (byU16) and large (byU32) inputs */
+                {   int const srcSizes[] = { (int)segSize, (int)(64 KB) };
+                    int n;
+                    for (n = 0; n < 2; n++) {
+                        int const cSize = LZ4_compress_fast_extState_fastReset(workCtx, testInput, testCompressed, srcSizes[n], testCompressedSize, 1);
+                        FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_extState_fastReset() failed with runtime table size");
+                        result = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSizes[n]);
+                        FUZ_CHECKTEST(result != srcSizes[n] || memcmp(testInput, testVerify, (size_t)srcSizes[n]),
+                                    "one-shot compression corrupted with runtime table size (memoryUsage=%i)", memUsages[m]);
+                }   }
+                free(dictState);
+                free(workState);
+        }   }
+        DISPLAYLEVEL(3, " OK \n");
     }
 
     DISPLAYLEVEL(3, "LZ4_initStreamHC with multiple valid alignments : ");
@@ -1319,6 +1564,427 @@ static void FUZ_unitTests(int compressionLevel)
     }
     DISPLAYLEVEL(3, "all inits OK \n");
 
+    DISPLAYLEVEL(3, "batch compression of independent inputs : ");
+    {   static const int srcSizes[] = { 0, 1, 200, 4 KB, 13, 70 KB, 1000, 300 };
+        enum { nbInputs = sizeof(srcSizes) / sizeof(srcSizes[0]) };
+        const char* srcs[nbInputs];
+        char* dsts[nbInputs];
+        int dstCapacities[nbInputs];
+        int cSizes[nbInputs];
+        LZ4_stream_t* const refCtx = LZ4_createStream();
+        LZ4_stream_t* const batchCtx = LZ4_createStream();
+        LZ4_streamHC_t* const refHC = LZ4_createStreamHC();
+        LZ4_streamHC_t* const batchHC = LZ4_createStreamHC();
+        char* const decoded = (char*)malloc(70 KB);
+        int hc;
+        assert(refCtx != NULL); assert(batchCtx != NULL);
+        assert(refHC != NULL); assert(batchHC != NULL); assert(decoded != NULL);
+        {   size_t n, pos = 0;
+            for (n = 0; n < nbInputs; n++) {
+                srcs[n] = testInput + n * 997;
+                dsts[n] = testCompressed + pos;
+                dstCapacities[n] = (n == 6) ? 10 : LZ4_compressBound(srcSizes[n]);   /* input 6 must fail */
+                pos += (size_t)dstCapacities[n];
+            }
+            assert(pos <= testCompressedSize);
+        }
+        for (hc = 0; hc < 2; hc++) {
+            int const nbCompressed = hc ? LZ4_compress_HC_batch(batchHC, srcs, srcSizes, dsts, dstCapacities, cSizes, nbInputs, 9)
+                                        : LZ4_compress_fast_batch(batchCtx, srcs, srcSizes, dsts, dstCapacities, cSizes, nbInputs, 1);
+            size_t n;
+            FUZ_CHECKTEST(nbCompressed != nbInputs-1, "batch compression should compress all inputs but one (%i)", nbCompressed);
+            for (n = 0; n < nbInputs; n++) {
+                /* same result as one call per input on a state with same history */
+                int const refSize = hc ? LZ4_compress_HC_extStateHC_fastReset(refHC, srcs[n], testVerify, srcSizes[n], dstCapacities[n], 9)
+                                       : LZ4_compress_fast_extState_fastReset(refCtx, srcs[n], testVerify, srcSizes[n], dstCapacities[n], 1);
+                FUZ_CHECKTEST(cSizes[n] != refSize || memcmp(dsts[n], testVerify, (size_t)refSize),
+                            "batch compression differs from single input compression (input %u, hc=%i)", (unsigned)n, hc);
+                if (n == 6) {
+                    FUZ_CHECKTEST(cSizes[n] != 0, "input 6 should have failed, due to insufficient capacity");
+                    continue;
+                }
+                {   int const r = LZ4_decompress_safe(dsts[n], decoded, cSizes[n], srcSizes[n]);
+                    FUZ_CHECKTEST(r != srcSizes[n] || memcmp(srcs[n], decoded, (size_t)srcSizes[n]),
+                                "batch compression corrupted input %u (hc=%i)", (unsigned)n, hc);
+        }   }   }
+        FUZ_CHECKTEST(LZ4_compress_fast_batch((char*)batchCtx + 1, srcs, srcSizes, dsts, dstCapacities, cSizes, nbInputs, 1) != 0,
+                    "misaligned state should be rejected");
+        LZ4_freeStream(refCtx);
+        LZ4_freeStream(batchCtx);
+        LZ4_freeStreamHC(refHC);
+        LZ4_freeStreamHC(batchHC);
+        free(decoded);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_compress_HC_parallel : ");
+    {   /* compressible, then incompressible, then compressible again */
+        int const srcSize = 1300 KB;
+        int const bound = LZ4_compressBound(srcSize) + 16 * 4;
+        char* const src = (char*)malloc((size_t)srcSize);
+        char* const dst = (char*)malloc((size_t)bound);
+        char* const ref = (char*)malloc((size_t)bound);
+        char* const decoded = (char*)malloc((size_t)srcSize);
+        void* states[4];
+        FUZ_deferredJobs_t deferred;
+        LZ4HC_Executor executor;
+        static const int levels[] = { 2, 9, 12 };
+        size_t l;
+        int n;
+        assert(src != NULL); assert(dst != NULL); assert(ref != NULL); assert(decoded != NULL);
+        FUZ_fillCompressibleNoiseBuffer(src, 600 KB, 0.50, &randState);
+        for (n = (int)(600 KB); n < (int)(900 KB); n++) src[n] = (char)FUZ_rand(&randState);
+        FUZ_fillCompressibleNoiseBuffer(src + 900 KB, 400 KB, 0.60, &randState);
+        for (n = 0; n < 4; n++) { states[n] = malloc((size_t)LZ4_sizeofStateHC()); assert(states[n] != NULL); }
+        deferred.nbJobs = 0;
+        executor.submitJob = FUZ_deferJob;
+        executor.completeJobs = FUZ_runDeferredJobs;
+        executor.opaqueState = &deferred;
+        for (l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+            int const refSize = LZ4_compress_HC(src, ref, srcSize, bound, levels[l]);
+            int const cSize = LZ4_compress_HC_parallel(states, 4, src, dst, srcSize, bound, levels[l], NULL);
+            FUZ_CHECKTEST(cSize <= 0, "LZ4_compress_HC_parallel() failed (level %i)", levels[l]);
+            FUZ_CHECKTEST(LZ4_decompress_safe(dst, decoded, cSize, srcSize) != srcSize || memcmp(src, decoded, (size_t)srcSize),
+                        "LZ4_compress_HC_parallel() corrupted input (level %i)", levels[l]);
+            FUZ_CHECKTEST(cSize > refSize + refSize / 100, "LZ4_compress_HC_parallel() compresses too poorly : %i vs %i (level %i)", cSize, refSize, levels[l]);
+            /* result doesn't depend on scheduling : here, jobs run in reverse order */
+            memcpy(ref, dst, (size_t)cSize);
+            FUZ_CHECKTEST(LZ4_compress_HC_parallel(states, 4, src, dst, srcSize, bound, levels[l], &executor) != cSize
+                        || memcmp(ref, dst, (size_t)cSize), "result depends on job scheduling (level %i)", levels[l]);
+            /* dst too small for reserved slots : uses a temporary buffer */
+            FUZ_CHECKTEST(LZ4_compress_HC_parallel(states, 4, src, dst, srcSize, cSize, levels[l], NULL) != cSize
+                        || memcmp(ref, dst, (size_t)cSize), "LZ4_compress_HC_parallel() fails with exact capacity (level %i)", levels[l]);
+            FUZ_CHECKTEST(LZ4_compress_HC_parallel(states, 4, src, dst, srcSize, cSize - 1, levels[l], NULL) != 0,
+                        "LZ4_compress_HC_parallel() should fail when dst is too small (level %i)", levels[l]);
+        }
+        /* small inputs are not cut : same as LZ4_compress_HC_extStateHC() */
+        {   int const refSize = LZ4_compress_HC(src, ref, 100 KB, bound, 9);
+            FUZ_CHECKTEST(LZ4_compress_HC_parallel(states, 4, src, dst, 100 KB, bound, 9, &executor) != refSize
+                        || memcmp(ref, dst, (size_t)refSize), "small input should be compressed as a single segment");
+        }
+        for (n = 0; n < 4; n++) free(states[n]);
+        free(src);
+        free(dst);
+        free(ref);
+        free(decoded);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_setWorkLimitHC : ");
+    {   int const srcSize = 512 KB;
+        int const bound = LZ4_compressBound(srcSize);
+        char* const src = (char*)malloc((size_t)srcSize);
+        char* const dst = (char*)malloc((size_t)bound);
+        char* const ref = (char*)malloc((size_t)bound);
+        char* const decoded = (char*)malloc((size_t)srcSize);
+        LZ4_streamHC_t* const sHC = LZ4_createStreamHC();
+        static const int levels[] = { 9, 12 };
+        size_t l;
+        int n;
+        assert(src != NULL); assert(dst != NULL); assert(ref != NULL); assert(decoded != NULL); assert(sHC != NULL);
+        for (l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+            int refSize, cSize;
+            /* typical data : unaffected by default limit */
+            FUZ_fillCompressibleNoiseBuffer(src, (size_t)srcSize, 0.50, &randState);
+            LZ4_resetStreamHC_fast(sHC, levels[l]);
+            LZ4_setWorkLimitHC(sHC, 255);
+            refSize = LZ4_compress_HC_continue(sHC, src, ref, srcSize, bound);
+            LZ4_resetStreamHC_fast(sHC, levels[l]);
+            LZ4_setWorkLimitHC(sHC, 0);
+            cSize = LZ4_compress_HC_continue(sHC, src, dst, srcSize, bound);
+            FUZ_CHECKTEST(cSize != refSize || memcmp(ref, dst, (size_t)cSize), "default work limit changed output on typical data (level %i)", levels[l]);
+            /* tiny alphabet : limit triggers */
+            for (n = 0; n < srcSize; n++) src[n] = (char)('a' + FUZ_rand(&randState) % 4);
+            LZ4_resetStreamHC_fast(sHC, levels[l]);
+            LZ4_setWorkLimitHC(sHC, 255);
+            refSize = LZ4_compress_HC_continue(sHC, src, ref, srcSize, bound);
+            LZ4_resetStreamHC_fast(sHC, levels[l]);
+            LZ4_setWorkLimitHC(sHC, 1);
+            cSize = LZ4_compress_HC_continue(sHC, src, dst, srcSize, bound);
+            FUZ_CHECKTEST(cSize <= 0, "compression failed with work limit (level %i)", levels[l]);
+            FUZ_CHECKTEST(LZ4_decompress_safe(dst, decoded, cSize, srcSize) != srcSize || memcmp(src, decoded, (size_t)srcSize),
+                        "work limit corrupted output (level %i)", levels[l]);
+            FUZ_CHECKTEST(cSize == refSize && !memcmp(ref, dst, (size_t)cSize), "work limit should have reduced search (level %i)", levels[l]);
+        }
+        LZ4_freeStreamHC(sHC);
+        free(src);
+        free(dst);
+        free(ref);
+        free(decoded);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_compress_HC_continue_budget with work limit : ");
+    {   int const srcSize = 512 KB;
+        int const bound = LZ4_compressBound(srcSize);
+        char* const src = (char*)malloc((size_t)srcSize);
+        char* const dst = (char*)malloc((size_t)bound);
+        char* const ref = (char*)malloc((size_t)bound);
+        char* const decoded = (char*)malloc((size_t)srcSize);
+        LZ4_streamHC_t* const sHC = LZ4_createStreamHC();
+        static const int levels[] = { 3, 6, 9, 10, 12 };
+        static const int budgets[] = { 1 KB, 64 KB };
+        size_t l, b;
+        int n;
+        assert(src != NULL); assert(dst != NULL); assert(ref != NULL); assert(decoded != NULL); assert(sHC != NULL);
+        /* tiny alphabet : limit triggers */
+        for (n = 0; n < srcSize; n++) src[n] = (char)('a' + FUZ_rand(&randState) % 4);
+        for (l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+            for (b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+                LZ4HC_resume_t resume;
+                int refSize, cSize, nbCalls = 0;
+                LZ4_resetStreamHC_fast(sHC, levels[l]);
+                LZ4_setWorkLimitHC(sHC, 1);
+                refSize = LZ4_compress_HC_continue(sHC, src, ref, srcSize, bound);
+                FUZ_CHECKTEST(refSize <= 0, "compression failed with work limit (level %i)", levels[l]);
+                memset(&resume, 0, sizeof(resume));
+                LZ4_resetStreamHC_fast(sHC, levels[l]);
+                LZ4_setWorkLimitHC(sHC, 1);
+                do {
+                    const void* const wksp = resume.optWksp;
+                    cSize = LZ4_compress_HC_continue_budget(sHC, src, dst, srcSize, bound, &resume, budgets[b]);
+                    nbCalls++;
+                    /* parser workspace is allocated once per block, then kept across invocations */
+                    FUZ_CHECKTEST(cSize < 0 && wksp != NULL && resume.optWksp != wksp,
+                                "parser workspace reallocated while resuming (level %i, budget %i)", levels[l], budgets[b]);
+                    FUZ_CHECKTEST(cSize < 0 && (levels[l] >= LZ4HC_CLEVEL_OPT_MIN) != (resume.optWksp != NULL),
+                                "parser workspace not kept while suspended (level %i, budget %i)", levels[l], budgets[b]);
+                } while (cSize < 0);
+                FUZ_CHECKTEST(cSize <= 0, "budgeted compression failed (level %i, budget %i)", levels[l], budgets[b]);
+                FUZ_CHECKTEST(nbCalls < 2, "block not interrupted (level %i, budget %i)", levels[l], budgets[b]);
+                FUZ_CHECKTEST(LZ4_decompress_safe(dst, decoded, cSize, srcSize) != srcSize || memcmp(src, decoded, (size_t)srcSize),
+                            "budgeted compression corrupted output (level %i, budget %i)", levels[l], budgets[b]);
+                FUZ_CHECKTEST(cSize != refSize || memcmp(ref, dst, (size_t)cSize),
+                            "budgeted output differs from LZ4_compress_HC_continue() (level %i, budget %i)", levels[l], budgets[b]);
+                FUZ_CHECKTEST(resume.srcPos != 0 || resume.workBlockSpent != 0 || resume.optWksp != NULL,
+                            "resume state not reset after block (level %i)", levels[l]);
+        }   }
+        /* block abandoned while suspended : workspace released */
+        {   LZ4HC_resume_t resume;
+            memset(&resume, 0, sizeof(resume));
+            LZ4_resetStreamHC_fast(sHC, LZ4HC_CLEVEL_MAX);
+            FUZ_CHECKTEST(LZ4_compress_HC_continue_budget(sHC, src, dst, srcSize, bound, &resume, 1 KB) >= 0, "block not interrupted");
+            FUZ_CHECKTEST(resume.optWksp == NULL, "parser workspace not kept while suspended");
+            LZ4HC_resume_release(&resume);
+            FUZ_CHECKTEST(resume.srcPos != 0 || resume.optWksp != NULL, "resume state not reset after release");
+            LZ4HC_resume_release(&resume);   /* no block in progress : no-op */
+        }
+        LZ4_freeStreamHC(sHC);
+        free(src);
+        free(dst);
+        free(ref);
+        free(decoded);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "optimal parser statistics : ");
+    {   int const srcSize = 256 KB;
+        int const bound = LZ4_compressBound(srcSize);
+        char* const src = (char*)malloc((size_t)srcSize);
+        char* const dst = (char*)malloc((size_t)bound);
+        LZ4HC_optStats_t st, zero;
+        int collected;
+        assert(src != NULL); assert(dst != NULL);
+        memset(&zero, 0, sizeof(zero));
+        FUZ_fillCompressibleNoiseBuffer(src, (size_t)srcSize, 0.50, &randState);
+        LZ4_resetOptimalParserStats();
+        FUZ_CHECKTEST(LZ4_compress_HC(src, dst, srcSize, bound, LZ4HC_CLEVEL_MAX) <= 0, "LZ4_compress_HC() failed");
+        collected = LZ4_getOptimalParserStats(&st);
+        if (collected) {
+            FUZ_CHECKTEST(st.srcSize != (unsigned long long)srcSize, "optimal parser counted %llu input bytes instead of %i", st.srcSize, srcSize);
+            FUZ_CHECKTEST(st.nbSearches == 0 || st.nbCandidates == 0 || st.nbParses == 0, "optimal parser activity not counted");
+            FUZ_CHECKTEST(st.parsedLength > st.srcSize, "optimal parses longer than input");
+            FUZ_CHECKTEST(st.nbSufficientExits + st.nbWindowEnds > st.nbParses, "more parses cut short than parses");
+            /* levels below LZ4HC_CLEVEL_OPT_MIN don't employ the optimal parser */
+            LZ4_resetOptimalParserStats();
+            FUZ_CHECKTEST(LZ4_compress_HC(src, dst, srcSize, bound, 9) <= 0, "LZ4_compress_HC() failed");
+            (void)LZ4_getOptimalParserStats(&st);
+            FUZ_CHECKTEST(st.srcSize || st.nbSearches || st.nbParses, "optimal parser activity counted at level 9");
+        } else {
+            FUZ_CHECKTEST(memcmp(&st, &zero, sizeof(st)), "optimal parser statistics not collected, but not zeroed");
+        }
+        free(src);
+        free(dst);
+        DISPLAYLEVEL(3, collected ? "OK \n" : "OK (not collected) \n");
+    }
+
+    DISPLAYLEVEL(3, "batch decompression of independent blocks : ");
+    {   static const int srcSizes[] = { 0, 1, 200, 4 KB, 13, 70 KB, 1000, 300 };
+        enum { nbBlocks = sizeof(srcSizes) / sizeof(srcSizes[0]) };
+        const char* srcs[nbBlocks];
+        char* cBlocks[nbBlocks];
+        int cCapacities[nbBlocks];
+        int cSizes[nbBlocks];
+        char* dsts[nbBlocks];
+        int dstCapacities[nbBlocks];
+        int results[nbBlocks];
+        LZ4_stream_t* const ctx = LZ4_createStream();
+        size_t n;
+        assert(ctx != NULL);
+        {   size_t cPos = 0, dPos = 0;
+            for (n = 0; n < nbBlocks; n++) {
+                srcs[n] = testInput + n * 997;
+                cBlocks[n] = testCompressed + cPos;
+                cCapacities[n] = LZ4_compressBound(srcSizes[n]);
+                cPos += (size_t)cCapacities[n];
+                dsts[n] = testVerify + dPos;
+                dstCapacities[n] = srcSizes[n];
+                dPos += (size_t)srcSizes[n];
+            }
+            assert(cPos <= testCompressedSize);
+            assert(dPos <= testInputSize);
+        }
+        FUZ_CHECKTEST(LZ4_compress_fast_batch(ctx, srcs, srcSizes, cBlocks, cCapacities, cSizes, nbBlocks, 1) != nbBlocks,
+                    "batch compression failed");
+        FUZ_CHECKTEST(LZ4_decompress_safe_batch((const char* const*)cBlocks, cSizes, dsts, dstCapacities, nbBlocks, results) != nbBlocks,
+                    "batch decompression failed");
+        for (n = 0; n < nbBlocks; n++) {
+            FUZ_CHECKTEST(results[n] != srcSizes[n] || memcmp(srcs[n], dsts[n], (size_t)srcSizes[n]),
+                        "batch decompression corrupted block %u", (unsigned)n);
+        }
+        /* block 3 is truncated, block 6 doesn't fit : both must fail, without affecting other blocks */
+        cSizes[3] -= 1;
+        dstCapacities[6] -= 1;
+        FUZ_CHECKTEST(LZ4_decompress_safe_batch((const char* const*)cBlocks, cSizes, dsts, dstCapacities, nbBlocks, results) != nbBlocks-2,
+                    "batch decompression should decode all blocks but two");
+        for (n = 0; n < nbBlocks; n++) {
+            if (n == 3 || n == 6) {
+                FUZ_CHECKTEST(results[n] >= 0, "block %u should have been rejected", (unsigned)n);
+                continue;
+            }
+            FUZ_CHECKTEST(results[n] != srcSizes[n] || memcmp(srcs[n], dsts[n], (size_t)srcSizes[n]),
+                        "batch decompression corrupted block %u", (unsigned)n);
+        }
+        /* corrupted blocks, mixed with valid ones : each result is the one of a single block decompression */
+        {   char* const single = (char*)malloc(70 KB);
+            int round;
+            assert(single != NULL);
+            cSizes[3] += 1;
+            dstCapacities[6] += 1;
+            for (round = 0; round < 20; round++) {
+                int nbValid = 0, nbDecoded;
+                for (n = 0; n < nbBlocks; n++) {
+                    if (cSizes[n] > 0 && (FUZ_rand(&randState) & 1)) {
+                        int const pos = (int)(FUZ_rand(&randState) % (U32)cSizes[n]);
+                        cBlocks[n][pos] ^= (char)(1 + FUZ_rand(&randState) % 255);
+                }   }
+                nbDecoded = LZ4_decompress_safe_batch((const char* const*)cBlocks, cSizes, dsts, dstCapacities, nbBlocks, results);
+                for (n = 0; n < nbBlocks; n++) {
+                    int const r = LZ4_decompress_safe(cBlocks[n], single, cSizes[n], dstCapacities[n]);
+                    FUZ_CHECKTEST(results[n] != r, "batch result differs from single block result (block %u : %i != %i)",
+                                (unsigned)n, results[n], r);
+                    FUZ_CHECKTEST(r > 0 && memcmp(single, dsts[n], (size_t)r), "batch output differs from single block output (block %u)", (unsigned)n);
+                    nbValid += (r >= 0);
+                }
+                FUZ_CHECKTEST(nbDecoded != nbValid, "batch decompression count is wrong (%i != %i)", nbDecoded, nbValid);
+            }
+            free(single);
+        }
+        LZ4_freeStream(ctx);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "dictionary training : ");
+    {   enum { nbSamples = 200, sampleMax = 256 };
+        static const char* const types[] = { "page_view", "click", "add_to_cart", "search" };
+        char* const samples = (char*)malloc(nbSamples * sampleMax);
+        int sampleSizes[nbSamples];
+        char dict[4 KB];
+        char event[sampleMax];
+        char compressed[LZ4_COMPRESSBOUND(sampleMax)];
+        char decoded[sampleMax];
+        U32 sampleRand = 1;
+        size_t pos = 0;
+        int n, dictSize;
+        assert(samples != NULL);
+        for (n = 0; n <= nbSamples; n++) {
+            char* const dst = (n < nbSamples) ? samples + pos : event;
+            int const len = sprintf(dst, "{\"id\":%u,\"type\":\"%s\",\"user\":{\"id\":%u,\"locale\":\"en-US\"},\"client\":\"Mozilla/5.0 (X11; Linux x86_64)\",\"duration_ms\":%u}",
+                                    FUZ_rand(&sampleRand), types[FUZ_rand(&sampleRand) % 4], FUZ_rand(&sampleRand) % 100000, FUZ_rand(&sampleRand) % 60000);
+            assert(len < sampleMax);
+            if (n < nbSamples) { sampleSizes[n] = len; pos += (size_t)len; }
+        }
+        dictSize = LZ4_trainDictionary(dict, sizeof(dict), samples, sampleSizes, nbSamples);
+        FUZ_CHECKTEST(dictSize <= 0 || dictSize > (int)sizeof(dict), "LZ4_trainDictionary() failed (%i)", dictSize);
+        {   LZ4_stream_t* const ctx = LZ4_createStream();
+            int const eventSize = (int)strlen(event);
+            int const cSizeNoDict = LZ4_compress_default(event, compressed, eventSize, (int)sizeof(compressed));
+            int cSize, dSize;
+            assert(ctx != NULL);
+            LZ4_loadDict(ctx, dict, dictSize);
+            cSize = LZ4_compress_fast_continue(ctx, event, compressed, eventSize, (int)sizeof(compressed), 1);
+            FUZ_CHECKTEST(cSize <= 0 || cSize * 2 > cSizeNoDict, "trained dictionary is not effective (%i vs %i)", cSize, cSizeNoDict);
+            dSize = LZ4_decompress_safe_usingDict(compressed, decoded, cSize, (int)sizeof(decoded), dict, dictSize);
+            FUZ_CHECKTEST(dSize != eventSize || memcmp(event, decoded, (size_t)eventSize), "decompression with trained dictionary failed");
+            LZ4_freeStream(ctx);
+        }
+        /* samples too short to contain any repetition can't produce a dictionary */
+        for (n = 0; n < nbSamples; n++) sampleSizes[n] = 4;
+        FUZ_CHECKTEST(LZ4_trainDictionary(dict, sizeof(dict), samples, sampleSizes, nbSamples) != 0,
+                    "tiny samples should not produce a dictionary");
+        FUZ_CHECKTEST(LZ4_trainDictionary(dict, sizeof(dict), samples, sampleSizes, 0) != 0,
+                    "training without samples should fail");
+        FUZ_CHECKTEST(LZ4_trainDictionary(dict, 0, samples, sampleSizes, nbSamples) != 0,
+                    "training into an empty dictionary should fail");
+        free(samples);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "compressed page store : ");
+    {   enum { pageSize = 4 KB, nbPages = 24 };
+        LZ4_pageStore* const store = LZ4_createPageStore(pageSize, nbPages, 2, 1);
+        char* const pages = (char*)malloc(nbPages * pageSize);
+        char page[pageSize];
+        LZ4_pageStoreStats stats, emptyStats;
+        size_t n, i;
+        FUZ_CHECKTEST(store == NULL || pages == NULL, "LZ4_createPageStore() failed");
+        /* one page out of 3 is incompressible */
+        for (n = 0; n < nbPages; n++) {
+            char* const p = pages + n * pageSize;
+            if (n % 3 == 2) { for (i = 0; i < pageSize; i++) p[i] = (char)FUZ_rand(&randState); }
+            else FUZ_fillCompressibleNoiseBuffer(p, pageSize, 0.60, &randState);
+        }
+        LZ4_pageStore_getStats(store, &emptyStats);
+        FUZ_CHECKTEST(emptyStats.nbPages != 0 || emptyStats.memoryUsed == 0, "empty store statistics are wrong");
+        for (n = 0; n < nbPages; n++) {
+            int const r = LZ4_pageStore_put(store, n, pages + n * pageSize);
+            FUZ_CHECKTEST(r <= 0 || r > pageSize, "LZ4_pageStore_put() failed on page %u", (unsigned)n);
+            FUZ_CHECKTEST((n % 3 == 2) != (r == pageSize), "page %u : wrong storage mode (%i bytes)", (unsigned)n, r);
+        }
+        LZ4_pageStore_getStats(store, &stats);
+        FUZ_CHECKTEST(stats.nbPages != nbPages || stats.nbRawPages != nbPages / 3, "wrong page count");
+        FUZ_CHECKTEST(stats.storedSize >= nbPages * pageSize, "pages are not compressed");
+        for (n = nbPages; n-- > 0; ) {
+            FUZ_CHECKTEST(LZ4_pageStore_get(store, n, page) != pageSize, "LZ4_pageStore_get() failed on page %u", (unsigned)n);
+            FUZ_CHECKTEST(memcmp(page, pages + n * pageSize, pageSize), "page %u is corrupted", (unsigned)n);
+        }
+        /* overwrite : page 1 becomes incompressible, page 2 compressible */
+        FUZ_CHECKTEST(LZ4_pageStore_put(store, 1, pages + 2 * pageSize) != pageSize, "overwrite failed");
+        FUZ_CHECKTEST(LZ4_pageStore_put(store, 2, pages) <= 0, "overwrite failed");
+        FUZ_CHECKTEST(LZ4_pageStore_get(store, 1, page) != pageSize || memcmp(page, pages + 2 * pageSize, pageSize), "overwritten page 1 is corrupted");
+        FUZ_CHECKTEST(LZ4_pageStore_get(store, 2, page) != pageSize || memcmp(page, pages, pageSize), "overwritten page 2 is corrupted");
+        LZ4_pageStore_getStats(store, &stats);
+        FUZ_CHECKTEST(stats.nbPages != nbPages || stats.nbRawPages != nbPages / 3, "wrong page count after overwrite");
+        /* discard */
+        FUZ_CHECKTEST(LZ4_pageStore_discard(store, 3) != 1, "LZ4_pageStore_discard() failed");
+        FUZ_CHECKTEST(LZ4_pageStore_discard(store, 3) != 0, "page 3 should be empty");
+        memset(page, 0x5A, pageSize);
+        FUZ_CHECKTEST(LZ4_pageStore_get(store, 3, page) != 0 || page[0] != 0x5A, "empty page should not be read");
+        FUZ_CHECKTEST(LZ4_pageStore_get(store, nbPages, page) >= 0, "out of range page should fail");
+        FUZ_CHECKTEST(LZ4_pageStore_put(store, nbPages, page) != 0, "out of range page should fail");
+        FUZ_CHECKTEST(LZ4_pageStore_discard(store, nbPages) >= 0, "out of range page should fail");
+        for (n = 0; n < nbPages; n++) LZ4_pageStore_discard(store, n);
+        LZ4_pageStore_getStats(store, &stats);
+        FUZ_CHECKTEST(stats.nbPages != 0 || stats.storedSize != 0, "store should be empty");
+        /* each class keeps at most one spare slab, of at most 4 pages */
+        FUZ_CHECKTEST(stats.memoryUsed > emptyStats.memoryUsed + (17 * 4 + 1) * pageSize, "slabs are not released");
+        FUZ_CHECKTEST(LZ4_createPageStore(3000, nbPages, 1, 1) != NULL, "page size must be a power of 2");
+        FUZ_CHECKTEST(LZ4_createPageStore(pageSize, 0, 1, 1) != NULL, "store can't be empty");
+        LZ4_freePageStore(store);
+        free(pages);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
     /* LZ4 HC streaming tests */
     {   LZ4_streamHC_t sHC;   /* statically allocated */
         int result;
@@ -1412,6 +2078,255 @@ static void FUZ_unitTests(int compressionLevel)
         }   }
         DISPLAYLEVEL(3, " OK \n");
 
+        /* low-entropy input : long hash chains trigger the binary tree match finder */
+        DISPLAYLEVEL(3, "HC max level streaming on low-entropy input : ");
+        {   size_t const segSize = 64 KB;
+            char* const src = (char*)malloc(2*segSize);
+            char* const segCopy = (char*)malloc(segSize);   /* not contiguous : first segment becomes extDict */
+            LZ4_streamDecode_t sd;
+            size_t n;
+            assert(src != NULL); assert(segCopy != NULL);
+            for (n = 0; n < 2*segSize; n++) src[n] = "ACGT"[FUZ_rand(&randState) & 3];
+            memcpy(segCopy, src + segSize, segSize);
+            LZ4_resetStreamHC_fast(&sHC, LZ4HC_CLEVEL_MAX);
+            LZ4_setStreamDecode(&sd, NULL, 0);
+            {   int const cSize = LZ4_compress_HC_continue(&sHC, src, testCompressed, (int)segSize, testCompressedSize);
+                FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_continue() failed on first segment");
+                FUZ_CHECKTEST(LZ4_decompress_safe_continue(&sd, testCompressed, testVerify, cSize, (int)segSize) != (int)segSize,
+                            "LZ4_decompress_safe_continue() failed on first segment");
+            }
+            {   int const cSize = LZ4_compress_HC_continue(&sHC, segCopy, testCompressed, (int)segSize, testCompressedSize);
+                FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_continue() failed on second segment");
+                FUZ_CHECKTEST(LZ4_decompress_safe_continue(&sd, testCompressed, testVerify + segSize, cSize, (int)segSize) != (int)segSize,
+                            "LZ4_decompress_safe_continue() failed on second segment");
+            }
+            FUZ_CHECKTEST(memcmp(src, testVerify, 2*segSize), "HC max level streaming : corruption");
+            free(src);
+            free(segCopy);
+        }
+        DISPLAYLEVEL(3, " OK \n");
+
+        DISPLAYLEVEL(3, "HC streaming with reduced tables : ");
+        {   static const int logs[][2] = { { 8, 8 }, { 10, 11 }, { 15, 12 } };
+            static const int levels[] = { 2, 4, 9, 12 };
+            size_t const segSize = 8 KB;
+            size_t l, c;
+            assert(4*segSize <= testInputSize);
+            FUZ_CHECKTEST(LZ4_sizeofStreamHC_advanced(LZ4HC_HASHLOG_MIN-1, 12) != 0, "hashLog too small should be rejected");
+            FUZ_CHECKTEST(LZ4_sizeofStreamHC_advanced(12, LZ4HC_DICTIONARY_LOGSIZE+1) != 0, "chainLog too large should be rejected");
+            FUZ_CHECKTEST(LZ4_sizeofStreamHC_advanced(LZ4HC_HASH_LOG, LZ4HC_DICTIONARY_LOGSIZE) > (int)sizeof(LZ4_streamHC_t),
+                        "full size tables should fit into LZ4_streamHC_t");
+            for (l = 0; l < sizeof(logs)/sizeof(logs[0]); l++) {
+                int const stateSize = LZ4_sizeofStreamHC_advanced(logs[l][0], logs[l][1]);
+                void* const dictState = malloc((size_t)stateSize);
+                void* const workState = malloc((size_t)stateSize);
+                LZ4_streamHC_t* dictHC;
+                LZ4_streamHC_t* workHC;
+                assert(dictState != NULL); assert(workState != NULL);
+                FUZ_CHECKTEST(LZ4_initStreamHC_advanced(workState, (size_t)stateSize-1, logs[l][0], logs[l][1]) != NULL,
+                            "insufficient state size should be rejected");
+                dictHC = LZ4_initStreamHC_advanced(dictState, (size_t)stateSize, logs[l][0], logs[l][1]);
+                workHC = LZ4_initStreamHC_advanced(workState, (size_t)stateSize, logs[l][0], logs[l][1]);
+                FUZ_CHECKTEST(dictHC==NULL || workHC==NULL, "LZ4_initStreamHC_advanced() failed");
+                for (c = 0; c < sizeof(levels)/sizeof(levels[0]); c++) {
+                    /* dictionary, then 2 consecutive blocks */
+                    {   LZ4_streamDecode_t sd;
+                        size_t n;
+                        LZ4_resetStreamHC_fast(workHC, levels[c]);
+                        LZ4_loadDictHC(workHC, testInput, (int)segSize);
+                        LZ4_setStreamDecode(&sd, testInput, (int)segSize);
+                        for (n = 1; n < 3; n++) {
+                            int const cSize = LZ4_compress_HC_continue(workHC, testInput + n*segSize, testCompressed, (int)segSize, testCompressedSize);
+                            FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_continue() failed (hashLog=%i, chainLog=%i, level=%i)",
+                                        logs[l][0], logs[l][1], levels[c]);
+                            FUZ_CHECKTEST(workHC->internal_donotuse.dirty, "Context should be clean");
+                            result = LZ4_decompress_safe_continue(&sd, testCompressed, testVerify + n*segSize, cSize, (int)segSize);
+                            FUZ_CHECKTEST(result != (int)segSize, "LZ4_decompress_safe_continue() failed with reduced tables");
+                        }
+                        FUZ_CHECKTEST(memcmp(testInput + segSize, testVerify + segSize, 2*segSize),
+                                    "corruption with reduced tables (hashLog=%i, chainLog=%i, level=%i)", logs[l][0], logs[l][1], levels[c]);
+                    }
+                    /* attached dictionary, one-shot compression */
+                    {   int cSize;
+                        LZ4_resetStreamHC_fast(dictHC, levels[c]);
+                        LZ4_loadDictHC(dictHC, testInput, (int)segSize);
+                        LZ4_resetStreamHC_fast(workHC, levels[c]);
+                        LZ4_attach_HC_dictionary(workHC, dictHC);
+                        cSize = LZ4_compress_HC_continue(workHC, testInput + 3*segSize, testCompressed, (int)segSize, testCompressedSize);
+                        FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_continue() with attached dictionary failed");
+                        result = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, (int)segSize, testInput, (int)segSize);
+                        FUZ_CHECKTEST(result != (int)segSize, "LZ4_decompress_safe_usingDict() failed with reduced tables");
+                        FUZ_CHECKTEST(memcmp(testInput + 3*segSize, testVerify, segSize), "corruption with attached reduced dictionary");
+                        cSize = LZ4_compress_HC_extStateHC_fastReset(workHC, testInput, testCompressed, (int)segSize, testCompressedSize, levels[c]);
+                        FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_extStateHC_fastReset() failed with reduced tables");
+                        result = LZ4_decompress_safe(testCompressed, testVerify, cSize, (int)segSize);
+                        FUZ_CHECKTEST(result != (int)segSize || memcmp(testInput, testVerify, segSize),
+                                    "one-shot compression corrupted with reduced tables");
+                }   }
+                free(dictState);
+                free(workState);
+        }   }
+        DISPLAYLEVEL(3, " OK \n");
+
+        DISPLAYLEVEL(3, "HC dictionary reload over stale tables : ");
+        {   static const int levels[] = { 2, 9, 12 };
+            size_t const blockSize = 8 KB;
+            size_t const smallDictSize = 1 KB;
+            char* const smallDict = (char*)malloc(smallDictSize);
+            LZ4_streamHC_t* const workHC = LZ4_createStreamHC();
+            size_t c;
+            assert(smallDict != NULL); assert(workHC != NULL);
+            memcpy(smallDict, testInput + 40 KB, smallDictSize);
+            for (c = 0; c < sizeof(levels)/sizeof(levels[0]); c++) {
+                int cSize;
+                /* fill tables with references into testInput, then fail, leaving state dirty */
+                LZ4_resetStreamHC_fast(&sHC, levels[c]);
+                LZ4_loadDictHC(&sHC, testInput, 32 KB);
+                cSize = LZ4_compress_HC_continue(&sHC, testInput + 32 KB, testCompressed, (int)blockSize, testCompressedSize);
+                FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_continue() failed");
+                cSize = LZ4_compress_HC_continue(&sHC, testInput, testCompressed, (int)blockSize, 16);
+                FUZ_CHECKTEST(cSize!=0 || !sHC.internal_donotuse.dirty, "compression into tiny buffer should fail");
+                /* stale entries must not be referenced from the new dictionary */
+                LZ4_loadDictHC(&sHC, smallDict, (int)smallDictSize);
+                FUZ_CHECKTEST(sHC.internal_donotuse.dirty, "Context should be clean");
+                LZ4_resetStreamHC_fast(workHC, levels[c]);
+                LZ4_attach_HC_dictionary(workHC, &sHC);
+                cSize = LZ4_compress_HC_continue(workHC, testInput, testCompressed, (int)blockSize, testCompressedSize);
+                FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_continue() with attached dictionary failed");
+                result = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, (int)blockSize, smallDict, (int)smallDictSize);
+                FUZ_CHECKTEST(result != (int)blockSize || memcmp(testInput, testVerify, blockSize),
+                            "corruption with attached reloaded dictionary (level %i)", levels[c]);
+                cSize = LZ4_compress_HC_continue(&sHC, testInput, testCompressed, (int)blockSize, testCompressedSize);
+                FUZ_CHECKTEST(cSize==0, "LZ4_compress_HC_continue() with reloaded dictionary failed");
+                result = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, (int)blockSize, smallDict, (int)smallDictSize);
+                FUZ_CHECKTEST(result != (int)blockSize || memcmp(testInput, testVerify, blockSize),
+                            "corruption with reloaded dictionary (level %i)", levels[c]);
+                /* output doesn't depend on previous use of the state */
+                {   int refSize;
+                    LZ4_initStreamHC(workHC, sizeof(*workHC));
+                    LZ4_setCompressionLevel(workHC, levels[c]);
+                    LZ4_loadDictHC(workHC, smallDict, (int)smallDictSize);
+                    refSize = LZ4_compress_HC_continue(workHC, testInput, testVerify, (int)blockSize, LZ4_compressBound((int)blockSize));
+                    FUZ_CHECKTEST(refSize != cSize || memcmp(testCompressed, testVerify, (size_t)cSize),
+                                "reloaded dictionary output differs from fresh state (level %i)", levels[c]);
+            }   }
+            LZ4_freeStreamHC(workHC);
+            free(smallDict);
+        }
+        DISPLAYLEVEL(3, " OK \n");
+
+        DISPLAYLEVEL(3, "stream cloning : ");
+        {   static const int levels[] = { 2, 9, 12 };
+            static const int logs[][2] = { { LZ4HC_HASH_LOG, LZ4HC_DICTIONARY_LOGSIZE }, { 10, 11 } };
+            size_t const blockSize = 16 KB;
+            size_t const stateSize = sizeof(LZ4_streamHC_t);
+            void* const cloneState = malloc(stateSize);
+            char* const cloneCompressed = (char*)malloc((size_t)testCompressedSize);
+            size_t c, l, n;
+            assert(cloneState != NULL); assert(cloneCompressed != NULL);
+            assert(7*blockSize <= testInputSize);
+            for (l = 0; l < sizeof(logs)/sizeof(logs[0]); l++)
+            for (c = 0; c < sizeof(levels)/sizeof(levels[0]); c++) {
+                void* const srcState = malloc(stateSize);
+                LZ4_streamHC_t* const srcHC = LZ4_initStreamHC_advanced(srcState, stateSize, logs[l][0], logs[l][1]);
+                assert(srcHC != NULL);
+                FUZ_CHECKTEST(LZ4_cloneStreamHC(cloneState, (size_t)LZ4_sizeofStreamHC_advanced(logs[l][0], logs[l][1]) - 1, srcHC) != NULL,
+                            "LZ4_cloneStreamHC() should fail on insufficient size");
+                /* with attached dictionary (first block), then long history (window wrap) */
+                LZ4_resetStreamHC_fast(&sHC, levels[c]);
+                LZ4_loadDictHC(&sHC, testInput, 32 KB);
+                LZ4_resetStreamHC_fast(srcHC, levels[c]);
+                LZ4_attach_HC_dictionary(srcHC, &sHC);
+                for (n = 2; n < 7; n++) {
+                    LZ4_streamHC_t* cloneHC;
+                    int cSize, cloneCSize;
+                    memset(cloneState, (int)(n * 37), stateSize);   /* stale content must not matter */
+                    cloneHC = LZ4_cloneStreamHC(cloneState, stateSize, srcHC);
+                    FUZ_CHECKTEST(cloneHC == NULL, "LZ4_cloneStreamHC() failed");
+                    cSize = LZ4_compress_HC_continue(srcHC, testInput + n*blockSize, testCompressed, (int)blockSize, testCompressedSize);
+                    cloneCSize = LZ4_compress_HC_continue(cloneHC, testInput + n*blockSize, cloneCompressed, (int)blockSize, testCompressedSize);
+                    FUZ_CHECKTEST(cSize == 0, "LZ4_compress_HC_continue() failed");
+                    FUZ_CHECKTEST(cSize != cloneCSize || memcmp(testCompressed, cloneCompressed, (size_t)cSize),
+                                "cloned HC stream should produce same output (level %i, block %u)", levels[c], (unsigned)n);
+                }
+                free(srcState);
+            }
+            /* fast streams, full and reduced hash tables */
+            {   static const int memoryUsages[] = { LZ4_MEMORY_USAGE, 10 };
+                size_t m;
+                for (m = 0; m < sizeof(memoryUsages)/sizeof(memoryUsages[0]); m++) {
+                    void* const srcState = malloc(sizeof(LZ4_stream_t));
+                    LZ4_stream_t* const srcStream = LZ4_initStream_advanced(srcState, sizeof(LZ4_stream_t), memoryUsages[m]);
+                    assert(srcStream != NULL);
+                    LZ4_loadDict(srcStream, testInput, 32 KB);
+                    for (n = 2; n < 7; n++) {
+                        LZ4_stream_t* cloneStream;
+                        int cSize, cloneCSize;
+                        memset(cloneState, (int)(n * 37), stateSize);
+                        cloneStream = LZ4_cloneStream(cloneState, sizeof(LZ4_stream_t), srcStream);
+                        FUZ_CHECKTEST(cloneStream == NULL, "LZ4_cloneStream() failed");
+                        cSize = LZ4_compress_fast_continue(srcStream, testInput + n*blockSize, testCompressed, (int)blockSize, testCompressedSize, 1);
+                        cloneCSize = LZ4_compress_fast_continue(cloneStream, testInput + n*blockSize, cloneCompressed, (int)blockSize, testCompressedSize, 1);
+                        FUZ_CHECKTEST(cSize == 0, "LZ4_compress_fast_continue() failed");
+                        FUZ_CHECKTEST(cSize != cloneCSize || memcmp(testCompressed, cloneCompressed, (size_t)cSize),
+                                    "cloned stream should produce same output (memoryUsage %i, block %u)", memoryUsages[m], (unsigned)n);
+                    }
+                    free(srcState);
+            }   }
+            free(cloneCompressed);
+            free(cloneState);
+        }
+        DISPLAYLEVEL(3, " OK \n");
+
+        DISPLAYLEVEL(3, "decompression of short offset matches : ");
+        {   size_t const bufSize = 160 KB;
+            char* const patterns = (char*)malloc(bufSize);
+            char* const cBuffer = (char*)malloc((size_t)LZ4_compressBound((int)bufSize));
+            char* const dBuffer = (char*)malloc(bufSize);
+            size_t pos = 0;
+            U32 rs = 7;
+            assert(patterns != NULL); assert(cBuffer != NULL); assert(dBuffer != NULL);
+            /* runs of every offset from 1 to 31, of all lengths from 4 to 300, separated by literals */
+            while (pos < bufSize) {
+                size_t const offset = 1 + FUZ_rand(&rs) % 31;
+                size_t const runLength = 4 + FUZ_rand(&rs) % 297;
+                size_t n;
+                for (n = 0; n < offset + 3 && pos < bufSize; n++) patterns[pos++] = (char)FUZ_rand(&rs);
+                for (n = 0; n < runLength && pos < bufSize; n++, pos++) patterns[pos] = patterns[pos - offset];
+            }
+            {   int const cSize = LZ4_compress_default(patterns, cBuffer, (int)bufSize, LZ4_compressBound((int)bufSize));
+                int const dSize = LZ4_decompress_safe(cBuffer, dBuffer, cSize, (int)bufSize);
+                FUZ_CHECKTEST(cSize <= 0, "compression of short offset matches failed");
+                FUZ_CHECKTEST(dSize != (int)bufSize, "decompression of short offset matches failed (%i)", dSize);
+                FUZ_CHECKTEST(memcmp(patterns, dBuffer, bufSize), "short offset matches : corrupted decoded data");
+            }
+            free(patterns);
+            free(cBuffer);
+            free(dBuffer);
+        }
+        DISPLAYLEVEL(3, " OK \n");
+
+        DISPLAYLEVEL(3, "sampled compressed size estimation : ");
+        {   int const exact = LZ4_estimateCompressedSize(testInput, testInputSize, 1);
+            int const bound = LZ4_compressBound(testInputSize);
+            char* const dst = (char*)malloc((size_t)bound);
+            int sampleLog;
+            assert(dst != NULL);
+            FUZ_CHECKTEST(exact != LZ4_compress_fast(testInput, dst, testInputSize, bound, 1),
+                        "LZ4_estimateCompressedSize() should match LZ4_compress_fast()");
+            free(dst);
+            FUZ_CHECKTEST(LZ4_estimateCompressedSize(testInput, -1, 1) != 0, "LZ4_estimateCompressedSize() should fail on invalid size");
+            for (sampleLog = 0; sampleLog <= 2; sampleLog++) {
+                int errorBound = -1;
+                int const e = LZ4_estimateCompressedSize_sampled(testInput, testInputSize, 1, sampleLog, &errorBound);
+                int const delta = (e > exact) ? e - exact : exact - e;
+                FUZ_CHECKTEST(sampleLog == 0 && (e != exact || errorBound != 0), "sampleLog 0 should be exact");
+                /* sampling error is statistical : only check it's in a generous range of the reported bound */
+                FUZ_CHECKTEST(errorBound < 0 || delta > 2*errorBound + exact/50,
+                            "sampled estimation too far (sampleLog %i : %i vs %i, bound %i)", sampleLog, e, exact, errorBound);
+        }   }
+        DISPLAYLEVEL(3, " OK \n");
+
         /* multiple HC compression test with dictionary */
         {   int result1, result2;
             int segSize = testCompressedSize / 2;
@@ -1735,6 +2650,41 @@ static void FUZ_unitTests(int compressionLevel)
     }
     DISPLAYLEVEL(3, " OK \n");
 
+    DISPLAYLEVEL(3, "XXH32_multi() matches XXH32(), with each kernel :");
+    {   const void* inputs[20];
+        size_t lengths[20];
+        XXH32_hash_t results[20];
+        static const XXH32_multiKernel_e kernels[] = { XXH32_multiKernel_auto, XXH32_multiKernel_scalar,
+                                                       XXH32_multiKernel_sse41, XXH32_multiKernel_avx2 };
+        static const char* const kernelNames[] = { "auto", "scalar", "sse4.1", "avx2" };
+        size_t k;
+        for (k = 0; k < sizeof(kernels)/sizeof(kernels[0]); k++) {
+            int t;
+            if (!XXH32_multi_selectKernel(kernels[k])) {
+                DISPLAYLEVEL(3, " (%s : n/a)", kernelNames[k]);
+                continue;
+            }
+            DISPLAYLEVEL(3, " %s", kernelNames[k]);
+            for (t = 0; t < 2000; t++) {
+                size_t const nbInputs = FUZ_rand(&randState) % 20;
+                U32 const hSeed = FUZ_rand(&randState);
+                size_t n;
+                for (n = 0; n < nbInputs; n++) {
+                    /* mostly short inputs, so that lanes complete at different stripes */
+                    size_t const maxLength = (FUZ_rand(&randState) & 3) ? 300 : 70 KB;
+                    lengths[n] = FUZ_rand(&randState) % maxLength;
+                    inputs[n] = testInput + FUZ_rand(&randState) % (testInputSize - lengths[n] + 1);
+                }
+                XXH32_multi(inputs, lengths, nbInputs, hSeed, results);
+                for (n = 0; n < nbInputs; n++) {
+                    FUZ_CHECKTEST(results[n] != XXH32(inputs[n], lengths[n], hSeed),
+                                  "XXH32_multi() (%s) : wrong hash for input %u of %u (length %u)",
+                                  kernelNames[k], (unsigned)n, (unsigned)nbInputs, (unsigned)lengths[n]);
+        }   }   }
+        FUZ_CHECKTEST(!XXH32_multi_selectKernel(XXH32_multiKernel_auto), "XXH32_multi_selectKernel(auto) must always succeed");
+    }
+    DISPLAYLEVEL(3, " OK \n");
+
 
     /* clean up */
     free(testInput);
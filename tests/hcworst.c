@@ -0,0 +1,353 @@
+/*
+    hcworst.c - worst case speed of HC levels, on adversarial inputs
+    Copyright (C) Yann Collet 2012-2024
+
+    GPL v2 License
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    You can contact the author at :
+   - LZ4 source repository : https://github.com/lz4/lz4
+*/
+
+/*
+ * Compresses inputs known to defeat the HC match finder,
+ * and compares their speed with typical data, at each level.
+ * Inputs are generated (see g_families), or loaded from files,
+ * such as oss-fuzz timeout reproducers, or a fuzzer corpus.
+ * Every result is decompressed and verified.
+ */
+
+
+/*===========================================
+*   Dependencies
+*==========================================*/
+#include <stddef.h>     /* size_t */
+#include <stdlib.h>     /* malloc, free, exit */
+#include <stdio.h>      /* fprintf */
+#include <string.h>     /* strcmp, memcpy */
+#include <sys/types.h>  /* stat */
+#include <sys/stat.h>   /* stat */
+#include "datagen.h"    /* RDG_genBuffer */
+#include "lorem.h"      /* LOREM_genBuffer */
+#include "timefn.h"     /* TIME_getTime, TIME_clockSpan_ns */
+
+#define LZ4_HC_STATIC_LINKING_ONLY   /* LZ4_setWorkLimitHC */
+#include "lz4.h"
+#include "lz4hc.h"
+
+
+/*===========================================
+*   Constants
+*==========================================*/
+#define KB *(1 <<10)
+#define MB *(1 <<20)
+
+#define DEFAULT_SRCSIZE (4 MB)
+#define DEFAULT_NBLOOPS 3
+#define MAX_INPUTS      64
+
+
+/*===========================================
+*   Macros
+*==========================================*/
+#define MIN(a,b)  ( (a) < (b) ? (a) : (b) )
+#define MSG(...)  fprintf(stderr, __VA_ARGS__)
+#define OUT(...)  fprintf(stdout, __VA_ARGS__)
+
+
+/*===========================================
+*   Generators
+*==========================================*/
+static unsigned HCW_rand(unsigned* seed)
+{
+    /* xorshift32 */
+    unsigned x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+static void HCW_typical(char* buf, size_t size, unsigned seed, unsigned param)
+{
+    if (param) RDG_genBuffer(buf, size, param / 100., 0., seed);
+    else LOREM_genBuffer(buf, size, seed);
+}
+
+/* long runs of a single byte, with rare variations (1 every @param bytes) */
+static void HCW_runs(char* buf, size_t size, unsigned seed, unsigned param)
+{
+    size_t n;
+    for (n = 0; n < size; n++)
+        buf[n] = (HCW_rand(&seed) % param) ? 'a' : 'b';
+}
+
+/* random bytes from a tiny alphabet, of @param symbols */
+static void HCW_alphabet(char* buf, size_t size, unsigned seed, unsigned param)
+{
+    size_t n;
+    for (n = 0; n < size; n++)
+        buf[n] = (char)('a' + HCW_rand(&seed) % param);
+}
+
+/* same, with a line break every @param bytes */
+static void HCW_lines(char* buf, size_t size, unsigned seed, unsigned param)
+{
+    size_t n;
+    for (n = 0; n < size; n++)
+        buf[n] = (n % param == param - 1) ? '\n' : (char)('a' + HCW_rand(&seed) % 4);
+}
+
+/* records of @param bytes, each one a copy of the previous one with one byte modified */
+static void HCW_nearDuplicates(char* buf, size_t size, unsigned seed, unsigned param)
+{
+    size_t n;
+    RDG_genBuffer(buf, MIN(param, size), 0.5, 0., seed);
+    for (n = param; n < size; n++) buf[n] = buf[n - param];
+    for (n = param; n + param <= size; n += param)
+        buf[n + HCW_rand(&seed) % param] ^= (char)(1 + HCW_rand(&seed) % 255);
+}
+
+/* records of @param bytes : a constant header, followed by random payload */
+static void HCW_records(char* buf, size_t size, unsigned seed, unsigned param)
+{
+    static const char header[] = "{\"id\":0000,\"type\":\"event\",\"payload\":\"";
+    size_t n;
+    for (n = 0; n < size; n++) {
+        size_t const pos = n % param;
+        buf[n] = (pos < param / 2) ? header[pos % (sizeof(header) - 1)] : (char)HCW_rand(&seed);
+    }
+}
+
+/* random block of @param bytes, repeated : period is beyond reach when larger than 64 KB */
+static void HCW_period(char* buf, size_t size, unsigned seed, unsigned param)
+{
+    size_t n;
+    for (n = 0; n < MIN(param, size); n++) buf[n] = (char)HCW_rand(&seed);
+    for (; n < size; n++) buf[n] = buf[n - param];
+}
+
+typedef void (*HCW_generator)(char* buf, size_t size, unsigned seed, unsigned param);
+
+typedef struct {
+    const char* name;
+    HCW_generator gen;
+    unsigned param;
+    int typical;   /* reference for normal speed */
+} HCW_family_t;
+
+static const HCW_family_t g_families[] = {
+    { "lorem",        HCW_typical,        0,         1 },
+    { "datagen-50",   HCW_typical,        50,        1 },
+    { "datagen-90",   HCW_typical,        90,        1 },
+    { "runs-16",      HCW_runs,           16,        0 },
+    { "runs-256",     HCW_runs,           256,       0 },
+    { "alphabet-2",   HCW_alphabet,       2,         0 },
+    { "alphabet-4",   HCW_alphabet,       4,         0 },
+    { "lines-64",     HCW_lines,          64,        0 },
+    { "neardup-64",   HCW_nearDuplicates, 64,        0 },
+    { "neardup-256",  HCW_nearDuplicates, 256,       0 },
+    { "neardup-1K",   HCW_nearDuplicates, 1 KB,      0 },
+    { "records-32",   HCW_records,        32,        0 },
+    { "records-256",  HCW_records,        256,       0 },
+    { "period-100K",  HCW_period,         100 KB,    0 },
+};
+#define NB_FAMILIES (int)(sizeof(g_families) / sizeof(g_families[0]))
+
+
+/*===========================================
+*   Files
+*==========================================*/
+static char* HCW_loadFile(const char* fileName, size_t* sizePtr)
+{
+    struct stat statbuf;
+    FILE* f;
+    char* buf;
+    if (stat(fileName, &statbuf) || !(statbuf.st_mode & S_IFREG)) {
+        MSG("%s : not a regular file \n", fileName);
+        exit(2);
+    }
+    f = fopen(fileName, "rb");
+    buf = (char*)malloc((size_t)statbuf.st_size + 1);
+    if (f == NULL || buf == NULL) {
+        MSG("%s : can't load \n", fileName);
+        exit(3);
+    }
+    *sizePtr = fread(buf, 1, (size_t)statbuf.st_size, f);
+    fclose(f);
+    return buf;
+}
+
+
+/*===========================================
+*   Benchmark
+*==========================================*/
+typedef struct {
+    const char* name;
+    char* buf;
+    size_t size;
+    int typical;
+} HCW_input_t;
+
+/* @return : best speed over @nbLoops runs, in MB/s */
+static double HCW_bench(const HCW_input_t* in, char* cBuf, char* dBuf, LZ4_streamHC_t* state,
+                        int level, int workLimit, int nbLoops, double* ratioPtr)
+{
+    int const cCapacity = LZ4_compressBound((int)in->size);
+    Duration_ns best = 0;
+    int cSize = 0;
+    int loop;
+    for (loop = 0; loop < nbLoops; loop++) {
+        TIME_t const start = TIME_getTime();
+        Duration_ns span;
+        LZ4_resetStreamHC_fast(state, level);
+        LZ4_setWorkLimitHC(state, workLimit);
+        cSize = LZ4_compress_HC_continue(state, in->buf, cBuf, (int)in->size, cCapacity);
+        span = TIME_clockSpan_ns(start);
+        if (cSize <= 0) {
+            MSG("%s : compression failed at level %i \n", in->name, level);
+            exit(5);
+        }
+        if (loop == 0 || span < best) best = span;
+    }
+    if ( LZ4_decompress_safe(cBuf, dBuf, cSize, (int)in->size) != (int)in->size
+      || memcmp(in->buf, dBuf, in->size) ) {
+        MSG("%s : round trip failed at level %i \n", in->name, level);
+        exit(6);
+    }
+    *ratioPtr = (double)in->size / cSize;
+    if (best == 0) best = 1;
+    return (double)in->size * 1000. / (double)best;
+}
+
+
+static int usage(const char* exeName)
+{
+    MSG("Usage : %s [options] [files] \n", exeName);
+    MSG("Compresses generated adversarial inputs, and files if any, at HC levels \n");
+    MSG("Options : \n");
+    MSG(" -b#    : first level (default : 9) \n");
+    MSG(" -e#    : last level (default : 12) \n");
+    MSG(" -s#    : size of generated inputs, in KB (default : %u) \n", DEFAULT_SRCSIZE >> 10);
+    MSG(" -i#    : nb of runs per measurement, best one is kept (default : %i) \n", DEFAULT_NBLOOPS);
+    MSG(" -L#    : work limit, see LZ4_setWorkLimitHC() (default : 0 == library default, 255 == none) \n");
+    MSG(" -t#    : fail if worst case is more than # times slower than typical data \n");
+    MSG(" -g     : skip generated inputs, only bench files \n");
+    return 1;
+}
+
+static unsigned readU32(const char** s)
+{
+    unsigned r = 0;
+    while (**s >= '0' && **s <= '9') { r = r * 10 + (unsigned)(**s - '0'); (*s)++; }
+    return r;
+}
+
+int main(int argc, const char** argv)
+{
+    HCW_input_t inputs[MAX_INPUTS];
+    int nbInputs = 0;
+    int firstLevel = 9, lastLevel = 12;
+    size_t srcSize = DEFAULT_SRCSIZE;
+    int nbLoops = DEFAULT_NBLOOPS;
+    int workLimit = 0;
+    unsigned maxSlowdown = 0;
+    int generated = 1;
+    int argNb, n, level;
+    int result = 0;
+    size_t maxSize = 0;
+    char* cBuf;
+    char* dBuf;
+    LZ4_streamHC_t* const state = LZ4_createStreamHC();
+
+    for (argNb = 1; argNb < argc; argNb++) {
+        const char* arg = argv[argNb];
+        if (arg[0] == '-') {
+            char const cmd = arg[1];
+            arg += 2;
+            switch (cmd) {
+            case 'b': firstLevel = (int)readU32(&arg); break;
+            case 'e': lastLevel = (int)readU32(&arg); break;
+            case 's': srcSize = (size_t)readU32(&arg) KB; break;
+            case 'i': nbLoops = (int)readU32(&arg); break;
+            case 'L': workLimit = (int)readU32(&arg); break;
+            case 't': maxSlowdown = readU32(&arg); break;
+            case 'g': generated = 0; break;
+            default : return usage(argv[0]);
+            }
+            if (*arg != 0) return usage(argv[0]);
+            continue;
+        }
+        if (nbInputs >= MAX_INPUTS) { MSG("too many files \n"); return 1; }
+        inputs[nbInputs].name = arg;
+        inputs[nbInputs].buf = HCW_loadFile(arg, &inputs[nbInputs].size);
+        inputs[nbInputs].typical = 0;
+        nbInputs++;
+    }
+    if (nbLoops < 1) nbLoops = 1;
+    if (srcSize == 0 || srcSize > LZ4_MAX_INPUT_SIZE) return usage(argv[0]);
+    if (state == NULL) { MSG("allocation error \n"); return 4; }
+
+    if (generated) {
+        for (n = 0; n < NB_FAMILIES && nbInputs < MAX_INPUTS; n++) {
+            HCW_input_t* const in = inputs + nbInputs++;
+            in->name = g_families[n].name;
+            in->buf = (char*)malloc(srcSize);
+            in->size = srcSize;
+            in->typical = g_families[n].typical;
+            if (in->buf == NULL) { MSG("allocation error \n"); return 4; }
+            g_families[n].gen(in->buf, srcSize, (unsigned)(n + 1) * 2654435761U, g_families[n].param);
+    }   }
+    if (nbInputs == 0) return usage(argv[0]);
+    for (n = 0; n < nbInputs; n++) {
+        if (inputs[n].size == 0 || inputs[n].size > LZ4_MAX_INPUT_SIZE) { MSG("%s : unsupported size \n", inputs[n].name); return 1; }
+        if (inputs[n].size > maxSize) maxSize = inputs[n].size;
+    }
+    cBuf = (char*)malloc((size_t)LZ4_compressBound((int)maxSize));
+    dBuf = (char*)malloc(maxSize);
+    if (cBuf == NULL || dBuf == NULL) { MSG("allocation error \n"); return 4; }
+
+    for (level = firstLevel; level <= lastLevel; level++) {
+        double typicalSpeed = 0., worstSpeed = 0.;
+        const char* worstName = NULL;
+        for (n = 0; n < nbInputs; n++) {
+            double ratio;
+            double const speed = HCW_bench(inputs + n, cBuf, dBuf, state, level, workLimit, nbLoops, &ratio);
+            OUT("L%-2i %-20.20s %9.1f MB/s  ratio %7.3f %s\n", level, inputs[n].name, speed, ratio, inputs[n].typical ? "(typical)" : "");
+            if (inputs[n].typical) {
+                if (typicalSpeed == 0. || speed < typicalSpeed) typicalSpeed = speed;
+            } else if (worstName == NULL || speed < worstSpeed) {
+                worstSpeed = speed;
+                worstName = inputs[n].name;
+        }   }
+        if (worstName == NULL) continue;
+        OUT("L%-2i worst case : %.1f MB/s (%s)", level, worstSpeed, worstName);
+        if (typicalSpeed > 0.) {
+            double const slowdown = typicalSpeed / worstSpeed;
+            OUT(", %.1fx slower than typical data (%.1f MB/s)", slowdown, typicalSpeed);
+            if (maxSlowdown && slowdown > (double)maxSlowdown) result = 1;
+        }
+        OUT("\n\n");
+    }
+    if (result) MSG("worst case is more than %ux slower than typical data \n", maxSlowdown);
+
+    for (n = 0; n < nbInputs; n++) free(inputs[n].buf);
+    free(cBuf);
+    free(dBuf);
+    LZ4_freeStreamHC(state);
+    return result;
+}
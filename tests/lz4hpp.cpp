@@ -0,0 +1,130 @@
+/*
+ * lz4hpp.cpp
+ * Checks that compile-time specialized entry points of lib/lz4.hpp
+ * produce the same results as regular lz4 API functions.
+ */
+#include "../lib/lz4.c"
+#include "../lib/lz4.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(c, ...) do { if (!(c)) { printf("Error line %i : ", __LINE__); printf(__VA_ARGS__); printf("\n"); exit(1); } } while (0)
+
+#define SRC_SIZE (300 KB)
+#define DICT_SIZE (32 KB)
+
+static void fillSource(char* buf, size_t size)
+{
+    unsigned rand32 = 2654435761U;
+    size_t pos = 0;
+    while (pos < size) {
+        /* mix of literals and repetitions, at various distances */
+        rand32 = rand32 * 1103515245U + 12345U;
+        if (pos > 70 KB && (rand32 >> 28) < 9) {
+            size_t const len = 4 + ((rand32 >> 8) & 63);
+            size_t const dist = 1 + ((rand32 >> 14) % (70 KB));
+            size_t n;
+            for (n = 0; n < len && pos < size; n++, pos++) buf[pos] = buf[pos - dist];
+        } else {
+            buf[pos++] = (char)('a' + ((rand32 >> 16) % 26));
+        }
+    }
+}
+
+static void checkRoundTrip(const char* src, int srcSize, const char* cBuf, int cSize, const char* dict, size_t dictSize)
+{
+    char* const out = (char*)malloc((size_t)srcSize);
+    int const r = (dict == NULL) ? lz4::decompress(cBuf, out, cSize, srcSize)
+                                 : lz4::decompress<lz4::decode_full_block, lz4::usingExtDict>(cBuf, out, cSize, srcSize, dict, dictSize);
+    CHECK(r == srcSize && !memcmp(src, out, (size_t)srcSize), "round trip failed (%i / %i)", r, srcSize);
+    free(out);
+}
+
+int main(void)
+{
+    char* const src = (char*)malloc(SRC_SIZE);
+    int const bound = LZ4_compressBound(SRC_SIZE);
+    char* const ref = (char*)malloc((size_t)bound);
+    char* const cBuf = (char*)malloc((size_t)bound);
+    LZ4_stream_t refStream, stream, dictStream;
+    CHECK(src && ref && cBuf, "allocation failed");
+    fillSource(src, SRC_SIZE);
+
+    /* independent blocks */
+    {   static const int sizes[] = { 0, 10, 1000, 20 KB, 60 KB, 64 KB, 200 KB, SRC_SIZE };
+        static const int accels[] = { 1, 2, 17 };
+        size_t s, a;
+        LZ4_initStream(&stream, sizeof(stream));
+        for (a = 0; a < sizeof(accels)/sizeof(accels[0]); a++)
+        for (s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+            int const srcSize = sizes[s];
+            int const refSize = LZ4_compress_fast_extState(&refStream, src, ref, srcSize, bound, accels[a]);
+            int const cSize = (srcSize < LZ4_64Klimit)
+                            ? lz4::compress<lz4::byU16>(&stream, src, cBuf, srcSize, bound, accels[a])
+                            : lz4::compress<lz4::byU32>(&stream, src, cBuf, srcSize, bound, accels[a]);
+            int const nlSize = (srcSize < LZ4_64Klimit)
+                            ? lz4::compress<lz4::byU16, lz4::noDict, lz4::notLimited>(&stream, src, cBuf, srcSize, bound, accels[a])
+                            : lz4::compress<lz4::byU32, lz4::noDict, lz4::notLimited>(&stream, src, cBuf, srcSize, bound, accels[a]);
+            CHECK(refSize > 0, "reference compression failed");
+            CHECK(cSize == refSize, "size %i : compressed size %i differs from reference %i", srcSize, cSize, refSize);
+            CHECK(nlSize == refSize && !memcmp(cBuf, ref, (size_t)refSize), "size %i : notLimited output differs", srcSize);
+            checkRoundTrip(src, srcSize, cBuf, cSize, NULL, 0);
+            if (srcSize > 1) {
+                CHECK(lz4::compress<lz4::byU32>(&stream, src, cBuf, srcSize, cSize - 1, accels[a]) == 0, "size %i : should fail with too small dst", srcSize);
+            }
+        }
+        CHECK(lz4::compress<lz4::byU16>(&stream, src, cBuf, 70 KB, bound) == 0, "byU16 should refuse inputs >= LZ4_64Klimit");
+    }
+
+    /* streaming : external dictionary, then prefix */
+    {   int const blockSize = 16 KB;
+        const char* const dict = src + SRC_SIZE - DICT_SIZE;
+        int refSize, cSize;
+        LZ4_initStream(&refStream, sizeof(refStream));
+        LZ4_initStream(&stream, sizeof(stream));
+        LZ4_loadDict(&refStream, dict, DICT_SIZE);
+        LZ4_loadDict(&stream, dict, DICT_SIZE);
+
+        refSize = LZ4_compress_fast_continue(&refStream, src, ref, blockSize, bound, 1);
+        cSize = lz4::compress<lz4::byU32, lz4::usingExtDict>(&stream, src, cBuf, blockSize, bound);
+        CHECK(cSize == refSize && !memcmp(cBuf, ref, (size_t)cSize), "usingExtDict output differs");
+        checkRoundTrip(src, blockSize, cBuf, cSize, dict, DICT_SIZE);
+
+        refSize = LZ4_compress_fast_continue(&refStream, src + blockSize, ref, blockSize, bound, 1);
+        cSize = lz4::compress<lz4::byU32, lz4::withPrefix64k>(&stream, src + blockSize, cBuf, blockSize, bound);
+        CHECK(cSize == refSize && !memcmp(cBuf, ref, (size_t)cSize), "withPrefix64k output differs");
+        {   char* const out = (char*)malloc((size_t)(2 * blockSize));
+            int r;
+            memcpy(out, src, (size_t)blockSize);
+            r = lz4::decompress(cBuf, out + blockSize, cSize, blockSize, out, (size_t)blockSize);
+            CHECK(r == blockSize && !memcmp(out, src, (size_t)(2 * blockSize)), "prefix decoding failed");
+            r = lz4::decompress<lz4::partial_decode>(cBuf, out + blockSize, cSize, 100, out, (size_t)blockSize);
+            CHECK(r == 100 && !memcmp(out + blockSize, src + blockSize, 100), "partial decoding failed (%i)", r);
+            free(out);
+    }   }
+
+    /* streaming : attached dictionary */
+    {   int const blockSize = 4 KB;
+        const char* const dict = src + SRC_SIZE - DICT_SIZE;
+        int refSize, cSize;
+        LZ4_initStream(&dictStream, sizeof(dictStream));
+        LZ4_loadDict(&dictStream, dict, DICT_SIZE);
+        LZ4_initStream(&refStream, sizeof(refStream));
+        LZ4_initStream(&stream, sizeof(stream));
+        LZ4_attach_dictionary(&refStream, &dictStream);
+        LZ4_attach_dictionary(&stream, &dictStream);
+
+        refSize = LZ4_compress_fast_continue(&refStream, src, ref, blockSize, bound, 1);
+        cSize = lz4::compress<lz4::byU32, lz4::usingDictCtx>(&stream, src, cBuf, blockSize, bound);
+        CHECK(cSize == refSize && !memcmp(cBuf, ref, (size_t)cSize), "usingDictCtx output differs");
+        checkRoundTrip(src, blockSize, cBuf, cSize, dict, DICT_SIZE);
+    }
+
+    free(src);
+    free(ref);
+    free(cBuf);
+    printf("test lz4.hpp OK \n");
+    return 0;
+}
@@ -25,6 +25,12 @@ datagen -g6M -P99 | lz4 -9BD   | lz4 -t
 datagen -g17M     | lz4 -9v    | lz4 -qt
 datagen -g33M     | lz4 --no-frame-crc | lz4 -t
 datagen -g256MB   | lz4 -vqB4D | lz4 -t --no-crc
+datagen -g40M -P60 | lz4 -T1 --adapt -BD | lz4 -t    # adaptive level, linked blocks
+datagen -g40M -P60 | lz4 -T1 --adapt=min=1,max=4 -B4 | lz4 -t
+datagen -g16KB    | lz4 --adapt=min=3 -1 | lz4 -t
+datagen -g16KB    | lz4 --adapt=min=5,max=4 && exit 1   # must fail: empty range
+datagen -g16KB    | lz4 --adapt=min=0 && exit 1         # must fail: level 0
+datagen -g16KB    | lz4 --adapt=mid=3 && exit 1         # must fail: unknown parameter
 echo "hello world" > $FPREFIX-hw
 lz4 --rm -f $FPREFIX-hw $FPREFIX-hw.lz4
 test ! -f $FPREFIX-hw                   # must fail (--rm)
@@ -57,6 +63,13 @@ test ! -f ${FPREFIX}-dir.lz4          # must not create artifact (#1211)
 lz4 -f $FPREFIX-hw                    # create $FPREFIX-hw.lz4, for next tests
 lz4 --list $FPREFIX-hw.lz4            # test --list on valid single-frame file
 lz4 --list < $FPREFIX-hw.lz4          # test --list from stdin (file only)
+datagen -g300KB > $FPREFIX-dg300k
+lz4 -f -B4 --seekable $FPREFIX-dg300k $FPREFIX-seek.lz4
+lz4 --list $FPREFIX-seek.lz4 | grep -q "300.00K"   # uncompressed size read from seek table
+lz4 --list -m -T2 --json $FPREFIX-hw.lz4 $FPREFIX-seek.lz4 > $FPREFIX-list.json
+grep -q '"file":"'$FPREFIX'-seek.lz4","frames":2,.*"uncompressed":307200}' $FPREFIX-list.json
+grep -q '"file":"'$FPREFIX'-hw.lz4","frames":1,"type":"LZ4Frame",.*"uncompressed":null}' $FPREFIX-list.json
+test "$(head -n 1 $FPREFIX-list.json)" = "["
 cat $FPREFIX-hw >> $FPREFIX-hw.lz4
 lz4 -f $FPREFIX-hw.lz4 && exit 1      # uncompress valid frame followed by invalid data (must fail now)
 lz4 -BX $FPREFIX-hw -c -q | lz4 -tv   # test block checksum
@@ -79,3 +92,53 @@ datagen -g16M | lz4 -T2 | lz4 -t
 datagen -g16M | lz4 --threads=2 | lz4 -t
 # bug #1374
 datagen -g4194302 | lz4 -B4 -c > $FPREFIX-test3
+# --rsyncable : compressed output realigns after an insertion
+datagen -g2M -P50 > $FPREFIX-rs
+{ head -c 1000 $FPREFIX-rs; printf 'X'; tail -c +1001 $FPREFIX-rs; } > $FPREFIX-rs2
+lz4 -f -B4 --rsyncable --no-frame-crc $FPREFIX-rs $FPREFIX-rs.lz4
+lz4 -f -B4 --rsyncable --no-frame-crc $FPREFIX-rs2 $FPREFIX-rs2.lz4
+tail -c 500000 $FPREFIX-rs.lz4 > $FPREFIX-rs-tail
+tail -c 500000 $FPREFIX-rs2.lz4 | cmp - $FPREFIX-rs-tail
+lz4 -d -c $FPREFIX-rs2.lz4 | cmp - $FPREFIX-rs2
+lz4 -f -T4 --rsyncable $FPREFIX-rs $FPREFIX-rs.lz4
+lz4 -d -c $FPREFIX-rs.lz4 | cmp - $FPREFIX-rs
+# --append : continues last frame of existing file, which remains a single frame
+datagen -g300KB -s1 > $FPREFIX-ap1
+datagen -g200KB -s2 > $FPREFIX-ap2
+cat $FPREFIX-ap1 $FPREFIX-ap2 $FPREFIX-hw > $FPREFIX-ap.ref
+lz4 -q -B4 $FPREFIX-ap1 $FPREFIX-ap.lz4
+lz4 -q --append $FPREFIX-ap2 $FPREFIX-ap.lz4
+lz4 -q --append -9 $FPREFIX-hw $FPREFIX-ap.lz4
+test "$(lz4 --list $FPREFIX-ap.lz4 | grep -c LZ4Frame)" -eq 1
+lz4 -dc $FPREFIX-ap.lz4 | cmp - $FPREFIX-ap.ref
+lz4 -q --append -BX --no-frame-crc $FPREFIX-ap1 $FPREFIX-apx.lz4   # new file
+lz4 -q --append $FPREFIX-ap2 $FPREFIX-apx.lz4
+cat $FPREFIX-ap1 $FPREFIX-ap2 > $FPREFIX-apx.ref
+lz4 -dc $FPREFIX-apx.lz4 | cmp - $FPREFIX-apx.ref
+lz4 -f -q -B4 -BD $FPREFIX-ap1 $FPREFIX-apx.lz4
+lz4 -q --append $FPREFIX-ap2 $FPREFIX-apx.lz4 && exit 1   # linked blocks
+lz4 -f -q --seekable $FPREFIX-ap1 $FPREFIX-apx.lz4
+lz4 -q --append $FPREFIX-ap2 $FPREFIX-apx.lz4 && exit 1   # followed by seek table
+for contentCrc in --frame-crc --no-frame-crc; do
+    lz4 -f -q -B4 -BX $contentCrc $FPREFIX-ap1 $FPREFIX-apx.lz4
+    set -- $(od -An -tu1 -j7 -N4 $FPREFIX-apx.lz4)   # first block header, after 7-bytes frame header
+    crcPos=$((7 + 4 + $1 + ($2 << 8) + ($3 << 16) + (($4 & 127) << 24)))
+    crcByte=$(od -An -tu1 -j$crcPos -N1 $FPREFIX-apx.lz4)
+    printf "\\$(printf '%03o' $((crcByte ^ 1)))" | dd of=$FPREFIX-apx.lz4 bs=1 seek=$crcPos conv=notrunc 2>/dev/null
+    lz4 -q --append $FPREFIX-ap2 $FPREFIX-apx.lz4 && exit 1   # block checksum error
+done
+# mapped input truncated while being compressed : read error, instead of SIGBUS
+if command -v truncate > /dev/null; then
+    for threads in -T1 -T2; do
+        datagen -g64M > $FPREFIX-tr
+        lz4 -q -f -12 $threads $FPREFIX-tr $FPREFIX-tr.lz4 2> $FPREFIX-tr.err &
+        pid=$!
+        sleep 1
+        truncate -s 1M $FPREFIX-tr
+        status=0
+        wait $pid || status=$?
+        test $status -eq 40
+        grep -q "truncated while being read" $FPREFIX-tr.err
+    done
+fi
+true
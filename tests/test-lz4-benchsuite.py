@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""
+Benchmark regression suite.
+
+Benchmarks the programs of this tree over a fixed, generated corpus,
+and compares results against a baseline previously recorded on the same host.
+
+Coverage :
+- fullbench : every block API (fast, HC, streaming, dictionary, partial decoding)
+              and LZ4F frame API variants ;
+- lz4 -b    : every compression level, block API ;
+- lz4 -b --bench-frame -BX : frame API, with block and content checksums.
+
+Each benchmark is run several times, interleaved, and its median is kept.
+A result is a regression when it is slower than baseline by more than
+the larger of --threshold and the noise observed between runs (baseline + current).
+Compressed sizes must match exactly : any difference is reported.
+
+Typical usage :
+    ./test-lz4-benchsuite.py --save baseline.json      # on reference version
+    ./test-lz4-benchsuite.py --compare baseline.json   # on candidate version
+"""
+
+import argparse
+import json
+import os
+import random
+import shutil
+import statistics
+import struct
+import subprocess
+import sys
+import time
+
+TESTDIR = os.path.dirname(os.path.realpath(__file__))
+LZ4 = os.path.abspath(os.path.join(TESTDIR, "..", "programs", "lz4"))
+FULLBENCH = os.path.join(TESTDIR, "fullbench")
+DATAGEN = os.path.join(TESTDIR, "datagen")
+WORKDIR = os.path.join(TESTDIR, "tmp-benchsuite")
+SPEEDS = ("cSpeedMBs", "dSpeedMBs")
+
+
+def log(text):
+    print(time.strftime("%H:%M:%S") + " - " + text, flush=True)
+
+
+def execute(cmd):
+    res = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, cwd=WORKDIR)
+    if res.returncode != 0:
+        sys.exit(f"error : {' '.join(cmd)} failed (exit code {res.returncode})")
+    return res.stdout.decode("utf-8")
+
+
+# --- corpus : deterministic, so that results remain comparable between versions ---
+
+def gen_json(size, seed):
+    rng = random.Random(seed)
+    words = ["alpha", "beta", "gamma", "delta", "status", "pending", "done", "error", "user", "admin"]
+    out = []
+    total = 0
+    n = 0
+    while total < size:
+        record = {
+            "id": n,
+            "name": rng.choice(words) + "-" + str(rng.randrange(10000)),
+            "role": rng.choice(words),
+            "score": round(rng.random() * 100, 3),
+            "tags": rng.sample(words, rng.randrange(1, 4)),
+            "ts": 1600000000 + n * 17 + rng.randrange(17),
+        }
+        line = json.dumps(record) + "\n"
+        out.append(line)
+        total += len(line)
+        n += 1
+    return "".join(out).encode("utf-8")[:size]
+
+
+def gen_binary(size, seed):
+    # table of fixed-size records : integers, floats, small enums, random padding
+    rng = random.Random(seed)
+    out = bytearray()
+    n = 0
+    while len(out) < size:
+        out += struct.pack("<IqdHH8s", n, 1600000000000 + n * 1000 + rng.randrange(1000),
+                           rng.gauss(0, 1), rng.randrange(16), rng.randrange(3),
+                           bytes(rng.randrange(256) for _ in range(rng.randrange(9))).ljust(8, b"\0"))
+        n += 1
+    return bytes(out[:size])
+
+
+def generate_corpus(size):
+    os.makedirs(WORKDIR, exist_ok=True)
+    corpus = []
+
+    def datagen(name, args):
+        path = os.path.join(WORKDIR, name)
+        with open(path, "wb") as f:
+            f.write(subprocess.run([DATAGEN, f"-g{size}"] + args, stdout=subprocess.PIPE,
+                                   stderr=subprocess.DEVNULL, check=True).stdout)
+        corpus.append(path)
+
+    def write(name, content):
+        path = os.path.join(WORKDIR, name)
+        with open(path, "wb") as f:
+            f.write(content)
+        corpus.append(path)
+
+    datagen("lorem.txt", [])   # no compressibility : lorem ipsum text
+    for proba in (10, 50, 90):
+        datagen(f"datagen-P{proba}", [f"-P{proba}"])
+    write("records.json", gen_json(size, 1))
+    write("records.bin", gen_binary(size, 2))
+    return corpus
+
+
+# --- benchmarks ---
+
+def parse_records(output, tool):
+    for line in output.splitlines():
+        if not line.startswith("{"):
+            continue
+        r = json.loads(line)
+        key = f"{tool}:{r['file']}:{r['api']}:{'-' if r['level'] is None else r['level']}"
+        yield key, r
+
+
+def run_suite(corpus, args):
+    results = {}
+    meta = None
+    for f in corpus:
+        name = os.path.basename(f)
+        cmds = [
+            ("fullbench", [FULLBENCH, "--no-prompt", "--json", "-i1", name]),
+            ("lz4", [LZ4, f"-b{args.levels[0]}e{args.levels[1]}", "-i1", "--bench-format=json", name]),
+            ("lz4-frame", [LZ4, "-b1", "--bench-frame", "-BX", "-i1", "--bench-format=json", name]),
+        ]
+        for tool, cmd in cmds:
+            log(f"{tool} : {name}")
+            for key, r in parse_records(execute(cmd), tool):
+                results[key] = r
+                if meta is None:
+                    meta = {k: r[k] for k in ("cpu", "version", "compiler", "LZ4_MEMORY_USAGE", "LZ4_FAST_DEC_LOOP")}
+    return results, meta
+
+
+def summarize(runs):
+    summary = {}
+    for key in runs[0]:
+        entries = [run[key] for run in runs if key in run]
+        s = {"cSize": entries[0]["cSize"]}
+        for m in SPEEDS:
+            values = [e[m] for e in entries if e[m] is not None]
+            if not values:
+                continue
+            median = statistics.median(values)
+            s[m] = {"median": median, "spread": (max(values) - min(values)) / median if median else 0.}
+        summary[key] = s
+    return summary
+
+
+def compare(baseline, current, threshold):
+    regressions = 0
+    if baseline["meta"] != current["meta"]:
+        log("warning : baseline was recorded in a different environment :")
+        log(f"  baseline : {baseline['meta']}")
+        log(f"  current  : {current['meta']}")
+    for key, cur in sorted(current["results"].items()):
+        ref = baseline["results"].get(key)
+        if ref is None:
+            log(f"new      {key}")
+            continue
+        if cur["cSize"] != ref["cSize"]:
+            regressions += cur["cSize"] > ref["cSize"]
+            log(f"{'REGRESS ' if cur['cSize'] > ref['cSize'] else 'changed '} {key} : compressed size {ref['cSize']} -> {cur['cSize']}")
+        for m in SPEEDS:
+            if m not in cur or m not in ref:
+                continue
+            tolerance = max(threshold, ref[m]["spread"] + cur[m]["spread"])
+            ratio = cur[m]["median"] / ref[m]["median"]
+            if ratio < 1. - tolerance:
+                regressions += 1
+                status = "REGRESS "
+            elif ratio > 1. + tolerance:
+                status = "faster  "
+            else:
+                continue
+            log(f"{status} {key} : {m} {ref[m]['median']:.1f} -> {cur[m]['median']:.1f} "
+                f"({(ratio - 1.) * 100:+.1f}%, tolerance {tolerance * 100:.1f}%)")
+    for key in sorted(set(baseline["results"]) - set(current["results"])):
+        log(f"missing  {key}")
+    return regressions
+
+
+def parse_levels(s):
+    lo, _, hi = s.partition("-")
+    return int(lo), int(hi or lo)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="lz4 benchmark regression suite")
+    parser.add_argument("--save", metavar="FILE", help="record results as new baseline into FILE")
+    parser.add_argument("--compare", metavar="FILE", help="compare results against baseline FILE")
+    parser.add_argument("--runs", type=int, default=3, help="nb of interleaved runs of the whole suite (default: 3)")
+    parser.add_argument("--threshold", type=float, default=3., help="minimum speed difference reported, in %% (default: 3)")
+    parser.add_argument("--size", type=int, default=4 << 20, help="size of each corpus file (default: 4 MiB)")
+    parser.add_argument("--levels", type=parse_levels, default=(1, 12), help="compression levels benchmarked by lz4 -b (default: 1-12)")
+    args = parser.parse_args()
+    if not args.save and not args.compare:
+        parser.error("at least one of --save or --compare is required")
+    if args.compare and not os.path.exists(args.compare):
+        sys.exit(f"error : baseline {args.compare} not found ; create it with --save")
+    for prg in (LZ4, FULLBENCH, DATAGEN):
+        if not os.path.exists(prg):
+            sys.exit(f"error : {prg} not found ; build it first")
+
+    corpus = generate_corpus(args.size)
+    runs = []
+    meta = None
+    try:
+        for n in range(args.runs):
+            log(f"run {n + 1} / {args.runs}")
+            results, meta = run_suite(corpus, args)
+            runs.append(results)
+    finally:
+        shutil.rmtree(WORKDIR, ignore_errors=True)
+    meta["runs"] = args.runs
+    current = {"meta": meta, "results": summarize(runs)}
+    current_env = {k: v for k, v in meta.items() if k != "runs"}
+
+    status = 0
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+        baseline["meta"].pop("runs", None)
+        nb = compare(baseline, {"meta": current_env, "results": current["results"]}, args.threshold / 100.)
+        log(f"{nb} regression(s) over {len(current['results'])} benchmarks")
+        status = int(nb > 0)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(current, f, indent=1, sort_keys=True)
+        log(f"baseline saved into {args.save}")
+    sys.exit(status)
@@ -0,0 +1,33 @@
+#!/bin/sh
+
+FPREFIX="tmp-tcd"
+
+set -e
+
+remove () {
+    rm $FPREFIX*
+}
+
+trap remove EXIT
+
+set -x
+
+# ${FPREFIX}-lz4 is built with LZ4_CPU_DISPATCH=1 : on a cpu with avx2, it runs the avx2 variants,
+# while lz4 runs the default ones. Both must produce the same results.
+DLZ4=./${FPREFIX}-lz4
+nm $DLZ4 2>/dev/null | grep -c '\.avx2' || true   # nb of avx2 variants, for information
+
+datagen -g3M -P50 -s1 > ${FPREFIX}-src
+head -c 2000000 /dev/zero >> ${FPREFIX}-src           # zero runs : sparse detection
+datagen -g1M -P100 -s2 >> ${FPREFIX}-src
+for level in -1 -9 -12; do
+    lz4 -q -f $level ${FPREFIX}-src ${FPREFIX}-ref.lz4
+    $DLZ4 -q -f $level ${FPREFIX}-src ${FPREFIX}-d.lz4
+    cmp ${FPREFIX}-ref.lz4 ${FPREFIX}-d.lz4
+done
+for sparse in --sparse --no-sparse; do
+    lz4 -q -d -f $sparse ${FPREFIX}-d.lz4 ${FPREFIX}-ref
+    $DLZ4 -q -d -f $sparse ${FPREFIX}-ref.lz4 ${FPREFIX}-d
+    cmp ${FPREFIX}-src ${FPREFIX}-ref
+    cmp ${FPREFIX}-src ${FPREFIX}-d
+done
@@ -5,7 +5,7 @@ FPREFIX="tmp-dict"
 set -e
 
 remove () {
-    rm $FPREFIX*
+    rm -rf $FPREFIX*
 }
 
 trap remove EXIT
@@ -34,6 +34,24 @@ touch $FPREFIX-sample-0
 < $FPREFIX-sample-32k lz4 -D $FPREFIX-sample-0 | lz4 -dD $FPREFIX-sample-0 | diff - $FPREFIX-sample-32k
 < $FPREFIX-sample-0 lz4 -D $FPREFIX-sample-0 | lz4 -dD $FPREFIX-sample-0 | diff - $FPREFIX-sample-0
 lz4 -bi0 -D $FPREFIX $FPREFIX-sample-32k $FPREFIX-sample-32k
+lz4 -b1e3 -i0 -T2 --bench-shared-dict=1K -D $FPREFIX $FPREFIX-sample-32k
+lz4 -b1 -i0 --bench-shared-dict=1K $FPREFIX-sample-32k && exit 1   # requires a dictionary
+
+echo "---- test lz4 dictionary training ----"
+mkdir $FPREFIX-train
+for i in $(seq 1 200); do
+    printf '{"id":%d,"type":"page_view","user":{"name":"user%d","locale":"en-US"},"client":"Mozilla/5.0 (X11; Linux x86_64)","page":"/products/%d"}' $i $((i % 7)) $((i * 13)) > $FPREFIX-train/$i.json
+done
+lz4 --train $FPREFIX-train/*.json -D $FPREFIX-trained --maxdict=8KB
+test -s $FPREFIX-trained
+test "$(wc -c < $FPREFIX-trained)" -le 8192
+lz4 -D $FPREFIX-trained $FPREFIX-train/7.json -c | lz4 -dD $FPREFIX-trained | diff - $FPREFIX-train/7.json
+size_dict=$( lz4 -D $FPREFIX-trained $FPREFIX-train/7.json -c | wc -c)
+size_nodict=$( lz4 $FPREFIX-train/7.json -c | wc -c)
+test "$size_dict" -lt "$size_nodict"
+lz4 --train $FPREFIX-train/*.json && exit 1   # missing -D
+lz4 --train -D $FPREFIX-trained2 && exit 1    # missing samples
+rm -r $FPREFIX-train
 
 echo "---- test lz4 dictionary loading ----"
 datagen -g128KB > $FPREFIX-data-128KB
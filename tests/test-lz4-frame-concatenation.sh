@@ -19,3 +19,23 @@ lz4 -zq $FPREFIX-nonempty -c > $FPREFIX-nonempty.lz4
 cat $FPREFIX-nonempty.lz4 $FPREFIX-empty.lz4 $FPREFIX-nonempty.lz4 > $FPREFIX-concat.lz4
 lz4 -d $FPREFIX-concat.lz4 -c > $FPREFIX-result
 cmp $FPREFIX-src $FPREFIX-result
+
+# merge frames into a single frame, without recompression
+datagen -g300KB -s1 > $FPREFIX-part1
+datagen -g200KB -s2 > $FPREFIX-part2
+cat $FPREFIX-part1 $FPREFIX-empty $FPREFIX-part2 > $FPREFIX-parts
+lz4 -zq -B5 --content-size $FPREFIX-part1 -c > $FPREFIX-part1.lz4
+lz4 -zq -B5 -BX --seekable $FPREFIX-part2 -c > $FPREFIX-part2.lz4
+lz4 -f --merge=$FPREFIX-merged.lz4 $FPREFIX-part1.lz4 $FPREFIX-empty.lz4 $FPREFIX-part2.lz4
+lz4 -t $FPREFIX-merged.lz4
+lz4 -d $FPREFIX-merged.lz4 -c | cmp - $FPREFIX-parts
+test "$(lz4 --list $FPREFIX-merged.lz4 | tail -n 1 | awk '{print $1}')" = "1"   # single frame
+lz4 -f -BX --seekable --merge=$FPREFIX-merged.lz4 $FPREFIX-part1.lz4 $FPREFIX-empty.lz4 $FPREFIX-part2.lz4
+lz4 -d $FPREFIX-merged.lz4 -c | cmp - $FPREFIX-parts
+lz4 -zq -B4 $FPREFIX-part2 -c > $FPREFIX-part2-B4.lz4
+lz4 -f --merge=$FPREFIX-merged.lz4 $FPREFIX-part2-B4.lz4 $FPREFIX-part1.lz4   # smaller blocks first
+cat $FPREFIX-part2 $FPREFIX-part1 > $FPREFIX-parts
+lz4 -d $FPREFIX-merged.lz4 -c | cmp - $FPREFIX-parts
+lz4 -zq -B4 -BD $FPREFIX-part2 -c > $FPREFIX-part2-BD.lz4
+lz4 -f --merge=$FPREFIX-bad.lz4 $FPREFIX-part1.lz4 $FPREFIX-part2-BD.lz4 && exit 1   # linked blocks
+test ! -f $FPREFIX-bad.lz4
@@ -0,0 +1,154 @@
+#!/bin/sh
+
+FPREFIX="tmp-lmt"
+
+set -e
+
+remove () {
+    rm $FPREFIX*
+}
+
+trap remove EXIT
+
+set -x
+
+datagen -g20M -P50 > ${FPREFIX}src
+# independent blocks : decoded in parallel
+lz4 -f -B4 ${FPREFIX}src ${FPREFIX}src.lz4
+lz4 -d -f -T4 ${FPREFIX}src.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}src ${FPREFIX}dec
+lz4 -t -T4 ${FPREFIX}src.lz4
+cat ${FPREFIX}src.lz4 | lz4 -d -T3 | cmp ${FPREFIX}src -
+# block checksum, content size, larger blocks
+lz4 -f -BX -B6 --content-size ${FPREFIX}src ${FPREFIX}bx.lz4
+lz4 -d -f -T4 ${FPREFIX}bx.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}src ${FPREFIX}dec
+# linked blocks : must still decode correctly
+lz4 -f -BD ${FPREFIX}src ${FPREFIX}bd.lz4
+lz4 -d -f -T4 ${FPREFIX}bd.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}src ${FPREFIX}dec
+# incompressible data : uncompressed blocks
+datagen -g3M -P0 > ${FPREFIX}rnd
+lz4 -f -B4 ${FPREFIX}rnd ${FPREFIX}rnd.lz4
+lz4 -d -f -T4 ${FPREFIX}rnd.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}rnd ${FPREFIX}dec
+# adaptive compression level
+datagen -g40M -P60 | lz4 -T4 --adapt | lz4 -d -T4 > ${FPREFIX}dec
+datagen -g40M -P60 | cmp - ${FPREFIX}dec
+# frame concatenation
+cat ${FPREFIX}src.lz4 ${FPREFIX}rnd.lz4 ${FPREFIX}bd.lz4 | lz4 -d -T4 > ${FPREFIX}dec
+cat ${FPREFIX}src ${FPREFIX}rnd ${FPREFIX}src | cmp - ${FPREFIX}dec
+# corrupted content checksum must be detected
+cp ${FPREFIX}src.lz4 ${FPREFIX}bad.lz4
+printf '\377' | dd of=${FPREFIX}bad.lz4 bs=1 seek=$(($(wc -c < ${FPREFIX}src.lz4) - 1)) conv=notrunc 2>/dev/null
+lz4 -t -T4 ${FPREFIX}bad.lz4 && exit 1
+# legacy format : independent 8 MB blocks, decoded in parallel
+lz4 -f -l ${FPREFIX}src ${FPREFIX}leg.lz4
+lz4 -d -f -T4 ${FPREFIX}leg.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}src ${FPREFIX}dec
+lz4 -t -T4 ${FPREFIX}leg.lz4
+cat ${FPREFIX}leg.lz4 ${FPREFIX}src.lz4 | lz4 -d -T4 > ${FPREFIX}dec
+cat ${FPREFIX}src ${FPREFIX}src | cmp - ${FPREFIX}dec
+# test mode without content checksum : blocks are verified, then dropped by workers
+lz4 -f -B4 --no-frame-crc ${FPREFIX}src ${FPREFIX}nc.lz4
+lz4 -t -T4 ${FPREFIX}nc.lz4
+head -c 3000000 ${FPREFIX}nc.lz4 > ${FPREFIX}bad.lz4
+lz4 -t -T4 ${FPREFIX}bad.lz4 && exit 1
+# dictionary
+datagen -g128K -s7 > ${FPREFIX}dict
+lz4 -f -B4 -D ${FPREFIX}dict ${FPREFIX}src ${FPREFIX}dict.lz4
+lz4 -d -f -T4 -D ${FPREFIX}dict ${FPREFIX}dict.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}src ${FPREFIX}dec
+# seekable frames : ranges decoded and written in parallel
+cat ${FPREFIX}src ${FPREFIX}rnd > ${FPREFIX}mix
+head -c 1M /dev/zero >> ${FPREFIX}mix
+lz4 -f -BX --seekable ${FPREFIX}mix ${FPREFIX}sk.lz4
+lz4 -d -f -T4 ${FPREFIX}sk.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}mix ${FPREFIX}dec
+lz4 -d -f -T1 ${FPREFIX}sk.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}mix ${FPREFIX}dec
+lz4 -t -T4 ${FPREFIX}sk.lz4
+cat ${FPREFIX}sk.lz4 | lz4 -d -T4 | cmp ${FPREFIX}mix -
+cat ${FPREFIX}src.lz4 ${FPREFIX}sk.lz4 | lz4 -d -T4 > ${FPREFIX}dec
+cat ${FPREFIX}src ${FPREFIX}mix | cmp - ${FPREFIX}dec
+cp ${FPREFIX}sk.lz4 ${FPREFIX}bad.lz4
+printf '\377' | dd of=${FPREFIX}bad.lz4 bs=1 seek=1000000 conv=notrunc 2>/dev/null
+lz4 -d -f -T4 ${FPREFIX}bad.lz4 ${FPREFIX}dec && exit 1
+# multiple files : small files processed concurrently, large ones by chunks
+mkdir ${FPREFIX}m ${FPREFIX}m1
+for i in 1 2 3 4 5 6 7 8; do datagen -s$i -g${i}00K > ${FPREFIX}m/f$i; done
+cp ${FPREFIX}src ${FPREFIX}m/large
+: > ${FPREFIX}m/empty
+cp -r ${FPREFIX}m/* ${FPREFIX}m1/
+lz4 -f -m -T1 ${FPREFIX}m1/*
+lz4 -f -m -T4 ${FPREFIX}m/*
+for f in f1 f5 f8 large empty; do cmp ${FPREFIX}m1/$f.lz4 ${FPREFIX}m/$f.lz4; done
+lz4 -t -m -T4 ${FPREFIX}m/*.lz4
+lz4 -l -f ${FPREFIX}m/f2 ${FPREFIX}m/f2.lz4   # legacy frame : handed back to the calling thread
+rm ${FPREFIX}m1/*.lz4
+mv ${FPREFIX}m/*.lz4 ${FPREFIX}m1/
+lz4 -d -f -m -T4 --rm ${FPREFIX}m1/*.lz4
+for f in f1 f2 f5 f8 large empty; do cmp ${FPREFIX}m/$f ${FPREFIX}m1/$f; done
+test ! -f ${FPREFIX}m1/f1.lz4
+rm -r ${FPREFIX}m ${FPREFIX}m1
+# per-stage statistics
+lz4 -f -T4 --stats ${FPREFIX}src ${FPREFIX}st.lz4 2>&1 | grep -q "peak buffered"
+lz4 -d -f -T4 --stats ${FPREFIX}st.lz4 ${FPREFIX}dec 2>&1 | grep -q "ordered writer"
+cmp ${FPREFIX}src ${FPREFIX}dec
+# direct I/O : same output as buffered mode
+lz4 -f -T4 ${FPREFIX}src ${FPREFIX}ref.lz4
+lz4 -f -T4 --direct-io ${FPREFIX}src ${FPREFIX}dio.lz4
+cmp ${FPREFIX}ref.lz4 ${FPREFIX}dio.lz4
+lz4 -f -T1 --direct-io ${FPREFIX}src ${FPREFIX}dio.lz4
+cmp ${FPREFIX}ref.lz4 ${FPREFIX}dio.lz4
+lz4 -f -l -T4 --direct-io ${FPREFIX}src ${FPREFIX}dio.lz4
+lz4 -f -l -T4 ${FPREFIX}src ${FPREFIX}ref.lz4
+cmp ${FPREFIX}ref.lz4 ${FPREFIX}dio.lz4
+datagen -g5000 > ${FPREFIX}tiny
+lz4 -f -T4 --direct-io ${FPREFIX}tiny ${FPREFIX}dio.lz4
+lz4 -d -c ${FPREFIX}dio.lz4 | cmp ${FPREFIX}tiny -
+# regular output file : written through io_uring when available, same result as fwrite() into a pipe
+lz4 -vvv -f -T4 --max-memory=2M ${FPREFIX}src ${FPREFIX}aio.lz4 2>&1 | grep -a "io_uring" || true   # for information
+lz4 -T4 --max-memory=2M -c ${FPREFIX}src | cmp - ${FPREFIX}aio.lz4
+lz4 -f -T4 -B4 -BX ${FPREFIX}mix ${FPREFIX}aio.lz4
+lz4 -T4 -B4 -BX -c ${FPREFIX}mix | cmp - ${FPREFIX}aio.lz4
+lz4 -f -l -T4 ${FPREFIX}src ${FPREFIX}aio.lz4
+lz4 -l -T4 -c ${FPREFIX}src | cmp - ${FPREFIX}aio.lz4
+# compression queue full : the reader compresses chunks itself, instead of waiting
+head -c 8M ${FPREFIX}src > ${FPREFIX}src8
+lz4 -q -f -T1 -B4 -12 ${FPREFIX}src8 ${FPREFIX}ref.lz4
+nbInline=$(lz4 -v -f -T2 -B4 -12 --max-memory=2M --stats ${FPREFIX}src8 ${FPREFIX}inl.lz4 2>&1 | tr '\r' '\n' | grep "inline chunks" | sed 's/.*: *//')
+test "$nbInline" -gt 0
+cmp ${FPREFIX}ref.lz4 ${FPREFIX}inl.lz4
+# --numa : threads bound to NUMA nodes (no effect on single node systems), same output
+lz4 -q -f -T4 --numa ${FPREFIX}src ${FPREFIX}numa.lz4
+lz4 -T4 -c ${FPREFIX}src | cmp - ${FPREFIX}numa.lz4
+lz4 -q -d -f -T4 --numa ${FPREFIX}numa.lz4 ${FPREFIX}dec
+cmp ${FPREFIX}src ${FPREFIX}dec
+lz4 -q -f -l -T4 --numa ${FPREFIX}src ${FPREFIX}numa.lz4
+lz4 -t -T4 --numa ${FPREFIX}numa.lz4
+# content checksum computed by its own thread : from the mapping, or from read buffers (pipe)
+lz4 -f -T4 -B4 --max-memory=2M ${FPREFIX}mix ${FPREFIX}crc.lz4
+cat ${FPREFIX}mix | lz4 -T4 -B4 --max-memory=2M | cmp - ${FPREFIX}crc.lz4
+lz4 -T1 -B4 -c ${FPREFIX}mix | cmp - ${FPREFIX}crc.lz4
+lz4 -t -T1 ${FPREFIX}crc.lz4
+lz4 -f -T4 --stats ${FPREFIX}mix ${FPREFIX}crc.lz4 2>&1 | grep -a -q "^checksum"
+# buffer pools live across files : more files don't allocate more buffers
+mkdir ${FPREFIX}p
+for i in 1 2 3 4; do head -c 12M ${FPREFIX}src > ${FPREFIX}p/f$i; done
+nbAllocs1=$(lz4 -v -f -T2 --stats -m ${FPREFIX}p/f1 2>&1 | tr '\r' '\n' | grep "buffer allocs" | sed 's/.*: *//')
+nbAllocs4=$(lz4 -v -f -T2 --stats -m ${FPREFIX}p/f* 2>&1 | tr '\r' '\n' | grep "buffer allocs" | sed 's/.*: *//')
+test "$nbAllocs4" -lt $((3 * nbAllocs1))
+for i in 1 2 3 4; do lz4 -d -c ${FPREFIX}p/f$i.lz4 | cmp - ${FPREFIX}p/f$i; done
+rm -r ${FPREFIX}p
+# bounded memory : smaller jobs, same content
+cat ${FPREFIX}src | lz4 -T4 --max-memory=2M | lz4 -d | cmp ${FPREFIX}src -
+lz4 -f -T4 --max-memory=2M ${FPREFIX}src ${FPREFIX}mm.lz4
+lz4 -t ${FPREFIX}mm.lz4
+# low latency pipe : input trickles in, each piece is flushed
+cat ${FPREFIX}tiny ${FPREFIX}tiny ${FPREFIX}tiny > ${FPREFIX}tiny3
+for T in 1 4; do
+    (for i in 1 2 3; do cat ${FPREFIX}tiny; sleep 0.1; done) | lz4 -T$T --flush-interval=10 > ${FPREFIX}fl.lz4
+    lz4 -d -c ${FPREFIX}fl.lz4 | cmp ${FPREFIX}tiny3 -
+done
+true
@@ -17,6 +17,22 @@ datagen > $FPREFIX
 lz4 -f $FPREFIX -c > $FPREFIX.lz4
 lz4 -bdi0 $FPREFIX.lz4 # test benchmark decode-only mode
 lz4 -bdi0 --no-crc $FPREFIX.lz4 # test benchmark decode-only mode
+echo "---- benchmark modes ----"
+datagen -g2M > $FPREFIX-b
+if lz4 -V 2>&1 | grep -q multithread; then
+    # -T# : scaling, threads share input by ranges of blocks, or replicate it
+    test "$(lz4 -b1 -i0 -T2 -B4 $FPREFIX-b 2>&1 | grep -c "^ *[12] :")" -eq 2
+    test "$(lz4 -b1 -i0 -T2 --bench-replicate $FPREFIX-b 2>&1 | grep -c "^ *[12] :")" -eq 2
+    lz4 -b1 -i0 --bench-frame -T2 -B4 $FPREFIX-b 2>&1 | grep -q "^ *2 :"
+fi
+# --bench-frame : frame parameters and dictionary
+datagen -g64K -s2 > $FPREFIX-d
+lz4 -b1 -e3 -i0 --bench-frame -BD -BX $FPREFIX-b 2>&1 | grep -q "linked blocks, block checksums, content checksum"
+lz4 -b9 -i0 --bench-frame -B4 --no-frame-crc --content-size -D $FPREFIX-d $FPREFIX-b
+# --bench-latency=# : one line per API with -q, histograms with -v
+test "$(lz4 -b1 -i0 -q --bench-latency=4K $FPREFIX-b 2>/dev/null | wc -l)" -eq 7
+test "$(lz4 -b9 -i0 -q --bench-latency=1000 $FPREFIX-b 2>/dev/null | grep -c "StreamHC")" -eq 2
+lz4 -b1 -i0 -v --bench-latency=4K $FPREFIX-b 2>&1 | grep -q "LZ4F_decompress (reused dctx) : 512 calls"
 echo "---- test mode ----"
 datagen | lz4 -t && exit 1
 datagen | lz4 -tf && exit 1
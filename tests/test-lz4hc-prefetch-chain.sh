@@ -0,0 +1,32 @@
+#!/bin/sh
+
+FPREFIX="tmp-thpc"
+
+set -e
+
+remove () {
+    rm $FPREFIX*
+}
+
+trap remove EXIT
+
+set -x
+
+# ${FPREFIX}-lz4 is built with LZ4HC_PREFETCH_CHAIN=1 : hash chain walks prefetch next candidate.
+# Prefetching must not change output.
+PLZ4=./${FPREFIX}-lz4
+
+datagen -g3M -P50 -s1 > ${FPREFIX}-src
+datagen -g1M -P90 -s2 >> ${FPREFIX}-src
+datagen -g64K -P50 -s3 > ${FPREFIX}-dict
+for level in -3 -6 -9 -10 -12; do
+    lz4 -q -f $level ${FPREFIX}-src ${FPREFIX}-ref.lz4
+    $PLZ4 -q -f $level ${FPREFIX}-src ${FPREFIX}-p.lz4
+    cmp ${FPREFIX}-ref.lz4 ${FPREFIX}-p.lz4
+    # linked blocks : previous block as external dictionary ; dictionary attached as a separate context
+    lz4 -q -f $level -BD -B4 -D ${FPREFIX}-dict ${FPREFIX}-src ${FPREFIX}-ref.lz4
+    $PLZ4 -q -f $level -BD -B4 -D ${FPREFIX}-dict ${FPREFIX}-src ${FPREFIX}-p.lz4
+    cmp ${FPREFIX}-ref.lz4 ${FPREFIX}-p.lz4
+done
+$PLZ4 -q -d -f -D ${FPREFIX}-dict ${FPREFIX}-p.lz4 ${FPREFIX}-dec
+cmp ${FPREFIX}-src ${FPREFIX}-dec